@@ -22,10 +22,16 @@ class Builer:
     
     def build(self):
         
-        if self.config.settings.mode == Mode.LIVE:
+        settings = self.config.settings
+        handler = None
+        if settings.mode == Mode.LIVE:
+            if settings.render:
+                handler = RadarHandler(self.global_vals, mode='live', render_shm=settings.render_shm)
             radardisplay = RadarDisplay(self.global_vals, self.config, mode='live')
-        elif self.config.settings.mode == Mode.FILE:
+        elif settings.mode == Mode.FILE:
             file_path = os.path.join(os.path.dirname(os.path.dirname(__file__)), '20250124-120122-0x2eea4790.cpr')
+            if settings.render:
+                handler = RadarHandler(self.global_vals, mode='file', file_path=file_path, render_shm=settings.render_shm)
             radardisplay = RadarDisplay(self.global_vals, self.config, mode='file', file_path=file_path)
         elif self.config.settings.mode == Mode.DIRECTORY:
             # 현재 스크립트의 상위 폴더 경로 지정
@@ -36,4 +42,6 @@ class Builer:
             raise ValueError(f"Invalid mode: {self.config.settings.mode}")
 
         radardisplay.run()
+        if handler is not None:
+            handler.stop()
 
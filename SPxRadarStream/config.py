@@ -17,6 +17,30 @@ class Mode(Enum):
 @dataclass
 class SETTINGS:
     mode: Mode
+    # True 이면 LIVE/FILE 모드에서 SPxRenderServer 가 공유 메모리에 스캔 변환한 영상을 표시
+    render: bool = False
+    render_shm: str = '/spxrender'
+    # 잔상(afterglow) 모드: 섹터를 지우지 않고 매 프레임 감쇠, afterglow_secs 후 완전히 사라짐
+    afterglow: bool = False
+    afterglow_secs: float = 3.0
+    # 화면 갱신 주기와 프레임당 섹터 처리 시간 예산 (초과분은 섹터별로 최신 데이터만 유지)
+    frame_rate: int = 60
+    process_budget_ms: float = 10.0
+    # 레이더 한 개의 표시 크기(픽셀). 듀얼 모드 창 폭은 두 배
+    view_size: int = 600
+    # libspxviewer.so 의 타일 래스터로 스캔 변환 (0 스레드 = 코어 수만큼)
+    # 필터 체인/CFAR/클러터 맵도 같은 스레드 풀에서 방위 구간별로 병렬 처리
+    native_raster: bool = True
+    raster_threads: int = 0
+    # 필터 체인 (형식은 SPxRadarStream/filter.py 참고, 예: 'blank:0-150;stc:400,30;median:3;thresh:40')
+    filter_params: str = 'blank:0-150'
+    # 회전 간 적분 (I 키로 전환, 형식은 src/SPxScanIntegrator.h: 'mean,4', 'max,4', 'mofn,5,3,40')
+    integrate: bool = False
+    integration: str = 'mean,4'
+    # 적응형 클러터 맵 (필터 체인 앞, 형식은 src/SPxClutterMap.h: 'sub,4,10', 'thresh,5,20', 빈 문자열 = 사용 안 함)
+    # 맵 파일을 지정하면 시작할 때 읽고 종료할 때 저장
+    clutter_map: str = ''
+    clutter_map_file: str = ''
         
 def initialize_global_values():
     manager = multiprocessing.Manager()
@@ -6,11 +6,14 @@ import time
 import glob
 
 class RadarHandler:
-    def __init__(self, global_vals, mode='live', file_path=None):
+    def __init__(self, global_vals, mode='live', file_path=None, render_shm=None):
         self.global_vals = global_vals
         self.mode = mode
         self.file_path = file_path
+        self.render_shm = render_shm
         self.files = []
+        self.process = None
+        self.receiver_thread = None
         self.run()
 
     def data_receiver(self):
@@ -161,6 +164,20 @@ class RadarHandler:
 
     
     def run(self):
+        if self.render_shm is not None:
+            # 렌더 서버 모드: 스캔 변환은 SPxRenderServer 가 공유 메모리에 직접 수행
+            args = ['./src/SPxRenderServer', '-s', self.render_shm]
+            if self.mode == 'live':
+                args += ['-a', '239.192.43.79']
+            elif self.mode == 'file':
+                args.append(self.file_path)
+            else:
+                raise ValueError("렌더 서버는 'live' 또는 'file' 모드만 지원합니다.")
+            self.process = subprocess.Popen(args,
+                                          stdout=subprocess.DEVNULL,
+                                          stderr=subprocess.DEVNULL)
+            return
+
         if self.mode == 'live':
             self.process = subprocess.Popen(['./src/SPxLiveStream', '-a', '239.192.43.79'],
                                           stdout=subprocess.PIPE,
@@ -184,3 +201,9 @@ class RadarHandler:
 
         # self.receiver_thread.daemon = True
         self.receiver_thread.start()
+
+    def stop(self):
+        if self.process:
+            self.process.terminate()
+            self.process.wait()
+            self.process = None
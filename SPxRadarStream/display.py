@@ -2,45 +2,58 @@
 import numpy as np
 import pygame
 import math
+import os
 import time
-from SPxRadarStream.filter import RadarFilter
+import queue
+import threading
+from SPxRadarStream.filter import RadarFilter, DEFAULT_PARAMS
+from SPxRadarStream.render import RenderClient
+from SPxRadarStream import native
 
 class RadarDisplay:
     def __init__(
                 self,
                 global_vals,
                 Config,
-                screen_size=(600, 600),
+                screen_size=None,
                 mode='live',
-                file_path=None
+                file_path=None,
+                headless=False
                 ):
+        # 헤드리스: X 창 없이 화면 대신 오프스크린 서피스에 합성 (빌드 서버 벤치마크/골든 이미지용)
+        self.headless = headless
+        if headless:
+            os.environ.setdefault('SDL_VIDEODRIVER', 'dummy')
         pygame.init()
         self.global_vals = global_vals
         self.config = Config
+        settings = getattr(self.config, 'settings', None)
+        # 레이더 한 개의 표시 크기 (고해상도 모니터에서는 2000 등으로 설정)
+        self.view_size = int(getattr(settings, 'view_size', 600))
+        if screen_size is None:
+            screen_size = (self.view_size, self.view_size)
         self.screen_size = screen_size
-        self.screen = pygame.display.set_mode(screen_size)
-        self.radar_filter = RadarFilter()
+        self.screen = self.create_screen(screen_size)
+        self.radar_filter = RadarFilter(getattr(settings, 'filter_params', DEFAULT_PARAMS))
         # 모드에 따른 캡션 설정
         mode_text = {
             'live': 'LiveStream',
             'file': 'fileStream',
             'directory': 'directoryStream'
         }.get(mode, '알 수 없는 모드')
-        pygame.display.set_caption(f"Radar Display - Original vs Filtered ({mode_text})")
+        if not headless:
+            pygame.display.set_caption(f"Radar Display - Original vs Filtered ({mode_text})")
         
         self.center_original = (screen_size[0]//2, screen_size[1]//2)  # 왼쪽 레이더 중심
         self.center_filtered = (3*screen_size[0]//2, screen_size[1]//2)  # 오른쪽 레이더 중심
-        self.scale_factor = 250
+        self.scale_factor = self.view_size * 250 // 600
         self.current_end_range = 50.0
         self.scale = 0
         self.concentric_circles = 5  # 동심원 개수
 
         self.angle_idx = 0
         self.current_sector = 0
-        self.data_surface_original = pygame.Surface(screen_size)
-        self.data_surface_original.fill((0, 0, 0))
-        self.data_surface_filtered = pygame.Surface(screen_size)
-        self.data_surface_filtered.fill((0, 0, 0))
+        self.create_data_surfaces()
         
         # 섹터 관련 변수
         self.sector_timestamps = {i: 0 for i in range(12)}
@@ -63,104 +76,362 @@ class RadarDisplay:
         # self.global_vals.is_paused = False
         self.display_mode = 'single'  # 'single' 또는 'dual' 모드
 
-    def draw_radar_display(self):
+        # 화면 갱신 캐시: 섹터 마스크(창 크기/레이아웃별), 정적 격자 레이어, 변경 영역
+        self.font_grid = pygame.font.Font(None, 18)
+        self.font_title = pygame.font.Font(None, 36)
+        self.font_status = pygame.font.Font(None, 24)
+        self.sector_masks = {}
+        self.grid_layer = None
+        self.grid_key = None
+        self.dirty_rects = []
+        self.full_redraw = True
+        self.back_dirty_rects = []                  # 처리 서피스에서 아직 표시 서피스로 옮기지 않은 영역
+        self.back_full = True
+        self.show_stats = False
+        self.frame_cpu_ms = 0.0
+
+        # 잔상 모드 (SPxScSourceLocal::SetFade 와 유사한 형광 잔상)
+        self.afterglow = bool(getattr(settings, 'afterglow', False))
+        self.afterglow_secs = float(getattr(settings, 'afterglow_secs', 3.0))
+        self.last_fade_time = time.perf_counter()
+        self.fade_ms = 0.0
+
+        # 수신/처리 스레드와 화면 스레드 분리
+        self.frame_rate = int(getattr(settings, 'frame_rate', 60))
+        self.process_budget_ms = float(getattr(settings, 'process_budget_ms', 10.0))
+        self.process_lock = threading.RLock()       # 처리 서피스/래스터/적분기 보호
+        self.surface_lock = threading.RLock()       # 표시 서피스/변경 영역 보호 (짧게만 잡음)
+        self.pending_cond = threading.Condition()   # 처리 대기 섹터 보호
+        self.pending = {}                           # 섹터 번호 -> (섹터 데이터, 수신 시각)
+        self.coalesced_count = 0
+        self.process_ms = 0.0
+        self.stop_event = threading.Event()
+        self.worker_threads = []
+
+        # 네이티브 타일 래스터: 극좌표 영상을 변경된 타일만 여러 코어에서 서피스에 직접 스캔 변환
+        self.use_raster = bool(getattr(settings, 'native_raster', True)) and native.available()
+        self.raster_threads = int(getattr(settings, 'raster_threads', 0))
+        self.rasters = []
+        self.raster_key = None
+        self.raster_ms = 0.0
+
+        # 회전 간 적분: 최근 K 회전의 극좌표 영상을 네이티브 링 버퍼에 두고 표시 데이터를 적분값으로 대체
+        self.integrate = bool(getattr(settings, 'integrate', False)) and native.available()
+        self.integration = getattr(settings, 'integration', 'mean,4')
+        self.integrator = None
+
+        # 적응형 클러터 맵: 셀별 배경(지수 이동 평균)을 빼거나 임계값으로 사용, 필터 모드에서 필터 체인 앞에 적용
+        self.clutter_args = getattr(settings, 'clutter_map', '') if native.available() else ''
+        self.clutter_file = getattr(settings, 'clutter_map_file', '')
+        self.clutter_map = None
+
+        # 렌더 서버 모드: SPxRenderServer 가 그린 공유 메모리 비트맵을 사용
+        self.render_client = None
+        self.render_view = None
+        if settings is not None and getattr(settings, 'render', False) and mode in ('live', 'file'):
+            self.render_client = RenderClient(settings.render_shm)
+
+    def create_data_surfaces(self):
+        """처리 스레드가 그리는 data_surface_* 와 화면 스레드가 합성하는 display_surface_* 를 새로 만듦"""
+        self.data_surface_original = pygame.Surface(self.screen_size)
+        self.data_surface_original.fill((0, 0, 0))
+        self.data_surface_filtered = pygame.Surface(self.screen_size)
+        self.data_surface_filtered.fill((0, 0, 0))
+        self.display_surface_original = pygame.Surface(self.screen_size)
+        self.display_surface_original.fill((0, 0, 0))
+        self.display_surface_filtered = pygame.Surface(self.screen_size)
+        self.display_surface_filtered.fill((0, 0, 0))
+
+    def create_screen(self, size):
+        if self.headless:
+            return pygame.Surface(size, 0, 32)
+        return pygame.display.set_mode(size)
+
+    def draw_radar_display(self, surface):
         if self.display_mode == 'single':
             # 단일 레이더 (원본만)
-            self.draw_single_radar((self.screen_size[0]//2, self.screen_size[1]//2), "Original")
+            self.draw_single_radar(surface, (self.screen_size[0]//2, self.screen_size[1]//2), "Original")
         else:
             # 두 개의 레이더 (원본과 필터링)
-            self.draw_single_radar(self.center_original, "Original")
-            self.draw_single_radar(self.center_filtered, "Filtered")
+            self.draw_single_radar(surface, self.center_original, "Original")
+            self.draw_single_radar(surface, self.center_filtered, "Filtered")
 
-    def draw_single_radar(self, center, title):
+    def draw_single_radar(self, surface, center, title):
         # 레이더 배경 원 그리기
-        pygame.draw.circle(self.screen, (0, 100, 0), center, self.scale_factor, 1)
+        pygame.draw.circle(surface, (0, 100, 0), center, self.scale_factor, 1)
         
         # 동심원과 거리 텍스트 그리기
-        font = pygame.font.Font(None, 18)
+        font = self.font_grid
         distance = np.linspace(0, self.current_end_range, self.concentric_circles + 1)
         # radius_ = np.linspace(0,self.scale_factor,6)
         for i in range(1, ((self.concentric_circles+1)-self.scale)):
             radius = self.scale_factor * i / (self.concentric_circles-self.scale)
-            pygame.draw.circle(self.screen, (0, 50, 0), center, int(radius), 1)
+            pygame.draw.circle(surface, (0, 50, 0), center, int(radius), 1)
             
             # distance = self.current_end_range * i / (5-self.scale)
             text = f"{distance[i]:.1f}m"
             text_surface = font.render(text, True, (0, 100, 0))
             text_rect = text_surface.get_rect()
             text_rect.midleft = (center[0] + int(radius) + 2, center[1]+10)
-            self.screen.blit(text_surface, text_rect)
+            surface.blit(text_surface, text_rect)
         
         # 방위각 선 그리기
         for angle in range(0, 360, 30):
             rad = math.radians(angle) - math.pi/2
             end_x = center[0] + self.scale_factor * math.cos(rad)
             end_y = center[1] + self.scale_factor * math.sin(rad)
-            pygame.draw.line(self.screen, (0, 50, 0), center, (int(end_x), int(end_y)), 1)
+            pygame.draw.line(surface, (0, 50, 0), center, (int(end_x), int(end_y)), 1)
         
         # 제목 표시
-        title_font = pygame.font.Font(None, 36)
-        title_surface = title_font.render(title, True, (0, 150, 0))
+        title_surface = self.font_title.render(title, True, (0, 150, 0))
         title_rect = title_surface.get_rect()
         title_rect.midtop = (center[0], 10)
-        self.screen.blit(title_surface, title_rect)
+        surface.blit(title_surface, title_rect)
+
+    def get_grid_layer(self):
+        """격자/거리 눈금/제목이 그려진 정적 레이어. 확대 상태나 창 배치가 바뀔 때만 다시 그림"""
+        key = (self.screen_size, self.display_mode, self.concentric_circles,
+               self.scale, self.current_end_range, self.scale_factor)
+        if key != self.grid_key:
+            if self.grid_layer is None or self.grid_layer.get_size() != self.screen_size:
+                self.grid_layer = pygame.Surface(self.screen_size)
+            self.grid_layer.fill((0, 0, 0))
+            self.draw_radar_display(self.grid_layer)
+            self.grid_key = key
+            self.full_redraw = True
+        return self.grid_layer
+
+    def get_sector_masks(self):
+        """섹터별 지우기 다각형과 변경 영역을 창 크기/레이아웃별로 한 번만 계산"""
+        key = (self.screen_size, self.display_mode, self.scale_factor)
+        masks = self.sector_masks.get(key)
+        if masks is None:
+            bounds = pygame.Rect((0, 0), self.screen_size)
+            if self.display_mode == 'dual':
+                targets = [('data_surface_original', self.center_original),
+                           ('data_surface_filtered', self.center_filtered)]
+            else:
+                targets = [('data_surface_original', self.center_original)]
+            masks = []
+            for sector in range(12):
+                start_rad = math.radians(sector * 30) - math.pi/2
+                end_rad = math.radians((sector + 1) * 30) - math.pi/2
+                entries = []
+                for surface_name, center in targets:
+                    points = [center]
+                    for angle in np.linspace(start_rad, end_rad, 31):
+                        x = center[0] + (self.scale_factor * 1.2) * math.cos(angle)
+                        y = center[1] + (self.scale_factor * 1.2) * math.sin(angle)
+                        points.append((int(x), int(y)))
+                    xs = [pt[0] for pt in points]
+                    ys = [pt[1] for pt in points]
+                    rect = pygame.Rect(min(xs) - 1, min(ys) - 1,
+                                       max(xs) - min(xs) + 3, max(ys) - min(ys) + 3).clip(bounds)
+                    entries.append((surface_name, tuple(points), rect))
+                masks.append(entries)
+            self.sector_masks[key] = masks
+        return masks
+
+    def radar_areas(self):
+        """각 레이더 원을 덮는 화면 영역 (섹터 영역들의 합)"""
+        masks = self.get_sector_masks()
+        return [masks[0][i][2].unionall([masks[sector][i][2] for sector in range(1, 12)])
+                for i in range(len(masks[0]))]
+
+    def apply_afterglow(self, now=None):
+        """경과 시간에 비례해 데이터 서피스 전체를 감쇠 (afterglow_secs 후 1/256).
+        now 를 주면 그 시각 기준 (헤드리스 재생의 데이터 시간)"""
+        if now is None:
+            now = time.perf_counter()
+        elapsed = now - self.last_fade_time
+        factor = int(round(256.0 * (1.0 / 256.0) ** (elapsed / max(self.afterglow_secs, 0.01))))
+        if factor > 255:
+            # 감쇠량이 1단계 미만이면 시간을 누적
+            return
+        start = time.perf_counter()
+        native.fade_surface(self.data_surface_original, factor)
+        if self.display_mode == 'dual':
+            native.fade_surface(self.data_surface_filtered, factor)
+        self.fade_ms = (time.perf_counter() - start) * 1000.0
+        self.last_fade_time = now
+        for rect in self.radar_areas():
+            self.mark_dirty(rect)
+
+    def mark_dirty(self, rect):
+        if not self.back_full:
+            self.back_dirty_rects.append(rect)
+
+    def invalidate_display(self):
+        self.back_full = True
+        self.back_dirty_rects = []
+
+    def publish(self):
+        """처리 서피스에서 바뀐 영역만 표시 서피스로 복사 (process_lock 을 잡은 채로 호출).
+        화면 스레드는 이 복사 동안만 기다림"""
+        if not self.back_full and not self.back_dirty_rects:
+            return
+        with self.surface_lock:
+            if self.back_full:
+                self.display_surface_original.blit(self.data_surface_original, (0, 0))
+                self.display_surface_filtered.blit(self.data_surface_filtered, (0, 0))
+                self.full_redraw = True
+                self.dirty_rects = []
+            else:
+                for rect in self.back_dirty_rects:
+                    self.display_surface_original.blit(self.data_surface_original, rect, rect)
+                    self.display_surface_filtered.blit(self.data_surface_filtered, rect, rect)
+                if not self.full_redraw:
+                    self.dirty_rects.extend(self.back_dirty_rects)
+        self.back_full = False
+        self.back_dirty_rects = []
 
     def process_sector_data(self, sector_data, received_time):
         first_azimuth = float(sector_data[0][0])
         current_sector = int(first_azimuth // 30)
         self.current_end_range = float(sector_data[0][1])
         
-        for row in sector_data:
-            azimuth = float(row[0])
-            intensity_data = np.array([int(x) for x in row[3:]])
-            
+        spokes = [(float(row[0]), np.array([int(x) for x in row[3:]])) for row in sector_data]
+        # 필터가 필요한 모드에서는 섹터 전체를 한 번에 필터링 (스포크 길이가 같을 때)
+        filtered_rows = [None] * len(spokes)
+        same_length = len({len(data) for _, data in spokes}) == 1
+        if self.display_mode != 'single' and same_length:
+            frame = np.stack([data for _, data in spokes])
+            if self.clutter_args:
+                frame = self.apply_clutter_map(spokes, frame)
+            filtered_frame = self.radar_filter.apply_frame(frame, [azimuth for azimuth, _ in spokes],
+                                                           self.raster_threads)
+            filtered_rows = [row.astype(spokes[0][1].dtype) for row in filtered_frame]
+        if self.integrate and same_length:
+            # 단일 모드는 원본, 나머지 모드는 필터 결과를 적분해서 표시
+            if self.display_mode == 'single':
+                integrated = self.integrate_rows(spokes, [data for _, data in spokes])
+                spokes = [(azimuth, row) for (azimuth, _), row in zip(spokes, integrated)]
+            else:
+                filtered_rows = list(self.integrate_rows(spokes, filtered_rows))
+
+        for (azimuth, intensity_data), filtered_data in zip(spokes, filtered_rows):
             if received_time > self.sector_timestamps[current_sector]:
                 if current_sector != self.angle_idx:
-                    self.clear_sector(current_sector)
+                    if not self.afterglow and not self.use_raster:
+                        self.clear_sector(current_sector)
                     self.angle_idx = current_sector
 
-                self.draw_intensity_data(azimuth, intensity_data)
+                self.draw_intensity_data(azimuth, intensity_data, filtered_data)
         
+        if self.use_raster:
+            # 래스터가 실제로 다시 그린 타일 영역만 화면 갱신 대상으로 추가
+            self.render_rasters()
+        else:
+            # 데이터가 그려진 섹터 영역만 화면 갱신 대상으로 추가
+            for _, _, rect in self.get_sector_masks()[current_sector]:
+                self.mark_dirty(rect)
         self.sector_timestamps[current_sector] = received_time#int(sector_data[-1][2])
 
+    def integrate_rows(self, spokes, rows):
+        """섹터의 스포크들을 적분기에 넣고 각 스포크 방위의 적분 결과 반환 (스포크 길이가 바뀌면 새로 시작)"""
+        num_gates = len(rows[0])
+        if self.integrator is None or self.integrator.num_gates != num_gates:
+            if self.integrator is not None:
+                self.integrator.close()
+            self.integrator = native.ScanIntegrator(self.integration, num_gates)
+        frame = np.clip(np.stack(rows), 0, 255).astype(np.uint8)
+        return self.integrator.update([azimuth for azimuth, _ in spokes], frame).astype(rows[0].dtype)
+
+    def apply_clutter_map(self, spokes, frame):
+        """섹터의 스포크들에서 클러터를 제거 (맵은 첫 섹터에서 만들거나 파일에서 읽음)"""
+        frame = np.ascontiguousarray(np.clip(frame, 0, 255), dtype=np.uint8)
+        if self.clutter_map is None:
+            self.clutter_map = native.ClutterMap(self.clutter_args, frame.shape[1])
+            if self.clutter_file and os.path.exists(self.clutter_file):
+                if self.clutter_map.load(self.clutter_file):
+                    print(f"Loaded clutter map from '{self.clutter_file}'")
+                else:
+                    print(f"Ignoring invalid clutter map file '{self.clutter_file}'")
+        return self.clutter_map.apply([azimuth for azimuth, _ in spokes], frame, self.raster_threads)
+
     def clear_sector(self, sector):
-        sector_mask = pygame.Surface(self.screen_size, pygame.SRCALPHA)
-        sector_mask.fill((0, 0, 0, 0))
-        
-        start_angle = sector * 30
-        end_angle = (sector + 1) * 30
-        
-        # 원본 레이더용 섹터 지우기
-        points_original = [self.center_original]
-        # 필터링된 레이더용 섹터 지우기
-        points_filtered = [self.center_filtered]
-        
-        start_rad = math.radians(start_angle) - math.pi/2
-        end_rad = math.radians(end_angle) - math.pi/2
-        
-        for angle in np.linspace(start_rad, end_rad, 31):
-            x_orig = self.center_original[0] + (self.scale_factor * 1.2) * math.cos(angle)
-            y_orig = self.center_original[1] + (self.scale_factor * 1.2) * math.sin(angle)
-            points_original.append((int(x_orig), int(y_orig)))
-            
-            x_filt = self.center_filtered[0] + (self.scale_factor * 1.2) * math.cos(angle)
-            y_filt = self.center_filtered[1] + (self.scale_factor * 1.2) * math.sin(angle)
-            points_filtered.append((int(x_filt), int(y_filt)))
-        
-        if len(points_original) > 2:
-            pygame.draw.polygon(sector_mask, (0, 0, 0, 255), points_original)
-            pygame.draw.polygon(sector_mask, (0, 0, 0, 255), points_filtered)
-        
-        self.data_surface_original.blit(sector_mask, (0, 0))
-        self.data_surface_filtered.blit(sector_mask, (0, 0))
+        # 미리 계산된 섹터 다각형을 데이터 서피스에 직접 검은색으로 채움 (매번 서피스를 만들지 않음)
+        for surface_name, points, rect in self.get_sector_masks()[sector]:
+            pygame.draw.polygon(getattr(self, surface_name), (0, 0, 0), points)
+            self.mark_dirty(rect)
 
-    def draw_intensity_data(self, azimuth, intensity_data):
+    def clear_data(self):
+        """데이터 서피스와 래스터의 극좌표 영상을 모두 지움 (파일 이동 등)"""
+        self.data_surface_original.fill((0, 0, 0))
+        self.data_surface_filtered.fill((0, 0, 0))
+        for raster, _, _, _ in self.rasters:
+            raster.clear()
+        if self.integrator is not None:
+            self.integrator.reset()
+
+    def get_rasters(self):
+        """표시 모드/창 크기별 래스터 목록: (래스터, 서피스 이름, 서피스 내 영역, 추가 플래그)"""
+        key = (self.screen_size, self.display_mode, self.scale_factor)
+        if key != self.raster_key:
+            for raster, _, _, _ in self.rasters:
+                raster.close()
+            if self.display_mode == 'single':
+                targets = [('data_surface_original', self.center_original, (0, 255, 0), 0)]
+            elif self.display_mode == 'filter_visualization':
+                # 남은 데이터는 초록, 제거된 데이터는 빨강 (같은 타일에 최댓값 합성)
+                targets = [('data_surface_original', self.center_original, (0, 255, 0), 0),
+                           ('data_surface_original', self.center_original, (255, 0, 0), native.RASTER_MAX)]
+            else:
+                targets = [('data_surface_original', self.center_original, (0, 255, 0), 0),
+                           ('data_surface_filtered', self.center_filtered, (0, 255, 0), 0)]
+            self.rasters = []
+            for surface_name, center, colour, flags in targets:
+                bounds = getattr(self, surface_name).get_rect()
+                rect = pygame.Rect(0, 0, self.view_size, self.view_size)
+                rect.center = center
+                rect = rect.clip(bounds)
+                raster = native.Raster(rect.width, rect.height)
+                raster.set_colour(colour)
+                self.rasters.append((raster, surface_name, rect, flags))
+            self.raster_key = key
+        return self.rasters
+
+    def update_rasters(self, azimuth, intensity_data, filtered_data=None):
+        rasters = self.get_rasters()
+        if self.display_mode == 'single':
+            rasters[0][0].update_spoke(azimuth, intensity_data)
+            return
+        if filtered_data is None:
+            filtered_data = self.radar_filter.apply_filter(intensity_data, azimuth)
+        if self.display_mode == 'filter_visualization':
+            removed_data = np.where(intensity_data > filtered_data, intensity_data, 0)
+            rasters[0][0].update_spoke(azimuth, filtered_data)
+            rasters[1][0].update_spoke(azimuth, removed_data)
+        else:
+            rasters[0][0].update_spoke(azimuth, intensity_data)
+            rasters[1][0].update_spoke(azimuth, filtered_data)
+
+    def render_rasters(self):
+        """변경된 타일만 데이터 서피스에 스캔 변환하고 그 영역을 화면 갱신 대상으로 추가"""
+        start = time.perf_counter()
+        ratio = (self.concentric_circles - self.scale) / self.concentric_circles
+        # 잔상 모드: 감쇠된 기존 영상에 새 스포크만 최댓값으로 더함
+        base_flags = (native.RASTER_MAX | native.RASTER_CONSUME) if self.afterglow else 0
+        for raster, surface_name, rect, flags in self.get_rasters():
+            center = self.center_original if surface_name == 'data_surface_original' else self.center_filtered
+            raster.set_geometry((center[0] - rect.x, center[1] - rect.y), self.scale_factor,
+                                (raster.num_gates - 1) * ratio)
+            dirty = raster.render(getattr(self, surface_name), rect, self.raster_threads, base_flags | flags)
+            if dirty is not None:
+                self.mark_dirty(dirty)
+        self.raster_ms = (time.perf_counter() - start) * 1000.0
+
+    def draw_intensity_data(self, azimuth, intensity_data, filtered_data=None):
+        if self.use_raster:
+            self.update_rasters(azimuth, intensity_data, filtered_data)
+            return
+        if filtered_data is None and self.display_mode != 'single':
+            filtered_data = self.radar_filter.apply_filter(intensity_data, azimuth)
         if self.display_mode == 'single':
             # 원본 데이터 그리기
             self._draw_single_intensity_data(self.data_surface_original, self.center_original, azimuth, intensity_data)
         elif self.display_mode == 'filter_visualization':
             # 필터링 시각화 모드
-            filtered_data = self.radar_filter.apply_filter(intensity_data)
             # 필터링된 데이터는 초록색으로 표시
             self._draw_single_intensity_data_colored(self.data_surface_original, self.center_original, azimuth, filtered_data, (0, 255, 0))
             # 필터링으로 제거된 데이터는 빨간색으로 표시
@@ -168,8 +439,6 @@ class RadarDisplay:
             self._draw_single_intensity_data_colored(self.data_surface_original, self.center_original, azimuth, removed_data, (255, 0, 0))
         else:
             # 듀얼 모드 (기존 코드)
-            filtered_data = self.radar_filter.apply_filter(intensity_data)
-            
             self._draw_single_intensity_data(self.data_surface_original, self.center_original, azimuth, intensity_data)
             self._draw_single_intensity_data(self.data_surface_filtered, self.center_filtered, azimuth, filtered_data)
 
@@ -197,6 +466,11 @@ class RadarDisplay:
             intensities = intensity_data[mask][valid_indices]
             
             colors = np.minimum(intensities, 255) << 8
+            if self.afterglow:
+                # 잔상 모드: 기존 잔상과 채널별 최댓값으로 합성
+                del pixel_array
+                native.plot_max(surface, x, y, colors)
+                return
             pixel_array[x, y] = colors
         
         del pixel_array
@@ -228,10 +502,18 @@ class RadarDisplay:
             if g: colors |= (g << 8)
             if b: colors |= b
             
+            if self.afterglow:
+                del pixel_array
+                native.plot_max(surface, x, y, colors)
+                return
             pixel_array[x, y] = colors
         
         del pixel_array
 
+    def progress_bar_area(self):
+        """스크롤바와 위쪽 진행률/상태 텍스트를 포함하는 화면 영역"""
+        return pygame.Rect(0, self.screen_size[1] - 75, self.screen_size[0], 75)
+
     def draw_progress_bar(self):
         """진행 상황 스크롤바 그리기"""
         if self.mode == 'directory' and self.global_vals.total_files > 0:
@@ -256,7 +538,7 @@ class RadarDisplay:
             pygame.draw.rect(self.screen, (0, 150, 0), self.scroll_button_rect)
             
             # 진행률 텍스트
-            font = pygame.font.Font(None, 24)
+            font = self.font_status
             progress_text = f"{self.global_vals.current_file_index}/{self.global_vals.total_files}"
             text_surface = font.render(progress_text, True, (0, 150, 0))
             text_rect = text_surface.get_rect(midtop=(self.scroll_rect.centerx, self.scroll_rect.top - 25))
@@ -274,46 +556,57 @@ class RadarDisplay:
             if event.key == pygame.K_1:
                 # 단일 레이더 모드로 전환 (원본 데이터)
                 self.display_mode = 'single'
-                self.screen_size = (600, 600)
-                self.screen = pygame.display.set_mode(self.screen_size)
-                self.data_surface_original = pygame.Surface(self.screen_size)
-                self.data_surface_original.fill((0, 0, 0))
-                self.data_surface_filtered = pygame.Surface(self.screen_size)
-                self.data_surface_filtered.fill((0, 0, 0))
+                self.screen_size = (self.view_size, self.view_size)
+                self.screen = self.create_screen(self.screen_size)
+                self.create_data_surfaces()
             elif event.key == pygame.K_2:
                 # 단일 레이더 모드로 전환 (필터링 시각화)
                 self.display_mode = 'filter_visualization'
-                self.screen_size = (600, 600)
-                self.screen = pygame.display.set_mode(self.screen_size)
-                self.data_surface_original = pygame.Surface(self.screen_size)
-                self.data_surface_original.fill((0, 0, 0))
-                self.data_surface_filtered = pygame.Surface(self.screen_size)
-                self.data_surface_filtered.fill((0, 0, 0))
+                self.screen_size = (self.view_size, self.view_size)
+                self.screen = self.create_screen(self.screen_size)
+                self.create_data_surfaces()
             elif event.key == pygame.K_3:
                 # 듀얼 레이더 모드로 전환
                 self.display_mode = 'dual'
-                self.screen_size = (1200, 600)
-                self.screen = pygame.display.set_mode(self.screen_size)
-                self.data_surface_original = pygame.Surface(self.screen_size)
-                self.data_surface_original.fill((0, 0, 0))
-                self.data_surface_filtered = pygame.Surface(self.screen_size)
-                self.data_surface_filtered.fill((0, 0, 0))
+                self.screen_size = (2 * self.view_size, self.view_size)
+                self.screen = self.create_screen(self.screen_size)
+                self.create_data_surfaces()
             elif event.key == pygame.K_SPACE:
                 self.global_vals.is_paused = not self.global_vals.is_paused
+            elif event.key == pygame.K_s:
+                # 프레임 처리 시간 통계 표시 전환
+                self.show_stats = not self.show_stats
+            elif event.key == pygame.K_f:
+                # 잔상 모드 전환
+                self.afterglow = not self.afterglow
+                self.last_fade_time = time.perf_counter()
+            elif event.key == pygame.K_r and native.available():
+                # 네이티브 래스터 / 파이썬 점 표시 전환 (성능 비교용)
+                self.use_raster = not self.use_raster
+                self.clear_data()
+            elif event.key == pygame.K_i and native.available():
+                # 회전 간 적분 전환 (다시 켜면 처음부터 누적)
+                self.integrate = not self.integrate
+                if self.integrator is not None:
+                    self.integrator.reset()
+            elif event.key == pygame.K_LEFTBRACKET:
+                # 잔상 시간 감소
+                self.afterglow_secs = max(0.2, self.afterglow_secs / 1.5)
+            elif event.key == pygame.K_RIGHTBRACKET:
+                # 잔상 시간 증가
+                self.afterglow_secs = min(60.0, self.afterglow_secs * 1.5)
             # 왼쪽 방향키 처리
             elif event.key == pygame.K_LEFT:
                 new_index = max(0, self.global_vals.current_file_index - 5)
                 if new_index != self.global_vals.current_file_index:
                     self.global_vals.current_file_index = new_index
-                    self.data_surface_original.fill((0, 0, 0))
-                    self.data_surface_filtered.fill((0, 0, 0))
+                    self.clear_data()
             # 오른쪽 방향키 처리
             elif event.key == pygame.K_RIGHT:
                 new_index = min(self.global_vals.total_files - 1, self.global_vals.current_file_index + 5)
                 if new_index != self.global_vals.current_file_index:
                     self.global_vals.current_file_index = new_index
-                    self.data_surface_original.fill((0, 0, 0))
-                    self.data_surface_filtered.fill((0, 0, 0))
+                    self.clear_data()
             elif event.key == pygame.K_7:
                 if self.concentric_circles > 1:
                     self.concentric_circles -= 1
@@ -339,46 +632,197 @@ class RadarDisplay:
             if new_index != self.global_vals.current_file_index:
                 self.global_vals.current_file_index = new_index
                 # 데이터 서피스 초기화
-                self.data_surface_original.fill((0, 0, 0))
-                self.data_surface_filtered.fill((0, 0, 0))
+                self.clear_data()
+
+        if event.type == pygame.KEYDOWN or (event.type == pygame.MOUSEMOTION and self.dragging):
+            # 서피스가 초기화되었을 수 있으므로 다음 프레임은 전체를 다시 그림
+            self.invalidate_display()
+            if self.use_raster:
+                # 확대 상태가 바뀌었으면 저장된 극좌표 영상으로 바로 다시 그림
+                self.render_rasters()
+            if self.render_client is not None:
+                self.render_client.invalidate()
+                self.sync_render_view()
+
+    def sync_render_view(self):
+        """현재 거리 눈금/확대 상태를 렌더 서버의 SetView 요청으로 전달"""
+        if self.render_client is None or self.render_client.mm is None:
+            return
+        max_range = self.current_end_range * (self.concentric_circles-self.scale) / self.concentric_circles
+        metres_per_pixel = max_range / self.scale_factor
+        width, height = self.render_client.size
+        view = (0.0, 0.0, width * metres_per_pixel, height * metres_per_pixel)
+        if view != self.render_view:
+            self.render_client.set_view(*view)
+            self.render_view = view
+
+    def update_from_render_server(self):
+        """렌더 서버 비트맵의 변경 영역만 원본 표시 서피스에 복사 (화면 스레드, surface_lock)"""
+        if not self.render_client.open():
+            return
+        end_range = self.render_client.end_range()
+        if end_range > 0 and end_range != self.current_end_range:
+            self.current_end_range = end_range
+        self.sync_render_view()
+        for rect in self.render_client.blit(self.display_surface_original):
+            if not self.full_redraw:
+                self.dirty_rects.append(rect)
+
+    def stats_area(self):
+        return pygame.Rect(self.screen_size[0] - 260, 40, 260, 100)
+
+    def draw_stats(self):
+        """화면 우측 상단에 프레임당 처리 시간과 잔상 감쇠 시간 표시"""
+        lines = [f"frame {self.frame_cpu_ms:.2f} ms",
+                 f"proc {self.process_ms:.1f} ms, coalesced {self.coalesced_count}"]
+        if self.use_raster:
+            threads = self.raster_threads if self.raster_threads > 0 else native.num_cores()
+            lines.append(f"raster {self.raster_ms:.2f} ms ({threads} threads)")
+        if self.integrate and self.integrator is not None:
+            lines.append(f"integ {self.integration} ({self.integrator.memory_bytes() / 1e6:.1f} MB)")
+        if self.afterglow:
+            lines.append(f"fade {self.fade_ms:.2f} ms ({native.simd_name()}, {self.afterglow_secs:.1f}s)")
+        for i, text in enumerate(lines):
+            text_surface = self.font_status.render(text, True, (0, 150, 0))
+            self.screen.blit(text_surface, text_surface.get_rect(topright=(self.screen_size[0] - 5, 40 + 20 * i)))
+
+    def compose_frame(self):
+        """변경된 영역만 격자 레이어 + 데이터 서피스로 다시 합성하고 그 영역만 화면에 반영"""
+        layer = self.get_grid_layer()
+        if self.full_redraw:
+            rects = [self.screen.get_rect()]
+        else:
+            rects = self.dirty_rects
+            if self.mode == 'directory':
+                rects.append(self.progress_bar_area())
+            if self.show_stats:
+                rects.append(self.stats_area())
+        if not rects:
+            return
+
+        # 같은 섹터가 여러 번 표시된 경우 중복 제거, 너무 많으면 하나로 합침
+        rects = list({tuple(rect): rect for rect in rects}.values())
+        if len(rects) > 32:
+            rects = [rects[0].unionall(rects[1:])]
+        dual = self.display_mode == 'dual'
+        for rect in rects:
+            self.screen.blit(layer, rect, rect)
+            self.screen.blit(self.display_surface_original, rect, rect, special_flags=pygame.BLEND_ADD)
+            if dual:
+                self.screen.blit(self.display_surface_filtered, rect, rect, special_flags=pygame.BLEND_ADD)
+
+        if self.mode == 'directory':
+            self.draw_progress_bar()
+        if self.show_stats:
+            self.draw_stats()
+
+        if self.headless:
+            pass
+        elif self.full_redraw:
+            pygame.display.flip()
+        else:
+            pygame.display.update(rects)
+        self.dirty_rects = []
+        self.full_redraw = False
+
+    def ingest_loop(self):
+        """수신 스레드: 큐에서 섹터를 꺼내 섹터별로 최신 데이터만 남김"""
+        data_queue = self.global_vals.data_queue
+        while not self.stop_event.is_set():
+            try:
+                sector_data, receive_time = data_queue.get(timeout=0.1)
+            except queue.Empty:
+                continue
+            except (EOFError, OSError):
+                break
+            if not sector_data:
+                continue
+            sector = int(float(sector_data[0][0]) // 30) % 12
+            with self.pending_cond:
+                if sector in self.pending:
+                    # 아직 처리되지 않은 같은 섹터는 새 데이터로 대체 (큐에 쌓지 않음)
+                    self.coalesced_count += 1
+                self.pending[sector] = (sector_data, receive_time)
+                self.pending_cond.notify()
+
+    def process_loop(self):
+        """처리 스레드: 프레임마다 시간 예산 안에서만 섹터를 처리하고 나머지 시간은 양보.
+        처리 서피스에 그린 뒤 바뀐 영역만 publish() 로 표시 서피스에 넘김"""
+        period = 1.0 / max(self.frame_rate, 1)
+        budget = self.process_budget_ms / 1000.0
+        while not self.stop_event.is_set():
+            with self.pending_cond:
+                if not self.pending:
+                    # 잔상 모드에서는 데이터가 없어도 프레임마다 감쇠
+                    self.pending_cond.wait(period if self.afterglow else 0.1)
+                if not self.pending and not self.afterglow:
+                    continue
+            start = time.perf_counter()
+            if self.afterglow:
+                with self.process_lock:
+                    self.apply_afterglow()
+                    self.publish()
+            while time.perf_counter() - start < budget:
+                with self.pending_cond:
+                    if not self.pending:
+                        break
+                    sector = next(iter(self.pending))
+                    sector_data, receive_time = self.pending.pop(sector)
+
+                with self.process_lock:
+                    self.process_sector_data(sector_data, receive_time)
+                    if self.current_sector == 0 and self.angle_idx == 11:
+                        self.sector_timestamps = {i: 0 for i in range(12)}
+                    self.publish()
+            elapsed = time.perf_counter() - start
+            self.process_ms = elapsed * 1000.0
+            if elapsed < period:
+                self.stop_event.wait(period - elapsed)
+
+    def start_workers(self):
+        self.stop_event.clear()
+        self.worker_threads = [
+            threading.Thread(target=self.ingest_loop, name='radar-ingest', daemon=True),
+            threading.Thread(target=self.process_loop, name='radar-process', daemon=True),
+        ]
+        for thread in self.worker_threads:
+            thread.start()
+
+    def stop_workers(self):
+        self.stop_event.set()
+        with self.pending_cond:
+            self.pending_cond.notify_all()
+        for thread in self.worker_threads:
+            thread.join(timeout=1.0)
+        self.worker_threads = []
 
     def run(self):
         clock = pygame.time.Clock()
+        self.start_workers()
         
         try:
             while self.global_vals.running:
+                # 화면 스레드: 이벤트 처리 후 처리 완료된 최신 영상만 합성
+                frame_start = time.thread_time()
                 for event in pygame.event.get():
                     if event.type == pygame.QUIT:
                         self.global_vals.running = False
-                    self.handle_scroll_events(event)
-                
-                while not self.global_vals.data_queue.empty():
-                    sector_data, receive_time = self.global_vals.data_queue.get()
-                    processing_delay = time.time() - receive_time
-                    
-                    # 일시 정지 상태가 아닐 때만 처리 지연 메시지 표시
-                    if processing_delay > 0.1 and not self.global_vals.is_paused:
-                        print(f"처리 지연 감지: {processing_delay:.3f}초")
-                    
-                    self.process_sector_data(sector_data,receive_time)
+                    if event.type == pygame.KEYDOWN or (event.type == pygame.MOUSEMOTION and self.dragging):
+                        # 처리 서피스를 바꾸는 입력만 처리 스레드와 직렬화
+                        with self.process_lock:
+                            self.handle_scroll_events(event)
+                            self.publish()
+                    else:
+                        self.handle_scroll_events(event)
                 
-                self.screen.fill((0, 0, 0))
-                self.draw_radar_display()
-                self.screen.blit(self.data_surface_original, (0, 0), special_flags=pygame.BLEND_ADD)
-                self.screen.blit(self.data_surface_filtered, (0, 0), special_flags=pygame.BLEND_ADD)
-                
-                if self.mode == 'directory':
-                    # while self.global_vals.total_files==0:
-                    #     time.sleep(0.01)
-                    # time.sleep(0.1)
-                    self.draw_progress_bar()
-                
-                pygame.display.flip()
-                
-                if self.current_sector == 0 and self.angle_idx == 11:
-                    self.sector_timestamps = {i: 0 for i in range(12)}
+                with self.surface_lock:
+                    if self.render_client is not None:
+                        self.update_from_render_server()
+
+                    self.compose_frame()
+                self.frame_cpu_ms = (time.thread_time() - frame_start) * 1000.0
                 
-                clock.tick(60)
+                clock.tick(self.frame_rate)
 
         except KeyboardInterrupt:
             self.cleanup()
@@ -386,6 +830,19 @@ class RadarDisplay:
             self.cleanup()
 
     def cleanup(self):
+        self.stop_workers()
+        for raster, _, _, _ in self.rasters:
+            raster.close()
+        self.rasters = []
+        if self.integrator is not None:
+            self.integrator.close()
+        if self.clutter_map is not None:
+            if self.clutter_file and not self.clutter_map.save(self.clutter_file):
+                print(f"Failed to save clutter map to '{self.clutter_file}'")
+            self.clutter_map.close()
+            self.clutter_map = None
+        if self.render_client is not None:
+            self.render_client.close()
         if self.process:
             self.process.terminate()
             self.process.wait()
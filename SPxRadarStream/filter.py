@@ -1,18 +1,241 @@
+import math
+
+import numpy as np
+
+from SPxRadarStream import native
+
+# 기존 동작(앞쪽 150 게이트 제거)과 같은 기본 필터 체인
+DEFAULT_PARAMS = 'blank:0-150'
+
+
 class RadarFilter:
-    def apply_filter(self, intensity_data):
-        """레이더 데이터에 필터를 적용하는 메서드"""
-        filtered_data = intensity_data.copy()
-        
-        # === 필터링 알고리즘 시작 ===
-        filtered_data[:150] = 0
-        
-        # 여기에 추가 필터링 알고리즘
-        # - 노이즈 제거
-        # - 신호 증폭
-        # - 특정 범위 필터링
-        # - 이동 평균 필터
-        # 등등...
-        
-        # === 필터링 알고리즘 끝 ===
-        
-        return filtered_data
\ No newline at end of file
+    """레이더 스포크 필터 체인.
+
+    파라미터 문자열은 ';' 로 구분한 단계 목록이며 순서대로 적용 (src/SPxFilterChain.h 와 동일):
+      blank:<시작>-<끝>      거리 게이트 제거
+      gain:<dB>              고정 이득
+      stc:<게이트>[,<dB>]    40log10(R) 감쇠 (STC)
+      ma:<n>                 이동 평균 (홀수, 3~63)
+      median:<n>             중앙값 (3 또는 5)
+      thresh:<레벨>          레벨 미만 제거
+      cfar:<ca|os>,<보호>,<참조>,<배율>[,<방위>][,bin]
+                             CFAR 검출 (src/SPxCfar.h 참고, 이웃 스포크는 프레임 안에서 선택)
+      mask:<파일>            SPxMaskBuilder 로 만든 정적 클러터 마스크 (방위각이 주어질 때만 적용)
+    libspxviewer.so 가 있으면 네이티브(AVX2) 필터를, 없으면 같은 연산의 numpy 구현을 사용.
+    """
+
+    def __init__(self, params=DEFAULT_PARAMS):
+        self.chain = None
+        self.stages = []
+        self.set_params(params)
+
+    def set_params(self, params):
+        stages = parse_params(params)
+        if native.available():
+            if self.chain is None:
+                self.chain = native.FilterChain(params)
+            else:
+                self.chain.set_params(params)
+        self.stages = stages
+        self.params = params
+
+    def apply_filter(self, intensity_data, azimuth=None):
+        """레이더 데이터(스포크 하나)에 필터를 적용한 사본 반환 (입력과 같은 dtype)"""
+        intensity_data = np.asarray(intensity_data)
+        azimuths = None if azimuth is None else [azimuth]
+        frame = self.apply_frame(intensity_data.reshape(1, -1), azimuths)
+        return frame[0].astype(intensity_data.dtype, copy=False)
+
+    def apply_frame(self, frame, azimuths=None, num_threads=0):
+        """2차원 극좌표 영상(스포크 x 샘플)에 필터를 적용한 uint8 사본 반환.
+        azimuths 는 스포크별 방위각(도)이며 없으면 mask 단계를 건너뜀.
+        네이티브 체인은 num_threads 스레드(0 = 코어 수)로 나눠 처리"""
+        frame = np.ascontiguousarray(np.clip(frame, 0, 255), dtype=np.uint8).copy()
+        if azimuths is not None:
+            azimuths = np.asarray(azimuths, dtype=np.float64)
+        if self.chain is not None:
+            return self.chain.apply_frame(frame, azimuths, num_threads)
+        for stage in self.stages:
+            frame = _apply_stage_numpy(stage, frame, azimuths)
+        return frame
+
+
+def parse_params(params):
+    """파라미터 문자열을 (이름, 인자들) 목록으로 변환. 잘못된 경우 ValueError"""
+    stages = []
+    for item in params.split(';'):
+        item = item.strip()
+        if not item:
+            continue
+        name, _, args = item.partition(':')
+        try:
+            if name == 'blank':
+                start, end = (int(x) for x in args.split('-'))
+                valid = 0 <= start < end
+                stage = (name, start, end)
+            elif name == 'gain':
+                db = float(args)
+                valid = abs(db) <= 48.0
+                stage = (name, db)
+            elif name == 'stc':
+                parts = args.split(',')
+                gates = int(parts[0])
+                db = float(parts[1]) if len(parts) > 1 else 40.0
+                valid = gates > 0 and 0.0 < db <= 48.0 and len(parts) <= 2
+                stage = (name, gates, db)
+            elif name == 'ma':
+                n = int(args)
+                valid = 3 <= n <= 63 and n % 2 == 1
+                stage = (name, n)
+            elif name == 'median':
+                n = int(args)
+                valid = n in (3, 5)
+                stage = (name, n)
+            elif name == 'thresh':
+                level = int(args)
+                valid = 0 <= level <= 255
+                stage = (name, level)
+            elif name == 'cfar':
+                stage, valid = _parse_cfar(args)
+            elif name == 'mask':
+                stage = _load_mask(args)
+                if stage is None:
+                    raise ValueError(f"cannot load clutter mask '{args}'")
+                valid = True
+            else:
+                raise ValueError(f"unknown filter stage '{name}'")
+        except (TypeError, ValueError) as e:
+            if 'unknown' in str(e) or 'cannot load' in str(e):
+                raise
+            valid = False
+        if not valid:
+            raise ValueError(f"invalid arguments for filter stage '{item}'")
+        stages.append(stage)
+    return stages
+
+
+def _parse_cfar(args):
+    """'<ca|os>,<보호>,<참조>,<배율>[,<방위>][,bin]' -> (('cfar', 모드, 보호, 참조, Q8 배율, 방위, bin), 유효 여부)"""
+    fields = args.split(',')
+    binary = fields[-1] == 'bin'
+    if binary:
+        fields.pop()
+    if len(fields) not in (4, 5) or fields[0] not in ('ca', 'os'):
+        return None, False
+    guard, ref = int(fields[1]), int(fields[2])
+    scale = float(fields[3])
+    azis = int(fields[4]) if len(fields) == 5 else 0
+    valid = 0 <= guard <= 32 and 1 <= ref <= 64 and 0.0 < scale <= 32.0 and 0 <= azis <= 4
+    scale_q8 = int(math.floor(scale * 256.0 + 0.5))
+    return ('cfar', fields[0], guard, ref, scale_q8, azis, binary), valid
+
+
+def _load_mask(filename):
+    """SPxClutterMask::Save 로 저장한 마스크 파일 -> ('mask', 종류, 방위 구간 수, 게이트 수, 셀), 실패하면 None"""
+    try:
+        with open(filename, 'rb') as f:
+            data = f.read()
+    except OSError:
+        return None
+    if len(data) < 20 or data[:8] != b'SPXMASK1':
+        return None
+    azis, gates, kind = (int(x) for x in np.frombuffer(data, dtype=np.int32, count=3, offset=8))
+    if azis <= 0 or gates <= 0 or kind not in (0, 1):
+        return None
+    num_cells = azis * gates
+    body = np.frombuffer(data, dtype=np.uint8, offset=20)
+    if kind == 0:
+        if body.size != (num_cells + 7) // 8:
+            return None
+        cells = np.unpackbits(body, bitorder='little')[:num_cells] * np.uint8(255)
+    else:
+        if body.size != num_cells:
+            return None
+        cells = body.copy()
+    return ('mask', 'bits' if kind == 0 else 'gain', azis, gates, cells.reshape(azis, gates))
+
+
+def _mask_numpy(stage, frame, azimuths):
+    """SPxClutterMask::Apply 와 같은 연산 (방위 구간 선택, 길이가 다르면 최근접 게이트)"""
+    _, kind, azis, gates, cells = stage
+    turns = azimuths / 360.0
+    turns = turns - np.floor(turns)
+    bins = np.minimum((turns * azis).astype(np.int64), azis - 1)
+    num_samples = frame.shape[1]
+    index = (np.arange(num_samples, dtype=np.int64) * gates) // num_samples
+    rows = cells[bins][:, index]
+    if kind == 'bits':
+        return frame & rows
+    return ((frame.astype(np.uint32) * (rows.astype(np.uint32) + 1)) >> 8).astype(np.uint8)
+
+
+def _cfar_numpy(stage, frame):
+    """SPxCfar::ApplyFrame 과 같은 정수 연산의 CFAR (이웃 스포크는 프레임 끝에서 고정)"""
+    _, mode, guard, ref, scale_q8, azis, binary = stage
+    num_spokes, num_samples = frame.shape
+    half = guard + ref
+    num_cells = 2 * ref * (2 * azis + 1)
+    gates = np.clip(np.arange(-half, num_samples + half), 0, num_samples - 1)
+    rows = [frame[np.clip(np.arange(num_spokes) + d, 0, num_spokes - 1)][:, gates]
+            for d in range(-azis, azis + 1)]
+    g = np.arange(num_samples)
+    lag_lo = 2 * guard + ref + 1
+    cut = frame.astype(np.uint64)
+    if mode == 'ca':
+        col_sum = np.sum([row.astype(np.uint64) for row in rows], axis=0)
+        prefix = np.concatenate([np.zeros((num_spokes, 1), np.uint64), np.cumsum(col_sum, axis=1)], axis=1)
+        total = (prefix[:, g + ref] - prefix[:, g]) + (prefix[:, g + lag_lo + ref] - prefix[:, g + lag_lo])
+        detect = cut * (num_cells * 256) > total * scale_q8
+    else:
+        offsets = np.concatenate([np.arange(ref), lag_lo + np.arange(ref)])
+        cells = np.concatenate([row[:, g[:, None] + offsets] for row in rows], axis=2)
+        rank = (3 * num_cells) // 4
+        level = np.partition(cells, rank, axis=2)[:, :, rank].astype(np.uint64)
+        detect = cut * 256 > level * scale_q8
+    return np.where(detect, np.uint8(255) if binary else frame, np.uint8(0)).astype(np.uint8)
+
+
+def _gain_table(stage, num_samples):
+    """SPxFilterChain::buildGains 와 같은 Q8 게이트별 이득"""
+    gains = np.empty(num_samples, dtype=np.uint32)
+    for g in range(num_samples):
+        db = stage[1]
+        if stage[0] == 'stc':
+            gates, max_db = stage[1], stage[2]
+            atten = 0.0
+            if g < gates:
+                atten = max_db if g == 0 else min(max_db, 40.0 * math.log10(gates / g))
+            db = -atten
+        gains[g] = min(65535, int(math.floor(256.0 * 10.0 ** (db / 20.0) + 0.5)))
+    return gains
+
+
+def _apply_stage_numpy(stage, frame, azimuths=None):
+    name = stage[0]
+    if name == 'blank':
+        frame[:, stage[1]:stage[2]] = 0
+    elif name in ('gain', 'stc'):
+        gains = _gain_table(stage, frame.shape[1])
+        frame = np.minimum((frame.astype(np.uint32) * gains) >> 8, 255).astype(np.uint8)
+    elif name == 'ma':
+        n = stage[1]
+        half = n // 2
+        padded = np.pad(frame, ((0, 0), (half, half)), mode='edge').astype(np.uint32)
+        sums = np.cumsum(np.pad(padded, ((0, 0), (1, 0))), axis=1)
+        window = sums[:, n:] - sums[:, :-n]
+        recip = (65536 + n - 1) // n
+        frame = ((window * recip) >> 16).astype(np.uint8)
+    elif name == 'median':
+        n = stage[1]
+        half = n // 2
+        padded = np.pad(frame, ((0, 0), (half, half)), mode='edge')
+        width = frame.shape[1]
+        windows = np.stack([padded[:, k:k + width] for k in range(n)])
+        frame = np.sort(windows, axis=0)[half]
+    elif name == 'thresh':
+        frame[frame < stage[1]] = 0
+    elif name == 'cfar':
+        frame = _cfar_numpy(stage, frame)
+    elif name == 'mask' and azimuths is not None:
+        frame = _mask_numpy(stage, frame, azimuths)
+    return frame
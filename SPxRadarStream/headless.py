@@ -0,0 +1,239 @@
+"""헤드리스 렌더링: X 창 없이 파일/디렉토리를 재생하며 오프스크린으로 프레임을 그리고 성능을 보고.
+
+빌드 서버의 렌더링 벤치마크와 골든 이미지 테스트용.
+프레임 시점은 재생 데이터의 방위각 진행으로 정하므로 (한 바퀴 = rotation_secs) 실행할 때마다 같은 프레임이 나옴.
+
+사용 예:
+    python -m SPxRadarStream.headless data/20250124-120122-0x2eea4790 --frames-dir /tmp/frames --format png
+    python -m SPxRadarStream.headless recording.cpr --every-ms 100 --display dual --view-size 2000
+"""
+import argparse
+import csv
+import glob
+import json
+import os
+import resource
+import subprocess
+import sys
+import time
+import types
+
+import numpy as np
+
+from SPxRadarStream.config import SETTINGS, Mode
+
+
+def read_directory_sectors(path):
+    """radar_data_*.txt (SPxDataConverter 출력) 를 순서대로 읽어 30도 섹터 단위로 반환.
+    행 형식은 RadarHandler.data_receiver_directory 와 동일"""
+    files = sorted(glob.glob(os.path.join(path, '*.txt'))) if os.path.isdir(path) else [path]
+    if not files:
+        raise FileNotFoundError(f"{path} 에서 *.txt 파일을 찾을 수 없습니다.")
+    buffer = []
+    current_sector = None
+    for file in files:
+        with open(file, 'r') as f:
+            for line in f:
+                values = line.strip().split()
+                if len(values) < 3:
+                    continue
+                try:
+                    azimuth = float(values[0])
+                    float(values[1])
+                except ValueError:
+                    continue
+                sector_idx = int(azimuth // 30) % 12
+                if sector_idx != current_sector and buffer:
+                    yield buffer
+                    buffer = []
+                current_sector = sector_idx
+                buffer.append(values)
+    if buffer:
+        yield buffer
+
+
+def read_stream_sectors(path):
+    """SPx 녹화 파일(*.cpr)을 ./src/SPxDataStream 으로 재생하여 섹터 단위로 반환"""
+    streamer = os.path.join(os.path.dirname(os.path.dirname(os.path.abspath(__file__))), 'src', 'SPxDataStream')
+    process = subprocess.Popen([streamer, path], stdout=subprocess.PIPE, stderr=subprocess.DEVNULL,
+                               universal_newlines=True)
+    buffer = []
+    current_sector = None
+    try:
+        for line in process.stdout:
+            if line.startswith('File finished'):
+                break
+            for row in csv.reader([line.strip()]):
+                if len(row) < 3:
+                    continue
+                try:
+                    azimuth = float(row[0])
+                except ValueError:
+                    continue
+                sector_idx = int(azimuth // 30) % 12
+                if sector_idx != current_sector and buffer:
+                    yield buffer
+                    buffer = []
+                current_sector = sector_idx
+                buffer.append(row)
+        if buffer:
+            yield buffer
+    finally:
+        process.terminate()
+        process.wait()
+
+
+def read_sectors(path):
+    if os.path.isdir(path) or path.endswith('.txt'):
+        return read_directory_sectors(path)
+    return read_stream_sectors(path)
+
+
+def percentile(values, p):
+    if not values:
+        return 0.0
+    return float(np.percentile(np.asarray(values), p))
+
+
+class HeadlessRenderer:
+    """RadarDisplay 를 헤드리스로 구동하는 재생기"""
+
+    def __init__(self, settings, source, display_mode='single', every_ms=0.0, rotation_secs=2.5,
+                 frames_dir=None, frame_format='png', max_frames=0):
+        # RadarDisplay 가 pygame 을 초기화하기 전에 설정해야 함
+        os.environ.setdefault('SDL_VIDEODRIVER', 'dummy')
+        import pygame
+        from SPxRadarStream.display import RadarDisplay
+        self.pygame = pygame
+        self.source = source
+        self.every_ms = float(every_ms)
+        self.rotation_secs = float(rotation_secs)
+        self.frames_dir = frames_dir
+        self.frame_format = frame_format
+        self.max_frames = int(max_frames)
+        if frames_dir:
+            os.makedirs(frames_dir, exist_ok=True)
+
+        self.global_vals = types.SimpleNamespace(running=True, is_paused=False,
+                                                 current_file_index=0, total_files=0)
+        config = types.SimpleNamespace(settings=settings)
+        mode = 'directory' if os.path.isdir(source) else 'file'
+        self.display = RadarDisplay(self.global_vals, config, mode=mode, file_path=source, headless=True)
+        key = {'single': pygame.K_1, 'filter_visualization': pygame.K_2, 'dual': pygame.K_3}[display_mode]
+        if display_mode != 'single':
+            self.display.handle_scroll_events(pygame.event.Event(pygame.KEYDOWN, key=key))
+        self.display.last_fade_time = 0.0
+
+        self.frame_ms = []
+        self.frame_count = 0
+
+    def render_frame(self, data_time, work_ms):
+        """지금까지 처리된 데이터로 한 프레임 합성 후 저장"""
+        start = time.perf_counter()
+        if self.display.afterglow:
+            self.display.apply_afterglow(now=data_time)
+        self.display.invalidate_display()
+        self.display.publish()
+        self.display.compose_frame()
+        self.frame_ms.append(work_ms + (time.perf_counter() - start) * 1000.0)
+        if self.frames_dir:
+            name = os.path.join(self.frames_dir, f"frame_{self.frame_count:05d}.{self.frame_format}")
+            if self.frame_format == 'png':
+                self.pygame.image.save(self.display.screen, name)
+            else:
+                with open(name, 'wb') as f:
+                    f.write(self.pygame.image.tostring(self.display.screen, 'RGBA'))
+        self.frame_count += 1
+
+    def run(self):
+        """재생을 끝까지 (또는 max_frames 까지) 진행하고 결과 요약 반환"""
+        degs_to_secs = self.rotation_secs / 360.0
+        data_time = 0.0
+        next_frame_time = self.every_ms / 1000.0
+        last_azimuth = None
+        last_sector = None
+        work_ms = 0.0
+        sector_count = 0
+        wall_start = time.perf_counter()
+
+        for sector_data in read_sectors(self.source):
+            azimuth = float(sector_data[-1][0])
+            sector = int(float(sector_data[0][0]) // 30) % 12
+            rotation_done = last_sector is not None and sector < last_sector
+            if last_azimuth is not None:
+                data_time += ((azimuth - last_azimuth) % 360.0) * degs_to_secs
+            last_azimuth = azimuth
+
+            if self.every_ms <= 0 and rotation_done:
+                # 한 바퀴가 끝날 때마다 프레임
+                self.render_frame(data_time, work_ms)
+                work_ms = 0.0
+            start = time.perf_counter()
+            self.display.process_sector_data(sector_data, data_time + 1.0)
+            work_ms += (time.perf_counter() - start) * 1000.0
+            sector_count += 1
+            last_sector = sector
+
+            while self.every_ms > 0 and data_time >= next_frame_time:
+                self.render_frame(data_time, work_ms)
+                work_ms = 0.0
+                next_frame_time += self.every_ms / 1000.0
+            if self.max_frames and self.frame_count >= self.max_frames:
+                break
+        if self.every_ms <= 0 and work_ms > 0 and not (self.max_frames and self.frame_count >= self.max_frames):
+            self.render_frame(data_time, work_ms)
+
+        wall_secs = time.perf_counter() - wall_start
+        self.display.cleanup()
+        return {
+            'frames': self.frame_count,
+            'sectors': sector_count,
+            'wall_secs': round(wall_secs, 3),
+            'fps': round(self.frame_count / wall_secs, 2) if wall_secs > 0 else 0.0,
+            'frame_ms_p50': round(percentile(self.frame_ms, 50), 3),
+            'frame_ms_p90': round(percentile(self.frame_ms, 90), 3),
+            'frame_ms_p99': round(percentile(self.frame_ms, 99), 3),
+            'frame_ms_max': round(max(self.frame_ms), 3) if self.frame_ms else 0.0,
+            # Linux 의 ru_maxrss 단위는 KB
+            'peak_rss_mb': round(resource.getrusage(resource.RUSAGE_SELF).ru_maxrss / 1024.0, 1),
+        }
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description='헤드리스 레이더 렌더링 벤치마크')
+    parser.add_argument('source', help='radar_data_*.txt 디렉토리/파일 또는 SPx 녹화 파일(*.cpr)')
+    parser.add_argument('--display', choices=['single', 'filter_visualization', 'dual'], default='single')
+    parser.add_argument('--view-size', type=int, default=600, help='레이더 한 개의 크기(픽셀)')
+    parser.add_argument('--every-ms', type=float, default=0.0,
+                        help='데이터 시간 N ms 마다 프레임 (0 = 한 바퀴마다)')
+    parser.add_argument('--rotation-secs', type=float, default=2.5, help='데이터 시간 계산용 한 바퀴 시간')
+    parser.add_argument('--frames-dir', help='프레임 저장 디렉토리 (없으면 저장 안 함)')
+    parser.add_argument('--format', choices=['png', 'rgba'], default='png', help='프레임 파일 형식')
+    parser.add_argument('--max-frames', type=int, default=0)
+    parser.add_argument('--no-raster', action='store_true', help='네이티브 래스터 대신 파이썬 점 표시 사용')
+    parser.add_argument('--afterglow', action='store_true')
+    parser.add_argument('--integrate', metavar='ARGS', help="회전 간 적분, 예: 'mean,4' 또는 'mofn,5,3,40'")
+    parser.add_argument('--clutter-map', metavar='ARGS', default='', help="적응형 클러터 맵, 예: 'sub,4,10'")
+    parser.add_argument('--clutter-map-file', metavar='FILE', default='', help='클러터 맵을 읽고 저장할 파일')
+    parser.add_argument('--json', help='결과 요약을 JSON 파일로 저장')
+    args = parser.parse_args(argv)
+
+    settings = SETTINGS(mode=Mode.DIRECTORY if os.path.isdir(args.source) else Mode.FILE,
+                        view_size=args.view_size, native_raster=not args.no_raster,
+                        afterglow=args.afterglow, integrate=bool(args.integrate),
+                        integration=args.integrate or 'mean,4', clutter_map=args.clutter_map,
+                        clutter_map_file=args.clutter_map_file)
+    renderer = HeadlessRenderer(settings, args.source, display_mode=args.display, every_ms=args.every_ms,
+                                rotation_secs=args.rotation_secs, frames_dir=args.frames_dir,
+                                frame_format=args.format, max_frames=args.max_frames)
+    result = renderer.run()
+    for key, value in result.items():
+        print(f"{key:>14}: {value}")
+    if args.json:
+        with open(args.json, 'w') as f:
+            json.dump(result, f, indent=2)
+    return 0 if result['frames'] > 0 else 1
+
+
+if __name__ == '__main__':
+    sys.exit(main())
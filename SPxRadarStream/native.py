@@ -0,0 +1,407 @@
+import ctypes
+import os
+
+import numpy as np
+
+# src/SPxViewerLib.h 의 C 인터페이스 (변경 시 함께 수정)
+_LIB_PATH = os.path.join(os.path.dirname(os.path.dirname(os.path.abspath(__file__))), 'src', 'libspxviewer.so')
+
+_i32_p = ctypes.POINTER(ctypes.c_int32)
+_u32_p = ctypes.POINTER(ctypes.c_uint32)
+
+
+def _load():
+    """libspxviewer.so 로드. 없으면 None (numpy 대체 경로 사용)"""
+    try:
+        lib = ctypes.CDLL(_LIB_PATH)
+    except OSError:
+        return None
+    lib.SPxViewerGetSimdName.restype = ctypes.c_char_p
+    lib.SPxViewerGetSimdName.argtypes = []
+    lib.SPxViewerFade32.restype = None
+    lib.SPxViewerFade32.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.c_int, ctypes.c_int, ctypes.c_int]
+    lib.SPxViewerPlotMax32.restype = None
+    lib.SPxViewerPlotMax32.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.c_int, ctypes.c_int,
+                                       _i32_p, _i32_p, _u32_p, ctypes.c_int]
+    return lib
+
+
+lib = _load()
+
+
+def available():
+    return lib is not None
+
+
+def simd_name():
+    if lib is None:
+        return 'numpy'
+    return lib.SPxViewerGetSimdName().decode()
+
+
+def fade_surface(surface, factor):
+    """32비트 서피스의 모든 픽셀을 factor/256 배로 감쇠 (factor: 0~256)"""
+    if factor >= 256:
+        return
+    if lib is not None:
+        surface.lock()
+        try:
+            lib.SPxViewerFade32(surface._pixels_address, surface.get_width(), surface.get_height(),
+                                surface.get_pitch(), int(factor))
+        finally:
+            surface.unlock()
+        return
+    import pygame
+    pixels = pygame.surfarray.pixels3d(surface)
+    pixels[...] = (pixels.astype(np.uint16) * int(factor)) >> 8
+    del pixels
+
+
+def plot_max(surface, xs, ys, colours):
+    """(xs, ys) 위치에 색상을 채널별 최댓값으로 합성 (잔상 모드에서 새 스포크 표시)"""
+    if len(xs) == 0:
+        return
+    if lib is not None:
+        xs = np.ascontiguousarray(xs, dtype=np.int32)
+        ys = np.ascontiguousarray(ys, dtype=np.int32)
+        colours = np.ascontiguousarray(colours, dtype=np.uint32)
+        surface.lock()
+        try:
+            lib.SPxViewerPlotMax32(surface._pixels_address, surface.get_width(), surface.get_height(),
+                                   surface.get_pitch(),
+                                   xs.ctypes.data_as(_i32_p), ys.ctypes.data_as(_i32_p),
+                                   colours.ctypes.data_as(_u32_p), len(xs))
+        finally:
+            surface.unlock()
+        return
+    import pygame
+    pixel_array = pygame.surfarray.pixels2d(surface)
+    current = pixel_array[xs, ys].astype(np.uint32)
+    colours = np.asarray(colours, dtype=np.uint32)
+    merged = np.zeros_like(current)
+    for shift in (0, 8, 16):
+        channel = np.maximum((current >> shift) & 0xFF, (colours >> shift) & 0xFF)
+        merged |= channel << shift
+    pixel_array[xs, ys] = merged
+    del pixel_array
+
+
+# SPxViewerRasterRender 플래그 (src/SPxViewerRaster.h 와 동일)
+RASTER_MAX = 0x01       # 기존 픽셀과 채널별 최댓값 합성
+RASTER_CONSUME = 0x02   # 그린 뒤 갱신된 스포크를 0 으로 (잔상 모드)
+
+
+def _bind_raster(lib):
+    if lib is None:
+        return
+    _c_int_p = ctypes.POINTER(ctypes.c_int)
+    lib.SPxViewerRasterCreate.restype = ctypes.c_void_p
+    lib.SPxViewerRasterCreate.argtypes = [ctypes.c_int] * 5
+    lib.SPxViewerRasterDestroy.restype = None
+    lib.SPxViewerRasterDestroy.argtypes = [ctypes.c_void_p]
+    lib.SPxViewerRasterSetGeometry.restype = None
+    lib.SPxViewerRasterSetGeometry.argtypes = [ctypes.c_void_p] + [ctypes.c_double] * 4
+    lib.SPxViewerRasterSetPalette.restype = None
+    lib.SPxViewerRasterSetPalette.argtypes = [ctypes.c_void_p, _u32_p]
+    lib.SPxViewerRasterUpdateSpoke.restype = None
+    lib.SPxViewerRasterUpdateSpoke.argtypes = [ctypes.c_void_p, ctypes.c_double,
+                                               ctypes.POINTER(ctypes.c_uint8), ctypes.c_int]
+    lib.SPxViewerRasterClear.restype = None
+    lib.SPxViewerRasterClear.argtypes = [ctypes.c_void_p]
+    lib.SPxViewerRasterInvalidate.restype = None
+    lib.SPxViewerRasterInvalidate.argtypes = [ctypes.c_void_p]
+    lib.SPxViewerRasterRender.restype = ctypes.c_int
+    lib.SPxViewerRasterRender.argtypes = [ctypes.c_void_p, ctypes.c_void_p, ctypes.c_int,
+                                          ctypes.c_int, ctypes.c_int]
+    lib.SPxViewerRasterGetDirtyBounds.restype = None
+    lib.SPxViewerRasterGetDirtyBounds.argtypes = [ctypes.c_void_p] + [_c_int_p] * 4
+    lib.SPxViewerGetNumCores.restype = ctypes.c_int
+    lib.SPxViewerGetNumCores.argtypes = []
+
+
+_bind_raster(lib)
+
+
+def num_cores():
+    if lib is None:
+        return 1
+    return lib.SPxViewerGetNumCores()
+
+
+class Raster:
+    """타일 단위 멀티스레드 스캔 변환기 (SPxViewerRaster).
+
+    스포크는 극좌표 영상에 저장되고, render() 가 변경된 타일만 여러 코어에서
+    pygame 서피스 버퍼(rect 영역)에 직접 씀. 라이브러리가 없으면 생성 시 RuntimeError.
+    """
+
+    def __init__(self, width, height, num_azis=4096, num_gates=1024, tile_size=64):
+        if lib is None:
+            raise RuntimeError('libspxviewer.so 를 찾을 수 없음')
+        self.size = (int(width), int(height))
+        self.num_gates = int(num_gates)
+        self.handle = lib.SPxViewerRasterCreate(self.size[0], self.size[1], int(num_azis),
+                                                self.num_gates, int(tile_size))
+        if not self.handle:
+            raise RuntimeError('래스터 생성 실패')
+        self.geometry = None
+
+    def set_geometry(self, centre, radius_pixels, gates_in_radius):
+        """centre 는 래스터 영역 기준 좌표. 값이 바뀐 경우에만 조회 테이블 재계산"""
+        geometry = (float(centre[0]), float(centre[1]), float(radius_pixels), float(gates_in_radius))
+        if geometry != self.geometry:
+            lib.SPxViewerRasterSetGeometry(self.handle, *geometry)
+            self.geometry = geometry
+
+    def set_colour(self, colour):
+        """세기 0~255 를 (r, g, b) 색상의 밝기로 표시하는 팔레트 설정"""
+        levels = np.arange(256, dtype=np.uint32)
+        palette = np.zeros(256, dtype=np.uint32)
+        for channel, shift in zip(colour, (16, 8, 0)):
+            palette |= ((levels * int(channel)) // 255) << shift
+        lib.SPxViewerRasterSetPalette(self.handle, palette.ctypes.data_as(_u32_p))
+
+    def update_spoke(self, azimuth, samples):
+        samples = np.ascontiguousarray(np.clip(samples, 0, 255), dtype=np.uint8)
+        lib.SPxViewerRasterUpdateSpoke(self.handle, float(azimuth),
+                                       samples.ctypes.data_as(ctypes.POINTER(ctypes.c_uint8)), len(samples))
+
+    def clear(self):
+        lib.SPxViewerRasterClear(self.handle)
+
+    def invalidate(self):
+        lib.SPxViewerRasterInvalidate(self.handle)
+
+    def render(self, surface, rect, num_threads=0, flags=0):
+        """변경된 타일을 surface 의 rect 영역에 그리고 갱신된 화면 영역(Rect) 반환 (없으면 None)"""
+        import pygame
+        rect = pygame.Rect(rect)
+        if rect.size != self.size or not surface.get_rect().contains(rect) or surface.get_bytesize() != 4:
+            raise ValueError('래스터 영역이 서피스를 벗어났거나 32비트 서피스가 아님')
+        pitch = surface.get_pitch()
+        surface.lock()
+        try:
+            address = surface._pixels_address + rect.y * pitch + rect.x * 4
+            tiles = lib.SPxViewerRasterRender(self.handle, address, pitch, int(num_threads), int(flags))
+        finally:
+            surface.unlock()
+        if tiles == 0:
+            return None
+        x, y, w, h = ctypes.c_int(), ctypes.c_int(), ctypes.c_int(), ctypes.c_int()
+        lib.SPxViewerRasterGetDirtyBounds(self.handle, ctypes.byref(x), ctypes.byref(y),
+                                          ctypes.byref(w), ctypes.byref(h))
+        return pygame.Rect(rect.x + x.value, rect.y + y.value, w.value, h.value)
+
+    def close(self):
+        if self.handle:
+            lib.SPxViewerRasterDestroy(self.handle)
+            self.handle = None
+
+    def __del__(self):
+        self.close()
+
+
+def _bind_filter(lib):
+    if lib is None:
+        return
+    lib.SPxViewerFilterCreate.restype = ctypes.c_void_p
+    lib.SPxViewerFilterCreate.argtypes = []
+    lib.SPxViewerFilterDestroy.restype = None
+    lib.SPxViewerFilterDestroy.argtypes = [ctypes.c_void_p]
+    lib.SPxViewerFilterSetParams.restype = ctypes.c_int
+    lib.SPxViewerFilterSetParams.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
+    lib.SPxViewerFilterGetError.restype = ctypes.c_char_p
+    lib.SPxViewerFilterGetError.argtypes = [ctypes.c_void_p]
+    lib.SPxViewerFilterApplyFrame.restype = None
+    lib.SPxViewerFilterApplyFrame.argtypes = [ctypes.c_void_p, ctypes.c_void_p, ctypes.c_int,
+                                              ctypes.c_int, ctypes.c_int, ctypes.POINTER(ctypes.c_double),
+                                              ctypes.c_int]
+    lib.SPxViewerFilterGetSimdName.restype = ctypes.c_char_p
+    lib.SPxViewerFilterGetSimdName.argtypes = []
+
+
+_bind_filter(lib)
+
+
+class FilterChain:
+    """스포크 필터 체인 (SPxFilterChain). 파라미터 문자열 형식은 src/SPxFilterChain.h 참고"""
+
+    def __init__(self, params=''):
+        if lib is None:
+            raise RuntimeError('libspxviewer.so 를 찾을 수 없음')
+        self.handle = lib.SPxViewerFilterCreate()
+        if not self.handle:
+            raise RuntimeError('필터 체인 생성 실패')
+        self.set_params(params)
+
+    def set_params(self, params):
+        if lib.SPxViewerFilterSetParams(self.handle, params.encode()) != 0:
+            raise ValueError(lib.SPxViewerFilterGetError(self.handle).decode())
+        self.params = params
+
+    def apply_frame(self, frame, azimuths=None, num_threads=0):
+        """2차원 uint8 극좌표 영상(스포크 x 샘플)을 제자리에서 필터링.
+        azimuths(스포크별 방위각, 도)가 없으면 mask 단계는 건너뜀.
+        방위 구간으로 나눠 num_threads 스레드(0 = 코어 수)에서 처리하며 결과는 스레드 수와 무관"""
+        if frame.dtype != np.uint8 or frame.ndim != 2 or frame.strides[1] != 1:
+            raise ValueError('행 단위로 연속된 2차원 uint8 배열이어야 함')
+        if frame.size == 0:
+            return frame
+        az_ptr = None
+        if azimuths is not None:
+            azimuths = np.ascontiguousarray(azimuths, dtype=np.float64)
+            if azimuths.shape != (frame.shape[0],):
+                raise ValueError('방위각 수가 스포크 수와 같아야 함')
+            az_ptr = azimuths.ctypes.data_as(ctypes.POINTER(ctypes.c_double))
+        lib.SPxViewerFilterApplyFrame(self.handle, frame.ctypes.data, frame.shape[0], frame.shape[1],
+                                      frame.strides[0], az_ptr, int(num_threads))
+        return frame
+
+    @staticmethod
+    def simd_name():
+        return lib.SPxViewerFilterGetSimdName().decode()
+
+    def close(self):
+        if self.handle:
+            lib.SPxViewerFilterDestroy(self.handle)
+            self.handle = None
+
+    def __del__(self):
+        self.close()
+
+
+def _bind_integrator(lib):
+    if lib is None:
+        return
+    lib.SPxViewerIntegratorCreate.restype = ctypes.c_void_p
+    lib.SPxViewerIntegratorCreate.argtypes = [ctypes.c_int, ctypes.c_int, ctypes.c_char_p]
+    lib.SPxViewerIntegratorDestroy.restype = None
+    lib.SPxViewerIntegratorDestroy.argtypes = [ctypes.c_void_p]
+    lib.SPxViewerIntegratorUpdateSpokes.restype = None
+    lib.SPxViewerIntegratorUpdateSpokes.argtypes = [ctypes.c_void_p, ctypes.POINTER(ctypes.c_double),
+                                                    ctypes.c_void_p, ctypes.c_int, ctypes.c_int, ctypes.c_int,
+                                                    ctypes.c_void_p, ctypes.c_int]
+    lib.SPxViewerIntegratorGetFrame.restype = None
+    lib.SPxViewerIntegratorGetFrame.argtypes = [ctypes.c_void_p, ctypes.c_void_p]
+    lib.SPxViewerIntegratorReset.restype = None
+    lib.SPxViewerIntegratorReset.argtypes = [ctypes.c_void_p]
+    lib.SPxViewerIntegratorGetRotationCount.restype = ctypes.c_uint
+    lib.SPxViewerIntegratorGetRotationCount.argtypes = [ctypes.c_void_p]
+    lib.SPxViewerIntegratorGetMemoryBytes.restype = ctypes.c_size_t
+    lib.SPxViewerIntegratorGetMemoryBytes.argtypes = [ctypes.c_void_p]
+
+
+_bind_integrator(lib)
+
+
+class ScanIntegrator:
+    """회전 간 적분 (SPxScanIntegrator). 인자 형식은 src/SPxScanIntegrator.h 참고 (예: 'mean,4', 'mofn,5,3,40')"""
+
+    def __init__(self, args, num_gates, num_azis=4096):
+        if lib is None:
+            raise RuntimeError('libspxviewer.so 를 찾을 수 없음')
+        self.args = args
+        self.num_azis = int(num_azis)
+        self.num_gates = int(num_gates)
+        self.handle = lib.SPxViewerIntegratorCreate(self.num_azis, self.num_gates, args.encode())
+        if not self.handle:
+            raise ValueError(f"invalid integration '{args}'")
+
+    def update(self, azimuths, frame):
+        """스포크들(uint8 2차원, 행 = 스포크)을 더하고 각 스포크 방위의 적분 결과 (스포크 수 x num_gates) 반환"""
+        frame = np.ascontiguousarray(frame, dtype=np.uint8)
+        azimuths = np.ascontiguousarray(azimuths, dtype=np.float64)
+        out = np.zeros((frame.shape[0], self.num_gates), dtype=np.uint8)
+        if frame.size:
+            lib.SPxViewerIntegratorUpdateSpokes(self.handle, azimuths.ctypes.data_as(ctypes.POINTER(ctypes.c_double)),
+                                                frame.ctypes.data, frame.shape[0], frame.shape[1],
+                                                frame.strides[0], out.ctypes.data, out.strides[0])
+        return out
+
+    def frame(self):
+        """적분된 전체 극좌표 영상 (num_azis x num_gates, 0 번 방위 = 북쪽)"""
+        out = np.empty((self.num_azis, self.num_gates), dtype=np.uint8)
+        lib.SPxViewerIntegratorGetFrame(self.handle, out.ctypes.data)
+        return out
+
+    def reset(self):
+        lib.SPxViewerIntegratorReset(self.handle)
+
+    def rotation_count(self):
+        return lib.SPxViewerIntegratorGetRotationCount(self.handle)
+
+    def memory_bytes(self):
+        return lib.SPxViewerIntegratorGetMemoryBytes(self.handle)
+
+    def close(self):
+        if self.handle:
+            lib.SPxViewerIntegratorDestroy(self.handle)
+            self.handle = None
+
+    def __del__(self):
+        self.close()
+
+
+def _bind_clutter(lib):
+    if lib is None:
+        return
+    lib.SPxViewerClutterCreate.restype = ctypes.c_void_p
+    lib.SPxViewerClutterCreate.argtypes = [ctypes.c_int, ctypes.c_int, ctypes.c_char_p]
+    lib.SPxViewerClutterDestroy.restype = None
+    lib.SPxViewerClutterDestroy.argtypes = [ctypes.c_void_p]
+    lib.SPxViewerClutterApplySpokes.restype = None
+    lib.SPxViewerClutterApplySpokes.argtypes = [ctypes.c_void_p, ctypes.POINTER(ctypes.c_double),
+                                                ctypes.c_void_p, ctypes.c_int, ctypes.c_int, ctypes.c_int,
+                                                ctypes.c_int]
+    lib.SPxViewerClutterSave.restype = ctypes.c_int
+    lib.SPxViewerClutterSave.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
+    lib.SPxViewerClutterLoad.restype = ctypes.c_int
+    lib.SPxViewerClutterLoad.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
+    lib.SPxViewerClutterReset.restype = None
+    lib.SPxViewerClutterReset.argtypes = [ctypes.c_void_p]
+
+
+_bind_clutter(lib)
+
+
+class ClutterMap:
+    """적응형 클러터 맵 (SPxClutterMap). 인자 형식은 src/SPxClutterMap.h 참고 (예: 'sub,4,10', 'thresh,5,20')"""
+
+    def __init__(self, args, num_gates, num_azis=4096):
+        if lib is None:
+            raise RuntimeError('libspxviewer.so 를 찾을 수 없음')
+        self.args = args
+        self.handle = lib.SPxViewerClutterCreate(int(num_azis), int(num_gates), args.encode())
+        if not self.handle:
+            raise ValueError(f"invalid clutter map '{args}'")
+
+    def apply(self, azimuths, frame, num_threads=0):
+        """스포크들(uint8 2차원, 행 = 스포크)의 클러터를 제자리에서 제거하고 배경을 갱신
+        (방위 빈 단위로 num_threads 스레드에서 처리, 0 = 코어 수)"""
+        if frame.dtype != np.uint8 or frame.ndim != 2 or frame.strides[1] != 1:
+            raise ValueError('행 단위로 연속된 2차원 uint8 배열이어야 함')
+        azimuths = np.ascontiguousarray(azimuths, dtype=np.float64)
+        if frame.size:
+            lib.SPxViewerClutterApplySpokes(self.handle, azimuths.ctypes.data_as(ctypes.POINTER(ctypes.c_double)),
+                                            frame.ctypes.data, frame.shape[0], frame.shape[1], frame.strides[0],
+                                            int(num_threads))
+        return frame
+
+    def save(self, filename):
+        """맵을 파일에 저장, 성공하면 True"""
+        return lib.SPxViewerClutterSave(self.handle, os.fsencode(filename)) == 0
+
+    def load(self, filename):
+        """파일에서 맵을 읽음 (격자 크기도 파일을 따름), 성공하면 True"""
+        return lib.SPxViewerClutterLoad(self.handle, os.fsencode(filename)) == 0
+
+    def reset(self):
+        lib.SPxViewerClutterReset(self.handle)
+
+    def close(self):
+        if self.handle:
+            lib.SPxViewerClutterDestroy(self.handle)
+            self.handle = None
+
+    def __del__(self):
+        self.close()
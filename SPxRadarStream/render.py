@@ -0,0 +1,137 @@
+import mmap
+import os
+import struct
+
+import numpy as np
+import pygame
+
+# src/SPxRenderShm.h 와 같은 레이아웃 (변경 시 함께 수정)
+SHM_MAGIC = 0x52585053
+SHM_VERSION = 1
+SHM_DEFAULT_NAME = '/spxrender'
+SHM_NUM_RECTS = 64
+
+_OFF_SERVER_PID = 24
+_OFF_RECT_SEQ = 28
+_OFF_END_RANGE = 32
+_OFF_VIEW_SEQ = 40
+_OFF_VIEW = 44
+_OFF_RECTS = 64
+_RECT_FMT = '<4H'
+
+
+class RenderClient:
+    """SPxRenderServer 가 공유 메모리에 그린 비트맵을 pygame 으로 가져오는 클래스"""
+
+    def __init__(self, shm_name=SHM_DEFAULT_NAME):
+        self.shm_name = shm_name
+        self.mm = None
+        self.bitmap = None
+        self.size = (0, 0)
+        self.last_rect_seq = 0
+        self.view_seq = 0
+
+    def open(self):
+        """서버가 세그먼트를 만들었으면 매핑. 성공 시 True"""
+        if self.mm is not None:
+            return True
+        path = os.path.join('/dev/shm', self.shm_name.lstrip('/'))
+        try:
+            fd = os.open(path, os.O_RDWR)
+        except OSError:
+            return False
+        try:
+            size = os.fstat(fd).st_size
+            if size < 4096:
+                return False
+            mm = mmap.mmap(fd, size, mmap.MAP_SHARED, mmap.PROT_READ | mmap.PROT_WRITE)
+        finally:
+            os.close(fd)
+
+        magic, version, header_size, width, height, stride = struct.unpack_from('<6I', mm, 0)
+        if magic != SHM_MAGIC or version != SHM_VERSION or stride != width * 4:
+            mm.close()
+            return False
+
+        self.mm = mm
+        self.size = (width, height)
+        # 비트맵 메모리를 그대로 참조하는 배열 (복사 없음), 픽셀은 0xAARRGGBB
+        self.bitmap = np.frombuffer(mm, dtype=np.uint32, count=width * height,
+                                    offset=header_size).reshape(height, width)
+        # 처음 한 번은 전체를 그리도록 함
+        self.last_rect_seq = struct.unpack_from('<I', mm, _OFF_RECT_SEQ)[0]
+        self.invalidate()
+        self.view_seq = struct.unpack_from('<I', mm, _OFF_VIEW_SEQ)[0]
+        return True
+
+    def is_alive(self):
+        return self.mm is not None and struct.unpack_from('<I', self.mm, _OFF_SERVER_PID)[0] != 0
+
+    def end_range(self):
+        if self.mm is None:
+            return 0.0
+        return struct.unpack_from('<f', self.mm, _OFF_END_RANGE)[0]
+
+    def dirty_rects(self):
+        """마지막 호출 이후 변경된 영역 목록. 링을 놓쳤으면 전체 영역 하나"""
+        if self.mm is None:
+            return []
+        seq = struct.unpack_from('<I', self.mm, _OFF_RECT_SEQ)[0]
+        pending = (seq - self.last_rect_seq) & 0xFFFFFFFF
+        self.last_rect_seq = seq
+        if pending == 0:
+            return []
+        if pending > SHM_NUM_RECTS:
+            return [pygame.Rect(0, 0, *self.size)]
+        rects = []
+        for i in range(seq - pending, seq):
+            offset = _OFF_RECTS + (i % SHM_NUM_RECTS) * 8
+            x, y, w, h = struct.unpack_from(_RECT_FMT, self.mm, offset)
+            rects.append(pygame.Rect(x, y, w, h))
+        return rects
+
+    def invalidate(self):
+        """다음 blit 에서 전체 비트맵을 복사하도록 함"""
+        self.last_rect_seq = (self.last_rect_seq - SHM_NUM_RECTS - 1) & 0xFFFFFFFF
+
+    def blit(self, surface, dest=(0, 0)):
+        """변경된 영역만 32비트 surface 에 복사하고 surface 좌표의 영역 목록을 반환
+
+        서버 비트맵의 알파 바이트는 무시하고 RGB 만 복사한다.
+        """
+        rects = self.dirty_rects()
+        if not rects:
+            return []
+        bounds = surface.get_rect()
+        pixels = pygame.surfarray.pixels2d(surface)
+        updated = []
+        for rect in rects:
+            target = rect.move(dest).clip(bounds)
+            if target.width <= 0 or target.height <= 0:
+                continue
+            sx = target.x - dest[0]
+            sy = target.y - dest[1]
+            src = self.bitmap[sy:sy + target.height, sx:sx + target.width]
+            np.bitwise_and(src.T, 0x00FFFFFF,
+                           out=pixels[target.left:target.right, target.top:target.bottom])
+            updated.append(target)
+        del pixels
+        return updated
+
+    def set_view(self, view_x, view_y, view_w, view_h):
+        """SPxScSourceLocal::SetView() 로 전달될 뷰 요청 (단위: m)"""
+        if self.mm is None:
+            return
+        struct.pack_into('<4f', self.mm, _OFF_VIEW, view_x, view_y, view_w, view_h)
+        self.view_seq = (self.view_seq + 1) & 0xFFFFFFFF
+        struct.pack_into('<I', self.mm, _OFF_VIEW_SEQ, self.view_seq)
+
+    def close(self):
+        self.bitmap = None
+        if self.mm is not None:
+            try:
+                self.mm.close()
+            except BufferError:
+                # 비트맵 배열이 아직 참조 중이면 GC 에 맡김
+                pass
+            self.mm = None
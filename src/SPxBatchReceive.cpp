@@ -0,0 +1,1215 @@
+/*********************************************************************
+*
+* File: SPxBatchReceive.cpp
+*
+* Purpose:
+*	Native batched UDP receiver for radar video (see
+*	SPxBatchReceive.h).
+*
+**********************************************************************/
+
+/* Standard headers. */
+#include <string.h>
+#include <zlib.h>
+#include <chrono>
+#ifndef _WIN32
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#endif
+
+/* SPx headers, for the packet layouts only. */
+#include "SPxLibData/SPxPackets.h"
+#include "SPxLibNet/SPxNetDist.h"
+#include "SPxLibSc/SPxScNet.h"
+
+/* Our own header. */
+#include "SPxBatchReceive.h"
+
+/*
+ * Constants.
+ */
+/* Largest datagram, spoke (65535 16-bit samples) and chunked message. */
+#define	MAX_DATAGRAM_BYTES	65536
+#define	MAX_SPOKE_BYTES		(65535 * 2)
+#define	MAX_MESSAGE_BYTES	(MAX_SPOKE_BYTES + 4096)
+
+/* Fixed header sizes on the wire. */
+#define	CHUNK_HEADER_BYTES	24
+#define	RETURN_HEADER_BYTES	48
+#define	PACKETB_HEADER_BYTES	16
+#define	RADAR_CONFIG_BYTES	12
+#define	RADAR_RETURN_BYTES	16
+
+/* Cat-240 message types (I240/000). */
+#define	CAT240_MSG_SUMMARY	1
+#define	CAT240_MSG_VIDEO	2
+
+/* Receive timeout, so the thread sees the stop flag. */
+#define	RECV_TIMEOUT_MSECS	100
+
+/*
+ * Private functions.
+ */
+static unsigned int read16(const unsigned char *p, int big);
+static UINT32 read32(const unsigned char *p, int big);
+static REAL32 readFloat(const unsigned char *p, int big);
+static int64_t nowUsecs(void);
+
+
+/*********************************************************************
+*
+*	Public functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* SPxBatchReceive::SPxBatchReceive
+*	Constructor.
+*
+* Params:
+*	fn			Data function, called per spoke,
+*	userArg			Its user arg.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+SPxBatchReceive::SPxBatchReceive(SPxBatchReceiveFn_t fn, void *userArg)
+    : m_sock(-1),
+      m_cat240(0),
+      m_batch(1),
+      m_cpu(-1),
+      m_stop(0),
+      m_arrivalUsecs(0),
+      m_fn(fn),
+      m_userArg(userArg),
+      m_slots(1),
+      m_numReady(0),
+      m_msgSource(0),
+      m_msgSequence(0),
+      m_msgChunks(0),
+      m_msgReceived(0),
+      m_channels(256)
+{
+    m_slots[0].data.resize(MAX_SPOKE_BYTES);
+    memset(&m_channels[0], 0, m_channels.size() * sizeof(Channel));
+    memset(&m_counts, 0, sizeof(m_counts));
+    memset(&m_stats, 0, sizeof(m_stats));
+} /* SPxBatchReceive::SPxBatchReceive() */
+
+
+/*====================================================================
+*
+* SPxBatchReceive::~SPxBatchReceive
+*	Destructor, stopping the receive thread and closing the socket.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+SPxBatchReceive::~SPxBatchReceive()
+{
+    m_stop = 1;
+    if( m_thread.joinable() )
+    {
+	m_thread.join();
+    }
+#ifndef _WIN32
+    if( m_sock >= 0 )
+    {
+	close(m_sock);
+    }
+#endif
+} /* SPxBatchReceive::~SPxBatchReceive() */
+
+
+/*====================================================================
+*
+* SPxBatchReceive::Create
+*	Open the socket and start receiving.
+*
+* Params:
+*	addr			Address (multicast group or local), NULL
+*				for the default,
+*	port			Port, 0 for the default,
+*	ifAddr			Interface for multicast, NULL for any,
+*	cat240			Non-zero for ASTERIX Cat-240, else SPx,
+*	batch			Most datagrams per system call,
+*	rcvBufBytes		Socket receive buffer size to ask for.
+*
+* Returns:
+*	Zero on success, -1 on error.
+*
+* Notes
+*	The receive buffer is forced past net.core.rmem_max where the
+*	process is allowed to (CAP_NET_ADMIN), otherwise it is capped
+*	by the kernel; the size granted is in the statistics.
+*
+*===================================================================*/
+int SPxBatchReceive::Create(const char *addr, int port, const char *ifAddr,
+			    int cat240, unsigned int batch,
+			    unsigned int rcvBufBytes)
+{
+#ifdef _WIN32
+    m_error = "native receive is not supported on Windows";
+    return(-1);
+#else
+    if( m_sock >= 0 )
+    {
+	m_error = "receiver already created";
+	return(-1);
+    }
+    if( (batch < 1) || (batch > SPX_BATCH_RECEIVE_MAX_BATCH) )
+    {
+	m_error = "invalid receive batch size";
+	return(-1);
+    }
+    if( addr == NULL )
+    {
+	addr = cat240 ? SPX_SCNET_DEFAULT_ADDR_ASTERIX : SPX_SCNET_DEFAULT_ADDR_RADAR;
+    }
+    if( port == 0 )
+    {
+	port = cat240 ? SPX_SCNET_DEFAULT_PORT_ASTERIX : SPX_SCNET_DEFAULT_PORT_RADAR;
+    }
+
+    struct in_addr group;
+    struct in_addr iface;
+    iface.s_addr = htonl(INADDR_ANY);
+    if( (inet_pton(AF_INET, addr, &group) != 1)
+	|| ((ifAddr != NULL) && (inet_pton(AF_INET, ifAddr, &iface) != 1)) )
+    {
+	m_error = std::string("invalid address '") + addr + "'";
+	return(-1);
+    }
+
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if( sock < 0 )
+    {
+	m_error = std::string("cannot open socket: ") + strerror(errno);
+	return(-1);
+    }
+    int one = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+#ifdef SO_REUSEPORT
+    /* 같은 포트의 다른 그룹을 받는 채널과 공유 */
+    setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+#endif
+#ifdef IP_MULTICAST_ALL
+    /* 다른 소켓이 가입한 그룹은 받지 않음 */
+    int zero = 0;
+    setsockopt(sock, IPPROTO_IP, IP_MULTICAST_ALL, &zero, sizeof(zero));
+#endif
+
+    /* 큰 수신 버퍼 (권한이 있으면 rmem_max 초과 허용) */
+    int size = (int)rcvBufBytes;
+#ifdef SO_RCVBUFFORCE
+    if( setsockopt(sock, SOL_SOCKET, SO_RCVBUFFORCE, &size, sizeof(size)) != 0 )
+#endif
+    {
+	setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    }
+    int granted = 0;
+    socklen_t grantedLen = sizeof(granted);
+    getsockopt(sock, SOL_SOCKET, SO_RCVBUF, &granted, &grantedLen);
+#ifdef SO_RXQ_OVFL
+    setsockopt(sock, SOL_SOCKET, SO_RXQ_OVFL, &one, sizeof(one));
+#endif
+    struct timeval timeout;
+    timeout.tv_sec = 0;
+    timeout.tv_usec = RECV_TIMEOUT_MSECS * 1000;
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    struct sockaddr_in local;
+    memset(&local, 0, sizeof(local));
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    local.sin_port = htons((unsigned short)port);
+    if( bind(sock, (struct sockaddr *)&local, sizeof(local)) != 0 )
+    {
+	m_error = std::string("cannot bind port: ") + strerror(errno);
+	close(sock);
+	return(-1);
+    }
+    if( IN_MULTICAST(ntohl(group.s_addr)) )
+    {
+	struct ip_mreq mreq;
+	mreq.imr_multiaddr = group;
+	mreq.imr_interface = iface;
+	if( setsockopt(sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) != 0 )
+	{
+	    m_error = std::string("cannot join multicast group: ") + strerror(errno);
+	    close(sock);
+	    return(-1);
+	}
+    }
+
+    /* 배치 크기만큼 수신 버퍼와 스포크 슬롯을 미리 할당 */
+    m_sock = sock;
+    m_cat240 = cat240;
+    m_batch = batch;
+    m_bufs.resize(batch);
+    for(unsigned int i = 0; i < batch; i++)
+    {
+	m_bufs[i].resize(MAX_DATAGRAM_BYTES);
+    }
+    m_slots.resize(batch);
+    for(unsigned int i = 0; i < batch; i++)
+    {
+	m_slots[i].data.resize(MAX_SPOKE_BYTES);
+    }
+    m_message.reserve(MAX_MESSAGE_BYTES);
+    m_counts.rcvBufBytes = (unsigned int)granted;
+    publish();
+
+    m_thread = std::thread(&SPxBatchReceive::receiveThread, this);
+    if( m_cpu >= 0 )
+    {
+#ifdef __linux__
+	int err = EINVAL;
+	if( m_cpu < CPU_SETSIZE )
+	{
+	    cpu_set_t cpus;
+	    CPU_ZERO(&cpus);
+	    CPU_SET(m_cpu, &cpus);
+	    err = pthread_setaffinity_np(m_thread.native_handle(),
+					 sizeof(cpus), &cpus);
+	}
+	if( err != 0 )
+	{
+	    m_error = std::string("cannot pin receive thread: ") + strerror(err);
+	    return(-1);
+	}
+#else
+	m_error = "cannot pin receive thread on this platform";
+	return(-1);
+#endif
+    }
+    return(0);
+#endif
+} /* SPxBatchReceive::Create() */
+
+
+/*====================================================================
+*
+* SPxBatchReceive::DecodeDatagram
+*	Decode a datagram without receiving it.
+*
+* Params:
+*	buf, len		Datagram,
+*	cat240			Non-zero for ASTERIX Cat-240, else SPx.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	The data function is called before this returns.
+*
+*===================================================================*/
+void SPxBatchReceive::DecodeDatagram(const unsigned char *buf,
+				     unsigned int len, int cat240)
+{
+    m_cat240 = cat240;
+    m_counts.numPackets++;
+    decode(buf, len);
+    flush();
+    publish();
+} /* SPxBatchReceive::DecodeDatagram() */
+
+
+/*====================================================================
+*
+* SPxBatchReceive::GetStats
+*	Read the statistics.
+*
+* Params:
+*	stats			Filled in with totals since Create().
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Updated once per receive batch.
+*
+*===================================================================*/
+void SPxBatchReceive::GetStats(Stats *stats)
+{
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    *stats = m_stats;
+} /* SPxBatchReceive::GetStats() */
+
+
+/*********************************************************************
+*
+*	Private functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* SPxBatchReceive::receiveThread
+*	Receive, decode and deliver batches until stopped.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	recvmmsg() with MSG_WAITFORONE waits for the first datagram and
+*	then takes whatever else is queued, up to the batch size.
+*
+*===================================================================*/
+void SPxBatchReceive::receiveThread(void)
+{
+#if defined(__linux__)
+    std::vector<struct mmsghdr> msgs(m_batch);
+    std::vector<struct iovec> iovs(m_batch);
+    size_t controlBytes = CMSG_SPACE(sizeof(UINT32));
+    std::vector<unsigned char> control(m_batch * controlBytes);
+
+    while( !m_stop )
+    {
+	for(unsigned int i = 0; i < m_batch; i++)
+	{
+	    iovs[i].iov_base = &m_bufs[i][0];
+	    iovs[i].iov_len = m_bufs[i].size();
+	    memset(&msgs[i], 0, sizeof(msgs[i]));
+	    msgs[i].msg_hdr.msg_iov = &iovs[i];
+	    msgs[i].msg_hdr.msg_iovlen = 1;
+	    msgs[i].msg_hdr.msg_control = &control[i * controlBytes];
+	    msgs[i].msg_hdr.msg_controllen = controlBytes;
+	}
+	int num = recvmmsg(m_sock, &msgs[0], m_batch, MSG_WAITFORONE, NULL);
+	if( num <= 0 )
+	{
+	    /* 타임아웃(EAGAIN) 또는 시그널 */
+	    continue;
+	}
+	m_arrivalUsecs = nowUsecs();
+
+	m_counts.numSyscalls++;
+	m_counts.numPackets += (unsigned int)num;
+	if( (unsigned int)num > m_counts.maxBatch )
+	{
+	    m_counts.maxBatch = (unsigned int)num;
+	}
+	for(int i = 0; i < num; i++)
+	{
+	    struct msghdr *hdr = &msgs[i].msg_hdr;
+	    for(struct cmsghdr *cmsg = CMSG_FIRSTHDR(hdr); cmsg != NULL;
+		cmsg = CMSG_NXTHDR(hdr, cmsg))
+	    {
+		/* 소켓 생성 이후 커널이 버린 데이터그램 누계 */
+		if( (cmsg->cmsg_level == SOL_SOCKET)
+		    && (cmsg->cmsg_type == SO_RXQ_OVFL) )
+		{
+		    UINT32 drops;
+		    memcpy(&drops, CMSG_DATA(cmsg), sizeof(drops));
+		    m_counts.numKernelDrops = drops;
+		}
+	    }
+	    if( hdr->msg_flags & MSG_TRUNC )
+	    {
+		m_counts.numBad++;
+		continue;
+	    }
+	    decode(&m_bufs[i][0], msgs[i].msg_len);
+	}
+	flush();
+	publish();
+    }
+#elif !defined(_WIN32)
+    while( !m_stop )
+    {
+	ssize_t len = recv(m_sock, &m_bufs[0][0], m_bufs[0].size(), 0);
+	if( len <= 0 )
+	{
+	    continue;
+	}
+	m_arrivalUsecs = nowUsecs();
+	m_counts.numSyscalls++;
+	m_counts.numPackets++;
+	m_counts.maxBatch = 1;
+	decode(&m_bufs[0][0], (unsigned int)len);
+	flush();
+	publish();
+    }
+#endif
+} /* SPxBatchReceive::receiveThread() */
+
+
+/*====================================================================
+*
+* SPxBatchReceive::decode
+*	Decode a datagram into spoke slots.
+*
+* Params:
+*	buf, len		Datagram.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+void SPxBatchReceive::decode(const unsigned char *buf, unsigned int len)
+{
+    if( m_cat240 )
+    {
+	decodeCat240(buf, len);
+    }
+    else
+    {
+	decodeSpx(buf, len);
+    }
+} /* SPxBatchReceive::decode() */
+
+
+/*====================================================================
+*
+* SPxBatchReceive::decodeSpx
+*	Decode an SPx datagram, reassembling chunked messages.
+*
+* Params:
+*	buf, len		Datagram.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Chunks of one message are expected together; a chunk of another
+*	message abandons a partly received one.  Datagrams without an
+*	SPxNetChunkHeader are taken as a whole message.
+*
+*===================================================================*/
+void SPxBatchReceive::decodeSpx(const unsigned char *buf, unsigned int len)
+{
+    if( (len < CHUNK_HEADER_BYTES) || (read32(buf, 1) != SPX_NETDIST_MAGIC) )
+    {
+	decodePayload(buf, len);
+	return;
+    }
+
+    unsigned int headerSize = buf[5];
+    unsigned int numChunks = buf[6];
+    unsigned int thisChunk = buf[7];
+    UINT16 sequence = (UINT16)read16(buf + 8, 1);
+    unsigned int payloadSize = read16(buf + 10, 1);
+    UINT32 totalSize = read32(buf + 12, 1);
+    UINT32 offset = read32(buf + 16, 1);
+    UINT32 source = read32(buf + 20, 1);
+    if( (headerSize < CHUNK_HEADER_BYTES) || ((headerSize + payloadSize) > len)
+	|| (numChunks == 0) || (thisChunk >= numChunks) )
+    {
+	m_counts.numBad++;
+	return;
+    }
+    if( numChunks == 1 )
+    {
+	decodePayload(buf + headerSize, payloadSize);
+	return;
+    }
+    if( (totalSize > MAX_MESSAGE_BYTES) || (offset > totalSize)
+	|| (payloadSize > (totalSize - offset)) )
+    {
+	m_counts.numBad++;
+	return;
+    }
+
+    /* 다른 메시지의 청크가 오면 미완성 메시지는 버림 */
+    if( (m_msgReceived > 0) && ((sequence != m_msgSequence)
+				|| (source != m_msgSource)) )
+    {
+	m_counts.numIncomplete++;
+	m_msgReceived = 0;
+    }
+    if( m_msgReceived == 0 )
+    {
+	m_msgSequence = sequence;
+	m_msgSource = source;
+	m_msgChunks = numChunks;
+	m_message.resize(totalSize);
+    }
+    else if( (numChunks != m_msgChunks) || (totalSize != m_message.size()) )
+    {
+	m_counts.numBad++;
+	m_msgReceived = 0;
+	return;
+    }
+    if( payloadSize > 0 )
+    {
+	memcpy(&m_message[offset], buf + headerSize, payloadSize);
+    }
+    if( ++m_msgReceived == m_msgChunks )
+    {
+	m_msgReceived = 0;
+	decodePayload(&m_message[0], (unsigned int)m_message.size());
+    }
+} /* SPxBatchReceive::decodeSpx() */
+
+
+/*====================================================================
+*
+* SPxBatchReceive::decodePayload
+*	Decode a complete SPx message.
+*
+* Params:
+*	buf, len		Message.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	The message is an SPxReturnHeader or SPxPacketHeaderB, in either
+*	byte order (found from the magic number).
+*
+*===================================================================*/
+void SPxBatchReceive::decodePayload(const unsigned char *buf, unsigned int len)
+{
+    if( (len >= 4) && ((read32(buf, 0) == SPX_RIB_HEADER_MAGIC1)
+		       || (read32(buf, 1) == SPX_RIB_HEADER_MAGIC1)) )
+    {
+	decodeReturn(buf, len);
+    }
+    else if( (len >= 2) && ((read16(buf, 0) == SPX_PACKET_MAGIC_B)
+			    || (read16(buf, 1) == SPX_PACKET_MAGIC_B)) )
+    {
+	decodePacketB(buf, len);
+    }
+    else
+    {
+	m_counts.numBad++;
+    }
+} /* SPxBatchReceive::decodePayload() */
+
+
+/*====================================================================
+*
+* SPxBatchReceive::decodeReturn
+*	Decode an SPxReturnHeader and its data.
+*
+* Params:
+*	buf, len		Message.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+void SPxBatchReceive::decodeReturn(const unsigned char *buf, unsigned int len)
+{
+    if( len < RETURN_HEADER_BYTES )
+    {
+	m_counts.numBad++;
+	return;
+    }
+    int big = (read32(buf, 1) == SPX_RIB_HEADER_MAGIC1);
+    Slot *slot = nextSlot();
+    SPxReturnHeader *hdr = &slot->hdr;
+    hdr->magic1 = read32(buf, big);
+    hdr->protocolVersion = (UINT16)read16(buf + 4, big);
+    hdr->reserved06 = buf[6];
+    hdr->headerSize = buf[7];
+    hdr->radarVideoSize = (UINT16)read16(buf + 8, big);
+    hdr->numTriggers = buf[10];
+    hdr->sourceType = buf[11];
+    hdr->reserved12 = buf[12];
+    hdr->sourceCode = buf[13];
+    hdr->count = (UINT16)read16(buf + 14, big);
+    hdr->nominalLength = (UINT16)read16(buf + 16, big);
+    hdr->thisLength = (UINT16)read16(buf + 18, big);
+    hdr->azimuth = (UINT16)read16(buf + 20, big);
+    hdr->packing = buf[22];
+    hdr->scanMode = buf[23];
+    hdr->totalSize = read32(buf + 24, big);
+    hdr->heading = (UINT16)read16(buf + 28, big);
+    hdr->reserved30 = (UINT16)read16(buf + 30, big);
+    hdr->timeInterval = (UINT16)read16(buf + 32, big);
+    hdr->pimFlags = buf[34];
+    hdr->dataFlags = buf[35];
+    hdr->startRange = readFloat(buf + 36, big);
+    hdr->endRange = readFloat(buf + 40, big);
+    hdr->magic2 = read32(buf + 44, big);
+    if( (hdr->magic2 != SPX_RIB_HEADER_MAGIC2)
+	|| (hdr->headerSize < RETURN_HEADER_BYTES)
+	|| ((unsigned int)(hdr->headerSize + hdr->radarVideoSize) > len) )
+    {
+	m_counts.numBad++;
+	return;
+    }
+
+    /* ZLIB 패킹은 압축된 RAW8, 플래그는 원래 패킹의 압축 */
+    unsigned int packing = hdr->packing;
+    int compressed = (packing == SPX_RIB_PACKING_ZLIB)
+	|| (hdr->dataFlags & SPX_RIB_DATA_FLAG_COMPRESSED_ZLIB);
+    if( (packing == SPX_RIB_PACKING_ORC)
+	|| (hdr->dataFlags & SPX_RIB_DATA_FLAG_COMPRESSED_ORC) )
+    {
+	m_counts.numUnsupported++;
+	return;
+    }
+    if( packing == SPX_RIB_PACKING_ZLIB )
+    {
+	packing = SPX_RIB_PACKING_RAW8;
+    }
+    if( unpack(slot, buf + hdr->headerSize, hdr->radarVideoSize, packing,
+	       hdr->thisLength, compressed,
+	       (hdr->dataFlags & SPX_RIB_DATA_FLAG_BIG_ENDIAN) != 0) == 0 )
+    {
+	m_numReady++;
+    }
+} /* SPxBatchReceive::decodeReturn() */
+
+
+/*====================================================================
+*
+* SPxBatchReceive::decodePacketB
+*	Decode an SPxPacketHeaderB radar config or return packet.
+*
+* Params:
+*	buf, len		Message.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Range scaling comes from the last SPxPacketRadarConfig for the
+*	channel, zero until one has been seen.
+*
+*===================================================================*/
+void SPxBatchReceive::decodePacketB(const unsigned char *buf, unsigned int len)
+{
+    if( len < PACKETB_HEADER_BYTES )
+    {
+	m_counts.numBad++;
+	return;
+    }
+    int big = (read16(buf, 1) == SPX_PACKET_MAGIC_B);
+    unsigned int type = read16(buf + 2, big);
+    UINT32 totalSize = read32(buf + 4, big);
+    if( (totalSize < PACKETB_HEADER_BYTES) || (totalSize > len) )
+    {
+	m_counts.numBad++;
+	return;
+    }
+    const unsigned char *p = buf + PACKETB_HEADER_BYTES;
+    unsigned int n = totalSize - PACKETB_HEADER_BYTES;
+
+    if( type == SPX_PACKET_TYPEB_RADAR_CONFIG )
+    {
+	if( n < RADAR_CONFIG_BYTES )
+	{
+	    m_counts.numBad++;
+	    return;
+	}
+	Channel *channel = &m_channels[p[0]];
+	channel->nominalLength = (UINT16)read16(p + 2, big);
+	channel->startRange = readFloat(p + 4, big);
+	channel->endRange = readFloat(p + 8, big);
+	return;
+    }
+    if( type != SPX_PACKET_TYPEB_RADAR_RETURN )
+    {
+	m_counts.numUnsupported++;
+	return;
+    }
+
+    if( n < RADAR_RETURN_BYTES )
+    {
+	m_counts.numBad++;
+	return;
+    }
+    unsigned int encodeMode = p[3];
+    unsigned int dataFlags = p[5];
+    unsigned int rawLength = read16(p + 12, big);
+    unsigned int encLength = read16(p + 14, big);
+    if( (RADAR_RETURN_BYTES + encLength) > n )
+    {
+	m_counts.numBad++;
+	return;
+    }
+    if( (encodeMode == SPX_RIB_PACKING_ORC)
+	|| (dataFlags & SPX_RIB_DATA_FLAG_COMPRESSED_ORC) )
+    {
+	m_counts.numUnsupported++;
+	return;
+    }
+    int compressed = (encodeMode == SPX_RIB_PACKING_ZLIB)
+	|| (dataFlags & SPX_RIB_DATA_FLAG_COMPRESSED_ZLIB);
+    unsigned int packing = (encodeMode == SPX_RIB_PACKING_ZLIB)
+	? SPX_RIB_PACKING_RAW8 : encodeMode;
+    unsigned int numSamples = (packing == SPX_RIB_PACKING_RAW16)
+	? (rawLength / 2) : rawLength;
+
+    const Channel *channel = &m_channels[p[2]];
+    Slot *slot = nextSlot();
+    SPxReturnHeader *hdr = &slot->hdr;
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->magic1 = SPX_RIB_HEADER_MAGIC1;
+    hdr->magic2 = SPX_RIB_HEADER_MAGIC2;
+    hdr->azimuth = (UINT16)read16(p, big);
+    hdr->scanMode = p[4];
+    hdr->dataFlags = (UINT8)dataFlags;
+    hdr->timeInterval = (UINT16)read16(p + 6, big);
+    hdr->numTriggers = 1;
+    hdr->nominalLength = (channel->nominalLength > 0)
+	? channel->nominalLength : (UINT16)numSamples;
+    hdr->startRange = channel->startRange;
+    hdr->endRange = channel->endRange;
+    if( unpack(slot, p + RADAR_RETURN_BYTES, encLength, packing, numSamples,
+	       compressed, (dataFlags & SPX_RIB_DATA_FLAG_BIG_ENDIAN) != 0) == 0 )
+    {
+	m_numReady++;
+    }
+} /* SPxBatchReceive::decodePacketB() */
+
+
+/*====================================================================
+*
+* SPxBatchReceive::decodeCat240
+*	Decode the ASTERIX data blocks of a Cat-240 datagram.
+*
+* Params:
+*	buf, len		Datagram.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+void SPxBatchReceive::decodeCat240(const unsigned char *buf, unsigned int len)
+{
+    while( len > 0 )
+    {
+	/* CAT, LEN (블록 전체) 다음에 레코드들 */
+	unsigned int blockLen = (len >= 3) ? read16(buf + 1, 1) : 0;
+	if( (len < 3) || (buf[0] != 240) || (blockLen < 3) || (blockLen > len) )
+	{
+	    m_counts.numBad++;
+	    return;
+	}
+	const unsigned char *record = buf + 3;
+	unsigned int recordLen = blockLen - 3;
+	while( recordLen > 0 )
+	{
+	    int used = decodeCat240Record(record, recordLen);
+	    if( used <= 0 )
+	    {
+		return;
+	    }
+	    record += used;
+	    recordLen -= (unsigned int)used;
+	}
+	buf += blockLen;
+	len -= blockLen;
+    }
+} /* SPxBatchReceive::decodeCat240() */
+
+
+/*====================================================================
+*
+* SPxBatchReceive::decodeCat240Record
+*	Decode one Cat-240 record.
+*
+* Params:
+*	buf, len		Record and what follows it in the block.
+*
+* Returns:
+*	Bytes used by the record, or -1 if it is malformed.
+*
+* Notes
+*	Items (FRN): 1 I240/010, 2 /000, 3 /020, 4 /030, 5 /040,
+*	6 /041, 7 /048, 8 /049, 9 /050, 10 /051, 11 /052, 12 /140,
+*	13 RE, 14 SP.
+*
+*===================================================================*/
+int SPxBatchReceive::decodeCat240Record(const unsigned char *buf,
+					unsigned int len)
+{
+    /* FSPEC: 바이트당 7개 FRN, 최하위 비트는 FX */
+    unsigned int fspec = 0;
+    unsigned int pos = 0;
+    unsigned int numFrns = 0;
+    do
+    {
+	if( (pos >= len) || (numFrns >= 14) )
+	{
+	    m_counts.numBad++;
+	    return(-1);
+	}
+	fspec |= (unsigned int)(buf[pos] >> 1) << (7 * (1 - pos));
+	numFrns += 7;
+    } while( buf[pos++] & 0x01 );
+
+    unsigned int msgType = 0;
+    UINT32 index = 0;
+    unsigned int startAz = 0;
+    UINT32 startRg = 0;
+    UINT32 cellDur = 0;
+    int haveCells = 0;
+    int femto = 0;
+    int compressed = 0;
+    unsigned int res = 0;
+    UINT32 numCells = 0;
+    const unsigned char *video = NULL;
+    unsigned int videoBytes = 0;
+    for(unsigned int frn = 1; frn <= 14; frn++)
+    {
+	if( !(fspec & (1u << (14 - frn))) )
+	{
+	    continue;
+	}
+	unsigned int size = 0;
+	switch( frn )
+	{
+	    case 1:	size = 2;		break;
+	    case 2:	size = 1;		break;
+	    case 3:	size = 4;		break;
+	    case 5:	/* fall through */
+	    case 6:	size = 12;		break;
+	    case 7:	size = 2;		break;
+	    case 8:	size = 5;		break;
+	    case 12:	size = 3;		break;
+	    default:
+		/* 반복 또는 가변 길이 항목 */
+		if( pos >= len )
+		{
+		    m_counts.numBad++;
+		    return(-1);
+		}
+		if( frn == 4 )	      size = 1 + buf[pos];
+		else if( frn == 9 )   size = 1 + (buf[pos] * 4);
+		else if( frn == 10 )  size = 1 + (buf[pos] * 64);
+		else if( frn == 11 )  size = 1 + (buf[pos] * 256);
+		else		      size = buf[pos];
+		break;
+	}
+	if( (size == 0) || (size > (len - pos)) )
+	{
+	    m_counts.numBad++;
+	    return(-1);
+	}
+	const unsigned char *item = buf + pos;
+	switch( frn )
+	{
+	    case 2:	msgType = item[0];				break;
+	    case 3:	index = read32(item, 1);			break;
+	    case 5:	/* fall through */
+	    case 6:
+		startAz = read16(item, 1);
+		startRg = read32(item + 4, 1);
+		cellDur = read32(item + 8, 1);
+		femto = (frn == 6);
+		haveCells = 1;
+		break;
+	    case 7:
+		compressed = (item[0] & 0x80) != 0;
+		res = item[1];
+		break;
+	    case 8:
+		numCells = ((UINT32)item[2] << 16) | ((UINT32)item[3] << 8) | item[4];
+		break;
+	    case 9:	/* fall through */
+	    case 10:	/* fall through */
+	    case 11:
+		video = item + 1;
+		videoBytes = size - 1;
+		break;
+	    default:							break;
+	}
+	pos += size;
+    }
+
+    if( msgType == CAT240_MSG_SUMMARY )
+    {
+	m_counts.numSummaries++;
+	return((int)pos);
+    }
+    if( msgType != CAT240_MSG_VIDEO )
+    {
+	m_counts.numUnsupported++;
+	return((int)pos);
+    }
+    if( !haveCells || (res == 0) || (video == NULL) )
+    {
+	m_counts.numBad++;
+	return((int)pos);
+    }
+    /* 8/16비트 셀만 지원 (RES 4, 5) */
+    if( ((res != 4) && (res != 5)) || (numCells > 65535) )
+    {
+	m_counts.numUnsupported++;
+	return((int)pos);
+    }
+
+    double cellMetres = cellDur * (femto ? 1e-15 : 1e-9) * (299792458.0 / 2.0);
+    Slot *slot = nextSlot();
+    SPxReturnHeader *hdr = &slot->hdr;
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->magic1 = SPX_RIB_HEADER_MAGIC1;
+    hdr->magic2 = SPX_RIB_HEADER_MAGIC2;
+    hdr->count = (UINT16)index;
+    hdr->azimuth = (UINT16)startAz;
+    hdr->numTriggers = 1;
+    hdr->nominalLength = (UINT16)numCells;
+    hdr->startRange = (REAL32)(startRg * cellMetres);
+    hdr->endRange = (REAL32)((startRg + numCells) * cellMetres);
+    if( unpack(slot, video, videoBytes,
+	       (res == 5) ? SPX_RIB_PACKING_RAW16 : SPX_RIB_PACKING_RAW8,
+	       numCells, compressed, 1) == 0 )
+    {
+	m_numReady++;
+    }
+    return((int)pos);
+} /* SPxBatchReceive::decodeCat240Record() */
+
+
+/*====================================================================
+*
+* SPxBatchReceive::unpack
+*	Put a spoke's samples in its slot.
+*
+* Params:
+*	slot			Slot, header filled in apart from the
+*				sizes and packing,
+*	src, srcBytes		Encoded data,
+*	packing			SPX_RIB_PACKING_RAW8 or _RAW16 once
+*				decompressed,
+*	numSamples		Samples in the spoke,
+*	compressed		Non-zero if zlib compressed,
+*	bigEndian		Non-zero if 16-bit samples are big-endian.
+*
+* Returns:
+*	Zero on success, -1 if the spoke is not delivered (counted).
+*
+* Notes
+*	Samples are left in host order, uncompressed.
+*
+*===================================================================*/
+int SPxBatchReceive::unpack(Slot *slot, const unsigned char *src,
+			    unsigned int srcBytes, unsigned int packing,
+			    unsigned int numSamples, int compressed,
+			    int bigEndian)
+{
+    unsigned int bps = (packing == SPX_RIB_PACKING_RAW16) ? 2
+	: ((packing == SPX_RIB_PACKING_RAW8) ? 1 : 0);
+    if( bps == 0 )
+    {
+	m_counts.numUnsupported++;
+	return(-1);
+    }
+    unsigned int bytes = numSamples * bps;
+    if( bytes > slot->data.size() )
+    {
+	m_counts.numBad++;
+	return(-1);
+    }
+    unsigned char *dest = &slot->data[0];
+    if( compressed )
+    {
+	uLongf destLen = bytes;
+	if( (bytes > 0) && ((uncompress(dest, &destLen, src, srcBytes) != Z_OK)
+			    || (destLen != bytes)) )
+	{
+	    m_counts.numBad++;
+	    return(-1);
+	}
+    }
+    else
+    {
+	if( srcBytes < bytes )
+	{
+	    m_counts.numBad++;
+	    return(-1);
+	}
+	memcpy(dest, src, bytes);
+    }
+
+    /* 16비트 샘플은 호스트 바이트 순서로 */
+    const UINT16 one = 1;
+    int hostBig = (*(const unsigned char *)&one == 0);
+    if( (bps == 2) && (bigEndian != hostBig) )
+    {
+	for(unsigned int i = 0; i < bytes; i += 2)
+	{
+	    unsigned char t = dest[i];
+	    dest[i] = dest[i + 1];
+	    dest[i + 1] = t;
+	}
+    }
+
+    SPxReturnHeader *hdr = &slot->hdr;
+    hdr->headerSize = sizeof(SPxReturnHeader);
+    hdr->packing = (UCHAR)packing;
+    hdr->thisLength = (UINT16)numSamples;
+    hdr->radarVideoSize = (UINT16)bytes;
+    hdr->totalSize = sizeof(SPxReturnHeader) + bytes;
+    hdr->dataFlags &= ~(SPX_RIB_DATA_FLAG_COMPRESSION_MASK
+			| SPX_RIB_DATA_FLAG_BIG_ENDIAN);
+    if( hostBig && (bps == 2) )
+    {
+	hdr->dataFlags |= SPX_RIB_DATA_FLAG_BIG_ENDIAN;
+    }
+    return(0);
+} /* SPxBatchReceive::unpack() */
+
+
+/*====================================================================
+*
+* SPxBatchReceive::nextSlot
+*	Get the next free spoke slot.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Slot, used if the decoder then increments m_numReady.
+*
+* Notes
+*	Delivers the ready spokes first if all the slots are in use.
+*
+*===================================================================*/
+SPxBatchReceive::Slot *SPxBatchReceive::nextSlot(void)
+{
+    if( m_numReady >= m_slots.size() )
+    {
+	flush();
+    }
+    return(&m_slots[m_numReady]);
+} /* SPxBatchReceive::nextSlot() */
+
+
+/*====================================================================
+*
+* SPxBatchReceive::flush
+*	Call the data function for the ready spokes.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+void SPxBatchReceive::flush(void)
+{
+    for(unsigned int i = 0; i < m_numReady; i++)
+    {
+	if( m_fn != NULL )
+	{
+	    m_fn(m_userArg, &m_slots[i].hdr, &m_slots[i].data[0]);
+	}
+    }
+    m_counts.numSpokes += m_numReady;
+    m_numReady = 0;
+} /* SPxBatchReceive::flush() */
+
+
+/*====================================================================
+*
+* SPxBatchReceive::publish
+*	Make the counts visible to GetStats().
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+void SPxBatchReceive::publish(void)
+{
+    m_counts.packetsPerSyscall = (m_counts.numSyscalls > 0)
+	? ((double)m_counts.numPackets / (double)m_counts.numSyscalls) : 0.0;
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    m_stats = m_counts;
+} /* SPxBatchReceive::publish() */
+
+
+/*====================================================================
+*
+* read16, read32, readFloat
+*	Read a field of either byte order.
+*
+* Params:
+*	p			Field,
+*	big			Non-zero if big-endian.
+*
+* Returns:
+*	Value
+*
+* Notes
+*
+*===================================================================*/
+static unsigned int read16(const unsigned char *p, int big)
+{
+    return( big ? ((unsigned int)(p[0] << 8) | p[1])
+	    : ((unsigned int)(p[1] << 8) | p[0]) );
+} /* read16() */
+
+static UINT32 read32(const unsigned char *p, int big)
+{
+    return( big ? (((UINT32)p[0] << 24) | ((UINT32)p[1] << 16)
+		   | ((UINT32)p[2] << 8) | p[3])
+	    : (((UINT32)p[3] << 24) | ((UINT32)p[2] << 16)
+	       | ((UINT32)p[1] << 8) | p[0]) );
+} /* read32() */
+
+static REAL32 readFloat(const unsigned char *p, int big)
+{
+    UINT32 bits = read32(p, big);
+    REAL32 value;
+    memcpy(&value, &bits, sizeof(value));
+    return(value);
+} /* readFloat() */
+
+
+/*====================================================================
+*
+* nowUsecs
+*	Get the monotonic time.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Steady clock microseconds, the clock SPxStreamOutput uses.
+*
+* Notes
+*
+*===================================================================*/
+static int64_t nowUsecs(void)
+{
+    return( std::chrono::duration_cast<std::chrono::microseconds>(
+	std::chrono::steady_clock::now().time_since_epoch()).count() );
+} /* nowUsecs() */
+
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
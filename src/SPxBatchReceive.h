@@ -0,0 +1,178 @@
+/*********************************************************************
+*
+* File: SPxBatchReceive.h
+*
+* Purpose:
+*	Native batched UDP receiver for SPx and ASTERIX Cat-240 radar
+*	video, an alternative to SPxNetworkReceive for high packet rates.
+*
+*	A receive thread reads up to a batch of datagrams per system
+*	call (recvmmsg() on Linux, one recvfrom() per call elsewhere)
+*	from a socket with a large receive buffer, decodes them straight
+*	into preallocated spoke slots and then calls the data function
+*	once per spoke, as SPxNetworkReceive's data function is called.
+*
+*	SPx video is accepted as SPxReturnHeader messages (in one or
+*	more SPxNetChunkHeader chunks, see SPxNetDist.h) or as
+*	SPxPacketHeaderB radar config/return packets (SPxPackets.h).
+*	Cat-240 video messages are decoded per I240/040 to I240/052;
+*	summary messages are counted and skipped.  Spokes are delivered
+*	as RAW8 or RAW16 (host order) with compression removed; other
+*	packings (ORC, 4-bit etc.) are counted as unsupported.
+*
+*	Packets per system call and kernel drops (SO_RXQ_OVFL, Linux)
+*	are kept with the decoding statistics.  Only the SPx headers are
+*	needed, not the SPx library.
+*
+*	Several receivers may share a port (SO_REUSEPORT), each joined to
+*	its own group: on Linux a socket only gets the groups it joined
+*	(IP_MULTICAST_ALL off).  The receive thread can be pinned to a
+*	core.
+*
+**********************************************************************/
+
+#ifndef _SPX_BATCH_RECEIVE_H
+#define _SPX_BATCH_RECEIVE_H
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "SPxLibData/SPxRib.h"
+
+/* Default receive buffer size, and the most datagrams per system call. */
+#define	SPX_BATCH_RECEIVE_RCVBUF_MB	32
+#define	SPX_BATCH_RECEIVE_MAX_BATCH	1024
+
+/* Data function, called on the receive thread for each spoke. */
+typedef void (*SPxBatchReceiveFn_t)(void *userArg, SPxReturnHeader *hdr,
+				    unsigned char *data);
+
+class SPxBatchReceive
+{
+public:
+    /* Totals since Create(). */
+    struct Stats
+    {
+	uint64_t numPackets;		/* Datagrams received */
+	uint64_t numSyscalls;		/* Receive calls returning data */
+	double packetsPerSyscall;
+	unsigned int maxBatch;		/* Most datagrams in one call */
+	uint64_t numSpokes;		/* Spokes delivered */
+	uint64_t numKernelDrops;	/* From SO_RXQ_OVFL, 0 if unsupported */
+	uint64_t numBad;		/* Malformed or truncated */
+	uint64_t numIncomplete;		/* Chunked messages missing chunks */
+	uint64_t numUnsupported;	/* Packing or message not decoded */
+	uint64_t numSummaries;		/* Cat-240 summary messages */
+	unsigned int rcvBufBytes;	/* Receive buffer size granted */
+    };
+
+    /* Constructor/destructor. */
+    SPxBatchReceive(SPxBatchReceiveFn_t fn, void *userArg);
+    ~SPxBatchReceive();
+
+    /* Open the socket (joining addr if multicast) and start the receive
+     * thread.  NULL/0 address and port mean the SPx (or Cat-240)
+     * defaults.  Zero on success or -1 on error (see GetError()).
+     */
+    int Create(const char *addr, int port, const char *ifAddr, int cat240,
+	       unsigned int batch, unsigned int rcvBufBytes);
+    const char *GetError(void) const { return m_error.c_str(); }
+
+    /* Core to pin the receive thread to, -1 (default) for none.  Call
+     * before Create(), which fails if the thread cannot be pinned.
+     */
+    void SetCpu(int cpu) { m_cpu = cpu; }
+
+    /* Decode one datagram as if received, calling the data function
+     * (for checking the decoders without a socket, not after Create()).
+     */
+    void DecodeDatagram(const unsigned char *buf, unsigned int len,
+			int cat240);
+
+    /* Read the statistics. */
+    void GetStats(Stats *stats);
+
+    /* When the batch being delivered was received, steady clock
+     * microseconds (as SPxStreamOutput::NowUsecs()).  Only valid in the
+     * data function, on the receive thread.
+     */
+    int64_t GetArrivalUsecs(void) const { return m_arrivalUsecs; }
+
+private:
+    /* Decoded spoke waiting for the data function. */
+    struct Slot
+    {
+	SPxReturnHeader hdr;
+	std::vector<unsigned char> data;
+    };
+
+    /* Range scaling from SPxPacketRadarConfig, per channel. */
+    struct Channel
+    {
+	UINT16 nominalLength;
+	REAL32 startRange;
+	REAL32 endRange;
+    };
+
+    /* Socket and thread. */
+    int m_sock;
+    int m_cat240;
+    unsigned int m_batch;
+    int m_cpu;
+    std::thread m_thread;
+    std::atomic<int> m_stop;
+    int64_t m_arrivalUsecs;
+    SPxBatchReceiveFn_t m_fn;
+    void *m_userArg;
+    std::string m_error;
+
+    /* Receive buffers, one per datagram of a batch. */
+    std::vector<std::vector<unsigned char> > m_bufs;
+
+    /* Spoke slots, filled by the decoders and emptied by flush(). */
+    std::vector<Slot> m_slots;
+    unsigned int m_numReady;
+
+    /* Reassembly of chunked SPx messages. */
+    std::vector<unsigned char> m_message;
+    UINT32 m_msgSource;
+    UINT16 m_msgSequence;
+    unsigned int m_msgChunks;		/* Chunks expected */
+    unsigned int m_msgReceived;		/* Chunks received, 0 if none */
+    std::vector<Channel> m_channels;
+
+    /* Statistics, counted in m_counts by the decoding thread and
+     * published to m_stats (guarded by m_statsMutex) per batch.
+     */
+    Stats m_counts;
+    std::mutex m_statsMutex;
+    Stats m_stats;
+
+    /* Private functions. */
+    void receiveThread(void);
+    void decode(const unsigned char *buf, unsigned int len);
+    void decodeSpx(const unsigned char *buf, unsigned int len);
+    void decodePayload(const unsigned char *buf, unsigned int len);
+    void decodeReturn(const unsigned char *buf, unsigned int len);
+    void decodePacketB(const unsigned char *buf, unsigned int len);
+    void decodeCat240(const unsigned char *buf, unsigned int len);
+    int decodeCat240Record(const unsigned char *buf, unsigned int len);
+    int unpack(Slot *slot, const unsigned char *src, unsigned int srcBytes,
+	       unsigned int packing, unsigned int numSamples, int compressed,
+	       int bigEndian);
+    Slot *nextSlot(void);
+    void flush(void);
+    void publish(void);
+};
+
+#endif /* _SPX_BATCH_RECEIVE_H */
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
@@ -0,0 +1,850 @@
+/*********************************************************************
+*
+* File: SPxCfar.cpp
+*
+* Purpose:
+*	CA-CFAR and OS-CFAR detection on 8-bit spokes (see SPxCfar.h).
+*
+**********************************************************************/
+
+/* Standard headers. */
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define	SPX_CFAR_X86	1
+#include <immintrin.h>
+#endif
+
+/* Our own header. */
+#include "SPxCfar.h"
+
+/* Other headers. */
+#include "SPxWorkPool.h"
+
+/*
+ * Constants.
+ */
+#define	MAX_GUARD	32
+#define	MAX_REF		64
+#define	MAX_AZIS	4	/* Keeps column sums within 16 bits */
+#define	MAX_SCALE	32.0	/* Keeps scale * sum within 32 bits */
+#define	MIN_CHUNK	8	/* Spokes per parallel task */
+
+/*
+ * Private function prototypes.
+ */
+static int useAvx2(void);
+static int parseInt(const std::string &text, int min, int max, int *value);
+static void colSumScalar(uint16_t *sum, const uint8_t *row, int start, int end);
+static void caScalar(uint8_t *dst, const uint8_t *cut, const uint32_t *prefix,
+		     int start, int end, int guard, int ref,
+		     uint32_t cutScale, uint32_t scaleQ8, int binary);
+#ifdef SPX_CFAR_X86
+static void colSumAvx2(uint16_t *sum, const uint8_t *row, int n);
+static void caAvx2(uint8_t *dst, const uint8_t *cut, const uint32_t *prefix,
+		   int n, int guard, int ref,
+		   uint32_t cutScale, uint32_t scaleQ8, int binary);
+#endif
+
+
+/*********************************************************************
+*
+*	Public functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* SPxCfar::SPxCfar
+*	Constructor, defaults to "ca,2,16,3".
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+SPxCfar::SPxCfar(void)
+    : m_mode(MODE_CA), m_guard(2), m_ref(16), m_scaleQ8(768), m_azis(0),
+      m_binary(0), m_simd(useAvx2()), m_historySamples(0), m_historyLen(0),
+      m_historyNext(0), m_scratch(1), m_runFrame(NULL), m_runSpokes(0),
+      m_runSamples(0), m_runStride(0), m_runChunk(0)
+{
+} /* SPxCfar::SPxCfar() */
+
+
+/*====================================================================
+*
+* SPxCfar::~SPxCfar
+*	Destructor.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+SPxCfar::~SPxCfar()
+{
+} /* SPxCfar::~SPxCfar() */
+
+
+/*====================================================================
+*
+* SPxCfar::SetParams
+*	Configure the detector.
+*
+* Params:
+*	args			"<ca|os>,<guard>,<ref>,<scale>[,<azis>][,bin]".
+*
+* Returns:
+*	Zero on success, -1 if the string is invalid.
+*
+* Notes
+*	Also clears the spoke history.
+*
+*===================================================================*/
+int SPxCfar::SetParams(const char *args)
+{
+    std::vector<std::string> fields;
+    std::string text = (args != NULL) ? args : "";
+    size_t pos = 0;
+    while( pos <= text.size() )
+    {
+	size_t end = text.find(',', pos);
+	if( end == std::string::npos )
+	{
+	    end = text.size();
+	}
+	fields.push_back(text.substr(pos, end - pos));
+	pos = end + 1;
+    }
+
+    int binary = 0;
+    if( fields.back() == "bin" )
+    {
+	binary = 1;
+	fields.pop_back();
+    }
+    if( (fields.size() < 4) || (fields.size() > 5) )
+    {
+	return(-1);
+    }
+
+    Mode mode;
+    if( fields[0] == "ca" )
+    {
+	mode = MODE_CA;
+    }
+    else if( fields[0] == "os" )
+    {
+	mode = MODE_OS;
+    }
+    else
+    {
+	return(-1);
+    }
+
+    int guard, ref, azis = 0;
+    if( (parseInt(fields[1], 0, MAX_GUARD, &guard) != 0)
+	|| (parseInt(fields[2], 1, MAX_REF, &ref) != 0)
+	|| ((fields.size() == 5) && (parseInt(fields[4], 0, MAX_AZIS, &azis) != 0)) )
+    {
+	return(-1);
+    }
+    char *end = NULL;
+    double scale = strtod(fields[3].c_str(), &end);
+    if( fields[3].empty() || (*end != '\0') || !(scale > 0.0) || (scale > MAX_SCALE) )
+    {
+	return(-1);
+    }
+
+    m_mode = mode;
+    m_guard = guard;
+    m_ref = ref;
+    m_scaleQ8 = (unsigned int)floor((scale * 256.0) + 0.5);
+    m_azis = azis;
+    m_binary = binary;
+    Reset();
+    return(0);
+} /* SPxCfar::SetParams() */
+
+
+/*====================================================================
+*
+* SPxCfar::SetSimd
+*	Enable or disable the AVX2 kernels.
+*
+* Params:
+*	enable			Non-zero to use AVX2 when the CPU has it.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	For benchmarks; the results are the same either way.
+*
+*===================================================================*/
+void SPxCfar::SetSimd(int enable)
+{
+    m_simd = enable ? useAvx2() : 0;
+} /* SPxCfar::SetSimd() */
+
+
+/*====================================================================
+*
+* SPxCfar::GetSimdName
+*	Report which kernels SetSimd(1) selects.
+*
+* Params:
+*	None
+*
+* Returns:
+*	"avx2" or "scalar".
+*
+* Notes
+*
+*===================================================================*/
+const char *SPxCfar::GetSimdName(void)
+{
+    return( useAvx2() ? "avx2" : "scalar" );
+} /* SPxCfar::GetSimdName() */
+
+
+/*====================================================================
+*
+* SPxCfar::Apply
+*	Detect on the latest spoke of a stream, in place.
+*
+* Params:
+*	samples			Spoke, first sample at zero range,
+*	numSamples		Number of samples.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Adjacent spokes come from the history of previous spokes; until
+*	there are enough of them the current spoke stands in.  The
+*	history restarts when the spoke length changes.
+*
+*===================================================================*/
+void SPxCfar::Apply(uint8_t *samples, int numSamples)
+{
+    if( (samples == NULL) || (numSamples <= 0) )
+    {
+	return;
+    }
+    if( m_azis == 0 )
+    {
+	const uint8_t *rows[1] = { samples };
+	Detect(samples, rows, samples, numSamples);
+	return;
+    }
+
+    int numHistory = 2 * m_azis;
+    if( numSamples != m_historySamples )
+    {
+	m_history.resize((size_t)numHistory * numSamples);
+	m_current.resize(numSamples);
+	m_historySamples = numSamples;
+	m_historyLen = 0;
+	m_historyNext = 0;
+    }
+
+    /* 검출 전 값을 보관해 두었다가 다음 스포크의 참조로 사용 */
+    memcpy(&m_current[0], samples, numSamples);
+    const uint8_t *rows[(2 * MAX_AZIS) + 1];
+    for(int i = 0; i < numHistory; i++)
+    {
+	/* 오래된 것부터, 부족하면 현재 스포크로 대체 */
+	int age = numHistory - i;
+	if( age <= m_historyLen )
+	{
+	    int slot = (m_historyNext - age + numHistory) % numHistory;
+	    rows[i] = &m_history[(size_t)slot * numSamples];
+	}
+	else
+	{
+	    rows[i] = &m_current[0];
+	}
+    }
+    rows[numHistory] = &m_current[0];
+    Detect(samples, rows, &m_current[0], numSamples);
+
+    memcpy(&m_history[(size_t)m_historyNext * numSamples], &m_current[0], numSamples);
+    m_historyNext = (m_historyNext + 1) % numHistory;
+    if( m_historyLen < numHistory )
+    {
+	m_historyLen++;
+    }
+} /* SPxCfar::Apply() */
+
+
+/*====================================================================
+*
+* SPxCfar::ApplyFrame
+*	Detect on every spoke of a polar frame, in place.
+*
+* Params:
+*	frame			First sample of the first spoke,
+*	numSpokes		Number of spokes,
+*	numSamples		Samples per spoke,
+*	strideBytes		Distance between spokes in bytes,
+*	pool			Threads to split the frame over, or NULL.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Adjacent spokes are clamped at the edges of the frame.  With a
+*	pool the snapshot is copied and then detected in chunks of
+*	spokes, each a separate batch, so no chunk can overwrite a
+*	spoke before its neighbour has copied it.
+*
+*===================================================================*/
+void SPxCfar::ApplyFrame(uint8_t *frame, int numSpokes, int numSamples,
+			 int strideBytes, SPxWorkPool *pool)
+{
+    if( (frame == NULL) || (numSpokes <= 0) || (numSamples <= 0) )
+    {
+	return;
+    }
+    m_runFrame = frame;
+    m_runSpokes = numSpokes;
+    m_runSamples = numSamples;
+    m_runStride = strideBytes;
+
+    if( (pool == NULL) || (pool->GetNumThreads() <= 1) )
+    {
+	if( m_azis > 0 )
+	{
+	    copySpokes(0, numSpokes);
+	}
+	detectSpokes(0, numSpokes, &m_scratch[0]);
+	return;
+    }
+
+    if( m_scratch.size() < pool->GetNumThreads() )
+    {
+	m_scratch.resize(pool->GetNumThreads());
+    }
+    m_runChunk = (int)pool->GetChunkSize((unsigned int)numSpokes, MIN_CHUNK);
+    unsigned int numTasks = (unsigned int)((numSpokes + m_runChunk - 1) / m_runChunk);
+    if( m_azis > 0 )
+    {
+	m_frame.resize((size_t)numSpokes * numSamples);
+	pool->Run(numTasks, copyTask, this);
+    }
+    pool->Run(numTasks, detectTask, this);
+} /* SPxCfar::ApplyFrame() */
+
+
+/*====================================================================
+*
+* SPxCfar::Reset
+*	Forget the previous spokes used by Apply().
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+void SPxCfar::Reset(void)
+{
+    m_historySamples = 0;
+    m_historyLen = 0;
+    m_historyNext = 0;
+} /* SPxCfar::Reset() */
+
+
+/*====================================================================
+*
+* SPxCfar::Detect
+*	Detect one spoke against the given reference spokes.
+*
+* Params:
+*	dst			Output spoke (may be the same as cut),
+*	rows			2 * azis + 1 reference spokes,
+*	cut			Cells under test,
+*	numSamples		Samples per spoke.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+void SPxCfar::Detect(uint8_t *dst, const uint8_t *const *rows,
+		     const uint8_t *cut, int numSamples)
+{
+    if( numSamples <= 0 )
+    {
+	return;
+    }
+    if( m_mode == MODE_CA )
+    {
+	detectCa(dst, rows, cut, numSamples, &m_scratch[0]);
+    }
+    else
+    {
+	detectOs(dst, rows, cut, numSamples, &m_scratch[0]);
+    }
+} /* SPxCfar::Detect() */
+
+
+/*********************************************************************
+*
+*	Private functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* SPxCfar::copySpokes
+*	Copy spokes of the frame being processed into the snapshot.
+*
+* Params:
+*	first, end		Range of spokes.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	The snapshot is sized here for the serial case; the parallel
+*	copy sizes it before starting the batch.
+*
+*===================================================================*/
+void SPxCfar::copySpokes(int first, int end)
+{
+    size_t size = (size_t)m_runSpokes * m_runSamples;
+    if( m_frame.size() != size )
+    {
+	m_frame.resize(size);
+    }
+    for(int a = first; a < end; a++)
+    {
+	memcpy(&m_frame[(size_t)a * m_runSamples],
+	       m_runFrame + ((size_t)a * m_runStride), m_runSamples);
+    }
+} /* SPxCfar::copySpokes() */
+
+
+/*====================================================================
+*
+* SPxCfar::detectSpokes
+*	Detect spokes of the frame being processed.
+*
+* Params:
+*	first, end		Range of spokes,
+*	scratch			Buffers of the calling worker.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Adjacent spokes, including those beyond the range, are read
+*	from the snapshot, which must already hold the whole frame.
+*
+*===================================================================*/
+void SPxCfar::detectSpokes(int first, int end, Scratch *scratch)
+{
+    const uint8_t *rows[(2 * MAX_AZIS) + 1];
+    for(int a = first; a < end; a++)
+    {
+	uint8_t *spoke = m_runFrame + ((size_t)a * m_runStride);
+	if( m_azis == 0 )
+	{
+	    rows[0] = spoke;
+	}
+	else
+	{
+	    for(int d = -m_azis; d <= m_azis; d++)
+	    {
+		int r = a + d;
+		r = (r < 0) ? 0 : ((r >= m_runSpokes) ? (m_runSpokes - 1) : r);
+		rows[d + m_azis] = &m_frame[(size_t)r * m_runSamples];
+	    }
+	}
+	if( m_mode == MODE_CA )
+	{
+	    detectCa(spoke, rows, rows[m_azis], m_runSamples, scratch);
+	}
+	else
+	{
+	    detectOs(spoke, rows, rows[m_azis], m_runSamples, scratch);
+	}
+    }
+} /* SPxCfar::detectSpokes() */
+
+/*====================================================================
+*
+* SPxCfar::detectCa
+*	Cell averaging detection.
+*
+* Params:
+*	As for Detect().
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Reference sums come from a prefix sum over the edge-padded sum
+*	of the reference spokes, so each cell costs four loads whatever
+*	the window size.  Sums stay below 2^32 (see the limits above).
+*
+*===================================================================*/
+void SPxCfar::detectCa(uint8_t *dst, const uint8_t *const *rows,
+		       const uint8_t *cut, int numSamples, Scratch *scratch)
+{
+    int numRows = (2 * m_azis) + 1;
+    int half = m_guard + m_ref;
+
+    std::vector<uint16_t> &colSum = scratch->colSum;
+    colSum.assign(numSamples, 0);
+    for(int r = 0; r < numRows; r++)
+    {
+#ifdef SPX_CFAR_X86
+	if( m_simd )
+	{
+	    colSumAvx2(&colSum[0], rows[r], numSamples);
+	    continue;
+	}
+#endif
+	colSumScalar(&colSum[0], rows[r], 0, numSamples);
+    }
+
+    /* prefix[j] = 패딩된 열 합의 앞쪽 j 개 합 */
+    size_t size = (size_t)numSamples + (2 * half) + 1;
+    scratch->prefix.resize(size);
+    uint32_t *p = &scratch->prefix[0];
+    p[0] = 0;
+    for(int j = 0; j < numSamples + (2 * half); j++)
+    {
+	int g = j - half;
+	g = (g < 0) ? 0 : ((g >= numSamples) ? (numSamples - 1) : g);
+	p[j + 1] = p[j] + colSum[g];
+    }
+
+    uint32_t cutScale = (uint32_t)GetNumRefCells() * 256;
+#ifdef SPX_CFAR_X86
+    if( m_simd )
+    {
+	caAvx2(dst, cut, p, numSamples, m_guard, m_ref, cutScale, m_scaleQ8, m_binary);
+	return;
+    }
+#endif
+    caScalar(dst, cut, p, 0, numSamples, m_guard, m_ref, cutScale, m_scaleQ8, m_binary);
+} /* SPxCfar::detectCa() */
+
+
+/*====================================================================
+*
+* SPxCfar::detectOs
+*	Ordered statistic detection.
+*
+* Params:
+*	As for Detect().
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	A 256-bin histogram of the reference cells slides along the
+*	spoke (four cells in and out per reference spoke per step) and
+*	the rank is tracked incrementally, so a step costs O(azis) plus
+*	the small movement of the selected level.
+*
+*===================================================================*/
+void SPxCfar::detectOs(uint8_t *dst, const uint8_t *const *rows,
+		       const uint8_t *cut, int numSamples, Scratch *scratch)
+{
+    int numRows = (2 * m_azis) + 1;
+    int half = m_guard + m_ref;
+    int width = numSamples + (2 * half);
+
+    /* 가장자리를 복제해 패딩한 참조 스포크 */
+    std::vector<uint8_t> &padded = scratch->padded;
+    padded.resize((size_t)numRows * width);
+    for(int r = 0; r < numRows; r++)
+    {
+	uint8_t *p = &padded[(size_t)r * width];
+	memset(p, rows[r][0], half);
+	memcpy(p + half, rows[r], numSamples);
+	memset(p + half + numSamples, rows[r][numSamples - 1], half);
+    }
+
+    /* 셀 g 의 참조 구간 (패딩 좌표): [g, g+ref) 와 [g+lagLo, g+lagLo+ref) */
+    int lagLo = (2 * m_guard) + m_ref + 1;
+    unsigned int hist[256];
+    memset(hist, 0, sizeof(hist));
+    for(int r = 0; r < numRows; r++)
+    {
+	const uint8_t *p = &padded[(size_t)r * width];
+	for(int k = 0; k < m_ref; k++)
+	{
+	    hist[p[k]]++;
+	    hist[p[lagLo + k]]++;
+	}
+    }
+
+    unsigned int rank = (unsigned int)GetRank();
+    unsigned int level = 0;
+    unsigned int below = 0;	/* Reference cells below level */
+    for(int g = 0; g < numSamples; g++)
+    {
+	while( below > rank )
+	{
+	    level--;
+	    below -= hist[level];
+	}
+	while( (below + hist[level]) <= rank )
+	{
+	    below += hist[level];
+	    level++;
+	}
+
+	uint8_t v = cut[g];
+	int detect = (((uint32_t)v * 256) > (level * m_scaleQ8));
+	dst[g] = detect ? (m_binary ? 255 : v) : 0;
+
+	if( g + 1 < numSamples )
+	{
+	    for(int r = 0; r < numRows; r++)
+	    {
+		const uint8_t *p = &padded[(size_t)r * width];
+		uint8_t out1 = p[g];
+		uint8_t in1 = p[g + m_ref];
+		uint8_t out2 = p[g + lagLo];
+		uint8_t in2 = p[g + lagLo + m_ref];
+		hist[out1]--;
+		hist[out2]--;
+		hist[in1]++;
+		hist[in2]++;
+		below += (in1 < level) + (in2 < level);
+		below -= (out1 < level) + (out2 < level);
+	    }
+	}
+    }
+} /* SPxCfar::detectOs() */
+
+
+/*====================================================================
+*
+* SPxCfar::copyTask / detectTask
+*	Work pool tasks for ApplyFrame().
+*
+* Params:
+*	userArg			The detector,
+*	taskIdx			Chunk of spokes,
+*	workerIdx		Worker running the task.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+void SPxCfar::copyTask(void *userArg, unsigned int taskIdx,
+		       unsigned int workerIdx)
+{
+    (void)workerIdx;
+    SPxCfar *cfar = (SPxCfar *)userArg;
+    int first = (int)taskIdx * cfar->m_runChunk;
+    int end = first + cfar->m_runChunk;
+    cfar->copySpokes(first, (end < cfar->m_runSpokes) ? end : cfar->m_runSpokes);
+} /* SPxCfar::copyTask() */
+
+void SPxCfar::detectTask(void *userArg, unsigned int taskIdx,
+			 unsigned int workerIdx)
+{
+    SPxCfar *cfar = (SPxCfar *)userArg;
+    int first = (int)taskIdx * cfar->m_runChunk;
+    int end = first + cfar->m_runChunk;
+    cfar->detectSpokes(first, (end < cfar->m_runSpokes) ? end : cfar->m_runSpokes,
+		       &cfar->m_scratch[workerIdx]);
+} /* SPxCfar::detectTask() */
+
+
+/*====================================================================
+*
+* useAvx2
+*	Decide once whether the AVX2 kernels can be used.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Non-zero to use AVX2.
+*
+* Notes
+*	SPX_SIMD=scalar in the environment forces the scalar kernels,
+*	as for SPxFilterChain.
+*
+*===================================================================*/
+static int useAvx2(void)
+{
+    static int avx2 = -1;
+    if( avx2 < 0 )
+    {
+	int ok = 0;
+#ifdef SPX_CFAR_X86
+	__builtin_cpu_init();
+	ok = __builtin_cpu_supports("avx2") ? 1 : 0;
+#endif
+	const char *env = getenv("SPX_SIMD");
+	if( (env != NULL) && (strcmp(env, "scalar") == 0) )
+	{
+	    ok = 0;
+	}
+	avx2 = ok;
+    }
+    return(avx2);
+} /* useAvx2() */
+
+
+/*====================================================================
+*
+* parseInt
+*	Parse a whole field as an integer within limits.
+*
+* Params:
+*	text			Field,
+*	min, max		Allowed range,
+*	value			Set on success.
+*
+* Returns:
+*	Zero on success, -1 on error.
+*
+* Notes
+*
+*===================================================================*/
+static int parseInt(const std::string &text, int min, int max, int *value)
+{
+    char *end = NULL;
+    long v = strtol(text.c_str(), &end, 10);
+    if( text.empty() || (*end != '\0') || (v < min) || (v > max) )
+    {
+	return(-1);
+    }
+    *value = (int)v;
+    return(0);
+} /* parseInt() */
+
+
+/*====================================================================
+*
+* colSum / ca, Scalar and Avx2
+*	Cell averaging kernels.
+*
+* Params:
+*	sum			Column sums to add the row to,
+*	row			Reference spoke,
+*	dst, cut		Output and cells under test,
+*	prefix			Prefix sums (see detectCa()),
+*	start, end		Range of samples (scalar versions),
+*	n			Number of samples (AVX2 versions),
+*	others			Detector parameters.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Detection is cut * N * 256 > sum * scaleQ8, in unsigned 32-bit
+*	arithmetic in both versions.  The AVX2 compare handles 8 cells
+*	per step and the tail goes to the scalar version.
+*
+*===================================================================*/
+static void colSumScalar(uint16_t *sum, const uint8_t *row, int start, int end)
+{
+    for(int i = start; i < end; i++)
+    {
+	sum[i] = (uint16_t)(sum[i] + row[i]);
+    }
+} /* colSumScalar() */
+
+static void caScalar(uint8_t *dst, const uint8_t *cut, const uint32_t *prefix,
+		     int start, int end, int guard, int ref,
+		     uint32_t cutScale, uint32_t scaleQ8, int binary)
+{
+    int lagLo = (2 * guard) + ref + 1;
+    int lagHi = lagLo + ref;
+    for(int i = start; i < end; i++)
+    {
+	uint32_t sum = (prefix[i + ref] - prefix[i])
+	    + (prefix[i + lagHi] - prefix[i + lagLo]);
+	uint8_t v = cut[i];
+	int detect = (((uint32_t)v * cutScale) > (sum * scaleQ8));
+	dst[i] = detect ? (binary ? 255 : v) : 0;
+    }
+} /* caScalar() */
+
+#ifdef SPX_CFAR_X86
+__attribute__((target("avx2")))
+static void colSumAvx2(uint16_t *sum, const uint8_t *row, int n)
+{
+    int i = 0;
+    for(; i + 16 <= n; i += 16)
+    {
+	__m256i s = _mm256_loadu_si256((const __m256i *)(sum + i));
+	__m256i v = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(row + i)));
+	_mm256_storeu_si256((__m256i *)(sum + i), _mm256_add_epi16(s, v));
+    }
+    colSumScalar(sum, row, i, n);
+} /* colSumAvx2() */
+
+__attribute__((target("avx2")))
+static void caAvx2(uint8_t *dst, const uint8_t *cut, const uint32_t *prefix,
+		   int n, int guard, int ref,
+		   uint32_t cutScale, uint32_t scaleQ8, int binary)
+{
+    int lagLo = (2 * guard) + ref + 1;
+    int lagHi = lagLo + ref;
+    const __m256i cs = _mm256_set1_epi32((int)cutScale);
+    const __m256i sq = _mm256_set1_epi32((int)scaleQ8);
+    const __m256i all = _mm256_set1_epi32(255);
+    int i = 0;
+    for(; i + 8 <= n; i += 8)
+    {
+	const uint32_t *p = prefix + i;
+	__m256i lead = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i *)(p + ref)),
+					_mm256_loadu_si256((const __m256i *)(p)));
+	__m256i lag = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i *)(p + lagHi)),
+				       _mm256_loadu_si256((const __m256i *)(p + lagLo)));
+	__m256i rhs = _mm256_mullo_epi32(_mm256_add_epi32(lead, lag), sq);
+	__m256i v = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(cut + i)));
+	__m256i lhs = _mm256_mullo_epi32(v, cs);
+	/* 부호 없는 비교: lhs <= rhs 이면 max(lhs, rhs) == rhs */
+	__m256i miss = _mm256_cmpeq_epi32(_mm256_max_epu32(lhs, rhs), rhs);
+	__m256i out = _mm256_andnot_si256(miss, binary ? all : v);
+	/* 32비트 8개 -> 바이트 8개 (각 128비트 절반의 앞 4바이트) */
+	out = _mm256_packus_epi32(out, out);
+	out = _mm256_packus_epi16(out, out);
+	uint32_t lo = (uint32_t)_mm_cvtsi128_si32(_mm256_castsi256_si128(out));
+	uint32_t hi = (uint32_t)_mm_cvtsi128_si32(_mm256_extracti128_si256(out, 1));
+	memcpy(dst + i, &lo, 4);
+	memcpy(dst + i + 4, &hi, 4);
+    }
+    caScalar(dst, cut, prefix, i, n, guard, ref, cutScale, scaleQ8, binary);
+} /* caAvx2() */
+#endif /* SPX_CFAR_X86 */
+
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
@@ -0,0 +1,147 @@
+/*********************************************************************
+*
+* File: SPxCfar.h
+*
+* Purpose:
+*	Constant false alarm rate (CFAR) detection on 8-bit spokes.
+*
+*	The parameter string is
+*
+*	  <ca|os>,<guard>,<ref>,<scale>[,<azis>][,bin]
+*
+*	For each cell under test the reference cells are the <ref>
+*	cells on each side in range, beyond <guard> guard cells, on
+*	the spoke itself and on <azis> adjacent spokes either side, so
+*	there are N = 2 * ref * (2 * azis + 1) of them.  Spokes are
+*	edge-replicated in range.
+*
+*	  ca - cell averaging: detect when cut * N > scale * sum.
+*	  os - ordered statistic: detect when cut > scale * X, where X
+*	       is the reference cell of rank 3N/4 (0 = smallest).
+*
+*	A detected cell keeps its value (or becomes 255 with "bin",
+*	giving a binary detection plane); all other cells become zero.
+*	The scale is applied in Q8 fixed point and all comparisons are
+*	integer, so every implementation gives bit-exact results.
+*
+*	In a polar frame (ApplyFrame) the adjacent spokes are those
+*	either side, clamped at the first and last spoke.  When spokes
+*	arrive one at a time (Apply) they are the 2 * azis spokes
+*	before the current one.
+*
+*	Given an SPxWorkPool, ApplyFrame splits the frame into chunks
+*	of whole spokes detected in parallel.  Each chunk reads the
+*	azis spokes beyond its edges (its halo) from an undetected
+*	copy of the frame, so the output is the same as serial.
+*
+*	Cell averaging uses prefix sums with AVX2 compares (scalar
+*	fallback, or SPX_SIMD=scalar); the ordered statistic uses a
+*	sliding histogram.  It does not depend on the SPx library.
+*
+**********************************************************************/
+
+#ifndef _SPX_CFAR_H
+#define _SPX_CFAR_H
+
+#include <stdint.h>
+#include <vector>
+
+class SPxWorkPool;
+
+class SPxCfar
+{
+public:
+    /* Detector types. */
+    enum Mode
+    {
+	MODE_CA,
+	MODE_OS
+    };
+
+    /* Constructor/destructor. */
+    SPxCfar(void);
+    ~SPxCfar();
+
+    /* Configuration.  Returns zero on success, -1 on a bad string
+     * (the previous settings are kept).
+     */
+    int SetParams(const char *args);
+    Mode GetMode(void) const { return m_mode; }
+    int GetGuard(void) const { return m_guard; }
+    int GetRef(void) const { return m_ref; }
+    unsigned int GetScaleQ8(void) const { return m_scaleQ8; }
+    int GetAzis(void) const { return m_azis; }
+    int GetBinary(void) const { return m_binary; }
+    int GetNumRefCells(void) const { return 2 * m_ref * ((2 * m_azis) + 1); }
+    int GetRank(void) const { return (3 * GetNumRefCells()) / 4; }
+
+    /* Use the AVX2 kernels if the CPU has them (default), or not. */
+    void SetSimd(int enable);
+    static const char *GetSimdName(void);
+
+    /* Detection, in place. */
+    void Apply(uint8_t *samples, int numSamples);
+    void ApplyFrame(uint8_t *frame, int numSpokes, int numSamples,
+		    int strideBytes, SPxWorkPool *pool = NULL);
+    void Reset(void);
+
+    /* Detect one spoke.  rows[] holds the 2 * azis + 1 spokes the
+     * reference cells come from, cut the cells under test; dst may
+     * be the same as cut but not as any of the rows.
+     */
+    void Detect(uint8_t *dst, const uint8_t *const *rows,
+		const uint8_t *cut, int numSamples);
+
+private:
+    Mode m_mode;
+    int m_guard;
+    int m_ref;
+    unsigned int m_scaleQ8;
+    int m_azis;
+    int m_binary;
+    int m_simd;
+
+    /* Previous spokes for Apply() (ring of 2 * azis). */
+    std::vector<uint8_t> m_history;
+    std::vector<uint8_t> m_current;
+    int m_historySamples;
+    int m_historyLen;
+    int m_historyNext;
+
+    /* Scratch buffers, one set per pool worker. */
+    struct Scratch
+    {
+	std::vector<uint8_t> padded;
+	std::vector<uint16_t> colSum;
+	std::vector<uint32_t> prefix;
+    };
+    std::vector<Scratch> m_scratch;
+    std::vector<uint8_t> m_frame;
+
+    /* Frame being processed by ApplyFrame(). */
+    uint8_t *m_runFrame;
+    int m_runSpokes;
+    int m_runSamples;
+    int m_runStride;
+    int m_runChunk;		/* Spokes per task */
+
+    /* Private functions. */
+    void copySpokes(int first, int end);
+    void detectSpokes(int first, int end, Scratch *scratch);
+    void detectCa(uint8_t *dst, const uint8_t *const *rows,
+		  const uint8_t *cut, int numSamples, Scratch *scratch);
+    void detectOs(uint8_t *dst, const uint8_t *const *rows,
+		  const uint8_t *cut, int numSamples, Scratch *scratch);
+    static void copyTask(void *userArg, unsigned int taskIdx,
+			 unsigned int workerIdx);
+    static void detectTask(void *userArg, unsigned int taskIdx,
+			   unsigned int workerIdx);
+};
+
+#endif /* _SPX_CFAR_H */
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
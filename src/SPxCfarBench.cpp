@@ -0,0 +1,415 @@
+/*********************************************************************
+*
+* File: SPxCfarBench.cpp
+*
+* Purpose:
+*	Speed and bit-exactness check of the CFAR detector (SPxCfar)
+*	against a naive reference that gathers and sorts the reference
+*	cells of every cell under test.
+*
+*	For each detector setting a synthetic polar frame is detected by
+*	the naive reference, the scalar kernels and the AVX2 kernels
+*	(when available), both as a whole frame and spoke by spoke as
+*	in the streamers.  Any cell that differs from the reference is
+*	counted as a mismatch.
+*
+*	The program does not need the SPx library.
+*
+*	Run the program with "-?" as the command line option to get a help
+*	message.
+*
+**********************************************************************/
+
+/* Standard headers. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+
+/* Our own headers. */
+#include "SPxCfar.h"
+
+/*
+ * Constants.
+ */
+#define	USAGE "Usage:\n\tSPxCfarBench [options]\n"			\
+		"\nOptions:\n"						\
+		"\t-a <spokes>\tSet spokes per frame (default 4096)\n"	\
+		"\t-g <gates>\tSet range gates per spoke (default 1024)\n" \
+		"\t-n <frames>\tSet frames per measurement (default 5)\n" \
+		"\t-p <args>\tMeasure only these CFAR args, e.g.\n"	\
+		"\t\t\t\"os,2,16,3,1\" (default: a standard set)\n"	\
+		"\t-?\t\tPrint usage information.\n\n"
+
+/* Settings measured by default. */
+static const char *DefaultParams[] =
+{
+    "ca,2,16,3",
+    "ca,2,16,3,1",
+    "ca,4,32,2.5,2,bin",
+    "os,2,16,3",
+    "os,2,16,3,1",
+    "os,4,32,2.5,2,bin",
+};
+#define	NUM_DEFAULT_PARAMS	(sizeof(DefaultParams) / sizeof(DefaultParams[0]))
+
+/*
+ * Private function prototypes.
+ */
+static double nowSecs(void);
+static void makeSpoke(uint8_t *samples, int numSamples, unsigned int *seed);
+static void naiveDetect(const SPxCfar *cfar, uint8_t *dst,
+			const uint8_t *const *rows, const uint8_t *cut,
+			int numSamples, std::vector<uint8_t> *cells);
+static void naiveFrame(const SPxCfar *cfar, std::vector<uint8_t> *out,
+		       const std::vector<uint8_t> &in, int numSpokes,
+		       int numSamples, int stream);
+static long long countDiffs(const std::vector<uint8_t> &a,
+			    const std::vector<uint8_t> &b);
+
+
+/*********************************************************************
+*
+*	Public functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* main
+*	Main entry point for the program.
+*
+* Params:
+*	argc, argv		Command line arguments.
+*
+* Returns:
+*	Zero if every result matched the reference, -1 otherwise.
+*
+* Notes
+*
+*===================================================================*/
+int main(int argc, char **argv)
+{
+    int c;
+    int numSpokes = 4096;
+    int numGates = 1024;
+    int numFrames = 5;
+    const char *params = NULL;
+
+    /* Process any command line arguments.  */
+    opterr = 0;
+    while( (c = getopt(argc, argv, "a:g:n:p:?")) != -1 )
+    {
+	switch(c)
+	{
+	    case 'a':	numSpokes = strtol(optarg, NULL, 0);	break;
+	    case 'g':	numGates = strtol(optarg, NULL, 0);	break;
+	    case 'n':	numFrames = strtol(optarg, NULL, 0);	break;
+	    case 'p':	params = optarg;			break;
+	    case '?':	/* fall through */
+	    default:
+		fprintf(stderr, "\n%s", USAGE);
+		exit(-1);
+	}
+    } /* end of for each option */
+
+    if( (numSpokes <= 0) || (numGates <= 0) || (numFrames <= 0) )
+    {
+	fprintf(stderr, "Invalid parameters.\n\n%s", USAGE);
+	exit(-1);
+    }
+
+    std::vector<const char *> paramList;
+    if( params != NULL )
+    {
+	paramList.push_back(params);
+    }
+    else
+    {
+	paramList.assign(DefaultParams, DefaultParams + NUM_DEFAULT_PARAMS);
+    }
+
+    /* 합성 극좌표 프레임 */
+    unsigned int seed = 12345;
+    size_t frameSize = (size_t)numSpokes * numGates;
+    std::vector<uint8_t> input(frameSize);
+    for(int a = 0; a < numSpokes; a++)
+    {
+	makeSpoke(&input[(size_t)a * numGates], numGates, &seed);
+    }
+
+    printf("SPxCfarBench: %d spokes x %d gates, %d frames per measurement, "
+	   "simd = %s\n\n", numSpokes, numGates, numFrames, SPxCfar::GetSimdName());
+    printf("%-20s | naive ms | scalar ms  speedup | simd ms  speedup | "
+	   "detections  mismatches\n", "params");
+
+    long long totalDiffs = 0;
+    std::vector<uint8_t> reference;
+    std::vector<uint8_t> streamReference;
+    std::vector<uint8_t> work(frameSize);
+    for(size_t p = 0; p < paramList.size(); p++)
+    {
+	SPxCfar cfar;
+	if( cfar.SetParams(paramList[p]) != 0 )
+	{
+	    fprintf(stderr, "Invalid CFAR args '%s'.\n", paramList[p]);
+	    exit(-1);
+	}
+
+	/* 기준 결과 (프레임 1회만 측정, 매우 느림) */
+	double start = nowSecs();
+	naiveFrame(&cfar, &reference, input, numSpokes, numGates, 0);
+	double naiveMs = (nowSecs() - start) * 1000.0;
+	naiveFrame(&cfar, &streamReference, input, numSpokes, numGates, 1);
+
+	long long diffs = 0;
+	double ms[2] = { 0.0, 0.0 };
+	for(int simd = 0; simd < 2; simd++)
+	{
+	    cfar.SetSimd(simd);
+	    start = nowSecs();
+	    for(int f = 0; f < numFrames; f++)
+	    {
+		work = input;
+		cfar.ApplyFrame(&work[0], numSpokes, numGates, numGates);
+	    }
+	    ms[simd] = (nowSecs() - start) * 1000.0 / numFrames;
+	    diffs += countDiffs(work, reference);
+
+	    /* 스트리머처럼 스포크 단위로 */
+	    work = input;
+	    cfar.Reset();
+	    for(int a = 0; a < numSpokes; a++)
+	    {
+		cfar.Apply(&work[(size_t)a * numGates], numGates);
+	    }
+	    diffs += countDiffs(work, streamReference);
+	}
+
+	long long detections = 0;
+	for(size_t i = 0; i < frameSize; i++)
+	{
+	    detections += (reference[i] != 0);
+	}
+	printf("%-20s | %8.1f | %9.2f %7.1fx | %7.2f %7.1fx | %10lld  %10lld\n",
+	       paramList[p], naiveMs, ms[0], naiveMs / ms[0],
+	       ms[1], naiveMs / ms[1], detections, diffs);
+	totalDiffs += diffs;
+    }
+
+    printf("\n%s\n", (totalDiffs == 0) ? "All results bit-exact."
+	   : "MISMATCHES against the naive reference.");
+    return( (totalDiffs == 0) ? 0 : -1 );
+} /* main() */
+
+
+/*********************************************************************
+*
+*	Private functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* nowSecs
+*	Get a monotonic time in seconds.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Time in seconds.
+*
+* Notes
+*
+*===================================================================*/
+static double nowSecs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return(ts.tv_sec + (ts.tv_nsec * 1e-9));
+} /* nowSecs() */
+
+
+/*====================================================================
+*
+* makeSpoke
+*	Generate a spoke of noise with clutter and a few targets.
+*
+* Params:
+*	samples			Buffer to fill,
+*	numSamples		Number of samples,
+*	seed			Random number state.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Deterministic, so runs are comparable.
+*
+*===================================================================*/
+static void makeSpoke(uint8_t *samples, int numSamples, unsigned int *seed)
+{
+    for(int g = 0; g < numSamples; g++)
+    {
+	*seed = (*seed * 1103515245u) + 12345u;
+	unsigned int noise = (*seed >> 16) & 0x3F;
+	/* 근거리 클러터와 드문 표적 */
+	unsigned int clutter = (g < numSamples / 8) ? (200 - (g * 160 / (numSamples / 8 + 1))) : 0;
+	unsigned int target = (((*seed >> 8) & 0xFF) == 0) ? 160 : 0;
+	unsigned int v = noise + clutter + target;
+	samples[g] = (uint8_t)((v > 255) ? 255 : v);
+    }
+} /* makeSpoke() */
+
+
+/*====================================================================
+*
+* naiveDetect
+*	Reference detector: gather every reference cell, then sum or
+*	select the ranked cell directly.
+*
+* Params:
+*	cfar			Detector settings,
+*	dst			Output spoke,
+*	rows			2 * azis + 1 reference spokes,
+*	cut			Cells under test,
+*	numSamples		Samples per spoke,
+*	cells			Scratch buffer.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Written from the definition in SPxCfar.h, not from SPxCfar.cpp.
+*
+*===================================================================*/
+static void naiveDetect(const SPxCfar *cfar, uint8_t *dst,
+			const uint8_t *const *rows, const uint8_t *cut,
+			int numSamples, std::vector<uint8_t> *cells)
+{
+    int guard = cfar->GetGuard();
+    int ref = cfar->GetRef();
+    int numRows = (2 * cfar->GetAzis()) + 1;
+    for(int g = 0; g < numSamples; g++)
+    {
+	cells->clear();
+	for(int r = 0; r < numRows; r++)
+	{
+	    for(int k = guard + 1; k <= guard + ref; k++)
+	    {
+		int lead = g - k;
+		int lag = g + k;
+		cells->push_back(rows[r][(lead < 0) ? 0 : lead]);
+		cells->push_back(rows[r][(lag >= numSamples) ? (numSamples - 1) : lag]);
+	    }
+	}
+
+	uint64_t v = cut[g];
+	int detect;
+	if( cfar->GetMode() == SPxCfar::MODE_CA )
+	{
+	    uint64_t sum = 0;
+	    for(size_t i = 0; i < cells->size(); i++)
+	    {
+		sum += (*cells)[i];
+	    }
+	    detect = ((v * cells->size() * 256) > (sum * cfar->GetScaleQ8()));
+	}
+	else
+	{
+	    std::vector<uint8_t>::iterator k = cells->begin() + cfar->GetRank();
+	    std::nth_element(cells->begin(), k, cells->end());
+	    detect = ((v * 256) > ((uint64_t)*k * cfar->GetScaleQ8()));
+	}
+	dst[g] = detect ? (cfar->GetBinary() ? 255 : (uint8_t)v) : 0;
+    }
+} /* naiveDetect() */
+
+
+/*====================================================================
+*
+* naiveFrame
+*	Run the reference detector over a frame.
+*
+* Params:
+*	cfar			Detector settings,
+*	out			Output frame,
+*	in			Input frame,
+*	numSpokes		Number of spokes,
+*	numSamples		Samples per spoke,
+*	stream			Zero for frame neighbours (either side,
+*				clamped), non-zero for stream neighbours
+*				(previous spokes, the current spoke
+*				standing in for missing ones).
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+static void naiveFrame(const SPxCfar *cfar, std::vector<uint8_t> *out,
+		       const std::vector<uint8_t> &in, int numSpokes,
+		       int numSamples, int stream)
+{
+    int azis = cfar->GetAzis();
+    std::vector<const uint8_t *> rows((2 * azis) + 1);
+    std::vector<uint8_t> cells;
+    out->resize(in.size());
+    for(int a = 0; a < numSpokes; a++)
+    {
+	for(int d = 0; d <= 2 * azis; d++)
+	{
+	    int r = stream ? (a - (2 * azis) + d) : (a - azis + d);
+	    if( r < 0 )
+	    {
+		r = stream ? a : 0;
+	    }
+	    if( r >= numSpokes )
+	    {
+		r = numSpokes - 1;
+	    }
+	    rows[d] = &in[(size_t)r * numSamples];
+	}
+	naiveDetect(cfar, &(*out)[(size_t)a * numSamples], &rows[0],
+		    &in[(size_t)a * numSamples], numSamples, &cells);
+    }
+} /* naiveFrame() */
+
+
+/*====================================================================
+*
+* countDiffs
+*	Count differing bytes.
+*
+* Params:
+*	a, b			Frames of the same size.
+*
+* Returns:
+*	Number of differences.
+*
+* Notes
+*
+*===================================================================*/
+static long long countDiffs(const std::vector<uint8_t> &a,
+			    const std::vector<uint8_t> &b)
+{
+    long long n = 0;
+    for(size_t i = 0; i < a.size(); i++)
+    {
+	n += (a[i] != b[i]);
+    }
+    return(n);
+} /* countDiffs() */
+
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
@@ -0,0 +1,726 @@
+/*********************************************************************
+*
+* File: SPxClutterMap.cpp
+*
+* Purpose:
+*	Adaptive per-cell clutter map (see SPxClutterMap.h).
+*
+**********************************************************************/
+
+/* Standard headers. */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define	SPX_CLUTTER_X86	1
+#include <immintrin.h>
+#endif
+
+/* Our own header. */
+#include "SPxClutterMap.h"
+
+/* Other headers. */
+#include "SPxWorkPool.h"
+
+/*
+ * Constants.
+ */
+#define	MAX_SHIFT	12
+#define	MAX_AZIS	65536
+#define	MAX_GATES	(1 << 20)
+#define	MIN_CHUNK	16	/* Bin updates per parallel task */
+
+/* Bins skipped between two spokes up to this fraction of a turn are
+ * learnt from the later spoke, as in SPxScanIntegrator.
+ */
+#define	MAX_GAP_DIVISOR	32
+
+/* File header. */
+static const char FileMagic[8] = { 'S', 'P', 'X', 'C', 'M', 'A', 'P', '1' };
+
+/*
+ * Private function prototypes.
+ */
+static int useAvx2(void);
+static void updateScalar(uint16_t *bg, const uint8_t *samples, uint8_t *out,
+			 int start, int end, int shift, int offset, int thresh);
+#ifdef SPX_CLUTTER_X86
+static void updateAvx2(uint16_t *bg, const uint8_t *samples, uint8_t *out,
+		       int n, int shift, int offset, int thresh);
+#endif
+
+
+/*********************************************************************
+*
+*	Public functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* SPxClutterMap::SPxClutterMap
+*	Constructor, defaults to "sub,4,0".
+*
+* Params:
+*	numAzis			Azimuth bins per turn,
+*	numGates		Range gates per bin.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+SPxClutterMap::SPxClutterMap(int numAzis, int numGates)
+    : m_numAzis((numAzis > 0) ? numAzis : 1),
+      m_numGates((numGates > 0) ? numGates : 1),
+      m_mode(MODE_SUB), m_shift(4), m_offset(0), m_simd(useAvx2()),
+      m_lastBin(-1), m_runFrame(NULL), m_runStride(0), m_runNum(0)
+{
+    m_map.assign((size_t)m_numAzis * m_numGates, 0);
+    m_seeded.assign(m_numAzis, 0);
+} /* SPxClutterMap::SPxClutterMap() */
+
+
+/*====================================================================
+*
+* SPxClutterMap::~SPxClutterMap
+*	Destructor.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+SPxClutterMap::~SPxClutterMap()
+{
+} /* SPxClutterMap::~SPxClutterMap() */
+
+
+/*====================================================================
+*
+* SPxClutterMap::SetParams
+*	Configure the clutter map.
+*
+* Params:
+*	args			"sub,<shift>[,<offset>]" or
+*				"thresh,<shift>[,<offset>]".
+*
+* Returns:
+*	Zero on success, -1 if the string is invalid.
+*
+* Notes
+*
+*===================================================================*/
+int SPxClutterMap::SetParams(const char *args)
+{
+    std::vector<long> values;
+    std::string text = (args != NULL) ? args : "";
+    size_t comma = text.find(',');
+    std::string name = text.substr(0, comma);
+    while( comma != std::string::npos )
+    {
+	size_t start = comma + 1;
+	comma = text.find(',', start);
+	std::string field = text.substr(start, (comma == std::string::npos)
+					? std::string::npos : comma - start);
+	char *end = NULL;
+	long v = strtol(field.c_str(), &end, 10);
+	if( field.empty() || (*end != '\0') )
+	{
+	    return(-1);
+	}
+	values.push_back(v);
+    }
+
+    Mode mode;
+    if( name == "sub" )
+    {
+	mode = MODE_SUB;
+    }
+    else if( name == "thresh" )
+    {
+	mode = MODE_THRESH;
+    }
+    else
+    {
+	return(-1);
+    }
+    if( (values.size() < 1) || (values.size() > 2)
+	|| (values[0] < 1) || (values[0] > MAX_SHIFT) )
+    {
+	return(-1);
+    }
+    if( (values.size() > 1) && ((values[1] < 0) || (values[1] > 255)) )
+    {
+	return(-1);
+    }
+
+    m_mode = mode;
+    m_shift = (int)values[0];
+    m_offset = (values.size() > 1) ? (int)values[1] : 0;
+    return(0);
+} /* SPxClutterMap::SetParams() */
+
+
+/*====================================================================
+*
+* SPxClutterMap::SetSimd
+*	Enable or disable the AVX2 kernel.
+*
+* Params:
+*	enable			Non-zero to use AVX2 when the CPU has it.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	For benchmarks; the results are the same either way.
+*
+*===================================================================*/
+void SPxClutterMap::SetSimd(int enable)
+{
+    m_simd = enable ? useAvx2() : 0;
+} /* SPxClutterMap::SetSimd() */
+
+
+/*====================================================================
+*
+* SPxClutterMap::Apply
+*	Suppress clutter on a spoke and update the background.
+*
+* Params:
+*	azDegrees		Azimuth, degrees clockwise from north,
+*	samples			Samples, first at zero range, changed
+*				in place,
+*	numSamples		Number of samples.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Costs O(gates) per spoke.  Small gaps since the previous spoke
+*	are learnt from this spoke too, so that jitter in the spoke
+*	azimuths does not leave bins without an estimate.
+*
+*===================================================================*/
+void SPxClutterMap::Apply(double azDegrees, uint8_t *samples, int numSamples)
+{
+    if( (samples == NULL) || (numSamples <= 0) )
+    {
+	return;
+    }
+    int num = std::min(numSamples, m_numGates);
+
+    int bin = getBin(azDegrees);
+    if( m_lastBin >= 0 )
+    {
+	int gap = (bin - m_lastBin + m_numAzis) % m_numAzis;
+	if( (gap > 1) && (gap <= (m_numAzis / MAX_GAP_DIVISOR)) )
+	{
+	    for(int b = (m_lastBin + 1) % m_numAzis; b != bin; b = (b + 1) % m_numAzis)
+	    {
+		updateBin(b, samples, num, NULL);
+	    }
+	}
+    }
+    m_lastBin = bin;
+
+    /* 출력은 이번 스포크를 더하기 전의 배경과 비교 */
+    updateBin(bin, samples, num, samples);
+} /* SPxClutterMap::Apply() */
+
+
+/*====================================================================
+*
+* SPxClutterMap::ApplyFrame
+*	Apply() a batch of spokes, optionally in parallel.
+*
+* Params:
+*	azDegrees		Azimuth of each spoke, degrees,
+*	frame			First sample of the first spoke,
+*	numSpokes		Number of spokes, in arrival order,
+*	numSamples		Samples per spoke,
+*	strideBytes		Distance between spokes in bytes,
+*	pool			Threads to split the batch over, or NULL.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	The bin updates (gap fills included) are listed first, exactly
+*	as Apply() would make them, then sorted by bin keeping their
+*	order and cut into tasks at bin boundaries.  A batch spanning
+*	few bins gives few tasks.
+*
+*===================================================================*/
+void SPxClutterMap::ApplyFrame(const double *azDegrees, uint8_t *frame,
+			       int numSpokes, int numSamples, int strideBytes,
+			       SPxWorkPool *pool)
+{
+    if( (azDegrees == NULL) || (frame == NULL) || (numSpokes <= 0)
+	|| (numSamples <= 0) )
+    {
+	return;
+    }
+    if( (pool == NULL) || (pool->GetNumThreads() <= 1) )
+    {
+	for(int s = 0; s < numSpokes; s++)
+	{
+	    Apply(azDegrees[s], frame + ((size_t)s * strideBytes), numSamples);
+	}
+	return;
+    }
+    int num = std::min(numSamples, m_numGates);
+
+    m_updates.clear();
+    for(int s = 0; s < numSpokes; s++)
+    {
+	Update update;
+	update.spoke = s;
+	update.output = 0;
+
+	int bin = getBin(azDegrees[s]);
+	if( m_lastBin >= 0 )
+	{
+	    int gap = (bin - m_lastBin + m_numAzis) % m_numAzis;
+	    if( (gap > 1) && (gap <= (m_numAzis / MAX_GAP_DIVISOR)) )
+	    {
+		for(int b = (m_lastBin + 1) % m_numAzis; b != bin; b = (b + 1) % m_numAzis)
+		{
+		    update.bin = b;
+		    m_updates.push_back(update);
+		}
+	    }
+	}
+	m_lastBin = bin;
+	update.bin = bin;
+	update.output = 1;
+	m_updates.push_back(update);
+    }
+    std::stable_sort(m_updates.begin(), m_updates.end(), binBefore);
+
+    /* 빈 경계에서만 나눔 (같은 빈의 갱신은 한 작업이 순서대로) */
+    size_t chunk = pool->GetChunkSize((unsigned int)m_updates.size(), MIN_CHUNK);
+    m_taskStart.clear();
+    m_taskStart.push_back(0);
+    for(size_t i = chunk; i < m_updates.size(); i++)
+    {
+	if( (m_updates[i].bin != m_updates[i - 1].bin)
+	    && (i - m_taskStart.back() >= chunk) )
+	{
+	    m_taskStart.push_back(i);
+	}
+    }
+    m_taskStart.push_back(m_updates.size());
+
+    /* 갭 채우기가 다른 작업에서 출력보다 늦게 읽을 수 있으므로 사본 사용 */
+    m_input.resize((size_t)numSpokes * num);
+    for(int s = 0; s < numSpokes; s++)
+    {
+	memcpy(&m_input[(size_t)s * num], frame + ((size_t)s * strideBytes), num);
+    }
+    m_runFrame = frame;
+    m_runStride = strideBytes;
+    m_runNum = num;
+    pool->Run((unsigned int)(m_taskStart.size() - 1), binTask, this);
+} /* SPxClutterMap::ApplyFrame() */
+
+
+/*====================================================================
+*
+* SPxClutterMap::Save
+*	Write the map to a file.
+*
+* Params:
+*	filename		File to write.
+*
+* Returns:
+*	Zero on success, -1 on error.
+*
+* Notes
+*	The map is written to a temporary file which is then renamed,
+*	so a crash never leaves a partial map behind.
+*
+*===================================================================*/
+int SPxClutterMap::Save(const char *filename) const
+{
+    if( filename == NULL )
+    {
+	return(-1);
+    }
+    std::string tmpName = std::string(filename) + ".tmp";
+    FILE *fp = fopen(tmpName.c_str(), "wb");
+    if( fp == NULL )
+    {
+	return(-1);
+    }
+
+    int32_t dims[2] = { m_numAzis, m_numGates };
+    int ok = (fwrite(FileMagic, sizeof(FileMagic), 1, fp) == 1)
+	&& (fwrite(dims, sizeof(dims), 1, fp) == 1)
+	&& (fwrite(&m_seeded[0], m_seeded.size(), 1, fp) == 1)
+	&& (fwrite(&m_map[0], m_map.size() * sizeof(uint16_t), 1, fp) == 1);
+    ok = (fclose(fp) == 0) && ok;
+
+    if( !ok || (rename(tmpName.c_str(), filename) != 0) )
+    {
+	remove(tmpName.c_str());
+	return(-1);
+    }
+    return(0);
+} /* SPxClutterMap::Save() */
+
+
+/*====================================================================
+*
+* SPxClutterMap::Load
+*	Read a map written by Save().
+*
+* Params:
+*	filename		File to read.
+*
+* Returns:
+*	Zero on success, -1 on error (the map is unchanged).
+*
+* Notes
+*	The grid takes the size stored in the file.  The parameters
+*	are not stored and are left as they are.
+*
+*===================================================================*/
+int SPxClutterMap::Load(const char *filename)
+{
+    FILE *fp = (filename != NULL) ? fopen(filename, "rb") : NULL;
+    if( fp == NULL )
+    {
+	return(-1);
+    }
+
+    char magic[sizeof(FileMagic)];
+    int32_t dims[2];
+    int ok = (fread(magic, sizeof(magic), 1, fp) == 1)
+	&& (memcmp(magic, FileMagic, sizeof(magic)) == 0)
+	&& (fread(dims, sizeof(dims), 1, fp) == 1)
+	&& (dims[0] > 0) && (dims[0] <= MAX_AZIS)
+	&& (dims[1] > 0) && (dims[1] <= MAX_GATES);
+
+    std::vector<uint8_t> seeded;
+    std::vector<uint16_t> map;
+    if( ok )
+    {
+	seeded.resize(dims[0]);
+	map.resize((size_t)dims[0] * dims[1]);
+	ok = (fread(&seeded[0], seeded.size(), 1, fp) == 1)
+	    && (fread(&map[0], map.size() * sizeof(uint16_t), 1, fp) == 1)
+	    && (fgetc(fp) == EOF);
+    }
+    fclose(fp);
+    if( !ok )
+    {
+	return(-1);
+    }
+
+    m_numAzis = dims[0];
+    m_numGates = dims[1];
+    m_seeded.swap(seeded);
+    m_map.swap(map);
+    m_lastBin = -1;
+    return(0);
+} /* SPxClutterMap::Load() */
+
+
+/*====================================================================
+*
+* SPxClutterMap::Reset
+*	Forget the background.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+void SPxClutterMap::Reset(void)
+{
+    std::fill(m_map.begin(), m_map.end(), 0);
+    std::fill(m_seeded.begin(), m_seeded.end(), 0);
+    m_lastBin = -1;
+} /* SPxClutterMap::Reset() */
+
+
+/*********************************************************************
+*
+*	Private functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* SPxClutterMap::getBin
+*	Find the bin for an azimuth.
+*
+* Params:
+*	azDegrees		Azimuth, degrees clockwise from north.
+*
+* Returns:
+*	Bin, 0 to numAzis - 1.
+*
+* Notes
+*
+*===================================================================*/
+int SPxClutterMap::getBin(double azDegrees) const
+{
+    double turns = azDegrees / 360.0;
+    turns -= floor(turns);
+    int bin = (int)(turns * m_numAzis);
+    return( (bin >= m_numAzis) ? (m_numAzis - 1) : bin );
+} /* SPxClutterMap::getBin() */
+
+
+/*====================================================================
+*
+* SPxClutterMap::updateBin
+*	Compare a spoke with one bin's background and update it.
+*
+* Params:
+*	bin			Bin,
+*	samples			Samples,
+*	num			Number of samples, at most numGates,
+*	out			Output (may be samples), or NULL to only
+*				update the background.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	A bin's first spoke becomes its background as it is.
+*
+*===================================================================*/
+void SPxClutterMap::updateBin(int bin, const uint8_t *samples, int num, uint8_t *out)
+{
+    uint16_t *bg = &m_map[(size_t)bin * m_numGates];
+    int thresh = (m_mode == MODE_THRESH);
+
+    if( !m_seeded[bin] )
+    {
+	/* 처음 본 빈: 배경 0 과 비교하고 스포크로 초기화 (out 은 samples 일 수 있음) */
+	int level = std::min(m_offset, 255);
+	for(int g = 0; g < num; g++)
+	{
+	    int v = samples[g];
+	    bg[g] = (uint16_t)(v << 8);
+	    if( out != NULL )
+	    {
+		out[g] = (uint8_t)((v > level) ? (thresh ? v : (v - level)) : 0);
+	    }
+	}
+	m_seeded[bin] = 1;
+	return;
+    }
+
+#ifdef SPX_CLUTTER_X86
+    if( m_simd )
+    {
+	updateAvx2(bg, samples, out, num, m_shift, m_offset, thresh);
+	return;
+    }
+#endif
+    updateScalar(bg, samples, out, 0, num, m_shift, m_offset, thresh);
+} /* SPxClutterMap::updateBin() */
+
+
+/*====================================================================
+*
+* SPxClutterMap::binTask
+*	Work pool task for ApplyFrame().
+*
+* Params:
+*	userArg			The map,
+*	taskIdx			Group of bins,
+*	workerIdx		Worker running the task (unused).
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+void SPxClutterMap::binTask(void *userArg, unsigned int taskIdx,
+			    unsigned int workerIdx)
+{
+    (void)workerIdx;
+    SPxClutterMap *map = (SPxClutterMap *)userArg;
+    for(size_t i = map->m_taskStart[taskIdx]; i < map->m_taskStart[taskIdx + 1]; i++)
+    {
+	const Update *update = &map->m_updates[i];
+	uint8_t *out = update->output
+	    ? map->m_runFrame + ((size_t)update->spoke * map->m_runStride) : NULL;
+	map->updateBin(update->bin, &map->m_input[(size_t)update->spoke * map->m_runNum],
+		       map->m_runNum, out);
+    }
+} /* SPxClutterMap::binTask() */
+
+
+/*====================================================================
+*
+* SPxClutterMap::binBefore
+*	Order bin updates by bin.
+*
+* Params:
+*	a, b			Updates to compare.
+*
+* Returns:
+*	True if a's bin is before b's.
+*
+* Notes
+*
+*===================================================================*/
+bool SPxClutterMap::binBefore(const Update &a, const Update &b)
+{
+    return(a.bin < b.bin);
+} /* SPxClutterMap::binBefore() */
+
+
+/*====================================================================
+*
+* useAvx2
+*	Decide once whether the AVX2 kernel can be used.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Non-zero to use AVX2.
+*
+* Notes
+*	SPX_SIMD=scalar in the environment forces the scalar kernel,
+*	as for SPxFilterChain.
+*
+*===================================================================*/
+static int useAvx2(void)
+{
+    static int avx2 = -1;
+    if( avx2 < 0 )
+    {
+	int ok = 0;
+#ifdef SPX_CLUTTER_X86
+	__builtin_cpu_init();
+	ok = __builtin_cpu_supports("avx2") ? 1 : 0;
+#endif
+	const char *env = getenv("SPX_SIMD");
+	if( (env != NULL) && (strcmp(env, "scalar") == 0) )
+	{
+	    ok = 0;
+	}
+	avx2 = ok;
+    }
+    return(avx2);
+} /* useAvx2() */
+
+
+/*====================================================================
+*
+* update, Scalar and Avx2
+*	Compare samples with the background and update it.
+*
+* Params:
+*	bg			Background, Q8,
+*	samples			Samples,
+*	out			Output (may be samples), or NULL,
+*	start, end		Range of samples (scalar version),
+*	n			Number of samples (AVX2 version),
+*	shift, offset		Parameters,
+*	thresh			Non-zero to threshold, else subtract.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	The update moves bg towards sample * 256 by the difference
+*	shifted right, in unsigned 16-bit arithmetic, so the step is
+*	truncated towards zero in both directions.  The AVX2 version
+*	handles 16 cells per step and the tail goes to the scalar one.
+*
+*===================================================================*/
+static void updateScalar(uint16_t *bg, const uint8_t *samples, uint8_t *out,
+			 int start, int end, int shift, int offset, int thresh)
+{
+    for(int i = start; i < end; i++)
+    {
+	int v = samples[i];
+	int b = bg[i];
+	if( out != NULL )
+	{
+	    int level = std::min((b >> 8) + offset, 255);
+	    if( thresh )
+	    {
+		out[i] = (uint8_t)((v > level) ? v : 0);
+	    }
+	    else
+	    {
+		out[i] = (uint8_t)((v > level) ? (v - level) : 0);
+	    }
+	}
+	int target = v << 8;
+	int up = (target > b) ? ((target - b) >> shift) : 0;
+	int down = (b > target) ? ((b - target) >> shift) : 0;
+	bg[i] = (uint16_t)(b + up - down);
+    }
+} /* updateScalar() */
+
+#ifdef SPX_CLUTTER_X86
+__attribute__((target("avx2")))
+static void updateAvx2(uint16_t *bg, const uint8_t *samples, uint8_t *out,
+		       int n, int shift, int offset, int thresh)
+{
+    const __m256i off = _mm256_set1_epi16((short)offset);
+    const __m256i top = _mm256_set1_epi16(255);
+    const __m128i count = _mm_cvtsi32_si128(shift);
+    int i = 0;
+    for(; i + 16 <= n; i += 16)
+    {
+	__m256i v = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(samples + i)));
+	__m256i b = _mm256_loadu_si256((const __m256i *)(bg + i));
+	if( out != NULL )
+	{
+	    __m256i level = _mm256_min_epu16(_mm256_add_epi16(_mm256_srli_epi16(b, 8), off), top);
+	    __m256i o;
+	    if( thresh )
+	    {
+		o = _mm256_and_si256(v, _mm256_cmpgt_epi16(v, level));
+	    }
+	    else
+	    {
+		o = _mm256_subs_epu16(v, level);
+	    }
+	    /* 16비트 16개 -> 바이트 16개 (128비트 절반마다 묶이므로 재배치) */
+	    o = _mm256_permute4x64_epi64(_mm256_packus_epi16(o, o), 0xD8);
+	    _mm_storeu_si128((__m128i *)(out + i), _mm256_castsi256_si128(o));
+	}
+	__m256i target = _mm256_slli_epi16(v, 8);
+	__m256i up = _mm256_srl_epi16(_mm256_subs_epu16(target, b), count);
+	__m256i down = _mm256_srl_epi16(_mm256_subs_epu16(b, target), count);
+	b = _mm256_sub_epi16(_mm256_add_epi16(b, up), down);
+	_mm256_storeu_si256((__m256i *)(bg + i), b);
+    }
+    updateScalar(bg, samples, out, i, n, shift, offset, thresh);
+} /* updateAvx2() */
+#endif /* SPX_CLUTTER_X86 */
+
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
@@ -0,0 +1,135 @@
+/*********************************************************************
+*
+* File: SPxClutterMap.h
+*
+* Purpose:
+*	Adaptive clutter map: a per-cell background estimate on an
+*	azimuth bin x range gate grid, used to suppress clutter.
+*
+*	Each cell holds an exponential moving average of its samples in
+*	Q8 fixed point:
+*
+*	  bg += (sample * 256 - bg) / 2^shift	(truncated towards zero)
+*
+*	so each spoke updates one bin in constant time.  A bin takes
+*	the first spoke it sees as its starting estimate.
+*
+*	The parameter string is
+*
+*	  sub,<shift>[,<offset>]	Output max(0, sample - bg - offset).
+*	  thresh,<shift>[,<offset>]	Output the sample where it exceeds
+*					bg + offset, else 0.
+*
+*	where bg is the integer part of the estimate before the spoke
+*	is added.  The shift (1..12) sets the time constant: about
+*	2^shift rotations.
+*
+*	A batch of spokes (ApplyFrame) can be split over an SPxWorkPool.
+*	Bins are independent, so each task takes whole bins and runs
+*	their updates in arrival order, reading the spokes from a copy
+*	made before any output is written; the result is the same as
+*	calling Apply() for each spoke in turn.
+*
+*	The map can be saved to and loaded from a file, so a restart
+*	does not need to learn the background again.  Files are raw
+*	host byte order.
+*
+*	Updates use AVX2 when available (SPX_SIMD=scalar forces the
+*	scalar code, with identical results).  The map does not depend
+*	on the SPx library.
+*
+**********************************************************************/
+
+#ifndef _SPX_CLUTTER_MAP_H
+#define _SPX_CLUTTER_MAP_H
+
+#include <stdint.h>
+#include <vector>
+
+class SPxWorkPool;
+
+class SPxClutterMap
+{
+public:
+    /* Output types. */
+    enum Mode
+    {
+	MODE_SUB,
+	MODE_THRESH
+    };
+
+    /* Constructor/destructor. */
+    SPxClutterMap(int numAzis, int numGates);
+    ~SPxClutterMap();
+
+    /* Configuration.  Returns zero on success, -1 on a bad string
+     * (the previous settings are kept).  The map is not cleared.
+     */
+    int SetParams(const char *args);
+    Mode GetMode(void) const { return m_mode; }
+    int GetShift(void) const { return m_shift; }
+    int GetOffset(void) const { return m_offset; }
+    int GetNumAzis(void) const { return m_numAzis; }
+    int GetNumGates(void) const { return m_numGates; }
+
+    /* Use the AVX2 kernels if the CPU has them (default), or not. */
+    void SetSimd(int enable);
+
+    /* Suppress clutter on a spoke in place and learn from it.
+     * Samples beyond the grid's gates pass through unchanged.
+     */
+    void Apply(double azDegrees, uint8_t *samples, int numSamples);
+    void ApplyFrame(const double *azDegrees, uint8_t *frame, int numSpokes,
+		    int numSamples, int strideBytes, SPxWorkPool *pool = NULL);
+
+    /* Persistence, zero on success or -1 on error.  Load() takes its
+     * grid size from the file.
+     */
+    int Save(const char *filename) const;
+    int Load(const char *filename);
+    void Reset(void);
+
+    /* Background estimates, Q8, bins x gates. */
+    const uint16_t *GetMap(void) const { return &m_map[0]; }
+
+private:
+    int m_numAzis;
+    int m_numGates;
+    Mode m_mode;
+    int m_shift;
+    int m_offset;
+    int m_simd;
+    int m_lastBin;
+
+    std::vector<uint16_t> m_map;
+    std::vector<uint8_t> m_seeded;	/* Per bin, non-zero once seen */
+
+    /* Bin update of a batch being processed by ApplyFrame(). */
+    struct Update
+    {
+	int bin;
+	int spoke;
+	int output;		/* Zero for a gap fill */
+    };
+    std::vector<Update> m_updates;	/* Sorted by bin, stable */
+    std::vector<size_t> m_taskStart;	/* First update of each task */
+    std::vector<uint8_t> m_input;	/* Copy of the spokes */
+    uint8_t *m_runFrame;
+    int m_runStride;
+    int m_runNum;
+
+    /* Private functions. */
+    int getBin(double azDegrees) const;
+    void updateBin(int bin, const uint8_t *samples, int num, uint8_t *out);
+    static bool binBefore(const Update &a, const Update &b);
+    static void binTask(void *userArg, unsigned int taskIdx,
+			unsigned int workerIdx);
+};
+
+#endif /* _SPX_CLUTTER_MAP_H */
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
@@ -0,0 +1,498 @@
+/*********************************************************************
+*
+* File: SPxClutterMask.cpp
+*
+* Purpose:
+*	Static clutter mask (see SPxClutterMask.h).
+*
+**********************************************************************/
+
+/* Standard headers. */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define	SPX_MASK_X86	1
+#include <immintrin.h>
+#endif
+
+/* Our own header. */
+#include "SPxClutterMask.h"
+
+/*
+ * Constants.
+ */
+#define	MAX_AZIS	65536
+#define	MAX_GATES	(1 << 20)
+
+/* File header. */
+static const char FileMagic[8] = { 'S', 'P', 'X', 'M', 'A', 'S', 'K', '1' };
+
+/*
+ * Private function prototypes.
+ */
+static int useAvx2(void);
+static void andScalar(uint8_t *s, const uint8_t *m, int start, int end);
+static void gainScalar(uint8_t *s, const uint8_t *m, int start, int end);
+#ifdef SPX_MASK_X86
+static void andAvx2(uint8_t *s, const uint8_t *m, int n);
+static void gainAvx2(uint8_t *s, const uint8_t *m, int n);
+#endif
+
+
+/*********************************************************************
+*
+*	Public functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* SPxClutterMask::SPxClutterMask
+*	Constructor, for an empty mask.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+SPxClutterMask::SPxClutterMask(void)
+    : m_type(TYPE_BITS), m_numAzis(0), m_numGates(0), m_simd(useAvx2())
+{
+} /* SPxClutterMask::SPxClutterMask() */
+
+
+/*====================================================================
+*
+* SPxClutterMask::~SPxClutterMask
+*	Destructor.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+SPxClutterMask::~SPxClutterMask()
+{
+} /* SPxClutterMask::~SPxClutterMask() */
+
+
+/*====================================================================
+*
+* SPxClutterMask::Create
+*	Make a new grid that passes everything.
+*
+* Params:
+*	numAzis			Azimuth bins per turn,
+*	numGates		Range gates per bin,
+*	type			Mask type.
+*
+* Returns:
+*	Zero on success, -1 on a bad size.
+*
+* Notes
+*
+*===================================================================*/
+int SPxClutterMask::Create(int numAzis, int numGates, Type type)
+{
+    if( (numAzis <= 0) || (numAzis > MAX_AZIS)
+	|| (numGates <= 0) || (numGates > MAX_GATES) )
+    {
+	return(-1);
+    }
+    m_type = type;
+    m_numAzis = numAzis;
+    m_numGates = numGates;
+    m_cells.assign((size_t)numAzis * numGates, 255);
+    m_index.clear();
+    return(0);
+} /* SPxClutterMask::Create() */
+
+
+/*====================================================================
+*
+* SPxClutterMask::Save
+*	Write the mask to a file.
+*
+* Params:
+*	filename		File to write.
+*
+* Returns:
+*	Zero on success, -1 on error.
+*
+* Notes
+*	The header is the magic, then bins, gates and type as 32-bit
+*	host order integers.  Bit masks follow at one bit per cell
+*	(bit i % 8 of byte i / 8, set to pass), gain masks at one byte.
+*
+*===================================================================*/
+int SPxClutterMask::Save(const char *filename) const
+{
+    if( (filename == NULL) || m_cells.empty() )
+    {
+	return(-1);
+    }
+    FILE *fp = fopen(filename, "wb");
+    if( fp == NULL )
+    {
+	return(-1);
+    }
+
+    int32_t header[3] = { m_numAzis, m_numGates, (int32_t)m_type };
+    int ok = (fwrite(FileMagic, sizeof(FileMagic), 1, fp) == 1)
+	&& (fwrite(header, sizeof(header), 1, fp) == 1);
+    if( ok && (m_type == TYPE_BITS) )
+    {
+	std::vector<uint8_t> bits((m_cells.size() + 7) / 8, 0);
+	for(size_t i = 0; i < m_cells.size(); i++)
+	{
+	    if( m_cells[i] )
+	    {
+		bits[i >> 3] |= (uint8_t)(1 << (i & 7));
+	    }
+	}
+	ok = (fwrite(&bits[0], bits.size(), 1, fp) == 1);
+    }
+    else if( ok )
+    {
+	ok = (fwrite(&m_cells[0], m_cells.size(), 1, fp) == 1);
+    }
+    ok = (fclose(fp) == 0) && ok;
+    return( ok ? 0 : -1 );
+} /* SPxClutterMask::Save() */
+
+
+/*====================================================================
+*
+* SPxClutterMask::Load
+*	Read a mask written by Save().
+*
+* Params:
+*	filename		File to read.
+*
+* Returns:
+*	Zero on success, -1 on error.
+*
+* Notes
+*
+*===================================================================*/
+int SPxClutterMask::Load(const char *filename)
+{
+    FILE *fp = (filename != NULL) ? fopen(filename, "rb") : NULL;
+    if( fp == NULL )
+    {
+	return(-1);
+    }
+
+    char magic[sizeof(FileMagic)];
+    int32_t header[3];
+    int ok = (fread(magic, sizeof(magic), 1, fp) == 1)
+	&& (memcmp(magic, FileMagic, sizeof(magic)) == 0)
+	&& (fread(header, sizeof(header), 1, fp) == 1)
+	&& (header[0] > 0) && (header[0] <= MAX_AZIS)
+	&& (header[1] > 0) && (header[1] <= MAX_GATES)
+	&& ((header[2] == TYPE_BITS) || (header[2] == TYPE_GAIN));
+
+    std::vector<uint8_t> cells;
+    if( ok )
+    {
+	cells.resize((size_t)header[0] * header[1]);
+	if( header[2] == TYPE_BITS )
+	{
+	    std::vector<uint8_t> bits((cells.size() + 7) / 8);
+	    ok = (fread(&bits[0], bits.size(), 1, fp) == 1);
+	    for(size_t i = 0; ok && (i < cells.size()); i++)
+	    {
+		cells[i] = ((bits[i >> 3] >> (i & 7)) & 1) ? 255 : 0;
+	    }
+	}
+	else
+	{
+	    ok = (fread(&cells[0], cells.size(), 1, fp) == 1);
+	}
+	ok = ok && (fgetc(fp) == EOF);
+    }
+    fclose(fp);
+    if( !ok )
+    {
+	return(-1);
+    }
+
+    m_numAzis = header[0];
+    m_numGates = header[1];
+    m_type = (Type)header[2];
+    m_cells.swap(cells);
+    m_index.clear();
+    return(0);
+} /* SPxClutterMask::Load() */
+
+
+/*====================================================================
+*
+* SPxClutterMask::GetBin
+*	Find the bin for an azimuth.
+*
+* Params:
+*	azDegrees		Azimuth, degrees clockwise from north.
+*
+* Returns:
+*	Bin, 0 to numAzis - 1 (0 if the mask is empty).
+*
+* Notes
+*
+*===================================================================*/
+int SPxClutterMask::GetBin(double azDegrees) const
+{
+    if( m_numAzis <= 0 )
+    {
+	return(0);
+    }
+    double turns = azDegrees / 360.0;
+    turns -= floor(turns);
+    int bin = (int)(turns * m_numAzis);
+    return( (bin >= m_numAzis) ? (m_numAzis - 1) : bin );
+} /* SPxClutterMask::GetBin() */
+
+
+/*====================================================================
+*
+* SPxClutterMask::SetSimd
+*	Enable or disable the AVX2 kernels.
+*
+* Params:
+*	enable			Non-zero to use AVX2 when the CPU has it.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	For benchmarks; the results are the same either way.
+*
+*===================================================================*/
+void SPxClutterMask::SetSimd(int enable)
+{
+    m_simd = enable ? useAvx2() : 0;
+} /* SPxClutterMask::SetSimd() */
+
+
+/*====================================================================
+*
+* SPxClutterMask::Apply
+*	Mask a spoke in place.
+*
+* Params:
+*	azDegrees		Azimuth, degrees clockwise from north,
+*	samples			Samples, first at zero range,
+*	numSamples		Number of samples.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	An empty mask passes everything.  Sample i of a spoke whose
+*	length is not the grid's uses gate i * gates / numSamples.
+*
+*===================================================================*/
+void SPxClutterMask::Apply(double azDegrees, uint8_t *samples, int numSamples)
+{
+    if( m_cells.empty() || (samples == NULL) || (numSamples <= 0) )
+    {
+	return;
+    }
+    const uint8_t *row = GetRow(GetBin(azDegrees));
+
+    if( numSamples == m_numGates )
+    {
+#ifdef SPX_MASK_X86
+	if( m_simd )
+	{
+	    if( m_type == TYPE_BITS )
+	    {
+		andAvx2(samples, row, numSamples);
+	    }
+	    else
+	    {
+		gainAvx2(samples, row, numSamples);
+	    }
+	    return;
+	}
+#endif
+	if( m_type == TYPE_BITS )
+	{
+	    andScalar(samples, row, 0, numSamples);
+	}
+	else
+	{
+	    gainScalar(samples, row, 0, numSamples);
+	}
+	return;
+    }
+
+    /* 길이가 다른 스포크: 샘플별 최근접 게이트 */
+    Prepare(numSamples);
+    for(int i = 0; i < numSamples; i++)
+    {
+	unsigned int m = row[m_index[i]];
+	samples[i] = (uint8_t)((m_type == TYPE_BITS) ? (samples[i] & m)
+			       : ((samples[i] * (m + 1)) >> 8));
+    }
+} /* SPxClutterMask::Apply() */
+
+
+/*====================================================================
+*
+* SPxClutterMask::Prepare
+*	Build the gate table for spokes of a given length.
+*
+* Params:
+*	numSamples		Spoke length.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Nothing to do for the grid's own length or when the table is
+*	already for this length.
+*
+*===================================================================*/
+void SPxClutterMask::Prepare(int numSamples)
+{
+    if( (numSamples <= 0) || (numSamples == m_numGates)
+	|| ((int)m_index.size() == numSamples) )
+    {
+	return;
+    }
+    m_index.resize(numSamples);
+    for(int i = 0; i < numSamples; i++)
+    {
+	m_index[i] = (int)(((int64_t)i * m_numGates) / numSamples);
+    }
+} /* SPxClutterMask::Prepare() */
+
+
+/*********************************************************************
+*
+*	Private functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* useAvx2
+*	Decide once whether the AVX2 kernels can be used.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Non-zero to use AVX2.
+*
+* Notes
+*	SPX_SIMD=scalar in the environment forces the scalar kernels,
+*	as for SPxFilterChain.
+*
+*===================================================================*/
+static int useAvx2(void)
+{
+    static int avx2 = -1;
+    if( avx2 < 0 )
+    {
+	int ok = 0;
+#ifdef SPX_MASK_X86
+	__builtin_cpu_init();
+	ok = __builtin_cpu_supports("avx2") ? 1 : 0;
+#endif
+	const char *env = getenv("SPX_SIMD");
+	if( (env != NULL) && (strcmp(env, "scalar") == 0) )
+	{
+	    ok = 0;
+	}
+	avx2 = ok;
+    }
+    return(avx2);
+} /* useAvx2() */
+
+
+/*====================================================================
+*
+* and / gain, Scalar and Avx2
+*	Apply one mask row to a spoke.
+*
+* Params:
+*	s			Samples, changed in place,
+*	m			Mask row,
+*	start, end		Range of samples (scalar versions),
+*	n			Number of samples (AVX2 versions).
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	The AVX2 versions handle 32 (AND) or 16 (gain) samples per step
+*	and the tail goes to the scalar version.
+*
+*===================================================================*/
+static void andScalar(uint8_t *s, const uint8_t *m, int start, int end)
+{
+    for(int i = start; i < end; i++)
+    {
+	s[i] = (uint8_t)(s[i] & m[i]);
+    }
+} /* andScalar() */
+
+static void gainScalar(uint8_t *s, const uint8_t *m, int start, int end)
+{
+    for(int i = start; i < end; i++)
+    {
+	s[i] = (uint8_t)((s[i] * (m[i] + 1)) >> 8);
+    }
+} /* gainScalar() */
+
+#ifdef SPX_MASK_X86
+__attribute__((target("avx2")))
+static void andAvx2(uint8_t *s, const uint8_t *m, int n)
+{
+    int i = 0;
+    for(; i + 32 <= n; i += 32)
+    {
+	__m256i v = _mm256_loadu_si256((const __m256i *)(s + i));
+	__m256i k = _mm256_loadu_si256((const __m256i *)(m + i));
+	_mm256_storeu_si256((__m256i *)(s + i), _mm256_and_si256(v, k));
+    }
+    andScalar(s, m, i, n);
+} /* andAvx2() */
+
+__attribute__((target("avx2")))
+static void gainAvx2(uint8_t *s, const uint8_t *m, int n)
+{
+    const __m256i one = _mm256_set1_epi16(1);
+    int i = 0;
+    for(; i + 16 <= n; i += 16)
+    {
+	__m256i v = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(s + i)));
+	__m256i k = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(m + i)));
+	__m256i p = _mm256_srli_epi16(_mm256_mullo_epi16(v, _mm256_add_epi16(k, one)), 8);
+	/* 16비트 16개 -> 바이트 16개 (128비트 절반마다 묶이므로 재배치) */
+	p = _mm256_permute4x64_epi64(_mm256_packus_epi16(p, p), 0xD8);
+	_mm_storeu_si128((__m128i *)(s + i), _mm256_castsi256_si128(p));
+    }
+    gainScalar(s, m, i, n);
+} /* gainAvx2() */
+#endif /* SPX_MASK_X86 */
+
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
@@ -0,0 +1,98 @@
+/*********************************************************************
+*
+* File: SPxClutterMask.h
+*
+* Purpose:
+*	Static clutter mask on an azimuth bin x range gate grid, built
+*	offline by SPxMaskBuilder from recorded rotations.
+*
+*	A mask is one of
+*
+*	  bits		A pass/block bit per cell; blocked cells are
+*			zeroed (one AND per sample).
+*	  gain		A gain per cell, 0 (block) to 255 (pass),
+*			applied as (sample * (gain + 1)) >> 8 (one
+*			multiply per sample).
+*
+*	In memory each cell is a byte (0 or 255 for bits), so a spoke
+*	costs a single AVX2 AND or multiply over one row.  On disk bit
+*	masks take one bit per cell.  Spokes whose length differs from
+*	the grid use the nearest gate.
+*
+*	The mask does not depend on the SPx library.
+*
+**********************************************************************/
+
+#ifndef _SPX_CLUTTER_MASK_H
+#define _SPX_CLUTTER_MASK_H
+
+#include <stdint.h>
+#include <vector>
+
+class SPxClutterMask
+{
+public:
+    /* Mask types. */
+    enum Type
+    {
+	TYPE_BITS,
+	TYPE_GAIN
+    };
+
+    /* Constructor/destructor.  The mask starts empty (passes all). */
+    SPxClutterMask(void);
+    ~SPxClutterMask();
+
+    /* Make a grid that passes everything, zero on success or -1 on
+     * a bad size.
+     */
+    int Create(int numAzis, int numGates, Type type);
+
+    /* Persistence, zero on success or -1 on error (Load() leaves the
+     * mask unchanged on error).
+     */
+    int Save(const char *filename) const;
+    int Load(const char *filename);
+
+    /* Information retrieval. */
+    int IsEmpty(void) const { return m_cells.empty(); }
+    Type GetType(void) const { return m_type; }
+    int GetNumAzis(void) const { return m_numAzis; }
+    int GetNumGates(void) const { return m_numGates; }
+    int GetBin(double azDegrees) const;
+
+    /* Cells, bins x gates (0 or 255 for bit masks). */
+    uint8_t *GetCells(void) { return m_cells.empty() ? NULL : &m_cells[0]; }
+    const uint8_t *GetRow(int bin) const
+    {
+	return &m_cells[(size_t)bin * m_numGates];
+    }
+
+    /* Use the AVX2 kernels if the CPU has them (default), or not. */
+    void SetSimd(int enable);
+
+    /* Mask a spoke in place.  Apply() only reads the mask once
+     * Prepare() has been called for the spoke length, so spokes of
+     * that length may then be masked from several threads at once.
+     */
+    void Prepare(int numSamples);
+    void Apply(double azDegrees, uint8_t *samples, int numSamples);
+
+private:
+    Type m_type;
+    int m_numAzis;
+    int m_numGates;
+    int m_simd;
+    std::vector<uint8_t> m_cells;
+
+    /* Gate of each sample for spokes of another length. */
+    std::vector<int> m_index;
+};
+
+#endif /* _SPX_CLUTTER_MASK_H */
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
@@ -28,6 +28,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <vector>
 #ifndef _WIN32
 #include <unistd.h>
 #include <signal.h>
@@ -44,14 +45,68 @@
 #include "SPxLibUtils/SPxGetOpt.h"
 #endif
 
+/* Spoke processing (filters, plugins, integration), plots and tracks,
+ * video republishing and receive telemetry.
+ */
+#include "SPxFilterPlugin.h"
+#include "SPxPlotExtract.h"
+#include "SPxSpokeProcess.h"
+#include "SPxSpokeTelemetry.h"
+#include "SPxTrackOutput.h"
+#include "SPxVideoRepublish.h"
+
 /*
  * Constants.
  */
 #define	USAGE "Usage:\n\tspxfiledatadirect [options] <filename>\n"	\
 		"\nOptions:\n"						\
+		"\t-C <clutter>\tAdaptive clutter map, e.g. \"sub,4,10\"\n"	\
+		"\t-E <extract>\tPlot level[,min samples], e.g. \"100,4\"\n" \
+		"\t-F <filters>\tFilter spokes before output, e.g.\n"	\
+		"\t\t\t\"blank:0-150;stc:400,30;median:3;thresh:40\"\n" \
+		"\t-I <integ>\tIntegrate over rotations, e.g. \"mean,4\",\n" \
+		"\t\t\t\"max,4\" or \"mofn,5,3,40\"\n"		\
+		"\t-L <plugin>\tChain a filter plugin, \"<lib>[:<args>]\",\n"	\
+		"\t\t\te.g. \"./libspxplugin_thresh.so:60,4\"\n"	\
+		"\t-M <file>\tLoad/save the clutter map in this file\n" \
+		"\t-N\t\tNo video output (e.g. for plot extraction only)\n" \
+		"\t-P <file>\tExtract plots to this file (CSV if *.csv)\n" \
+		"\t-R <link>\tRepublish the processed video, may be repeated,\n" \
+		"\t\t\te.g. \"239.192.50.1:5000,zlib,rr=2\" or\n"	\
+		"\t\t\t\"127.0.0.1:5001,cat240\"\n"			\
+		"\t-T <file>\tTrack the plots, reports to this file\n"	\
+		"\t-U <addr:port>\tSend SPx track reports to this address\n" \
 		"\t-v\t\tIncrease verbosity\n"				\
+		"\t-Y <dest>\tWrite replay telemetry lines to \"stderr\" or\n" \
+		"\t\t\t\"<addr>:<port>\" (UDP), e.g. \"stderr,secs=5\"\n" \
 		"\t-?\t\tPrint usage information.\n\n"
 
+/* Azimuth bins per turn for scan-to-scan integration. */
+#define	INTEGRATION_AZIS	4096
+
+/* Azimuth bins per turn for a new clutter map, and how often the map
+ * is saved to its file (as well as on exit), in main loop passes.
+ */
+#define	CLUTTER_AZIS		4096
+#define	CLUTTER_SAVE_PASSES	600	/* 60 seconds */
+
+/* Plot extraction level if -E is not given, and how often plot
+ * statistics are printed, in main loop passes.
+ */
+#define	DEFAULT_PLOT_EXTRACT	"128"
+#define	PLOT_REPORT_PASSES	50	/* 5 seconds */
+
+/* How often filter plugin statistics are printed, in main loop passes. */
+#define	PLUGIN_REPORT_PASSES	50	/* 5 seconds */
+
+/* How often video republish (-R) bandwidth is printed, in main loop
+ * passes.
+ */
+#define	REPUBLISH_REPORT_PASSES	50	/* 5 seconds */
+
+/* Main loop passes per second, for the telemetry (-Y) interval. */
+#define	PASSES_PER_SEC		10
+
 /* Amount of time to sleep on exit, in milliseconds. */
 #ifdef _WIN32
 #define	EXIT_DELAY_TIME	5000	/* To keep console window on screen */
@@ -71,6 +126,13 @@ static void spxErrorHandler(SPxErrorType errType, SPxErrorCode errCode,
 static void handleRadar(SPxRadarReplay *src, void *arg,
 				SPxReturnHeader *hdr, unsigned char *data);
 
+/* Plot, track and plugin statistics. */
+static void reportPlots(SPxPlotExtractor *plots, SPxTrackOutput *tracks);
+static void reportPlugins(SPxFilterPluginChain *plugins);
+static void reportRepublish(std::vector<SPxVideoRepublish *> *links);
+static void reportTelemetry(SPxTelemetryOutput *output,
+				SPxSpokeTelemetry *telemetry);
+
 /* Init/shutdown utility functions. */
 static SPxErrorCode osInit(void);
 #ifdef _WIN32
@@ -89,6 +151,16 @@ static int Verbose = 0;
 /* Exit flag. */
 static int MainLoopFinish = 0;
 
+/* What handleRadar() does with each spoke, given as its user arg. */
+typedef struct
+{
+    SPxSpokeProcess *proc;	/* Spoke processing */
+    SPxPlotExtractor *plots;	/* Plot extraction, or NULL */
+    int video;			/* Non-zero to print spokes */
+    std::vector<SPxVideoRepublish *> links;	/* Video republishing */
+    SPxSpokeTelemetry *telemetry;	/* Replay telemetry, or NULL */
+} StreamContext;
+
 
 /*********************************************************************
 *
@@ -114,6 +186,19 @@ static int MainLoopFinish = 0;
 int main(int argc, char **argv)
 {
     int c;				/* For parsing command line options */
+    const char *filterParams = NULL;	/* Filter chain, NULL for none */
+    const char *integration = NULL;	/* Integration, NULL for none */
+    const char *clutter = NULL;		/* Clutter map, NULL for none */
+    const char *clutterFile = NULL;	/* Clutter map file, or NULL */
+    std::vector<const char *> plugins;	/* Filter plugins, in order */
+    const char *plotExtract = NULL;	/* Plot extraction, NULL for default */
+    const char *plotFile = NULL;	/* Plot file, NULL for none */
+    const char *trackFile = NULL;	/* Track file, NULL for none */
+    const char *trackDest = NULL;	/* Track packet address, or NULL */
+    int video = TRUE;			/* Print spokes to stdout */
+    std::vector<const char *> linkSpecs; /* Video republish links */
+    const char *telemetrySpec = NULL;	/* Telemetry lines, or NULL */
+    int passes = 0;			/* Main loop passes */
 
     /* Initialise operating system specific things. */
     if( osInit() != SPX_NO_ERROR )
@@ -124,11 +209,23 @@ int main(int argc, char **argv)
 
     /* Process any command line arguments.  */
     opterr = 0;
-    while( (c = getopt(argc, argv, "v?")) != -1 )
+    while( (c = getopt(argc, argv, "C:E:F:I:L:M:NP:R:T:U:vY:?")) != -1 )
     {
 	switch(c)
 	{
+	    case 'C':	clutter = optarg;			break;
+	    case 'E':	plotExtract = optarg;			break;
+	    case 'F':	filterParams = optarg;			break;
+	    case 'I':	integration = optarg;			break;
+	    case 'L':	plugins.push_back(optarg);		break;
+	    case 'M':	clutterFile = optarg;			break;
+	    case 'N':	video = FALSE;				break;
+	    case 'P':	plotFile = optarg;			break;
+	    case 'R':	linkSpecs.push_back(optarg);		break;
+	    case 'T':	trackFile = optarg;			break;
+	    case 'U':	trackDest = optarg;			break;
 	    case 'v':	Verbose++;				break;
+	    case 'Y':	telemetrySpec = optarg;			break;
 	    case '?':	/* fall through */
 	    default:
 		fprintf(stderr, "\n%s", USAGE);
@@ -149,6 +246,90 @@ int main(int argc, char **argv)
     }
     const char *filename = argv[optind];
 
+    /*
+     * Set up spoke processing before anything is printed to stdout.
+     */
+    SPxSpokeProcess *proc = new SPxSpokeProcess();
+    if( ((filterParams != NULL) && (proc->SetFilter(filterParams) != 0))
+	|| ((integration != NULL)
+	    && (proc->SetIntegration(integration, INTEGRATION_AZIS) != 0))
+	|| ((clutter != NULL)
+	    && (proc->SetClutterMap(clutter, CLUTTER_AZIS, clutterFile) != 0)) )
+    {
+	fprintf(stderr, "Invalid option: %s.\n", proc->GetError());
+	SPxTimeSleepMsecs(EXIT_DELAY_TIME);
+	exit(-1);
+    }
+    for(size_t i = 0; i < plugins.size(); i++)
+    {
+	if( proc->AddPlugin(plugins[i]) != 0 )
+	{
+	    fprintf(stderr, "Invalid option: %s.\n", proc->GetError());
+	    SPxTimeSleepMsecs(EXIT_DELAY_TIME);
+	    exit(-1);
+	}
+    }
+    if( (clutterFile != NULL) && proc->IsClutterMapLoaded() )
+    {
+	fprintf(stderr, "Loaded clutter map from '%s'.\n", clutterFile);
+    }
+
+    /* Plot extraction and tracking, opening the files now to report
+     * errors.
+     */
+    SPxPlotExtractor *plots = NULL;
+    SPxTrackOutput *tracks = NULL;
+    int tracking = (trackFile != NULL) || (trackDest != NULL);
+    if( (plotFile == NULL) && !tracking && (plotExtract != NULL) )
+    {
+	fprintf(stderr, "Plot extraction (-E) needs a plot file (-P)"
+		" or tracking (-T/-U).\n");
+	SPxTimeSleepMsecs(EXIT_DELAY_TIME);
+	exit(-1);
+    }
+    if( tracking )
+    {
+	tracks = new SPxTrackOutput();
+	if( tracks->Create(trackFile, trackDest) != 0 )
+	{
+	    fprintf(stderr, "Invalid option: %s.\n", tracks->GetError());
+	    SPxTimeSleepMsecs(EXIT_DELAY_TIME);
+	    exit(-1);
+	}
+    }
+    if( (plotFile != NULL) || tracking )
+    {
+	plots = new SPxPlotExtractor();
+	if( plots->Create((plotExtract != NULL) ? plotExtract
+			  : DEFAULT_PLOT_EXTRACT, plotFile) != 0 )
+	{
+	    fprintf(stderr, "Invalid option: %s.\n", plots->GetError());
+	    SPxTimeSleepMsecs(EXIT_DELAY_TIME);
+	    exit(-1);
+	}
+	plots->SetTrackOutput(tracks);
+    }
+    StreamContext context;
+    context.proc = proc;
+    context.plots = plots;
+    context.video = video;
+    context.telemetry = NULL;
+
+    /* Replay telemetry, counted from the spoke headers. */
+    SPxTelemetryOutput *telemetry = NULL;
+    if( telemetrySpec != NULL )
+    {
+	telemetry = new SPxTelemetryOutput();
+	if( telemetry->Create(telemetrySpec) != 0 )
+	{
+	    fprintf(stderr, "Invalid option: %s.\n", telemetry->GetError());
+	    SPxTimeSleepMsecs(EXIT_DELAY_TIME);
+	    exit(-1);
+	}
+	context.telemetry = new SPxSpokeTelemetry();
+	context.telemetry->SetGapFactor(telemetry->GetGapFactor());
+    }
+
     /*
      * Welcome banner.
      */
@@ -169,6 +350,26 @@ int main(int argc, char **argv)
     /* Initialise dongle-based licensing if available. */
     SPxLicInit();
 
+    /* Video republish links (channel 0 is the file). */
+    for(size_t i = 0; i < linkSpecs.size(); i++)
+    {
+	SPxVideoRepublish *link = new SPxVideoRepublish();
+	if( link->Create(linkSpecs[i]) != 0 )
+	{
+	    fprintf(stderr, "Invalid option: %s.\n", link->GetError());
+	    SPxTimeSleepMsecs(EXIT_DELAY_TIME);
+	    exit(-1);
+	}
+	if( link->GetChannel() != 0 )
+	{
+	    fprintf(stderr, "Invalid option: no channel %u for video"
+		    " link '%s'.\n", link->GetChannel(), linkSpecs[i]);
+	    SPxTimeSleepMsecs(EXIT_DELAY_TIME);
+	    exit(-1);
+	}
+	context.links.push_back(link);
+    }
+
     /* Create a file replay object, noting that we do not give
      * it a RIB to write into because we want direct data access.
      */
@@ -182,8 +383,10 @@ int main(int argc, char **argv)
 	exit(-1);
     }
 
-    /* Install a routine to get radar data. (We don't use the user arg). */
-    if( src->InstallDataFn(handleRadar, NULL) != SPX_NO_ERROR )
+    /* Install a routine to get radar data, with the spoke processing
+     * and plot extraction as the user arg.
+     */
+    if( src->InstallDataFn(handleRadar, &context) != SPX_NO_ERROR )
     {
 	fprintf(stderr, "Failed to install radar handler.\n");
 	SPxTimeSleepMsecs(EXIT_DELAY_TIME);
@@ -207,6 +410,41 @@ int main(int argc, char **argv)
 	 * busy wait.
 	 */
 	SPxTimeSleepMsecs(100);
+	passes++;
+
+	/* Save the clutter map now and then, for a quick restart. */
+	if( (clutter != NULL) && (clutterFile != NULL)
+	    && ((passes % CLUTTER_SAVE_PASSES) == 0) )
+	{
+	    proc->SaveClutterMap();
+	}
+
+	/* Report plot extraction now and then. */
+	if( (plots != NULL) && ((passes % PLOT_REPORT_PASSES) == 0) )
+	{
+	    reportPlots(plots, tracks);
+	}
+
+	/* Report filter plugins now and then. */
+	if( (proc->GetPlugins() != NULL)
+	    && ((passes % PLUGIN_REPORT_PASSES) == 0) )
+	{
+	    reportPlugins(proc->GetPlugins());
+	}
+
+	/* Report republish bandwidth now and then. */
+	if( !context.links.empty()
+	    && ((passes % REPUBLISH_REPORT_PASSES) == 0) )
+	{
+	    reportRepublish(&context.links);
+	}
+
+	/* Write telemetry every interval. */
+	if( (telemetry != NULL) && ((passes
+	    % (telemetry->GetReportSecs() * PASSES_PER_SEC)) == 0) )
+	{
+	    reportTelemetry(telemetry, context.telemetry);
+	}
 
 	/* The file replay goes into a paused state when the file finishes
 	 * (because we called SetAutoLoop(FALSE) above), so look for this
@@ -223,6 +461,36 @@ int main(int argc, char **argv)
      * Tidy up.
      */
     delete src;
+    if( !context.links.empty() )
+    {
+	reportRepublish(&context.links);
+    }
+    for(size_t i = 0; i < context.links.size(); i++)
+    {
+	delete context.links[i];
+    }
+    if( telemetry != NULL )
+    {
+	reportTelemetry(telemetry, context.telemetry);
+	delete context.telemetry;
+	delete telemetry;
+    }
+    if( (clutter != NULL) && (clutterFile != NULL)
+	&& (proc->SaveClutterMap() != 0) )
+    {
+	fprintf(stderr, "Failed to save clutter map to '%s'.\n", clutterFile);
+    }
+    if( plots != NULL )
+    {
+	reportPlots(plots, tracks);
+	delete plots;
+    }
+    delete tracks;
+    if( proc->GetPlugins() != NULL )
+    {
+	reportPlugins(proc->GetPlugins());
+    }
+    delete proc;
 
     /* Sleep for a while so the console window doesn't vanish immediately
      * in case this isn't being run inside a console box on windows.
@@ -276,7 +544,7 @@ static void spxErrorHandler(SPxErrorType errType, SPxErrorCode errCode,
 * Params:
 *	src		Pointer to radar source object we are using,
 *	arg		User argument we gave when installing this handler
-*			function (not used in this example),
+*			function (StreamContext),
 *	hdr		Pointer to header structure describing the spoke,
 *	data		Pointer to the radar data for this return.
 *
@@ -291,10 +559,57 @@ static void handleRadar(SPxRadarReplay *src, void *arg,
 {
     static char buffer[4096];
     size_t offset = 0;
+    StreamContext *context = (StreamContext *)arg;
+    SPxSpokeProcess *proc = context->proc;
+
+    if( context->telemetry != NULL )
+    {
+        context->telemetry->Add(hdr);
+    }
     
     /* 방위각을 각도로 변환 (0-65535 -> 0-360도) */
     float azimuthDegrees = (float)hdr->azimuth * 360.0f / 65536.0f;
     
+    unsigned int bps = SPxGetPackingBytesPerSample(hdr->packing);
+
+    unsigned int numSamples = hdr->thisLength;
+
+    /* 처리나 플롯 추출이 설정되어 있으면 8비트 샘플로 변환 후 필터/적분 적용 */
+    const UINT8 *processed = NULL;
+    int num = 0;
+    if( proc->IsActive() || (context->plots != NULL) )
+    {
+        processed = proc->Process(azimuthDegrees, data, (int)bps,
+                                  (int)numSamples, &num, hdr->startRange,
+                                  hdr->endRange, hdr);
+
+        /* 플러그인이 드롭한 스포크는 출력하지 않음 */
+        if( (processed == NULL) && (proc->GetPlugins() != NULL) )
+        {
+            return;
+        }
+    }
+    if( (context->plots != NULL) && (processed != NULL) )
+    {
+        context->plots->AddSpoke(hdr, processed, num);
+    }
+    if( proc->IsActive() && (processed != NULL) )
+    {
+        data = (unsigned char *)processed;
+        numSamples = (unsigned int)num;
+        bps = 1;
+    }
+
+    /* 처리된 비디오를 각 링크로 재송신 */
+    for(size_t i = 0; i < context->links.size(); i++)
+    {
+        context->links[i]->Send(hdr, data, numSamples, bps);
+    }
+    if( !context->video )
+    {
+        return;
+    }
+
     /* 현재 시간 밀리초 단위로 가져오기 */
     struct timespec ts;
     clock_gettime(CLOCK_REALTIME, &ts);
@@ -305,16 +620,15 @@ static void handleRadar(SPxRadarReplay *src, void *arg,
                       "%.4f,%.1f,%lld", azimuthDegrees, hdr->endRange, current_time_ms);
     
     /* 샘플 데이터 추가 */
-    unsigned int bps = SPxGetPackingBytesPerSample(hdr->packing);
     if (bps == 1) {
-        for (unsigned int i = 0; i < hdr->thisLength && 
+        for (unsigned int i = 0; i < numSamples && 
              offset < (size_t)(sizeof(buffer) - 8); i++) {
             offset += snprintf(buffer + offset, sizeof(buffer) - offset, ",%d", data[i]);
         }
     }
     else if (bps == 2) {
         UINT16 *data16 = (UINT16 *)data;
-        for (unsigned int i = 0; i < hdr->thisLength && 
+        for (unsigned int i = 0; i < numSamples && 
              offset < (size_t)(sizeof(buffer) - 8); i++) {
             offset += snprintf(buffer + offset, sizeof(buffer) - offset, ",%d", data16[i]);
         }
@@ -330,6 +644,133 @@ static void handleRadar(SPxRadarReplay *src, void *arg,
 } /* handleRadar() */
 
 
+/*====================================================================
+*
+* reportPlots
+*	Print plot extraction and tracking statistics.
+*
+* Params:
+*	plots		Plot extraction,
+*	tracks		Track output, or NULL.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Printed to stderr, as stdout carries the video.
+*
+*===================================================================*/
+static void reportPlots(SPxPlotExtractor *plots, SPxTrackOutput *tracks)
+{
+    SPxPlotExtractor::Stats stats;
+    plots->GetStats(&stats);
+    fprintf(stderr, "Plots: %llu total, %.1f/s, latency %.1f ms mean,"
+	    " %.1f ms max.\n", (unsigned long long)stats.totalPlots,
+	    stats.plotsPerSec, stats.meanLatencyMs, stats.maxLatencyMs);
+
+    if( tracks != NULL )
+    {
+	SPxTrackOutput::Stats trackStats;
+	tracks->GetStats(&trackStats);
+	fprintf(stderr, "Tracks: %u active, %llu reports, tracker CPU"
+		" %.2f ms/scan mean, %.2f ms max over %u scans.\n",
+		trackStats.numTracks,
+		(unsigned long long)trackStats.totalReports,
+		trackStats.meanCpuMs, trackStats.maxCpuMs, trackStats.numScans);
+    }
+} /* reportPlots() */
+
+
+/*====================================================================
+*
+* reportPlugins
+*	Print filter plugin statistics.
+*
+* Params:
+*	plugins		Plugin chain.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Printed to stderr, as stdout carries the video.
+*
+*===================================================================*/
+static void reportPlugins(SPxFilterPluginChain *plugins)
+{
+    std::vector<SPxFilterPluginChain::Stats> stats;
+    plugins->GetStats(&stats);
+    for(size_t i = 0; i < stats.size(); i++)
+    {
+	fprintf(stderr, "Plugin %s: %llu spokes, %llu dropped,"
+		" %.1f us mean, %.1f us max.\n", stats[i].name.c_str(),
+		(unsigned long long)stats[i].numSpokes,
+		(unsigned long long)stats[i].numDropped,
+		stats[i].meanUsecs, stats[i].maxUsecs);
+    }
+} /* reportPlugins() */
+
+
+/*====================================================================
+*
+* reportRepublish
+*	Print video republish bandwidth.
+*
+* Params:
+*	links		Republish links.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Printed to stderr, as stdout carries the video.  Rates cover
+*	the time since the previous report.
+*
+*===================================================================*/
+static void reportRepublish(std::vector<SPxVideoRepublish *> *links)
+{
+    for(size_t i = 0; i < links->size(); i++)
+    {
+	SPxVideoRepublish::Stats stats;
+	(*links)[i]->GetStats(&stats);
+	fprintf(stderr, "Republish %s: %.1f spokes/s, %.1f packets/s,"
+		" %.2f Mbit/s, compression %.2f, %llu errors.\n",
+		(*links)[i]->GetSpec(), stats.spokesPerSec,
+		stats.packetsPerSec, stats.bitsPerSec / 1e6,
+		stats.compression, (unsigned long long)stats.numErrors);
+    }
+} /* reportRepublish() */
+
+
+/*====================================================================
+*
+* reportTelemetry
+*	Write the telemetry line.
+*
+* Params:
+*	output		Where to write it,
+*	telemetry	Counted from the replayed spokes.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	The file has no datagrams or source losses, so pkts_s is "-"
+*	and src_lost 0; gaps and misses are those recorded in the file.
+*
+*===================================================================*/
+static void reportTelemetry(SPxTelemetryOutput *output,
+				SPxSpokeTelemetry *telemetry)
+{
+    SPxSpokeTelemetry::Stats stats;
+    char line[512];
+    telemetry->GetStats(&stats);
+    SPxSpokeTelemetry::FormatLine(line, sizeof(line), "SPxDataStream", 0,
+				  &stats);
+    output->Write(line);
+} /* reportTelemetry() */
+
+
 /*********************************************************************
 *
 *	Utility functions to handle init/shutdown per operating system.
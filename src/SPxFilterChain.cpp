@@ -0,0 +1,943 @@
+/*********************************************************************
+*
+* File: SPxFilterChain.cpp
+*
+* Purpose:
+*	Per-spoke video filter chain (see SPxFilterChain.h).
+*
+**********************************************************************/
+
+/* Standard headers. */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define	SPX_FILTER_X86	1
+#include <immintrin.h>
+#endif
+
+/* Our own header. */
+#include "SPxFilterChain.h"
+
+/* Other headers. */
+#include "SPxWorkPool.h"
+
+/*
+ * Constants.
+ */
+#define	MAX_GAIN_DB	48.0	/* Q8 gains up to 65535 (x256) */
+#define	MAX_MA_WINDOW	63	/* Keeps window sums within 16 bits */
+#define	DEFAULT_STC_DB	40.0
+#define	MIN_CHUNK	16	/* Spokes per parallel task */
+
+/*
+ * Private function prototypes.
+ */
+static int useAvx2(void);
+static void gainScalar(uint8_t *s, const uint16_t *g, int start, int end);
+static void maScalar(uint8_t *dst, const uint8_t *padded, int start, int end,
+		     int win, unsigned int recip);
+static void median3Scalar(uint8_t *dst, const uint8_t *padded, int start, int end);
+static void median5Scalar(uint8_t *dst, const uint8_t *padded, int start, int end);
+static void threshScalar(uint8_t *s, int start, int end, uint8_t level);
+#ifdef SPX_FILTER_X86
+static void gainAvx2(uint8_t *s, const uint16_t *g, int n);
+static void maAvx2(uint8_t *dst, const uint8_t *padded, int n, int win,
+		   unsigned int recip);
+static void median3Avx2(uint8_t *dst, const uint8_t *padded, int n);
+static void median5Avx2(uint8_t *dst, const uint8_t *padded, int n);
+static void threshAvx2(uint8_t *s, int n, uint8_t level);
+#endif
+
+/*
+ * Global variables.
+ */
+/* -1 until the CPU has been checked. */
+static int UseAvx2 = -1;
+
+
+/*********************************************************************
+*
+*	Public functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* SPxFilterChain::SPxFilterChain
+*	Constructor, creates an empty chain (no filtering).
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+SPxFilterChain::SPxFilterChain(void)
+    : m_padded(1), m_runFrame(NULL), m_runSpokes(0), m_runSamples(0),
+      m_runStride(0), m_runAz(NULL), m_runFirst(0), m_runLast(0),
+      m_runChunk(0)
+{
+} /* SPxFilterChain::SPxFilterChain() */
+
+
+/*====================================================================
+*
+* SPxFilterChain::~SPxFilterChain
+*	Destructor.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+SPxFilterChain::~SPxFilterChain()
+{
+} /* SPxFilterChain::~SPxFilterChain() */
+
+
+/*====================================================================
+*
+* SPxFilterChain::SetParams
+*	Build the chain from a parameter string.
+*
+* Params:
+*	params			Stage list (see SPxFilterChain.h), NULL or
+*				empty for no filtering.
+*
+* Returns:
+*	Zero on success, -1 if the string is invalid.
+*
+* Notes
+*	The new chain only replaces the old one if every stage parses.
+*
+*===================================================================*/
+int SPxFilterChain::SetParams(const char *params)
+{
+    std::vector<Stage> stages;
+    std::string text = (params != NULL) ? params : "";
+    size_t pos = 0;
+
+    while( pos <= text.size() )
+    {
+	size_t end = text.find(';', pos);
+	if( end == std::string::npos )
+	{
+	    end = text.size();
+	}
+	/* 앞뒤 공백 제거 */
+	std::string item = text.substr(pos, end - pos);
+	size_t first = item.find_first_not_of(" \t");
+	size_t last = item.find_last_not_of(" \t");
+	if( first != std::string::npos )
+	{
+	    Stage stage;
+	    if( parseStage(item.substr(first, last - first + 1), &stage) != 0 )
+	    {
+		return(-1);
+	    }
+	    stages.push_back(stage);
+	}
+	pos = end + 1;
+    }
+
+    m_stages = stages;
+    m_params = text;
+    m_error.clear();
+    return(0);
+} /* SPxFilterChain::SetParams() */
+
+
+/*====================================================================
+*
+* SPxFilterChain::Apply
+*	Filter one spoke in place.
+*
+* Params:
+*	samples			Samples, first at zero range,
+*	numSamples		Number of samples,
+*	azDegrees		Azimuth, degrees clockwise from north
+*				(mask stages are skipped without it).
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	CFAR stages take adjacent spokes from the previous calls.
+*
+*===================================================================*/
+void SPxFilterChain::Apply(uint8_t *samples, int numSamples)
+{
+    if( (samples == NULL) || (numSamples <= 0) )
+    {
+	return;
+    }
+    for(size_t i = 0; i < m_stages.size(); i++)
+    {
+	applyStage(&m_stages[i], samples, numSamples, NULL, 0);
+    }
+} /* SPxFilterChain::Apply() */
+
+void SPxFilterChain::Apply(uint8_t *samples, int numSamples, double azDegrees)
+{
+    if( (samples == NULL) || (numSamples <= 0) )
+    {
+	return;
+    }
+    for(size_t i = 0; i < m_stages.size(); i++)
+    {
+	applyStage(&m_stages[i], samples, numSamples, &azDegrees, 0);
+    }
+} /* SPxFilterChain::Apply() */
+
+
+/*====================================================================
+*
+* SPxFilterChain::ApplyFrame
+*	Filter every spoke of a polar frame in place.
+*
+* Params:
+*	frame			First sample of the first spoke,
+*	numSpokes		Number of spokes,
+*	numSamples		Samples per spoke,
+*	strideBytes		Distance between spokes in bytes,
+*	azDegrees		Azimuth of each spoke in degrees, or NULL
+*				(mask stages are then skipped),
+*	pool			Threads to split the frame over, or NULL.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Runs of per-spoke stages are applied spoke by spoke, so each
+*	spoke stays in cache; CFAR stages see the whole frame.  With a
+*	pool each run is one batch of chunks of spokes, and the tables
+*	the stages build lazily are built first so the workers only
+*	read them.
+*
+*===================================================================*/
+void SPxFilterChain::ApplyFrame(uint8_t *frame, int numSpokes, int numSamples,
+				int strideBytes, const double *azDegrees,
+				SPxWorkPool *pool)
+{
+    if( (frame == NULL) || (numSamples <= 0) )
+    {
+	return;
+    }
+    if( (pool != NULL) && (pool->GetNumThreads() <= 1) )
+    {
+	pool = NULL;
+    }
+    if( (pool != NULL) && (m_padded.size() < pool->GetNumThreads()) )
+    {
+	m_padded.resize(pool->GetNumThreads());
+    }
+    m_runFrame = frame;
+    m_runSpokes = numSpokes;
+    m_runSamples = numSamples;
+    m_runStride = strideBytes;
+    m_runAz = azDegrees;
+
+    size_t first = 0;
+    while( first < m_stages.size() )
+    {
+	if( m_stages[first].type == STAGE_CFAR )
+	{
+	    m_stages[first].cfar.ApplyFrame(frame, numSpokes, numSamples,
+					    strideBytes, pool);
+	    first++;
+	    continue;
+	}
+	size_t last = first;
+	while( (last < m_stages.size()) && (m_stages[last].type != STAGE_CFAR) )
+	{
+	    last++;
+	}
+	m_runFirst = first;
+	m_runLast = last;
+	if( (pool == NULL) || (numSpokes <= MIN_CHUNK) )
+	{
+	    applySpokes(0, numSpokes, 0);
+	}
+	else
+	{
+	    prepareStages(first, last, numSamples);
+	    m_runChunk = (int)pool->GetChunkSize((unsigned int)numSpokes, MIN_CHUNK);
+	    pool->Run((unsigned int)((numSpokes + m_runChunk - 1) / m_runChunk),
+		      spokeTask, this);
+	}
+	first = last;
+    }
+} /* SPxFilterChain::ApplyFrame() */
+
+
+/*====================================================================
+*
+* SPxFilterChain::GetSimdName
+*	Report which kernels are in use.
+*
+* Params:
+*	None
+*
+* Returns:
+*	"avx2" or "scalar".
+*
+* Notes
+*
+*===================================================================*/
+const char *SPxFilterChain::GetSimdName(void)
+{
+    return( useAvx2() ? "avx2" : "scalar" );
+} /* SPxFilterChain::GetSimdName() */
+
+
+/*********************************************************************
+*
+*	Private functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* SPxFilterChain::prepareStages
+*	Build the tables a run of stages needs for a spoke length.
+*
+* Params:
+*	first, last		Stages first..last-1,
+*	numSamples		Spoke length.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Called before a parallel batch, so that applyStage() does not
+*	resize anything shared between workers.
+*
+*===================================================================*/
+void SPxFilterChain::prepareStages(size_t first, size_t last, int numSamples)
+{
+    (void)useAvx2();
+    for(size_t i = first; i < last; i++)
+    {
+	Stage *stage = &m_stages[i];
+	if( ((stage->type == STAGE_GAIN) || (stage->type == STAGE_STC))
+	    && ((int)stage->gains.size() != numSamples) )
+	{
+	    buildGains(stage, numSamples);
+	}
+	else if( stage->type == STAGE_MASK )
+	{
+	    stage->mask.Prepare(numSamples);
+	}
+    }
+} /* SPxFilterChain::prepareStages() */
+
+
+/*====================================================================
+*
+* SPxFilterChain::applySpokes
+*	Apply the current run of stages to some spokes of the frame.
+*
+* Params:
+*	first, end		Range of spokes,
+*	worker			Pool worker (selects the scratch buffer).
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+void SPxFilterChain::applySpokes(int first, int end, unsigned int worker)
+{
+    for(int s = first; s < end; s++)
+    {
+	uint8_t *spoke = m_runFrame + ((size_t)s * m_runStride);
+	for(size_t i = m_runFirst; i < m_runLast; i++)
+	{
+	    applyStage(&m_stages[i], spoke, m_runSamples,
+		       (m_runAz != NULL) ? &m_runAz[s] : NULL, worker);
+	}
+    }
+} /* SPxFilterChain::applySpokes() */
+
+
+/*====================================================================
+*
+* SPxFilterChain::spokeTask
+*	Work pool task for ApplyFrame().
+*
+* Params:
+*	userArg			The chain,
+*	taskIdx			Chunk of spokes,
+*	workerIdx		Worker running the task.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+void SPxFilterChain::spokeTask(void *userArg, unsigned int taskIdx,
+			       unsigned int workerIdx)
+{
+    SPxFilterChain *chain = (SPxFilterChain *)userArg;
+    int first = (int)taskIdx * chain->m_runChunk;
+    int end = first + chain->m_runChunk;
+    chain->applySpokes(first, (end < chain->m_runSpokes) ? end : chain->m_runSpokes,
+		       workerIdx);
+} /* SPxFilterChain::spokeTask() */
+
+
+/*====================================================================
+*
+* SPxFilterChain::applyStage
+*	Apply one stage to one spoke in place.
+*
+* Params:
+*	stage			Stage,
+*	samples			Samples, first at zero range,
+*	numSamples		Number of samples,
+*	azDegrees		Azimuth in degrees, or NULL if unknown,
+*	worker			Pool worker (selects the scratch buffer).
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Gain tables are rebuilt only when the spoke length changes.
+*
+*===================================================================*/
+void SPxFilterChain::applyStage(Stage *stage, uint8_t *samples, int numSamples,
+				const double *azDegrees, unsigned int worker)
+{
+    int avx2 = useAvx2();
+    switch(stage->type)
+    {
+	case STAGE_BLANK:
+	{
+	    int start = (stage->a < numSamples) ? stage->a : numSamples;
+	    int end = (stage->b < numSamples) ? stage->b : numSamples;
+	    if( end > start )
+	    {
+		memset(samples + start, 0, end - start);
+	    }
+	    break;
+	}
+
+	case STAGE_GAIN:
+	case STAGE_STC:
+	    if( (int)stage->gains.size() != numSamples )
+	    {
+		buildGains(stage, numSamples);
+	    }
+#ifdef SPX_FILTER_X86
+	    if( avx2 )
+	    {
+		gainAvx2(samples, &stage->gains[0], numSamples);
+		break;
+	    }
+#endif
+	    gainScalar(samples, &stage->gains[0], 0, numSamples);
+	    break;
+
+	case STAGE_MA:
+	{
+	    int win = stage->a;
+	    /* 반올림된 역수를 곱해 나눗셈 대체 (AVX2 와 동일한 결과) */
+	    unsigned int recip = (65536 + win - 1) / win;
+	    const uint8_t *padded = pad(samples, numSamples, win / 2, worker);
+#ifdef SPX_FILTER_X86
+	    if( avx2 )
+	    {
+		maAvx2(samples, padded, numSamples, win, recip);
+		break;
+	    }
+#endif
+	    maScalar(samples, padded, 0, numSamples, win, recip);
+	    break;
+	}
+
+	case STAGE_MEDIAN:
+	{
+	    const uint8_t *padded = pad(samples, numSamples, stage->a / 2, worker);
+#ifdef SPX_FILTER_X86
+	    if( avx2 )
+	    {
+		if( stage->a == 3 )
+		{
+		    median3Avx2(samples, padded, numSamples);
+		}
+		else
+		{
+		    median5Avx2(samples, padded, numSamples);
+		}
+		break;
+	    }
+#endif
+	    if( stage->a == 3 )
+	    {
+		median3Scalar(samples, padded, 0, numSamples);
+	    }
+	    else
+	    {
+		median5Scalar(samples, padded, 0, numSamples);
+	    }
+	    break;
+	}
+
+	case STAGE_THRESH:
+#ifdef SPX_FILTER_X86
+	    if( avx2 )
+	    {
+		threshAvx2(samples, numSamples, (uint8_t)stage->a);
+		break;
+	    }
+#endif
+	    threshScalar(samples, 0, numSamples, (uint8_t)stage->a);
+	    break;
+
+	case STAGE_CFAR:
+	    stage->cfar.Apply(samples, numSamples);
+	    break;
+
+	case STAGE_MASK:
+	    if( azDegrees != NULL )
+	    {
+		stage->mask.Apply(*azDegrees, samples, numSamples);
+	    }
+	    break;
+    }
+} /* SPxFilterChain::applyStage() */
+
+
+/*====================================================================
+*
+* SPxFilterChain::parseStage
+*	Parse one "name[:args]" stage.
+*
+* Params:
+*	text			Stage text without surrounding spaces,
+*	stage			Filled in on success.
+*
+* Returns:
+*	Zero on success, -1 on error (m_error is set).
+*
+* Notes
+*
+*===================================================================*/
+int SPxFilterChain::parseStage(const std::string &text, Stage *stage)
+{
+    size_t colon = text.find(':');
+    std::string name = text.substr(0, colon);
+    const char *args = (colon != std::string::npos) ? text.c_str() + colon + 1 : "";
+    char extra;
+
+    stage->a = 0;
+    stage->b = 0;
+    stage->dB = 0.0;
+    stage->gains.clear();
+
+    if( name == "blank" )
+    {
+	stage->type = STAGE_BLANK;
+	if( (sscanf(args, "%d-%d%c", &stage->a, &stage->b, &extra) == 2)
+	    && (stage->a >= 0) && (stage->b > stage->a) )
+	{
+	    return(0);
+	}
+    }
+    else if( name == "gain" )
+    {
+	stage->type = STAGE_GAIN;
+	if( (sscanf(args, "%lf%c", &stage->dB, &extra) == 1)
+	    && (fabs(stage->dB) <= MAX_GAIN_DB) )
+	{
+	    return(0);
+	}
+    }
+    else if( name == "stc" )
+    {
+	stage->type = STAGE_STC;
+	stage->dB = DEFAULT_STC_DB;
+	int n = sscanf(args, "%d,%lf%c", &stage->a, &stage->dB, &extra);
+	if( ((n == 1) || (n == 2)) && (stage->a > 0)
+	    && (stage->dB > 0.0) && (stage->dB <= MAX_GAIN_DB) )
+	{
+	    return(0);
+	}
+    }
+    else if( name == "ma" )
+    {
+	stage->type = STAGE_MA;
+	if( (sscanf(args, "%d%c", &stage->a, &extra) == 1)
+	    && (stage->a >= 3) && (stage->a <= MAX_MA_WINDOW) && (stage->a & 1) )
+	{
+	    return(0);
+	}
+    }
+    else if( name == "median" )
+    {
+	stage->type = STAGE_MEDIAN;
+	if( (sscanf(args, "%d%c", &stage->a, &extra) == 1)
+	    && ((stage->a == 3) || (stage->a == 5)) )
+	{
+	    return(0);
+	}
+    }
+    else if( name == "thresh" )
+    {
+	stage->type = STAGE_THRESH;
+	if( (sscanf(args, "%d%c", &stage->a, &extra) == 1)
+	    && (stage->a >= 0) && (stage->a <= 255) )
+	{
+	    return(0);
+	}
+    }
+    else if( name == "cfar" )
+    {
+	stage->type = STAGE_CFAR;
+	if( stage->cfar.SetParams(args) == 0 )
+	{
+	    return(0);
+	}
+    }
+    else if( name == "mask" )
+    {
+	stage->type = STAGE_MASK;
+	if( stage->mask.Load(args) == 0 )
+	{
+	    return(0);
+	}
+	m_error = std::string("cannot load clutter mask '") + args + "'";
+	return(-1);
+    }
+    else
+    {
+	m_error = "unknown filter stage '" + name + "'";
+	return(-1);
+    }
+    m_error = "invalid arguments for filter stage '" + text + "'";
+    return(-1);
+} /* SPxFilterChain::parseStage() */
+
+
+/*====================================================================
+*
+* SPxFilterChain::buildGains
+*	Build the per-gate gain table of a gain or STC stage.
+*
+* Params:
+*	stage			Stage to update,
+*	numSamples		Spoke length.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	STC attenuation follows the 40log10(R) (R^4) law, reaching zero
+*	at the configured gate.  Gains are Q8, so 256 is unity.
+*
+*===================================================================*/
+void SPxFilterChain::buildGains(Stage *stage, int numSamples)
+{
+    stage->gains.resize(numSamples);
+    for(int g = 0; g < numSamples; g++)
+    {
+	double dB = stage->dB;
+	if( stage->type == STAGE_STC )
+	{
+	    double atten = 0.0;
+	    if( g < stage->a )
+	    {
+		atten = (g == 0) ? stage->dB : (40.0 * log10((double)stage->a / g));
+		if( atten > stage->dB )
+		{
+		    atten = stage->dB;
+		}
+	    }
+	    dB = -atten;
+	}
+	double q8 = floor((256.0 * pow(10.0, dB / 20.0)) + 0.5);
+	stage->gains[g] = (uint16_t)((q8 > 65535.0) ? 65535.0 : q8);
+    }
+} /* SPxFilterChain::buildGains() */
+
+
+/*====================================================================
+*
+* SPxFilterChain::pad
+*	Copy a spoke into the scratch buffer with replicated edges.
+*
+* Params:
+*	samples			Spoke,
+*	numSamples		Spoke length,
+*	half			Samples of padding on each side,
+*	worker			Pool worker whose buffer to use.
+*
+* Returns:
+*	Pointer to the padded copy (sample 0 is at index half).
+*
+* Notes
+*
+*===================================================================*/
+const uint8_t *SPxFilterChain::pad(const uint8_t *samples, int numSamples,
+				   int half, unsigned int worker)
+{
+    std::vector<uint8_t> &padded = m_padded[worker];
+    size_t size = (size_t)numSamples + (2 * half);
+    if( padded.size() < size )
+    {
+	padded.resize(size);
+    }
+    uint8_t *p = &padded[0];
+    memset(p, samples[0], half);
+    memcpy(p + half, samples, numSamples);
+    memset(p + half + numSamples, samples[numSamples - 1], half);
+    return(p);
+} /* SPxFilterChain::pad() */
+
+
+/*====================================================================
+*
+* useAvx2
+*	Decide once whether to use the AVX2 kernels.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Non-zero to use AVX2.
+*
+* Notes
+*	SPX_SIMD=scalar in the environment forces the scalar kernels,
+*	for comparing results and timings.
+*
+*===================================================================*/
+static int useAvx2(void)
+{
+    if( UseAvx2 < 0 )
+    {
+	int avx2 = 0;
+#ifdef SPX_FILTER_X86
+	__builtin_cpu_init();
+	avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+#endif
+	const char *env = getenv("SPX_SIMD");
+	if( (env != NULL) && (strcmp(env, "scalar") == 0) )
+	{
+	    avx2 = 0;
+	}
+	UseAvx2 = avx2;
+    }
+    return(UseAvx2);
+} /* useAvx2() */
+
+
+/*====================================================================
+*
+* gain / ma / median3 / median5 / thresh, Scalar and Avx2
+*	Stage kernels.
+*
+* Params:
+*	s, dst			Samples to update in place,
+*	padded			Edge-padded copy for the smoothing stages,
+*	start, end		Range of samples (scalar versions),
+*	n			Number of samples (AVX2 versions),
+*	others			Stage parameters.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	The AVX2 versions process 16 or 32 samples per step and hand
+*	the tail to the scalar version, which uses exactly the same
+*	arithmetic.
+*
+*===================================================================*/
+static void gainScalar(uint8_t *s, const uint16_t *g, int start, int end)
+{
+    for(int i = start; i < end; i++)
+    {
+	uint32_t v = ((uint32_t)s[i] * g[i]) >> 8;
+	s[i] = (uint8_t)((v > 255) ? 255 : v);
+    }
+} /* gainScalar() */
+
+static void maScalar(uint8_t *dst, const uint8_t *padded, int start, int end,
+		     int win, unsigned int recip)
+{
+    for(int i = start; i < end; i++)
+    {
+	unsigned int sum = 0;
+	for(int k = 0; k < win; k++)
+	{
+	    sum += padded[i + k];
+	}
+	dst[i] = (uint8_t)((sum * recip) >> 16);
+    }
+} /* maScalar() */
+
+static inline uint8_t med3(uint8_t a, uint8_t b, uint8_t c)
+{
+    uint8_t lo = (a < b) ? a : b;
+    uint8_t hi = (a < b) ? b : a;
+    uint8_t m = (hi < c) ? hi : c;
+    return( (lo > m) ? lo : m );
+}
+
+static void median3Scalar(uint8_t *dst, const uint8_t *padded, int start, int end)
+{
+    for(int i = start; i < end; i++)
+    {
+	dst[i] = med3(padded[i], padded[i + 1], padded[i + 2]);
+    }
+} /* median3Scalar() */
+
+static void median5Scalar(uint8_t *dst, const uint8_t *padded, int start, int end)
+{
+    for(int i = start; i < end; i++)
+    {
+	const uint8_t *p = padded + i;
+	/* med5 = med3(e, max(min(a,b),min(c,d)), min(max(a,b),max(c,d))) */
+	uint8_t minAB = (p[0] < p[1]) ? p[0] : p[1];
+	uint8_t maxAB = (p[0] < p[1]) ? p[1] : p[0];
+	uint8_t minCD = (p[2] < p[3]) ? p[2] : p[3];
+	uint8_t maxCD = (p[2] < p[3]) ? p[3] : p[2];
+	uint8_t f = (minAB > minCD) ? minAB : minCD;
+	uint8_t g = (maxAB < maxCD) ? maxAB : maxCD;
+	dst[i] = med3(p[4], f, g);
+    }
+} /* median5Scalar() */
+
+static void threshScalar(uint8_t *s, int start, int end, uint8_t level)
+{
+    for(int i = start; i < end; i++)
+    {
+	if( s[i] < level )
+	{
+	    s[i] = 0;
+	}
+    }
+} /* threshScalar() */
+
+#ifdef SPX_FILTER_X86
+/* 16비트 16개를 포화 없이 8비트 16개로 줄여 저장 (값은 이미 0..255) */
+__attribute__((target("avx2")))
+static inline void store16(uint8_t *dst, __m256i v)
+{
+    _mm_storeu_si128((__m128i *)dst,
+		     _mm_packus_epi16(_mm256_castsi256_si128(v),
+				      _mm256_extracti128_si256(v, 1)));
+}
+
+__attribute__((target("avx2")))
+static void gainAvx2(uint8_t *s, const uint16_t *g, int n)
+{
+    const __m256i max8 = _mm256_set1_epi16(255);
+    int i = 0;
+    for(; i + 16 <= n; i += 16)
+    {
+	__m256i v = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(s + i)));
+	__m256i gv = _mm256_loadu_si256((const __m256i *)(g + i));
+	/* 24비트 곱의 >> 8 을 상위/하위 16비트 곱으로 조합 (상위는 항상 255 이하) */
+	__m256i lo = _mm256_mullo_epi16(v, gv);
+	__m256i hi = _mm256_mulhi_epu16(v, gv);
+	__m256i r = _mm256_or_si256(_mm256_srli_epi16(lo, 8), _mm256_slli_epi16(hi, 8));
+	r = _mm256_min_epu16(r, max8);
+	store16(s + i, r);
+    }
+    gainScalar(s, g, i, n);
+} /* gainAvx2() */
+
+__attribute__((target("avx2")))
+static void maAvx2(uint8_t *dst, const uint8_t *padded, int n, int win,
+		   unsigned int recip)
+{
+    const __m256i r = _mm256_set1_epi16((short)recip);
+    int i = 0;
+    for(; i + 16 <= n; i += 16)
+    {
+	__m256i sum = _mm256_setzero_si256();
+	for(int k = 0; k < win; k++)
+	{
+	    sum = _mm256_add_epi16(sum, _mm256_cvtepu8_epi16(
+				   _mm_loadu_si128((const __m128i *)(padded + i + k))));
+	}
+	store16(dst + i, _mm256_mulhi_epu16(sum, r));
+    }
+    maScalar(dst, padded, i, n, win, recip);
+} /* maAvx2() */
+
+__attribute__((target("avx2")))
+static inline __m256i med3Avx2(__m256i a, __m256i b, __m256i c)
+{
+    __m256i lo = _mm256_min_epu8(a, b);
+    __m256i hi = _mm256_max_epu8(a, b);
+    return(_mm256_max_epu8(lo, _mm256_min_epu8(hi, c)));
+}
+
+__attribute__((target("avx2")))
+static void median3Avx2(uint8_t *dst, const uint8_t *padded, int n)
+{
+    int i = 0;
+    for(; i + 32 <= n; i += 32)
+    {
+	__m256i a = _mm256_loadu_si256((const __m256i *)(padded + i));
+	__m256i b = _mm256_loadu_si256((const __m256i *)(padded + i + 1));
+	__m256i c = _mm256_loadu_si256((const __m256i *)(padded + i + 2));
+	_mm256_storeu_si256((__m256i *)(dst + i), med3Avx2(a, b, c));
+    }
+    median3Scalar(dst, padded, i, n);
+} /* median3Avx2() */
+
+__attribute__((target("avx2")))
+static void median5Avx2(uint8_t *dst, const uint8_t *padded, int n)
+{
+    int i = 0;
+    for(; i + 32 <= n; i += 32)
+    {
+	const uint8_t *p = padded + i;
+	__m256i a = _mm256_loadu_si256((const __m256i *)(p));
+	__m256i b = _mm256_loadu_si256((const __m256i *)(p + 1));
+	__m256i c = _mm256_loadu_si256((const __m256i *)(p + 2));
+	__m256i d = _mm256_loadu_si256((const __m256i *)(p + 3));
+	__m256i e = _mm256_loadu_si256((const __m256i *)(p + 4));
+	__m256i f = _mm256_max_epu8(_mm256_min_epu8(a, b), _mm256_min_epu8(c, d));
+	__m256i g = _mm256_min_epu8(_mm256_max_epu8(a, b), _mm256_max_epu8(c, d));
+	_mm256_storeu_si256((__m256i *)(dst + i), med3Avx2(e, f, g));
+    }
+    median5Scalar(dst, padded, i, n);
+} /* median5Avx2() */
+
+__attribute__((target("avx2")))
+static void threshAvx2(uint8_t *s, int n, uint8_t level)
+{
+    const __m256i t = _mm256_set1_epi8((char)level);
+    int i = 0;
+    for(; i + 32 <= n; i += 32)
+    {
+	__m256i v = _mm256_loadu_si256((const __m256i *)(s + i));
+	/* v >= t 이면 max(v, t) == v */
+	__m256i keep = _mm256_cmpeq_epi8(_mm256_max_epu8(v, t), v);
+	_mm256_storeu_si256((__m256i *)(s + i), _mm256_and_si256(v, keep));
+    }
+    threshScalar(s, i, n, level);
+} /* threshAvx2() */
+#endif /* SPX_FILTER_X86 */
+
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
@@ -0,0 +1,151 @@
+/*********************************************************************
+*
+* File: SPxFilterChain.h
+*
+* Purpose:
+*	Configurable chain of per-spoke video filters on 8-bit samples.
+*
+*	The chain is built from a parameter string of stages separated
+*	by ';', each "name[:args]", applied in the order given:
+*
+*	  blank:<start>-<end>	Zero gates start..end-1 (range gating).
+*	  gain:<dB>		Constant gain (-48..+48 dB).
+*	  stc:<gates>[,<dB>]	Sensitivity time control: 40log10(R)
+*				attenuation reaching zero at <gates>,
+*				capped at <dB> (default 40).
+*	  ma:<n>		Moving average over n gates (odd, 3..63).
+*	  median:<n>		Median over n gates (3 or 5).
+*	  thresh:<level>	Zero samples below level.
+*	  cfar:<args>		CFAR detection, see SPxCfar.h for args,
+*				e.g. "cfar:ca,2,16,3" or "cfar:os,2,16,3,1,bin".
+*	  mask:<file>		Static clutter mask from SPxMaskBuilder
+*				(see SPxClutterMask.h), loaded once.
+*
+*	e.g. "blank:0-150;stc:400,30;median:3;thresh:40".
+*
+*	A CFAR stage with adjacent spokes reads the whole frame in
+*	ApplyFrame(); with Apply() it uses the previous spokes.  A mask
+*	stage needs the spoke azimuths and passes spokes unchanged when
+*	they are not given.
+*
+*	Every stage except blank has an AVX2 kernel and a scalar
+*	fallback giving identical results; the AVX2 kernels are used
+*	when the CPU supports them unless SPX_SIMD=scalar is set in the
+*	environment.  Smoothing stages replicate the edge samples.
+*
+*	ApplyFrame() can split the frame over an SPxWorkPool: runs of
+*	per-spoke stages are applied to chunks of spokes in parallel,
+*	each worker with its own scratch, and CFAR stages split the
+*	frame themselves (see SPxCfar.h).  The output is the same as
+*	with no pool.
+*
+*	The chain keeps scratch buffers, so one object must not be used
+*	from several threads at once.  It does not depend on the SPx
+*	library.
+*
+**********************************************************************/
+
+#ifndef _SPX_FILTER_CHAIN_H
+#define _SPX_FILTER_CHAIN_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "SPxCfar.h"
+#include "SPxClutterMask.h"
+
+class SPxWorkPool;
+
+class SPxFilterChain
+{
+public:
+    /* Constructor/destructor. */
+    SPxFilterChain(void);
+    ~SPxFilterChain();
+
+    /* Configuration.  Returns zero on success, -1 on a bad string
+     * (the previous chain is kept and GetError() says why).
+     */
+    int SetParams(const char *params);
+    const char *GetParams(void) const { return m_params.c_str(); }
+    const char *GetError(void) const { return m_error.c_str(); }
+    int GetNumStages(void) const { return (int)m_stages.size(); }
+
+    /* Filtering, in place, optionally with the azimuth of each spoke
+     * in degrees (for mask stages) and a pool to split frames over.
+     */
+    void Apply(uint8_t *samples, int numSamples);
+    void Apply(uint8_t *samples, int numSamples, double azDegrees);
+    void ApplyFrame(uint8_t *frame, int numSpokes, int numSamples,
+		    int strideBytes, const double *azDegrees = NULL,
+		    SPxWorkPool *pool = NULL);
+
+    /* Name of the instruction set in use ("avx2" or "scalar"). */
+    static const char *GetSimdName(void);
+
+private:
+    /* Stage types. */
+    enum StageType
+    {
+	STAGE_BLANK,
+	STAGE_GAIN,
+	STAGE_STC,
+	STAGE_MA,
+	STAGE_MEDIAN,
+	STAGE_THRESH,
+	STAGE_CFAR,
+	STAGE_MASK
+    };
+
+    struct Stage
+    {
+	StageType type;
+	int a;			/* Start gate, window, level or STC gates */
+	int b;			/* End gate */
+	double dB;		/* Gain or STC attenuation */
+	std::vector<uint16_t> gains;	/* Per-gate gain, Q8 */
+	SPxCfar cfar;			/* CFAR detector and its history */
+	SPxClutterMask mask;		/* Static clutter mask */
+    };
+
+    std::string m_params;
+    std::string m_error;
+    std::vector<Stage> m_stages;
+
+    /* Scratch buffers for the smoothing stages (with edge padding),
+     * one per pool worker.
+     */
+    std::vector<std::vector<uint8_t> > m_padded;
+
+    /* Run of stages being applied by ApplyFrame(). */
+    uint8_t *m_runFrame;
+    int m_runSpokes;
+    int m_runSamples;
+    int m_runStride;
+    const double *m_runAz;
+    size_t m_runFirst;		/* Stages first..last-1 */
+    size_t m_runLast;
+    int m_runChunk;		/* Spokes per task */
+
+    /* Private functions. */
+    int parseStage(const std::string &text, Stage *stage);
+    void prepareStages(size_t first, size_t last, int numSamples);
+    void applySpokes(int first, int end, unsigned int worker);
+    void applyStage(Stage *stage, uint8_t *samples, int numSamples,
+		    const double *azDegrees, unsigned int worker);
+    void buildGains(Stage *stage, int numSamples);
+    const uint8_t *pad(const uint8_t *samples, int numSamples, int half,
+		       unsigned int worker);
+    static void spokeTask(void *userArg, unsigned int taskIdx,
+			  unsigned int workerIdx);
+};
+
+#endif /* _SPX_FILTER_CHAIN_H */
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
@@ -0,0 +1,353 @@
+/*********************************************************************
+*
+* File: SPxFilterPlugin.cpp
+*
+* Purpose:
+*	Chain of run-time loaded filter plugins (see SPxFilterPlugin.h).
+*
+**********************************************************************/
+
+/* Standard headers. */
+#include <chrono>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+/* Our own header. */
+#include "SPxFilterPlugin.h"
+
+/*
+ * Private functions.
+ */
+static void *openLib(const std::string &path, std::string *error);
+static void *findSymbol(void *lib, const char *name);
+static void closeLib(void *lib);
+
+
+/*********************************************************************
+*
+*	Public functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* SPxFilterPluginChain::SPxFilterPluginChain
+*	Constructor, with no plugins.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+SPxFilterPluginChain::SPxFilterPluginChain(void)
+    : m_spokeCount(0)
+{
+} /* SPxFilterPluginChain::SPxFilterPluginChain() */
+
+
+/*====================================================================
+*
+* SPxFilterPluginChain::~SPxFilterPluginChain
+*	Destructor, destroying the instances and unloading the plugins.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+SPxFilterPluginChain::~SPxFilterPluginChain()
+{
+    for(size_t i = 0; i < m_plugins.size(); i++)
+    {
+	m_plugins[i].destroyFn(m_plugins[i].instance);
+	closeLib(m_plugins[i].lib);
+    }
+} /* SPxFilterPluginChain::~SPxFilterPluginChain() */
+
+
+/*====================================================================
+*
+* SPxFilterPluginChain::Add
+*	Load a plugin and append it to the chain.
+*
+* Params:
+*	spec			"<lib>[:<args>]".
+*
+* Returns:
+*	Zero on success, -1 on error.
+*
+* Notes
+*	The library path is up to the first ':', so it cannot contain
+*	one.
+*
+*===================================================================*/
+int SPxFilterPluginChain::Add(const char *spec)
+{
+    std::string text = (spec != NULL) ? spec : "";
+    size_t colon = text.find(':');
+    std::string path = text.substr(0, colon);
+    std::string args = (colon == std::string::npos) ? "" : text.substr(colon + 1);
+    if( path.empty() )
+    {
+	m_error = "invalid plugin '" + text + "'";
+	return(-1);
+    }
+
+    void *lib = openLib(path, &m_error);
+    if( lib == NULL )
+    {
+	return(-1);
+    }
+    SPxFilterPluginAbiFn abiFn
+	= (SPxFilterPluginAbiFn)findSymbol(lib, "SPxFilterPluginAbi");
+    SPxFilterPluginCreateFn createFn
+	= (SPxFilterPluginCreateFn)findSymbol(lib, "SPxFilterPluginCreate");
+    SPxFilterPluginProcessFn processFn
+	= (SPxFilterPluginProcessFn)findSymbol(lib, "SPxFilterPluginProcess");
+    SPxFilterPluginDestroyFn destroyFn
+	= (SPxFilterPluginDestroyFn)findSymbol(lib, "SPxFilterPluginDestroy");
+    if( (abiFn == NULL) || (createFn == NULL) || (processFn == NULL)
+	|| (destroyFn == NULL) )
+    {
+	closeLib(lib);
+	m_error = "'" + path + "' is not a filter plugin";
+	return(-1);
+    }
+    if( abiFn() != SPX_FILTER_PLUGIN_ABI_VERSION )
+    {
+	closeLib(lib);
+	m_error = "'" + path + "' has a different plugin interface version";
+	return(-1);
+    }
+    void *instance = createFn(args.c_str());
+    if( instance == NULL )
+    {
+	closeLib(lib);
+	m_error = "plugin '" + path + "' rejected args '" + args + "'";
+	return(-1);
+    }
+
+    Plugin plugin;
+    plugin.name = text;
+    plugin.lib = lib;
+    plugin.instance = instance;
+    plugin.processFn = processFn;
+    plugin.destroyFn = destroyFn;
+    plugin.numSpokes = 0;
+    plugin.numDropped = 0;
+    plugin.sumUsecs = 0.0;
+    plugin.maxUsecs = 0.0;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_plugins.push_back(plugin);
+    return(0);
+} /* SPxFilterPluginChain::Add() */
+
+
+/*====================================================================
+*
+* SPxFilterPluginChain::Apply
+*	Run the chain on a spoke.
+*
+* Params:
+*	hdr			Spoke description (count and size are
+*				filled in),
+*	samples			Samples, filtered in place,
+*	numSamples		Number of samples, updated to the
+*				output length.
+*
+* Returns:
+*	Zero if the spoke is kept, -1 if it was dropped.
+*
+* Notes
+*	A plugin that moves the span or makes it longer has the spoke
+*	dropped.
+*
+*===================================================================*/
+int SPxFilterPluginChain::Apply(SPxFilterPluginHeader *hdr, uint8_t *samples,
+				int *numSamples)
+{
+    hdr->structSize = sizeof(SPxFilterPluginHeader);
+    hdr->spokeCount = m_spokeCount++;
+
+    SPxFilterPluginSpan span;
+    span.samples = samples;
+    span.numSamples = (*numSamples > 0) ? (uint32_t)*numSamples : 0;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for(size_t i = 0; i < m_plugins.size(); i++)
+    {
+	Plugin *plugin = &m_plugins[i];
+	uint8_t *start = span.samples;
+	uint32_t count = span.numSamples;
+
+	std::chrono::steady_clock::time_point t0
+	    = std::chrono::steady_clock::now();
+	int result = plugin->processFn(plugin->instance, hdr, &span);
+	double usecs = std::chrono::duration<double, std::micro>(
+	    std::chrono::steady_clock::now() - t0).count();
+
+	plugin->numSpokes++;
+	plugin->sumUsecs += usecs;
+	if( usecs > plugin->maxUsecs )
+	{
+	    plugin->maxUsecs = usecs;
+	}
+	/* 포인터를 옮기거나 구간을 늘리면 드롭 */
+	if( (result != SPX_FILTER_PLUGIN_KEEP) || (span.samples != start)
+	    || (span.numSamples > count) )
+	{
+	    plugin->numDropped++;
+	    return(-1);
+	}
+    }
+
+    *numSamples = (int)span.numSamples;
+    return(0);
+} /* SPxFilterPluginChain::Apply() */
+
+
+/*====================================================================
+*
+* SPxFilterPluginChain::GetStats
+*	Read the per-plugin statistics.
+*
+* Params:
+*	stats			Filled in, one entry per plugin in chain
+*				order.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Counts and times cover the spokes since the previous call.
+*
+*===================================================================*/
+void SPxFilterPluginChain::GetStats(std::vector<Stats> *stats)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    stats->resize(m_plugins.size());
+    for(size_t i = 0; i < m_plugins.size(); i++)
+    {
+	Plugin *plugin = &m_plugins[i];
+	Stats *s = &(*stats)[i];
+	s->name = plugin->name;
+	s->numSpokes = plugin->numSpokes;
+	s->numDropped = plugin->numDropped;
+	s->meanUsecs = (plugin->numSpokes > 0)
+	    ? plugin->sumUsecs / (double)plugin->numSpokes : 0.0;
+	s->maxUsecs = plugin->maxUsecs;
+
+	plugin->numSpokes = 0;
+	plugin->numDropped = 0;
+	plugin->sumUsecs = 0.0;
+	plugin->maxUsecs = 0.0;
+    }
+} /* SPxFilterPluginChain::GetStats() */
+
+
+/*********************************************************************
+*
+*	Private functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* openLib
+*	Load a shared object.
+*
+* Params:
+*	path			Path of the library,
+*	error			Set on error.
+*
+* Returns:
+*	Handle, or NULL on error.
+*
+* Notes
+*
+*===================================================================*/
+static void *openLib(const std::string &path, std::string *error)
+{
+#ifdef _WIN32
+    void *lib = (void *)LoadLibraryA(path.c_str());
+    if( lib == NULL )
+    {
+	*error = "cannot load plugin '" + path + "'";
+    }
+#else
+    void *lib = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if( lib == NULL )
+    {
+	const char *why = dlerror();
+	*error = "cannot load plugin: " + std::string((why != NULL) ? why : path);
+    }
+#endif
+    return(lib);
+} /* openLib() */
+
+
+/*====================================================================
+*
+* findSymbol
+*	Look up an exported function.
+*
+* Params:
+*	lib			Handle from openLib(),
+*	name			Symbol name.
+*
+* Returns:
+*	Address, or NULL if not found.
+*
+* Notes
+*
+*===================================================================*/
+static void *findSymbol(void *lib, const char *name)
+{
+#ifdef _WIN32
+    return( (void *)GetProcAddress((HMODULE)lib, name) );
+#else
+    return( dlsym(lib, name) );
+#endif
+} /* findSymbol() */
+
+
+/*====================================================================
+*
+* closeLib
+*	Unload a shared object.
+*
+* Params:
+*	lib			Handle from openLib().
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+static void closeLib(void *lib)
+{
+#ifdef _WIN32
+    FreeLibrary((HMODULE)lib);
+#else
+    dlclose(lib);
+#endif
+} /* closeLib() */
+
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
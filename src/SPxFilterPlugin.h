@@ -0,0 +1,88 @@
+/*********************************************************************
+*
+* File: SPxFilterPlugin.h
+*
+* Purpose:
+*	Chain of filter plugins loaded at run time from shared objects
+*	exporting the C interface in SPxFilterPluginAbi.h.
+*
+*	Each plugin is given as "<lib>[:<args>]", e.g.
+*	"./libspxplugin_thresh.so:60", and plugins run in the order
+*	added.  A spoke dropped by one plugin is not given to the rest.
+*
+*	Per-plugin statistics (spokes, drops, time in the plugin) are
+*	kept for the streamers to print.  It does not depend on the SPx
+*	library.
+*
+**********************************************************************/
+
+#ifndef _SPX_FILTER_PLUGIN_H
+#define _SPX_FILTER_PLUGIN_H
+
+#include <stdint.h>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "SPxFilterPluginAbi.h"
+
+class SPxFilterPluginChain
+{
+public:
+    /* Statistics of one plugin since the previous GetStats() call. */
+    struct Stats
+    {
+	std::string name;	/* As given to Add() */
+	uint64_t numSpokes;
+	uint64_t numDropped;
+	double meanUsecs;	/* Time per spoke in the plugin */
+	double maxUsecs;
+    };
+
+    /* Constructor/destructor. */
+    SPxFilterPluginChain(void);
+    ~SPxFilterPluginChain();
+
+    /* Load a plugin and append it to the chain, zero on success or
+     * -1 on error (GetError() says why).
+     */
+    int Add(const char *spec);
+    const char *GetError(void) const { return m_error.c_str(); }
+    int IsEmpty(void) const { return m_plugins.empty(); }
+
+    /* Run the chain on a spoke in place.  Returns zero with the
+     * output length in *numSamples, or -1 if the spoke was dropped.
+     */
+    int Apply(SPxFilterPluginHeader *hdr, uint8_t *samples,
+	      int *numSamples);
+
+    /* Read the statistics, one entry per plugin. */
+    void GetStats(std::vector<Stats> *stats);
+
+private:
+    /* A loaded plugin. */
+    struct Plugin
+    {
+	std::string name;
+	void *lib;
+	void *instance;
+	SPxFilterPluginProcessFn processFn;
+	SPxFilterPluginDestroyFn destroyFn;
+	uint64_t numSpokes;	/* Interval statistics */
+	uint64_t numDropped;
+	double sumUsecs;
+	double maxUsecs;
+    };
+    std::vector<Plugin> m_plugins;
+    uint32_t m_spokeCount;
+    std::string m_error;
+    std::mutex m_mutex;		/* Guards the statistics */
+};
+
+#endif /* _SPX_FILTER_PLUGIN_H */
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
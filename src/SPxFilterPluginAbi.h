@@ -0,0 +1,87 @@
+/*********************************************************************
+*
+* File: SPxFilterPluginAbi.h
+*
+* Purpose:
+*	C interface for filter plugins loaded by the streamers (see
+*	SPxFilterPlugin.h).  A plugin is a shared object exporting:
+*
+*	  uint32_t SPxFilterPluginAbi(void);
+*		Returns SPX_FILTER_PLUGIN_ABI_VERSION.
+*	  void *SPxFilterPluginCreate(const char *args);
+*		Creates an instance from the text after the ':' of
+*		"<lib>:<args>" ("" if none), NULL on error.
+*	  int SPxFilterPluginProcess(void *instance,
+*				     const SPxFilterPluginHeader *hdr,
+*				     SPxFilterPluginSpan *span);
+*		Filters one spoke, returning SPX_FILTER_PLUGIN_KEEP or
+*		SPX_FILTER_PLUGIN_DROP.
+*	  void SPxFilterPluginDestroy(void *instance);
+*
+*	The span holds the spoke's 8-bit samples (first at the start
+*	range), owned by the host.  The plugin filters them in place
+*	and may shorten the span by reducing the count, but must not
+*	move the pointer (the first sample stays at the start range) or
+*	increase the count.  Nothing is copied between plugins in a
+*	chain.
+*
+*	The header gives the spoke's azimuth and range and, where the
+*	source is an SPx one, its SPxReturnHeader, so a plugin may wrap
+*	an SDK process (e.g. from an SPxPluginProcess).  Instances are
+*	called from one thread at a time.
+*
+**********************************************************************/
+
+#ifndef _SPX_FILTER_PLUGIN_ABI_H
+#define _SPX_FILTER_PLUGIN_ABI_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Version of this interface, changed when it changes incompatibly. */
+#define	SPX_FILTER_PLUGIN_ABI_VERSION	1
+
+/* Results of SPxFilterPluginProcess(). */
+#define	SPX_FILTER_PLUGIN_KEEP		0	/* Pass the span on */
+#define	SPX_FILTER_PLUGIN_DROP		1	/* Drop the spoke */
+
+/* Read-only description of a spoke. */
+typedef struct SPxFilterPluginHeader_tag
+{
+    uint32_t structSize;	/* sizeof(SPxFilterPluginHeader) */
+    uint32_t spokeCount;	/* Spokes given to the chain so far */
+    double azimuthDegrees;	/* Clockwise from north */
+    double startRangeMetres;	/* Range of the first sample, or 0 */
+    double endRangeMetres;	/* Range of the last sample, or 0 */
+    const void *sdkHeader;	/* SPxReturnHeader of the spoke, or NULL */
+} SPxFilterPluginHeader;
+
+/* Mutable samples of a spoke. */
+typedef struct SPxFilterPluginSpan_tag
+{
+    uint8_t *samples;
+    uint32_t numSamples;
+} SPxFilterPluginSpan;
+
+/* Exported functions, as looked up by the host. */
+typedef uint32_t (*SPxFilterPluginAbiFn)(void);
+typedef void *(*SPxFilterPluginCreateFn)(const char *args);
+typedef int (*SPxFilterPluginProcessFn)(void *instance,
+					const SPxFilterPluginHeader *hdr,
+					SPxFilterPluginSpan *span);
+typedef void (*SPxFilterPluginDestroyFn)(void *instance);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SPX_FILTER_PLUGIN_ABI_H */
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
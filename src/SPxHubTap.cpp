@@ -0,0 +1,312 @@
+/*********************************************************************
+*
+* File: SPxHubTap.cpp
+*
+* Purpose:
+*	Example subscriber of the spoke fan-out hub (SPxLiveStream -S,
+*	see SPxSpokeHub.h).
+*
+*	Connects to the hub's Unix domain socket, sends a request line
+*	(decimation options) and prints each spoke received as a CSV
+*	line "<channel>,<azimuth>,<end range>,<time ms>,<samples...>",
+*	or with -q a summary per second of spokes, coalesced spokes and
+*	lag.  A delay per spoke (-w) makes it a slow subscriber for
+*	trying the hub's coalescing.
+*
+*	A command line (-c, e.g. "seek=60" with a time-shift store,
+*	SPxLiveStream -H) may be sent after a while (-t); the time from
+*	sending it to the first spoke of the new mode (time-shifted or
+*	live) is printed to stderr.
+*
+*	The program does not need the SPx library.
+*
+*	Run the program with "-?" as the command line option to get a help
+*	message.
+*
+**********************************************************************/
+
+/* Standard headers. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <string>
+#include <vector>
+
+/* Our own headers. */
+#include "SPxSpokeHub.h"
+
+/*
+ * Constants.
+ */
+#define	DEFAULT_PATH	"/tmp/spxhub.sock"
+#define	USAGE "Usage:\n\tSPxHubTap [options]\n"				\
+		"\nOptions:\n"						\
+		"\t-c <command>\tSend this command, e.g. \"seek=60\" or\n" \
+		"\t\t\t\"live\"\n"					\
+		"\t-n <spokes>\tExit after this many spokes\n"		\
+		"\t-q\t\tPrint a summary per second, not the spokes\n" \
+		"\t-r <request>\tRequest, e.g. \"range=4 sector=0-90 every=2\"\n" \
+		"\t\t\t(default \"\", everything)\n"			\
+		"\t-s <path>\tHub socket (default " DEFAULT_PATH ")\n"	\
+		"\t-t <secs>\tSend the command after this long (default 2)\n" \
+		"\t-w <usecs>\tDelay per spoke (a slow subscriber)\n"	\
+		"\t-?\t\tPrint usage information.\n\n"
+
+/*
+ * Private function prototypes.
+ */
+static int readAll(int fd, void *buf, size_t len);
+static double nowSecs(void);
+
+
+/*********************************************************************
+*
+*	Public functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* main
+*	Main entry point for the program.
+*
+* Params:
+*	argc, argv		Command line arguments.
+*
+* Returns:
+*	Zero when the hub closes or enough spokes were read, -1 on error.
+*
+* Notes
+*
+*===================================================================*/
+int main(int argc, char **argv)
+{
+    int c;
+    const char *path = DEFAULT_PATH;
+    const char *request = "";
+    unsigned long long maxSpokes = 0;
+    int quiet = 0;
+    unsigned int delayUsecs = 0;
+    const char *command = NULL;
+    double commandSecs = 2.0;
+
+    /* Process any command line arguments.  */
+    opterr = 0;
+    while( (c = getopt(argc, argv, "c:n:qr:s:t:w:?")) != -1 )
+    {
+	switch(c)
+	{
+	    case 'c':	command = optarg;			break;
+	    case 'n':	maxSpokes = strtoull(optarg, NULL, 0);	break;
+	    case 'q':	quiet = 1;				break;
+	    case 'r':	request = optarg;			break;
+	    case 's':	path = optarg;				break;
+	    case 't':	commandSecs = atof(optarg);		break;
+	    case 'w':	delayUsecs = strtoul(optarg, NULL, 0);	break;
+	    case '?':	/* fall through */
+	    default:
+		fprintf(stderr, "\n%s", USAGE);
+		exit(-1);
+	}
+    } /* end of for each option */
+
+    struct sockaddr_un sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sun_family = AF_UNIX;
+    if( strlen(path) >= sizeof(sa.sun_path) )
+    {
+	fprintf(stderr, "Invalid parameters.\n\n%s", USAGE);
+	exit(-1);
+    }
+    strcpy(sa.sun_path, path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if( (fd < 0) || (connect(fd, (struct sockaddr *)&sa, sizeof(sa)) != 0) )
+    {
+	fprintf(stderr, "Failed to connect to hub '%s'.\n", path);
+	exit(-1);
+    }
+    std::string line = std::string(request) + "\n";
+    if( write(fd, line.c_str(), line.size()) != (ssize_t)line.size() )
+    {
+	fprintf(stderr, "Failed to send request.\n");
+	exit(-1);
+    }
+
+    /* 레코드 헤더와 샘플을 차례로 읽음 */
+    std::vector<unsigned char> samples;
+    std::string out;
+    unsigned long long numSpokes = 0;
+    unsigned long long numCoalesced = 0;
+    unsigned long long intervalSpokes = 0;
+    uint32_t maxLag = 0;
+    double lastReport = nowSecs();
+    double commandAt = lastReport + commandSecs;
+    double commandSent = 0.0;
+    uint32_t commandMagic = 0;
+    int shifted = 0;
+    for(;;)
+    {
+	SPxSpokeHubRecord rec;
+	if( readAll(fd, &rec, sizeof(rec)) != 0 )
+	{
+	    break;
+	}
+	if( (rec.magic != SPX_SPOKE_HUB_MAGIC)
+	    && (rec.magic != SPX_SPOKE_HUB_MAGIC_SHIFTED) )
+	{
+	    fprintf(stderr, "Bad record from hub.\n");
+	    exit(-1);
+	}
+	shifted = (rec.magic == SPX_SPOKE_HUB_MAGIC_SHIFTED);
+	samples.resize(rec.numSamples);
+	if( (rec.numSamples > 0)
+	    && (readAll(fd, &samples[0], rec.numSamples) != 0) )
+	{
+	    break;
+	}
+	numSpokes++;
+	intervalSpokes++;
+	numCoalesced += rec.numCoalesced;
+	if( rec.lag > maxLag )
+	{
+	    maxLag = rec.lag;
+	}
+
+	if( !quiet )
+	{
+	    char buf[64];
+	    snprintf(buf, sizeof(buf), "%u,%.2f,%.1f,%lld", rec.channel,
+		     rec.azimuth * 360.0 / 65536.0, rec.endRange,
+		     (long long)rec.timeMs);
+	    out = buf;
+	    for(unsigned int i = 0; i < rec.numSamples; i++)
+	    {
+		snprintf(buf, sizeof(buf), ",%u", samples[i]);
+		out += buf;
+	    }
+	    out += '\n';
+	    fwrite(out.data(), 1, out.size(), stdout);
+	}
+	else
+	{
+	    double now = nowSecs();
+	    if( now - lastReport >= 1.0 )
+	    {
+		printf("%.1f spokes/s, %llu coalesced, max lag %u spokes%s\n",
+		       intervalSpokes / (now - lastReport), numCoalesced, maxLag,
+		       shifted ? " (time-shifted)" : "");
+		fflush(stdout);
+		intervalSpokes = 0;
+		numCoalesced = 0;
+		maxLag = 0;
+		lastReport = now;
+	    }
+	}
+
+	/* 명령 후 새 모드의 첫 스포크까지 시간 */
+	if( (commandSent > 0.0) && (rec.magic == commandMagic) )
+	{
+	    fprintf(stderr, "Command \"%s\": first spoke after %.2f ms.\n",
+		    command, (nowSecs() - commandSent) * 1000.0);
+	    commandSent = 0.0;
+	}
+	if( (command != NULL) && (commandAt > 0.0) && (nowSecs() >= commandAt) )
+	{
+	    line = std::string(command) + "\n";
+	    commandSent = nowSecs();
+	    commandMagic = (strncmp(command, "live", 4) == 0)
+		? SPX_SPOKE_HUB_MAGIC : SPX_SPOKE_HUB_MAGIC_SHIFTED;
+	    commandAt = 0.0;
+	    if( write(fd, line.c_str(), line.size()) != (ssize_t)line.size() )
+	    {
+		fprintf(stderr, "Failed to send command.\n");
+		exit(-1);
+	    }
+	}
+
+	if( (maxSpokes > 0) && (numSpokes >= maxSpokes) )
+	{
+	    break;
+	}
+	if( delayUsecs > 0 )
+	{
+	    usleep(delayUsecs);
+	}
+    }
+
+    close(fd);
+    fflush(stdout);
+    return(0);
+} /* main() */
+
+
+/*********************************************************************
+*
+*	Private functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* readAll
+*	Read exactly len bytes.
+*
+* Params:
+*	fd			Socket,
+*	buf, len		Where to read to.
+*
+* Returns:
+*	Zero on success, -1 if closed or on error.
+*
+* Notes
+*
+*===================================================================*/
+static int readAll(int fd, void *buf, size_t len)
+{
+    unsigned char *p = (unsigned char *)buf;
+    while( len > 0 )
+    {
+	ssize_t n = read(fd, p, len);
+	if( n <= 0 )
+	{
+	    return(-1);
+	}
+	p += n;
+	len -= (size_t)n;
+    }
+    return(0);
+} /* readAll() */
+
+
+/*====================================================================
+*
+* nowSecs
+*	Get a monotonic time.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Seconds.
+*
+* Notes
+*
+*===================================================================*/
+static double nowSecs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return(ts.tv_sec + ts.tv_nsec / 1e9);
+} /* nowSecs() */
+
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
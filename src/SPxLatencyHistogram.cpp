@@ -0,0 +1,344 @@
+/*********************************************************************
+*
+* File: SPxLatencyHistogram.cpp
+*
+* Purpose:
+*	Latency histogram (see SPxLatencyHistogram.h).
+*
+**********************************************************************/
+
+/* Standard headers. */
+#include <string.h>
+
+/* Our own header. */
+#include "SPxLatencyHistogram.h"
+
+/*
+ * Constants.
+ */
+/* Buckets: values below SUB_COUNT are exact, each doubling above is
+ * split in HALF_COUNT, up to 2^MAX_BITS microseconds.
+ */
+#define	SUB_BITS		7
+#define	SUB_COUNT		(1u << SUB_BITS)
+#define	HALF_COUNT		(SUB_COUNT / 2)
+#define	MAX_BITS		40
+#define	NUM_BUCKETS		(SUB_COUNT + (MAX_BITS - SUB_BITS + 1) * HALF_COUNT)
+
+/* Percentile distribution ticks per halving of the remainder. */
+#define	TICKS_PER_HALF		2
+
+
+/*====================================================================
+*
+* SPxLatencyHistogram::SPxLatencyHistogram
+*	Constructor.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+SPxLatencyHistogram::SPxLatencyHistogram(void)
+    : m_counts(NUM_BUCKETS, 0),
+      m_count(0),
+      m_min(0),
+      m_max(0),
+      m_sum(0.0)
+{
+} /* SPxLatencyHistogram::SPxLatencyHistogram() */
+
+
+/*====================================================================
+*
+* SPxLatencyHistogram::~SPxLatencyHistogram
+*	Destructor.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+SPxLatencyHistogram::~SPxLatencyHistogram()
+{
+} /* SPxLatencyHistogram::~SPxLatencyHistogram() */
+
+
+/*====================================================================
+*
+* SPxLatencyHistogram::Record
+*	Count a value.
+*
+* Params:
+*	usecs			Latency, microseconds.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Not thread safe; the caller guards the histogram.
+*
+*===================================================================*/
+void SPxLatencyHistogram::Record(int64_t usecs)
+{
+    if( usecs < 0 )
+    {
+	usecs = 0;
+    }
+    m_counts[indexOf(usecs)]++;
+    if( (m_count == 0) || (usecs < m_min) )
+    {
+	m_min = usecs;
+    }
+    if( usecs > m_max )
+    {
+	m_max = usecs;
+    }
+    m_sum += (double)usecs;
+    m_count++;
+} /* SPxLatencyHistogram::Record() */
+
+
+/*====================================================================
+*
+* SPxLatencyHistogram::Reset
+*	Forget all values.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+void SPxLatencyHistogram::Reset(void)
+{
+    memset(&m_counts[0], 0, m_counts.size() * sizeof(m_counts[0]));
+    m_count = 0;
+    m_min = 0;
+    m_max = 0;
+    m_sum = 0.0;
+} /* SPxLatencyHistogram::Reset() */
+
+
+/*====================================================================
+*
+* SPxLatencyHistogram::GetMean
+*	Mean of the values.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Mean, microseconds, 0 if none.
+*
+* Notes
+*
+*===================================================================*/
+double SPxLatencyHistogram::GetMean(void) const
+{
+    return( (m_count > 0) ? (m_sum / (double)m_count) : 0.0 );
+} /* SPxLatencyHistogram::GetMean() */
+
+
+/*====================================================================
+*
+* SPxLatencyHistogram::GetPercentile
+*	Value at a percentile.
+*
+* Params:
+*	percentile		0 to 100.
+*
+* Returns:
+*	The highest value of the bucket holding the percentile (capped
+*	at the maximum recorded), microseconds, 0 if none.
+*
+* Notes
+*
+*===================================================================*/
+int64_t SPxLatencyHistogram::GetPercentile(double percentile) const
+{
+    if( m_count == 0 )
+    {
+	return(0);
+    }
+    if( percentile > 100.0 )
+    {
+	percentile = 100.0;
+    }
+    uint64_t wanted = (uint64_t)((percentile / 100.0) * (double)m_count + 0.5);
+    if( wanted < 1 )
+    {
+	wanted = 1;
+    }
+    uint64_t total = 0;
+    for(unsigned int i = 0; i < m_counts.size(); i++)
+    {
+	total += m_counts[i];
+	if( total >= wanted )
+	{
+	    int64_t value = highestOf(i);
+	    return( (value < m_max) ? value : m_max );
+	}
+    }
+    return(m_max);
+} /* SPxLatencyHistogram::GetPercentile() */
+
+
+/*====================================================================
+*
+* SPxLatencyHistogram::Print
+*	Write the summary and percentile distribution.
+*
+* Params:
+*	file			Where to write,
+*	title			First line.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	The distribution has TICKS_PER_HALF lines per halving of what
+*	is left above the percentile (50, 75, 87.5, ... 100), with the
+*	value, percentile, count up to it and 1/(1-percentile), as
+*	HdrHistogram's percentile output.
+*
+*===================================================================*/
+void SPxLatencyHistogram::Print(FILE *file, const char *title) const
+{
+    fprintf(file, "%s: %llu values, min %.3f ms, mean %.3f ms, max %.3f ms.\n",
+	    title, (unsigned long long)m_count, GetMin() / 1000.0,
+	    GetMean() / 1000.0, m_max / 1000.0);
+    if( m_count == 0 )
+    {
+	return;
+    }
+    fprintf(file, "  p50 %.3f  p90 %.3f  p99 %.3f  p99.9 %.3f  p99.99 %.3f"
+	    "  p99.999 %.3f ms\n", GetPercentile(50.0) / 1000.0,
+	    GetPercentile(90.0) / 1000.0, GetPercentile(99.0) / 1000.0,
+	    GetPercentile(99.9) / 1000.0, GetPercentile(99.99) / 1000.0,
+	    GetPercentile(99.999) / 1000.0);
+    fprintf(file, "  %12s %14s %12s %16s\n", "Value(ms)", "Percentile",
+	    "TotalCount", "1/(1-Percentile)");
+
+    /* 남은 부분이 절반씩 줄어드는 눈금마다 한 줄 */
+    double percentile = 0.0;
+    double step = 50.0 / TICKS_PER_HALF;
+    double reported = 0.0;
+    uint64_t total = 0;
+    unsigned int i = 0;
+    for(;;)
+    {
+	uint64_t wanted = (uint64_t)((percentile / 100.0) * (double)m_count + 0.5);
+	if( wanted < 1 )
+	{
+	    wanted = 1;
+	}
+	while( (total < wanted) && (i < m_counts.size()) )
+	{
+	    total += m_counts[i++];
+	}
+	int64_t value = (i > 0) ? highestOf(i - 1) : 0;
+	if( value > m_max )
+	{
+	    value = m_max;
+	}
+	double actual = 100.0 * (double)total / (double)m_count;
+	if( (actual < 100.0) && (actual >= reported) )
+	{
+	    fprintf(file, "  %12.3f %14.6f %12llu %16.2f\n", value / 1000.0,
+		    actual / 100.0, (unsigned long long)total,
+		    1.0 / (1.0 - actual / 100.0));
+	    reported = actual;
+	}
+	if( total >= m_count )
+	{
+	    break;
+	}
+	percentile += step;
+	if( percentile >= 100.0 - 2.0 * step + 1e-9 )
+	{
+	    step /= 2.0;
+	}
+    }
+    fprintf(file, "  %12.3f %14.6f %12llu %16s\n", m_max / 1000.0, 1.0,
+	    (unsigned long long)m_count, "inf");
+} /* SPxLatencyHistogram::Print() */
+
+
+/*====================================================================
+*
+* SPxLatencyHistogram::indexOf
+*	Bucket of a value.
+*
+* Params:
+*	usecs			Value, not negative.
+*
+* Returns:
+*	Bucket index.
+*
+* Notes
+*	Values past the range go in the last bucket.
+*
+*===================================================================*/
+unsigned int SPxLatencyHistogram::indexOf(int64_t usecs)
+{
+    uint64_t v = (uint64_t)usecs;
+    if( v < SUB_COUNT )
+    {
+	return( (unsigned int)v );
+    }
+    unsigned int msb = 63;
+    while( !(v & (1ull << msb)) )
+    {
+	msb--;
+    }
+    /* v >> shift 는 HALF_COUNT..SUB_COUNT-1 */
+    unsigned int shift = msb - (SUB_BITS - 1);
+    unsigned int idx = SUB_COUNT + (shift - 1) * HALF_COUNT
+	+ (unsigned int)((v >> shift) - HALF_COUNT);
+    return( (idx < NUM_BUCKETS) ? idx : (NUM_BUCKETS - 1) );
+} /* SPxLatencyHistogram::indexOf() */
+
+
+/*====================================================================
+*
+* SPxLatencyHistogram::highestOf
+*	Highest value of a bucket.
+*
+* Params:
+*	idx			Bucket index.
+*
+* Returns:
+*	Value, microseconds.
+*
+* Notes
+*
+*===================================================================*/
+int64_t SPxLatencyHistogram::highestOf(unsigned int idx)
+{
+    if( idx < SUB_COUNT )
+    {
+	return( (int64_t)idx );
+    }
+    unsigned int shift = (idx - SUB_COUNT) / HALF_COUNT + 1;
+    uint64_t sub = (idx - SUB_COUNT) % HALF_COUNT + HALF_COUNT;
+    return( (int64_t)(((sub + 1) << shift) - 1) );
+} /* SPxLatencyHistogram::highestOf() */
+
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
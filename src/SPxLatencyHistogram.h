@@ -0,0 +1,68 @@
+/*********************************************************************
+*
+* File: SPxLatencyHistogram.h
+*
+* Purpose:
+*	Latency histogram in the style of HdrHistogram: values in
+*	microseconds are counted in buckets of constant relative width
+*	(1/64, under 1.6% error) from 1 us to about 12 days, in a fixed
+*	array, so recording is an increment with no allocation and the
+*	high percentiles are as exact as the low ones.
+*
+*	Print() writes the percentile distribution with the halving
+*	ticks (50%, 75%, 87.5%, ...) that HdrHistogram's tools plot.
+*	It does not depend on the SPx library.
+*
+**********************************************************************/
+
+#ifndef _SPX_LATENCY_HISTOGRAM_H
+#define _SPX_LATENCY_HISTOGRAM_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+class SPxLatencyHistogram
+{
+public:
+    /* Constructor/destructor. */
+    SPxLatencyHistogram(void);
+    ~SPxLatencyHistogram();
+
+    /* Count a value (negative values count as 0). */
+    void Record(int64_t usecs);
+
+    /* Forget all values. */
+    void Reset(void);
+
+    /* Values counted, and their minimum, maximum and mean. */
+    uint64_t GetCount(void) const { return m_count; }
+    int64_t GetMin(void) const { return (m_count > 0) ? m_min : 0; }
+    int64_t GetMax(void) const { return m_max; }
+    double GetMean(void) const;
+
+    /* Value at a percentile (0 to 100), the top of its bucket. */
+    int64_t GetPercentile(double percentile) const;
+
+    /* Write the summary and percentile distribution, in milliseconds. */
+    void Print(FILE *file, const char *title) const;
+
+private:
+    std::vector<uint64_t> m_counts;
+    uint64_t m_count;
+    int64_t m_min;
+    int64_t m_max;
+    double m_sum;
+
+    /* Private functions. */
+    static unsigned int indexOf(int64_t usecs);
+    static int64_t highestOf(unsigned int idx);
+};
+
+#endif /* _SPX_LATENCY_HISTOGRAM_H */
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
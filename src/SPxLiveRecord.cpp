@@ -0,0 +1,410 @@
+/*********************************************************************
+*
+* File: SPxLiveRecord.cpp
+*
+* Purpose:
+*	Recording sink for the streamers (see SPxLiveRecord.h).
+*
+**********************************************************************/
+
+/* Standard headers. */
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+/* Our own header. */
+#include "SPxLiveRecord.h"
+
+/*
+ * Private function prototypes.
+ */
+static int64_t nowUsecs(void);
+
+
+/*********************************************************************
+*
+*	Public functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* SPxLiveRecord::SPxLiveRecord
+*	Constructor.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Nothing is recorded until Create() succeeds.
+*
+*===================================================================*/
+SPxLiveRecord::SPxLiveRecord(void)
+    : m_channel(0),
+      m_maxSpokes(SPX_LIVE_RECORD_QUEUE),
+      m_record(NULL),
+      m_numQueued(0),
+      m_maxQueued(0),
+      m_numWritten(0),
+      m_lastWritten(0),
+      m_numDropped(0),
+      m_numErrors(0),
+      m_bandwidth(0.0),
+      m_compression(0.0),
+      m_numFiles(0),
+      m_lastStatsUsecs(nowUsecs()),
+      m_stop(0)
+{
+    m_fileName[0] = '\0';
+} /* SPxLiveRecord::SPxLiveRecord() */
+
+
+/*====================================================================
+*
+* SPxLiveRecord::~SPxLiveRecord
+*	Destructor.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	The writer thread writes what is queued before it stops.
+*
+*===================================================================*/
+SPxLiveRecord::~SPxLiveRecord()
+{
+    {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_stop = 1;
+    }
+    m_ready.notify_one();
+    if( m_thread.joinable() )
+    {
+	m_thread.join();
+    }
+    if( m_record != NULL )
+    {
+	m_record->CloseFile();
+	delete m_record;
+    }
+} /* SPxLiveRecord::~SPxLiveRecord() */
+
+
+/*====================================================================
+*
+* SPxLiveRecord::Create
+*	Start recording.
+*
+* Params:
+*	spec			"<prefix>[,option...]"
+*				(see SPxLiveRecord.h).
+*
+* Returns:
+*	Zero on success, -1 on error.
+*
+* Notes
+*	SPxRecord opens its first file with the first spoke.
+*
+*===================================================================*/
+int SPxLiveRecord::Create(const char *spec)
+{
+    if( m_record != NULL )
+    {
+	m_error = "recording already created";
+	return(-1);
+    }
+    std::string text = (spec != NULL) ? spec : "";
+    m_error = "invalid recording '" + text + "'";
+
+    /* 파일 접두어 다음에 쉼표로 구분된 옵션 */
+    std::string prefix = text.substr(0, text.find(','));
+    if( prefix.empty() )
+    {
+	return(-1);
+    }
+    int maxMB = 0;
+    int maxSecs = 0;
+    int tocSecs = SPX_LIVE_RECORD_TOC_SECS;
+    size_t pos = text.find(',');
+    while( pos != std::string::npos )
+    {
+	size_t next = text.find(',', pos + 1);
+	std::string opt = text.substr(pos + 1, (next == std::string::npos)
+				      ? std::string::npos : (next - pos - 1));
+	size_t eq = opt.find('=');
+	if( (eq == std::string::npos) || (eq + 1 >= opt.size()) )
+	{
+	    return(-1);
+	}
+	std::string value = opt.substr(eq + 1);
+	opt = opt.substr(0, eq);
+	char *end = NULL;
+	unsigned long n = strtoul(value.c_str(), &end, 0);
+	if( *end != '\0' )
+	{
+	    return(-1);
+	}
+	if( (opt == "mb") && (n >= 1) && (n <= 1000000) )
+	{
+	    maxMB = (int)n;
+	}
+	else if( (opt == "secs") && (n >= 1) && (n <= 31 * 86400) )
+	{
+	    maxSecs = (int)n;
+	}
+	else if( (opt == "toc") && (n >= 1) && (n <= 3600) )
+	{
+	    tocSecs = (int)n;
+	}
+	else if( (opt == "queue") && (n >= 16) && (n <= 1048576) )
+	{
+	    m_maxSpokes = (unsigned int)n;
+	}
+	else if( (opt == "ch") && (n < 65536) )
+	{
+	    m_channel = (unsigned int)n;
+	}
+	else
+	{
+	    return(-1);
+	}
+	pos = next;
+    }
+
+    m_record = new SPxRecord();
+    if( (m_record->SetFilePrefix(prefix.c_str()) != SPX_NO_ERROR)
+	|| ((maxMB > 0) && (m_record->SetMaxFileSizeMB(maxMB) != SPX_NO_ERROR))
+	|| ((maxSecs > 0)
+	    && (m_record->SetMaxFileSizeSeconds(maxSecs) != SPX_NO_ERROR))
+	|| (m_record->SetTOCWriteIntervalSecs(tocSecs) != SPX_NO_ERROR) )
+    {
+	m_error = "cannot set up recording '" + text + "'";
+	delete m_record;
+	m_record = NULL;
+	return(-1);
+    }
+    m_queue.reserve(m_maxSpokes);
+    m_batch.reserve(m_maxSpokes);
+    m_spec = text;
+    m_error.clear();
+    m_lastStatsUsecs = nowUsecs();
+    m_thread = std::thread(&SPxLiveRecord::writerThread, this);
+    return(0);
+} /* SPxLiveRecord::Create() */
+
+
+/*====================================================================
+*
+* SPxLiveRecord::Record
+*	Queue a received spoke.
+*
+* Params:
+*	hdr			Received spoke header,
+*	data			Its data, packed as hdr->packing.
+*
+* Returns:
+*	Zero if queued, -1 if dropped (queue full or not created).
+*
+* Notes
+*	Called on the receive thread; only copies the spoke, reusing a
+*	spare buffer when there is one big enough.
+*
+*===================================================================*/
+int SPxLiveRecord::Record(const SPxReturnHeader *hdr,
+			  const unsigned char *data)
+{
+    if( m_record == NULL )
+    {
+	return(-1);
+    }
+    unsigned int numBytes = SPxGetPackingNumBytes(hdr->packing, hdr->thisLength);
+    SPxTime_t now;
+    SPxTimeGetEpoch(&now);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if( m_numQueued >= m_maxSpokes )
+    {
+	m_numDropped++;
+	return(-1);
+    }
+    if( m_numQueued == m_queue.size() )
+    {
+	m_queue.push_back(Spoke());
+    }
+    Spoke *spoke = &m_queue[m_numQueued++];
+    size_t size = sizeof(SPxReturnHeader) + numBytes;
+    if( spoke->rtn.size() < size )
+    {
+	spoke->rtn.resize(size);
+    }
+
+    /* 헤더 크기 필드는 실제 데이터에 맞춤 */
+    SPxReturnHeader *out = (SPxReturnHeader *)&spoke->rtn[0];
+    *out = *hdr;
+    out->headerSize = sizeof(SPxReturnHeader);
+    out->radarVideoSize = (UINT16)numBytes;
+    out->totalSize = (UINT32)size;
+    if( numBytes > 0 )
+    {
+	memcpy(&spoke->rtn[sizeof(SPxReturnHeader)], data, numBytes);
+    }
+    spoke->time = now;
+    if( m_numQueued > m_maxQueued )
+    {
+	m_maxQueued = (unsigned int)m_numQueued;
+    }
+    if( m_numQueued == 1 )
+    {
+	m_ready.notify_one();
+    }
+    return(0);
+} /* SPxLiveRecord::Record() */
+
+
+/*====================================================================
+*
+* SPxLiveRecord::GetStats
+*	Read the statistics.
+*
+* Params:
+*	stats			Filled in.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	The SPxRecord status is as of the writer's last batch, so this
+*	never waits for the disk.
+*
+*===================================================================*/
+void SPxLiveRecord::GetStats(Stats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    std::lock_guard<std::mutex> lock(m_mutex);
+    int64_t now = nowUsecs();
+    double secs = (double)(now - m_lastStatsUsecs) / 1e6;
+    if( secs > 0.0 )
+    {
+	stats->spokesPerSec = (double)(m_numWritten - m_lastWritten) / secs;
+    }
+    stats->bandwidth = m_bandwidth;
+    stats->compression = m_compression;
+    stats->queueDepth = (unsigned int)m_numQueued;
+    stats->maxQueueDepth = m_maxQueued;
+    stats->numFiles = m_numFiles;
+    stats->numDropped = m_numDropped;
+    stats->numErrors = m_numErrors;
+    memcpy(stats->fileName, m_fileName, sizeof(stats->fileName));
+    stats->fileName[sizeof(stats->fileName) - 1] = '\0';
+    m_lastWritten = m_numWritten;
+    m_maxQueued = (unsigned int)m_numQueued;
+    m_lastStatsUsecs = now;
+} /* SPxLiveRecord::GetStats() */
+
+
+/*********************************************************************
+*
+*	Private functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* SPxLiveRecord::writerThread
+*	Write queued spokes to disk until stopped.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	The whole queue is taken at once, as in SPxStreamOutput, so the
+*	receive thread only waits for the swap.  The written spokes keep
+*	their buffers for reuse.
+*
+*===================================================================*/
+void SPxLiveRecord::writerThread(void)
+{
+    size_t numBatch = 0;
+    for(;;)
+    {
+	{
+	    std::unique_lock<std::mutex> lock(m_mutex);
+	    while( (m_numQueued == 0) && !m_stop )
+	    {
+		m_ready.wait(lock);
+	    }
+	    if( m_numQueued == 0 )
+	    {
+		return;
+	    }
+	    m_batch.swap(m_queue);
+	    numBatch = m_numQueued;
+	    m_numQueued = 0;
+	}
+
+	/* 디스크 쓰기는 잠금 밖에서 */
+	unsigned int numErrors = 0;
+	for(size_t i = 0; i < numBatch; i++)
+	{
+	    if( m_record->RecordReturn((SPxReturn *)&m_batch[i].rtn[0], 0,
+				       &m_batch[i].time) != SPX_NO_ERROR )
+	    {
+		numErrors++;
+	    }
+	}
+	double bandwidth = m_record->GetStatusBandwidth();
+	double compression = m_record->GetStatusCompressionRatio();
+	unsigned int numFiles = m_record->GetSessionNumFiles();
+	char fileName[sizeof(m_fileName)];
+	if( m_record->GetFilename(fileName, sizeof(fileName)) != SPX_NO_ERROR )
+	{
+	    fileName[0] = '\0';
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_numWritten += numBatch - numErrors;
+	m_numErrors += numErrors;
+	m_bandwidth = bandwidth;
+	m_compression = compression;
+	m_numFiles = numFiles;
+	memcpy(m_fileName, fileName, sizeof(m_fileName));
+	m_fileName[sizeof(m_fileName) - 1] = '\0';
+    }
+} /* SPxLiveRecord::writerThread() */
+
+
+/*====================================================================
+*
+* nowUsecs
+*	Get the monotonic time.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Microseconds.
+*
+* Notes
+*
+*===================================================================*/
+static int64_t nowUsecs(void)
+{
+    return( std::chrono::duration_cast<std::chrono::microseconds>(
+	std::chrono::steady_clock::now().time_since_epoch()).count() );
+} /* nowUsecs() */
+
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
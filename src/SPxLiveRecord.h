@@ -0,0 +1,131 @@
+/*********************************************************************
+*
+* File: SPxLiveRecord.h
+*
+* Purpose:
+*	Recording sink for the streamers: received spokes of a channel
+*	are written to rotating .cpr files with SPxRecord, which
+*	SPxDataStream (or any SPx replay) plays back.
+*
+*	A recording is given as "<prefix>[,option...]" with the
+*	options:
+*
+*	    mb=<n>		Start a new file after this many MB
+*	    secs=<n>		Start a new file after this many seconds
+*	    toc=<secs>		Table of contents interval, for seeking
+*				(default 10)
+*	    queue=<n>		Spokes queued for the disk (default 8192)
+*	    ch=<n>		Channel to record (default 0)
+*
+*	Record() only copies the spoke into a bounded queue; a thread of
+*	its own writes the queue to disk, so a disk stall never holds up
+*	the receive thread.  When the queue is full the spoke is dropped
+*	and counted.  The files hold the channel as channel 0.
+*
+**********************************************************************/
+
+#ifndef _SPX_LIVE_RECORD_H
+#define _SPX_LIVE_RECORD_H
+
+#include <stdint.h>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* SPx library types (SPxReturnHeader, SPxRecord etc.). */
+#include "SPx.h"
+
+/* Defaults for the options. */
+#define	SPX_LIVE_RECORD_TOC_SECS	10
+#define	SPX_LIVE_RECORD_QUEUE		8192
+
+class SPxLiveRecord
+{
+public:
+    /* Statistics; rates cover the time since the previous GetStats(). */
+    struct Stats
+    {
+	double spokesPerSec;		/* Written to disk */
+	double bandwidth;		/* SPxRecord's GetStatusBandwidth() */
+	double compression;		/* SPxRecord's compression ratio */
+	unsigned int queueDepth;	/* Spokes waiting now */
+	unsigned int maxQueueDepth;	/* Most waiting since the last call */
+	unsigned int numFiles;		/* Files this session */
+	uint64_t numDropped;		/* Queue full, total */
+	uint64_t numErrors;		/* RecordReturn() failed, total */
+	char fileName[256];		/* File being written */
+    };
+
+    /* Constructor/destructor.  The destructor writes the spokes still
+     * queued and closes the file.
+     */
+    SPxLiveRecord(void);
+    ~SPxLiveRecord();
+
+    /* Start recording (see above).  Zero on success or -1 on error (see
+     * GetError()).  The SPx library must be initialised.
+     */
+    int Create(const char *spec);
+    const char *GetError(void) const { return m_error.c_str(); }
+
+    /* Recording description and the channel it records. */
+    const char *GetSpec(void) const { return m_spec.c_str(); }
+    unsigned int GetChannel(void) const { return m_channel; }
+
+    /* Queue a received spoke (from the receive thread).  Zero if
+     * queued, -1 if dropped.
+     */
+    int Record(const SPxReturnHeader *hdr, const unsigned char *data);
+
+    /* Read the statistics. */
+    void GetStats(Stats *stats);
+
+private:
+    /* A queued spoke: SPxReturn (header and data) and receive time. */
+    struct Spoke
+    {
+	std::vector<unsigned char> rtn;
+	SPxTime_t time;
+    };
+
+    /* Recording. */
+    std::string m_spec;
+    std::string m_error;
+    unsigned int m_channel;
+    unsigned int m_maxSpokes;
+    SPxRecord *m_record;		/* Only used on the writer thread */
+    std::thread m_thread;
+
+    /* Queue (m_numQueued used, rest spare with their buffers), the
+     * writer's batch and the statistics, guarded by the mutex.
+     */
+    std::mutex m_mutex;
+    std::condition_variable m_ready;
+    std::vector<Spoke> m_queue;
+    size_t m_numQueued;
+    std::vector<Spoke> m_batch;
+    unsigned int m_maxQueued;
+    uint64_t m_numWritten;
+    uint64_t m_lastWritten;		/* At the previous GetStats() */
+    uint64_t m_numDropped;
+    uint64_t m_numErrors;
+    double m_bandwidth;			/* Copied from m_record per batch */
+    double m_compression;
+    unsigned int m_numFiles;
+    char m_fileName[256];
+    int64_t m_lastStatsUsecs;
+    int m_stop;
+
+    /* Private functions. */
+    void writerThread(void);
+};
+
+#endif /* _SPX_LIVE_RECORD_H */
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
@@ -40,13 +40,15 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <atomic>
+#include <vector>
 #include <time.h>
+#include <signal.h>
 #ifdef _WIN32
 #include "stdafx.h"
 #include <direct.h>  // Windows의 _mkdir를 위해 추가
 #else
 #include <unistd.h>
-#include <signal.h>
 #include <errno.h>
 #include <sys/stat.h>  // Linux의 mkdir를 위해 추가
 #include <sys/types.h> // Linux의 mkdir를 위해 추가
@@ -58,19 +60,126 @@
 #include "SPxLibUtils/SPxGetOpt.h"
 #endif
 
+/* Spoke processing (filters, plugins, integration), plots and tracks,
+ * the native batched receiver, the multiplexed output, the spoke
+ * fan-out hub and its time-shift store, video republishing, the browser viewer server and
+ * receive telemetry.
+ */
+#include "SPxBatchReceive.h"
+#include "SPxFilterPlugin.h"
+#include "SPxLiveRecord.h"
+#include "SPxPlotExtract.h"
+#include "SPxRealtime.h"
+#include "SPxSpokeHub.h"
+#include "SPxSpokeProcess.h"
+#include "SPxSpokeTelemetry.h"
+#include "SPxStreamOutput.h"
+#include "SPxTimeShift.h"
+#include "SPxTrackOutput.h"
+#include "SPxVideoRepublish.h"
+#include "SPxWebStream.h"
+
 /*
  * Constants.
  */
 #define	USAGE "Usage:\n\tSPxLiveStream [options]\n"			\
 		"\nOptions:\n"						\
-		"\t-a <addr>\tSet address for receiving radar data\n"	\
+		"\t-a <addr>[:port][@ifAddr]\n"				\
+		"\t\t\tAdd a radar source (channel), may be repeated\n" \
+		"\t-B <batch>[,MB]\tReceive natively, batch datagrams per\n" \
+		"\t\t\tsystem call, MB receive buffer (default 32)\n" \
+		"\t-C <clutter>\tAdaptive clutter map, e.g. \"sub,4,10\"\n"	\
 		"\t-d <flags>\tSet debug flags\n"			\
+		"\t-E <extract>\tPlot level[,min samples], e.g. \"100,4\"\n" \
+		"\t-F <filters>\tFilter spokes before output, e.g.\n"	\
+		"\t\t\t\"blank:0-150;stc:400,30;median:3;thresh:40\"\n" \
+		"\t-H <store>\tKeep the last minutes of spokes for hub (-S)\n" \
+		"\t\t\tsubscribers to rewind, e.g. \"10,mb=512,zlib\"\n" \
+		"\t-I <integ>\tIntegrate over rotations, e.g. \"mean,4\",\n" \
+		"\t\t\t\"max,4\" or \"mofn,5,3,40\"\n"		\
 		"\t-i <ifAddr>\tSet interface address for multicast\n"	\
-		"\t-p <port>\tSet port for receiving radar data\n"	\
+		"\t-K <cpus>\tPin the receive threads (-B) to these cores,\n" \
+		"\t\t\tone per source in order, e.g. \"2,3\"\n"	\
+		"\t-L <plugin>\tChain a filter plugin, \"<lib>[:<args>]\",\n"	\
+		"\t\t\te.g. \"./libspxplugin_thresh.so:60,4\"\n"	\
+		"\t-M <file>\tLoad/save the clutter map in this file\n" \
+		"\t-N\t\tNo video output (e.g. for plot extraction only)\n" \
+		"\t-O <record>\tRecord a channel to rotating .cpr files, e.g.\n" \
+		"\t\t\t\"/data/radar,secs=3600,ch=0\"\n"		\
+		"\t-P <file>\tExtract plots to this file (CSV if *.csv)\n" \
+		"\t-p <port>\tSet default port for receiving radar data\n" \
+		"\t-Q <mode>\tReal-time mode, \"on\" or e.g.\n"	\
+		"\t\t\t\"rx=2:3,writer=4,prio=50,rcvbuf=64\" (pinned\n" \
+		"\t\t\tSCHED_FIFO threads, locked memory)\n"	\
+		"\t-R <link>\tRepublish the processed video, may be repeated,\n" \
+		"\t\t\te.g. \"239.192.50.1:5000,zlib,rr=2\" or\n"	\
+		"\t\t\t\"127.0.0.1:5001,cat240,ch=1\"\n"		\
+		"\t-S <path>\tServe spokes to local subscribers on this\n" \
+		"\t\t\tUnix domain socket (see SPxHubTap)\n"		\
+		"\t-T <file>\tTrack the plots, reports to this file\n"	\
+		"\t-U <addr:port>\tSend SPx track reports to this address\n" \
 		"\t-v\t\tIncrease verbosity\n"				\
+		"\t-W <server>\tServe a channel to browsers, e.g.\n"	\
+		"\t\t\t\"8080,html=SPxWebViewer.html,fps=10\"\n"	\
+		"\t-Y <dest>\tWrite receive telemetry lines to \"stderr\" or\n" \
+		"\t\t\t\"<addr>:<port>\" (UDP), e.g. \"stderr,secs=5\"\n" \
 		"\t-x\t\tReceive ASTERIX Cat-240 radar video\n"		\
 		"\t-?\t\tPrint usage information.\n\n"
 
+/* Azimuth bins per turn for scan-to-scan integration. */
+#define	INTEGRATION_AZIS	4096
+
+/* Azimuth bins per turn for a new clutter map, and how often the map
+ * is saved to its file (as well as on exit), in main loop passes.
+ */
+#define	CLUTTER_AZIS		4096
+#define	CLUTTER_SAVE_PASSES	600	/* 60 seconds */
+
+/* Plot extraction level if -E is not given, and how often plot
+ * statistics are printed, in main loop passes.
+ */
+#define	DEFAULT_PLOT_EXTRACT	"128"
+#define	PLOT_REPORT_PASSES	50	/* 5 seconds */
+
+/* How often filter plugin statistics are printed, in main loop passes. */
+#define	PLUGIN_REPORT_PASSES	50	/* 5 seconds */
+
+/* How often receive statistics (per channel, and native receive for
+ * -B) are printed, in main loop passes.
+ */
+#define	RECEIVE_REPORT_PASSES	50	/* 5 seconds */
+
+/* How often spoke hub (-S) subscriber statistics are printed, in main
+ * loop passes.
+ */
+#define	HUB_REPORT_PASSES	50	/* 5 seconds */
+
+/* How often video republish (-R) bandwidth is printed, in main loop
+ * passes.
+ */
+#define	REPUBLISH_REPORT_PASSES	50	/* 5 seconds */
+
+/* How often browser viewer (-W) client statistics are printed, in main
+ * loop passes.
+ */
+#define	WEB_REPORT_PASSES	50	/* 5 seconds */
+
+/* How often recording (-O) bandwidth and queue depth are printed, in
+ * main loop passes.
+ */
+#define	RECORD_REPORT_PASSES	50	/* 5 seconds */
+
+/* Main loop passes per second, for the telemetry (-Y) interval. */
+#define	PASSES_PER_SEC		10
+
+/* Longest video line, the size of each output line faulted in by the
+ * real-time mode (-Q).
+ */
+#define	MAX_LINE_BYTES		4096
+
+/* Most sources (-a), i.e. channels. */
+#define	MAX_CHANNELS		64
+
 /* Amount of time to sleep on exit, in milliseconds. */
 #ifdef _WIN32
 #define	EXIT_DELAY_TIME	5000	/* To keep console window on screen */
@@ -78,6 +187,39 @@
 #define	EXIT_DELAY_TIME	100
 #endif
 
+/* What handleRadar() does with each spoke of a channel, given as its
+ * user arg.  There is one per source, used by its receive thread.
+ */
+typedef struct
+{
+    unsigned int channel;	/* Channel id, the index of its source */
+    int tagged;			/* Non-zero to prefix lines with the channel */
+    SPxSpokeProcess *proc;	/* Spoke processing */
+    SPxPlotExtractor *plots;	/* Plot extraction, or NULL */
+    int video;			/* Non-zero to print spokes */
+    SPxStreamOutput *output;	/* Multiplexed video output */
+    SPxSpokeHub *hub;		/* Spoke fan-out, or NULL */
+    std::vector<SPxVideoRepublish *> links;	/* Republishing this channel */
+    SPxWebStream *web;		/* Browser viewer server, or NULL */
+    SPxLiveRecord *record;	/* Recording this channel, or NULL */
+    SPxSpokeTelemetry *telemetry;	/* Receive telemetry, or NULL */
+    const SPxRealtime *realtime;	/* Real-time mode, or NULL */
+    int rtApplied;		/* Receive thread set up for real-time */
+    SPxBatchReceive *batchSrc;	/* Native source (for arrival times), or NULL */
+    std::atomic<unsigned long long> numSpokes;	/* Spokes received */
+    unsigned long long lastSpokes;	/* At the previous report */
+    int64_t lastReportUsecs;
+} StreamContext;
+
+/* A radar source (-a), NULL/0 for the -i/-p or library defaults. */
+typedef struct
+{
+    char *addr;
+    int port;
+    char *ifAddr;
+    int cpu;			/* Core for the receive thread, -1 for any */
+} StreamSource;
+
 /*
  * Private function prototypes.
  */
@@ -86,21 +228,47 @@ static void spxErrorHandler(SPxErrorType errType, SPxErrorCode errCode,
 				int arg1, int arg2,
 				const char *arg3, const char *arg4);
 
-/* Radar data handler. */
+/* Network source and radar data handlers. */
+static SPxNetworkReceive *openSdkSource(const char *addr, int port,
+					const char *ifAddr, int asterixCat240,
+					unsigned int rcvBufBytes,
+					StreamContext *context);
 static void handleRadar(SPxNetworkReceive *src, void *arg,
 				SPxReturnHeader *hdr, unsigned char *data);
+static void handleBatchRadar(void *arg, SPxReturnHeader *hdr,
+				unsigned char *data);
 
 /* ASTERIX Cat-240 summary handler. */
 static void handleCat240Summary(SPxNetworkReceiveAsterix *src, void *arg,
                                 UINT8 sac, UINT8 sic,
                                 const char *summaryText);
 
+/* Plot, track and plugin statistics. */
+static void reportPlots(SPxPlotExtractor *plots, SPxTrackOutput *tracks);
+static void reportPlugins(SPxFilterPluginChain *plugins, const char *tag);
+static void reportReceive(SPxBatchReceive *batchSrc, const char *tag);
+static void reportHub(SPxSpokeHub *hub);
+static void reportRepublish(std::vector<SPxVideoRepublish *> *links);
+static void reportWeb(SPxWebStream *web);
+static void reportRecord(SPxLiveRecord *record);
+static void reportTelemetry(SPxTelemetryOutput *telemetry,
+				StreamContext *context, SPxNetworkReceive *src,
+				SPxBatchReceive *batchSrc);
+static void reportChannel(StreamContext *context, SPxNetworkReceive *src,
+				SPxBatchReceive *batchSrc, const char *tag);
+static void reportLatency(SPxStreamOutput *output, int always);
+
+/* Option parsing. */
+static int parseSource(char *arg, StreamSource *source);
+static int parseCpus(const char *arg, std::vector<StreamSource> *sources);
+
 /* Init/shutdown utility functions. */
 static SPxErrorCode osInit(void);
 #ifdef _WIN32
 static BOOL WINAPI sigIntHandler(DWORD fdwCtrlType);
 #else
 static void sigIntHandler(int sig);
+static void sigUsr1Handler(int sig);
 #endif
 
 
@@ -118,6 +286,9 @@ static int Verbose = 0;
 /* Exit flag. */
 static int MainLoopFinish = 0;
 
+/* Set by SIGUSR1 to print the latency histogram. */
+static volatile sig_atomic_t LatencyDump = 0;
+
 
 /*********************************************************************
 *
@@ -143,12 +314,31 @@ static int MainLoopFinish = 0;
 int main(int argc, char **argv)
 {
     int c;				/* For parsing command line options */
-    SPxErrorCode err;			/* SPx error value */
-    char *addr;				/* For receiving radar data */
-    char *ifAddr;			/* For joining multicast groups */
-    int port;				/* For receiving radar data */
+    std::vector<StreamSource> sources;	/* Sources (-a), one per channel */
+    char *ifAddr;			/* Default for joining multicast groups */
+    int port;				/* Default for receiving radar data */
     UINT32 debug;			/* Debug flags */
     int asterixCat240 = FALSE;		/* Receive ASTERIX Cat-240 */
+    const char *filterParams = NULL;	/* Filter chain, NULL for none */
+    const char *integration = NULL;	/* Integration, NULL for none */
+    const char *clutter = NULL;		/* Clutter map, NULL for none */
+    const char *clutterFile = NULL;	/* Clutter map file, or NULL */
+    std::vector<const char *> plugins;	/* Filter plugins, in order */
+    const char *plotExtract = NULL;	/* Plot extraction, NULL for default */
+    const char *plotFile = NULL;	/* Plot file, NULL for none */
+    const char *trackFile = NULL;	/* Track file, NULL for none */
+    const char *trackDest = NULL;	/* Track packet address, or NULL */
+    int video = TRUE;			/* Print spokes to stdout */
+    const char *batchArgs = NULL;	/* Native receive, NULL for SDK */
+    const char *cpuArgs = NULL;		/* Receive thread cores, or NULL */
+    const char *hubPath = NULL;		/* Spoke hub socket, NULL for none */
+    const char *timeShiftSpec = NULL;	/* Hub time-shift store, or NULL */
+    std::vector<const char *> linkSpecs; /* Video republish links */
+    const char *webSpec = NULL;		/* Browser viewer server, or NULL */
+    const char *recordSpec = NULL;	/* Recording, or NULL */
+    const char *telemetrySpec = NULL;	/* Telemetry lines, or NULL */
+    const char *realtimeSpec = NULL;	/* Real-time mode, or NULL */
+    int passes = 0;			/* Main loop passes */
 
     /* Initialise operating system specific things. */
     if( osInit() != SPX_NO_ERROR )
@@ -158,23 +348,51 @@ int main(int argc, char **argv)
     }
 
     /* Initialise configuration. */
-    addr = NULL;		/* NULL means use library default */
     port = 0;			/* 0 means use library default */
     ifAddr = NULL;
     debug = 0;
 
     /* Process any command line arguments.  */
     opterr = 0;
-    while( (c = getopt(argc, argv, "a:d:i:p:vx?")) != -1 )
+    while( (c = getopt(argc, argv, "a:B:C:d:E:F:H:I:i:K:L:M:NO:P:p:Q:R:S:T:U:vW:xY:?")) != -1 )
     {
+	StreamSource source;
 	switch(c)
 	{
-	    case 'a':	addr = optarg;				break;
+	    case 'a':
+		if( (sources.size() >= MAX_CHANNELS)
+		    || (parseSource(optarg, &source) != 0) )
+		{
+		    fprintf(stderr, "Invalid option: source '%s'.\n", optarg);
+		    SPxTimeSleepMsecs(EXIT_DELAY_TIME);
+		    exit(-1);
+		}
+		sources.push_back(source);
+		break;
+	    case 'B':	batchArgs = optarg;			break;
+	    case 'C':	clutter = optarg;			break;
 	    case 'd':	debug = strtoul(optarg, NULL, 0);	break;
+	    case 'E':	plotExtract = optarg;			break;
+	    case 'F':	filterParams = optarg;			break;
+	    case 'H':	timeShiftSpec = optarg;			break;
+	    case 'I':	integration = optarg;			break;
 	    case 'i':	ifAddr = optarg;			break;
+	    case 'K':	cpuArgs = optarg;			break;
+	    case 'L':	plugins.push_back(optarg);		break;
+	    case 'M':	clutterFile = optarg;			break;
+	    case 'N':	video = FALSE;				break;
+	    case 'O':	recordSpec = optarg;			break;
+	    case 'P':	plotFile = optarg;			break;
 	    case 'p':	port = strtol(optarg, NULL, 0);		break;
+	    case 'Q':	realtimeSpec = optarg;			break;
+	    case 'R':	linkSpecs.push_back(optarg);		break;
+	    case 'S':	hubPath = optarg;			break;
+	    case 'T':	trackFile = optarg;			break;
+	    case 'U':	trackDest = optarg;			break;
 	    case 'v':	Verbose++;				break;
+	    case 'W':	webSpec = optarg;			break;
 	    case 'x':	asterixCat240 = TRUE;			break;    
+	    case 'Y':	telemetrySpec = optarg;			break;
 	    case '?':	/* fall through */
 	    default:
 		fprintf(stderr, "\n%s", USAGE);
@@ -183,11 +401,277 @@ int main(int argc, char **argv)
 	}
     } /* end of for each option */
 
+    /* Without -a there is one source at the -p/-i or library defaults,
+     * and -p/-i fill in whatever the sources leave out.
+     */
+    if( sources.empty() )
+    {
+	StreamSource source;
+	memset(&source, 0, sizeof(source));
+	source.cpu = -1;
+	sources.push_back(source);
+    }
+    for(size_t i = 0; i < sources.size(); i++)
+    {
+	if( sources[i].port == 0 )
+	{
+	    sources[i].port = port;
+	}
+	if( sources[i].ifAddr == NULL )
+	{
+	    sources[i].ifAddr = ifAddr;
+	}
+    }
+    unsigned int numChannels = (unsigned int)sources.size();
+    if( (cpuArgs != NULL) && (parseCpus(cpuArgs, &sources) != 0) )
+    {
+	fprintf(stderr, "Invalid option: cores '%s'.\n", cpuArgs);
+	SPxTimeSleepMsecs(EXIT_DELAY_TIME);
+	exit(-1);
+    }
+    if( (cpuArgs != NULL) && (batchArgs == NULL) )
+    {
+	fprintf(stderr, "Pinning receive threads (-K) needs native"
+		" receive (-B).\n");
+	SPxTimeSleepMsecs(EXIT_DELAY_TIME);
+	exit(-1);
+    }
+
+    /* Real-time mode.  Its receive cores fill in what -K leaves out. */
+    SPxRealtime *realtime = NULL;
+    if( realtimeSpec != NULL )
+    {
+	realtime = new SPxRealtime();
+	if( realtime->Create(realtimeSpec) != 0 )
+	{
+	    fprintf(stderr, "Invalid option: %s.\n", realtime->GetError());
+	    SPxTimeSleepMsecs(EXIT_DELAY_TIME);
+	    exit(-1);
+	}
+	for(unsigned int ch = 0; ch < numChannels; ch++)
+	{
+	    if( sources[ch].cpu < 0 )
+	    {
+		sources[ch].cpu = realtime->GetReceiveCpu(ch);
+	    }
+	}
+    }
+
+    /* Plot extraction and tracking, opening the files now to report
+     * errors.  They follow one radar, so need a single source.
+     */
+    SPxPlotExtractor *plots = NULL;
+    SPxTrackOutput *tracks = NULL;
+    int tracking = (trackFile != NULL) || (trackDest != NULL);
+    if( (plotFile == NULL) && !tracking && (plotExtract != NULL) )
+    {
+	fprintf(stderr, "Plot extraction (-E) needs a plot file (-P)"
+		" or tracking (-T/-U).\n");
+	SPxTimeSleepMsecs(EXIT_DELAY_TIME);
+	exit(-1);
+    }
+    if( ((plotFile != NULL) || tracking) && (numChannels > 1) )
+    {
+	fprintf(stderr, "Plot extraction and tracking (-P/-T/-U) need"
+		" a single source (-a).\n");
+	SPxTimeSleepMsecs(EXIT_DELAY_TIME);
+	exit(-1);
+    }
+
+    /*
+     * Set up spoke processing before anything is printed to stdout,
+     * the same for each channel but with its own state (and its own
+     * clutter map file, "<file>.<channel>", if there are several).
+     */
+    std::vector<StreamContext *> contexts;
+    for(unsigned int ch = 0; ch < numChannels; ch++)
+    {
+	char chFile[1024];
+	const char *file = clutterFile;
+	if( (clutterFile != NULL) && (numChannels > 1) )
+	{
+	    snprintf(chFile, sizeof(chFile), "%s.%u", clutterFile, ch);
+	    file = chFile;
+	}
+	SPxSpokeProcess *proc = new SPxSpokeProcess();
+	if( ((filterParams != NULL) && (proc->SetFilter(filterParams) != 0))
+	    || ((integration != NULL)
+		&& (proc->SetIntegration(integration, INTEGRATION_AZIS) != 0))
+	    || ((clutter != NULL)
+		&& (proc->SetClutterMap(clutter, CLUTTER_AZIS, file) != 0)) )
+	{
+	    fprintf(stderr, "Invalid option: %s.\n", proc->GetError());
+	    SPxTimeSleepMsecs(EXIT_DELAY_TIME);
+	    exit(-1);
+	}
+	for(size_t i = 0; i < plugins.size(); i++)
+	{
+	    if( proc->AddPlugin(plugins[i]) != 0 )
+	    {
+		fprintf(stderr, "Invalid option: %s.\n", proc->GetError());
+		SPxTimeSleepMsecs(EXIT_DELAY_TIME);
+		exit(-1);
+	    }
+	}
+	if( (file != NULL) && proc->IsClutterMapLoaded() )
+	{
+	    fprintf(stderr, "Loaded clutter map from '%s'.\n", file);
+	}
+
+	StreamContext *context = new StreamContext;
+	context->channel = ch;
+	context->tagged = (numChannels > 1);
+	context->proc = proc;
+	context->plots = NULL;
+	context->video = video;
+	context->output = NULL;
+	context->hub = NULL;
+	context->web = NULL;
+	context->record = NULL;
+	context->telemetry = NULL;
+	context->realtime = realtime;
+	context->rtApplied = 0;
+	context->batchSrc = NULL;
+	context->numSpokes = 0;
+	context->lastSpokes = 0;
+	context->lastReportUsecs = SPxStreamOutput::NowUsecs();
+	contexts.push_back(context);
+    }
+
+    if( tracking )
+    {
+	tracks = new SPxTrackOutput();
+	if( tracks->Create(trackFile, trackDest) != 0 )
+	{
+	    fprintf(stderr, "Invalid option: %s.\n", tracks->GetError());
+	    SPxTimeSleepMsecs(EXIT_DELAY_TIME);
+	    exit(-1);
+	}
+    }
+    if( (plotFile != NULL) || tracking )
+    {
+	plots = new SPxPlotExtractor();
+	if( plots->Create((plotExtract != NULL) ? plotExtract
+			  : DEFAULT_PLOT_EXTRACT, plotFile) != 0 )
+	{
+	    fprintf(stderr, "Invalid option: %s.\n", plots->GetError());
+	    SPxTimeSleepMsecs(EXIT_DELAY_TIME);
+	    exit(-1);
+	}
+	plots->SetTrackOutput(tracks);
+	contexts[0]->plots = plots;
+    }
+    /* Native receive batch and buffer size. */
+    unsigned int batch = 0;
+    unsigned int rcvBufMB = SPX_BATCH_RECEIVE_RCVBUF_MB;
+    if( batchArgs != NULL )
+    {
+	char *end = NULL;
+	batch = (unsigned int)strtoul(batchArgs, &end, 0);
+	if( *end == ',' )
+	{
+	    rcvBufMB = (unsigned int)strtoul(end + 1, &end, 0);
+	}
+	if( (*end != '\0') || (batch < 1) || (batch > SPX_BATCH_RECEIVE_MAX_BATCH)
+	    || (rcvBufMB < 1) || (rcvBufMB > 1024) )
+	{
+	    fprintf(stderr, "Invalid option: receive batch '%s'.\n", batchArgs);
+	    SPxTimeSleepMsecs(EXIT_DELAY_TIME);
+	    exit(-1);
+	}
+    }
+    unsigned int rcvBufBytes = rcvBufMB * 1024 * 1024;
+    if( (realtime != NULL) && (realtime->GetRcvBufBytes() > 0) )
+    {
+	rcvBufBytes = realtime->GetRcvBufBytes();
+    }
+
+    /* Spoke fan-out to local subscribers, one ring for all channels. */
+    SPxSpokeHub *hub = NULL;
+    if( (timeShiftSpec != NULL) && (hubPath == NULL) )
+    {
+	fprintf(stderr, "Invalid option: a time-shift store (-H) needs"
+		" the spoke hub (-S).\n");
+	SPxTimeSleepMsecs(EXIT_DELAY_TIME);
+	exit(-1);
+    }
+    if( hubPath != NULL )
+    {
+	hub = new SPxSpokeHub();
+	if( ((timeShiftSpec != NULL) && (hub->SetTimeShift(timeShiftSpec) != 0))
+	    || (hub->Create(hubPath) != 0) )
+	{
+	    fprintf(stderr, "Invalid option: %s.\n", hub->GetError());
+	    SPxTimeSleepMsecs(EXIT_DELAY_TIME);
+	    exit(-1);
+	}
+	for(unsigned int ch = 0; ch < numChannels; ch++)
+	{
+	    contexts[ch]->hub = hub;
+	}
+	if( realtime != NULL )
+	{
+	    hub->Prefault();
+	}
+    }
+
+    /* Receive telemetry, counted per channel from the spoke headers. */
+    SPxTelemetryOutput *telemetry = NULL;
+    if( telemetrySpec != NULL )
+    {
+	telemetry = new SPxTelemetryOutput();
+	if( telemetry->Create(telemetrySpec) != 0 )
+	{
+	    fprintf(stderr, "Invalid option: %s.\n", telemetry->GetError());
+	    SPxTimeSleepMsecs(EXIT_DELAY_TIME);
+	    exit(-1);
+	}
+	for(unsigned int ch = 0; ch < numChannels; ch++)
+	{
+	    contexts[ch]->telemetry = new SPxSpokeTelemetry();
+	    contexts[ch]->telemetry->SetGapFactor(telemetry->GetGapFactor());
+	}
+    }
+
     /*
      * Welcome banner.
      */
     printf("\n### Cambridge Pixel  %s ###\n\n",
 		SPX_VERSION_STRING);
+    fflush(stdout);
+
+    /* All channels' video lines go through one writer thread, so a slow
+     * reader of stdout holds up none of the receive threads.
+     */
+    SPxStreamOutput *output = NULL;
+    if( realtime == NULL )
+    {
+	output = new SPxStreamOutput(stdout, numChannels);
+    }
+    else
+    {
+	/* 실시간 모드: 큐를 미리 채워 두고 쓰기 스레드를 고정 */
+	output = new SPxStreamOutput(stdout, numChannels, realtime->GetLines());
+	output->Prefault(MAX_LINE_BYTES);
+	std::string message;
+	int rc = realtime->ApplyToThread(output->GetWriterThread(),
+					 realtime->GetWriterCpu(), &message);
+	if( rc < 0 )
+	{
+	    fprintf(stderr, "Invalid option: writer thread: %s.\n",
+		    message.c_str());
+	    SPxTimeSleepMsecs(EXIT_DELAY_TIME);
+	    exit(-1);
+	}
+	if( rc > 0 )
+	{
+	    fprintf(stderr, "Warning: writer thread: %s.\n", message.c_str());
+	}
+    }
+    for(unsigned int ch = 0; ch < numChannels; ch++)
+    {
+	contexts[ch]->output = output;
+    }
 
     /*
      * Install a handler for SPx errors.
@@ -209,191 +693,1119 @@ int main(int argc, char **argv)
      */
     SPxLicInit();
 
+    /* Video republish links, each sending its channel's processed
+     * spokes from that channel's receive thread.
+     */
+    std::vector<SPxVideoRepublish *> links;
+    for(size_t i = 0; i < linkSpecs.size(); i++)
+    {
+	SPxVideoRepublish *link = new SPxVideoRepublish();
+	if( link->Create(linkSpecs[i]) != 0 )
+	{
+	    fprintf(stderr, "Invalid option: %s.\n", link->GetError());
+	    SPxTimeSleepMsecs(EXIT_DELAY_TIME);
+	    exit(-1);
+	}
+	if( link->GetChannel() >= numChannels )
+	{
+	    fprintf(stderr, "Invalid option: no channel %u for video"
+		    " link '%s'.\n", link->GetChannel(), linkSpecs[i]);
+	    SPxTimeSleepMsecs(EXIT_DELAY_TIME);
+	    exit(-1);
+	}
+	links.push_back(link);
+	contexts[link->GetChannel()]->links.push_back(link);
+    }
+
+    /* Browser viewer server, fed the processed spokes of its channel. */
+    SPxWebStream *web = NULL;
+    if( webSpec != NULL )
+    {
+	web = new SPxWebStream();
+	if( web->Create(webSpec) != 0 )
+	{
+	    fprintf(stderr, "Invalid option: %s.\n", web->GetError());
+	    SPxTimeSleepMsecs(EXIT_DELAY_TIME);
+	    exit(-1);
+	}
+	if( web->GetChannel() >= numChannels )
+	{
+	    fprintf(stderr, "Invalid option: no channel %u for web"
+		    " server '%s'.\n", web->GetChannel(), webSpec);
+	    SPxTimeSleepMsecs(EXIT_DELAY_TIME);
+	    exit(-1);
+	}
+	contexts[web->GetChannel()]->web = web;
+	fprintf(stderr, "Serving channel %u to browsers on port %d.\n",
+		web->GetChannel(), web->GetPort());
+    }
+
+    /* Recording, of the spokes of its channel as received. */
+    SPxLiveRecord *record = NULL;
+    if( recordSpec != NULL )
+    {
+	record = new SPxLiveRecord();
+	if( record->Create(recordSpec) != 0 )
+	{
+	    fprintf(stderr, "Invalid option: %s.\n", record->GetError());
+	    SPxTimeSleepMsecs(EXIT_DELAY_TIME);
+	    exit(-1);
+	}
+	if( record->GetChannel() >= numChannels )
+	{
+	    fprintf(stderr, "Invalid option: no channel %u for recording"
+		    " '%s'.\n", record->GetChannel(), recordSpec);
+	    SPxTimeSleepMsecs(EXIT_DELAY_TIME);
+	    exit(-1);
+	}
+	contexts[record->GetChannel()]->record = record;
+    }
+
     /*
      * Set up debug if desired.
      */
     if( (Verbose > 0) || (debug != 0) )
     {
-	SPxNetworkReceive::SetLogFile(stdout);
-	SPxNetworkReceive::SetDebug(debug);
-	printf("Debug flags = 0x%08x\n", debug);
+	SPxNetworkReceive::SetLogFile(stdout);
+	SPxNetworkReceive::SetDebug(debug);
+	printf("Debug flags = 0x%08x\n", debug);
+    }
+
+    /* Open a source per channel, each with its own receive thread.
+     * Either receive natively in batches, calling handleRadar() through
+     * handleBatchRadar() from the (optionally pinned) receive thread,
+     * or use the SDK source.  Native sources on the same port share it
+     * (SO_REUSEPORT), each getting only its own group.
+     */
+    if( realtime != NULL )
+    {
+	/* 이후 할당도 MCL_FUTURE 로 잠김 */
+	std::string message;
+	if( realtime->LockMemory(&message) != 0 )
+	{
+	    fprintf(stderr, "Warning: %s.\n", message.c_str());
+	}
+    }
+    std::vector<SPxBatchReceive *> batchSrcs(numChannels, (SPxBatchReceive *)NULL);
+    std::vector<SPxNetworkReceive *> srcs(numChannels, (SPxNetworkReceive *)NULL);
+    for(unsigned int ch = 0; ch < numChannels; ch++)
+    {
+	StreamSource *source = &sources[ch];
+	if( batch > 0 )
+	{
+	    batchSrcs[ch] = new SPxBatchReceive(handleBatchRadar, contexts[ch]);
+	    batchSrcs[ch]->SetCpu(source->cpu);
+	    contexts[ch]->batchSrc = batchSrcs[ch];
+	    if( batchSrcs[ch]->Create(source->addr, source->port,
+				      source->ifAddr, asterixCat240, batch,
+				      rcvBufBytes) != 0 )
+	    {
+		fprintf(stderr, "Failed to create network source %u: %s.\n",
+			ch, batchSrcs[ch]->GetError());
+		SPxTimeSleepMsecs(EXIT_DELAY_TIME);
+		exit(-1);
+	    }
+	}
+
+	else
+	{
+	    srcs[ch] = openSdkSource(source->addr, source->port,
+				     source->ifAddr, asterixCat240,
+				     (realtime != NULL) ? rcvBufBytes : 0,
+				     contexts[ch]);
+	}
+    }
+
+    /*
+     * Run the main loop.
+     */
+    while( !MainLoopFinish )
+    {
+	/* In a real application, we would normally do things in the main
+	 * loop such as provide a user interface, display graphics and
+	 * so on, but in this example we just make sure that we don't
+	 * busy wait.
+	 */
+	SPxTimeSleepMsecs(100);
+	passes++;
+
+	/* Print the latency histogram on SIGUSR1. */
+	if( LatencyDump )
+	{
+	    LatencyDump = 0;
+	    reportLatency(output, TRUE);
+	}
+
+	for(unsigned int ch = 0; ch < numChannels; ch++)
+	{
+	    SPxSpokeProcess *proc = contexts[ch]->proc;
+	    char tag[32] = "";
+	    if( numChannels > 1 )
+	    {
+		snprintf(tag, sizeof(tag), "Channel %u ", ch);
+	    }
+
+	    /* Save the clutter map now and then, for a quick restart. */
+	    if( (clutter != NULL) && (clutterFile != NULL)
+		&& ((passes % CLUTTER_SAVE_PASSES) == 0) )
+	    {
+		proc->SaveClutterMap();
+	    }
+
+	    /* Report filter plugins now and then. */
+	    if( (proc->GetPlugins() != NULL)
+		&& ((passes % PLUGIN_REPORT_PASSES) == 0) )
+	    {
+		reportPlugins(proc->GetPlugins(), tag);
+	    }
+
+	    /* Report receive now and then. */
+	    if( (passes % RECEIVE_REPORT_PASSES) == 0 )
+	    {
+		reportChannel(contexts[ch], srcs[ch], batchSrcs[ch], tag);
+		if( batchSrcs[ch] != NULL )
+		{
+		    reportReceive(batchSrcs[ch], tag);
+		}
+	    }
+
+	    /* Write telemetry every interval. */
+	    if( (telemetry != NULL) && ((passes
+		% (telemetry->GetReportSecs() * PASSES_PER_SEC)) == 0) )
+	    {
+		reportTelemetry(telemetry, contexts[ch], srcs[ch],
+				batchSrcs[ch]);
+	    }
+	}
+
+	/* Report plot extraction now and then. */
+	if( (plots != NULL) && ((passes % PLOT_REPORT_PASSES) == 0) )
+	{
+	    reportPlots(plots, tracks);
+	}
+
+	/* Report hub subscribers now and then. */
+	if( (hub != NULL) && ((passes % HUB_REPORT_PASSES) == 0) )
+	{
+	    reportHub(hub);
+	}
+
+	/* Report republish bandwidth now and then. */
+	if( !links.empty() && ((passes % REPUBLISH_REPORT_PASSES) == 0) )
+	{
+	    reportRepublish(&links);
+	}
+
+	/* Report browser viewers now and then. */
+	if( (web != NULL) && ((passes % WEB_REPORT_PASSES) == 0) )
+	{
+	    reportWeb(web);
+	}
+
+	/* Report recording now and then. */
+	if( (record != NULL) && ((passes % RECORD_REPORT_PASSES) == 0) )
+	{
+	    reportRecord(record);
+	}
+    } /* end of main loop */
+
+    /*
+     * Tidy up: report, stop the sources and then the output they write
+     * to (which writes what it still has queued).
+     */
+    for(unsigned int ch = 0; ch < numChannels; ch++)
+    {
+	char tag[32] = "";
+	if( numChannels > 1 )
+	{
+	    snprintf(tag, sizeof(tag), "Channel %u ", ch);
+	}
+	reportChannel(contexts[ch], srcs[ch], batchSrcs[ch], tag);
+	if( batchSrcs[ch] != NULL )
+	{
+	    reportReceive(batchSrcs[ch], tag);
+	}
+	if( telemetry != NULL )
+	{
+	    reportTelemetry(telemetry, contexts[ch], srcs[ch], batchSrcs[ch]);
+	}
+    }
+    for(unsigned int ch = 0; ch < numChannels; ch++)
+    {
+	delete srcs[ch];
+	delete batchSrcs[ch];
+    }
+    reportLatency(output, FALSE);
+    delete output;
+    if( hub != NULL )
+    {
+	reportHub(hub);
+	delete hub;
+    }
+    if( !links.empty() )
+    {
+	reportRepublish(&links);
+    }
+    for(size_t i = 0; i < links.size(); i++)
+    {
+	delete links[i];
+    }
+    if( web != NULL )
+    {
+	reportWeb(web);
+	delete web;
+    }
+    if( record != NULL )
+    {
+	/* 남은 큐를 쓰고 파일을 닫은 뒤 보고 */
+	SPxLiveRecord::Stats stats;
+	record->GetStats(&stats);
+	delete record;
+	fprintf(stderr, "Record %s: %u files, %llu dropped, %llu errors.\n",
+		recordSpec, stats.numFiles, (unsigned long long)stats.numDropped,
+		(unsigned long long)stats.numErrors);
+    }
+    for(unsigned int ch = 0; ch < numChannels; ch++)
+    {
+	StreamContext *context = contexts[ch];
+	char tag[32] = "";
+	if( numChannels > 1 )
+	{
+	    snprintf(tag, sizeof(tag), "Channel %u ", ch);
+	}
+	if( (clutter != NULL) && (clutterFile != NULL)
+	    && (context->proc->SaveClutterMap() != 0) )
+	{
+	    fprintf(stderr, "%sFailed to save clutter map to '%s'.\n",
+		    tag, clutterFile);
+	}
+	if( context->proc->GetPlugins() != NULL )
+	{
+	    reportPlugins(context->proc->GetPlugins(), tag);
+	}
+	delete context->proc;
+	delete context->telemetry;
+	delete context;
+    }
+    delete telemetry;
+    delete realtime;
+    if( plots != NULL )
+    {
+	reportPlots(plots, tracks);
+	delete plots;
+    }
+    delete tracks;
+
+    /* Sleep for a while so the console window doesn't vanish immediately
+     * in case this isn't being run inside a console box on windows.
+     */
+    SPxTimeSleepMsecs(EXIT_DELAY_TIME);
+
+    /* Finished. */
+    exit(0);
+} /* main() */
+
+
+/*********************************************************************
+*
+*	Private functions.
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* spxErrorHandler
+*	Callback function for errors reported by the SPx library.
+*
+* Params:
+*	errType, errCode	Error type and code,
+*	arg1 - arg4		Error values.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+static void spxErrorHandler(SPxErrorType errType, SPxErrorCode errCode,
+				int arg1, int arg2,
+				const char *arg3, const char *arg4)
+{
+    /* We simply report errors to stdout. */
+    printf("SPx Error #%d, args %d, %d, %s, %s.\n",
+		errCode, arg1, arg2,
+		(arg3 ? arg3 : "<none>"),
+		(arg4 ? arg4 : "<none>"));
+    return;
+} /* spxErrorHandler() */
+
+
+/*====================================================================
+*
+* openSdkSource
+*	Create and enable the SDK network source.
+*
+* Params:
+*	addr, port, ifAddr	Where to receive, NULL/0 for defaults,
+*	asterixCat240		TRUE for ASTERIX Cat-240, else SPx,
+*	rcvBufBytes		Socket receive buffer, 0 for the default,
+*	context			User arg for handleRadar().
+*
+* Returns:
+*	The source (exits on error).
+*
+* Notes
+*
+*===================================================================*/
+static SPxNetworkReceive *openSdkSource(const char *addr, int port,
+					const char *ifAddr, int asterixCat240,
+					unsigned int rcvBufBytes,
+					StreamContext *context)
+{
+    SPxErrorCode err;
+
+    /* Instantiate the network receiving source, noting that we do not give
+     * it a RIB to write into because we want direct data access.
+     */
+    SPxNetworkReceive *src = NULL;
+    if (asterixCat240)
+    {   
+	/* Receive ASTERIX Cat-240 format radar video. */
+	src = new SPxNetworkReceiveAsterix(NULL);
+    }
+    else
+    {
+	/* Receive SPx format radar video. */
+	src = new SPxNetworkReceive(NULL);
+    }
+
+    /* Receive buffer size, applied when the socket is created. */
+    if( (rcvBufBytes > 0) && (src->SetRcvBufSize(rcvBufBytes) != SPX_NO_ERROR) )
+    {
+	fprintf(stderr, "Failed to set receive buffer size.\n");
+    }
+
+    /*
+     * Create the source.
+     */
+    err = src->Create(addr, port, ifAddr);
+    if( err != SPX_NO_ERROR )
+    {
+	fprintf(stderr, "Failed to create network source.\n");
+	SPxTimeSleepMsecs(EXIT_DELAY_TIME);
+	exit(-1);
+    }
+
+    /*
+     * Install a routine to get radar data, with the spoke processing
+     * and plot extraction as the user arg.
+     */
+    err = src->InstallDataFn(handleRadar, context);
+    if( err != SPX_NO_ERROR )
+    {
+	fprintf(stderr, "Failed to install radar handler.\n");
+	SPxTimeSleepMsecs(EXIT_DELAY_TIME);
+	exit(-1);
+    }
+
+    if (asterixCat240)
+    { 
+        /*
+         * Install a routine to get ASTERIX Cat-240 summary.
+         * (We don't use the user arg).
+         */
+        SPxNetworkReceiveAsterix *atxSrc = (SPxNetworkReceiveAsterix *)src;
+        err = atxSrc->InstallSummaryFn(handleCat240Summary, NULL);
+        if( err != SPX_NO_ERROR )
+        {
+            fprintf(stderr, "Failed to install Cat-240 summary handler.\n");
+            SPxTimeSleepMsecs(EXIT_DELAY_TIME);
+            exit(-1);
+        }
+    }
+
+    /*
+     * Start acquisition from the network.
+     */
+    src->Enable(TRUE);
+
+    return(src);
+} /* openSdkSource() */
+
+
+/*====================================================================
+*
+* handleRadar
+*	Function to handle a spoke of radar data from the network.
+*
+* Params:
+*	src		Pointer to radar source object we are using,
+*	arg		User argument we gave when installing this handler
+*			function (StreamContext),
+*	hdr		Pointer to header structure describing the spoke,
+*	data		Pointer to the radar data for this return.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Called on the channel's receive thread.  The line is queued on
+*	the multiplexed output, prefixed with the channel id if there
+*	are several channels.
+*
+*===================================================================*/
+static void handleRadar(SPxNetworkReceive *src, void *arg,
+				SPxReturnHeader *hdr, unsigned char *data)
+{
+    char buffer[MAX_LINE_BYTES];
+    size_t offset = 0;
+    StreamContext *context = (StreamContext *)arg;
+    SPxSpokeProcess *proc = context->proc;
+
+    /* 네이티브 수신은 recvmmsg() 반환 시각부터 잼 */
+    int64_t entryUsecs = (context->batchSrc != NULL)
+	? context->batchSrc->GetArrivalUsecs() : SPxStreamOutput::NowUsecs();
+
+    /* Real-time mode: set up the receive thread on its first spoke. */
+    if( (context->realtime != NULL) && !context->rtApplied )
+    {
+	std::string message;
+	context->rtApplied = 1;
+	if( context->realtime->ApplyToCurrentThread(
+		context->realtime->GetReceiveCpu(context->channel), &message) != 0 )
+	{
+	    fprintf(stderr, "Warning: channel %u receive thread: %s.\n",
+		    context->channel, message.c_str());
+	}
+    }
+
+    context->numSpokes++;
+    if( context->telemetry != NULL )
+    {
+        context->telemetry->Add(hdr);
+    }
+
+    /* Record the spoke as received (queued for the recording thread). */
+    if( context->record != NULL )
+    {
+        context->record->Record(hdr, data);
+    }
+    
+    float azimuthDegrees = (float)hdr->azimuth * 360.0f / 65536.0f;
+    
+    unsigned int bps = SPxGetPackingBytesPerSample(hdr->packing);
+
+    unsigned int numSamples = hdr->thisLength;
+
+    /* 처리나 플롯 추출이 설정되어 있으면 8비트 샘플로 변환 후 필터/적분 적용 */
+    const UINT8 *processed = NULL;
+    int num = 0;
+    if( proc->IsActive() || (context->plots != NULL) )
+    {
+        processed = proc->Process(azimuthDegrees, data, (int)bps,
+                                  (int)numSamples, &num, hdr->startRange,
+                                  hdr->endRange, hdr);
+
+        /* 플러그인이 드롭한 스포크는 출력하지 않음 */
+        if( (processed == NULL) && (proc->GetPlugins() != NULL) )
+        {
+            return;
+        }
+    }
+    if( (context->plots != NULL) && (processed != NULL) )
+    {
+        context->plots->AddSpoke(hdr, processed, num);
+    }
+    if( proc->IsActive() && (processed != NULL) )
+    {
+        data = (unsigned char *)processed;
+        numSamples = (unsigned int)num;
+        bps = 1;
+    }
+
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    long long current_time_ms = (long long)ts.tv_sec * 1000LL + (ts.tv_nsec / 1000000LL);
+
+    /* 허브 구독자에게는 비디오 출력 여부와 관계없이 전달 */
+    if( context->hub != NULL )
+    {
+        context->hub->Publish(context->channel, hdr->azimuth, hdr->startRange,
+                              hdr->endRange, current_time_ms, data,
+                              numSamples, bps);
+    }
+
+    /* 처리된 비디오를 각 링크로 재송신 */
+    for(size_t i = 0; i < context->links.size(); i++)
+    {
+        context->links[i]->Send(hdr, data, numSamples, bps);
+    }
+
+    /* 브라우저 뷰어용 격자에 추가 */
+    if( context->web != NULL )
+    {
+        context->web->Publish(hdr->azimuth, hdr->endRange, data,
+                              numSamples, bps);
+    }
+    if( !context->video )
+    {
+        return;
+    }
+
+    /* 채널이 여럿이면 채널 번호를 앞에 붙임 */
+    if( context->tagged )
+    {
+        offset += snprintf(buffer + offset, sizeof(buffer) - offset,
+                           "%u,", context->channel);
+    }
+    offset += snprintf(buffer + offset, sizeof(buffer) - offset, 
+                      "%.2f,%.1f,%lld", azimuthDegrees, hdr->endRange, current_time_ms);
+    
+    if (bps == 1) {
+        for (unsigned int i = 0; i < numSamples && 
+             offset < (size_t)(sizeof(buffer) - 8); i++) {
+            offset += snprintf(buffer + offset, sizeof(buffer) - offset, ",%d", data[i]);
+        }
+    }
+    else if (bps == 2) {
+        UINT16 *data16 = (UINT16 *)data;
+        for (unsigned int i = 0; i < numSamples && 
+             offset < (size_t)(sizeof(buffer) - 8); i++) {
+            offset += snprintf(buffer + offset, sizeof(buffer) - offset, ",%d", data16[i]);
+        }
+    }
+    
+    if (offset < (size_t)(sizeof(buffer) - 2)) {
+        buffer[offset++] = '\n';
+        buffer[offset] = '\0';
+        context->output->Write(context->channel, buffer, offset, entryUsecs);
+    }
+} /* handleRadar() */
+
+
+/*====================================================================
+*
+* handleBatchRadar
+*	Function to handle a spoke from the native receiver (-B).
+*
+* Params:
+*	arg		User argument (StreamContext),
+*	hdr		Pointer to header structure describing the spoke,
+*	data		Pointer to the radar data for this return.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	The spoke is RAW8 or RAW16, as from SPxNetworkReceive.
+*
+*===================================================================*/
+static void handleBatchRadar(void *arg, SPxReturnHeader *hdr,
+				unsigned char *data)
+{
+    handleRadar(NULL, arg, hdr, data);
+} /* handleBatchRadar() */
+
+
+/*====================================================================
+*
+* reportPlots
+*	Print plot extraction and tracking statistics.
+*
+* Params:
+*	plots		Plot extraction,
+*	tracks		Track output, or NULL.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Printed to stderr, as stdout carries the video.
+*
+*===================================================================*/
+static void reportPlots(SPxPlotExtractor *plots, SPxTrackOutput *tracks)
+{
+    SPxPlotExtractor::Stats stats;
+    plots->GetStats(&stats);
+    fprintf(stderr, "Plots: %llu total, %.1f/s, latency %.1f ms mean,"
+	    " %.1f ms max.\n", (unsigned long long)stats.totalPlots,
+	    stats.plotsPerSec, stats.meanLatencyMs, stats.maxLatencyMs);
+
+    if( tracks != NULL )
+    {
+	SPxTrackOutput::Stats trackStats;
+	tracks->GetStats(&trackStats);
+	fprintf(stderr, "Tracks: %u active, %llu reports, tracker CPU"
+		" %.2f ms/scan mean, %.2f ms max over %u scans.\n",
+		trackStats.numTracks,
+		(unsigned long long)trackStats.totalReports,
+		trackStats.meanCpuMs, trackStats.maxCpuMs, trackStats.numScans);
+    }
+} /* reportPlots() */
+
+
+/*====================================================================
+*
+* reportPlugins
+*	Print filter plugin statistics.
+*
+* Params:
+*	plugins		Plugin chain,
+*	tag		Channel prefix, "" if one channel.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Printed to stderr, as stdout carries the video.
+*
+*===================================================================*/
+static void reportPlugins(SPxFilterPluginChain *plugins, const char *tag)
+{
+    std::vector<SPxFilterPluginChain::Stats> stats;
+    plugins->GetStats(&stats);
+    for(size_t i = 0; i < stats.size(); i++)
+    {
+	fprintf(stderr, "%sPlugin %s: %llu spokes, %llu dropped,"
+		" %.1f us mean, %.1f us max.\n", tag, stats[i].name.c_str(),
+		(unsigned long long)stats[i].numSpokes,
+		(unsigned long long)stats[i].numDropped,
+		stats[i].meanUsecs, stats[i].maxUsecs);
+    }
+} /* reportPlugins() */
+
+
+/*====================================================================
+*
+* reportReceive
+*	Print native receive statistics.
+*
+* Params:
+*	batchSrc	Native receiver,
+*	tag		Channel prefix, "" if one channel.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Printed to stderr, as stdout carries the video.  Totals since
+*	the start; kernel drops come from SO_RXQ_OVFL.
+*
+*===================================================================*/
+static void reportReceive(SPxBatchReceive *batchSrc, const char *tag)
+{
+    SPxBatchReceive::Stats stats;
+    batchSrc->GetStats(&stats);
+    fprintf(stderr, "%sReceive: %llu packets, %.1f per syscall (max %u),"
+	    " %llu spokes, %llu kernel drops, %llu bad, %llu incomplete,"
+	    " %llu unsupported, rcvbuf %u bytes.\n", tag,
+	    (unsigned long long)stats.numPackets, stats.packetsPerSyscall,
+	    stats.maxBatch, (unsigned long long)stats.numSpokes,
+	    (unsigned long long)stats.numKernelDrops,
+	    (unsigned long long)stats.numBad,
+	    (unsigned long long)stats.numIncomplete,
+	    (unsigned long long)stats.numUnsupported, stats.rcvBufBytes);
+} /* reportReceive() */
+
+
+/*====================================================================
+*
+* reportHub
+*	Print spoke hub subscriber statistics.
+*
+* Params:
+*	hub		Spoke hub.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Printed to stderr, as stdout carries the video.  Counts cover
+*	the time since the previous report; lag is current.  With a
+*	time-shift store, what it keeps and which subscribers are
+*	rewound are printed too.
+*
+*===================================================================*/
+static void reportHub(SPxSpokeHub *hub)
+{
+    SPxTimeShift *timeShift = hub->GetTimeShift();
+    if( timeShift != NULL )
+    {
+	SPxTimeShift::Stats store;
+	timeShift->GetStats(&store);
+	fprintf(stderr, "Time-shift: %.1f s kept in %u blocks, %.1f of %.0f MB,"
+		" compression %.2f, %llu blocks evicted.\n",
+		(double)(store.newestMs - store.oldestMs) / 1000.0,
+		store.numBlocks, (double)store.memBytes / (1024.0 * 1024.0),
+		(double)store.maxBytes / (1024.0 * 1024.0), store.compression,
+		(unsigned long long)store.numEvicted);
     }
 
-    /* Instantiate the network receiving source, noting that we do not give
-     * it a RIB to write into because we want direct data access.
-     */
-    SPxNetworkReceive *src = NULL;
-    if (asterixCat240)
-    {   
-	/* Receive ASTERIX Cat-240 format radar video. */
-	src = new SPxNetworkReceiveAsterix(NULL);
-    }
-    else
+    std::vector<SPxSpokeHub::SubscriberStats> stats;
+    hub->GetStats(&stats);
+    for(size_t i = 0; i < stats.size(); i++)
     {
-	/* Receive SPx format radar video. */
-	src = new SPxNetworkReceive(NULL);
+	fprintf(stderr, "Subscriber %u \"%s\": %llu sent, %llu filtered,"
+		" %llu coalesced, %llu bytes, lag %u spokes (%.0f ms),"
+		" max %u.\n", stats[i].id, stats[i].request.c_str(),
+		(unsigned long long)stats[i].numSent,
+		(unsigned long long)stats[i].numFiltered,
+		(unsigned long long)stats[i].numCoalesced,
+		(unsigned long long)stats[i].numBytes, stats[i].lag,
+		stats[i].lagMs, stats[i].maxLag);
+	if( stats[i].shifted )
+	{
+	    fprintf(stderr, "Subscriber %u: time-shifted %.1f s, last seek"
+		    " %.2f ms to first spoke.\n", stats[i].id,
+		    stats[i].shiftSecs, stats[i].seekMs);
+	}
     }
+} /* reportHub() */
 
-    /*
-     * Create the source.
-     */
-    err = src->Create(addr, port, ifAddr);
-    if( err != SPX_NO_ERROR )
-    {
-	fprintf(stderr, "Failed to create network source.\n");
-	SPxTimeSleepMsecs(EXIT_DELAY_TIME);
-	exit(-1);
-    }
 
-    /*
-     * Install a routine to get radar data. (We don't use the user arg).
-     */
-    err = src->InstallDataFn(handleRadar, NULL);
-    if( err != SPX_NO_ERROR )
+/*====================================================================
+*
+* reportRepublish
+*	Print video republish bandwidth.
+*
+* Params:
+*	links		Republish links.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Printed to stderr, as stdout carries the video.  Rates cover
+*	the time since the previous report; compression is the bytes
+*	sent over the raw sample bytes.
+*
+*===================================================================*/
+static void reportRepublish(std::vector<SPxVideoRepublish *> *links)
+{
+    for(size_t i = 0; i < links->size(); i++)
     {
-	fprintf(stderr, "Failed to install radar handler.\n");
-	SPxTimeSleepMsecs(EXIT_DELAY_TIME);
-	exit(-1);
+	SPxVideoRepublish::Stats stats;
+	(*links)[i]->GetStats(&stats);
+	fprintf(stderr, "Republish %s: %.1f spokes/s, %.1f packets/s,"
+		" %.2f Mbit/s, compression %.2f, %llu errors.\n",
+		(*links)[i]->GetSpec(), stats.spokesPerSec,
+		stats.packetsPerSec, stats.bitsPerSec / 1e6,
+		stats.compression, (unsigned long long)stats.numErrors);
     }
+} /* reportRepublish() */
 
-    if (asterixCat240)
-    { 
-        /*
-         * Install a routine to get ASTERIX Cat-240 summary.
-         * (We don't use the user arg).
-         */
-        SPxNetworkReceiveAsterix *atxSrc = (SPxNetworkReceiveAsterix *)src;
-        err = atxSrc->InstallSummaryFn(handleCat240Summary, NULL);
-        if( err != SPX_NO_ERROR )
-        {
-            fprintf(stderr, "Failed to install Cat-240 summary handler.\n");
-            SPxTimeSleepMsecs(EXIT_DELAY_TIME);
-            exit(-1);
-        }
-    }
 
-    /*
-     * Start acquisition from the network.
-     */
-    src->Enable(TRUE);
+/*====================================================================
+*
+* reportRecord
+*	Print recording bandwidth and queue depth.
+*
+* Params:
+*	record		Recording.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Printed to stderr, as stdout carries the video.  The queue
+*	depth is the spokes waiting for the disk now and the most since
+*	the previous report; dropped spokes found the queue full.
+*
+*===================================================================*/
+static void reportRecord(SPxLiveRecord *record)
+{
+    SPxLiveRecord::Stats stats;
+    record->GetStats(&stats);
+    fprintf(stderr, "Record %s: %.1f spokes/s, bandwidth %.2f,"
+	    " compression %.2f, queue %u (max %u), %llu dropped,"
+	    " %llu errors, file %u '%s'.\n", record->GetSpec(),
+	    stats.spokesPerSec, stats.bandwidth, stats.compression,
+	    stats.queueDepth, stats.maxQueueDepth,
+	    (unsigned long long)stats.numDropped,
+	    (unsigned long long)stats.numErrors, stats.numFiles, stats.fileName);
+} /* reportRecord() */
 
-    /*
-     * Run the main loop.
-     */
-    while( !MainLoopFinish )
+
+/*====================================================================
+*
+* reportWeb
+*	Print browser viewer server and client statistics.
+*
+* Params:
+*	web		Browser viewer server.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Printed to stderr, as stdout carries the video.  Rates cover
+*	the time since the previous report; compression is the row
+*	bytes over the bytes queued, shared the sector messages that
+*	were encoded for another client.
+*
+*===================================================================*/
+static void reportWeb(SPxWebStream *web)
+{
+    SPxWebStream::Stats stats;
+    std::vector<SPxWebStream::ClientStats> clients;
+    web->GetStats(&stats, &clients);
+    if( stats.secs <= 0.0 )
     {
-	/* In a real application, we would normally do things in the main
-	 * loop such as provide a user interface, display graphics and
-	 * so on, but in this example we just make sure that we don't
-	 * busy wait.
-	 */
-	SPxTimeSleepMsecs(100);
-    } /* end of main loop */
+	return;
+    }
+    fprintf(stderr, "Web %s: %.1f spokes/s, %.1f sectors/s, %u clients,"
+	    " %.1f%% CPU.\n", web->GetSpec(), stats.numSpokes / stats.secs,
+	    stats.numSectors / stats.secs, (unsigned int)clients.size(),
+	    100.0 * stats.cpuSecs / stats.secs);
+    for(size_t i = 0; i < clients.size(); i++)
+    {
+	const SPxWebStream::ClientStats *c = &clients[i];
+	fprintf(stderr, "Web client %u (%s): %.1f updates/s, %.1f kB/s,"
+		" compression %.2f, %.0f%% shared, %llu deferred,"
+		" %llu resyncs, %lu bytes queued.\n", c->id, c->peer.c_str(),
+		c->numUpdates / stats.secs, c->numBytes / 1024.0 / stats.secs,
+		(c->numBytes > 0) ? ((double)c->numRawBytes / c->numBytes) : 0.0,
+		(c->numSectors > 0) ? (100.0 * c->numShared / c->numSectors) : 0.0,
+		(unsigned long long)c->numDeferred,
+		(unsigned long long)c->numResyncs,
+		(unsigned long)c->pendingBytes);
+    }
+} /* reportWeb() */
 
-    /*
-     * Tidy up.
-     */
-    delete src;
 
-    /* Sleep for a while so the console window doesn't vanish immediately
-     * in case this isn't being run inside a console box on windows.
-     */
-    SPxTimeSleepMsecs(EXIT_DELAY_TIME);
+/*====================================================================
+*
+* reportChannel
+*	Print a channel's rate, drop and latency statistics.
+*
+* Params:
+*	context		Channel,
+*	src		Its SDK source, or NULL,
+*	batchSrc	Its native source (-B), or NULL,
+*	tag		Channel prefix, "" if one channel.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Printed to stderr, as stdout carries the video.  The spoke rate,
+*	output lines, output drops (queue full) and latency (spoke
+*	received to line written) cover the time since the previous
+*	report; the receive losses are totals.
+*
+*===================================================================*/
+static void reportChannel(StreamContext *context, SPxNetworkReceive *src,
+				SPxBatchReceive *batchSrc, const char *tag)
+{
+    int64_t now = SPxStreamOutput::NowUsecs();
+    unsigned long long numSpokes = context->numSpokes;
+    double secs = (now - context->lastReportUsecs) / 1000000.0;
+    double rate = (secs > 0.0)
+	? ((numSpokes - context->lastSpokes) / secs) : 0.0;
+    context->lastSpokes = numSpokes;
+    context->lastReportUsecs = now;
 
-    /* Finished. */
-    exit(0);
-} /* main() */
+    /* 수신 손실: SDK 소스는 손실/불량 패킷, 네이티브는 커널 드롭과 미완성 */
+    unsigned long long lost = 0;
+    if( src != NULL )
+    {
+	lost = (unsigned long long)src->GetNumLostPackets()
+	    + src->GetNumBadPackets();
+    }
+    else if( batchSrc != NULL )
+    {
+	SPxBatchReceive::Stats stats;
+	batchSrc->GetStats(&stats);
+	lost = stats.numKernelDrops + stats.numIncomplete + stats.numBad;
+    }
 
+    SPxStreamOutput::Stats outStats;
+    context->output->GetStats(context->channel, &outStats);
+    fprintf(stderr, "%sStream: %.1f spokes/s, %llu lost, %llu lines,"
+	    " %llu dropped, latency %.2f ms mean, %.2f ms max.\n", tag,
+	    rate, lost, (unsigned long long)outStats.numLines,
+	    (unsigned long long)outStats.numDropped,
+	    outStats.meanLatencyMs, outStats.maxLatencyMs);
+} /* reportChannel() */
 
-/*********************************************************************
+
+/*====================================================================
 *
-*	Private functions.
+* reportLatency
+*	Print the video latency histogram.
 *
-**********************************************************************/
+* Params:
+*	output		Multiplexed video output,
+*	always		FALSE to print nothing if no spoke was written.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	From a spoke's arrival (its recvmmsg() with -B, else the SDK's
+*	call of handleRadar()) to its line written, all channels.
+*	Printed to stderr on SIGUSR1, and on exit if it has values.
+*
+*===================================================================*/
+static void reportLatency(SPxStreamOutput *output, int always)
+{
+    SPxLatencyHistogram histogram;
+    output->GetHistogram(&histogram);
+    if( !always && (histogram.GetCount() == 0) )
+    {
+	return;
+    }
+    histogram.Print(stderr, "Latency (arrival to written)");
+} /* reportLatency() */
+
 
 /*====================================================================
 *
-* spxErrorHandler
-*	Callback function for errors reported by the SPx library.
+* reportTelemetry
+*	Write a channel's telemetry line.
 *
 * Params:
-*	errType, errCode	Error type and code,
-*	arg1 - arg4		Error values.
+*	telemetry	Where to write it,
+*	context		Channel,
+*	src		Its SDK source, or NULL,
+*	batchSrc	Its native source (-B), or NULL.
 *
 * Returns:
 *	Nothing
 *
 * Notes
+*	Datagrams are only counted by the native receiver, so pkts_s is
+*	"-" for an SDK source.  src_lost is the source's own loss total
+*	(as in reportChannel()), beside the misses seen in the count.
 *
 *===================================================================*/
-static void spxErrorHandler(SPxErrorType errType, SPxErrorCode errCode,
-				int arg1, int arg2,
-				const char *arg3, const char *arg4)
+static void reportTelemetry(SPxTelemetryOutput *telemetry,
+				StreamContext *context, SPxNetworkReceive *src,
+				SPxBatchReceive *batchSrc)
 {
-    /* We simply report errors to stdout. */
-    printf("SPx Error #%d, args %d, %d, %s, %s.\n",
-		errCode, arg1, arg2,
-		(arg3 ? arg3 : "<none>"),
-		(arg4 ? arg4 : "<none>"));
-    return;
-} /* spxErrorHandler() */
+    if( src != NULL )
+    {
+	context->telemetry->SetSourceTotals(-1,
+	    (uint64_t)src->GetNumLostPackets() + src->GetNumBadPackets());
+    }
+    else if( batchSrc != NULL )
+    {
+	SPxBatchReceive::Stats stats;
+	batchSrc->GetStats(&stats);
+	context->telemetry->SetSourceTotals((int64_t)stats.numPackets,
+	    stats.numKernelDrops + stats.numIncomplete + stats.numBad);
+    }
+
+    SPxSpokeTelemetry::Stats stats;
+    char line[512];
+    context->telemetry->GetStats(&stats);
+    SPxSpokeTelemetry::FormatLine(line, sizeof(line), "SPxLiveStream",
+				  context->channel, &stats);
+    telemetry->Write(line);
+} /* reportTelemetry() */
 
 
 /*====================================================================
 *
-* handleRadar
-*	Function to handle a spoke of radar data from the network.
+* parseSource
+*	Parse a source option, "<addr>[:port][@ifAddr]".
 *
 * Params:
-*	src		Pointer to radar source object we are using,
-*	arg		User argument we gave when installing this handler
-*			function (not used in this example),
-*	hdr		Pointer to header structure describing the spoke,
-*	data		Pointer to the radar data for this return.
+*	arg		Option, split in place,
+*	source		Filled in, with 0/NULL for what is not given.
 *
 * Returns:
-*	Nothing
+*	Zero on success, -1 if invalid.
 *
 * Notes
 *
 *===================================================================*/
-static void handleRadar(SPxNetworkReceive *src, void *arg,
-				SPxReturnHeader *hdr, unsigned char *data)
+static int parseSource(char *arg, StreamSource *source)
 {
-    static char buffer[4096];
-    size_t offset = 0;
-    
-    float azimuthDegrees = (float)hdr->azimuth * 360.0f / 65536.0f;
-    
-    struct timespec ts;
-    clock_gettime(CLOCK_REALTIME, &ts);
-    long long current_time_ms = (long long)ts.tv_sec * 1000LL + (ts.tv_nsec / 1000000LL);
+    memset(source, 0, sizeof(*source));
+    source->cpu = -1;
 
-    offset += snprintf(buffer + offset, sizeof(buffer) - offset, 
-                      "%.2f,%.1f,%lld", azimuthDegrees, hdr->endRange, current_time_ms);
-    
-    unsigned int bps = SPxGetPackingBytesPerSample(hdr->packing);
-    if (bps == 1) {
-        for (unsigned int i = 0; i < hdr->thisLength && 
-             offset < (size_t)(sizeof(buffer) - 8); i++) {
-            offset += snprintf(buffer + offset, sizeof(buffer) - offset, ",%d", data[i]);
-        }
+    char *at = strchr(arg, '@');
+    if( at != NULL )
+    {
+	*at = '\0';
+	if( at[1] == '\0' )
+	{
+	    return(-1);
+	}
+	source->ifAddr = at + 1;
     }
-    else if (bps == 2) {
-        UINT16 *data16 = (UINT16 *)data;
-        for (unsigned int i = 0; i < hdr->thisLength && 
-             offset < (size_t)(sizeof(buffer) - 8); i++) {
-            offset += snprintf(buffer + offset, sizeof(buffer) - offset, ",%d", data16[i]);
-        }
+    char *colon = strchr(arg, ':');
+    if( colon != NULL )
+    {
+	char *end = NULL;
+	*colon = '\0';
+	long port = strtol(colon + 1, &end, 0);
+	if( (end == colon + 1) || (*end != '\0') || (port < 1) || (port > 65535) )
+	{
+	    return(-1);
+	}
+	source->port = (int)port;
     }
-    
-    if (offset < (size_t)(sizeof(buffer) - 2)) {
-        buffer[offset++] = '\n';
-        buffer[offset] = '\0';
-        fwrite(buffer, 1, offset, stdout);
-        fflush(stdout);
+    if( arg[0] == '\0' )
+    {
+	return(-1);
     }
-} /* handleRadar() */
+    source->addr = arg;
+    return(0);
+} /* parseSource() */
+
+
+/*====================================================================
+*
+* parseCpus
+*	Parse the receive thread cores, "<cpu>[,<cpu>...]".
+*
+* Params:
+*	arg		Option,
+*	sources		Sources to set the cores of, in order.
+*
+* Returns:
+*	Zero on success, -1 if invalid.
+*
+* Notes
+*	One core for all sources is allowed; otherwise there must be
+*	one per source.
+*
+*===================================================================*/
+static int parseCpus(const char *arg, std::vector<StreamSource> *sources)
+{
+    std::vector<int> cpus;
+    const char *p = arg;
+    for(;;)
+    {
+	char *end = NULL;
+	long cpu = strtol(p, &end, 0);
+	if( (end == p) || (cpu < 0) || (cpu > 1023) )
+	{
+	    return(-1);
+	}
+	cpus.push_back((int)cpu);
+	if( *end == '\0' )
+	{
+	    break;
+	}
+	if( *end != ',' )
+	{
+	    return(-1);
+	}
+	p = end + 1;
+    }
+    if( (cpus.size() != 1) && (cpus.size() != sources->size()) )
+    {
+	return(-1);
+    }
+    for(size_t i = 0; i < sources->size(); i++)
+    {
+	(*sources)[i].cpu = cpus[(cpus.size() == 1) ? 0 : i];
+    }
+    return(0);
+} /* parseCpus() */
 
 
 /*====================================================================
@@ -499,8 +1911,9 @@ static SPxErrorCode osInit(void)
 	return(SPX_ERR_SYSCALL);
     }
 #else
-    /* Install our tidy-up function. */
+    /* Install our tidy-up function, and the latency histogram dump. */
     signal(SIGINT, sigIntHandler);
+    signal(SIGUSR1, sigUsr1Handler);
 #endif
 
     /* Done. */
@@ -541,6 +1954,28 @@ static void sigIntHandler(int sig)
     MainLoopFinish = 1;
     return;
 } /* sigIntHandler() */
+
+
+/*====================================================================
+*
+* sigUsr1Handler
+*	Handler function for SIGUSR1.
+*
+* Params:
+*	sig		Signal we are being called for.
+*
+* Returns:
+*	Nothing
+*
+* Notes:
+*	Tells the main loop to print the latency histogram.
+*
+*===================================================================*/
+static void sigUsr1Handler(int sig)
+{
+    LatencyDump = 1;
+    return;
+} /* sigUsr1Handler() */
 #endif
 
 
@@ -0,0 +1,811 @@
+/*********************************************************************
+*
+* File: SPxLoadGen.cpp
+*
+* Purpose:
+*	Load generator and test driver for SPxLiveStream, so live mode
+*	can be measured without a radar.
+*
+*	Radar video is sent as SPx or ASTERIX Cat-240 (-x) to a
+*	multicast group, by default on the loopback interface.  It is
+*	either synthesised by SPxTestGenerator (returns per second,
+*	scan period, range and test pattern), each return sent through
+*	SPxVideoRepublish, or replayed from a recording (-f) at N times
+*	real time by SPxNetworkReplay.
+*
+*	With -D the program also drives a streamer: the command is run
+*	with its stdout (the video lines) read here, and the load is
+*	raised step by step.  For each step a line is printed with the
+*	spokes sent and received per second, the drop rate, the
+*	streamer's CPU and the end-to-end latency, until the drop rate
+*	passes the limit (saturation) or the steps run out.
+*
+*	Latency is from a spoke's send to its line being read here,
+*	matched by azimuth (the streamer prints it to 0.01 degrees).
+*	For a replay the send times are not known, so it is from the
+*	streamer's receive time printed in the line instead.  The
+*	streamer should have a single source (untagged lines).
+*
+*	Run the program with "-?" as the command line option to get a help
+*	message.
+*
+**********************************************************************/
+
+/* Standard headers. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#ifndef _WIN32
+#include <signal.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#endif
+
+/* SPx Library headers. */
+#include "SPxNoMFC.h"
+#ifdef _WIN32
+#include "SPxLibUtils/SPxGetOpt.h"
+#endif
+
+/* Sender and latency histogram. */
+#include "SPxLatencyHistogram.h"
+#include "SPxVideoRepublish.h"
+
+/*
+ * Constants.
+ */
+#define	USAGE "Usage:\n\tSPxLoadGen [options]\n"			\
+		"\nOptions:\n"						\
+		"\t-a <addr>[:port]\tSet multicast group (default SPx radar\n" \
+		"\t\t\tor ASTERIX group)\n"				\
+		"\t-D <command>\tDrive this streamer command, e.g.\n"	\
+		"\t\t\t\"./SPxLiveStream -B 64 -i 127.0.0.1\"\n"	\
+		"\t-e <metres>\tSet end range (default 20000)\n"	\
+		"\t-f <file>\tReplay this recording instead of synthesising\n" \
+		"\t-g <pattern>\tSet test pattern (default 1)\n"	\
+		"\t-i <ifAddr>\tSet interface (default 127.0.0.1)\n"	\
+		"\t-L <percent>\tDrop rate taken as saturation (default 1)\n" \
+		"\t-n <samples>\tSet samples per return (default 1024)\n" \
+		"\t-P <secs>\tSet scan period (default 2)\n"		\
+		"\t-r <load>\tReturns per second, or replay speed-up\n"	\
+		"\t\t\t(default 4096 or 1)\n"				\
+		"\t-S <factor>,<max>\tWith -D, multiply the load by factor\n" \
+		"\t\t\tper step up to max (default 2 and 64 x -r)\n"	\
+		"\t-t <secs>\tWith -D, seconds measured per step (default 10)\n" \
+		"\t-x\t\tSend ASTERIX Cat-240 instead of SPx\n"		\
+		"\t-?\t\tPrint usage information.\n\n"
+
+/* Test generator RIB, drained every main loop pass as nothing reads it. */
+#define	RIB_BYTES		(64 * 1024 * 1024)
+#define	DRAIN_BYTES		(1024 * 1024)
+
+/* Time for the streamer to start and join, and for each step to settle
+ * before it is measured, in milliseconds.
+ */
+#define	START_MSECS		2000
+#define	SETTLE_MSECS		2000
+
+/* Azimuth bins matching the streamer's 0.01 degree output. */
+#define	AZIMUTH_BINS		36000
+
+/* Longest video line read from the streamer. */
+#define	MAX_LINE_BYTES		65536
+
+/* How often sender statistics are printed without -D, in main loop
+ * passes.
+ */
+#define	SEND_REPORT_PASSES	50	/* 5 seconds */
+
+/* What the generator and the driver share. */
+typedef struct
+{
+    SPxVideoRepublish *link;		/* Synthesised video sender */
+    std::atomic<uint64_t> numSent;	/* Spokes (or replayed packets) */
+    std::vector<std::atomic<int64_t> > sendUsecs;	/* Per azimuth bin */
+    std::atomic<uint64_t> numLines;	/* Read from the streamer */
+    std::mutex mutex;			/* Guards the histogram */
+    SPxLatencyHistogram latency;
+    int replay;				/* Latency from the line's time */
+} LoadContext;
+
+/*
+ * Private function prototypes.
+ */
+static void spxErrorHandler(SPxErrorType errType, SPxErrorCode errCode,
+			    int arg1, int arg2,
+			    const char *arg3, const char *arg4);
+static void handleGenerated(SPxTestGenerator *testGen, void *userData,
+			    SPxReturnHeader *hdr, unsigned char *data);
+static void handleReplayed(unsigned int stream, const unsigned char *data,
+			   unsigned int numBytes, void *userArg);
+static void drainRib(SPxRIB *rib, std::vector<unsigned char> *scratch);
+static void setLoad(SPxTestGenerator *testGen, SPxNetworkReplay *replay,
+		    double load);
+static int64_t nowUsecs(void);
+static int64_t epochUsecs(void);
+#ifndef _WIN32
+static pid_t startStreamer(const char *command, FILE **out);
+static void readLines(FILE *in, LoadContext *context);
+static double cpuSecs(pid_t pid);
+#endif
+static void sigIntHandler(int sig);
+
+/* Exit flag. */
+static volatile int MainLoopFinish = 0;
+
+
+/*********************************************************************
+*
+*	Public functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* main
+*	Main entry point for the program.
+*
+* Params:
+*	argc, argv		Command line arguments.
+*
+* Returns:
+*	Zero on success, -1 on error.
+*
+* Notes
+*
+*===================================================================*/
+int main(int argc, char **argv)
+{
+    int c;
+    char *addr = NULL;
+    const char *ifAddr = "127.0.0.1";
+    int port = 0;
+    int cat240 = FALSE;
+    const char *file = NULL;
+    const char *command = NULL;
+    double load = 0.0;
+    double factor = 2.0;
+    double maxLoad = 0.0;
+    double stepSecs = 10.0;
+    double dropLimit = 1.0;
+    int numSamples = 1024;
+    double scanPeriod = 2.0;
+    double endRange = 20000.0;
+    int pattern = 1;
+
+    /* Process any command line arguments.  */
+    opterr = 0;
+    while( (c = getopt(argc, argv, "a:D:e:f:g:i:L:n:P:r:S:t:x?")) != -1 )
+    {
+	switch(c)
+	{
+	    case 'a':	addr = optarg;				break;
+	    case 'D':	command = optarg;			break;
+	    case 'e':	endRange = atof(optarg);		break;
+	    case 'f':	file = optarg;				break;
+	    case 'g':	pattern = strtol(optarg, NULL, 0);	break;
+	    case 'i':	ifAddr = optarg;			break;
+	    case 'L':	dropLimit = atof(optarg);		break;
+	    case 'n':	numSamples = strtol(optarg, NULL, 0);	break;
+	    case 'P':	scanPeriod = atof(optarg);		break;
+	    case 'r':	load = atof(optarg);			break;
+	    case 'S':
+		if( sscanf(optarg, "%lf,%lf", &factor, &maxLoad) < 1 )
+		{
+		    factor = 0.0;
+		}
+		break;
+	    case 't':	stepSecs = atof(optarg);		break;
+	    case 'x':	cat240 = TRUE;				break;
+	    case '?':	/* fall through */
+	    default:
+		fprintf(stderr, "\n%s", USAGE);
+		exit(-1);
+	}
+    } /* end of for each option */
+
+    if( load <= 0.0 )
+    {
+	load = (file != NULL) ? 1.0 : 4096.0;
+    }
+    if( maxLoad <= 0.0 )
+    {
+	maxLoad = 64.0 * load;
+    }
+    if( (numSamples < 1) || (numSamples > 65535) || (scanPeriod <= 0.0)
+	|| (endRange <= 0.0) || (factor <= 1.0) || (stepSecs < 1.0)
+	|| (dropLimit < 0.0) )
+    {
+	fprintf(stderr, "Invalid parameters.\n\n%s", USAGE);
+	exit(-1);
+    }
+#ifdef _WIN32
+    if( command != NULL )
+    {
+	fprintf(stderr, "Driving a streamer (-D) is not supported on"
+		" Windows.\n");
+	exit(-1);
+    }
+#endif
+
+    /* "주소[:포트]" */
+    if( addr != NULL )
+    {
+	char *colon = strchr(addr, ':');
+	if( colon != NULL )
+	{
+	    *colon = '\0';
+	    port = strtol(colon + 1, NULL, 0);
+	}
+    }
+    if( addr == NULL )
+    {
+	addr = (char *)(cat240 ? SPX_SCNET_DEFAULT_ADDR_ASTERIX
+			: SPX_SCNET_DEFAULT_ADDR_RADAR);
+    }
+    if( port == 0 )
+    {
+	port = cat240 ? SPX_SCNET_DEFAULT_PORT_ASTERIX : SPX_SCNET_DEFAULT_PORT_RADAR;
+    }
+    signal(SIGINT, sigIntHandler);
+
+    SPxSetErrorHandler(spxErrorHandler);
+    if( SPxInit() != SPX_NO_ERROR )
+    {
+	fprintf(stderr, "Failed to initialise SPx library.\n");
+	exit(-1);
+    }
+    SPxLicInit();
+
+    LoadContext context;
+    context.link = NULL;
+    context.numSent = 0;
+    context.sendUsecs = std::vector<std::atomic<int64_t> >(AZIMUTH_BINS);
+    for(size_t i = 0; i < context.sendUsecs.size(); i++)
+    {
+	context.sendUsecs[i] = 0;
+    }
+    context.numLines = 0;
+    context.replay = (file != NULL);
+
+    /*
+     * Source: a recording replayed to the group, or the test generator
+     * with each return sent on by its data function.
+     */
+    SPxNetworkReplay *replay = NULL;
+    SPxTestGenerator *testGen = NULL;
+    SPxRIB *rib = NULL;
+    std::vector<unsigned char> scratch;
+    char dest[256];
+    snprintf(dest, sizeof(dest), "%s:%d", addr, port);
+    if( file != NULL )
+    {
+	replay = new SPxNetworkReplay();
+	if( (replay->SetFileName(file) != SPX_NO_ERROR)
+	    || (replay->OverrideAddress(0, dest) != SPX_NO_ERROR)
+	    || (replay->AddHandler(handleReplayed, &context) != SPX_NO_ERROR) )
+	{
+	    fprintf(stderr, "Failed to replay '%s' to %s.\n", file, dest);
+	    exit(-1);
+	}
+	replay->SetAutoLoop(TRUE);
+	replay->SetSpeedupFactor(load);
+	replay->EnableOutput(TRUE);
+	printf("SPxLoadGen: replaying '%s' to %s at %.1fx.\n", file, dest, load);
+    }
+    else
+    {
+	char spec[512];
+	snprintf(spec, sizeof(spec), "%s@%s,%s", dest, ifAddr,
+		 cat240 ? "cat240" : "spx");
+	context.link = new SPxVideoRepublish();
+	if( context.link->Create(spec) != 0 )
+	{
+	    fprintf(stderr, "Invalid option: %s.\n", context.link->GetError());
+	    exit(-1);
+	}
+	rib = new SPxRIB(RIB_BYTES);
+	scratch.resize(DRAIN_BYTES);
+	testGen = new SPxTestGenerator(rib, numSamples, scanPeriod,
+				       (int)load, pattern);
+	testGen->SetEndRangeMetres(endRange);
+	testGen->SetPattern(pattern);
+	if( testGen->InstallDataFn(handleGenerated, &context) != SPX_NO_ERROR )
+	{
+	    fprintf(stderr, "Failed to install generator handler.\n");
+	    exit(-1);
+	}
+	printf("SPxLoadGen: %s to %s, %d samples, %.1f s scan, pattern %d,"
+	       " %.0f returns/s.\n", cat240 ? "ASTERIX Cat-240" : "SPx",
+	       spec, numSamples, scanPeriod, pattern, load);
+    }
+    if( replay != NULL )
+    {
+	replay->Play();
+    }
+    else
+    {
+	testGen->Enable(TRUE);
+    }
+    fflush(stdout);
+
+    if( command == NULL )
+    {
+	/* 드라이버 없이 Ctrl-C 까지 보냄 */
+	int passes = 0;
+	while( !MainLoopFinish )
+	{
+	    SPxTimeSleepMsecs(100);
+	    drainRib(rib, &scratch);
+	    if( (++passes % SEND_REPORT_PASSES) == 0 )
+	    {
+		uint64_t numSent = context.numSent.exchange(0);
+		fprintf(stderr, "Sent %.1f %s/s.\n", numSent / 5.0,
+			(replay != NULL) ? "packets" : "spokes");
+	    }
+	}
+    }
+#ifndef _WIN32
+    else
+    {
+	FILE *in = NULL;
+	pid_t pid = startStreamer(command, &in);
+	if( pid < 0 )
+	{
+	    fprintf(stderr, "Failed to run '%s'.\n", command);
+	    exit(-1);
+	}
+	std::thread reader(readLines, in, &context);
+	int saturated = FALSE;
+	for(int ms = 0; (ms < START_MSECS) && !MainLoopFinish; ms += 100)
+	{
+	    SPxTimeSleepMsecs(100);
+	    drainRib(rib, &scratch);
+	}
+
+	printf("\n%10s %12s %12s %8s %8s %10s %10s %10s\n",
+	       (replay != NULL) ? "speed" : "returns/s",
+	       (replay != NULL) ? "sent pkt/s" : "sent/s", "received/s",
+	       "drop %", "CPU %", "p50 ms", "p99 ms", "max ms");
+	for(double step = load; (step <= maxLoad * 1.0001) && !MainLoopFinish;
+	    step *= factor)
+	{
+	    /* 부하를 바꾸고 안정된 뒤 측정 */
+	    setLoad(testGen, replay, step);
+	    for(int ms = 0; (ms < SETTLE_MSECS) && !MainLoopFinish; ms += 100)
+	    {
+		SPxTimeSleepMsecs(100);
+		drainRib(rib, &scratch);
+	    }
+	    context.numSent = 0;
+	    context.numLines = 0;
+	    {
+		std::lock_guard<std::mutex> lock(context.mutex);
+		context.latency.Reset();
+	    }
+	    double cpuStart = cpuSecs(pid);
+	    int64_t start = nowUsecs();
+	    for(int ms = 0; (ms < stepSecs * 1000.0) && !MainLoopFinish; ms += 100)
+	    {
+		SPxTimeSleepMsecs(100);
+		drainRib(rib, &scratch);
+	    }
+	    double secs = (nowUsecs() - start) / 1e6;
+	    double cpu = 100.0 * (cpuSecs(pid) - cpuStart) / secs;
+	    double sent = context.numSent / secs;
+	    double received = context.numLines / secs;
+	    double drop = (sent > 0.0) ? (100.0 * (1.0 - received / sent)) : 0.0;
+	    if( drop < 0.0 )
+	    {
+		drop = 0.0;
+	    }
+	    SPxLatencyHistogram latency;
+	    {
+		std::lock_guard<std::mutex> lock(context.mutex);
+		latency = context.latency;
+	    }
+	    printf("%10.1f %12.1f %12.1f %8.2f %8.1f %10.3f %10.3f %10.3f\n",
+		   step, sent, received, drop, cpu,
+		   latency.GetPercentile(50.0) / 1000.0,
+		   latency.GetPercentile(99.0) / 1000.0,
+		   latency.GetMax() / 1000.0);
+	    fflush(stdout);
+	    if( drop > dropLimit )
+	    {
+		printf("\nSaturated at %.1f (drop %.2f%% > %.2f%%).\n",
+		       step, drop, dropLimit);
+		saturated = TRUE;
+		break;
+	    }
+	}
+	if( !saturated && !MainLoopFinish )
+	{
+	    printf("\nNot saturated up to %.1f.\n", maxLoad);
+	}
+
+	/* 스트리머를 멈추면 파이프가 닫혀 읽기 스레드도 끝남 */
+	kill(pid, SIGINT);
+	waitpid(pid, NULL, 0);
+	reader.join();
+	fclose(in);
+    }
+#endif
+
+    if( testGen != NULL )
+    {
+	testGen->Enable(FALSE);
+    }
+    delete replay;
+    delete testGen;
+    delete rib;
+    delete context.link;
+    return(0);
+} /* main() */
+
+
+/*********************************************************************
+*
+*	Private functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* spxErrorHandler
+*	Callback function for errors reported by the SPx library.
+*
+* Params:
+*	errType, errCode	Error type and code,
+*	arg1 - arg4		Error values.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+static void spxErrorHandler(SPxErrorType errType, SPxErrorCode errCode,
+			    int arg1, int arg2,
+			    const char *arg3, const char *arg4)
+{
+    fprintf(stderr, "SPx Error #%d, args %d, %d, %s, %s.\n",
+	    errCode, arg1, arg2,
+	    (arg3 ? arg3 : "<none>"),
+	    (arg4 ? arg4 : "<none>"));
+    return;
+} /* spxErrorHandler() */
+
+
+/*====================================================================
+*
+* handleGenerated
+*	Send a return built by the test generator.
+*
+* Params:
+*	testGen			Generator,
+*	userData		LoadContext,
+*	hdr, data		Return.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Called on the generator's thread.  The send time is kept by
+*	azimuth for the latency.
+*
+*===================================================================*/
+static void handleGenerated(SPxTestGenerator *testGen, void *userData,
+			    SPxReturnHeader *hdr, unsigned char *data)
+{
+    LoadContext *context = (LoadContext *)userData;
+    unsigned int bps = SPxGetPackingBytesPerSample(hdr->packing);
+    double degrees = hdr->azimuth * 360.0 / 65536.0;
+    unsigned int bin = (unsigned int)(degrees * 100.0 + 0.5) % AZIMUTH_BINS;
+    context->sendUsecs[bin] = nowUsecs();
+    context->link->Send(hdr, data, hdr->thisLength, bps);
+    context->numSent++;
+} /* handleGenerated() */
+
+
+/*====================================================================
+*
+* handleReplayed
+*	Count a replayed packet.
+*
+* Params:
+*	stream			Stream index,
+*	data, numBytes		Packet,
+*	userArg			LoadContext.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	A spoke is usually one packet, so these stand in for spokes
+*	sent.
+*
+*===================================================================*/
+static void handleReplayed(unsigned int stream, const unsigned char *data,
+			   unsigned int numBytes, void *userArg)
+{
+    LoadContext *context = (LoadContext *)userArg;
+    context->numSent++;
+} /* handleReplayed() */
+
+
+/*====================================================================
+*
+* drainRib
+*	Discard what the test generator wrote to its RIB.
+*
+* Params:
+*	rib			RIB, or NULL,
+*	scratch			Buffer to read into.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	The returns are sent from the data function, so the RIB is
+*	only kept from filling up.
+*
+*===================================================================*/
+static void drainRib(SPxRIB *rib, std::vector<unsigned char> *scratch)
+{
+    if( rib == NULL )
+    {
+	return;
+    }
+    int waiting = rib->BytesWaitingInBuffer();
+    while( waiting > 0 )
+    {
+	int n = (waiting < (int)scratch->size()) ? waiting : (int)scratch->size();
+	if( rib->Read(n, &(*scratch)[0]) <= 0 )
+	{
+	    break;
+	}
+	waiting -= n;
+    }
+} /* drainRib() */
+
+
+/*====================================================================
+*
+* setLoad
+*	Set the load of the source.
+*
+* Params:
+*	testGen			Generator, or NULL,
+*	replay			Replay, or NULL,
+*	load			Returns per second, or speed-up.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+static void setLoad(SPxTestGenerator *testGen, SPxNetworkReplay *replay,
+		    double load)
+{
+    if( testGen != NULL )
+    {
+	testGen->SetReturnsPerSecond((unsigned)load);
+    }
+    if( replay != NULL )
+    {
+	replay->SetSpeedupFactor(load);
+    }
+} /* setLoad() */
+
+
+/*====================================================================
+*
+* nowUsecs, epochUsecs
+*	Get the monotonic or wall clock time.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Microseconds.
+*
+* Notes
+*	The wall clock is compared with the streamer's line times.
+*
+*===================================================================*/
+static int64_t nowUsecs(void)
+{
+    return( std::chrono::duration_cast<std::chrono::microseconds>(
+	std::chrono::steady_clock::now().time_since_epoch()).count() );
+} /* nowUsecs() */
+
+static int64_t epochUsecs(void)
+{
+    return( std::chrono::duration_cast<std::chrono::microseconds>(
+	std::chrono::system_clock::now().time_since_epoch()).count() );
+} /* epochUsecs() */
+
+
+#ifndef _WIN32
+/*====================================================================
+*
+* startStreamer
+*	Run the streamer command with its stdout piped to us.
+*
+* Params:
+*	command			Shell command,
+*	out			Set to the read end of the pipe.
+*
+* Returns:
+*	Process id, or -1 on error.
+*
+* Notes
+*	The command is exec'd by the shell, so the process id (for the
+*	CPU time and SIGINT) is the streamer's own.  Its stderr is left
+*	on ours.
+*
+*===================================================================*/
+static pid_t startStreamer(const char *command, FILE **out)
+{
+    int fds[2];
+    if( pipe(fds) != 0 )
+    {
+	return(-1);
+    }
+    pid_t pid = fork();
+    if( pid < 0 )
+    {
+	close(fds[0]);
+	close(fds[1]);
+	return(-1);
+    }
+    if( pid == 0 )
+    {
+	dup2(fds[1], STDOUT_FILENO);
+	close(fds[0]);
+	close(fds[1]);
+	std::string shell = std::string("exec ") + command;
+	execl("/bin/sh", "sh", "-c", shell.c_str(), (char *)NULL);
+	_exit(127);
+    }
+    close(fds[1]);
+    *out = fdopen(fds[0], "r");
+    return(pid);
+} /* startStreamer() */
+
+
+/*====================================================================
+*
+* readLines
+*	Count the streamer's video lines and their latency.
+*
+* Params:
+*	in			Streamer's stdout,
+*	context			LoadContext.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Runs on its own thread until the pipe closes.  Lines are
+*	"<azimuth>,<end range>,<epoch ms>,<samples...>"; others (the
+*	banner) are skipped.
+*
+*===================================================================*/
+static void readLines(FILE *in, LoadContext *context)
+{
+    std::vector<char> line(MAX_LINE_BYTES);
+    while( fgets(&line[0], (int)line.size(), in) != NULL )
+    {
+	int64_t now = nowUsecs();
+	double degrees = 0.0;
+	double endRange = 0.0;
+	long long timeMs = 0;
+	if( sscanf(&line[0], "%lf,%lf,%lld", &degrees, &endRange, &timeMs) != 3 )
+	{
+	    continue;
+	}
+	context->numLines++;
+
+	/* 합성은 방위별 송신 시각, 재생은 줄의 수신 시각부터 */
+	int64_t usecs = -1;
+	if( context->replay )
+	{
+	    usecs = epochUsecs() - (int64_t)timeMs * 1000;
+	}
+	else
+	{
+	    unsigned int bin = (unsigned int)(degrees * 100.0 + 0.5) % AZIMUTH_BINS;
+	    int64_t sent = context->sendUsecs[bin];
+	    if( sent > 0 )
+	    {
+		usecs = now - sent;
+	    }
+	}
+	if( usecs >= 0 )
+	{
+	    std::lock_guard<std::mutex> lock(context->mutex);
+	    context->latency.Record(usecs);
+	}
+    }
+} /* readLines() */
+
+
+/*====================================================================
+*
+* cpuSecs
+*	Get a process's CPU time.
+*
+* Params:
+*	pid			Process.
+*
+* Returns:
+*	User plus system seconds, 0 if unknown.
+*
+* Notes
+*	From /proc/<pid>/stat (fields 14 and 15, in clock ticks).
+*
+*===================================================================*/
+static double cpuSecs(pid_t pid)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/stat", (int)pid);
+    FILE *f = fopen(path, "r");
+    if( f == NULL )
+    {
+	return(0.0);
+    }
+    char buf[1024];
+    size_t len = fread(buf, 1, sizeof(buf) - 1, f);
+    fclose(f);
+    buf[len] = '\0';
+
+    /* 명령 이름에 공백이 있을 수 있어 마지막 ')' 뒤부터 셈 */
+    char *p = strrchr(buf, ')');
+    unsigned long utime = 0;
+    unsigned long stime = 0;
+    if( (p == NULL) || (sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u"
+			       " %*u %*u %lu %lu", &utime, &stime) != 2) )
+    {
+	return(0.0);
+    }
+    return( (double)(utime + stime) / (double)sysconf(_SC_CLK_TCK) );
+} /* cpuSecs() */
+#endif
+
+
+/*====================================================================
+*
+* sigIntHandler
+*	Handler function for SIGINT (i.e. Ctrl-C).
+*
+* Params:
+*	sig			Signal we are being called for.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Stops sending (and driving) so we can clean up.
+*
+*===================================================================*/
+static void sigIntHandler(int sig)
+{
+    MainLoopFinish = 1;
+} /* sigIntHandler() */
+
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
@@ -0,0 +1,988 @@
+/*********************************************************************
+*
+* File: SPxMaskBuilder.cpp
+*
+* Purpose:
+*	Build a static clutter mask (see SPxClutterMask.h) from recorded
+*	rotations.
+*
+*	The input is either a recording file, replayed with SPxRadarReplay
+*	as fast as it can be read, or a directory written by
+*	SPxDataConverter (one radar_data_NNNNN.txt file per rotation).
+*	Rotations are shared out over a SPxWorkPool, each worker
+*	collecting occupancy statistics (see SPxOccupancy.h) in its own
+*	grid, and the grids are merged at the end.  Cells occupied in at
+*	least the given percentage of rotations are blocked, or
+*	attenuated for a gain mask.
+*
+*	The mask is applied with the "mask:<file>" stage of the filter
+*	chain, in the streamers (-F) and in the Python viewer.
+*
+**********************************************************************/
+
+/* Standard headers. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+#ifndef _WIN32
+#include <unistd.h>
+#include <signal.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#else
+#include <io.h>
+#endif
+
+/* SPx Library headers. */
+#include "SPxNoMFC.h"
+#ifdef _WIN32
+#include "SPxLibUtils/SPxGetOpt.h"
+#endif
+
+/* Our own headers. */
+#include "SPxClutterMask.h"
+#include "SPxOccupancy.h"
+#include "SPxWorkPool.h"
+
+/*
+ * Constants.
+ */
+#define	USAGE "Usage:\n\tSPxMaskBuilder [options] -o <mask> <file.cpr|directory>\n" \
+		"\nOptions:\n"						\
+		"\t-a <azis>\tAzimuth bins per turn (default 4096)\n"	\
+		"\t-g <gates>\tRange gates (default: first spoke length)\n" \
+		"\t-l <level>\tSample level counted as occupied (default 128)\n" \
+		"\t-n <threads>\tWorker threads (default: number of cores)\n" \
+		"\t-o <mask>\tMask file to write\n"			\
+		"\t-p <percent>\tBlock cells occupied in this percentage of\n" \
+		"\t\t\trotations or more (default 50)\n"		\
+		"\t-t <type>\t\"bits\" (default) or \"gain\"\n"		\
+		"\t-v\t\tIncrease verbosity\n"				\
+		"\t-?\t\tPrint usage information.\n\n"
+
+/* Replay speed for recording files (as fast as the file can be read). */
+#define	REPLAY_SPEEDUP		1000.0
+
+/* Rotations queued per worker thread before replay waits. */
+#define	QUEUE_PER_THREAD	4
+
+/* Amount of time to sleep on exit, in milliseconds. */
+#ifdef _WIN32
+#define	EXIT_DELAY_TIME	5000	/* To keep console window on screen */
+#else
+#define	EXIT_DELAY_TIME	100
+#endif
+
+/*
+ * Types.
+ */
+/* One rotation of 8-bit spokes. */
+struct Rotation
+{
+    std::vector<double> azimuths;
+    std::vector<int> lengths;
+    std::vector<uint8_t> samples;	/* Spokes back to back */
+};
+
+/* Builder state shared with the replay handler and the workers. */
+struct Builder
+{
+    int numAzis;
+    int numGates;			/* 0 until known */
+    int level;
+    std::vector<SPxOccupancy *> occupancy;	/* One per worker */
+
+    /* Directory input. */
+    std::vector<std::string> files;
+    std::atomic<unsigned int> numBadFiles;
+
+    /* Recording input, filled by handleRadar(). */
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::deque<Rotation *> queue;
+    size_t maxQueued;
+    Rotation *current;
+    UINT16 lastAzi;
+    std::vector<Rotation *> batch;
+
+    std::atomic<unsigned long> numSpokes;
+};
+
+/*
+ * Private function prototypes.
+ */
+/* Error handler. */
+static void spxErrorHandler(SPxErrorType errType, SPxErrorCode errCode,
+				int arg1, int arg2,
+				const char *arg3, const char *arg4);
+
+/* Radar data handler. */
+static void handleRadar(SPxRadarReplay *src, void *arg,
+				SPxReturnHeader *hdr, unsigned char *data);
+
+/* Input. */
+static int isDirectory(const char *path);
+static int listRotationFiles(const char *dirname, std::vector<std::string> *files);
+static int readRotationFile(const char *filename, Rotation *rotation);
+static int runDirectory(Builder *builder, SPxWorkPool *pool, const char *dirname);
+static int runRecording(Builder *builder, SPxWorkPool *pool, const char *filename);
+
+/* Workers. */
+static void createOccupancy(Builder *builder, unsigned int numWorkers);
+static void addRotation(SPxOccupancy *occupancy, const Rotation *rotation);
+static void fileTask(void *userArg, unsigned int taskIdx, unsigned int workerIdx);
+static void batchTask(void *userArg, unsigned int taskIdx, unsigned int workerIdx);
+
+/* Init/shutdown utility functions. */
+static SPxErrorCode osInit(void);
+#ifdef _WIN32
+static BOOL WINAPI sigIntHandler(DWORD fdwCtrlType);
+#else
+static void sigIntHandler(int sig);
+#endif
+
+
+/*
+ * Global variables.
+ */
+/* Verbosity level. */
+static int Verbose = 0;
+
+/* Exit flag. */
+static int MainLoopFinish = 0;
+
+
+/*********************************************************************
+*
+*	Implementation functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* main
+*	Entry point for program.
+*
+* Params:
+*	argc, argv		Standard C arguments.
+*
+* Returns:
+*	Zero on success,
+*	Error code otherwise.
+*
+* Notes:
+*
+*===================================================================*/
+int main(int argc, char **argv)
+{
+    int c;				/* For parsing command line options */
+    int numAzis = 4096;			/* Azimuth bins */
+    int numGates = 0;			/* Range gates, 0 for first spoke */
+    int level = 128;			/* Occupied level */
+    int numThreads = 0;			/* Workers, 0 for all cores */
+    double percent = 50.0;		/* Blocking occupancy */
+    const char *outName = NULL;		/* Mask file */
+    SPxClutterMask::Type type = SPxClutterMask::TYPE_BITS;
+
+    /* Initialise operating system specific things. */
+    if( osInit() != SPX_NO_ERROR )
+    {
+	SPxTimeSleepMsecs(EXIT_DELAY_TIME);
+	exit(-1);
+    }
+
+    /* Process any command line arguments.  */
+    opterr = 0;
+    int badArg = FALSE;
+    while( (c = getopt(argc, argv, "a:g:l:n:o:p:t:v?")) != -1 )
+    {
+	switch(c)
+	{
+	    case 'a':	numAzis = strtol(optarg, NULL, 0);	break;
+	    case 'g':	numGates = strtol(optarg, NULL, 0);	break;
+	    case 'l':	level = strtol(optarg, NULL, 0);	break;
+	    case 'n':	numThreads = strtol(optarg, NULL, 0);	break;
+	    case 'o':	outName = optarg;			break;
+	    case 'p':	percent = strtod(optarg, NULL);		break;
+	    case 't':
+		if( strcmp(optarg, "bits") == 0 )
+		{
+		    type = SPxClutterMask::TYPE_BITS;
+		}
+		else if( strcmp(optarg, "gain") == 0 )
+		{
+		    type = SPxClutterMask::TYPE_GAIN;
+		}
+		else
+		{
+		    badArg = TRUE;
+		}
+		break;
+	    case 'v':	Verbose++;				break;
+	    case '?':	/* fall through */
+	    default:
+		fprintf(stderr, "\n%s", USAGE);
+		SPxTimeSleepMsecs(EXIT_DELAY_TIME);
+		exit(-1);
+	}
+    } /* end of for each option */
+
+    /*
+     * Check we have an input and an output, and sensible settings.
+     */
+    if( badArg || (optind >= argc) || (outName == NULL)
+	|| (numAzis <= 0) || (numAzis > 65536) || (numGates < 0)
+	|| (level < 0) || (level > 255) || (numThreads < 0)
+	|| (percent < 0.0) || (percent > 100.0) )
+    {
+	fprintf(stderr, "\n%s", USAGE);
+	SPxTimeSleepMsecs(EXIT_DELAY_TIME);
+	exit(-1);
+    }
+    const char *inName = argv[optind];
+
+    /*
+     * Welcome banner.
+     */
+    printf("\n### Cambridge Pixel SPxMaskBuilder %s ###\n\n",
+		SPX_VERSION_STRING);
+
+    Builder *builder = new Builder();
+    builder->numAzis = numAzis;
+    builder->numGates = numGates;
+    builder->level = level;
+    builder->numBadFiles = 0;
+    builder->current = NULL;
+    builder->lastAzi = 0xFFFF;
+    builder->numSpokes = 0;
+
+    SPxWorkPool *pool = new SPxWorkPool((numThreads > 0) ? numThreads
+					: SPxWorkPool::GetNumCores());
+    builder->maxQueued = pool->GetNumThreads() * QUEUE_PER_THREAD;
+
+    /*
+     * Collect the statistics.
+     */
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    int err = isDirectory(inName) ? runDirectory(builder, pool, inName)
+				  : runRecording(builder, pool, inName);
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now()
+						- start).count();
+    if( (err != 0) || builder->occupancy.empty() )
+    {
+	fprintf(stderr, "No rotations read from '%s'.\n", inName);
+	SPxTimeSleepMsecs(EXIT_DELAY_TIME);
+	exit(-1);
+    }
+
+    /* Merge the workers' grids into the first. */
+    SPxOccupancy *total = builder->occupancy[0];
+    for(size_t i = 1; i < builder->occupancy.size(); i++)
+    {
+	total->Merge(*builder->occupancy[i]);
+    }
+
+    /*
+     * Build and save the mask.
+     */
+    SPxClutterMask mask;
+    if( (total->BuildMask(&mask, type, percent / 100.0) != 0)
+	|| (mask.Save(outName) != 0) )
+    {
+	fprintf(stderr, "Failed to write mask '%s'.\n", outName);
+	SPxTimeSleepMsecs(EXIT_DELAY_TIME);
+	exit(-1);
+    }
+
+    size_t numCells = (size_t)mask.GetNumAzis() * mask.GetNumGates();
+    size_t numBlocked = 0;
+    const uint8_t *cells = mask.GetCells();
+    for(size_t i = 0; i < numCells; i++)
+    {
+	numBlocked += (cells[i] < 255);
+    }
+    printf("Rotations:\t%u (%lu spokes, %u unreadable files)\n",
+	   total->GetNumRotations(), (unsigned long)builder->numSpokes,
+	   (unsigned int)builder->numBadFiles);
+    printf("Grid:\t\t%d azimuths x %d gates, level %d\n",
+	   mask.GetNumAzis(), mask.GetNumGates(), level);
+    printf("Masked:\t\t%lu cells (%.2f%%) at %.1f%% occupancy, %s mask\n",
+	   (unsigned long)numBlocked, (100.0 * numBlocked) / numCells, percent,
+	   (type == SPxClutterMask::TYPE_BITS) ? "bits" : "gain");
+    printf("Time:\t\t%.2f s on %u threads\n", secs, pool->GetNumThreads());
+    printf("Wrote '%s'.\n", outName);
+
+    /*
+     * Tidy up.
+     */
+    for(size_t i = 0; i < builder->occupancy.size(); i++)
+    {
+	delete builder->occupancy[i];
+    }
+    delete builder;
+    delete pool;
+
+    /* Finished. */
+    exit(0);
+} /* main() */
+
+
+/*********************************************************************
+*
+*	Private functions.
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* spxErrorHandler
+*	Callback function for errors reported by the SPx library.
+*
+* Params:
+*	errType, errCode	Error type and code,
+*	arg1 - arg4		Error values.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+static void spxErrorHandler(SPxErrorType errType, SPxErrorCode errCode,
+				int arg1, int arg2,
+				const char *arg3, const char *arg4)
+{
+    /* We simply report errors to stdout. */
+    printf("SPx Error #%d, args %d, %d, %s, %s.\n",
+		errCode, arg1, arg2,
+		(arg3 ? arg3 : "<none>"),
+		(arg4 ? arg4 : "<none>"));
+    return;
+} /* spxErrorHandler() */
+
+
+/*====================================================================
+*
+* handleRadar
+*	Function to handle a spoke of radar data from the file.
+*
+* Params:
+*	src		Pointer to radar source object we are using,
+*	arg		The builder,
+*	hdr		Pointer to header structure describing the spoke,
+*	data		Pointer to the radar data for this return.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Completed rotations are queued for the workers; replay waits
+*	here while the queue is full.
+*
+*===================================================================*/
+static void handleRadar(SPxRadarReplay *src, void *arg,
+				SPxReturnHeader *hdr, unsigned char *data)
+{
+    Builder *builder = (Builder *)arg;
+    unsigned int bps = SPxGetPackingBytesPerSample(hdr->packing);
+    if( (builder == NULL) || ((bps != 1) && (bps != 2)) || (hdr->thisLength == 0) )
+    {
+	return;
+    }
+
+    /* 북쪽을 지나면 지금까지의 회전을 큐에 넣음 */
+    if( (hdr->azimuth < builder->lastAzi) && (builder->current != NULL) )
+    {
+	std::unique_lock<std::mutex> lock(builder->mutex);
+	while( (builder->queue.size() >= builder->maxQueued) && !MainLoopFinish )
+	{
+	    builder->cond.wait_for(lock, std::chrono::milliseconds(100));
+	}
+	builder->queue.push_back(builder->current);
+	builder->current = NULL;
+	builder->cond.notify_all();
+    }
+    builder->lastAzi = hdr->azimuth;
+
+    if( builder->current == NULL )
+    {
+	builder->current = new Rotation();
+    }
+    Rotation *rotation = builder->current;
+    size_t offset = rotation->samples.size();
+    rotation->azimuths.push_back((double)hdr->azimuth * 360.0 / 65536.0);
+    rotation->lengths.push_back((int)hdr->thisLength);
+    rotation->samples.resize(offset + hdr->thisLength);
+
+    /* 8비트 샘플로 변환 (16비트는 상위 바이트) */
+    uint8_t *samples = &rotation->samples[offset];
+    if( bps == 1 )
+    {
+	memcpy(samples, data, hdr->thisLength);
+    }
+    else
+    {
+	const UINT16 *data16 = (const UINT16 *)data;
+	for(unsigned int i = 0; i < hdr->thisLength; i++)
+	{
+	    samples[i] = (uint8_t)(data16[i] >> 8);
+	}
+    }
+} /* handleRadar() */
+
+
+/*====================================================================
+*
+* isDirectory
+*	Check whether a path is a directory.
+*
+* Params:
+*	path			Path to check.
+*
+* Returns:
+*	Non-zero for a directory.
+*
+* Notes
+*
+*===================================================================*/
+static int isDirectory(const char *path)
+{
+#ifdef _WIN32
+    struct _stat st;
+    return( (_stat(path, &st) == 0) && (st.st_mode & _S_IFDIR) );
+#else
+    struct stat st;
+    return( (stat(path, &st) == 0) && S_ISDIR(st.st_mode) );
+#endif
+} /* isDirectory() */
+
+
+/*====================================================================
+*
+* listRotationFiles
+*	List the rotation files written by SPxDataConverter.
+*
+* Params:
+*	dirname			Directory,
+*	files			Set to the paths, in rotation order.
+*
+* Returns:
+*	Zero on success, -1 if the directory cannot be read.
+*
+* Notes
+*
+*===================================================================*/
+static int listRotationFiles(const char *dirname, std::vector<std::string> *files)
+{
+    std::vector<std::string> names;
+#ifdef _WIN32
+    struct _finddata_t found;
+    std::string pattern = std::string(dirname) + "\\radar_data_*.txt";
+    intptr_t handle = _findfirst(pattern.c_str(), &found);
+    if( handle == -1 )
+    {
+	return(-1);
+    }
+    do
+    {
+	names.push_back(found.name);
+    } while( _findnext(handle, &found) == 0 );
+    _findclose(handle);
+    const char *sep = "\\";
+#else
+    DIR *dir = opendir(dirname);
+    if( dir == NULL )
+    {
+	return(-1);
+    }
+    struct dirent *entry;
+    while( (entry = readdir(dir)) != NULL )
+    {
+	size_t len = strlen(entry->d_name);
+	if( (strncmp(entry->d_name, "radar_data_", 11) == 0) && (len > 4)
+	    && (strcmp(entry->d_name + len - 4, ".txt") == 0) )
+	{
+	    names.push_back(entry->d_name);
+	}
+    }
+    closedir(dir);
+    const char *sep = "/";
+#endif
+
+    /* 번호가 0 으로 채워져 있으므로 이름순 = 회전 순서 */
+    std::sort(names.begin(), names.end());
+    files->clear();
+    for(size_t i = 0; i < names.size(); i++)
+    {
+	files->push_back(std::string(dirname) + sep + names[i]);
+    }
+    return(0);
+} /* listRotationFiles() */
+
+
+/*====================================================================
+*
+* readRotationFile
+*	Read one rotation file written by SPxDataConverter.
+*
+* Params:
+*	filename		File to read,
+*	rotation		Filled in with the spokes.
+*
+* Returns:
+*	Zero on success, -1 on error.
+*
+* Notes
+*	Each line is "<azimuth> <end range> <samples...>".  Samples
+*	above 255 (16-bit recordings) are clipped, as in the viewer.
+*
+*===================================================================*/
+static int readRotationFile(const char *filename, Rotation *rotation)
+{
+    FILE *fp = fopen(filename, "rb");
+    if( fp == NULL )
+    {
+	return(-1);
+    }
+    std::string text;
+    char buf[65536];
+    size_t n;
+    while( (n = fread(buf, 1, sizeof(buf), fp)) > 0 )
+    {
+	text.append(buf, n);
+    }
+    fclose(fp);
+
+    rotation->azimuths.clear();
+    rotation->lengths.clear();
+    rotation->samples.clear();
+
+    const char *p = text.c_str();
+    while( *p != '\0' )
+    {
+	char *end;
+	double az = strtod(p, &end);
+	if( end == p )
+	{
+	    /* 빈 줄은 건너뜀 */
+	    p += strcspn(p, "\n");
+	    p += (*p == '\n');
+	    continue;
+	}
+	p = end;
+	strtod(p, &end);		/* End range, not used */
+	if( end == p )
+	{
+	    return(-1);
+	}
+	p = end;
+
+	int count = 0;
+	for(;;)
+	{
+	    while( (*p == ' ') || (*p == '\t') || (*p == '\r') )
+	    {
+		p++;
+	    }
+	    if( (*p == '\n') || (*p == '\0') )
+	    {
+		break;
+	    }
+	    long v = strtol(p, &end, 10);
+	    if( end == p )
+	    {
+		return(-1);
+	    }
+	    p = end;
+	    rotation->samples.push_back((uint8_t)((v < 0) ? 0 : ((v > 255) ? 255 : v)));
+	    count++;
+	}
+	p += (*p == '\n');
+	if( count > 0 )
+	{
+	    rotation->azimuths.push_back(az);
+	    rotation->lengths.push_back(count);
+	}
+    }
+    return( rotation->azimuths.empty() ? -1 : 0 );
+} /* readRotationFile() */
+
+
+/*====================================================================
+*
+* runDirectory
+*	Collect statistics from a directory of rotation files.
+*
+* Params:
+*	builder			Builder,
+*	pool			Worker pool,
+*	dirname			Directory.
+*
+* Returns:
+*	Zero on success, -1 on error.
+*
+* Notes
+*	Each file is one task, so the pool balances files of different
+*	sizes by stealing.
+*
+*===================================================================*/
+static int runDirectory(Builder *builder, SPxWorkPool *pool, const char *dirname)
+{
+    if( (listRotationFiles(dirname, &builder->files) != 0) || builder->files.empty() )
+    {
+	fprintf(stderr, "No rotation files in '%s'.\n", dirname);
+	return(-1);
+    }
+    printf("Reading %u rotation files from '%s'.\n",
+	   (unsigned int)builder->files.size(), dirname);
+
+    /* 게이트 수를 정하지 않았으면 첫 파일의 첫 스포크 길이 사용 */
+    if( builder->numGates == 0 )
+    {
+	Rotation first;
+	for(size_t i = 0; (i < builder->files.size()) && (builder->numGates == 0); i++)
+	{
+	    if( readRotationFile(builder->files[i].c_str(), &first) == 0 )
+	    {
+		builder->numGates = first.lengths[0];
+	    }
+	}
+	if( builder->numGates == 0 )
+	{
+	    return(-1);
+	}
+    }
+
+    createOccupancy(builder, pool->GetNumThreads());
+    pool->Run((unsigned int)builder->files.size(), fileTask, builder);
+    return(0);
+} /* runDirectory() */
+
+
+/*====================================================================
+*
+* runRecording
+*	Collect statistics from a recording file.
+*
+* Params:
+*	builder			Builder,
+*	pool			Worker pool,
+*	filename		Recording.
+*
+* Returns:
+*	Zero on success, -1 on error.
+*
+* Notes
+*	The replay thread queues whole rotations; this thread hands
+*	them to the pool a batch at a time while replay carries on.
+*	Ctrl-C stops early and builds the mask from what was read.
+*
+*===================================================================*/
+static int runRecording(Builder *builder, SPxWorkPool *pool, const char *filename)
+{
+    /*
+     * Install error handler and initialise library.
+     */
+    SPxSetErrorHandler(spxErrorHandler);
+    if( SPxInit() != SPX_NO_ERROR )
+    {
+	fprintf(stderr, "Failed to initialise SPx library.\n");
+	return(-1);
+    }
+
+    /* Initialise dongle-based licensing if available. */
+    SPxLicInit();
+
+    /* Create a file replay object, noting that we do not give
+     * it a RIB to write into because we want direct data access.
+     */
+    SPxRadarReplay *src = new SPxRadarReplay(NULL);
+
+    /* Open the file specified on the command line. */
+    if( src->SetFileName(filename) != SPX_NO_ERROR )
+    {
+	fprintf(stderr, "Failed to select file '%s'.\n", filename);
+	delete src;
+	return(-1);
+    }
+
+    /* Install a routine to get radar data, with the builder as the
+     * user arg.
+     */
+    if( src->InstallDataFn(handleRadar, builder) != SPX_NO_ERROR )
+    {
+	fprintf(stderr, "Failed to install radar handler.\n");
+	delete src;
+	return(-1);
+    }
+
+    /* Disable auto-looping and replay as fast as possible. */
+    src->SetAutoLoop(FALSE);
+    src->SetSpeedupFactor(REPLAY_SPEEDUP);
+
+    /* Start replay. */
+    printf("Replaying '%s'.\n", filename);
+    src->Enable(TRUE);
+
+    /*
+     * Run the main loop, until the file is finished and every queued
+     * rotation has been added.
+     */
+    int fileDone = FALSE;
+    for(;;)
+    {
+	{
+	    std::unique_lock<std::mutex> lock(builder->mutex);
+	    if( !fileDone && !MainLoopFinish
+		&& (builder->queue.size() < pool->GetNumThreads()) )
+	    {
+		builder->cond.wait_for(lock, std::chrono::milliseconds(100));
+	    }
+	}
+
+	/* The file replay goes into a paused state when the file finishes
+	 * (because we called SetAutoLoop(FALSE) above), so look for this
+	 * state to detect the end of the file.
+	 */
+	if( !fileDone && (src->IsPaused() || MainLoopFinish) )
+	{
+	    src->Enable(FALSE);
+	    fileDone = TRUE;
+	    std::lock_guard<std::mutex> lock(builder->mutex);
+	    if( builder->current != NULL )
+	    {
+		builder->queue.push_back(builder->current);
+		builder->current = NULL;
+	    }
+	}
+
+	/* 큐에서 최대 스레드 수만큼 꺼내 병렬로 처리 */
+	builder->batch.clear();
+	{
+	    std::lock_guard<std::mutex> lock(builder->mutex);
+	    while( !builder->queue.empty()
+		   && (builder->batch.size() < pool->GetNumThreads()) )
+	    {
+		builder->batch.push_back(builder->queue.front());
+		builder->queue.pop_front();
+	    }
+	    builder->cond.notify_all();
+	}
+	if( builder->batch.empty() )
+	{
+	    if( fileDone )
+	    {
+		break;
+	    }
+	    continue;
+	}
+
+	if( builder->occupancy.empty() )
+	{
+	    if( builder->numGates == 0 )
+	    {
+		builder->numGates = builder->batch[0]->lengths[0];
+	    }
+	    createOccupancy(builder, pool->GetNumThreads());
+	}
+	pool->Run((unsigned int)builder->batch.size(), batchTask, builder);
+	for(size_t i = 0; i < builder->batch.size(); i++)
+	{
+	    builder->numSpokes += builder->batch[i]->azimuths.size();
+	    delete builder->batch[i];
+	}
+	if( Verbose )
+	{
+	    printf("%u rotations.\n", builder->occupancy[0]->GetNumRotations());
+	}
+    }
+
+    delete src;
+    return(0);
+} /* runRecording() */
+
+
+/*====================================================================
+*
+* createOccupancy
+*	Create one statistics grid per worker.
+*
+* Params:
+*	builder			Builder, with its grid size set,
+*	numWorkers		Number of pool threads.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+static void createOccupancy(Builder *builder, unsigned int numWorkers)
+{
+    for(unsigned int i = 0; i < numWorkers; i++)
+    {
+	builder->occupancy.push_back(new SPxOccupancy(builder->numAzis,
+						      builder->numGates,
+						      builder->level));
+    }
+} /* createOccupancy() */
+
+
+/*====================================================================
+*
+* addRotation
+*	Add a rotation to a worker's statistics.
+*
+* Params:
+*	occupancy		Worker's grid,
+*	rotation		Rotation.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+static void addRotation(SPxOccupancy *occupancy, const Rotation *rotation)
+{
+    size_t offset = 0;
+    occupancy->BeginRotation();
+    for(size_t i = 0; i < rotation->azimuths.size(); i++)
+    {
+	occupancy->AddSpoke(rotation->azimuths[i], &rotation->samples[offset],
+			    rotation->lengths[i]);
+	offset += rotation->lengths[i];
+    }
+    occupancy->EndRotation();
+} /* addRotation() */
+
+
+/*====================================================================
+*
+* fileTask / batchTask
+*	Pool tasks adding one rotation to the worker's statistics.
+*
+* Params:
+*	userArg			The builder,
+*	taskIdx			File or batch entry,
+*	workerIdx		Worker, selecting its grid.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+static void fileTask(void *userArg, unsigned int taskIdx, unsigned int workerIdx)
+{
+    Builder *builder = (Builder *)userArg;
+    Rotation rotation;
+    if( readRotationFile(builder->files[taskIdx].c_str(), &rotation) != 0 )
+    {
+	builder->numBadFiles++;
+	return;
+    }
+    addRotation(builder->occupancy[workerIdx], &rotation);
+    builder->numSpokes += rotation.azimuths.size();
+    if( Verbose > 1 )
+    {
+	printf("%s: %u spokes.\n", builder->files[taskIdx].c_str(),
+	       (unsigned int)rotation.azimuths.size());
+    }
+} /* fileTask() */
+
+static void batchTask(void *userArg, unsigned int taskIdx, unsigned int workerIdx)
+{
+    Builder *builder = (Builder *)userArg;
+    addRotation(builder->occupancy[workerIdx], builder->batch[taskIdx]);
+} /* batchTask() */
+
+
+/*********************************************************************
+*
+*	Utility functions to handle init/shutdown per operating system.
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* osInit
+*	Function to perform operating system specific setup.
+*
+* Params:
+*	None
+*
+* Returns:
+*	SPx error code.
+*
+* Notes
+*
+*===================================================================*/
+static SPxErrorCode osInit(void)
+{
+#ifdef _WIN32
+    /* Install our tidy-up function. */
+    if( SetConsoleCtrlHandler((PHANDLER_ROUTINE)sigIntHandler, TRUE) == 0 )
+    {
+	printf("Fatal Error: Failed to install ctrl-c handler.\n");
+	return(SPX_ERR_SYSCALL);
+    }
+#else
+    /* Install our tidy-up function. */
+    signal(SIGINT, sigIntHandler);
+#endif
+
+    /* Done. */
+    return(SPX_NO_ERROR);
+} /* osInit() */
+
+
+/*====================================================================
+*
+* sigIntHandler
+*	Handler function for SIGINT (i.e. Ctrl-C).
+*
+* Params:
+*	sig		Signal we are being called for.
+*
+* Returns:
+*	Nothing
+*
+* Notes:
+*	Tells the main loop to finish so we can clean up tidily etc.
+*
+*===================================================================*/
+#ifdef _WIN32
+static BOOL WINAPI sigIntHandler(DWORD sig)
+{
+    if( (sig == CTRL_C_EVENT) || (sig == CTRL_CLOSE_EVENT) )
+    {
+	printf("\nSIGINT received - exiting.\n");
+	MainLoopFinish = 1;
+	return(TRUE);
+    }
+    return(FALSE);
+} /* sigIntHandler() */
+#else
+static void sigIntHandler(int sig)
+{
+    printf("\nSIGINT received - exiting.\n");
+    MainLoopFinish = 1;
+    return;
+} /* sigIntHandler() */
+#endif
+
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
@@ -0,0 +1,395 @@
+/*********************************************************************
+*
+* File: SPxOccupancy.cpp
+*
+* Purpose:
+*	Per-cell occupancy statistics over rotations (see
+*	SPxOccupancy.h).
+*
+**********************************************************************/
+
+/* Standard headers. */
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Our own header. */
+#include "SPxOccupancy.h"
+
+/*
+ * Constants.
+ */
+#define	MAX_COUNT	65535	/* Rotations counted per bin */
+
+/* Bins skipped between two spokes up to this fraction of a turn are
+ * filled in with the later spoke, as in SPxScanIntegrator.
+ */
+#define	MAX_GAP_DIVISOR	32
+
+
+/*********************************************************************
+*
+*	Public functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* SPxOccupancy::SPxOccupancy
+*	Constructor.
+*
+* Params:
+*	numAzis			Azimuth bins per turn,
+*	numGates		Range gates per bin,
+*	level			Sample level counted as occupied.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+SPxOccupancy::SPxOccupancy(int numAzis, int numGates, int level)
+    : m_numAzis((numAzis > 0) ? numAzis : 1),
+      m_numGates((numGates > 0) ? numGates : 1),
+      m_level(level), m_numRotations(0), m_lastBin(-1)
+{
+    size_t cells = (size_t)m_numAzis * m_numGates;
+    m_counts.assign(cells, 0);
+    m_binRotations.assign(m_numAzis, 0);
+    m_hits.assign(cells, 0);
+    m_touched.assign(m_numAzis, 0);
+    m_row.assign(m_numGates, 0);
+} /* SPxOccupancy::SPxOccupancy() */
+
+
+/*====================================================================
+*
+* SPxOccupancy::~SPxOccupancy
+*	Destructor.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+SPxOccupancy::~SPxOccupancy()
+{
+} /* SPxOccupancy::~SPxOccupancy() */
+
+
+/*====================================================================
+*
+* SPxOccupancy::BeginRotation
+*	Start a new rotation.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	A rotation that was not ended is discarded.
+*
+*===================================================================*/
+void SPxOccupancy::BeginRotation(void)
+{
+    for(size_t i = 0; i < m_touchedBins.size(); i++)
+    {
+	int bin = m_touchedBins[i];
+	memset(&m_hits[(size_t)bin * m_numGates], 0, m_numGates);
+	m_touched[bin] = 0;
+    }
+    m_touchedBins.clear();
+    m_lastBin = -1;
+} /* SPxOccupancy::BeginRotation() */
+
+
+/*====================================================================
+*
+* SPxOccupancy::AddSpoke
+*	Add a spoke to the current rotation.
+*
+* Params:
+*	azDegrees		Azimuth, degrees clockwise from north,
+*	samples			Samples, first at zero range,
+*	numSamples		Number of samples (resampled to the grid).
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Small gaps since the previous spoke are filled with this spoke.
+*
+*===================================================================*/
+void SPxOccupancy::AddSpoke(double azDegrees, const uint8_t *samples, int numSamples)
+{
+    if( (samples == NULL) || (numSamples <= 0) )
+    {
+	return;
+    }
+
+    /* 최근접 리샘플링으로 격자 게이트 수에 맞춤 */
+    const uint8_t *row = samples;
+    if( numSamples != m_numGates )
+    {
+	for(int g = 0; g < m_numGates; g++)
+	{
+	    m_row[g] = samples[(int)(((int64_t)g * numSamples) / m_numGates)];
+	}
+	row = &m_row[0];
+    }
+
+    int bin = getBin(azDegrees);
+    if( m_lastBin >= 0 )
+    {
+	int gap = (bin - m_lastBin + m_numAzis) % m_numAzis;
+	if( (gap > 1) && (gap <= (m_numAzis / MAX_GAP_DIVISOR)) )
+	{
+	    for(int b = (m_lastBin + 1) % m_numAzis; b != bin; b = (b + 1) % m_numAzis)
+	    {
+		markBin(b, row);
+	    }
+	}
+    }
+    markBin(bin, row);
+    m_lastBin = bin;
+} /* SPxOccupancy::AddSpoke() */
+
+
+/*====================================================================
+*
+* SPxOccupancy::EndRotation
+*	Add the current rotation to the totals.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Only the bins the rotation covered are counted.
+*
+*===================================================================*/
+void SPxOccupancy::EndRotation(void)
+{
+    for(size_t i = 0; i < m_touchedBins.size(); i++)
+    {
+	int bin = m_touchedBins[i];
+	if( m_binRotations[bin] >= MAX_COUNT )
+	{
+	    continue;
+	}
+	m_binRotations[bin]++;
+	uint16_t *counts = &m_counts[(size_t)bin * m_numGates];
+	const uint8_t *hits = &m_hits[(size_t)bin * m_numGates];
+	for(int g = 0; g < m_numGates; g++)
+	{
+	    counts[g] = (uint16_t)(counts[g] + hits[g]);
+	}
+    }
+    m_numRotations++;
+    BeginRotation();
+} /* SPxOccupancy::EndRotation() */
+
+
+/*====================================================================
+*
+* SPxOccupancy::Merge
+*	Add another object's totals to this one.
+*
+* Params:
+*	other			Statistics on the same grid.
+*
+* Returns:
+*	Zero on success, -1 if the grids differ.
+*
+* Notes
+*	Bins that would pass the count limit are capped, keeping the
+*	count no greater than the rotations.
+*
+*===================================================================*/
+int SPxOccupancy::Merge(const SPxOccupancy &other)
+{
+    if( (other.m_numAzis != m_numAzis) || (other.m_numGates != m_numGates) )
+    {
+	return(-1);
+    }
+    for(int bin = 0; bin < m_numAzis; bin++)
+    {
+	unsigned int rotations = m_binRotations[bin] + other.m_binRotations[bin];
+	if( rotations > MAX_COUNT )
+	{
+	    rotations = MAX_COUNT;
+	}
+	m_binRotations[bin] = (uint16_t)rotations;
+	uint16_t *counts = &m_counts[(size_t)bin * m_numGates];
+	const uint16_t *add = &other.m_counts[(size_t)bin * m_numGates];
+	for(int g = 0; g < m_numGates; g++)
+	{
+	    unsigned int count = counts[g] + add[g];
+	    counts[g] = (uint16_t)((count > rotations) ? rotations : count);
+	}
+    }
+    m_numRotations += other.m_numRotations;
+    return(0);
+} /* SPxOccupancy::Merge() */
+
+
+/*====================================================================
+*
+* SPxOccupancy::GetOccupancy
+*	Report the occupancy of one cell.
+*
+* Params:
+*	bin			Azimuth bin,
+*	gate			Range gate.
+*
+* Returns:
+*	Fraction of the bin's rotations in which the cell was occupied
+*	(zero if the bin was never covered).
+*
+* Notes
+*
+*===================================================================*/
+double SPxOccupancy::GetOccupancy(int bin, int gate) const
+{
+    if( (bin < 0) || (bin >= m_numAzis) || (gate < 0) || (gate >= m_numGates)
+	|| (m_binRotations[bin] == 0) )
+    {
+	return(0.0);
+    }
+    return( (double)m_counts[((size_t)bin * m_numGates) + gate] / m_binRotations[bin] );
+} /* SPxOccupancy::GetOccupancy() */
+
+
+/*====================================================================
+*
+* SPxOccupancy::BuildMask
+*	Turn the statistics into a clutter mask.
+*
+* Params:
+*	mask			Mask to create,
+*	type			Bit or gain mask,
+*	fraction		Occupancy at which cells start to be
+*				blocked, 0 to 1.
+*
+* Returns:
+*	Zero on success, -1 on error.
+*
+* Notes
+*	The test is count >= fraction x rotations, so a fraction of 0
+*	blocks every covered cell and 1 only those always occupied.
+*
+*===================================================================*/
+int SPxOccupancy::BuildMask(SPxClutterMask *mask, SPxClutterMask::Type type,
+			    double fraction) const
+{
+    if( (mask == NULL) || (fraction < 0.0) || (fraction > 1.0)
+	|| (mask->Create(m_numAzis, m_numGates, type) != 0) )
+    {
+	return(-1);
+    }
+    uint8_t *cells = mask->GetCells();
+    for(int bin = 0; bin < m_numAzis; bin++)
+    {
+	unsigned int rotations = m_binRotations[bin];
+	if( rotations == 0 )
+	{
+	    continue;
+	}
+	const uint16_t *counts = &m_counts[(size_t)bin * m_numGates];
+	uint8_t *row = &cells[(size_t)bin * m_numGates];
+	for(int g = 0; g < m_numGates; g++)
+	{
+	    double occupancy = (double)counts[g] / rotations;
+	    if( occupancy < fraction )
+	    {
+		continue;
+	    }
+	    if( (type == SPxClutterMask::TYPE_BITS) || (fraction >= 1.0) )
+	    {
+		row[g] = 0;
+	    }
+	    else
+	    {
+		/* 임계 점유율에서 255, 항상 점유된 셀에서 0 으로 선형 감소 */
+		double gain = 255.0 * (1.0 - occupancy) / (1.0 - fraction);
+		row[g] = (uint8_t)floor(gain + 0.5);
+	    }
+	}
+    }
+    return(0);
+} /* SPxOccupancy::BuildMask() */
+
+
+/*********************************************************************
+*
+*	Private functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* SPxOccupancy::getBin
+*	Find the bin for an azimuth.
+*
+* Params:
+*	azDegrees		Azimuth, degrees clockwise from north.
+*
+* Returns:
+*	Bin, 0 to numAzis - 1.
+*
+* Notes
+*
+*===================================================================*/
+int SPxOccupancy::getBin(double azDegrees) const
+{
+    double turns = azDegrees / 360.0;
+    turns -= floor(turns);
+    int bin = (int)(turns * m_numAzis);
+    return( (bin >= m_numAzis) ? (m_numAzis - 1) : bin );
+} /* SPxOccupancy::getBin() */
+
+
+/*====================================================================
+*
+* SPxOccupancy::markBin
+*	Mark the occupied cells of one bin in the current rotation.
+*
+* Params:
+*	bin			Bin,
+*	row			numGates samples.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+void SPxOccupancy::markBin(int bin, const uint8_t *row)
+{
+    if( !m_touched[bin] )
+    {
+	m_touched[bin] = 1;
+	m_touchedBins.push_back(bin);
+    }
+    uint8_t *hits = &m_hits[(size_t)bin * m_numGates];
+    for(int g = 0; g < m_numGates; g++)
+    {
+	hits[g] = (uint8_t)(hits[g] | (row[g] >= m_level));
+    }
+} /* SPxOccupancy::markBin() */
+
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
@@ -0,0 +1,88 @@
+/*********************************************************************
+*
+* File: SPxOccupancy.h
+*
+* Purpose:
+*	Per-cell occupancy statistics over recorded rotations, used by
+*	SPxMaskBuilder to find static clutter.
+*
+*	Spokes are resampled onto an azimuth bin x range gate grid.  A
+*	cell is occupied in a rotation if any spoke of that rotation in
+*	its bin reaches the level.  Each bin counts the rotations that
+*	covered it and, per gate, the rotations in which the cell was
+*	occupied, so the occupancy of a cell is count / rotations.
+*
+*	One object must only be fed by one thread at a time; parallel
+*	builders give each worker its own object and Merge() them.  The
+*	statistics do not depend on the SPx library.
+*
+**********************************************************************/
+
+#ifndef _SPX_OCCUPANCY_H
+#define _SPX_OCCUPANCY_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "SPxClutterMask.h"
+
+class SPxOccupancy
+{
+public:
+    /* Constructor/destructor. */
+    SPxOccupancy(int numAzis, int numGates, int level);
+    ~SPxOccupancy();
+
+    /* Add one rotation, spoke by spoke. */
+    void BeginRotation(void);
+    void AddSpoke(double azDegrees, const uint8_t *samples, int numSamples);
+    void EndRotation(void);
+
+    /* Add the statistics of another object with the same grid.
+     * Returns zero on success, -1 if the grids differ.
+     */
+    int Merge(const SPxOccupancy &other);
+
+    /* Information retrieval. */
+    int GetNumAzis(void) const { return m_numAzis; }
+    int GetNumGates(void) const { return m_numGates; }
+    unsigned int GetNumRotations(void) const { return m_numRotations; }
+    double GetOccupancy(int bin, int gate) const;
+
+    /* Build a mask blocking cells occupied in at least the given
+     * fraction of rotations; gain masks fall linearly from 255 at
+     * that fraction to 0 for cells that are always occupied.  Bins
+     * never covered pass.  Returns zero on success, -1 on error.
+     */
+    int BuildMask(SPxClutterMask *mask, SPxClutterMask::Type type,
+		  double fraction) const;
+
+private:
+    int m_numAzis;
+    int m_numGates;
+    int m_level;
+    unsigned int m_numRotations;
+
+    /* Totals. */
+    std::vector<uint16_t> m_counts;		/* Per cell */
+    std::vector<uint16_t> m_binRotations;	/* Per bin */
+
+    /* Current rotation. */
+    std::vector<uint8_t> m_hits;		/* Per cell, non-zero if occupied */
+    std::vector<uint8_t> m_touched;		/* Per bin */
+    std::vector<int> m_touchedBins;
+    std::vector<uint8_t> m_row;
+    int m_lastBin;
+
+    /* Private functions. */
+    int getBin(double azDegrees) const;
+    void markBin(int bin, const uint8_t *row);
+};
+
+#endif /* _SPX_OCCUPANCY_H */
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
@@ -0,0 +1,528 @@
+/*********************************************************************
+*
+* File: SPxPlotExtract.cpp
+*
+* Purpose:
+*	Plot extraction for the streamers (see SPxPlotExtract.h).
+*
+**********************************************************************/
+
+/* Standard headers. */
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <chrono>
+#include <vector>
+
+/* Our own headers. */
+#include "SPxPlotExtract.h"
+#include "SPxTrackOutput.h"
+
+/*
+ * Constants.
+ */
+#define	RIB_SIZE	(4 * 1024 * 1024)	/* Bytes */
+#define	PIM_AZIS	2048		/* Azimuths per turn in the PIM */
+#define	MAX_PIM_GATES	4096		/* Longer spokes are cut */
+#define	TRACK_SECTORS	16		/* Sectors in the blob database */
+
+static const char FileMagic[8] = { 'S', 'P', 'X', 'P', 'L', 'O', 'T', '1' };
+
+/* Tracker process that times the standard one (see timedTrackerFn()). */
+static SPxProcess *TimedTracker = NULL;
+
+/*
+ * Private functions.
+ */
+static void timedTrackerFn(SPxRunProcess *rp, SPxReturn *rtn,
+			   unsigned firstAzi, unsigned numAzis);
+static int64_t nowUsecs(void);
+
+
+/*********************************************************************
+*
+*	Public functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* SPxPlotExtractor::SPxPlotExtractor
+*	Constructor.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Nothing is extracted until Create() succeeds.
+*
+*===================================================================*/
+SPxPlotExtractor::SPxPlotExtractor(void)
+    : m_level(0), m_minWeight(1), m_created(0), m_csv(0), m_file(NULL),
+      m_tracks(NULL), m_rib(NULL), m_pim(NULL), m_nullPro(NULL),
+      m_spanPro(NULL), m_blobDetector(NULL), m_blobDB(NULL),
+      m_tracker(NULL), m_trackPro(NULL), m_totalPlots(0), m_numPlots(0),
+      m_sumLatencyMs(0.0), m_maxLatencyMs(0.0), m_lastStatsUsecs(nowUsecs())
+{
+    for(int i = 0; i < NUM_LATENCY_BINS; i++)
+    {
+	m_writeUsecs[i].store(0);
+    }
+} /* SPxPlotExtractor::SPxPlotExtractor() */
+
+
+/*====================================================================
+*
+* SPxPlotExtractor::~SPxPlotExtractor
+*	Destructor.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	The source feeding AddSpoke() must have been stopped.
+*
+*===================================================================*/
+SPxPlotExtractor::~SPxPlotExtractor()
+{
+    delete m_trackPro;
+    delete m_spanPro;
+    delete m_nullPro;
+    delete m_tracker;
+    delete m_blobDetector;
+    delete m_blobDB;
+    delete m_pim;
+    delete m_rib;
+    if( m_file != NULL )
+    {
+	fclose(m_file);
+    }
+} /* SPxPlotExtractor::~SPxPlotExtractor() */
+
+
+/*====================================================================
+*
+* SPxPlotExtractor::Create
+*	Configure the extraction and open the plot file.
+*
+* Params:
+*	args			"<level>[,<minWeight>]",
+*	filename		Plot file (CSV if it ends in ".csv"),
+*				or NULL for none.
+*
+* Returns:
+*	Zero on success, -1 on error.
+*
+* Notes
+*
+*===================================================================*/
+int SPxPlotExtractor::Create(const char *args, const char *filename)
+{
+    std::vector<long> values;
+    std::string text = (args != NULL) ? args : "";
+    size_t start = 0;
+    while( start <= text.size() )
+    {
+	size_t comma = text.find(',', start);
+	std::string field = text.substr(start, (comma == std::string::npos)
+					? std::string::npos : comma - start);
+	char *end = NULL;
+	long v = strtol(field.c_str(), &end, 10);
+	if( field.empty() || (*end != '\0') )
+	{
+	    values.clear();
+	    break;
+	}
+	values.push_back(v);
+	start = (comma == std::string::npos) ? text.size() + 1 : comma + 1;
+    }
+    if( (values.size() < 1) || (values.size() > 2)
+	|| (values[0] < 1) || (values[0] > 255)
+	|| ((values.size() == 2) && ((values[1] < 1) || (values[1] > 1000000))) )
+    {
+	m_error = "invalid plot extraction '" + text + "'";
+	return(-1);
+    }
+    if( m_created )
+    {
+	m_error = "plot extraction already created";
+	return(-1);
+    }
+
+    FILE *fp = NULL;
+    int csv = 0;
+    if( filename != NULL )
+    {
+	size_t len = strlen(filename);
+	csv = (len >= 4) && (strcmp(filename + len - 4, ".csv") == 0);
+	fp = fopen(filename, csv ? "w" : "wb");
+	if( fp == NULL )
+	{
+	    m_error = std::string("cannot open plot file '") + filename + "'";
+	    return(-1);
+	}
+	if( csv )
+	{
+	    fprintf(fp, "time_ms,range_m,azimuth_deg,size_range_m,"
+		    "size_azimuth_deg,weight,strength\n");
+	}
+	else
+	{
+	    fwrite(FileMagic, sizeof(FileMagic), 1, fp);
+	}
+    }
+
+    m_level = (int)values[0];
+    m_minWeight = (values.size() == 2) ? (unsigned int)values[1] : 1;
+    m_csv = csv;
+    m_file = fp;
+    m_created = 1;
+    return(0);
+} /* SPxPlotExtractor::Create() */
+
+
+/*====================================================================
+*
+* SPxPlotExtractor::AddSpoke
+*	Pass a spoke on to the detector.
+*
+* Params:
+*	hdr			Header of the received spoke,
+*	samples			8-bit samples, first at zero range,
+*	numSamples		Number of samples.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	The detector runs on the RIB's thread, so blobs are reported
+*	some spokes later on that thread.
+*
+*===================================================================*/
+void SPxPlotExtractor::AddSpoke(const SPxReturnHeader *hdr,
+				const uint8_t *samples, int numSamples)
+{
+    if( !m_created || (hdr == NULL) || (samples == NULL) || (numSamples <= 0) )
+    {
+	return;
+    }
+    if( (m_rib == NULL) && (createChain(numSamples) != 0) )
+    {
+	return;
+    }
+    if( numSamples > MAX_PIM_GATES )
+    {
+	numSamples = MAX_PIM_GATES;
+    }
+
+    /* 레벨 미만 샘플은 스팬이 되지 않도록 0 으로 */
+    m_samples.resize(numSamples);
+    for(int i = 0; i < numSamples; i++)
+    {
+	m_samples[i] = (samples[i] >= m_level) ? samples[i] : 0;
+    }
+
+    SPxReturnHeader rtn = *hdr;
+    rtn.packing = SPX_RIB_PACKING_RAW8;
+    rtn.thisLength = (UINT16)numSamples;
+    if( rtn.nominalLength < rtn.thisLength )
+    {
+	rtn.nominalLength = rtn.thisLength;
+    }
+    rtn.radarVideoSize = (UINT16)numSamples;
+    rtn.totalSize = rtn.headerSize + numSamples;
+
+    int bin = (hdr->azimuth * NUM_LATENCY_BINS) >> 16;
+    m_writeUsecs[bin].store(nowUsecs(), std::memory_order_relaxed);
+    m_rib->Write(&rtn, &m_samples[0], numSamples);
+} /* SPxPlotExtractor::AddSpoke() */
+
+
+/*====================================================================
+*
+* SPxPlotExtractor::GetStats
+*	Flush the plot file and read the statistics.
+*
+* Params:
+*	stats			Filled in.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Rates and latencies cover the time since the previous call.
+*
+*===================================================================*/
+void SPxPlotExtractor::GetStats(Stats *stats)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    int64_t now = nowUsecs();
+    double secs = (double)(now - m_lastStatsUsecs) / 1e6;
+
+    stats->totalPlots = m_totalPlots;
+    stats->numPlots = m_numPlots;
+    stats->plotsPerSec = (secs > 0.0) ? (double)m_numPlots / secs : 0.0;
+    stats->meanLatencyMs = (m_numPlots > 0) ? m_sumLatencyMs / m_numPlots : 0.0;
+    stats->maxLatencyMs = m_maxLatencyMs;
+
+    if( m_file != NULL )
+    {
+	fflush(m_file);
+    }
+    m_numPlots = 0;
+    m_sumLatencyMs = 0.0;
+    m_maxLatencyMs = 0.0;
+    m_lastStatsUsecs = now;
+} /* SPxPlotExtractor::GetStats() */
+
+
+/*********************************************************************
+*
+*	Private functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* SPxPlotExtractor::createChain
+*	Create the RIB, PIM and detection processes.
+*
+* Params:
+*	numSamples		Length of the first spoke.
+*
+* Returns:
+*	Zero on success, -1 on error.
+*
+* Notes
+*	The PIM range is fixed by the first spoke.  With a track output
+*	the blobs also go into a database read by the tracker.
+*
+*===================================================================*/
+int SPxPlotExtractor::createChain(int numSamples)
+{
+    if( SPxProNull == NULL )
+    {
+	SPxProNullInit();
+    }
+    if( SPxProSpanDetect == NULL )
+    {
+	SPxProSpanDetectInit();
+    }
+    if( (m_tracks != NULL) && (TimedTracker == NULL) )
+    {
+	if( SPxProTracker == NULL )
+	{
+	    SPxProTrackerInit();
+	}
+	if( SPxProTracker != NULL )
+	{
+	    TimedTracker = new SPxProcess("TimedTracker", timedTrackerFn);
+	}
+    }
+    if( (SPxProNull == NULL) || (SPxProSpanDetect == NULL)
+	|| ((m_tracks != NULL) && (TimedTracker == NULL)) )
+    {
+	/* 더 이상 시도하지 않음 */
+	m_created = 0;
+	return(-1);
+    }
+
+    m_rib = new SPxRIB(RIB_SIZE);
+    m_pim = new SPxPIM(m_rib, (numSamples > MAX_PIM_GATES) ? MAX_PIM_GATES : numSamples,
+		       PIM_AZIS);
+    m_nullPro = new SPxRunProcess(SPxProNull, NULL, m_pim);
+
+    /* 스팬 검출 → 블롭 검출, 블롭은 콜백으로 보고 */
+    if( m_tracks != NULL )
+    {
+	m_blobDB = new SPxTargetDB(TRACK_SECTORS, sizeof(SPxBlob_t));
+    }
+    m_blobDetector = new SPxBlobDetector(m_blobDB);
+    m_blobDetector->AddCallback(blobFn, this);
+    m_spanPro = new SPxRunProcess(SPxProSpanDetect, m_nullPro, m_pim,
+				  m_blobDetector);
+    if( m_spanPro->TestParamExists("Threshold") )
+    {
+	m_spanPro->SetParamValueI("Threshold", m_level);
+    }
+
+    /* 블롭 DB → 추적기, 추적 보고는 트랙 출력으로 */
+    if( m_tracks != NULL )
+    {
+	m_tracker = new SPxTracker(m_blobDB);
+	m_tracker->AddReportCallback(SPxTrackOutput::ReportFn, m_tracks);
+	m_trackPro = new SPxRunProcess(TimedTracker, m_spanPro, m_pim,
+				       m_tracker);
+	m_trackPro->SetUserArgs2(m_tracks);
+    }
+    return(0);
+} /* SPxPlotExtractor::createChain() */
+
+
+/*====================================================================
+*
+* SPxPlotExtractor::writePlot
+*	Write a blob to the plot file and update the statistics.
+*
+* Params:
+*	blob			Blob reported by the detector.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	The latency is from the write of the blob's last azimuth.
+*
+*===================================================================*/
+void SPxPlotExtractor::writePlot(const SPxBlob_t *blob)
+{
+    if( blob->weight < m_minWeight )
+    {
+	return;
+    }
+
+    int64_t now = nowUsecs();
+    double turns = blob->endAzimuthDegrees / 360.0;
+    turns -= floor(turns);
+    int bin = (int)(turns * NUM_LATENCY_BINS) % NUM_LATENCY_BINS;
+    int64_t written = m_writeUsecs[bin].load(std::memory_order_relaxed);
+    double latencyMs = (written > 0) ? (double)(now - written) / 1000.0 : 0.0;
+
+    SPxPlotRecord rec;
+    if( blob->epochTime.secs != 0 )
+    {
+	rec.timeMsecs = ((int64_t)blob->epochTime.secs * 1000)
+	    + (blob->epochTime.usecs / 1000);
+    }
+    else
+    {
+	rec.timeMsecs = std::chrono::duration_cast<std::chrono::milliseconds>(
+	    std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+    rec.rangeMetres = blob->rangeMetres;
+    rec.azimuthDegrees = blob->azimuthDegrees;
+    rec.sizeRangeMetres = blob->sizeRangeMetres;
+    rec.sizeAzimuthDegrees = blob->sizeAzimuthDegrees;
+    rec.weight = blob->weight;
+    rec.strength = blob->strength;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if( (m_file != NULL) && m_csv )
+    {
+	fprintf(m_file, "%lld,%.1f,%.3f,%.1f,%.3f,%u,%u\n",
+		(long long)rec.timeMsecs, rec.rangeMetres, rec.azimuthDegrees,
+		rec.sizeRangeMetres, rec.sizeAzimuthDegrees,
+		rec.weight, rec.strength);
+    }
+    else if( m_file != NULL )
+    {
+	fwrite(&rec, sizeof(rec), 1, m_file);
+    }
+    m_totalPlots++;
+    m_numPlots++;
+    m_sumLatencyMs += latencyMs;
+    if( latencyMs > m_maxLatencyMs )
+    {
+	m_maxLatencyMs = latencyMs;
+    }
+} /* SPxPlotExtractor::writePlot() */
+
+
+/*====================================================================
+*
+* SPxPlotExtractor::blobFn
+*	Blob callback installed on the detector.
+*
+* Params:
+*	invokingObject		The SPxBlobDetector,
+*	userObject		The SPxPlotExtractor,
+*	arg			The SPxBlob_t.
+*
+* Returns:
+*	Zero.
+*
+* Notes
+*
+*===================================================================*/
+int SPxPlotExtractor::blobFn(void *invokingObject, void *userObject, void *arg)
+{
+    if( (userObject != NULL) && (arg != NULL) )
+    {
+	((SPxPlotExtractor *)userObject)->writePlot((const SPxBlob_t *)arg);
+    }
+    return(0);
+} /* SPxPlotExtractor::blobFn() */
+
+
+/*====================================================================
+*
+* timedTrackerFn
+*	Process function that runs the standard tracker process and
+*	accounts its CPU time.
+*
+* Params:
+*	rp			Run process, with the SPxTracker as user
+*				args and the SPxTrackOutput as user args 2,
+*	rtn			First new return,
+*	firstAzi		Its PIM azimuth,
+*	numAzis			Number of new returns.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Thread CPU time, so it does not count time the detection thread
+*	is descheduled.  It includes writing the track reports.
+*
+*===================================================================*/
+static void timedTrackerFn(SPxRunProcess *rp, SPxReturn *rtn,
+			   unsigned firstAzi, unsigned numAzis)
+{
+    struct timespec start, end;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &start);
+    SPxProTracker->GetFunction()(rp, rtn, firstAzi, numAzis);
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &end);
+
+    SPxTrackOutput *tracks = (SPxTrackOutput *)rp->GetUserArgs2();
+    if( tracks != NULL )
+    {
+	tracks->AddTrackerTime(firstAzi,
+			       ((double)(end.tv_sec - start.tv_sec) * 1e3)
+			       + ((double)(end.tv_nsec - start.tv_nsec) / 1e6));
+    }
+} /* timedTrackerFn() */
+
+
+/*====================================================================
+*
+* nowUsecs
+*	Monotonic time.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Microseconds since an arbitrary point.
+*
+* Notes
+*
+*===================================================================*/
+static int64_t nowUsecs(void)
+{
+    return( std::chrono::duration_cast<std::chrono::microseconds>(
+	std::chrono::steady_clock::now().time_since_epoch()).count() );
+} /* nowUsecs() */
+
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
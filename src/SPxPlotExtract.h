@@ -0,0 +1,140 @@
+/*********************************************************************
+*
+* File: SPxPlotExtract.h
+*
+* Purpose:
+*	Plot extraction for the streamers: spokes are written into a
+*	RIB, and the SPx span detector (SPxProSpanDetect) feeds a
+*	SPxBlobDetector whose blobs are written as plots to a file.
+*
+*	Each plot has a time, range, azimuth, size and strength.  The
+*	file is either CSV (name ending in ".csv") or binary:
+*
+*	  "SPXPLOT1"		8-byte magic,
+*	  SPxPlotRecord		per plot, 32 bytes, host byte order.
+*
+*	Plot statistics (plots per second and the latency from the last
+*	spoke of a blob being written to its report) are kept for the
+*	streamers to print.
+*
+*	Plots may also be fed to an SPxTracker whose reports go to an
+*	SPxTrackOutput (see SPxTrackOutput.h).
+*
+**********************************************************************/
+
+#ifndef _SPX_PLOT_EXTRACT_H
+#define _SPX_PLOT_EXTRACT_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/* SPx library types (SPxReturnHeader, SPxBlob_t etc.). */
+#include "SPx.h"
+
+/* Forward declarations. */
+class SPxTrackOutput;
+
+/* Plot record in binary plot files. */
+typedef struct SPxPlotRecord_tag
+{
+    int64_t timeMsecs;		/* Epoch time of the plot, milliseconds */
+    float rangeMetres;		/* Centroid */
+    float azimuthDegrees;
+    float sizeRangeMetres;	/* Extent */
+    float sizeAzimuthDegrees;
+    uint32_t weight;		/* Samples in the plot */
+    uint32_t strength;		/* Sum of the samples */
+} SPxPlotRecord;
+
+class SPxPlotExtractor
+{
+public:
+    /* Statistics since the previous GetStats() call. */
+    struct Stats
+    {
+	uint64_t totalPlots;	/* Since creation */
+	uint64_t numPlots;	/* In this interval */
+	double plotsPerSec;
+	double meanLatencyMs;	/* Zero if there were no plots */
+	double maxLatencyMs;
+    };
+
+    /* Constructor/destructor. */
+    SPxPlotExtractor(void);
+    ~SPxPlotExtractor();
+
+    /* Configure from "<level>[,<minWeight>]" and open the plot file
+     * (NULL for none), zero on success or -1 on error (GetError() says
+     * why).  Samples below the level are not detected, and plots of
+     * fewer than minWeight samples (default 1) are dropped.
+     */
+    int Create(const char *args, const char *filename);
+    const char *GetError(void) const { return m_error.c_str(); }
+
+    /* Track the plots, reporting to the given output.  Must be called
+     * before the first spoke.
+     */
+    void SetTrackOutput(SPxTrackOutput *tracks) { m_tracks = tracks; }
+
+    /* Pass a spoke of 8-bit samples on to the detector.  The header
+     * is that of the received spoke; its length and packing are
+     * replaced.
+     */
+    void AddSpoke(const SPxReturnHeader *hdr, const uint8_t *samples,
+		  int numSamples);
+
+    /* Flush the plot file and read the statistics. */
+    void GetStats(Stats *stats);
+
+private:
+    /* Configuration. */
+    int m_level;
+    unsigned int m_minWeight;
+    int m_created;
+    int m_csv;
+    FILE *m_file;
+    SPxTrackOutput *m_tracks;
+    std::string m_error;
+
+    /* Detection chain, created on the first spoke. */
+    SPxRIB *m_rib;
+    SPxPIM *m_pim;
+    SPxRunProcess *m_nullPro;
+    SPxRunProcess *m_spanPro;
+    SPxBlobDetector *m_blobDetector;
+    SPxTargetDB *m_blobDB;		/* Tracking only */
+    SPxTracker *m_tracker;
+    SPxRunProcess *m_trackPro;
+    std::vector<uint8_t> m_samples;
+
+    /* Time each azimuth was last written, for the latency. */
+    enum { NUM_LATENCY_BINS = 1024 };
+    std::atomic<int64_t> m_writeUsecs[NUM_LATENCY_BINS];
+
+    /* Statistics, guarded by the mutex (blobs are reported on the
+     * detection thread).
+     */
+    std::mutex m_mutex;
+    uint64_t m_totalPlots;
+    uint64_t m_numPlots;
+    double m_sumLatencyMs;
+    double m_maxLatencyMs;
+    int64_t m_lastStatsUsecs;
+
+    /* Private functions. */
+    int createChain(int numSamples);
+    void writePlot(const SPxBlob_t *blob);
+    static int blobFn(void *invokingObject, void *userObject, void *arg);
+};
+
+#endif /* _SPX_PLOT_EXTRACT_H */
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
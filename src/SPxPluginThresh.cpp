@@ -0,0 +1,171 @@
+/*********************************************************************
+*
+* File: SPxPluginThresh.cpp
+*
+* Purpose:
+*	Example filter plugin (see SPxFilterPluginAbi.h), built as
+*	libspxplugin_thresh.so.
+*
+*	Args "<level>[,<minSamples>]": samples below the level are
+*	zeroed, trailing zeros are cut from the spoke, and spokes with
+*	fewer than minSamples (default 1) samples left at or above the
+*	level are dropped.
+*
+*	e.g. SPxDataStream -L ./libspxplugin_thresh.so:60,4 rec.cpr
+*
+**********************************************************************/
+
+/* Standard headers. */
+#include <stdlib.h>
+
+/* Plugin interface. */
+#include "SPxFilterPluginAbi.h"
+
+/* Per-instance state. */
+typedef struct
+{
+    int level;
+    uint32_t minSamples;
+} ThreshPlugin;
+
+
+/*********************************************************************
+*
+*	Exported functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* SPxFilterPluginAbi
+*	Report the interface version.
+*
+* Params:
+*	None
+*
+* Returns:
+*	SPX_FILTER_PLUGIN_ABI_VERSION
+*
+* Notes
+*
+*===================================================================*/
+extern "C" uint32_t SPxFilterPluginAbi(void)
+{
+    return(SPX_FILTER_PLUGIN_ABI_VERSION);
+} /* SPxFilterPluginAbi() */
+
+
+/*====================================================================
+*
+* SPxFilterPluginCreate
+*	Create an instance.
+*
+* Params:
+*	args			"<level>[,<minSamples>]".
+*
+* Returns:
+*	Instance, or NULL if the args are invalid.
+*
+* Notes
+*
+*===================================================================*/
+extern "C" void *SPxFilterPluginCreate(const char *args)
+{
+    char *end = NULL;
+    long level = strtol(args, &end, 10);
+    long minSamples = 1;
+    if( (end != args) && (*end == ',') )
+    {
+	const char *next = end + 1;
+	minSamples = strtol(next, &end, 10);
+	if( end == next )
+	{
+	    return(NULL);
+	}
+    }
+    if( (end == args) || (*end != '\0') || (level < 1) || (level > 255)
+	|| (minSamples < 1) || (minSamples > 65535) )
+    {
+	return(NULL);
+    }
+
+    ThreshPlugin *plugin = (ThreshPlugin *)malloc(sizeof(ThreshPlugin));
+    if( plugin != NULL )
+    {
+	plugin->level = (int)level;
+	plugin->minSamples = (uint32_t)minSamples;
+    }
+    return(plugin);
+} /* SPxFilterPluginCreate() */
+
+
+/*====================================================================
+*
+* SPxFilterPluginProcess
+*	Threshold a spoke.
+*
+* Params:
+*	instance		From SPxFilterPluginCreate(),
+*	hdr			Spoke description (unused),
+*	span			Samples, filtered in place and shortened.
+*
+* Returns:
+*	SPX_FILTER_PLUGIN_KEEP or SPX_FILTER_PLUGIN_DROP.
+*
+* Notes
+*
+*===================================================================*/
+extern "C" int SPxFilterPluginProcess(void *instance,
+				      const SPxFilterPluginHeader *hdr,
+				      SPxFilterPluginSpan *span)
+{
+    const ThreshPlugin *plugin = (const ThreshPlugin *)instance;
+    uint8_t *samples = span->samples;
+    uint32_t numAbove = 0;
+    uint32_t last = 0;
+    for(uint32_t i = 0; i < span->numSamples; i++)
+    {
+	if( samples[i] < plugin->level )
+	{
+	    samples[i] = 0;
+	}
+	else
+	{
+	    numAbove++;
+	    last = i + 1;
+	}
+    }
+    if( numAbove < plugin->minSamples )
+    {
+	return(SPX_FILTER_PLUGIN_DROP);
+    }
+    span->numSamples = last;
+    return(SPX_FILTER_PLUGIN_KEEP);
+} /* SPxFilterPluginProcess() */
+
+
+/*====================================================================
+*
+* SPxFilterPluginDestroy
+*	Destroy an instance.
+*
+* Params:
+*	instance		From SPxFilterPluginCreate().
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+extern "C" void SPxFilterPluginDestroy(void *instance)
+{
+    free(instance);
+} /* SPxFilterPluginDestroy() */
+
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
@@ -0,0 +1,280 @@
+/*********************************************************************
+*
+* File: SPxRasterBench.cpp
+*
+* Purpose:
+*	Throughput benchmark for the tiled viewer scan converter
+*	(SPxViewerRaster) at 1, 2, 4 and 8 threads.
+*
+*	Two loads are measured for each thread count:
+*	  full   - every tile re-rendered each frame (zoom/pan/resize),
+*	  sector - one 30 degree sector of new spokes per frame, the
+*	           normal update pattern of the viewer.
+*	With -D two rasters are rendered side by side into one image, as
+*	in the dual (original/filtered) display.
+*
+*	The program does not need the SPx library.
+*
+*	Run the program with "-?" as the command line option to get a help
+*	message.
+*
+**********************************************************************/
+
+/* Standard headers. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+/* Our own headers. */
+#include "SPxWorkPool.h"
+#include "SPxViewerRaster.h"
+
+/*
+ * Constants.
+ */
+#define	USAGE "Usage:\n\tSPxRasterBench [options]\n"			\
+		"\nOptions:\n"						\
+		"\t-a <bins>\tSet azimuth bins per turn (default 4096)\n" \
+		"\t-g <gates>\tSet range gates per spoke (default 1024)\n" \
+		"\t-n <frames>\tSet frames per measurement (default 100)\n" \
+		"\t-t <pixels>\tSet tile size (default 64)\n"		\
+		"\t-D\t\tRender two radars side by side (dual display)\n" \
+		"\t-H <pixels>\tSet height of one radar (default 2000)\n" \
+		"\t-W <pixels>\tSet width of one radar (default 2000)\n" \
+		"\t-?\t\tPrint usage information.\n\n"
+
+/* Thread counts measured. */
+static const unsigned int ThreadCounts[] = { 1, 2, 4, 8 };
+#define	NUM_THREAD_COUNTS	(sizeof(ThreadCounts) / sizeof(ThreadCounts[0]))
+
+/*
+ * Private function prototypes.
+ */
+static double nowSecs(void);
+static void makeSpoke(uint8_t *samples, int numSamples, unsigned int *seed);
+
+
+/*********************************************************************
+*
+*	Public functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* main
+*	Main entry point for the program.
+*
+* Params:
+*	argc, argv		Command line arguments.
+*
+* Returns:
+*	Zero on success, -1 on error.
+*
+* Notes
+*
+*===================================================================*/
+int main(int argc, char **argv)
+{
+    int c;
+    int numAzis = 4096;
+    int numGates = 1024;
+    int numFrames = 100;
+    int tileSize = 64;
+    int dual = 0;
+    int width = 2000;
+    int height = 2000;
+
+    /* Process any command line arguments.  */
+    opterr = 0;
+    while( (c = getopt(argc, argv, "a:g:n:t:DH:W:?")) != -1 )
+    {
+	switch(c)
+	{
+	    case 'a':	numAzis = strtol(optarg, NULL, 0);	break;
+	    case 'g':	numGates = strtol(optarg, NULL, 0);	break;
+	    case 'n':	numFrames = strtol(optarg, NULL, 0);	break;
+	    case 't':	tileSize = strtol(optarg, NULL, 0);	break;
+	    case 'D':	dual = 1;				break;
+	    case 'H':	height = strtol(optarg, NULL, 0);	break;
+	    case 'W':	width = strtol(optarg, NULL, 0);	break;
+	    case '?':	/* fall through */
+	    default:
+		fprintf(stderr, "\n%s", USAGE);
+		exit(-1);
+	}
+    } /* end of for each option */
+
+    if( (width <= 0) || (height <= 0) || (numAzis <= 0) || (numGates <= 1)
+	|| (numFrames <= 0) || (tileSize < 8) )
+    {
+	fprintf(stderr, "Invalid parameters.\n\n%s", USAGE);
+	exit(-1);
+    }
+
+    /* 듀얼 모드는 한 이미지에 두 레이더를 나란히 그림 (각 래스터는 자기 영역만 담당) */
+    int numRadars = dual ? 2 : 1;
+    int imageWidth = width * numRadars;
+    int pitchBytes = imageWidth * 4;
+    std::vector<uint32_t> image((size_t)imageWidth * height, 0);
+    std::vector<SPxViewerRaster *> rasters;
+    for(int r = 0; r < numRadars; r++)
+    {
+	SPxViewerRaster *raster = new SPxViewerRaster(width, height,
+						      numAzis, numGates, tileSize);
+	double radius = ((width < height) ? width : height) / 2.0 - 2.0;
+	raster->SetGeometry(width / 2.0, height / 2.0, radius, numGates - 1);
+	rasters.push_back(raster);
+    }
+
+    /* 한 바퀴 분량의 스포크를 미리 만들어 둠 */
+    unsigned int seed = 12345;
+    std::vector<uint8_t> spokes((size_t)numAzis * numGates);
+    for(int a = 0; a < numAzis; a++)
+    {
+	makeSpoke(&spokes[(size_t)a * numGates], numGates, &seed);
+    }
+    int aziPerSector = numAzis / 12;
+
+    printf("SPxRasterBench: %d x %d x %d radar(s), %d azimuths, %d gates, "
+	   "%d pixel tiles, %u cores\n\n",
+	   width, height, numRadars, numAzis, numGates, tileSize,
+	   SPxWorkPool::GetNumCores());
+    printf("threads | full ms/frame  Mpix/s  speedup | sector ms/frame  "
+	   "tiles  speedup\n");
+
+    double fullBase = 0.0;
+    double sectorBase = 0.0;
+    for(unsigned int i = 0; i < NUM_THREAD_COUNTS; i++)
+    {
+	unsigned int threads = ThreadCounts[i];
+	SPxWorkPool *pool = (threads > 1) ? new SPxWorkPool(threads) : NULL;
+
+	/* 전체 다시 그리기 */
+	for(int r = 0; r < numRadars; r++)
+	{
+	    for(int a = 0; a < numAzis; a++)
+	    {
+		rasters[r]->UpdateSpoke(a * 360.0 / numAzis,
+					&spokes[(size_t)a * numGates], numGates);
+	    }
+	}
+	double start = nowSecs();
+	for(int f = 0; f < numFrames; f++)
+	{
+	    for(int r = 0; r < numRadars; r++)
+	    {
+		rasters[r]->Invalidate();
+		rasters[r]->Render(&image[(size_t)r * width], pitchBytes, pool, 0);
+	    }
+	}
+	double fullMs = (nowSecs() - start) * 1000.0 / numFrames;
+
+	/* 섹터 단위 갱신 */
+	long long tiles = 0;
+	start = nowSecs();
+	for(int f = 0; f < numFrames; f++)
+	{
+	    int firstAzi = (f % 12) * aziPerSector;
+	    for(int r = 0; r < numRadars; r++)
+	    {
+		for(int a = firstAzi; a < firstAzi + aziPerSector; a++)
+		{
+		    rasters[r]->UpdateSpoke(a * 360.0 / numAzis,
+					    &spokes[(size_t)a * numGates], numGates);
+		}
+		tiles += rasters[r]->Render(&image[(size_t)r * width], pitchBytes,
+					    pool, 0);
+	    }
+	}
+	double sectorMs = (nowSecs() - start) * 1000.0 / numFrames;
+
+	if( i == 0 )
+	{
+	    fullBase = fullMs;
+	    sectorBase = sectorMs;
+	}
+	double mpix = ((double)imageWidth * height) / (fullMs * 1000.0);
+	printf("%7u | %13.2f %7.0f %7.2fx | %15.2f %6lld %7.2fx\n",
+	       threads, fullMs, mpix, fullBase / fullMs,
+	       sectorMs, tiles / numFrames, sectorBase / sectorMs);
+	delete pool;
+    }
+
+    for(size_t r = 0; r < rasters.size(); r++)
+    {
+	delete rasters[r];
+    }
+    return(0);
+} /* main() */
+
+
+/*********************************************************************
+*
+*	Private functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* nowSecs
+*	Get a monotonic time in seconds.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Time in seconds.
+*
+* Notes
+*
+*===================================================================*/
+static double nowSecs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return(ts.tv_sec + (ts.tv_nsec * 1e-9));
+} /* nowSecs() */
+
+
+/*====================================================================
+*
+* makeSpoke
+*	Generate a spoke of noise with a few targets and clutter.
+*
+* Params:
+*	samples			Buffer to fill,
+*	numSamples		Number of samples,
+*	seed			Random number state.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Deterministic, so runs are comparable.
+*
+*===================================================================*/
+static void makeSpoke(uint8_t *samples, int numSamples, unsigned int *seed)
+{
+    for(int g = 0; g < numSamples; g++)
+    {
+	*seed = (*seed * 1103515245u) + 12345u;
+	unsigned int noise = (*seed >> 16) & 0x3F;
+	/* 근거리 클러터와 드문 표적 */
+	unsigned int clutter = (g < numSamples / 8) ? (200 - (g * 160 / (numSamples / 8))) : 0;
+	unsigned int target = (((*seed >> 8) & 0x3FF) == 0) ? 255 : 0;
+	unsigned int v = noise + clutter + target;
+	samples[g] = (uint8_t)((v > 255) ? 255 : v);
+    }
+} /* makeSpoke() */
+
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
@@ -0,0 +1,387 @@
+/*********************************************************************
+*
+* File: SPxRealtime.cpp
+*
+* Purpose:
+*	Low-jitter real-time mode for the streamers (see SPxRealtime.h).
+*
+**********************************************************************/
+
+/* Standard headers. */
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+/* Our own header. */
+#include "SPxRealtime.h"
+
+/*
+ * Constants.
+ */
+/* Stack faulted in by ApplyToCurrentThread(). */
+#define	STACK_PREFAULT_BYTES	(256 * 1024)
+
+/* Page size if the system does not say. */
+#define	DEFAULT_PAGE_BYTES	4096
+
+
+/*====================================================================
+*
+* SPxRealtime::SPxRealtime
+*	Constructor.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+SPxRealtime::SPxRealtime(void)
+    : m_writerCpu(-1),
+      m_priority(SPX_REALTIME_PRIORITY),
+      m_rcvBufBytes(0),
+      m_lines(SPX_REALTIME_LINES),
+      m_lock(1)
+{
+} /* SPxRealtime::SPxRealtime() */
+
+
+/*====================================================================
+*
+* SPxRealtime::~SPxRealtime
+*	Destructor.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+SPxRealtime::~SPxRealtime()
+{
+} /* SPxRealtime::~SPxRealtime() */
+
+
+/*====================================================================
+*
+* SPxRealtime::Create
+*	Parse the mode.
+*
+* Params:
+*	spec			"on" or "<option>[,option...]"
+*				(see SPxRealtime.h).
+*
+* Returns:
+*	Zero on success, -1 on error.
+*
+* Notes
+*
+*===================================================================*/
+int SPxRealtime::Create(const char *spec)
+{
+    std::string text = (spec != NULL) ? spec : "";
+    m_error = "invalid real-time mode '" + text + "'";
+#ifndef __linux__
+    m_error = "real-time mode is only supported on Linux";
+    return(-1);
+#else
+    if( text.empty() )
+    {
+	return(-1);
+    }
+    if( text == "on" )
+    {
+	m_error.clear();
+	return(0);
+    }
+
+    size_t pos = 0;
+    while( pos != std::string::npos )
+    {
+	size_t next = text.find(',', pos);
+	std::string opt = text.substr(pos, (next == std::string::npos)
+				      ? std::string::npos : (next - pos));
+	pos = (next == std::string::npos) ? next : (next + 1);
+	if( opt == "nolock" )
+	{
+	    m_lock = 0;
+	    continue;
+	}
+	size_t eq = opt.find('=');
+	if( (eq == std::string::npos) || (eq + 1 >= opt.size()) )
+	{
+	    return(-1);
+	}
+	std::string value = opt.substr(eq + 1);
+	opt = opt.substr(0, eq);
+
+	/* rx 는 ':' 로 구분된 코어 목록 */
+	if( opt == "rx" )
+	{
+	    const char *p = value.c_str();
+	    m_rxCpus.clear();
+	    for(;;)
+	    {
+		char *end = NULL;
+		long cpu = strtol(p, &end, 0);
+		if( (end == p) || (cpu < 0) || (cpu >= CPU_SETSIZE) )
+		{
+		    return(-1);
+		}
+		m_rxCpus.push_back((int)cpu);
+		if( *end == '\0' )
+		{
+		    break;
+		}
+		if( *end != ':' )
+		{
+		    return(-1);
+		}
+		p = end + 1;
+	    }
+	    continue;
+	}
+
+	char *end = NULL;
+	long n = strtol(value.c_str(), &end, 0);
+	if( *end != '\0' )
+	{
+	    return(-1);
+	}
+	if( (opt == "writer") && (n >= 0) && (n < CPU_SETSIZE) )
+	{
+	    m_writerCpu = (int)n;
+	}
+	else if( (opt == "prio") && (n >= 0)
+		 && (n <= sched_get_priority_max(SCHED_FIFO)) )
+	{
+	    m_priority = (int)n;
+	}
+	else if( (opt == "rcvbuf") && (n >= 1) && (n <= 1024) )
+	{
+	    m_rcvBufBytes = (unsigned int)n * 1024 * 1024;
+	}
+	else if( (opt == "lines") && (n >= 16) && (n <= 1048576) )
+	{
+	    m_lines = (unsigned int)n;
+	}
+	else
+	{
+	    return(-1);
+	}
+    }
+    m_error.clear();
+    return(0);
+#endif
+} /* SPxRealtime::Create() */
+
+
+/*====================================================================
+*
+* SPxRealtime::GetReceiveCpu
+*	Get a channel's receive thread core.
+*
+* Params:
+*	channel			Channel.
+*
+* Returns:
+*	Core, or -1 if not pinned.
+*
+* Notes
+*	One core given is for all channels, otherwise channels past
+*	the list are not pinned.
+*
+*===================================================================*/
+int SPxRealtime::GetReceiveCpu(unsigned int channel) const
+{
+    if( m_rxCpus.size() == 1 )
+    {
+	return(m_rxCpus[0]);
+    }
+    return( (channel < m_rxCpus.size()) ? m_rxCpus[channel] : -1 );
+} /* SPxRealtime::GetReceiveCpu() */
+
+
+/*====================================================================
+*
+* SPxRealtime::ApplyToThread
+*	Pin a thread and set its scheduling class.
+*
+* Params:
+*	thread			Thread,
+*	cpu			Core, -1 to leave it unpinned,
+*	message			Set to the error or warning.
+*
+* Returns:
+*	Zero if applied, 1 if SCHED_FIFO was not permitted, -1 if the
+*	thread could not be pinned.
+*
+* Notes
+*
+*===================================================================*/
+int SPxRealtime::ApplyToThread(std::thread::native_handle_type thread,
+			       int cpu, std::string *message) const
+{
+    message->clear();
+#ifndef __linux__
+    (void)thread;
+    (void)cpu;
+    *message = "real-time mode is only supported on Linux";
+    return(-1);
+#else
+    if( cpu >= 0 )
+    {
+	cpu_set_t cpus;
+	CPU_ZERO(&cpus);
+	CPU_SET(cpu, &cpus);
+	int err = pthread_setaffinity_np(thread, sizeof(cpus), &cpus);
+	if( err != 0 )
+	{
+	    *message = "cannot pin thread to core " + std::to_string(cpu)
+		+ ": " + strerror(err);
+	    return(-1);
+	}
+    }
+    if( m_priority > 0 )
+    {
+	struct sched_param param;
+	memset(&param, 0, sizeof(param));
+	param.sched_priority = m_priority;
+	int err = pthread_setschedparam(thread, SCHED_FIFO, &param);
+	if( err != 0 )
+	{
+	    /* 권한이 없으면 경고만 하고 계속 */
+	    *message = std::string("cannot set SCHED_FIFO: ") + strerror(err);
+	    return(1);
+	}
+    }
+    return(0);
+#endif
+} /* SPxRealtime::ApplyToThread() */
+
+
+/*====================================================================
+*
+* SPxRealtime::ApplyToCurrentThread
+*	Pin the calling thread, set its scheduling class and fault in
+*	its stack.
+*
+* Params:
+*	cpu			Core, -1 to leave it unpinned,
+*	message			Set to the error or warning.
+*
+* Returns:
+*	As ApplyToThread().
+*
+* Notes
+*
+*===================================================================*/
+int SPxRealtime::ApplyToCurrentThread(int cpu, std::string *message) const
+{
+#ifdef __linux__
+    /* 스택을 미리 건드려 이후 페이지 폴트를 막음 */
+    volatile unsigned char stack[STACK_PREFAULT_BYTES];
+    for(size_t i = 0; i < sizeof(stack); i += DEFAULT_PAGE_BYTES)
+    {
+	stack[i] = 0;
+    }
+    return( ApplyToThread(pthread_self(), cpu, message) );
+#else
+    (void)cpu;
+    *message = "real-time mode is only supported on Linux";
+    return(-1);
+#endif
+} /* SPxRealtime::ApplyToCurrentThread() */
+
+
+/*====================================================================
+*
+* SPxRealtime::LockMemory
+*	Lock current and future memory.
+*
+* Params:
+*	message			Set to the warning.
+*
+* Returns:
+*	Zero if locked (or "nolock"), 1 if not permitted.
+*
+* Notes
+*	Locking also faults in everything already mapped; later
+*	mappings are faulted in as they are made.
+*
+*===================================================================*/
+int SPxRealtime::LockMemory(std::string *message) const
+{
+    message->clear();
+    if( !m_lock )
+    {
+	return(0);
+    }
+#ifdef __linux__
+    if( mlockall(MCL_CURRENT | MCL_FUTURE) != 0 )
+    {
+	*message = std::string("cannot lock memory: ") + strerror(errno);
+	return(1);
+    }
+    return(0);
+#else
+    *message = "real-time mode is only supported on Linux";
+    return(1);
+#endif
+} /* SPxRealtime::LockMemory() */
+
+
+/*====================================================================
+*
+* SPxRealtime::Prefault
+*	Touch every page of a buffer.
+*
+* Params:
+*	buf, len		Buffer.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	The contents are kept.
+*
+*===================================================================*/
+void SPxRealtime::Prefault(void *buf, size_t len)
+{
+    size_t page = DEFAULT_PAGE_BYTES;
+#ifdef __linux__
+    long sysPage = sysconf(_SC_PAGESIZE);
+    if( sysPage > 0 )
+    {
+	page = (size_t)sysPage;
+    }
+#endif
+    volatile unsigned char *p = (volatile unsigned char *)buf;
+    for(size_t i = 0; i < len; i += page)
+    {
+	p[i] = p[i];
+    }
+    if( len > 0 )
+    {
+	p[len - 1] = p[len - 1];
+    }
+} /* SPxRealtime::Prefault() */
+
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
@@ -0,0 +1,104 @@
+/*********************************************************************
+*
+* File: SPxRealtime.h
+*
+* Purpose:
+*	Low-jitter real-time mode for the streamers: threads pinned to
+*	chosen cores and run SCHED_FIFO, memory locked (mlockall) and
+*	buffers faulted in up front, so a spoke is not held up by the
+*	scheduler moving its thread or by page faults.
+*
+*	The mode is given as "<option>[,option...]" with the options:
+*
+*	    rx=<cpu>[:<cpu>...]	Receive thread cores, one for all
+*				channels or one per channel
+*	    writer=<cpu>	Output writer thread core
+*	    prio=<n>		SCHED_FIFO priority (default 50), 0 to
+*				leave the scheduling class alone
+*	    rcvbuf=<MB>		Socket receive buffer (default the
+*				receiver's own)
+*	    lines=<n>		Output lines queued, all faulted in
+*				(default 4096)
+*	    nolock		Do not mlockall()
+*
+*	"on" alone takes the defaults.  The scheduling class and memory
+*	locking need privileges (CAP_SYS_NICE, CAP_IPC_LOCK or rlimits);
+*	without them a warning is printed and the rest still applies.
+*	Pinning a thread to a core that does not exist is an error.
+*	Linux only.  It does not depend on the SPx library.
+*
+**********************************************************************/
+
+#ifndef _SPX_REALTIME_H
+#define _SPX_REALTIME_H
+
+#include <stddef.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* Defaults for the options. */
+#define	SPX_REALTIME_PRIORITY		50
+#define	SPX_REALTIME_LINES		4096
+
+class SPxRealtime
+{
+public:
+    /* Constructor/destructor. */
+    SPxRealtime(void);
+    ~SPxRealtime();
+
+    /* Parse the mode (see above).  Zero on success or -1 on error (see
+     * GetError()).
+     */
+    int Create(const char *spec);
+    const char *GetError(void) const { return m_error.c_str(); }
+
+    /* Options.  Cores are -1 and sizes 0 when not given. */
+    int GetReceiveCpu(unsigned int channel) const;
+    unsigned int GetNumReceiveCpus(void) const
+    {
+	return (unsigned int)m_rxCpus.size();
+    }
+    int GetWriterCpu(void) const { return m_writerCpu; }
+    int GetPriority(void) const { return m_priority; }
+    unsigned int GetRcvBufBytes(void) const { return m_rcvBufBytes; }
+    unsigned int GetLines(void) const { return m_lines; }
+
+    /* Pin a thread (cpu >= 0) and make it SCHED_FIFO (at the priority
+     * given).  Zero if everything applied, 1 if only the scheduling
+     * class could not be set (warning in *message), -1 on error.
+     */
+    int ApplyToThread(std::thread::native_handle_type thread, int cpu,
+		      std::string *message) const;
+
+    /* As ApplyToThread() for the calling thread (e.g. an SDK receive
+     * thread, on its first spoke), also faulting in its stack.
+     */
+    int ApplyToCurrentThread(int cpu, std::string *message) const;
+
+    /* Lock current and future memory unless "nolock".  Zero on success
+     * (or not asked for), 1 if not permitted (warning in *message).
+     */
+    int LockMemory(std::string *message) const;
+
+    /* Touch every page of a buffer. */
+    static void Prefault(void *buf, size_t len);
+
+private:
+    std::string m_error;
+    std::vector<int> m_rxCpus;
+    int m_writerCpu;
+    int m_priority;
+    unsigned int m_rcvBufBytes;
+    unsigned int m_lines;
+    int m_lock;
+};
+
+#endif /* _SPX_REALTIME_H */
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
@@ -0,0 +1,490 @@
+/*********************************************************************
+*
+* File: SPxRecvCheck.cpp
+*
+* Purpose:
+*	Check of the native batched receiver (SPxBatchReceive, the
+*	streamers' -B option) against the SDK decoder.
+*
+*	The same address and port are received by SPxNetworkReceive (or
+*	SPxNetworkReceiveAsterix with -x) and by SPxBatchReceive.  By
+*	default a turn of synthetic spokes is sent to them with the SDK's
+*	own encoder (SPxNetworkSend or SPxNetworkSendAsterix), so the
+*	wire format, chunking and compression are the SDK's; with -R
+*	nothing is sent and an external source is received instead.
+*
+*	The spokes from the two receivers are compared in order
+*	(azimuth, length, ranges and samples).  The address should be a
+*	multicast group so that both sockets get every datagram.
+*
+*	Run the program with "-?" as the command line option to get a help
+*	message.
+*
+**********************************************************************/
+
+/* Standard headers. */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mutex>
+#include <vector>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+/* SPx Library headers. */
+#include "SPxNoMFC.h"
+#ifdef _WIN32
+#include "SPxLibUtils/SPxGetOpt.h"
+#endif
+
+/* Native receiver. */
+#include "SPxBatchReceive.h"
+
+/*
+ * Constants.
+ */
+#define	USAGE "Usage:\n\tSPxRecvCheck [options]\n"			\
+		"\nOptions:\n"						\
+		"\t-a <addr>\tSet multicast group (default SPx radar or\n" \
+		"\t\t\tASTERIX group)\n"				\
+		"\t-B <batch>\tNative receive batch (default 64)\n"	\
+		"\t-e <format>\tSDK encode format, SPX_RIB_PACKING_...\n" \
+		"\t\t\t(default 0, RAW8; 20 for ZLIB)\n"		\
+		"\t-g <gates>\tSet samples per spoke (default 2048)\n"	\
+		"\t-i <ifAddr>\tSet interface address for multicast\n"	\
+		"\t-n <spokes>\tSet spokes to send (default 4096)\n"	\
+		"\t-p <port>\tSet port (default SPx radar or ASTERIX)\n" \
+		"\t-R\t\tSend nothing, receive an external source\n"	\
+		"\t-w <secs>\tReceive time with -R (default 10)\n"	\
+		"\t-x\t\tASTERIX Cat-240 instead of SPx\n"		\
+		"\t-?\t\tPrint usage information.\n\n"
+
+/* Time for multicast joins before sending, and for the last packets
+ * to arrive, in milliseconds.
+ */
+#define	SETTLE_MSECS		500
+#define	DRAIN_MSECS		1000
+
+/* Spokes sent between pauses, so the loopback is not overrun. */
+#define	SEND_BURST		32
+
+/* One decoded spoke. */
+struct Spoke
+{
+    UINT16 azimuth;
+    unsigned int numSamples;
+    REAL32 startRange;
+    REAL32 endRange;
+    std::vector<UINT16> samples;
+};
+
+/* Spokes from one receiver, added to on its thread. */
+struct SpokeLog
+{
+    std::mutex mutex;
+    std::vector<Spoke> spokes;
+};
+
+/* SDK sender with its encode and send of one return made public. */
+template<class SenderBase> class CheckSender : public SenderBase
+{
+public:
+    int SendOne(SPxReturn *rtn, std::vector<unsigned char> *buf)
+    {
+	unsigned int numBytes = 0;
+	unsigned int format = 0;
+	unsigned char *encoded = this->EncodeReturn(rtn, &(*buf)[0],
+						   (unsigned int)buf->size(),
+						   &numBytes, &format);
+	if( encoded == NULL )
+	{
+	    return(-1);
+	}
+	return( this->SendReturn(&rtn->header, encoded, numBytes, format) );
+    }
+};
+
+/*
+ * Private function prototypes.
+ */
+static void spxErrorHandler(SPxErrorType errType, SPxErrorCode errCode,
+			    int arg1, int arg2,
+			    const char *arg3, const char *arg4);
+static void addSpoke(SpokeLog *log, const SPxReturnHeader *hdr,
+		     const unsigned char *data);
+static void handleSdk(SPxNetworkReceive *src, void *arg,
+		      SPxReturnHeader *hdr, unsigned char *data);
+static void handleNative(void *arg, SPxReturnHeader *hdr,
+			 unsigned char *data);
+template<class SenderBase>
+static int sendTurn(const char *addr, int port, const char *ifAddr,
+		    int format, int numSpokes, int numGates);
+static int compareLogs(SpokeLog *sdk, SpokeLog *native);
+
+
+/*********************************************************************
+*
+*	Public functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* main
+*	Main entry point for the program.
+*
+* Params:
+*	argc, argv		Command line arguments.
+*
+* Returns:
+*	Zero if the receivers agreed, -1 otherwise.
+*
+* Notes
+*
+*===================================================================*/
+int main(int argc, char **argv)
+{
+    int c;
+    const char *addr = NULL;
+    const char *ifAddr = NULL;
+    int port = 0;
+    int cat240 = FALSE;
+    int send = TRUE;
+    int format = SPX_RIB_PACKING_RAW8;
+    int batch = 64;
+    int numGates = 2048;
+    int numSpokes = 4096;
+    int waitSecs = 10;
+
+    /* Process any command line arguments.  */
+    opterr = 0;
+    while( (c = getopt(argc, argv, "a:B:e:g:i:n:p:Rw:x?")) != -1 )
+    {
+	switch(c)
+	{
+	    case 'a':	addr = optarg;				break;
+	    case 'B':	batch = strtol(optarg, NULL, 0);	break;
+	    case 'e':	format = strtol(optarg, NULL, 0);	break;
+	    case 'g':	numGates = strtol(optarg, NULL, 0);	break;
+	    case 'i':	ifAddr = optarg;			break;
+	    case 'n':	numSpokes = strtol(optarg, NULL, 0);	break;
+	    case 'p':	port = strtol(optarg, NULL, 0);		break;
+	    case 'R':	send = FALSE;				break;
+	    case 'w':	waitSecs = strtol(optarg, NULL, 0);	break;
+	    case 'x':	cat240 = TRUE;				break;
+	    case '?':	/* fall through */
+	    default:
+		fprintf(stderr, "\n%s", USAGE);
+		exit(-1);
+	}
+    } /* end of for each option */
+
+    if( (numGates < 1) || (numGates > 65535) || (numSpokes < 1)
+	|| (batch < 1) || (batch > SPX_BATCH_RECEIVE_MAX_BATCH) || (waitSecs < 1) )
+    {
+	fprintf(stderr, "Invalid parameters.\n\n%s", USAGE);
+	exit(-1);
+    }
+    if( addr == NULL )
+    {
+	addr = cat240 ? SPX_SCNET_DEFAULT_ADDR_ASTERIX : SPX_SCNET_DEFAULT_ADDR_RADAR;
+    }
+    if( port == 0 )
+    {
+	port = cat240 ? SPX_SCNET_DEFAULT_PORT_ASTERIX : SPX_SCNET_DEFAULT_PORT_RADAR;
+    }
+
+    SPxSetErrorHandler(spxErrorHandler);
+    if( SPxInit() != SPX_NO_ERROR )
+    {
+	fprintf(stderr, "Failed to initialise SPx library.\n");
+	exit(-1);
+    }
+    SPxLicInit();
+
+    /* 같은 그룹/포트를 SDK와 네이티브 수신기로 동시에 수신 */
+    SpokeLog sdkLog;
+    SpokeLog nativeLog;
+    SPxNetworkReceive *src = cat240 ? new SPxNetworkReceiveAsterix(NULL)
+	: new SPxNetworkReceive(NULL);
+    if( (src->Create(addr, port, ifAddr) != SPX_NO_ERROR)
+	|| (src->InstallDataFn(handleSdk, &sdkLog) != SPX_NO_ERROR) )
+    {
+	fprintf(stderr, "Failed to create SDK network source.\n");
+	exit(-1);
+    }
+    src->Enable(TRUE);
+    SPxBatchReceive *native = new SPxBatchReceive(handleNative, &nativeLog);
+    if( native->Create(addr, port, ifAddr, cat240, (unsigned int)batch,
+		       SPX_BATCH_RECEIVE_RCVBUF_MB * 1024 * 1024) != 0 )
+    {
+	fprintf(stderr, "Failed to create native receiver: %s.\n",
+		native->GetError());
+	exit(-1);
+    }
+    printf("SPxRecvCheck: %s %s:%d, native batch %d\n",
+	   cat240 ? "ASTERIX Cat-240" : "SPx", addr, port, batch);
+    SPxTimeSleepMsecs(SETTLE_MSECS);
+
+    if( send )
+    {
+	printf("Sending %d spokes of %d samples, encode format %d.\n",
+	       numSpokes, numGates, format);
+	int sent = cat240
+	    ? sendTurn<SPxNetworkSendAsterix>(addr, port, ifAddr, format,
+					       numSpokes, numGates)
+	    : sendTurn<SPxNetworkSend>(addr, port, ifAddr, format,
+				       numSpokes, numGates);
+	if( sent != 0 )
+	{
+	    exit(-1);
+	}
+	SPxTimeSleepMsecs(DRAIN_MSECS);
+    }
+    else
+    {
+	printf("Receiving for %d seconds.\n", waitSecs);
+	SPxTimeSleepMsecs(waitSecs * 1000);
+    }
+
+    /* 수신을 멈추고 비교 */
+    delete src;
+    SPxBatchReceive::Stats stats;
+    native->GetStats(&stats);
+    delete native;
+    printf("Native: %llu packets, %.1f per syscall (max %u), %llu kernel"
+	   " drops, %llu bad, %llu incomplete, %llu unsupported.\n",
+	   (unsigned long long)stats.numPackets, stats.packetsPerSyscall,
+	   stats.maxBatch, (unsigned long long)stats.numKernelDrops,
+	   (unsigned long long)stats.numBad,
+	   (unsigned long long)stats.numIncomplete,
+	   (unsigned long long)stats.numUnsupported);
+
+    int result = compareLogs(&sdkLog, &nativeLog);
+    printf("\n%s\n", (result == 0) ? "Native receiver matches the SDK."
+	   : "MISMATCHES against the SDK.");
+    return(result);
+} /* main() */
+
+
+/*********************************************************************
+*
+*	Private functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* spxErrorHandler
+*	Callback function for errors reported by the SPx library.
+*
+* Params:
+*	errType, errCode	Error type and code,
+*	arg1 - arg4		Error values.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+static void spxErrorHandler(SPxErrorType errType, SPxErrorCode errCode,
+			    int arg1, int arg2,
+			    const char *arg3, const char *arg4)
+{
+    printf("SPx Error #%d, args %d, %d, %s, %s.\n",
+	   errCode, arg1, arg2,
+	   (arg3 ? arg3 : "<none>"),
+	   (arg4 ? arg4 : "<none>"));
+} /* spxErrorHandler() */
+
+
+/*====================================================================
+*
+* addSpoke
+*	Record a decoded spoke.
+*
+* Params:
+*	log			Receiver's log,
+*	hdr, data		Spoke from the data function.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Samples are widened to 16 bits so RAW8 and RAW16 compare.
+*
+*===================================================================*/
+static void addSpoke(SpokeLog *log, const SPxReturnHeader *hdr,
+		     const unsigned char *data)
+{
+    Spoke spoke;
+    unsigned int bps = SPxGetPackingBytesPerSample(hdr->packing);
+    spoke.azimuth = hdr->azimuth;
+    spoke.numSamples = hdr->thisLength;
+    spoke.startRange = hdr->startRange;
+    spoke.endRange = hdr->endRange;
+    spoke.samples.resize(spoke.numSamples);
+    for(unsigned int i = 0; i < spoke.numSamples; i++)
+    {
+	spoke.samples[i] = (bps == 2) ? ((const UINT16 *)data)[i] : data[i];
+    }
+    std::lock_guard<std::mutex> lock(log->mutex);
+    log->spokes.push_back(spoke);
+} /* addSpoke() */
+
+
+/*====================================================================
+*
+* handleSdk, handleNative
+*	Data functions of the two receivers.
+*
+* Params:
+*	src			SDK source (unused),
+*	arg			SpokeLog,
+*	hdr, data		Spoke.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+static void handleSdk(SPxNetworkReceive *src, void *arg,
+		      SPxReturnHeader *hdr, unsigned char *data)
+{
+    addSpoke((SpokeLog *)arg, hdr, data);
+} /* handleSdk() */
+
+static void handleNative(void *arg, SPxReturnHeader *hdr,
+			 unsigned char *data)
+{
+    addSpoke((SpokeLog *)arg, hdr, data);
+} /* handleNative() */
+
+
+/*====================================================================
+*
+* sendTurn
+*	Send a turn of synthetic spokes with the SDK encoder.
+*
+* Params:
+*	addr, port, ifAddr	Destination,
+*	format			Encode format,
+*	numSpokes, numGates	Spokes and samples per spoke.
+*
+* Returns:
+*	Zero on success, -1 on error.
+*
+* Notes
+*	Each spoke is a ramp plus a few spoke-dependent blocks, so
+*	both plain and compressed formats have something to carry.
+*
+*===================================================================*/
+template<class SenderBase>
+static int sendTurn(const char *addr, int port, const char *ifAddr,
+		    int format, int numSpokes, int numGates)
+{
+    CheckSender<SenderBase> sender;
+    if( sender.Create(addr, port, ifAddr) != SPX_NO_ERROR )
+    {
+	fprintf(stderr, "Failed to create SDK sender.\n");
+	return(-1);
+    }
+    sender.SetEncodeFormat(format);
+
+    std::vector<unsigned char> rtnBuf(sizeof(SPxReturnHeader) + numGates);
+    std::vector<unsigned char> encodeBuf((2 * numGates) + 4096);
+    SPxReturn *rtn = (SPxReturn *)&rtnBuf[0];
+    unsigned char *samples = &rtnBuf[sizeof(SPxReturnHeader)];
+    for(int a = 0; a < numSpokes; a++)
+    {
+	SPxReturnHeader *hdr = &rtn->header;
+	memset(hdr, 0, sizeof(*hdr));
+	hdr->magic1 = SPX_RIB_HEADER_MAGIC1;
+	hdr->magic2 = SPX_RIB_HEADER_MAGIC2;
+	hdr->headerSize = sizeof(SPxReturnHeader);
+	hdr->radarVideoSize = (UINT16)numGates;
+	hdr->totalSize = sizeof(SPxReturnHeader) + numGates;
+	hdr->numTriggers = 1;
+	hdr->count = (UINT16)a;
+	hdr->nominalLength = (UINT16)numGates;
+	hdr->thisLength = (UINT16)numGates;
+	hdr->azimuth = (UINT16)(((long long)a * 65536) / numSpokes);
+	hdr->packing = SPX_RIB_PACKING_RAW8;
+	hdr->timeInterval = 500;
+	hdr->startRange = 0.0f;
+	hdr->endRange = 7.5f * numGates;
+	for(int g = 0; g < numGates; g++)
+	{
+	    int block = ((g / 64) + a) % 7;
+	    samples[g] = (unsigned char)((block == 0) ? 200 : ((g + a) & 0x3F));
+	}
+	if( sender.SendOne(rtn, &encodeBuf) < 0 )
+	{
+	    fprintf(stderr, "Failed to send spoke %d.\n", a);
+	    return(-1);
+	}
+	if( ((a + 1) % SEND_BURST) == 0 )
+	{
+	    SPxTimeSleepMsecs(1);
+	}
+    }
+    return(0);
+} /* sendTurn() */
+
+
+/*====================================================================
+*
+* compareLogs
+*	Compare the spokes from the two receivers.
+*
+* Params:
+*	sdk, native		Logs.
+*
+* Returns:
+*	Zero if they match, -1 otherwise.
+*
+* Notes
+*	Spokes are paired in arrival order.
+*
+*===================================================================*/
+static int compareLogs(SpokeLog *sdk, SpokeLog *native)
+{
+    size_t numSdk = sdk->spokes.size();
+    size_t numNative = native->spokes.size();
+    size_t num = (numSdk < numNative) ? numSdk : numNative;
+    size_t azDiffs = 0;
+    size_t lengthDiffs = 0;
+    size_t rangeDiffs = 0;
+    size_t sampleDiffs = 0;
+    for(size_t i = 0; i < num; i++)
+    {
+	const Spoke *a = &sdk->spokes[i];
+	const Spoke *b = &native->spokes[i];
+	azDiffs += (a->azimuth != b->azimuth);
+	lengthDiffs += (a->numSamples != b->numSamples);
+	/* 범위는 부동소수 계산 차이만 허용 */
+	rangeDiffs += (fabs(a->startRange - b->startRange) > 0.01
+		       || fabs(a->endRange - b->endRange)
+		       > (0.0001 * fabs(a->endRange) + 0.01));
+	sampleDiffs += (a->samples != b->samples);
+    }
+    printf("\nSpokes: SDK %u, native %u; differing: azimuth %u, length %u,"
+	   " range %u, samples %u.\n", (unsigned int)numSdk,
+	   (unsigned int)numNative, (unsigned int)azDiffs,
+	   (unsigned int)lengthDiffs, (unsigned int)rangeDiffs,
+	   (unsigned int)sampleDiffs);
+    return( ((numSdk == numNative) && (numSdk > 0) && (azDiffs == 0)
+	     && (lengthDiffs == 0) && (rangeDiffs == 0) && (sampleDiffs == 0))
+	    ? 0 : -1 );
+} /* compareLogs() */
+
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
@@ -0,0 +1,715 @@
+/*********************************************************************
+*
+* File: SPxRenderServer.cpp
+*
+* Purpose:
+*	Headless render service for the Python viewer.
+*
+*	Radar video is received from the network (SPxNetworkReceive or
+*	SPxNetworkReceiveAsterix) or replayed from a recording
+*	(SPxRadarReplay) into a RIB.  A PIM on that RIB feeds the SDK
+*	software scan converter (SPxScSourceLocal), which draws into an
+*	SPxScDestBitmap whose memory lives in a POSIX shared memory
+*	segment (see SPxRenderShm.h).
+*
+*	The viewer maps the same segment, blits the dirty rectangles
+*	reported by the bitmap update callback and posts view changes
+*	(zoom/pan) back through the segment header, which the main loop
+*	here forwards to SPxScSourceLocal::SetView().
+*
+*	Run the program with "-?" as the command line option to get a help
+*	message.
+*
+**********************************************************************/
+
+/* Standard headers. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#ifndef _WIN32
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+/* SPx Library headers. */
+#include "SPxNoMFC.h"
+#ifdef _WIN32
+#include "SPxLibUtils/SPxGetOpt.h"
+#endif
+
+/* Shared memory layout. */
+#include "SPxRenderShm.h"
+
+/*
+ * Constants.
+ */
+#define	USAGE "Usage:\n\tSPxRenderServer [options] [<filename>]\n"	\
+		"\nOptions:\n"						\
+		"\t-a <addr>\tSet address for receiving radar data\n"	\
+		"\t-c <rrggbb>\tSet radar colour (hex, default 00ff00)\n" \
+		"\t-d <flags>\tSet debug flags\n"			\
+		"\t-f <rate>\tSet real-time fade rate (0 = replace)\n"	\
+		"\t-i <ifAddr>\tSet interface address for multicast\n"	\
+		"\t-p <port>\tSet port for receiving radar data\n"	\
+		"\t-r <metres>\tSet initial view radius in metres\n"	\
+		"\t-s <name>\tSet shared memory name (default "	\
+				SPX_RENDER_SHM_DEFAULT_NAME ")\n"	\
+		"\t-v\t\tIncrease verbosity\n"				\
+		"\t-x\t\tReceive ASTERIX Cat-240 radar video\n"		\
+		"\t-H <pixels>\tSet bitmap height (default 600)\n"	\
+		"\t-W <pixels>\tSet bitmap width (default 600)\n"	\
+		"\t-?\t\tPrint usage information.\n\n"			\
+		"\tIf <filename> is given the recording is replayed,\n"	\
+		"\totherwise radar video is received from the network.\n\n"
+
+/* Amount of time to sleep on exit, in milliseconds. */
+#ifdef _WIN32
+#define	EXIT_DELAY_TIME	5000	/* To keep console window on screen */
+#else
+#define	EXIT_DELAY_TIME	100
+#endif
+
+/* Main loop period, in milliseconds (also the fade check interval). */
+#define	MAIN_LOOP_PERIOD_MS	20
+
+/* RIB and PIM sizes. */
+#define	RIB_SIZE_BYTES		(8 * 1024 * 1024)
+#define	PIM_NUM_SAMPLES		1024
+#define	PIM_NUM_AZIMUTHS	2048
+
+/* Default bitmap size, matches the viewer's single radar window. */
+#define	DEFAULT_WIDTH		600
+#define	DEFAULT_HEIGHT		600
+
+/* Radius of the radar circle in the viewer, in pixels. */
+#define	VIEWER_RADAR_RADIUS	250
+
+/*
+ * Private function prototypes.
+ */
+/* Error handler. */
+static void spxErrorHandler(SPxErrorType errType, SPxErrorCode errCode,
+				int arg1, int arg2,
+				const char *arg3, const char *arg4);
+
+/* Bitmap update handler. */
+static void handleBitmapUpdate(SPxScDestBitmap *bitmap, UINT16 changes,
+				UINT16 firstAzimuth, UINT16 endAzimuth,
+				DirtyBox box, void *userPtr);
+
+/* Shared memory helpers. */
+static SPxRenderShmHeader_t *shmCreate(const char *name,
+					unsigned int width,
+					unsigned int height);
+static void shmDestroy(const char *name, SPxRenderShmHeader_t *hdr);
+static void shmAddRect(SPxRenderShmHeader_t *hdr,
+			int x, int y, int w, int h);
+
+/* Init/shutdown utility functions. */
+static SPxErrorCode osInit(void);
+#ifdef _WIN32
+static BOOL WINAPI sigIntHandler(DWORD fdwCtrlType);
+#else
+static void sigIntHandler(int sig);
+#endif
+
+
+/*
+ * Global variables.
+ */
+/* Verbosity level. */
+static int Verbose = 0;
+
+/* Exit flag. */
+static int MainLoopFinish = 0;
+
+
+/*********************************************************************
+*
+*	Implementation functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* main
+*	Entry point for program.
+*
+* Params:
+*	argc, argv		Standard C arguments.
+*
+* Returns:
+*	Zero on success,
+*	Error code otherwise.
+*
+* Notes:
+*
+*===================================================================*/
+int main(int argc, char **argv)
+{
+    int c;				/* For parsing command line options */
+    SPxErrorCode err;			/* SPx error value */
+    char *addr = NULL;			/* NULL means use library default */
+    char *ifAddr = NULL;		/* For joining multicast groups */
+    int port = 0;			/* 0 means use library default */
+    UINT32 debug = 0;			/* Debug flags */
+    int asterixCat240 = FALSE;		/* Receive ASTERIX Cat-240 */
+    const char *shmName = SPX_RENDER_SHM_DEFAULT_NAME;
+    unsigned int width = DEFAULT_WIDTH;
+    unsigned int height = DEFAULT_HEIGHT;
+    UINT32 colour = 0x00FF00;		/* Radar colour, 0xRRGGBB */
+    int fadeRate = 0;			/* 0 means replace mode */
+    double viewRadius = 0.0;		/* 0 means follow end range */
+
+    /* Initialise operating system specific things. */
+    if( osInit() != SPX_NO_ERROR )
+    {
+	SPxTimeSleepMsecs(EXIT_DELAY_TIME);
+	exit(-1);
+    }
+
+    /* Process any command line arguments.  */
+    opterr = 0;
+    while( (c = getopt(argc, argv, "a:c:d:f:i:p:r:s:vxH:W:?")) != -1 )
+    {
+	switch(c)
+	{
+	    case 'a':	addr = optarg;				break;
+	    case 'c':	colour = strtoul(optarg, NULL, 16);	break;
+	    case 'd':	debug = strtoul(optarg, NULL, 0);	break;
+	    case 'f':	fadeRate = strtol(optarg, NULL, 0);	break;
+	    case 'i':	ifAddr = optarg;			break;
+	    case 'p':	port = strtol(optarg, NULL, 0);		break;
+	    case 'r':	viewRadius = strtod(optarg, NULL);	break;
+	    case 's':	shmName = optarg;			break;
+	    case 'v':	Verbose++;				break;
+	    case 'x':	asterixCat240 = TRUE;			break;
+	    case 'H':	height = strtoul(optarg, NULL, 0);	break;
+	    case 'W':	width = strtoul(optarg, NULL, 0);	break;
+	    case '?':	/* fall through */
+	    default:
+		fprintf(stderr, "\n%s", USAGE);
+		SPxTimeSleepMsecs(EXIT_DELAY_TIME);
+		exit(-1);
+	}
+    } /* end of for each option */
+    const char *filename = (optind < argc) ? argv[optind] : NULL;
+
+    if( (width == 0) || (height == 0) || (width > 0xFFFF) || (height > 0xFFFF) )
+    {
+	fprintf(stderr, "Invalid bitmap size %ux%u.\n", width, height);
+	SPxTimeSleepMsecs(EXIT_DELAY_TIME);
+	exit(-1);
+    }
+
+    /*
+     * Welcome banner.
+     */
+    printf("\n### Cambridge Pixel SPxRenderServer %s ###\n\n",
+		SPX_VERSION_STRING);
+
+    /*
+     * Install error handler and initialise library.
+     */
+    SPxSetErrorHandler(spxErrorHandler);
+    if( SPxInit() != SPX_NO_ERROR )
+    {
+	fprintf(stderr, "Failed to initialise SPx library.\n");
+	SPxTimeSleepMsecs(EXIT_DELAY_TIME);
+	exit(-1);
+    }
+
+    /* Initialise dongle-based licensing if available. */
+    SPxLicInit();
+
+    /*
+     * Create the shared memory segment the bitmap lives in.
+     */
+    SPxRenderShmHeader_t *shm = shmCreate(shmName, width, height);
+    if( shm == NULL )
+    {
+	fprintf(stderr, "Failed to create shared memory '%s'.\n", shmName);
+	SPxTimeSleepMsecs(EXIT_DELAY_TIME);
+	exit(-1);
+    }
+    unsigned char *bitmapMem = (unsigned char *)shm + shm->headerSize;
+
+    /*
+     * Radar input: source -> RIB -> PIM.
+     */
+    SPxRIB *rib = new SPxRIB(RIB_SIZE_BYTES);
+    SPxPIM *pim = new SPxPIM(rib, PIM_NUM_SAMPLES, PIM_NUM_AZIMUTHS);
+
+    SPxNetworkReceive *netSrc = NULL;
+    SPxRadarReplay *fileSrc = NULL;
+    if( filename != NULL )
+    {
+	fileSrc = new SPxRadarReplay(rib);
+	if( fileSrc->SetFileName(filename) != SPX_NO_ERROR )
+	{
+	    fprintf(stderr, "Failed to select file '%s'.\n", filename);
+	    shmDestroy(shmName, shm);
+	    SPxTimeSleepMsecs(EXIT_DELAY_TIME);
+	    exit(-1);
+	}
+	/* 파일 끝에서 처음부터 다시 재생 */
+	fileSrc->SetAutoLoop(TRUE);
+    }
+    else
+    {
+	if( (Verbose > 0) || (debug != 0) )
+	{
+	    SPxNetworkReceive::SetLogFile(stdout);
+	    SPxNetworkReceive::SetDebug(debug);
+	}
+	if( asterixCat240 )
+	{
+	    netSrc = new SPxNetworkReceiveAsterix(rib);
+	}
+	else
+	{
+	    netSrc = new SPxNetworkReceive(rib);
+	}
+	err = netSrc->Create(addr, port, ifAddr);
+	if( err != SPX_NO_ERROR )
+	{
+	    fprintf(stderr, "Failed to create network source.\n");
+	    shmDestroy(shmName, shm);
+	    SPxTimeSleepMsecs(EXIT_DELAY_TIME);
+	    exit(-1);
+	}
+    }
+
+    /*
+     * Scan conversion: PIM -> SPxScSourceLocal -> SPxScDestBitmap.
+     */
+    SPxScDestBitmap *bitmap = new SPxScDestBitmap();
+    if( bitmap->Create((UINT16)width, (UINT16)height, SPX_BITMAP_32BITS,
+			bitmapMem, (int)shm->stride) != SPX_NO_ERROR )
+    {
+	fprintf(stderr, "Failed to create scan converter bitmap.\n");
+	shmDestroy(shmName, shm);
+	SPxTimeSleepMsecs(EXIT_DELAY_TIME);
+	exit(-1);
+    }
+    bitmap->SetUpdateCallback(handleBitmapUpdate, shm);
+
+    SPxScSourceLocal *sc = new SPxScSourceLocal(bitmap);
+    sc->SetWinGeom(0, 0, (UINT16)width, (UINT16)height);
+    sc->SetRadarColour(0, (UCHAR)((colour >> 16) & 0xFF),
+			(UCHAR)((colour >> 8) & 0xFF),
+			(UCHAR)(colour & 0xFF));
+    if( fadeRate > 0 )
+    {
+	sc->SetFade(SPX_RADAR_FADE_REAL_TIME, (UINT16)fadeRate);
+    }
+    else
+    {
+	sc->SetFade(SPX_RADAR_FADE_REPLACE, 0);
+    }
+    if( viewRadius > 0.0 )
+    {
+	/* 뷰어와 같은 축척: 반경 viewRadius 가 VIEWER_RADAR_RADIUS 픽셀 */
+	double metresPerPixel = viewRadius / VIEWER_RADAR_RADIUS;
+	sc->SetView(0.0f, 0.0f, (REAL32)(width * metresPerPixel),
+		    (REAL32)(height * metresPerPixel));
+    }
+    sc->ShowRadar(0, SPX_SC_STATE_RUN);
+
+    SPxRunProcess *scProcess = new SPxRunProcess(SPxProScanConv, NULL,
+						 pim, sc);
+    if( scProcess == NULL )
+    {
+	fprintf(stderr, "Failed to create scan conversion process.\n");
+	shmDestroy(shmName, shm);
+	SPxTimeSleepMsecs(EXIT_DELAY_TIME);
+	exit(-1);
+    }
+
+    /*
+     * Start acquisition.
+     */
+    if( fileSrc != NULL )
+    {
+	fileSrc->Enable(TRUE);
+    }
+    else
+    {
+	netSrc->Enable(TRUE);
+    }
+
+    printf("Rendering %ux%u into shared memory '%s'.\n",
+		width, height, shmName);
+    fflush(stdout);
+
+    /*
+     * Run the main loop.
+     */
+    while( !MainLoopFinish )
+    {
+	SPxTimeSleepMsecs(MAIN_LOOP_PERIOD_MS);
+
+	/* 실시간 페이드 처리 - 페이드가 일어나면 비트맵 전체가 변경됨 */
+	int faded = FALSE;
+	bitmap->FadeBitmap(&faded);
+	if( faded )
+	{
+	    shmAddRect(shm, 0, 0, (int)width, (int)height);
+	}
+
+	/* 뷰어에서 보낸 뷰 변경 요청 처리 */
+	UINT32 viewSeq = shm->viewSeq;
+	if( viewSeq != shm->viewSeqApplied )
+	{
+	    REAL32 vx = shm->viewX;
+	    REAL32 vy = shm->viewY;
+	    REAL32 vw = shm->viewW;
+	    REAL32 vh = shm->viewH;
+	    if( (vw > 0.0f) && (vh > 0.0f) )
+	    {
+		sc->SetView(vx, vy, vw, vh);
+		if( Verbose > 0 )
+		{
+		    printf("View %.1f,%.1f %.1fx%.1f m.\n", vx, vy, vw, vh);
+		}
+	    }
+	    shm->viewSeqApplied = viewSeq;
+	}
+
+	/* 뷰어의 거리 눈금 표시용 */
+	shm->endRangeMetres = (REAL32)sc->GetRadarEndRangeInMetres();
+    } /* end of main loop */
+
+    /*
+     * Tidy up.
+     */
+    if( fileSrc != NULL )
+    {
+	fileSrc->Enable(FALSE);
+    }
+    else
+    {
+	netSrc->Enable(FALSE);
+    }
+    delete scProcess;
+    delete sc;
+    delete bitmap;
+    delete fileSrc;
+    delete netSrc;
+    delete pim;
+    delete rib;
+    shmDestroy(shmName, shm);
+
+    /* Finished. */
+    exit(0);
+} /* main() */
+
+
+/*********************************************************************
+*
+*	Private functions.
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* spxErrorHandler
+*	Callback function for errors reported by the SPx library.
+*
+* Params:
+*	errType, errCode	Error type and code,
+*	arg1 - arg4		Error values.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+static void spxErrorHandler(SPxErrorType errType, SPxErrorCode errCode,
+				int arg1, int arg2,
+				const char *arg3, const char *arg4)
+{
+    /* We simply report errors to stdout. */
+    printf("SPx Error #%d, args %d, %d, %s, %s.\n",
+		errCode, arg1, arg2,
+		(arg3 ? arg3 : "<none>"),
+		(arg4 ? arg4 : "<none>"));
+    return;
+} /* spxErrorHandler() */
+
+
+/*====================================================================
+*
+* handleBitmapUpdate
+*	Function called by the scan converter bitmap after it has been
+*	updated.
+*
+* Params:
+*	bitmap		Bitmap that was updated,
+*	changes		SPX_BITMAP_CHANGE_... flags,
+*	firstAzimuth,	Azimuth range of the update,
+*	endAzimuth
+*	box		Region of the bitmap that changed,
+*	userPtr		Shared memory header.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	A view, size or fade change invalidates the whole bitmap.
+*
+*===================================================================*/
+static void handleBitmapUpdate(SPxScDestBitmap *bitmap, UINT16 changes,
+				UINT16 firstAzimuth, UINT16 endAzimuth,
+				DirtyBox box, void *userPtr)
+{
+    SPxRenderShmHeader_t *shm = (SPxRenderShmHeader_t *)userPtr;
+    if( shm == NULL )
+    {
+	return;
+    }
+
+    if( changes & (SPX_BITMAP_CHANGE_SIZE | SPX_BITMAP_CHANGE_VIEW |
+		   SPX_BITMAP_CHANGE_FADE) )
+    {
+	shmAddRect(shm, 0, 0, (int)shm->width, (int)shm->height);
+    }
+    else if( (box.w > 0) && (box.h > 0) )
+    {
+	shmAddRect(shm, box.x, box.y, box.w, box.h);
+    }
+} /* handleBitmapUpdate() */
+
+
+/*====================================================================
+*
+* shmCreate
+*	Create and map the shared memory segment.
+*
+* Params:
+*	name		POSIX shared memory object name,
+*	width, height	Bitmap size in pixels.
+*
+* Returns:
+*	Pointer to the mapped header, or NULL on error.
+*
+* Notes
+*	Any stale segment of the same name is replaced.  Only its owner
+*	can read or write it, so the viewer must run as the same user.
+*	Not supported on Windows.
+*
+*===================================================================*/
+static SPxRenderShmHeader_t *shmCreate(const char *name,
+					unsigned int width,
+					unsigned int height)
+{
+#ifdef _WIN32
+    fprintf(stderr, "Shared memory not supported on this platform.\n");
+    return(NULL);
+#else
+    size_t stride = (size_t)width * SPX_RENDER_SHM_BYTES_PER_PIXEL;
+    size_t size = SPX_RENDER_SHM_HEADER_SIZE + (stride * height);
+
+    shm_unlink(name);
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if( fd < 0 )
+    {
+	perror("shm_open");
+	return(NULL);
+    }
+    if( ftruncate(fd, (off_t)size) != 0 )
+    {
+	perror("ftruncate");
+	close(fd);
+	shm_unlink(name);
+	return(NULL);
+    }
+    void *mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if( mem == MAP_FAILED )
+    {
+	perror("mmap");
+	shm_unlink(name);
+	return(NULL);
+    }
+    memset(mem, 0, size);
+
+    SPxRenderShmHeader_t *shm = (SPxRenderShmHeader_t *)mem;
+    shm->headerSize = SPX_RENDER_SHM_HEADER_SIZE;
+    shm->width = width;
+    shm->height = height;
+    shm->stride = (UINT32)stride;
+    shm->serverPid = (UINT32)getpid();
+    shm->version = SPX_RENDER_SHM_VERSION;
+
+    /* 헤더가 모두 채워진 뒤에 magic 을 써서 뷰어가 유효성을 판단하도록 함 */
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    shm->magic = SPX_RENDER_SHM_MAGIC;
+    return(shm);
+#endif
+} /* shmCreate() */
+
+
+/*====================================================================
+*
+* shmDestroy
+*	Mark the segment as finished, unmap and unlink it.
+*
+* Params:
+*	name		POSIX shared memory object name,
+*	shm		Mapped header.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	A viewer that still has it mapped keeps its mapping and sees
+*	serverPid go to zero.
+*
+*===================================================================*/
+static void shmDestroy(const char *name, SPxRenderShmHeader_t *shm)
+{
+#ifndef _WIN32
+    if( shm != NULL )
+    {
+	size_t size = shm->headerSize + ((size_t)shm->stride * shm->height);
+	shm->serverPid = 0;
+	munmap(shm, size);
+    }
+    shm_unlink(name);
+#endif
+} /* shmDestroy() */
+
+
+/*====================================================================
+*
+* shmAddRect
+*	Publish a dirty rectangle to the viewer.
+*
+* Params:
+*	shm		Mapped header,
+*	x, y, w, h	Rectangle in bitmap pixels.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Called from the scan converter thread and the main loop, so the
+*	sequence number is reserved atomically.  The viewer falls back
+*	to a full blit if it has missed more than the ring holds.
+*
+*===================================================================*/
+static void shmAddRect(SPxRenderShmHeader_t *shm, int x, int y, int w, int h)
+{
+    /* 비트맵 범위로 자르기 */
+    if( x < 0 ) { w += x; x = 0; }
+    if( y < 0 ) { h += y; y = 0; }
+    if( x + w > (int)shm->width ) { w = (int)shm->width - x; }
+    if( y + h > (int)shm->height ) { h = (int)shm->height - y; }
+    if( (w <= 0) || (h <= 0) )
+    {
+	return;
+    }
+
+    static SPxCriticalSection rectLock;
+    rectLock.Enter();
+    UINT32 seq = shm->rectSeq;
+    SPxRenderShmRect_t *rect = &shm->rects[seq % SPX_RENDER_SHM_NUM_RECTS];
+    rect->x = (UINT16)x;
+    rect->y = (UINT16)y;
+    rect->w = (UINT16)w;
+    rect->h = (UINT16)h;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    shm->rectSeq = seq + 1;
+    rectLock.Leave();
+} /* shmAddRect() */
+
+
+/*********************************************************************
+*
+*	Utility functions to handle init/shutdown per operating system.
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* osInit
+*	Function to perform operating system specific setup.
+*
+* Params:
+*	None
+*
+* Returns:
+*	SPx error code.
+*
+* Notes
+*
+*===================================================================*/
+static SPxErrorCode osInit(void)
+{
+#ifdef _WIN32
+    /* Install our tidy-up function. */
+    if( SetConsoleCtrlHandler((PHANDLER_ROUTINE)sigIntHandler, TRUE) == 0 )
+    {
+	printf("Fatal Error: Failed to install ctrl-c handler.\n");
+	return(SPX_ERR_SYSCALL);
+    }
+#else
+    /* Install our tidy-up function.  The viewer stops us with SIGTERM. */
+    signal(SIGINT, sigIntHandler);
+    signal(SIGTERM, sigIntHandler);
+#endif
+
+    /* Done. */
+    return(SPX_NO_ERROR);
+} /* osInit() */
+
+
+/*====================================================================
+*
+* sigIntHandler
+*	Handler function for SIGINT (i.e. Ctrl-C) and SIGTERM.
+*
+* Params:
+*	sig		Signal we are being called for.
+*
+* Returns:
+*	Nothing
+*
+* Notes:
+*	Tells the main loop to finish so we can clean up tidily etc.
+*
+*===================================================================*/
+#ifdef _WIN32
+static BOOL WINAPI sigIntHandler(DWORD sig)
+{
+    if( (sig == CTRL_C_EVENT) || (sig == CTRL_CLOSE_EVENT) )
+    {
+	printf("\nSIGINT received - exiting.\n");
+	MainLoopFinish = 1;
+	return(TRUE);
+    }
+    return(FALSE);
+} /* sigIntHandler() */
+#else
+static void sigIntHandler(int sig)
+{
+    printf("\nSignal %d received - exiting.\n", sig);
+    MainLoopFinish = 1;
+    return;
+} /* sigIntHandler() */
+#endif
+
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
@@ -0,0 +1,94 @@
+/*********************************************************************
+*
+* File: SPxRenderShm.h
+*
+* Purpose:
+*	Layout of the shared memory segment written by SPxRenderServer
+*	and read by the Python viewer (SPxRadarStream/render.py).
+*
+*	The segment starts with a fixed size header page followed by
+*	the 32-bit (BGRA) bitmap the scan converter renders into.
+*
+*	The server is the only writer of the bitmap, the dirty rectangle
+*	ring and the status fields.  The viewer is the only writer of the
+*	view request fields.  Each side publishes a change by writing the
+*	payload first and incrementing the matching sequence number last,
+*	so no lock is shared between the processes.
+*
+*	Any change to this structure must be mirrored in render.py and
+*	must bump SPX_RENDER_SHM_VERSION.
+*
+**********************************************************************/
+
+#ifndef _SPX_RENDER_SHM_H
+#define _SPX_RENDER_SHM_H
+
+/*
+ * Constants.
+ */
+/* Magic number and layout version ("SPXR"). */
+#define	SPX_RENDER_SHM_MAGIC		0x52585053
+#define	SPX_RENDER_SHM_VERSION		1
+
+/* Default shared memory object name. */
+#define	SPX_RENDER_SHM_DEFAULT_NAME	"/spxrender"
+
+/* Size of the header page, the bitmap starts at this offset. */
+#define	SPX_RENDER_SHM_HEADER_SIZE	4096
+
+/* Number of entries in the dirty rectangle ring (power of two). */
+#define	SPX_RENDER_SHM_NUM_RECTS	64
+
+/* Bytes per pixel of the bitmap. */
+#define	SPX_RENDER_SHM_BYTES_PER_PIXEL	4
+
+
+/*
+ * Types.
+ */
+/* One dirty rectangle, in bitmap pixels. */
+typedef struct SPxRenderShmRect_tag {
+    UINT16 x;
+    UINT16 y;
+    UINT16 w;
+    UINT16 h;
+} SPxRenderShmRect_t;
+
+/* Header at the start of the shared memory segment. */
+typedef struct SPxRenderShmHeader_tag {
+    /* Fixed at creation time. */
+    UINT32 magic;		/* SPX_RENDER_SHM_MAGIC */
+    UINT32 version;		/* SPX_RENDER_SHM_VERSION */
+    UINT32 headerSize;		/* Offset of bitmap from segment start */
+    UINT32 width;		/* Bitmap width in pixels */
+    UINT32 height;		/* Bitmap height in pixels */
+    UINT32 stride;		/* Bitmap stride in bytes */
+
+    /* Written by the server. */
+    volatile UINT32 serverPid;	/* Zero once the server has exited */
+    volatile UINT32 rectSeq;	/* Number of rects ever written to ring */
+    volatile REAL32 endRangeMetres;	/* Radar end range, 0 if unknown */
+    volatile UINT32 viewSeqApplied;	/* Last view request applied */
+
+    /* Written by the viewer. */
+    volatile UINT32 viewSeq;	/* Incremented after each view request */
+    volatile REAL32 viewX;	/* View centre relative to radar, metres */
+    volatile REAL32 viewY;
+    volatile REAL32 viewW;	/* View width/height, metres */
+    volatile REAL32 viewH;
+
+    UINT32 reserved[1];
+
+    /* Ring of dirty rectangles, entry (rectSeq - 1) % NUM_RECTS is
+     * the most recent one.
+     */
+    SPxRenderShmRect_t rects[SPX_RENDER_SHM_NUM_RECTS];
+} SPxRenderShmHeader_t;
+
+#endif /* _SPX_RENDER_SHM_H */
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
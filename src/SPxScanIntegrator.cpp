@@ -0,0 +1,431 @@
+/*********************************************************************
+*
+* File: SPxScanIntegrator.cpp
+*
+* Purpose:
+*	Scan-to-scan integration over a ring of polar grids (see
+*	SPxScanIntegrator.h).
+*
+**********************************************************************/
+
+/* Standard headers. */
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+
+/* Our own header. */
+#include "SPxScanIntegrator.h"
+
+/*
+ * Constants.
+ */
+#define	MAX_ROTATIONS	64	/* Keeps the sums within 16 bits */
+
+/* Bins skipped between two spokes up to this fraction of a turn are
+ * filled in with the later spoke, as in SPxViewerRaster.
+ */
+#define	MAX_GAP_DIVISOR	32
+
+
+/*********************************************************************
+*
+*	Public functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* SPxScanIntegrator::SPxScanIntegrator
+*	Constructor, defaults to "mean,4".
+*
+* Params:
+*	numAzis			Azimuth bins per turn,
+*	numGates		Range gates per bin.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+SPxScanIntegrator::SPxScanIntegrator(int numAzis, int numGates)
+    : m_numAzis((numAzis > 0) ? numAzis : 1),
+      m_numGates((numGates > 0) ? numGates : 1),
+      m_mode(MODE_MEAN), m_numRotations(4), m_minCount(1), m_level(0),
+      m_rotation(0), m_lastBin(-1)
+{
+    allocate();
+} /* SPxScanIntegrator::SPxScanIntegrator() */
+
+
+/*====================================================================
+*
+* SPxScanIntegrator::~SPxScanIntegrator
+*	Destructor.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+SPxScanIntegrator::~SPxScanIntegrator()
+{
+} /* SPxScanIntegrator::~SPxScanIntegrator() */
+
+
+/*====================================================================
+*
+* SPxScanIntegrator::SetParams
+*	Configure the integration.
+*
+* Params:
+*	args			"mean,<K>", "max,<K>" or
+*				"mofn,<K>,<M>,<level>".
+*
+* Returns:
+*	Zero on success, -1 if the string is invalid.
+*
+* Notes
+*
+*===================================================================*/
+int SPxScanIntegrator::SetParams(const char *args)
+{
+    std::vector<long> values;
+    std::string text = (args != NULL) ? args : "";
+    size_t comma = text.find(',');
+    std::string name = text.substr(0, comma);
+    while( comma != std::string::npos )
+    {
+	size_t start = comma + 1;
+	comma = text.find(',', start);
+	std::string field = text.substr(start, (comma == std::string::npos)
+					? std::string::npos : comma - start);
+	char *end = NULL;
+	long v = strtol(field.c_str(), &end, 10);
+	if( field.empty() || (*end != '\0') )
+	{
+	    return(-1);
+	}
+	values.push_back(v);
+    }
+
+    Mode mode;
+    size_t numValues;
+    if( name == "mean" )
+    {
+	mode = MODE_MEAN;
+	numValues = 1;
+    }
+    else if( name == "max" )
+    {
+	mode = MODE_MAX;
+	numValues = 1;
+    }
+    else if( name == "mofn" )
+    {
+	mode = MODE_MOFN;
+	numValues = 3;
+    }
+    else
+    {
+	return(-1);
+    }
+    if( (values.size() != numValues) || (values[0] < 1) || (values[0] > MAX_ROTATIONS) )
+    {
+	return(-1);
+    }
+    if( (mode == MODE_MOFN) && ((values[1] < 1) || (values[1] > values[0])
+				|| (values[2] < 0) || (values[2] > 255)) )
+    {
+	return(-1);
+    }
+
+    m_mode = mode;
+    m_numRotations = (int)values[0];
+    m_minCount = (mode == MODE_MOFN) ? (int)values[1] : 1;
+    m_level = (mode == MODE_MOFN) ? (int)values[2] : 0;
+    allocate();
+    return(0);
+} /* SPxScanIntegrator::SetParams() */
+
+
+/*====================================================================
+*
+* SPxScanIntegrator::GetMemoryBytes
+*	Report the memory held.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Bytes in the history ring plus the running state and output.
+*
+* Notes
+*	The ring is K x bins x gates; the rest is at most three bytes
+*	per cell whatever K is.
+*
+*===================================================================*/
+size_t SPxScanIntegrator::GetMemoryBytes(void) const
+{
+    return( m_ring.size() + (m_sums.size() * sizeof(uint16_t)) + m_counts.size()
+	    + m_output.size() + m_row.size()
+	    + (m_binRotation.size() * (sizeof(unsigned int) + 2)) );
+} /* SPxScanIntegrator::GetMemoryBytes() */
+
+
+/*====================================================================
+*
+* SPxScanIntegrator::UpdateSpoke
+*	Add a spoke to the current rotation.
+*
+* Params:
+*	azDegrees		Azimuth, degrees clockwise from north,
+*	samples			Samples, first at zero range,
+*	numSamples		Number of samples (resampled to the grid).
+*
+* Returns:
+*	Bin updated, or -1 if there was nothing to add.
+*
+* Notes
+*	Small gaps since the previous spoke are filled with this spoke.
+*
+*===================================================================*/
+int SPxScanIntegrator::UpdateSpoke(double azDegrees, const uint8_t *samples,
+				   int numSamples)
+{
+    if( (samples == NULL) || (numSamples <= 0) )
+    {
+	return(-1);
+    }
+
+    /* 최근접 리샘플링으로 격자 게이트 수에 맞춤 */
+    const uint8_t *row = samples;
+    if( numSamples != m_numGates )
+    {
+	for(int g = 0; g < m_numGates; g++)
+	{
+	    m_row[g] = samples[(int)(((int64_t)g * numSamples) / m_numGates)];
+	}
+	row = &m_row[0];
+    }
+
+    int bin = GetBin(azDegrees);
+    int first = bin;
+    if( m_lastBin >= 0 )
+    {
+	int gap = (bin - m_lastBin + m_numAzis) % m_numAzis;
+	if( (gap > 1) && (gap <= (m_numAzis / MAX_GAP_DIVISOR)) )
+	{
+	    first = (m_lastBin + 1) % m_numAzis;
+	}
+    }
+    for(int b = first; ; b = (b + 1) % m_numAzis)
+    {
+	/* 북쪽을 지나면 새 회전 (반 바퀴 이상 되돌아간 경우) */
+	if( (m_lastBin >= 0) && (b < m_lastBin) && ((m_lastBin - b) > (m_numAzis / 2)) )
+	{
+	    m_rotation++;
+	}
+	m_lastBin = b;
+	updateBin(b, row);
+	if( b == bin )
+	{
+	    break;
+	}
+    }
+    return(bin);
+} /* SPxScanIntegrator::UpdateSpoke() */
+
+
+/*====================================================================
+*
+* SPxScanIntegrator::Reset
+*	Forget all history.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+void SPxScanIntegrator::Reset(void)
+{
+    std::fill(m_binNext.begin(), m_binNext.end(), 0);
+    std::fill(m_binFill.begin(), m_binFill.end(), 0);
+    std::fill(m_binRotation.begin(), m_binRotation.end(), 0);
+    std::fill(m_sums.begin(), m_sums.end(), 0);
+    std::fill(m_counts.begin(), m_counts.end(), 0);
+    std::fill(m_output.begin(), m_output.end(), 0);
+    /* 0 번 회전은 "아직 쓰지 않음" 으로 사용 */
+    m_rotation = 1;
+    m_lastBin = -1;
+} /* SPxScanIntegrator::Reset() */
+
+
+/*====================================================================
+*
+* SPxScanIntegrator::GetBin
+*	Find the bin for an azimuth.
+*
+* Params:
+*	azDegrees		Azimuth, degrees clockwise from north.
+*
+* Returns:
+*	Bin, 0 to numAzis - 1.
+*
+* Notes
+*
+*===================================================================*/
+int SPxScanIntegrator::GetBin(double azDegrees) const
+{
+    double turns = azDegrees / 360.0;
+    turns -= floor(turns);
+    int bin = (int)(turns * m_numAzis);
+    return( (bin >= m_numAzis) ? (m_numAzis - 1) : bin );
+} /* SPxScanIntegrator::GetBin() */
+
+
+/*********************************************************************
+*
+*	Private functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* SPxScanIntegrator::allocate
+*	(Re)allocate the ring and running state for the current mode.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Only the running state the mode needs is kept.
+*
+*===================================================================*/
+void SPxScanIntegrator::allocate(void)
+{
+    size_t cells = (size_t)m_numAzis * m_numGates;
+    m_ring.assign(cells * m_numRotations, 0);
+    m_binNext.assign(m_numAzis, 0);
+    m_binFill.assign(m_numAzis, 0);
+    m_binRotation.assign(m_numAzis, 0);
+    m_sums.assign((m_mode == MODE_MEAN) ? cells : 0, 0);
+    m_counts.assign((m_mode == MODE_MOFN) ? cells : 0, 0);
+    m_output.assign(cells, 0);
+    m_row.assign(m_numGates, 0);
+    Reset();
+} /* SPxScanIntegrator::allocate() */
+
+
+/*====================================================================
+*
+* SPxScanIntegrator::updateBin
+*	Store a row in one bin and update that bin's output.
+*
+* Params:
+*	bin			Bin to update,
+*	row			numGates samples.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Costs O(gates) for mean and M-of-N and O(K x gates) for max.
+*
+*===================================================================*/
+void SPxScanIntegrator::updateBin(int bin, const uint8_t *row)
+{
+    size_t cells = (size_t)m_numAzis * m_numGates;
+    size_t offset = (size_t)bin * m_numGates;
+    int slot;
+    int replace;	/* Non-zero if the slot holds a row to take out */
+
+    if( (m_binRotation[bin] == m_rotation) && (m_binFill[bin] > 0) )
+    {
+	/* 같은 회전에서 다시 들어온 스포크는 그 회전의 값을 대체 */
+	slot = (m_binNext[bin] + m_numRotations - 1) % m_numRotations;
+	replace = 1;
+    }
+    else
+    {
+	slot = m_binNext[bin];
+	replace = (m_binFill[bin] == m_numRotations);
+	m_binNext[bin] = (uint8_t)((slot + 1) % m_numRotations);
+	if( !replace )
+	{
+	    m_binFill[bin]++;
+	}
+	m_binRotation[bin] = m_rotation;
+    }
+
+    uint8_t *old = &m_ring[(slot * cells) + offset];
+    uint8_t *out = &m_output[offset];
+    int fill = m_binFill[bin];
+
+    switch(m_mode)
+    {
+	case MODE_MEAN:
+	{
+	    uint16_t *sums = &m_sums[offset];
+	    /* floor(sum / fill) 를 64비트 역수 곱으로 (sum < 2^16 이면 정확) */
+	    uint64_t recip = ((1ULL << 32) + fill - 1) / fill;
+	    for(int g = 0; g < m_numGates; g++)
+	    {
+		unsigned int sum = sums[g] + row[g] - (replace ? old[g] : 0);
+		sums[g] = (uint16_t)sum;
+		out[g] = (uint8_t)((sum * recip) >> 32);
+	    }
+	    memcpy(old, row, m_numGates);
+	    break;
+	}
+
+	case MODE_MAX:
+	{
+	    memcpy(old, row, m_numGates);
+	    memcpy(out, &m_ring[offset], m_numGates);
+	    for(int s = 1; s < fill; s++)
+	    {
+		const uint8_t *p = &m_ring[(s * cells) + offset];
+		for(int g = 0; g < m_numGates; g++)
+		{
+		    out[g] = (p[g] > out[g]) ? p[g] : out[g];
+		}
+	    }
+	    break;
+	}
+
+	case MODE_MOFN:
+	{
+	    uint8_t *counts = &m_counts[offset];
+	    for(int g = 0; g < m_numGates; g++)
+	    {
+		int count = counts[g] + (row[g] >= m_level)
+		    - (replace ? (old[g] >= m_level) : 0);
+		counts[g] = (uint8_t)count;
+		out[g] = (count >= m_minCount) ? 255 : 0;
+	    }
+	    memcpy(old, row, m_numGates);
+	    break;
+	}
+    }
+} /* SPxScanIntegrator::updateBin() */
+
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
@@ -0,0 +1,113 @@
+/*********************************************************************
+*
+* File: SPxScanIntegrator.h
+*
+* Purpose:
+*	Scan-to-scan integration of 8-bit spokes over the last K
+*	rotations.
+*
+*	Spokes are resampled onto a fixed polar grid (azimuth bins x
+*	range gates) and kept in a ring of K grids in one contiguous
+*	block, so the history costs exactly K x bins x gates bytes.
+*	Each time a bin is written the integrated value of that bin
+*	alone is brought up to date, from running sums or counts, so
+*	whole frames are never recomputed.
+*
+*	The parameter string is
+*
+*	  mean,<K>		Mean of the last K rotations.
+*	  max,<K>		Maximum of the last K rotations.
+*	  mofn,<K>,<M>,<level>	255 where at least M of the last K
+*				rotations reached level, else 0.
+*
+*	A new rotation starts when the azimuth passes north; a bin
+*	written again in the same rotation replaces that rotation's
+*	entry.  Until a bin has K rotations the integration uses the
+*	ones it has.
+*
+*	The integrator does not depend on the SPx library.
+*
+**********************************************************************/
+
+#ifndef _SPX_SCAN_INTEGRATOR_H
+#define _SPX_SCAN_INTEGRATOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+class SPxScanIntegrator
+{
+public:
+    /* Integration types. */
+    enum Mode
+    {
+	MODE_MEAN,
+	MODE_MAX,
+	MODE_MOFN
+    };
+
+    /* Constructor/destructor. */
+    SPxScanIntegrator(int numAzis, int numGates);
+    ~SPxScanIntegrator();
+
+    /* Configuration.  Returns zero on success, -1 on a bad string
+     * (the previous settings are kept).  Clears the history.
+     */
+    int SetParams(const char *args);
+    Mode GetMode(void) const { return m_mode; }
+    int GetNumRotations(void) const { return m_numRotations; }
+    int GetNumAzis(void) const { return m_numAzis; }
+    int GetNumGates(void) const { return m_numGates; }
+    unsigned int GetRotationCount(void) const { return m_rotation; }
+    size_t GetMemoryBytes(void) const;
+
+    /* Add a spoke, returning the bin it went into. */
+    int UpdateSpoke(double azDegrees, const uint8_t *samples, int numSamples);
+    void Reset(void);
+
+    /* Integrated output (bins x gates, bin 0 at north). */
+    int GetBin(double azDegrees) const;
+    const uint8_t *GetFrame(void) const { return &m_output[0]; }
+    const uint8_t *GetRow(int bin) const
+    {
+	return &m_output[(size_t)bin * m_numGates];
+    }
+
+private:
+    int m_numAzis;
+    int m_numGates;
+    Mode m_mode;
+    int m_numRotations;		/* K */
+    int m_minCount;		/* M */
+    int m_level;
+
+    /* Ring of K polar grids, [rotation][bin][gate]. */
+    std::vector<uint8_t> m_ring;
+
+    /* Per-bin state. */
+    std::vector<uint8_t> m_binNext;	/* Next ring slot */
+    std::vector<uint8_t> m_binFill;	/* Rotations held */
+    std::vector<unsigned int> m_binRotation; /* Rotation last written */
+
+    /* Running state for mean (sums) and M-of-N (counts). */
+    std::vector<uint16_t> m_sums;
+    std::vector<uint8_t> m_counts;
+    std::vector<uint8_t> m_output;
+    std::vector<uint8_t> m_row;
+
+    unsigned int m_rotation;
+    int m_lastBin;
+
+    /* Private functions. */
+    void allocate(void);
+    void updateBin(int bin, const uint8_t *row);
+};
+
+#endif /* _SPX_SCAN_INTEGRATOR_H */
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
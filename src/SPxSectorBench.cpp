@@ -0,0 +1,521 @@
+/*********************************************************************
+*
+* File: SPxSectorBench.cpp
+*
+* Purpose:
+*	Scaling check of the sector-parallel polar frame processing:
+*	the adaptive clutter map (SPxClutterMap) followed by the filter
+*	chain (SPxFilterChain, including CFAR) on a synthetic frame,
+*	split over 1 to N threads of an SPxWorkPool.
+*
+*	Each thread count starts from a fresh map and chain and runs
+*	the same frames, optionally in sector batches as the viewer
+*	receives them.  The output frames and the learnt background
+*	are compared with the single-threaded run; any difference is
+*	counted as a mismatch.
+*
+*	With -s the program instead runs a serial and a pooled map and
+*	chain side by side over many fresh frames, back to back, and
+*	compares every frame.  With small frames and -b batches this
+*	puts tens of thousands of batches through SPxWorkPool::Run(),
+*	which the few frames of a measurement do not.  Either check
+*	only exercises the parallel path on more than one core.
+*
+*	The program does not need the SPx library.
+*
+*	Run the program with "-?" as the command line option to get a help
+*	message.
+*
+**********************************************************************/
+
+/* Standard headers. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+/* Our own headers. */
+#include "SPxClutterMap.h"
+#include "SPxFilterChain.h"
+#include "SPxWorkPool.h"
+
+/*
+ * Constants.
+ */
+#define	DEFAULT_FILTER	"stc:400,30;median:3;cfar:os,2,16,3,1;thresh:40"
+#define	USAGE "Usage:\n\tSPxSectorBench [options]\n"			\
+		"\nOptions:\n"						\
+		"\t-a <spokes>\tSet spokes per frame (default 4096)\n"	\
+		"\t-b <spokes>\tProcess in batches of this many spokes\n" \
+		"\t\t\t(default 0, whole frames)\n"			\
+		"\t-c <args>\tSet clutter map args (default \"sub,4,10\",\n" \
+		"\t\t\t\"\" for none)\n"				\
+		"\t-f <params>\tSet filter chain (default\n"		\
+		"\t\t\t\"" DEFAULT_FILTER "\")\n" \
+		"\t-g <gates>\tSet range gates per spoke (default 1024)\n" \
+		"\t-n <frames>\tSet frames per measurement (default 5)\n" \
+		"\t-s <frames>\tCompare every frame of this many against\n" \
+		"\t\t\tthe serial code instead of measuring\n"		\
+		"\t-t <threads>\tSet the most threads (default: cores)\n" \
+		"\t-?\t\tPrint usage information.\n\n"
+
+/* Result of one thread count. */
+struct Run
+{
+    double clutterMs;		/* Per frame */
+    double filterMs;
+    unsigned long long numSteals;
+    std::vector<uint8_t> output;	/* Last frame */
+    std::vector<uint16_t> map;		/* Background after the last frame */
+};
+
+/*
+ * Private function prototypes.
+ */
+static double nowSecs(void);
+static void makeSpoke(uint8_t *samples, int numSamples, unsigned int *seed);
+static int runThreads(unsigned int numThreads, const std::vector<uint8_t> &input,
+		      const std::vector<double> &azimuths, int numSpokes,
+		      int numGates, int batch, int numFrames,
+		      const char *clutterArgs, const char *filterParams, Run *run);
+static long long countDiffs(const Run &a, const Run &b);
+static int soakThreads(unsigned int numThreads, int numSpokes, int numGates,
+		       int batch, int numFrames, const char *clutterArgs,
+		       const char *filterParams);
+
+
+/*********************************************************************
+*
+*	Public functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* main
+*	Main entry point for the program.
+*
+* Params:
+*	argc, argv		Command line arguments.
+*
+* Returns:
+*	Zero if every thread count matched one thread, -1 otherwise.
+*
+* Notes
+*
+*===================================================================*/
+int main(int argc, char **argv)
+{
+    int c;
+    int numSpokes = 4096;
+    int numGates = 1024;
+    int numFrames = 5;
+    int soakFrames = 0;
+    int batch = 0;
+    int maxThreads = (int)SPxWorkPool::GetNumCores();
+    const char *clutterArgs = "sub,4,10";
+    const char *filterParams = DEFAULT_FILTER;
+
+    /* Process any command line arguments.  */
+    opterr = 0;
+    while( (c = getopt(argc, argv, "a:b:c:f:g:n:s:t:?")) != -1 )
+    {
+	switch(c)
+	{
+	    case 'a':	numSpokes = strtol(optarg, NULL, 0);	break;
+	    case 'b':	batch = strtol(optarg, NULL, 0);	break;
+	    case 'c':	clutterArgs = optarg;			break;
+	    case 'f':	filterParams = optarg;			break;
+	    case 'g':	numGates = strtol(optarg, NULL, 0);	break;
+	    case 'n':	numFrames = strtol(optarg, NULL, 0);	break;
+	    case 's':	soakFrames = strtol(optarg, NULL, 0);	break;
+	    case 't':	maxThreads = strtol(optarg, NULL, 0);	break;
+	    case '?':	/* fall through */
+	    default:
+		fprintf(stderr, "\n%s", USAGE);
+		exit(-1);
+	}
+    } /* end of for each option */
+
+    if( (numSpokes <= 0) || (numGates <= 0) || (numFrames <= 0)
+	|| (soakFrames < 0) || (batch < 0) || (maxThreads <= 0) )
+    {
+	fprintf(stderr, "Invalid parameters.\n\n%s", USAGE);
+	exit(-1);
+    }
+    if( (batch == 0) || (batch > numSpokes) )
+    {
+	batch = numSpokes;
+    }
+
+    /* 1, 2, 4, ... 스레드와 최대 스레드 수 */
+    std::vector<unsigned int> counts;
+    for(int t = 1; t < maxThreads; t *= 2)
+    {
+	counts.push_back((unsigned int)t);
+    }
+    counts.push_back((unsigned int)maxThreads);
+
+    if( soakFrames > 0 )
+    {
+	printf("SPxSectorBench: %d frames of %d spokes x %d gates in "
+	       "batches of %d back to back, %u cores\n", soakFrames,
+	       numSpokes, numGates, batch, SPxWorkPool::GetNumCores());
+	printf("clutter \"%s\", filter \"%s\"\n\n", clutterArgs, filterParams);
+	if( counts.size() == 1 )
+	{
+	    printf("Only one thread: nothing to compare (use -t).\n");
+	    return(0);
+	}
+	printf("threads | pool calls |     secs |   steals  frames mismatched\n");
+	int badFrames = 0;
+	for(size_t i = 0; i < counts.size(); i++)
+	{
+	    if( counts[i] == 1 )
+	    {
+		continue;
+	    }
+	    int bad = soakThreads(counts[i], numSpokes, numGates, batch,
+				  soakFrames, clutterArgs, filterParams);
+	    if( bad < 0 )
+	    {
+		exit(-1);
+	    }
+	    badFrames += bad;
+	}
+	printf("\n%s\n", (badFrames == 0) ? "Every frame matches one thread."
+	       : "MISMATCHES against one thread.");
+	return( (badFrames == 0) ? 0 : -1 );
+    }
+
+    /* 합성 극좌표 프레임과 스포크 방위 */
+    unsigned int seed = 12345;
+    std::vector<uint8_t> input((size_t)numSpokes * numGates);
+    std::vector<double> azimuths(numSpokes);
+    for(int a = 0; a < numSpokes; a++)
+    {
+	makeSpoke(&input[(size_t)a * numGates], numGates, &seed);
+	azimuths[a] = (a * 360.0) / numSpokes;
+    }
+
+    printf("SPxSectorBench: %d spokes x %d gates in batches of %d, "
+	   "%d frames per measurement, simd = %s, %u cores\n",
+	   numSpokes, numGates, batch, numFrames, SPxFilterChain::GetSimdName(),
+	   SPxWorkPool::GetNumCores());
+    printf("clutter \"%s\", filter \"%s\"\n\n", clutterArgs, filterParams);
+    printf("threads | clutter ms | filter ms | total ms  speedup |   steals  mismatches\n");
+
+    long long totalDiffs = 0;
+    Run single;
+    for(size_t i = 0; i < counts.size(); i++)
+    {
+	Run run;
+	if( runThreads(counts[i], input, azimuths, numSpokes, numGates, batch,
+		       numFrames, clutterArgs, filterParams, &run) != 0 )
+	{
+	    exit(-1);
+	}
+	if( i == 0 )
+	{
+	    single = run;
+	}
+	long long diffs = countDiffs(run, single);
+	double total = run.clutterMs + run.filterMs;
+	double singleTotal = single.clutterMs + single.filterMs;
+	printf("%7u | %10.2f | %9.2f | %8.2f %7.2fx | %8llu  %10lld\n",
+	       counts[i], run.clutterMs, run.filterMs, total,
+	       (total > 0.0) ? (singleTotal / total) : 0.0, run.numSteals, diffs);
+	totalDiffs += diffs;
+    }
+
+    printf("\n%s\n", (totalDiffs == 0) ? "All thread counts match one thread."
+	   : "MISMATCHES against one thread.");
+    return( (totalDiffs == 0) ? 0 : -1 );
+} /* main() */
+
+
+/*********************************************************************
+*
+*	Private functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* nowSecs
+*	Get a monotonic time in seconds.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Time in seconds.
+*
+* Notes
+*
+*===================================================================*/
+static double nowSecs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return(ts.tv_sec + (ts.tv_nsec * 1e-9));
+} /* nowSecs() */
+
+
+/*====================================================================
+*
+* makeSpoke
+*	Generate a spoke of noise with clutter and a few targets.
+*
+* Params:
+*	samples			Buffer to fill,
+*	numSamples		Number of samples,
+*	seed			Random number state.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Deterministic, so runs are comparable.
+*
+*===================================================================*/
+static void makeSpoke(uint8_t *samples, int numSamples, unsigned int *seed)
+{
+    for(int g = 0; g < numSamples; g++)
+    {
+	*seed = (*seed * 1103515245u) + 12345u;
+	unsigned int noise = (*seed >> 16) & 0x3F;
+	/* 근거리 클러터와 드문 표적 */
+	unsigned int clutter = (g < numSamples / 8) ? (200 - (g * 160 / (numSamples / 8 + 1))) : 0;
+	unsigned int target = (((*seed >> 8) & 0xFF) == 0) ? 160 : 0;
+	unsigned int v = noise + clutter + target;
+	samples[g] = (uint8_t)((v > 255) ? 255 : v);
+    }
+} /* makeSpoke() */
+
+
+/*====================================================================
+*
+* runThreads
+*	Measure one thread count.
+*
+* Params:
+*	numThreads		Threads, 1 for the serial code,
+*	input, azimuths		Frame and spoke azimuths,
+*	numSpokes, numGates	Frame size,
+*	batch			Spokes per call,
+*	numFrames		Frames to process,
+*	clutterArgs		Clutter map args, "" for none,
+*	filterParams		Filter chain,
+*	run			Filled in.
+*
+* Returns:
+*	Zero on success, -1 on bad args.
+*
+* Notes
+*	Only the processing is timed, not restoring the input.
+*
+*===================================================================*/
+static int runThreads(unsigned int numThreads, const std::vector<uint8_t> &input,
+		      const std::vector<double> &azimuths, int numSpokes,
+		      int numGates, int batch, int numFrames,
+		      const char *clutterArgs, const char *filterParams, Run *run)
+{
+    SPxWorkPool *pool = (numThreads > 1) ? new SPxWorkPool(numThreads) : NULL;
+    SPxClutterMap clutter(numSpokes, numGates);
+    SPxFilterChain chain;
+    int useClutter = (clutterArgs[0] != '\0');
+    if( useClutter && (clutter.SetParams(clutterArgs) != 0) )
+    {
+	fprintf(stderr, "Invalid clutter map args '%s'.\n", clutterArgs);
+	delete pool;
+	return(-1);
+    }
+    if( chain.SetParams(filterParams) != 0 )
+    {
+	fprintf(stderr, "%s.\n", chain.GetError());
+	delete pool;
+	return(-1);
+    }
+
+    double clutterSecs = 0.0;
+    double filterSecs = 0.0;
+    run->output.resize(input.size());
+    for(int f = 0; f < numFrames; f++)
+    {
+	memcpy(&run->output[0], &input[0], input.size());
+	for(int first = 0; first < numSpokes; first += batch)
+	{
+	    int num = ((numSpokes - first) < batch) ? (numSpokes - first) : batch;
+	    uint8_t *spokes = &run->output[(size_t)first * numGates];
+	    double start = nowSecs();
+	    if( useClutter )
+	    {
+		clutter.ApplyFrame(&azimuths[first], spokes, num, numGates,
+				   numGates, pool);
+	    }
+	    double mid = nowSecs();
+	    chain.ApplyFrame(spokes, num, numGates, numGates, &azimuths[first], pool);
+	    filterSecs += nowSecs() - mid;
+	    clutterSecs += mid - start;
+	}
+    }
+
+    run->clutterMs = clutterSecs * 1000.0 / numFrames;
+    run->filterMs = filterSecs * 1000.0 / numFrames;
+    run->numSteals = (pool != NULL) ? pool->GetNumSteals() : 0;
+    const uint16_t *map = clutter.GetMap();
+    run->map.assign(map, map + ((size_t)numSpokes * numGates));
+    delete pool;
+    return(0);
+} /* runThreads() */
+
+
+/*====================================================================
+*
+* soakThreads
+*	Compare a thread count with the serial code on every frame.
+*
+* Params:
+*	numThreads		Threads of the pool,
+*	numSpokes, numGates	Frame size,
+*	batch			Spokes per call,
+*	numFrames		Frames to process,
+*	clutterArgs		Clutter map args, "" for none,
+*	filterParams		Filter chain.
+*
+* Returns:
+*	Number of frames that differ, or -1 on bad args.
+*
+* Notes
+*	Each frame is new noise, and both sides keep their clutter map
+*	and filter state across frames, so a task run twice, lost, or
+*	run with another batch's arguments shows up as a difference.
+*
+*===================================================================*/
+static int soakThreads(unsigned int numThreads, int numSpokes, int numGates,
+		       int batch, int numFrames, const char *clutterArgs,
+		       const char *filterParams)
+{
+    SPxWorkPool pool(numThreads);
+    SPxClutterMap serialClutter(numSpokes, numGates);
+    SPxClutterMap poolClutter(numSpokes, numGates);
+    SPxFilterChain serialChain;
+    SPxFilterChain poolChain;
+    SPxClutterMap *clutter[2] = { &serialClutter, &poolClutter };
+    SPxFilterChain *chain[2] = { &serialChain, &poolChain };
+    int useClutter = (clutterArgs[0] != '\0');
+    for(int side = 0; side < 2; side++)
+    {
+	if( useClutter && (clutter[side]->SetParams(clutterArgs) != 0) )
+	{
+	    fprintf(stderr, "Invalid clutter map args '%s'.\n", clutterArgs);
+	    return(-1);
+	}
+	if( chain[side]->SetParams(filterParams) != 0 )
+	{
+	    fprintf(stderr, "%s.\n", chain[side]->GetError());
+	    return(-1);
+	}
+    }
+
+    size_t size = (size_t)numSpokes * numGates;
+    std::vector<uint8_t> frames[2];
+    frames[0].resize(size);
+    frames[1].resize(size);
+    std::vector<double> azimuths(numSpokes);
+    for(int a = 0; a < numSpokes; a++)
+    {
+	azimuths[a] = (a * 360.0) / numSpokes;
+    }
+
+    unsigned int seed = 12345;
+    unsigned long long numCalls = 0;
+    int badFrames = 0;
+    double start = nowSecs();
+    for(int f = 0; f < numFrames; f++)
+    {
+	for(int a = 0; a < numSpokes; a++)
+	{
+	    makeSpoke(&frames[0][(size_t)a * numGates], numGates, &seed);
+	}
+	frames[1] = frames[0];
+	for(int first = 0; first < numSpokes; first += batch)
+	{
+	    int num = ((numSpokes - first) < batch) ? (numSpokes - first) : batch;
+	    for(int side = 0; side < 2; side++)
+	    {
+		/* 0 은 직렬, 1 은 작업 풀 */
+		SPxWorkPool *p = (side == 0) ? NULL : &pool;
+		uint8_t *spokes = &frames[side][(size_t)first * numGates];
+		if( useClutter )
+		{
+		    clutter[side]->ApplyFrame(&azimuths[first], spokes, num,
+					     numGates, numGates, p);
+		}
+		chain[side]->ApplyFrame(spokes, num, numGates, numGates,
+				       &azimuths[first], p);
+	    }
+	    numCalls += 1 + useClutter;
+	}
+
+	int same = (frames[0] == frames[1]);
+	if( same && useClutter )
+	{
+	    same = (memcmp(serialClutter.GetMap(), poolClutter.GetMap(),
+			   size * sizeof(uint16_t)) == 0);
+	}
+	if( !same )
+	{
+	    if( badFrames == 0 )
+	    {
+		printf("%u threads: frame %d differs\n", numThreads, f);
+	    }
+	    badFrames++;
+	}
+    }
+
+    printf("%7u | %10llu | %8.2f | %8llu  %10d of %d\n", numThreads,
+	   numCalls, nowSecs() - start, pool.GetNumSteals(), badFrames,
+	   numFrames);
+    return(badFrames);
+} /* soakThreads() */
+
+
+/*====================================================================
+*
+* countDiffs
+*	Count the cells where two runs differ.
+*
+* Params:
+*	a, b			Runs to compare.
+*
+* Returns:
+*	Number of differing output samples and background cells.
+*
+* Notes
+*
+*===================================================================*/
+static long long countDiffs(const Run &a, const Run &b)
+{
+    long long diffs = 0;
+    for(size_t i = 0; i < a.output.size(); i++)
+    {
+	diffs += (a.output[i] != b.output[i]);
+    }
+    for(size_t i = 0; i < a.map.size(); i++)
+    {
+	diffs += (a.map[i] != b.map[i]);
+    }
+    return(diffs);
+} /* countDiffs() */
+
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
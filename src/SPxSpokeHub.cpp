@@ -0,0 +1,1291 @@
+/*********************************************************************
+*
+* File: SPxSpokeHub.cpp
+*
+* Purpose:
+*	Local fan-out of received spokes to subscribers (see
+*	SPxSpokeHub.h).
+*
+**********************************************************************/
+
+/* Standard headers. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+/* Our own headers. */
+#include "SPxSpokeHub.h"
+#include "SPxTimeShift.h"
+
+/*
+ * Constants.
+ */
+/* Encoded bytes queued per subscriber before the ring is read again. */
+#define	PENDING_BYTES		(256 * 1024)
+
+/* Longest request line. */
+#define	MAX_REQUEST		256
+
+/* Poll timeout, so the thread sees the stop flag, and while any
+ * subscriber is time-shifted, so its playback keeps time.
+ */
+#define	POLL_TIMEOUT_MSECS	100
+#define	PLAYBACK_POLL_MSECS	10
+
+/* Playback speeds allowed. */
+#define	MIN_PLAYBACK_SPEED	0.1
+#define	MAX_PLAYBACK_SPEED	100.0
+
+/*
+ * Types.
+ */
+/* A subscriber's time-shifted playback: spokes are sent until the
+ * store's time reaches playMs plus the time since startUsecs (times
+ * speed).
+ */
+struct SPxSpokeHub::Playback
+{
+    SPxTimeShift::Cursor cursor;
+    int64_t playMs;			/* Time sought */
+    int64_t startUsecs;			/* When sought */
+    double speed;
+    int64_t seekUsecs;			/* Until the first spoke is queued */
+};
+
+/*
+ * Private function prototypes.
+ */
+static int64_t nowUsecs(void);
+
+
+/*********************************************************************
+*
+*	Public functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* SPxSpokeHub::SPxSpokeHub
+*	Constructor.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+SPxSpokeHub::SPxSpokeHub(void)
+    : m_listenFd(-1),
+      m_wakePending(0),
+      m_stop(0),
+      m_mask(0),
+      m_head(0),
+      m_nextId(0),
+      m_markGeneration(0),
+      m_timeShift(NULL),
+      m_shiftCursor(0)
+{
+    m_wakeFds[0] = -1;
+    m_wakeFds[1] = -1;
+} /* SPxSpokeHub::SPxSpokeHub() */
+
+
+/*====================================================================
+*
+* SPxSpokeHub::~SPxSpokeHub
+*	Destructor, disconnecting the subscribers.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+SPxSpokeHub::~SPxSpokeHub()
+{
+    m_stop = 1;
+    if( m_thread.joinable() )
+    {
+	m_thread.join();
+    }
+#ifndef _WIN32
+    while( !m_subs.empty() )
+    {
+	closeSubscriber(m_subs.size() - 1);
+    }
+    if( m_listenFd >= 0 )
+    {
+	close(m_listenFd);
+	unlink(m_path.c_str());
+    }
+    for(int i = 0; i < 2; i++)
+    {
+	if( m_wakeFds[i] >= 0 )
+	{
+	    close(m_wakeFds[i]);
+	}
+    }
+#endif
+    delete m_timeShift;
+} /* SPxSpokeHub::~SPxSpokeHub() */
+
+
+/*====================================================================
+*
+* SPxSpokeHub::Create
+*	Listen for subscribers and start the hub thread.
+*
+* Params:
+*	path			Unix domain socket path,
+*	ringSpokes		Spokes kept in the ring (rounded up to a
+*				power of two).
+*
+* Returns:
+*	Zero on success, -1 on error (see GetError()).
+*
+* Notes
+*	An existing socket at the path is removed first; the socket is
+*	removed again by the destructor.
+*
+*===================================================================*/
+int SPxSpokeHub::Create(const char *path, unsigned int ringSpokes)
+{
+#ifdef _WIN32
+    m_error = "spoke hub not supported on this platform";
+    return(-1);
+#else
+    if( m_listenFd >= 0 )
+    {
+	m_error = "hub already created";
+	return(-1);
+    }
+    struct sockaddr_un sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sun_family = AF_UNIX;
+    if( (path == NULL) || (path[0] == '\0')
+	|| (strlen(path) >= sizeof(sa.sun_path)) )
+    {
+	m_error = "invalid hub socket path";
+	return(-1);
+    }
+    strcpy(sa.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if( fd < 0 )
+    {
+	m_error = std::string("socket: ") + strerror(errno);
+	return(-1);
+    }
+    unlink(path);
+    if( (bind(fd, (struct sockaddr *)&sa, sizeof(sa)) != 0)
+	|| (listen(fd, 16) != 0) )
+    {
+	m_error = std::string("cannot listen on '") + path + "': "
+	    + strerror(errno);
+	close(fd);
+	return(-1);
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    if( pipe(m_wakeFds) != 0 )
+    {
+	m_error = std::string("pipe: ") + strerror(errno);
+	close(fd);
+	unlink(path);
+	return(-1);
+    }
+    fcntl(m_wakeFds[0], F_SETFL, fcntl(m_wakeFds[0], F_GETFL) | O_NONBLOCK);
+    fcntl(m_wakeFds[1], F_SETFL, fcntl(m_wakeFds[1], F_GETFL) | O_NONBLOCK);
+    m_listenFd = fd;
+    m_path = path;
+
+    /* 순환 버퍼 크기는 2의 거듭제곱 (시퀀스 번호 래핑과 맞추기 위해) */
+    unsigned int size = 64;
+    while( (size < ringSpokes) && (size < (1u << 20)) )
+    {
+	size <<= 1;
+    }
+    m_ring.resize(size);
+    m_mask = size - 1;
+
+    m_thread = std::thread(&SPxSpokeHub::hubThread, this);
+    return(0);
+#endif
+} /* SPxSpokeHub::Create() */
+
+
+/*====================================================================
+*
+* SPxSpokeHub::SetTimeShift
+*	Keep a time-shift store for subscribers to rewind.
+*
+* Params:
+*	spec			"<minutes>[,option...]"
+*				(see SPxTimeShift.h).
+*
+* Returns:
+*	Zero on success, -1 on error (see GetError()).
+*
+* Notes
+*	Must be called before Create().  The hub thread adds the spokes
+*	from the ring, so Publish() costs no more.
+*
+*===================================================================*/
+int SPxSpokeHub::SetTimeShift(const char *spec)
+{
+    if( (m_timeShift != NULL) || m_thread.joinable() )
+    {
+	m_error = "time-shift store must be set once, before the hub starts";
+	return(-1);
+    }
+    m_timeShift = new SPxTimeShift();
+    if( m_timeShift->Create(spec) != 0 )
+    {
+	m_error = m_timeShift->GetError();
+	delete m_timeShift;
+	m_timeShift = NULL;
+	return(-1);
+    }
+    return(0);
+} /* SPxSpokeHub::SetTimeShift() */
+
+
+/*====================================================================
+*
+* SPxSpokeHub::Prefault
+*	Allocate and fault in the ring's sample buffers.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Each slot gets SPX_SPOKE_HUB_MAX_SAMPLES of capacity, zeroed
+*	so its pages are present; Publish() then only resizes within it.
+*
+*===================================================================*/
+void SPxSpokeHub::Prefault(void)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for(size_t i = 0; i < m_ring.size(); i++)
+    {
+	std::vector<unsigned char> *samples = &m_ring[i].samples;
+	size_t n = samples->size();
+	samples->resize(SPX_SPOKE_HUB_MAX_SAMPLES);
+	samples->resize(n);
+    }
+} /* SPxSpokeHub::Prefault() */
+
+
+/*====================================================================
+*
+* SPxSpokeHub::Publish
+*	Add a spoke to the ring.
+*
+* Params:
+*	channel			Source channel,
+*	azimuth			65536 per turn,
+*	startRange, endRange	Range of the first and last sample,
+*	timeMs			Receive time, ms since the epoch,
+*	data, numSamples	Samples,
+*	bytesPerSample		1 or 2.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Called on the receive threads; only copies the spoke and wakes
+*	the hub thread.  Samples beyond SPX_SPOKE_HUB_MAX_SAMPLES are
+*	dropped.
+*
+*===================================================================*/
+void SPxSpokeHub::Publish(unsigned int channel, uint16_t azimuth,
+			  float startRange, float endRange, int64_t timeMs,
+			  const unsigned char *data, unsigned int numSamples,
+			  unsigned int bytesPerSample)
+{
+    if( m_ring.empty() || ((bytesPerSample != 1) && (bytesPerSample != 2)) )
+    {
+	return;
+    }
+    unsigned int n = numSamples;
+    if( n > SPX_SPOKE_HUB_MAX_SAMPLES )
+    {
+	endRange = startRange + (endRange - startRange)
+	    * (float)SPX_SPOKE_HUB_MAX_SAMPLES / (float)n;
+	n = SPX_SPOKE_HUB_MAX_SAMPLES;
+    }
+
+    {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	Slot *slot = &m_ring[m_head & m_mask];
+	SPxSpokeHubRecord *rec = &slot->rec;
+	rec->magic = SPX_SPOKE_HUB_MAGIC;
+	rec->seq = m_head;
+	rec->channel = (uint16_t)channel;
+	rec->azimuth = azimuth;
+	rec->numSamples = (uint16_t)n;
+	rec->rangeStep = 1;
+	rec->startRange = startRange;
+	rec->endRange = endRange;
+	rec->timeMs = timeMs;
+	rec->numCoalesced = 0;
+	rec->lag = 0;
+	slot->samples.resize(n);
+	if( n == 0 )
+	{
+	    /* 빈 스포크도 방위 갱신으로 전달 */
+	}
+	else if( bytesPerSample == 1 )
+	{
+	    memcpy(&slot->samples[0], data, n);
+	}
+	else
+	{
+	    /* 16비트 샘플은 상위 8비트만 사용 */
+	    const uint16_t *data16 = (const uint16_t *)data;
+	    for(unsigned int i = 0; i < n; i++)
+	    {
+		slot->samples[i] = (unsigned char)(data16[i] >> 8);
+	    }
+	}
+	m_head++;
+    }
+
+#ifndef _WIN32
+    if( !m_wakePending.exchange(1) )
+    {
+	char c = 0;
+	if( write(m_wakeFds[1], &c, 1) < 0 )
+	{
+	    /* Pipe full, so the hub thread is awake anyway. */
+	}
+    }
+#endif
+} /* SPxSpokeHub::Publish() */
+
+
+/*====================================================================
+*
+* SPxSpokeHub::GetStats
+*	Read the subscribers' statistics.
+*
+* Params:
+*	stats			Filled in, one per connected subscriber.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Resets the counts.
+*
+*===================================================================*/
+void SPxSpokeHub::GetStats(std::vector<SubscriberStats> *stats)
+{
+    stats->clear();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for(size_t i = 0; i < m_subs.size(); i++)
+    {
+	Subscriber *sub = m_subs[i];
+	if( !sub->subscribed )
+	{
+	    continue;
+	}
+	sub->stats.lag = (sub->playback != NULL) ? 0 : (m_head - sub->cursor);
+	sub->stats.lagMs = 0.0;
+	if( sub->stats.lag > 0 )
+	{
+	    /* 링이 한 바퀴 넘게 앞서면 가장 오래된 스포크 기준 (하한) */
+	    uint32_t oldest = (sub->stats.lag <= m_mask + 1) ? sub->cursor : m_head;
+	    sub->stats.lagMs = (double)(m_ring[(m_head - 1) & m_mask].rec.timeMs
+					- m_ring[oldest & m_mask].rec.timeMs);
+	}
+	stats->push_back(sub->stats);
+	sub->stats.numSent = 0;
+	sub->stats.numFiltered = 0;
+	sub->stats.numCoalesced = 0;
+	sub->stats.numBytes = 0;
+	sub->stats.maxLag = 0;
+	sub->stats.numSeeks = 0;
+    }
+} /* SPxSpokeHub::GetStats() */
+
+
+/*********************************************************************
+*
+*	Private functions
+*
+**********************************************************************/
+
+#ifndef _WIN32
+
+/*====================================================================
+*
+* SPxSpokeHub::hubThread
+*	Accept subscribers and send them spokes until stopped.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Never blocks on a subscriber: sockets are non-blocking and a
+*	subscriber whose socket is full waits for POLLOUT while the
+*	others carry on.
+*
+*===================================================================*/
+void SPxSpokeHub::hubThread(void)
+{
+    std::vector<struct pollfd> fds;
+    while( !m_stop )
+    {
+	fds.resize(2 + m_subs.size());
+	fds[0].fd = m_listenFd;
+	fds[0].events = POLLIN;
+	fds[1].fd = m_wakeFds[0];
+	fds[1].events = POLLIN;
+	for(size_t i = 0; i < m_subs.size(); i++)
+	{
+	    Subscriber *sub = m_subs[i];
+	    fds[2 + i].fd = sub->fd;
+	    fds[2 + i].events = POLLIN;
+	    if( sub->pendingOffset < sub->pending.size() )
+	    {
+		fds[2 + i].events |= POLLOUT;
+	    }
+	}
+	int timeout = POLL_TIMEOUT_MSECS;
+	for(size_t i = 0; i < fds.size(); i++)
+	{
+	    fds[i].revents = 0;
+	    if( (i >= 2) && (m_subs[i - 2]->playback != NULL) )
+	    {
+		timeout = PLAYBACK_POLL_MSECS;
+	    }
+	}
+	if( poll(&fds[0], fds.size(), timeout) < 0 )
+	{
+	    if( errno != EINTR )
+	    {
+		break;
+	    }
+	    continue;
+	}
+
+	/* 깨우기 파이프를 비우고 나서 링을 읽어야 새 스포크를 놓치지 않음 */
+	if( fds[1].revents & POLLIN )
+	{
+	    char buf[64];
+	    while( read(m_wakeFds[0], buf, sizeof(buf)) > 0 )
+	    {
+	    }
+	    m_wakePending = 0;
+	}
+	feedTimeShift();
+
+	/* Serve the subscribers polled, last first so closing one does
+	 * not move the others.
+	 */
+	for(size_t i = fds.size() - 2; i-- > 0; )
+	{
+	    Subscriber *sub = m_subs[i];
+	    short revents = fds[2 + i].revents;
+	    int ok = 1;
+	    if( revents & (POLLIN | POLLHUP | POLLERR) )
+	    {
+		if( !sub->subscribed )
+		{
+		    ok = (readRequest(sub) == 0);
+		}
+		else
+		{
+		    ok = (readCommands(sub) == 0);
+		}
+	    }
+	    if( ok && sub->subscribed )
+	    {
+		fillPending(sub);
+		ok = (sendPending(sub) == 0);
+	    }
+	    if( !ok )
+	    {
+		closeSubscriber(i);
+	    }
+	}
+
+	if( fds[0].revents & POLLIN )
+	{
+	    acceptSubscriber();
+	}
+    }
+} /* SPxSpokeHub::hubThread() */
+
+
+/*====================================================================
+*
+* SPxSpokeHub::acceptSubscriber
+*	Accept a new subscriber.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	It gets nothing until its request line has been read.
+*
+*===================================================================*/
+void SPxSpokeHub::acceptSubscriber(void)
+{
+    int fd = accept(m_listenFd, NULL, NULL);
+    if( fd < 0 )
+    {
+	return;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    Subscriber *sub = new Subscriber();
+    sub->fd = fd;
+    sub->id = m_nextId++;
+    sub->subscribed = 0;
+    sub->gates = 0;
+    sub->range = 1;
+    sub->sectorFrom = -1;
+    sub->sectorTo = -1;
+    sub->every = 1;
+    sub->everyCount = 0;
+    sub->cursor = 0;
+    sub->numSkipped = 0;
+    sub->pendingOffset = 0;
+    sub->playback = NULL;
+    sub->stats.id = sub->id;
+    sub->stats.numSent = 0;
+    sub->stats.numFiltered = 0;
+    sub->stats.numCoalesced = 0;
+    sub->stats.numBytes = 0;
+    sub->stats.lag = 0;
+    sub->stats.maxLag = 0;
+    sub->stats.lagMs = 0.0;
+    sub->stats.shifted = 0;
+    sub->stats.shiftSecs = 0.0;
+    sub->stats.numSeeks = 0;
+    sub->stats.seekMs = 0.0;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_subs.push_back(sub);
+} /* SPxSpokeHub::acceptSubscriber() */
+
+
+/*====================================================================
+*
+* SPxSpokeHub::readRequest
+*	Read (some of) a subscriber's request line.
+*
+* Params:
+*	sub			Subscriber.
+*
+* Returns:
+*	Zero if read or still to come, -1 to disconnect it.
+*
+* Notes
+*	Once the line is complete the subscriber starts from the newest
+*	spoke.
+*
+*===================================================================*/
+int SPxSpokeHub::readRequest(Subscriber *sub)
+{
+    char buf[MAX_REQUEST];
+    ssize_t n = recv(sub->fd, buf, sizeof(buf), MSG_DONTWAIT);
+    if( n == 0 )
+    {
+	return(-1);
+    }
+    if( n < 0 )
+    {
+	return((errno == EAGAIN) ? 0 : -1);
+    }
+    for(ssize_t i = 0; i < n; i++)
+    {
+	if( buf[i] == '\n' )
+	{
+	    /* Anything after the line is ignored. */
+	    if( parseRequest(sub, sub->request.c_str()) != 0 )
+	    {
+		fprintf(stderr, "Hub subscriber %u: invalid request '%s'.\n",
+			sub->id, sub->request.c_str());
+		return(-1);
+	    }
+	    std::lock_guard<std::mutex> lock(m_mutex);
+	    sub->stats.request = sub->request;
+	    sub->cursor = m_head;
+	    sub->subscribed = 1;
+	    return(0);
+	}
+	if( buf[i] != '\r' )
+	{
+	    sub->request += buf[i];
+	}
+    }
+    return((sub->request.size() < MAX_REQUEST) ? 0 : -1);
+} /* SPxSpokeHub::readRequest() */
+
+
+/*====================================================================
+*
+* SPxSpokeHub::parseRequest
+*	Parse a subscriber's request line.
+*
+* Params:
+*	sub			Subscriber, its options set,
+*	line			Request (see SPxSpokeHub.h).
+*
+* Returns:
+*	Zero on success, -1 if invalid.
+*
+* Notes
+*
+*===================================================================*/
+int SPxSpokeHub::parseRequest(Subscriber *sub, const char *line)
+{
+    char copy[MAX_REQUEST + 1];
+    snprintf(copy, sizeof(copy), "%s", line);
+    char *save = NULL;
+    for(char *tok = strtok_r(copy, " \t", &save); tok != NULL;
+	tok = strtok_r(NULL, " \t", &save))
+    {
+	char *end = NULL;
+	if( strncmp(tok, "gates=", 6) == 0 )
+	{
+	    unsigned long n = strtoul(tok + 6, &end, 0);
+	    if( (*end != '\0') || (n < 1) || (n > SPX_SPOKE_HUB_MAX_SAMPLES) )
+	    {
+		return(-1);
+	    }
+	    sub->gates = (unsigned int)n;
+	}
+	else if( strncmp(tok, "range=", 6) == 0 )
+	{
+	    unsigned long n = strtoul(tok + 6, &end, 0);
+	    if( (*end != '\0') || (n < 1) || (n > 256) )
+	    {
+		return(-1);
+	    }
+	    sub->range = (unsigned int)n;
+	}
+	else if( strncmp(tok, "sector=", 7) == 0 )
+	{
+	    double from = strtod(tok + 7, &end);
+	    if( *end != '-' )
+	    {
+		return(-1);
+	    }
+	    double to = strtod(end + 1, &end);
+	    if( (*end != '\0') || (from < 0.0) || (from > 360.0)
+		|| (to < 0.0) || (to > 360.0) )
+	    {
+		return(-1);
+	    }
+	    sub->sectorFrom = (int)(from * 65536.0 / 360.0) & 0xFFFF;
+	    sub->sectorTo = (to >= 360.0) ? 0xFFFF
+		: ((int)(to * 65536.0 / 360.0) & 0xFFFF);
+	}
+	else if( strncmp(tok, "every=", 6) == 0 )
+	{
+	    unsigned long n = strtoul(tok + 6, &end, 0);
+	    if( (*end != '\0') || (n < 1) || (n > 65536) )
+	    {
+		return(-1);
+	    }
+	    sub->every = (unsigned int)n;
+	}
+	else
+	{
+	    return(-1);
+	}
+    }
+    return(0);
+} /* SPxSpokeHub::parseRequest() */
+
+
+/*====================================================================
+*
+* SPxSpokeHub::readCommands
+*	Read a subscriber's command lines.
+*
+* Params:
+*	sub			Subscriber.
+*
+* Returns:
+*	Zero if read or still to come, -1 to disconnect it.
+*
+* Notes
+*	Each complete line is handled as it arrives.
+*
+*===================================================================*/
+int SPxSpokeHub::readCommands(Subscriber *sub)
+{
+    char buf[MAX_REQUEST];
+    ssize_t n = recv(sub->fd, buf, sizeof(buf), MSG_DONTWAIT);
+    if( n == 0 )
+    {
+	return(-1);
+    }
+    if( n < 0 )
+    {
+	return((errno == EAGAIN) ? 0 : -1);
+    }
+    for(ssize_t i = 0; i < n; i++)
+    {
+	if( buf[i] == '\n' )
+	{
+	    handleCommand(sub, sub->command.c_str());
+	    sub->command.clear();
+	}
+	else if( buf[i] != '\r' )
+	{
+	    sub->command += buf[i];
+	}
+    }
+    return((sub->command.size() < MAX_REQUEST) ? 0 : -1);
+} /* SPxSpokeHub::readCommands() */
+
+
+/*====================================================================
+*
+* SPxSpokeHub::handleCommand
+*	Switch a subscriber between live and time-shifted playback.
+*
+* Params:
+*	sub			Subscriber,
+*	line			Command (see SPxSpokeHub.h).
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Invalid commands are reported and ignored.  Seeking inflates at
+*	most one block of the store, without m_mutex, so Publish() is
+*	not held up.
+*
+*===================================================================*/
+void SPxSpokeHub::handleCommand(Subscriber *sub, const char *line)
+{
+    char copy[MAX_REQUEST + 1];
+    snprintf(copy, sizeof(copy), "%s", line);
+    int live = 0;
+    int seek = 0;
+    int64_t timeMs = 0;
+    double speed = 1.0;
+    int ok = 1;
+    char *save = NULL;
+    for(char *tok = strtok_r(copy, " \t", &save); (tok != NULL) && ok;
+	tok = strtok_r(NULL, " \t", &save))
+    {
+	char *end = NULL;
+	if( strcmp(tok, "live") == 0 )
+	{
+	    live = 1;
+	}
+	else if( strncmp(tok, "seek=", 5) == 0 )
+	{
+	    double secs = strtod(tok + 5, &end);
+	    ok = (*end == '\0') && (secs >= 0.0) && (m_timeShift != NULL);
+	    timeMs = ok ? (m_timeShift->GetNewestMs() - (int64_t)(secs * 1000.0)) : 0;
+	    seek = 1;
+	}
+	else if( strncmp(tok, "at=", 3) == 0 )
+	{
+	    timeMs = strtoll(tok + 3, &end, 0);
+	    ok = (*end == '\0') && (timeMs > 0) && (m_timeShift != NULL);
+	    seek = 1;
+	}
+	else if( strncmp(tok, "speed=", 6) == 0 )
+	{
+	    speed = strtod(tok + 6, &end);
+	    ok = (*end == '\0') && (speed >= MIN_PLAYBACK_SPEED)
+		&& (speed <= MAX_PLAYBACK_SPEED);
+	}
+	else
+	{
+	    ok = 0;
+	}
+    }
+    if( !ok || (live == seek) )
+    {
+	if( copy[0] != '\0' )
+	{
+	    fprintf(stderr, "Hub subscriber %u: invalid command '%s'%s.\n",
+		    sub->id, line, (m_timeShift == NULL) ? " (no time-shift store)" : "");
+	}
+	return;
+    }
+
+    if( live )
+    {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	delete sub->playback;
+	sub->playback = NULL;
+	sub->cursor = m_head;
+	sub->stats.shifted = 0;
+	sub->stats.shiftSecs = 0.0;
+	return;
+    }
+
+    /* 시간 이동: 그 시각 한 바퀴 전부터 */
+    int64_t now = nowUsecs();
+    Playback *playback = sub->playback;
+    if( playback == NULL )
+    {
+	playback = new Playback();
+    }
+    if( m_timeShift->Seek(timeMs, &playback->cursor) != 0 )
+    {
+	fprintf(stderr, "Hub subscriber %u: nothing kept to seek to yet.\n",
+		sub->id);
+	if( playback != sub->playback )
+	{
+	    delete playback;
+	}
+	return;
+    }
+    const unsigned char *samples = NULL;
+    const SPxSpokeHubRecord *first = m_timeShift->Peek(&playback->cursor, &samples);
+    if( (first != NULL) && (first->timeMs > timeMs) )
+    {
+	/* 남은 것보다 이전이면 가장 오래된 것부터 */
+	timeMs = first->timeMs;
+    }
+    playback->playMs = timeMs;
+    playback->startUsecs = now;
+    playback->speed = speed;
+    playback->seekUsecs = now;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    sub->playback = playback;
+    sub->stats.shifted = 1;
+    sub->stats.numSeeks++;
+} /* SPxSpokeHub::handleCommand() */
+
+
+/*====================================================================
+*
+* SPxSpokeHub::feedTimeShift
+*	Add the spokes published since the last call to the time-shift
+*	store.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	If the hub thread was held up for more than the ring, the spokes
+*	overwritten are not kept.  The spokes are copied out of the ring
+*	under the mutex and added after it is released, so Publish() is
+*	not held up by the store.
+*
+*===================================================================*/
+void SPxSpokeHub::feedTimeShift(void)
+{
+    if( m_timeShift == NULL )
+    {
+	return;
+    }
+    m_shiftRecs.clear();
+    m_shiftSamples.clear();
+    {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	uint32_t size = m_mask + 1;
+	if( m_head - m_shiftCursor > size )
+	{
+	    m_shiftCursor = m_head - size;
+	}
+	for(; m_shiftCursor != m_head; m_shiftCursor++)
+	{
+	    const Slot *slot = &m_ring[m_shiftCursor & m_mask];
+	    m_shiftRecs.push_back(slot->rec);
+	    m_shiftSamples.insert(m_shiftSamples.end(), slot->samples.begin(),
+				  slot->samples.end());
+	}
+    }
+
+    /* 저장소는 자체 잠금을 가짐 */
+    size_t offset = 0;
+    for(size_t i = 0; i < m_shiftRecs.size(); i++)
+    {
+	m_timeShift->Add(&m_shiftRecs[i], m_shiftSamples.data() + offset);
+	offset += m_shiftRecs[i].numSamples;
+    }
+} /* SPxSpokeHub::feedTimeShift() */
+
+
+/*====================================================================
+*
+* SPxSpokeHub::fillPending
+*	Encode spokes from a subscriber's cursor.
+*
+* Params:
+*	sub			Subscriber.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Stops when PENDING_BYTES are waiting to be sent, so a subscriber
+*	that is not reading falls behind in the ring instead of growing
+*	its buffer.  More than half the ring behind, the backlog is
+*	coalesced to the newest spoke per channel and azimuth bin (the
+*	newest of those that fit in PENDING_BYTES), and anything the
+*	ring has overwritten is skipped.
+*
+*===================================================================*/
+void SPxSpokeHub::fillPending(Subscriber *sub)
+{
+    if( sub->pendingOffset >= sub->pending.size() )
+    {
+	sub->pending.clear();
+	sub->pendingOffset = 0;
+    }
+    if( sub->playback != NULL )
+    {
+	fillPlayback(sub);
+	return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint32_t head = m_head;
+    uint32_t size = m_mask + 1;
+    uint32_t lag = head - sub->cursor;
+    if( lag > sub->stats.maxLag )
+    {
+	sub->stats.maxLag = lag;
+    }
+    if( (sub->pending.size() - sub->pendingOffset) >= PENDING_BYTES )
+    {
+	return;
+    }
+
+    if( lag > (size / 2) )
+    {
+	/* 밀린 구간에서 채널/방위 빈별 최신 스포크만 고름 */
+	uint32_t from = (lag > size) ? (head - size) : sub->cursor;
+	if( ++m_markGeneration == 0 )
+	{
+	    std::fill(m_marks.begin(), m_marks.end(), 0);
+	    m_markGeneration = 1;
+	}
+	m_selected.clear();
+	for(uint32_t seq = head; seq != from; )
+	{
+	    seq--;
+	    const SPxSpokeHubRecord *rec = &m_ring[seq & m_mask].rec;
+	    size_t key = (size_t)rec->channel * SPX_SPOKE_HUB_COALESCE_BINS
+		+ (((uint32_t)rec->azimuth * SPX_SPOKE_HUB_COALESCE_BINS) >> 16);
+	    if( key >= m_marks.size() )
+	    {
+		m_marks.resize(key + 1, 0);
+	    }
+	    if( m_marks[key] != m_markGeneration )
+	    {
+		m_marks[key] = m_markGeneration;
+		m_selected.push_back(seq);
+	    }
+	}
+
+	/* 최신 것부터 대기 바이트 한도까지만 보냄 (느린 구독자용) */
+	size_t bytes = 0;
+	for(size_t i = 0; i < m_selected.size(); i++)
+	{
+	    bytes += sizeof(SPxSpokeHubRecord)
+		+ m_ring[m_selected[i] & m_mask].rec.numSamples;
+	    if( (bytes > PENDING_BYTES) && (i > 0) )
+	    {
+		m_selected.resize(i);
+		break;
+	    }
+	}
+	uint32_t skipped = lag - (uint32_t)m_selected.size();
+	sub->numSkipped += skipped;
+	sub->stats.numCoalesced += skipped;
+	for(size_t i = m_selected.size(); i-- > 0; )
+	{
+	    const Slot *slot = &m_ring[m_selected[i] & m_mask];
+	    encode(sub, &slot->rec, slot->samples.data(), sub->numSkipped,
+		   head - m_selected[i] - 1);
+	}
+	sub->cursor = head;
+	return;
+    }
+
+    while( (sub->cursor != head)
+	   && ((sub->pending.size() - sub->pendingOffset) < PENDING_BYTES) )
+    {
+	const Slot *slot = &m_ring[sub->cursor & m_mask];
+	encode(sub, &slot->rec, slot->samples.data(), sub->numSkipped,
+	       head - sub->cursor - 1);
+	sub->cursor++;
+    }
+} /* SPxSpokeHub::fillPending() */
+
+
+/*====================================================================
+*
+* SPxSpokeHub::fillPlayback
+*	Encode a time-shifted subscriber's spokes that are due.
+*
+* Params:
+*	sub			Subscriber.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Spokes up to the playback time are due, so the turn before the
+*	time sought goes at once (up to PENDING_BYTES at a time).  When
+*	the store has nothing newer the subscriber is live again, from
+*	the next spoke the store would have kept.  The store is read
+*	without m_mutex, as moving to the next block may inflate it.
+*
+*===================================================================*/
+void SPxSpokeHub::fillPlayback(Subscriber *sub)
+{
+    Playback *playback = sub->playback;
+    int64_t now = nowUsecs();
+    int64_t clockMs = playback->playMs + (int64_t)((double)(now - playback->startUsecs)
+						    / 1000.0 * playback->speed);
+    while( (sub->pending.size() - sub->pendingOffset) < PENDING_BYTES )
+    {
+	const unsigned char *samples = NULL;
+	const SPxSpokeHubRecord *rec = m_timeShift->Peek(&playback->cursor, &samples);
+	if( rec == NULL )
+	{
+	    /* 최신까지 따라잡으면 다시 실시간 */
+	    std::lock_guard<std::mutex> lock(m_mutex);
+	    sub->cursor = m_shiftCursor;
+	    sub->playback = NULL;
+	    sub->stats.shifted = 0;
+	    sub->stats.shiftSecs = 0.0;
+	    delete playback;
+	    return;
+	}
+	if( rec->timeMs > clockMs )
+	{
+	    break;
+	}
+	std::lock_guard<std::mutex> lock(m_mutex);
+	encode(sub, rec, samples, 0, 0);
+	m_timeShift->Next(&playback->cursor);
+	if( playback->seekUsecs != 0 )
+	{
+	    sub->stats.seekMs = (double)(now - playback->seekUsecs) / 1000.0;
+	    playback->seekUsecs = 0;
+	}
+    }
+    int64_t newestMs = m_timeShift->GetNewestMs();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    sub->stats.shiftSecs = (double)(newestMs - clockMs) / 1000.0;
+} /* SPxSpokeHub::fillPlayback() */
+
+
+/*====================================================================
+*
+* SPxSpokeHub::encode
+*	Append a spoke to a subscriber's pending bytes, if it wants it.
+*
+* Params:
+*	sub			Subscriber,
+*	in, samples		Spoke,
+*	numCoalesced		Spokes skipped before it,
+*	lag			Spokes behind the newest.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Called with m_mutex held.  Applies the subscriber's sector,
+*	rate, range limit and range reduction.
+*
+*===================================================================*/
+void SPxSpokeHub::encode(Subscriber *sub, const SPxSpokeHubRecord *in,
+			 const unsigned char *samples, uint32_t numCoalesced,
+			 uint32_t lag)
+{
+    /* 방위 구간 (0도를 넘어가는 구간 포함) */
+    if( sub->sectorFrom >= 0 )
+    {
+	int az = in->azimuth;
+	int inside = (sub->sectorFrom <= sub->sectorTo)
+	    ? ((az >= sub->sectorFrom) && (az <= sub->sectorTo))
+	    : ((az >= sub->sectorFrom) || (az <= sub->sectorTo));
+	if( !inside )
+	{
+	    sub->stats.numFiltered++;
+	    return;
+	}
+    }
+    if( (sub->everyCount++ % sub->every) != 0 )
+    {
+	sub->stats.numFiltered++;
+	return;
+    }
+
+    /* 거리 제한 후 range 개씩 최대값으로 축소 */
+    unsigned int n = in->numSamples;
+    float spacing = (n > 0) ? ((in->endRange - in->startRange) / (float)n) : 0.0f;
+    if( (sub->gates > 0) && (sub->gates < n) )
+    {
+	n = sub->gates;
+    }
+    unsigned int range = sub->range;
+    unsigned int numOut = (n + range - 1) / range;
+
+    SPxSpokeHubRecord rec = *in;
+    rec.numSamples = (uint16_t)numOut;
+    rec.rangeStep = (uint16_t)range;
+    rec.endRange = in->startRange + spacing * (float)n;
+    rec.numCoalesced = numCoalesced;
+    rec.lag = lag;
+
+    size_t offset = sub->pending.size();
+    sub->pending.resize(offset + sizeof(rec) + numOut);
+    memcpy(&sub->pending[offset], &rec, sizeof(rec));
+    unsigned char *out = &sub->pending[offset + sizeof(rec)];
+    if( range == 1 )
+    {
+	if( numOut > 0 )
+	{
+	    memcpy(out, samples, numOut);
+	}
+    }
+    else
+    {
+	for(unsigned int i = 0; i < numOut; i++)
+	{
+	    unsigned int first = i * range;
+	    unsigned int last = (first + range < n) ? (first + range) : n;
+	    unsigned char peak = 0;
+	    for(unsigned int j = first; j < last; j++)
+	    {
+		if( samples[j] > peak )
+		{
+		    peak = samples[j];
+		}
+	    }
+	    out[i] = peak;
+	}
+    }
+
+    sub->numSkipped = 0;
+    sub->stats.numSent++;
+    sub->stats.numBytes += sizeof(rec) + numOut;
+} /* SPxSpokeHub::encode() */
+
+
+/*====================================================================
+*
+* SPxSpokeHub::sendPending
+*	Send as much of a subscriber's pending bytes as its socket takes.
+*
+* Params:
+*	sub			Subscriber.
+*
+* Returns:
+*	Zero if sent or the socket is full, -1 to disconnect it.
+*
+* Notes
+*
+*===================================================================*/
+int SPxSpokeHub::sendPending(Subscriber *sub)
+{
+    while( sub->pendingOffset < sub->pending.size() )
+    {
+	ssize_t n = send(sub->fd, &sub->pending[sub->pendingOffset],
+			 sub->pending.size() - sub->pendingOffset,
+			 MSG_DONTWAIT | MSG_NOSIGNAL);
+	if( n < 0 )
+	{
+	    return(((errno == EAGAIN) || (errno == EINTR)) ? 0 : -1);
+	}
+	sub->pendingOffset += (size_t)n;
+    }
+    return(0);
+} /* SPxSpokeHub::sendPending() */
+
+
+/*====================================================================
+*
+* SPxSpokeHub::closeSubscriber
+*	Disconnect and remove a subscriber.
+*
+* Params:
+*	idx			Its index in m_subs.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+void SPxSpokeHub::closeSubscriber(size_t idx)
+{
+    Subscriber *sub = m_subs[idx];
+    {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_subs.erase(m_subs.begin() + idx);
+    }
+    close(sub->fd);
+    delete sub->playback;
+    delete sub;
+} /* SPxSpokeHub::closeSubscriber() */
+
+
+/*====================================================================
+*
+* nowUsecs
+*	Get the monotonic time.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Microseconds.
+*
+* Notes
+*
+*===================================================================*/
+static int64_t nowUsecs(void)
+{
+    return( std::chrono::duration_cast<std::chrono::microseconds>(
+	std::chrono::steady_clock::now().time_since_epoch()).count() );
+} /* nowUsecs() */
+
+#endif /* _WIN32 */
+
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
@@ -0,0 +1,234 @@
+/*********************************************************************
+*
+* File: SPxSpokeHub.h
+*
+* Purpose:
+*	Local fan-out of received spokes to any number of subscribers
+*	over a Unix domain (stream) socket, so the viewer, a recorder and
+*	a detection process can share one receive and decode path.
+*
+*	Publish() copies each spoke (as 8-bit samples) into a broadcast
+*	ring of the most recent spokes.  A hub thread accepts subscribers
+*	and sends each one the spokes from its own cursor in the ring,
+*	never waiting on a subscriber's socket, so a slow subscriber only
+*	falls behind itself.  A subscriber more than half the ring behind
+*	gets coalesced updates: only the newest spoke of each azimuth bin
+*	(per channel) in its backlog, and the ring may lap it.
+*
+*	A subscriber sends one request line after connecting, options
+*	separated by spaces (an empty line for everything):
+*
+*	    gates=<n>		Only the first n samples (range limit)
+*	    range=<n>		Maximum of each n samples (range reduction)
+*	    sector=<a>-<b>	Only azimuths from a to b degrees (may wrap)
+*	    every=<n>		Only every nth spoke (rate reduction)
+*
+*	and then reads SPxSpokeHubRecord headers, each followed by its
+*	samples.  Records are in host byte order, as the socket is local.
+*
+*	With a time-shift store (SetTimeShift(), see SPxTimeShift.h) the
+*	hub also keeps the last minutes of spokes, and a subscriber may
+*	send command lines at any time to rewind:
+*
+*	    seek=<secs> [speed=<x>]	Play from this long before the
+*					newest spoke
+*	    at=<ms> [speed=<x>]		Play from this time (ms since
+*					the epoch)
+*	    live			Back to the live spokes
+*
+*	Playback starts with the turn before the time, sent at once, so
+*	a viewer has a whole picture straight away, then goes on at the
+*	speed given (default 1).  Played spokes have the magic
+*	SPX_SPOKE_HUB_MAGIC_SHIFTED; playback that catches up with the
+*	newest spoke goes back to live by itself.
+*
+*	The hub does not depend on the SPx library.
+*
+**********************************************************************/
+
+#ifndef _SPX_SPOKE_HUB_H
+#define _SPX_SPOKE_HUB_H
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* Spokes kept in the ring, most samples kept per spoke, and azimuth
+ * bins per channel when coalescing.
+ */
+#define	SPX_SPOKE_HUB_RING_SPOKES	4096
+#define	SPX_SPOKE_HUB_MAX_SAMPLES	16384
+#define	SPX_SPOKE_HUB_COALESCE_BINS	1024
+
+/* Magic number at the start of each record. */
+#define	SPX_SPOKE_HUB_MAGIC		0x53504842	/* "SPHB" */
+#define	SPX_SPOKE_HUB_MAGIC_SHIFTED	0x53504854	/* "SPHT", played back */
+
+/* Time-shift store (SPxTimeShift.h). */
+class SPxTimeShift;
+
+/* Record sent to subscribers before each spoke's samples. */
+struct SPxSpokeHubRecord
+{
+    uint32_t magic;		/* SPX_SPOKE_HUB_MAGIC */
+    uint32_t seq;		/* Hub sequence number of the spoke */
+    uint16_t channel;		/* Source channel */
+    uint16_t azimuth;		/* 65536 per turn */
+    uint16_t numSamples;	/* 8-bit samples following the record */
+    uint16_t rangeStep;		/* Received samples per sent sample */
+    float startRange;		/* Of the first and last sent sample */
+    float endRange;
+    int64_t timeMs;		/* Receive time, ms since the epoch */
+    uint32_t numCoalesced;	/* Spokes skipped since the previous record */
+    uint32_t lag;		/* Spokes behind the newest when sent */
+};
+
+class SPxSpokeHub
+{
+public:
+    /* Statistics of one subscriber.  Counts cover the time since the
+     * previous GetStats() call; lag is current.
+     */
+    struct SubscriberStats
+    {
+	unsigned int id;		/* Connection number */
+	std::string request;		/* Its request line */
+	uint64_t numSent;		/* Spokes sent */
+	uint64_t numFiltered;		/* Not wanted (sector, every) */
+	uint64_t numCoalesced;		/* Skipped while behind */
+	uint64_t numBytes;		/* Queued for sending */
+	unsigned int lag;		/* Spokes behind the newest */
+	unsigned int maxLag;
+	double lagMs;			/* Newest spoke to next to send */
+	int shifted;			/* Time-shifted playback */
+	double shiftSecs;		/* Playback behind the newest spoke */
+	unsigned int numSeeks;
+	double seekMs;			/* Last seek to its first spoke queued */
+    };
+
+    /* Constructor/destructor. */
+    SPxSpokeHub(void);
+    ~SPxSpokeHub();
+
+    /* Listen on a Unix domain socket (replacing a stale one) and start
+     * the hub thread.  Zero on success or -1 on error (see GetError()).
+     */
+    int Create(const char *path, unsigned int ringSpokes = SPX_SPOKE_HUB_RING_SPOKES);
+    const char *GetError(void) const { return m_error.c_str(); }
+
+    /* Keep a time-shift store (see SPxTimeShift.h), before Create().
+     * Zero on success or -1 on error (see GetError()).
+     */
+    int SetTimeShift(const char *spec);
+    SPxTimeShift *GetTimeShift(void) { return m_timeShift; }
+
+    /* Add a spoke (from any thread).  bytesPerSample is 1 or 2; 16-bit
+     * samples are reduced to their top 8 bits.
+     */
+    void Publish(unsigned int channel, uint16_t azimuth, float startRange,
+		 float endRange, int64_t timeMs, const unsigned char *data,
+		 unsigned int numSamples, unsigned int bytesPerSample);
+
+    /* Read the subscribers' statistics. */
+    void GetStats(std::vector<SubscriberStats> *stats);
+
+    /* Allocate and fault in every ring slot's samples (after Create()),
+     * so Publish() never allocates.
+     */
+    void Prefault(void);
+
+private:
+    /* A spoke in the ring. */
+    struct Slot
+    {
+	SPxSpokeHubRecord rec;
+	std::vector<unsigned char> samples;
+    };
+
+    /* A subscriber's time-shifted playback (SPxSpokeHub.cpp). */
+    struct Playback;
+
+    /* A connected subscriber, used by the hub thread only (apart from
+     * its statistics, guarded by m_mutex).
+     */
+    struct Subscriber
+    {
+	int fd;
+	unsigned int id;
+	int subscribed;			/* Request line read */
+	std::string request;
+	unsigned int gates;		/* 0 for all */
+	unsigned int range;		/* 1 for all */
+	int sectorFrom, sectorTo;	/* 16-bit azimuths, -1 for all */
+	unsigned int every;		/* 1 for all */
+	unsigned int everyCount;
+	uint32_t cursor;		/* Next sequence number to send */
+	uint32_t numSkipped;		/* Coalesced since the last record */
+	std::vector<unsigned char> pending;	/* Encoded, not yet sent */
+	size_t pendingOffset;
+	std::string command;		/* Command line being read */
+	Playback *playback;		/* NULL when live */
+	SubscriberStats stats;
+    };
+
+    /* Socket and thread. */
+    int m_listenFd;
+    int m_wakeFds[2];			/* Publish() wakes the hub thread */
+    std::atomic<int> m_wakePending;
+    std::string m_path;
+    std::thread m_thread;
+    std::atomic<int> m_stop;
+    std::string m_error;
+
+    /* Ring of spokes, guarded by m_mutex.  m_head is the next sequence
+     * number to publish.
+     */
+    std::mutex m_mutex;
+    std::vector<Slot> m_ring;
+    uint32_t m_mask;			/* Ring size (a power of two) - 1 */
+    uint32_t m_head;
+
+    /* Subscribers (added and removed by the hub thread under m_mutex)
+     * and coalescing marks (hub thread).
+     */
+    std::vector<Subscriber *> m_subs;
+    unsigned int m_nextId;
+    std::vector<uint32_t> m_marks;
+    uint32_t m_markGeneration;
+    std::vector<uint32_t> m_selected;
+
+    /* Time-shift store, or NULL, the next sequence number to add to
+     * it, and the spokes copied from the ring to add (hub thread).
+     */
+    SPxTimeShift *m_timeShift;
+    uint32_t m_shiftCursor;
+    std::vector<SPxSpokeHubRecord> m_shiftRecs;
+    std::vector<unsigned char> m_shiftSamples;
+
+    /* Private functions. */
+    void hubThread(void);
+    void acceptSubscriber(void);
+    int readRequest(Subscriber *sub);
+    int parseRequest(Subscriber *sub, const char *line);
+    int readCommands(Subscriber *sub);
+    void handleCommand(Subscriber *sub, const char *line);
+    void feedTimeShift(void);
+    void fillPending(Subscriber *sub);
+    void fillPlayback(Subscriber *sub);
+    void encode(Subscriber *sub, const SPxSpokeHubRecord *in,
+		const unsigned char *samples, uint32_t numCoalesced,
+		uint32_t lag);
+    int sendPending(Subscriber *sub);
+    void closeSubscriber(size_t idx);
+};
+
+#endif /* _SPX_SPOKE_HUB_H */
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
@@ -0,0 +1,375 @@
+/*********************************************************************
+*
+* File: SPxSpokeProcess.cpp
+*
+* Purpose:
+*	Per-spoke processing for the streamers (see SPxSpokeProcess.h).
+*
+**********************************************************************/
+
+/* Standard headers. */
+#include <stdlib.h>
+#include <string.h>
+
+/* Our own headers. */
+#include "SPxClutterMap.h"
+#include "SPxFilterChain.h"
+#include "SPxFilterPlugin.h"
+#include "SPxScanIntegrator.h"
+#include "SPxSpokeProcess.h"
+
+
+/*********************************************************************
+*
+*	Public functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* SPxSpokeProcess::SPxSpokeProcess
+*	Constructor, with no processing configured.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+SPxSpokeProcess::SPxSpokeProcess(void)
+    : m_clutter(NULL), m_clutterAzis(0), m_clutterLoaded(0),
+      m_filter(NULL), m_plugins(NULL), m_integrator(NULL),
+      m_integrationAzis(0)
+{
+} /* SPxSpokeProcess::SPxSpokeProcess() */
+
+
+/*====================================================================
+*
+* SPxSpokeProcess::~SPxSpokeProcess
+*	Destructor.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+SPxSpokeProcess::~SPxSpokeProcess()
+{
+    delete m_clutter;
+    delete m_filter;
+    delete m_plugins;
+    delete m_integrator;
+} /* SPxSpokeProcess::~SPxSpokeProcess() */
+
+
+/*====================================================================
+*
+* SPxSpokeProcess::SetFilter
+*	Configure the filter chain.
+*
+* Params:
+*	params			Chain (see SPxFilterChain.h).
+*
+* Returns:
+*	Zero on success, -1 on error.
+*
+* Notes
+*
+*===================================================================*/
+int SPxSpokeProcess::SetFilter(const char *params)
+{
+    SPxFilterChain *filter = new SPxFilterChain();
+    if( filter->SetParams(params) != 0 )
+    {
+	m_error = std::string("invalid filter chain: ") + filter->GetError();
+	delete filter;
+	return(-1);
+    }
+    delete m_filter;
+    m_filter = filter;
+    return(0);
+} /* SPxSpokeProcess::SetFilter() */
+
+
+/*====================================================================
+*
+* SPxSpokeProcess::AddPlugin
+*	Load a filter plugin onto the end of the plugin chain.
+*
+* Params:
+*	spec			"<lib>[:<args>]" (see SPxFilterPlugin.h).
+*
+* Returns:
+*	Zero on success, -1 on error.
+*
+* Notes
+*	Plugins run after the filter chain, before integration.
+*
+*===================================================================*/
+int SPxSpokeProcess::AddPlugin(const char *spec)
+{
+    if( m_plugins == NULL )
+    {
+	m_plugins = new SPxFilterPluginChain();
+    }
+    if( m_plugins->Add(spec) != 0 )
+    {
+	m_error = m_plugins->GetError();
+	return(-1);
+    }
+    return(0);
+} /* SPxSpokeProcess::AddPlugin() */
+
+
+/*====================================================================
+*
+* SPxSpokeProcess::SetIntegration
+*	Configure scan-to-scan integration.
+*
+* Params:
+*	args			Integration (see SPxScanIntegrator.h),
+*	numAzis			Azimuth bins per turn.
+*
+* Returns:
+*	Zero on success, -1 on error.
+*
+* Notes
+*	The integrator is created on the first spoke, with one gate per
+*	sample of that spoke.
+*
+*===================================================================*/
+int SPxSpokeProcess::SetIntegration(const char *args, int numAzis)
+{
+    /* 인자 검사만 먼저 (게이트 수는 첫 스포크에서 결정) */
+    SPxScanIntegrator check(1, 1);
+    if( (numAzis <= 0) || (check.SetParams(args) != 0) )
+    {
+	m_error = std::string("invalid integration '") + ((args != NULL) ? args : "") + "'";
+	return(-1);
+    }
+    delete m_integrator;
+    m_integrator = NULL;
+    m_integrationArgs = args;
+    m_integrationAzis = numAzis;
+    return(0);
+} /* SPxSpokeProcess::SetIntegration() */
+
+
+/*====================================================================
+*
+* SPxSpokeProcess::SetClutterMap
+*	Configure the adaptive clutter map.
+*
+* Params:
+*	args			Clutter map (see SPxClutterMap.h),
+*	numAzis			Azimuth bins per turn,
+*	filename		Map file to load from and save to, or
+*				NULL.
+*
+* Returns:
+*	Zero on success, -1 on error.
+*
+* Notes
+*	If the file holds a map it is used as it is, grid size included;
+*	otherwise the map is created on the first spoke, with one gate
+*	per sample of that spoke.  A missing or unreadable file is not
+*	an error (see IsClutterMapLoaded()).
+*
+*===================================================================*/
+int SPxSpokeProcess::SetClutterMap(const char *args, int numAzis,
+				   const char *filename)
+{
+    SPxClutterMap *map = new SPxClutterMap(1, 1);
+    if( (numAzis <= 0) || (map->SetParams(args) != 0) )
+    {
+	m_error = std::string("invalid clutter map '") + ((args != NULL) ? args : "") + "'";
+	delete map;
+	return(-1);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    delete m_clutter;
+    m_clutter = NULL;
+    m_clutterArgs = args;
+    m_clutterAzis = numAzis;
+    m_clutterFile = (filename != NULL) ? filename : "";
+    m_clutterLoaded = 0;
+    if( !m_clutterFile.empty() && (map->Load(m_clutterFile.c_str()) == 0) )
+    {
+	m_clutter = map;
+	m_clutterLoaded = 1;
+    }
+    else
+    {
+	delete map;
+    }
+    return(0);
+} /* SPxSpokeProcess::SetClutterMap() */
+
+
+/*====================================================================
+*
+* SPxSpokeProcess::SaveClutterMap
+*	Save the clutter map to its file.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Zero on success or if no spoke has been seen yet, -1 on error.
+*
+* Notes
+*	Holds off Process() while writing, so the file is a consistent
+*	snapshot.
+*
+*===================================================================*/
+int SPxSpokeProcess::SaveClutterMap(void)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if( m_clutterFile.empty() )
+    {
+	return(-1);
+    }
+    if( m_clutter == NULL )
+    {
+	return(0);
+    }
+    return(m_clutter->Save(m_clutterFile.c_str()));
+} /* SPxSpokeProcess::SaveClutterMap() */
+
+
+/*====================================================================
+*
+* SPxSpokeProcess::IsActive
+*	Check whether any processing is configured.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Non-zero if Process() changes spokes.
+*
+* Notes
+*
+*===================================================================*/
+int SPxSpokeProcess::IsActive(void) const
+{
+    return( !m_clutterArgs.empty() || (m_filter != NULL) || (m_plugins != NULL)
+	    || !m_integrationArgs.empty() );
+} /* SPxSpokeProcess::IsActive() */
+
+
+/*====================================================================
+*
+* SPxSpokeProcess::Process
+*	Process one spoke.
+*
+* Params:
+*	azDegrees		Azimuth, degrees clockwise from north,
+*	data			Samples,
+*	bytesPerSample		1 or 2,
+*	numSamples		Number of samples,
+*	numOut			Set to the number of samples returned,
+*	startRangeMetres,
+*	endRangeMetres		Range of the first and last samples,
+*	sdkHeader		SPxReturnHeader of the spoke, or NULL.
+*
+* Returns:
+*	Processed samples, or NULL if the packing is not supported or
+*	a plugin dropped the spoke.
+*
+* Notes
+*	With integration the output is the integrated bin of this
+*	spoke, on the integrator's gate grid.  A dropped spoke is not
+*	integrated.
+*
+*===================================================================*/
+const uint8_t *SPxSpokeProcess::Process(double azDegrees, const void *data,
+					int bytesPerSample, int numSamples,
+					int *numOut, double startRangeMetres,
+					double endRangeMetres,
+					const void *sdkHeader)
+{
+    if( (data == NULL) || (numSamples <= 0)
+	|| ((bytesPerSample != 1) && (bytesPerSample != 2)) )
+    {
+	return(NULL);
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    /* 8비트 샘플로 변환 (16비트는 상위 바이트) */
+    m_samples.resize(numSamples);
+    uint8_t *samples = &m_samples[0];
+    if( bytesPerSample == 1 )
+    {
+	memcpy(samples, data, numSamples);
+    }
+    else
+    {
+	const uint16_t *data16 = (const uint16_t *)data;
+	for(int i = 0; i < numSamples; i++)
+	{
+	    samples[i] = (uint8_t)(data16[i] >> 8);
+	}
+    }
+
+    if( !m_clutterArgs.empty() )
+    {
+	if( m_clutter == NULL )
+	{
+	    m_clutter = new SPxClutterMap(m_clutterAzis, numSamples);
+	    m_clutter->SetParams(m_clutterArgs.c_str());
+	}
+	m_clutter->Apply(azDegrees, samples, numSamples);
+    }
+
+    if( m_filter != NULL )
+    {
+	m_filter->Apply(samples, numSamples, azDegrees);
+    }
+
+    /* 플러그인은 제자리에서 처리, 스포크를 줄이거나 드롭할 수 있음 */
+    if( m_plugins != NULL )
+    {
+	SPxFilterPluginHeader hdr;
+	hdr.azimuthDegrees = azDegrees;
+	hdr.startRangeMetres = startRangeMetres;
+	hdr.endRangeMetres = endRangeMetres;
+	hdr.sdkHeader = sdkHeader;
+	if( m_plugins->Apply(&hdr, samples, &numSamples) != 0 )
+	{
+	    *numOut = 0;
+	    return(NULL);
+	}
+    }
+
+    if( !m_integrationArgs.empty() )
+    {
+	if( m_integrator == NULL )
+	{
+	    m_integrator = new SPxScanIntegrator(m_integrationAzis, numSamples);
+	    m_integrator->SetParams(m_integrationArgs.c_str());
+	}
+	int bin = m_integrator->UpdateSpoke(azDegrees, samples, numSamples);
+	*numOut = m_integrator->GetNumGates();
+	return(m_integrator->GetRow(bin));
+    }
+
+    *numOut = numSamples;
+    return(samples);
+} /* SPxSpokeProcess::Process() */
+
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
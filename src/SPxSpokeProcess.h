@@ -0,0 +1,96 @@
+/*********************************************************************
+*
+* File: SPxSpokeProcess.h
+*
+* Purpose:
+*	Processing applied to each spoke in the streamers before it is
+*	output: conversion to 8-bit samples, the adaptive clutter map,
+*	the filter chain, filter plugins and scan-to-scan integration.
+*
+*	It does not depend on the SPx library, so the same object can
+*	be driven from any source of spokes.
+*
+**********************************************************************/
+
+#ifndef _SPX_SPOKE_PROCESS_H
+#define _SPX_SPOKE_PROCESS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class SPxClutterMap;
+class SPxFilterChain;
+class SPxFilterPluginChain;
+class SPxScanIntegrator;
+
+class SPxSpokeProcess
+{
+public:
+    /* Constructor/destructor. */
+    SPxSpokeProcess(void);
+    ~SPxSpokeProcess();
+
+    /* Configuration, each returning zero on success or -1 on a bad
+     * string (GetError() says why).
+     */
+    int SetFilter(const char *params);
+    int SetIntegration(const char *args, int numAzis);
+    int SetClutterMap(const char *args, int numAzis, const char *filename);
+    int AddPlugin(const char *spec);
+    const char *GetError(void) const { return m_error.c_str(); }
+
+    /* Non-zero if the clutter map was loaded from its file. */
+    int IsClutterMapLoaded(void) const { return m_clutterLoaded; }
+
+    /* Save the clutter map to its file, zero on success or -1 on
+     * error.  Safe to call while another thread processes spokes.
+     */
+    int SaveClutterMap(void);
+
+    /* Non-zero if any processing is configured. */
+    int IsActive(void) const;
+
+    /* Process a spoke of 1 or 2 byte samples (16-bit samples are
+     * reduced to their high byte).  Returns the processed 8-bit
+     * samples, valid until the next call, and their number, or NULL
+     * if the spoke cannot be processed or a plugin dropped it.  The
+     * range and SDK header are only passed on to plugins.
+     */
+    const uint8_t *Process(double azDegrees, const void *data,
+			   int bytesPerSample, int numSamples, int *numOut,
+			   double startRangeMetres = 0.0,
+			   double endRangeMetres = 0.0,
+			   const void *sdkHeader = NULL);
+
+    /* Access to the stages (NULL if not configured). */
+    SPxClutterMap *GetClutterMap(void) { return m_clutter; }
+    SPxFilterChain *GetFilter(void) { return m_filter; }
+    SPxFilterPluginChain *GetPlugins(void) { return m_plugins; }
+    SPxScanIntegrator *GetIntegrator(void) { return m_integrator; }
+
+private:
+    SPxClutterMap *m_clutter;
+    std::string m_clutterArgs;
+    std::string m_clutterFile;
+    int m_clutterAzis;
+    int m_clutterLoaded;
+    SPxFilterChain *m_filter;
+    SPxFilterPluginChain *m_plugins;
+    SPxScanIntegrator *m_integrator;
+    std::string m_integrationArgs;
+    int m_integrationAzis;
+    std::vector<uint8_t> m_samples;
+    std::string m_error;
+    std::mutex m_mutex;		/* Guards Process() and saving */
+};
+
+#endif /* _SPX_SPOKE_PROCESS_H */
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
@@ -0,0 +1,554 @@
+/*********************************************************************
+*
+* File: SPxSpokeTelemetry.cpp
+*
+* Purpose:
+*	Receive telemetry for the streamers (see SPxSpokeTelemetry.h).
+*
+**********************************************************************/
+
+/* Standard headers. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#ifndef _WIN32
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#endif
+
+/* Our own header. */
+#include "SPxSpokeTelemetry.h"
+
+/*
+ * Constants.
+ */
+/* Defaults for the options. */
+#define	DEFAULT_REPORT_SECS	1
+#define	DEFAULT_GAP_FACTOR	1.5
+
+/* Azimuth units per turn. */
+#define	AZIMUTH_UNITS		65536.0
+
+/*
+ * Private function prototypes.
+ */
+static int64_t nowUsecs(void);
+
+
+/*********************************************************************
+*
+*	SPxSpokeTelemetry
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* SPxSpokeTelemetry::SPxSpokeTelemetry
+*	Constructor.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+SPxSpokeTelemetry::SPxSpokeTelemetry(void)
+    : m_spokeRate(5.0),
+      m_gapFactor(DEFAULT_GAP_FACTOR),
+      m_haveLast(0),
+      m_lastCount(0),
+      m_lastAzimuth(0),
+      m_countSeen(0),
+      m_numBytes(0),
+      m_numMissed(0),
+      m_numDuplicate(0),
+      m_numReordered(0),
+      m_numGaps(0),
+      m_maxGapDegrees(0.0),
+      m_totalMissed(0),
+      m_totalGaps(0),
+      m_prfSum(0.0),
+      m_numPrf(0),
+      m_crossed(0),
+      m_turnSpokes(0),
+      m_turnStartUsecs(0),
+      m_lastTurnSpokes(0),
+      m_rotationSecs(0.0),
+      m_numPackets(-1),
+      m_lastPackets(-1),
+      m_sourceLost(0),
+      m_lastStatsUsecs(nowUsecs())
+{
+} /* SPxSpokeTelemetry::SPxSpokeTelemetry() */
+
+
+/*====================================================================
+*
+* SPxSpokeTelemetry::~SPxSpokeTelemetry
+*	Destructor.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+SPxSpokeTelemetry::~SPxSpokeTelemetry()
+{
+} /* SPxSpokeTelemetry::~SPxSpokeTelemetry() */
+
+
+/*====================================================================
+*
+* SPxSpokeTelemetry::Add
+*	Add a spoke's header.
+*
+* Params:
+*	hdr			Spoke header as received.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Called on the receive thread.  A count that does not move at
+*	all is taken as one the source does not set, so nothing is
+*	counted as repeated until it has been seen to increment.  The
+*	gap is only known after the first full turn.
+*
+*===================================================================*/
+void SPxSpokeTelemetry::Add(const SPxReturnHeader *hdr)
+{
+    int64_t now = nowUsecs();
+    uint32_t bytes = hdr->totalSize;
+    if( bytes == 0 )
+    {
+	bytes = (uint32_t)hdr->headerSize + hdr->radarVideoSize;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_spokeRate.Add();
+    m_numBytes += bytes;
+    if( hdr->timeInterval > 0 )
+    {
+	unsigned int triggers = (hdr->numTriggers > 0) ? hdr->numTriggers : 1;
+	m_prfSum += (1000000.0 * triggers) / hdr->timeInterval;
+	m_numPrf++;
+    }
+    if( !m_haveLast )
+    {
+	m_haveLast = 1;
+	m_lastCount = hdr->count;
+	m_lastAzimuth = hdr->azimuth;
+	return;
+    }
+
+    /* 카운트: 1 이면 정상, 더 크면 놓침, 0 이면 중복, 뒤로 가면 순서 뒤바뀜 */
+    UINT16 countStep = (UINT16)(hdr->count - m_lastCount);
+    if( countStep == 1 )
+    {
+	m_countSeen = 1;
+    }
+    else if( countStep == 0 )
+    {
+	if( m_countSeen )
+	{
+	    m_numDuplicate++;
+	}
+    }
+    else if( countStep < 0x8000 )
+    {
+	m_countSeen = 1;
+	m_numMissed += countStep - 1u;
+	m_totalMissed += countStep - 1u;
+    }
+    else
+    {
+	m_numReordered++;
+    }
+    if( countStep < 0x8000 )
+    {
+	m_lastCount = hdr->count;
+    }
+
+    /* 방위: 어느 방향이든 북쪽을 지나면 한 바퀴 */
+    int16_t azStep = (int16_t)(UINT16)(hdr->azimuth - m_lastAzimuth);
+    unsigned int step = (azStep < 0) ? (unsigned int)(-azStep) : (unsigned int)azStep;
+    int crossed = ((azStep > 0) && (hdr->azimuth < m_lastAzimuth))
+	|| ((azStep < 0) && (hdr->azimuth > m_lastAzimuth));
+    m_lastAzimuth = hdr->azimuth;
+    if( (m_lastTurnSpokes > 0)
+	&& (step > (m_gapFactor * AZIMUTH_UNITS / m_lastTurnSpokes)) )
+    {
+	double degrees = step * 360.0 / AZIMUTH_UNITS;
+	m_numGaps++;
+	m_totalGaps++;
+	if( degrees > m_maxGapDegrees )
+	{
+	    m_maxGapDegrees = degrees;
+	}
+    }
+    m_turnSpokes++;
+    if( crossed )
+    {
+	if( m_crossed )
+	{
+	    m_lastTurnSpokes = m_turnSpokes;
+	    m_rotationSecs = (now - m_turnStartUsecs) / 1000000.0;
+	}
+	m_crossed = 1;
+	m_turnSpokes = 0;
+	m_turnStartUsecs = now;
+    }
+} /* SPxSpokeTelemetry::Add() */
+
+
+/*====================================================================
+*
+* SPxSpokeTelemetry::SetSourceTotals
+*	Set the source's own totals.
+*
+* Params:
+*	numPackets		Datagrams received, < 0 if not counted,
+*	numLost			Lost or bad, as the source counts them.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Called before GetStats(), e.g. from the main loop.
+*
+*===================================================================*/
+void SPxSpokeTelemetry::SetSourceTotals(int64_t numPackets, uint64_t numLost)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_numPackets = numPackets;
+    m_sourceLost = numLost;
+} /* SPxSpokeTelemetry::SetSourceTotals() */
+
+
+/*====================================================================
+*
+* SPxSpokeTelemetry::GetStats
+*	Read the statistics.
+*
+* Params:
+*	stats			Filled in.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	The counts and rates cover the time since the previous call.
+*
+*===================================================================*/
+void SPxSpokeTelemetry::GetStats(Stats *stats)
+{
+    int64_t now = nowUsecs();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    double secs = (now - m_lastStatsUsecs) / 1000000.0;
+    memset(stats, 0, sizeof(*stats));
+    stats->secs = secs;
+    stats->spokesPerSec = m_spokeRate.GetRateF(1.0);
+    stats->packetsPerSec = -1.0;
+    if( (m_numPackets >= 0) && (m_lastPackets >= 0) && (secs > 0.0) )
+    {
+	stats->packetsPerSec = (m_numPackets - m_lastPackets) / secs;
+    }
+    else if( m_numPackets >= 0 )
+    {
+	stats->packetsPerSec = 0.0;
+    }
+    stats->bytesPerSec = (secs > 0.0) ? (m_numBytes / secs) : 0.0;
+    stats->numMissed = m_numMissed;
+    stats->numDuplicate = m_numDuplicate;
+    stats->numReordered = m_numReordered;
+    stats->numGaps = m_numGaps;
+    stats->maxGapDegrees = m_maxGapDegrees;
+    stats->rotationSecs = m_rotationSecs;
+    stats->prfHz = (m_numPrf > 0) ? (m_prfSum / m_numPrf) : 0.0;
+    stats->totalMissed = m_totalMissed;
+    stats->totalGaps = m_totalGaps;
+    stats->sourceLost = m_sourceLost;
+
+    m_numBytes = 0;
+    m_numMissed = 0;
+    m_numDuplicate = 0;
+    m_numReordered = 0;
+    m_numGaps = 0;
+    m_maxGapDegrees = 0.0;
+    m_prfSum = 0.0;
+    m_numPrf = 0;
+    m_lastPackets = m_numPackets;
+    m_lastStatsUsecs = now;
+} /* SPxSpokeTelemetry::GetStats() */
+
+
+/*====================================================================
+*
+* SPxSpokeTelemetry::FormatLine
+*	Format a report line.
+*
+* Params:
+*	buf, bufLen		Buffer,
+*	app			Program name,
+*	channel			Channel number,
+*	stats			From GetStats().
+*
+* Returns:
+*	Length of the line (as snprintf()).
+*
+* Notes
+*	The line is "telemetry" and "key=value" fields separated by
+*	spaces (see SPxSpokeTelemetry.h), without a newline.
+*
+*===================================================================*/
+int SPxSpokeTelemetry::FormatLine(char *buf, size_t bufLen, const char *app,
+				  unsigned int channel, const Stats *stats)
+{
+    double wallSecs = std::chrono::duration_cast<std::chrono::milliseconds>(
+	std::chrono::system_clock::now().time_since_epoch()).count() / 1000.0;
+    char packets[32] = "-";
+    if( stats->packetsPerSec >= 0.0 )
+    {
+	snprintf(packets, sizeof(packets), "%.1f", stats->packetsPerSec);
+    }
+    double rpm = (stats->rotationSecs > 0.0) ? (60.0 / stats->rotationSecs) : 0.0;
+    return( snprintf(buf, bufLen, "telemetry t=%.3f app=%s ch=%u"
+		     " spokes_s=%.1f pkts_s=%s bytes_s=%.0f missed=%llu"
+		     " missed_total=%llu dup=%llu reorder=%llu gaps=%llu"
+		     " gaps_total=%llu max_gap_deg=%.3f period_s=%.3f"
+		     " rpm=%.2f prf_hz=%.1f src_lost=%llu",
+		     wallSecs, app, channel, stats->spokesPerSec, packets,
+		     stats->bytesPerSec,
+		     (unsigned long long)stats->numMissed,
+		     (unsigned long long)stats->totalMissed,
+		     (unsigned long long)stats->numDuplicate,
+		     (unsigned long long)stats->numReordered,
+		     (unsigned long long)stats->numGaps,
+		     (unsigned long long)stats->totalGaps,
+		     stats->maxGapDegrees, stats->rotationSecs, rpm,
+		     stats->prfHz, (unsigned long long)stats->sourceLost) );
+} /* SPxSpokeTelemetry::FormatLine() */
+
+
+/*********************************************************************
+*
+*	SPxTelemetryOutput
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* SPxTelemetryOutput::SPxTelemetryOutput
+*	Constructor.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+SPxTelemetryOutput::SPxTelemetryOutput(void)
+    : m_secs(DEFAULT_REPORT_SECS),
+      m_gapFactor(DEFAULT_GAP_FACTOR),
+      m_fd(-1)
+{
+} /* SPxTelemetryOutput::SPxTelemetryOutput() */
+
+
+/*====================================================================
+*
+* SPxTelemetryOutput::~SPxTelemetryOutput
+*	Destructor.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+SPxTelemetryOutput::~SPxTelemetryOutput()
+{
+#ifndef _WIN32
+    if( m_fd >= 0 )
+    {
+	close(m_fd);
+    }
+#endif
+} /* SPxTelemetryOutput::~SPxTelemetryOutput() */
+
+
+/*====================================================================
+*
+* SPxTelemetryOutput::Create
+*	Parse the destination and options.
+*
+* Params:
+*	spec			"stderr|<addr>:<port>[,option...]"
+*				(see SPxSpokeTelemetry.h).
+*
+* Returns:
+*	Zero on success, -1 on error.
+*
+* Notes
+*	A UDP destination is connected, so each line is one send().
+*
+*===================================================================*/
+int SPxTelemetryOutput::Create(const char *spec)
+{
+    std::string text = (spec != NULL) ? spec : "";
+    m_error = "invalid telemetry '" + text + "'";
+
+    size_t pos = text.find(',');
+    while( pos != std::string::npos )
+    {
+	size_t next = text.find(',', pos + 1);
+	std::string opt = text.substr(pos + 1, (next == std::string::npos)
+				      ? std::string::npos : (next - pos - 1));
+	size_t eq = opt.find('=');
+	if( eq == std::string::npos )
+	{
+	    return(-1);
+	}
+	std::string value = opt.substr(eq + 1);
+	opt = opt.substr(0, eq);
+	char *end = NULL;
+	double n = strtod(value.c_str(), &end);
+	if( value.empty() || (*end != '\0') )
+	{
+	    return(-1);
+	}
+	if( (opt == "secs") && (n >= 1.0) && (n <= 3600.0) && (n == (int)n) )
+	{
+	    m_secs = (unsigned int)n;
+	}
+	else if( (opt == "gap") && (n > 1.0) && (n <= 1000.0) )
+	{
+	    m_gapFactor = n;
+	}
+	else
+	{
+	    return(-1);
+	}
+	pos = next;
+    }
+
+    /* "stderr" 또는 "주소:포트" (UDP) */
+    std::string dest = text.substr(0, text.find(','));
+    if( dest == "stderr" )
+    {
+	m_error.clear();
+	return(0);
+    }
+    size_t colon = dest.rfind(':');
+    char *end = NULL;
+    long port = 0;
+    if( colon != std::string::npos )
+    {
+	port = strtol(dest.c_str() + colon + 1, &end, 10);
+    }
+    if( (colon == std::string::npos) || (colon == 0) || (*end != '\0')
+	|| (port < 1) || (port > 65535) )
+    {
+	return(-1);
+    }
+#ifdef _WIN32
+    m_error = "UDP telemetry is not supported on Windows, use 'stderr'";
+    return(-1);
+#else
+    struct sockaddr_in sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons((uint16_t)port);
+    if( inet_pton(AF_INET, dest.substr(0, colon).c_str(), &sa.sin_addr) != 1 )
+    {
+	return(-1);
+    }
+    m_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if( (m_fd < 0) || (connect(m_fd, (struct sockaddr *)&sa, sizeof(sa)) != 0) )
+    {
+	m_error = "cannot send telemetry to '" + dest + "'";
+	if( m_fd >= 0 )
+	{
+	    close(m_fd);
+	    m_fd = -1;
+	}
+	return(-1);
+    }
+    m_error.clear();
+    return(0);
+#endif
+} /* SPxTelemetryOutput::Create() */
+
+
+/*====================================================================
+*
+* SPxTelemetryOutput::Write
+*	Write a report line.
+*
+* Params:
+*	line			Line, without newline.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	A UDP line that cannot be sent (nobody listening) is dropped.
+*
+*===================================================================*/
+void SPxTelemetryOutput::Write(const char *line)
+{
+#ifndef _WIN32
+    if( m_fd >= 0 )
+    {
+	std::string datagram = std::string(line) + "\n";
+	(void)send(m_fd, datagram.c_str(), datagram.size(), MSG_DONTWAIT);
+	return;
+    }
+#endif
+    fprintf(stderr, "%s\n", line);
+} /* SPxTelemetryOutput::Write() */
+
+
+/*====================================================================
+*
+* nowUsecs
+*	Monotonic time.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Microseconds since an arbitrary point.
+*
+* Notes
+*
+*===================================================================*/
+static int64_t nowUsecs(void)
+{
+    return( std::chrono::duration_cast<std::chrono::microseconds>(
+	std::chrono::steady_clock::now().time_since_epoch()).count() );
+} /* nowUsecs() */
+
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
@@ -0,0 +1,167 @@
+/*********************************************************************
+*
+* File: SPxSpokeTelemetry.h
+*
+* Purpose:
+*	Receive telemetry for the streamers, from the fields of each
+*	spoke's SPxReturnHeader that the video output does not use:
+*
+*	    count		Returns missed (the count skips), repeated
+*				and out of order
+*	    azimuth		Gaps larger than the expected increment
+*				(a turn over the spokes in the last turn),
+*				and the rotation period (north crossings)
+*	    timeInterval	PRF (with numTriggers)
+*	    totalSize		Bytes per second
+*
+*	with spokes per second from an SPxRateCounter and, where the
+*	source counts them (native receive), datagrams per second.
+*
+*	Telemetry is given as "<dest>[,option...]", where dest is
+*	"stderr" or "<addr>:<port>" (one UDP datagram per line), with
+*	the options:
+*
+*	    secs=<n>		Seconds between lines (default 1)
+*	    gap=<factor>	Gap above this many expected increments
+*				(default 1.5)
+*
+*	Each report is one line per channel of "key=value" fields, never
+*	on stdout (which carries the video), e.g.
+*
+*	    telemetry t=1760860800.100 app=SPxLiveStream ch=0
+*	    spokes_s=4096.0 pkts_s=4096.0 bytes_s=4341760 missed=0
+*	    missed_total=0 dup=0 reorder=0 gaps=0 gaps_total=0
+*	    max_gap_deg=0.000 period_s=1.000 rpm=60.00 prf_hz=4096.0
+*	    src_lost=0
+*
+*	(on one line).  pkts_s is "-" when the source does not count
+*	datagrams, period_s/rpm 0 before the first full turn and prf_hz
+*	0 if the source does not set timeInterval.
+*
+**********************************************************************/
+
+#ifndef _SPX_SPOKE_TELEMETRY_H
+#define _SPX_SPOKE_TELEMETRY_H
+
+#include <stdint.h>
+#include <mutex>
+#include <string>
+
+/* SPx library types (SPxReturnHeader, SPxRateCounter). */
+#include "SPx.h"
+
+class SPxSpokeTelemetry
+{
+public:
+    /* Statistics since the previous GetStats() call. */
+    struct Stats
+    {
+	double secs;			/* Interval */
+	double spokesPerSec;		/* From the rate counter */
+	double packetsPerSec;		/* Datagrams, < 0 if not counted */
+	double bytesPerSec;		/* Return bytes */
+	uint64_t numMissed;		/* Counts skipped */
+	uint64_t numDuplicate;		/* Count repeated */
+	uint64_t numReordered;		/* Count went back */
+	uint64_t numGaps;		/* Azimuth jumps above the gap */
+	double maxGapDegrees;		/* Largest of them */
+	double rotationSecs;		/* Last full turn, 0 if none yet */
+	double prfHz;			/* Mean, 0 if not given */
+	uint64_t totalMissed;		/* Since Create() */
+	uint64_t totalGaps;
+	uint64_t sourceLost;		/* Source's own loss total */
+    };
+
+    /* Constructor/destructor. */
+    SPxSpokeTelemetry(void);
+    ~SPxSpokeTelemetry();
+
+    /* Set the gap factor (see above). */
+    void SetGapFactor(double gapFactor) { m_gapFactor = gapFactor; }
+
+    /* Add a spoke's header (on the receive thread). */
+    void Add(const SPxReturnHeader *hdr);
+
+    /* Set the source's own totals, datagrams received (< 0 if it does
+     * not count them) and lost.
+     */
+    void SetSourceTotals(int64_t numPackets, uint64_t numLost);
+
+    /* Read the statistics. */
+    void GetStats(Stats *stats);
+
+    /* Format a report line (without newline).  Returns the length. */
+    static int FormatLine(char *buf, size_t bufLen, const char *app,
+			  unsigned int channel, const Stats *stats);
+
+private:
+    /* Written by Add() and read by GetStats(), under the mutex. */
+    std::mutex m_mutex;
+    SPxRateCounter m_spokeRate;
+    double m_gapFactor;
+    int m_haveLast;
+    UINT16 m_lastCount;
+    UINT16 m_lastAzimuth;
+    int m_countSeen;			/* Count has been seen to increment */
+    uint64_t m_numBytes;
+    uint64_t m_numMissed;
+    uint64_t m_numDuplicate;
+    uint64_t m_numReordered;
+    uint64_t m_numGaps;
+    double m_maxGapDegrees;
+    uint64_t m_totalMissed;
+    uint64_t m_totalGaps;
+    double m_prfSum;
+    uint64_t m_numPrf;
+
+    /* Rotation: spokes and time since the last north crossing, and
+     * the spokes and time of the last full turn.
+     */
+    int m_crossed;
+    unsigned int m_turnSpokes;
+    int64_t m_turnStartUsecs;
+    unsigned int m_lastTurnSpokes;
+    double m_rotationSecs;
+
+    /* Source totals and those at the previous GetStats(). */
+    int64_t m_numPackets;
+    int64_t m_lastPackets;
+    uint64_t m_sourceLost;
+    int64_t m_lastStatsUsecs;
+};
+
+/* Where the report lines go. */
+class SPxTelemetryOutput
+{
+public:
+    /* Constructor/destructor. */
+    SPxTelemetryOutput(void);
+    ~SPxTelemetryOutput();
+
+    /* Parse the destination and options (see above).  Zero on success
+     * or -1 on error (see GetError()).
+     */
+    int Create(const char *spec);
+    const char *GetError(void) const { return m_error.c_str(); }
+
+    /* Options. */
+    unsigned int GetReportSecs(void) const { return m_secs; }
+    double GetGapFactor(void) const { return m_gapFactor; }
+
+    /* Write a line (without newline). */
+    void Write(const char *line);
+
+private:
+    std::string m_error;
+    unsigned int m_secs;
+    double m_gapFactor;
+    int m_fd;				/* UDP socket, -1 for stderr */
+};
+
+#endif /* _SPX_SPOKE_TELEMETRY_H */
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
@@ -0,0 +1,317 @@
+/*********************************************************************
+*
+* File: SPxStreamOutput.cpp
+*
+* Purpose:
+*	Multiplexed text output for the streamers (see SPxStreamOutput.h).
+*
+**********************************************************************/
+
+/* Standard headers. */
+#include <string.h>
+#include <chrono>
+
+/* Our own header. */
+#include "SPxStreamOutput.h"
+
+
+/*********************************************************************
+*
+*	Public functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* SPxStreamOutput::SPxStreamOutput
+*	Constructor, starting the writer thread.
+*
+* Params:
+*	file			Where to write, e.g. stdout,
+*	numChannels		Number of channels,
+*	maxLines		Most lines queued.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+SPxStreamOutput::SPxStreamOutput(FILE *file, unsigned int numChannels,
+				 unsigned int maxLines)
+    : m_file(file),
+      m_maxLines((maxLines > 0) ? maxLines : 1),
+      m_numQueued(0),
+      m_channels((numChannels > 0) ? numChannels : 1),
+      m_stop(0)
+{
+    memset(&m_channels[0], 0, m_channels.size() * sizeof(Channel));
+    m_queue.reserve(m_maxLines);
+    m_batch.reserve(m_maxLines);
+    m_thread = std::thread(&SPxStreamOutput::writerThread, this);
+} /* SPxStreamOutput::SPxStreamOutput() */
+
+
+/*====================================================================
+*
+* SPxStreamOutput::~SPxStreamOutput
+*	Destructor, writing the queued lines and stopping the writer.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+SPxStreamOutput::~SPxStreamOutput()
+{
+    {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_stop = 1;
+    }
+    m_ready.notify_one();
+    m_thread.join();
+} /* SPxStreamOutput::~SPxStreamOutput() */
+
+
+/*====================================================================
+*
+* SPxStreamOutput::Write
+*	Queue a line.
+*
+* Params:
+*	channel			Channel of the line,
+*	text, len		Line, including its newline,
+*	timeUsecs		Time to measure the latency from.
+*
+* Returns:
+*	Zero if queued, -1 if dropped (queue full or bad channel).
+*
+* Notes
+*	Never waits for the writer, and only allocates if the line is
+*	longer than the spare line's buffer (or there is none).
+*
+*===================================================================*/
+int SPxStreamOutput::Write(unsigned int channel, const char *text,
+			   size_t len, int64_t timeUsecs)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if( channel >= m_channels.size() )
+    {
+	return(-1);
+    }
+    if( m_numQueued >= m_maxLines )
+    {
+	m_channels[channel].numDropped++;
+	return(-1);
+    }
+
+    /* 남은 줄이 있으면 그 버퍼를 다시 씀 */
+    if( m_numQueued == m_queue.size() )
+    {
+	m_queue.push_back(Line());
+    }
+    Line *line = &m_queue[m_numQueued++];
+    line->channel = channel;
+    line->timeUsecs = timeUsecs;
+    line->text.assign(text, len);
+    int wake = (m_numQueued == 1);
+    lock.unlock();
+    if( wake )
+    {
+	m_ready.notify_one();
+    }
+    return(0);
+} /* SPxStreamOutput::Write() */
+
+
+/*====================================================================
+*
+* SPxStreamOutput::GetStats
+*	Read a channel's statistics.
+*
+* Params:
+*	channel			Channel,
+*	stats			Filled in.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Counts and latencies cover the lines since the previous call.
+*
+*===================================================================*/
+void SPxStreamOutput::GetStats(unsigned int channel, Stats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if( channel >= m_channels.size() )
+    {
+	return;
+    }
+    Channel *ch = &m_channels[channel];
+    stats->numLines = ch->numLines;
+    stats->numDropped = ch->numDropped;
+    stats->meanLatencyMs = (ch->numLines > 0)
+	? (ch->sumLatencyMs / (double)ch->numLines) : 0.0;
+    stats->maxLatencyMs = ch->maxLatencyMs;
+    memset(ch, 0, sizeof(*ch));
+} /* SPxStreamOutput::GetStats() */
+
+
+/*====================================================================
+*
+* SPxStreamOutput::GetHistogram
+*	Copy the latency histogram.
+*
+* Params:
+*	histogram		Set to a copy.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	The histogram covers every line written since construction.
+*
+*===================================================================*/
+void SPxStreamOutput::GetHistogram(SPxLatencyHistogram *histogram)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    *histogram = m_histogram;
+} /* SPxStreamOutput::GetHistogram() */
+
+
+/*====================================================================
+*
+* SPxStreamOutput::Prefault
+*	Allocate and fault in the queued lines' buffers.
+*
+* Params:
+*	lineBytes		Buffer size per line.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Both the queue and the writer's batch get m_maxLines lines, so
+*	a full queue never allocates.  Call before the first Write()
+*	(the writer is then waiting, not using its batch).
+*
+*===================================================================*/
+void SPxStreamOutput::Prefault(size_t lineBytes)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_queue.resize(m_maxLines);
+    m_batch.resize(m_maxLines);
+    for(size_t i = 0; i < m_maxLines; i++)
+    {
+	/* 버퍼를 채웠다 비워 용량은 남기고 페이지는 올려 둠 */
+	m_queue[i].text.assign(lineBytes, '\0');
+	m_queue[i].text.clear();
+	m_batch[i].text.assign(lineBytes, '\0');
+	m_batch[i].text.clear();
+    }
+} /* SPxStreamOutput::Prefault() */
+
+
+/*====================================================================
+*
+* SPxStreamOutput::NowUsecs
+*	Get the monotonic time.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Microseconds.
+*
+* Notes
+*
+*===================================================================*/
+int64_t SPxStreamOutput::NowUsecs(void)
+{
+    return( std::chrono::duration_cast<std::chrono::microseconds>(
+	std::chrono::steady_clock::now().time_since_epoch()).count() );
+} /* SPxStreamOutput::NowUsecs() */
+
+
+/*********************************************************************
+*
+*	Private functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* SPxStreamOutput::writerThread
+*	Write queued lines until stopped.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	The whole queue is taken at once, written and flushed, so the
+*	receive threads only wait for the swap.  The written lines stay
+*	in the batch, which becomes the queue at the next swap, so their
+*	buffers are reused.
+*
+*===================================================================*/
+void SPxStreamOutput::writerThread(void)
+{
+    size_t numBatch = 0;
+    for(;;)
+    {
+	{
+	    std::unique_lock<std::mutex> lock(m_mutex);
+	    while( (m_numQueued == 0) && !m_stop )
+	    {
+		m_ready.wait(lock);
+	    }
+	    if( m_numQueued == 0 )
+	    {
+		return;
+	    }
+	    m_batch.swap(m_queue);
+	    numBatch = m_numQueued;
+	    m_numQueued = 0;
+	}
+
+	for(size_t i = 0; i < numBatch; i++)
+	{
+	    fwrite(m_batch[i].text.data(), 1, m_batch[i].text.size(), m_file);
+	}
+	fflush(m_file);
+
+	/* 쓰기 완료 시점까지의 지연 */
+	int64_t now = NowUsecs();
+	{
+	    std::lock_guard<std::mutex> lock(m_mutex);
+	    for(size_t i = 0; i < numBatch; i++)
+	    {
+		Channel *ch = &m_channels[m_batch[i].channel];
+		int64_t usecs = now - m_batch[i].timeUsecs;
+		double ms = usecs / 1000.0;
+		ch->numLines++;
+		ch->sumLatencyMs += ms;
+		if( ms > ch->maxLatencyMs )
+		{
+		    ch->maxLatencyMs = ms;
+		}
+		m_histogram.Record(usecs);
+	    }
+	}
+    }
+} /* SPxStreamOutput::writerThread() */
+
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
@@ -0,0 +1,127 @@
+/*********************************************************************
+*
+* File: SPxStreamOutput.h
+*
+* Purpose:
+*	Multiplexed text output for the streamers' video lines.
+*
+*	Receive threads (one per channel) queue complete lines and a
+*	writer thread writes them to the file in batches, so a slow
+*	reader of the output or a busy channel does not hold up the
+*	other channels' receive threads.  The queue is bounded; a line
+*	that does not fit is dropped and counted against its channel.
+*
+*	Per-channel statistics: lines written and dropped, and latency
+*	from the time given with the line (normally when its spoke was
+*	received) to its write.  The latency of every line of all
+*	channels is also kept in a histogram.
+*
+*	Queued lines keep their buffers when written, so once the queue
+*	has been full (or Prefault() has been called) writing a line
+*	allocates nothing.  It does not depend on the SPx library.
+*
+**********************************************************************/
+
+#ifndef _SPX_STREAM_OUTPUT_H
+#define _SPX_STREAM_OUTPUT_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* Latency histogram. */
+#include "SPxLatencyHistogram.h"
+
+/* Lines queued before new ones are dropped. */
+#define	SPX_STREAM_OUTPUT_MAX_LINES	16384
+
+class SPxStreamOutput
+{
+public:
+    /* Statistics of one channel since the previous GetStats() call. */
+    struct Stats
+    {
+	uint64_t numLines;	/* Written */
+	uint64_t numDropped;	/* Queue full */
+	double meanLatencyMs;	/* Line time to written */
+	double maxLatencyMs;
+    };
+
+    /* Constructor/destructor.  The destructor writes the lines still
+     * queued.
+     */
+    SPxStreamOutput(FILE *file, unsigned int numChannels,
+		    unsigned int maxLines = SPX_STREAM_OUTPUT_MAX_LINES);
+    ~SPxStreamOutput();
+
+    /* Queue a line (including its newline) for a channel, with its
+     * time from NowUsecs().  Zero if queued, -1 if dropped.
+     */
+    int Write(unsigned int channel, const char *text, size_t len,
+	      int64_t timeUsecs);
+
+    /* Read a channel's statistics. */
+    void GetStats(unsigned int channel, Stats *stats);
+
+    /* Copy the latency histogram of all lines written. */
+    void GetHistogram(SPxLatencyHistogram *histogram);
+
+    /* Allocate and fault in every queued line's buffer, lineBytes
+     * each (before the first Write()).
+     */
+    void Prefault(size_t lineBytes);
+
+    /* The writer thread, e.g. to pin it. */
+    std::thread::native_handle_type GetWriterThread(void)
+    {
+	return m_thread.native_handle();
+    }
+
+    /* Monotonic time for Write(), in microseconds. */
+    static int64_t NowUsecs(void);
+
+private:
+    /* A queued line. */
+    struct Line
+    {
+	unsigned int channel;
+	int64_t timeUsecs;
+	std::string text;
+    };
+
+    /* Interval statistics of a channel. */
+    struct Channel
+    {
+	uint64_t numLines;
+	uint64_t numDropped;
+	double sumLatencyMs;
+	double maxLatencyMs;
+    };
+
+    FILE *m_file;
+    unsigned int m_maxLines;
+    std::thread m_thread;
+    std::mutex m_mutex;		/* Guards the queue, stats and m_stop */
+    std::condition_variable m_ready;
+    std::vector<Line> m_queue;		/* m_numQueued used, rest spare */
+    size_t m_numQueued;
+    std::vector<Line> m_batch;		/* Writer's, swapped with m_queue */
+    std::vector<Channel> m_channels;
+    SPxLatencyHistogram m_histogram;
+    int m_stop;
+
+    /* Private functions. */
+    void writerThread(void);
+};
+
+#endif /* _SPX_STREAM_OUTPUT_H */
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
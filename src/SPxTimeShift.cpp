@@ -0,0 +1,716 @@
+/*********************************************************************
+*
+* File: SPxTimeShift.cpp
+*
+* Purpose:
+*	Time-shift store for the spoke fan-out hub (see SPxTimeShift.h).
+*
+**********************************************************************/
+
+/* Standard headers. */
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+/* Our own header. */
+#include "SPxTimeShift.h"
+
+
+/*********************************************************************
+*
+*	Public functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* SPxTimeShift::SPxTimeShift
+*	Constructor.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Nothing is kept until Create() succeeds.
+*
+*===================================================================*/
+SPxTimeShift::SPxTimeShift(void)
+    : m_maxMs(0),
+      m_maxBytes((size_t)SPX_TIME_SHIFT_MB * 1024 * 1024),
+      m_maxBlockBytes(SPX_TIME_SHIFT_MAX_BLOCK_BYTES),
+      m_zlib(0),
+      m_nextId(0),
+      m_memBytes(0),
+      m_closedRawBytes(0),
+      m_closedBytes(0),
+      m_numSpokes(0),
+      m_numEvicted(0),
+      m_stop(0)
+{
+} /* SPxTimeShift::SPxTimeShift() */
+
+
+/*====================================================================
+*
+* SPxTimeShift::~SPxTimeShift
+*	Destructor.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+SPxTimeShift::~SPxTimeShift()
+{
+    {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_stop = 1;
+    }
+    m_ready.notify_one();
+    if( m_thread.joinable() )
+    {
+	m_thread.join();
+    }
+} /* SPxTimeShift::~SPxTimeShift() */
+
+
+/*====================================================================
+*
+* SPxTimeShift::Create
+*	Set up the store.
+*
+* Params:
+*	spec			"<minutes>[,option...]"
+*				(see SPxTimeShift.h).
+*
+* Returns:
+*	Zero on success, -1 on error.
+*
+* Notes
+*
+*===================================================================*/
+int SPxTimeShift::Create(const char *spec)
+{
+    if( m_thread.joinable() )
+    {
+	m_error = "time-shift store already created";
+	return(-1);
+    }
+    std::string text = (spec != NULL) ? spec : "";
+    m_error = "invalid time-shift store '" + text + "'";
+
+    /* 분 다음에 쉼표로 구분된 옵션 */
+    char *end = NULL;
+    double minutes = strtod(text.c_str(), &end);
+    if( (end == text.c_str()) || ((*end != '\0') && (*end != ','))
+	|| (minutes <= 0.0) || (minutes > 24.0 * 60.0) )
+    {
+	return(-1);
+    }
+    size_t pos = text.find(',');
+    while( pos != std::string::npos )
+    {
+	size_t next = text.find(',', pos + 1);
+	std::string opt = text.substr(pos + 1, (next == std::string::npos)
+				      ? std::string::npos : (next - pos - 1));
+	pos = next;
+	if( opt == "zlib" )
+	{
+	    m_zlib = 1;
+	    continue;
+	}
+	if( opt.compare(0, 3, "mb=") != 0 )
+	{
+	    return(-1);
+	}
+	unsigned long n = strtoul(opt.c_str() + 3, &end, 0);
+	if( (*end != '\0') || (n < 1) || (n > 65536) )
+	{
+	    return(-1);
+	}
+	m_maxBytes = (size_t)n * 1024 * 1024;
+    }
+    m_maxMs = (int64_t)(minutes * 60000.0);
+
+    /* 메모리가 적으면 블록도 작게 (최소 여러 블록) */
+    m_maxBlockBytes = m_maxBytes / 8;
+    if( m_maxBlockBytes > SPX_TIME_SHIFT_MAX_BLOCK_BYTES )
+    {
+	m_maxBlockBytes = SPX_TIME_SHIFT_MAX_BLOCK_BYTES;
+    }
+    m_spec = text;
+    m_error.clear();
+    m_thread = std::thread(&SPxTimeShift::compressThread, this);
+    return(0);
+} /* SPxTimeShift::Create() */
+
+
+/*====================================================================
+*
+* SPxTimeShift::Add
+*	Keep a spoke.
+*
+* Params:
+*	rec			Hub record,
+*	samples			Its rec->numSamples samples.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	The open block is closed on a turn of its first channel (the
+*	azimuth going back by more than half a turn), or when it is full
+*	or too long.  A new block reserves a little more than the last
+*	one took, so it rarely reallocates.
+*
+*===================================================================*/
+void SPxTimeShift::Add(const SPxSpokeHubRecord *rec,
+		       const unsigned char *samples)
+{
+    if( !m_thread.joinable() )
+    {
+	return;
+    }
+    size_t size = sizeof(SPxSpokeHubRecord) + rec->numSamples;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Block *block = m_blocks.empty() ? NULL : m_blocks.back().get();
+    if( (block != NULL) && !block->closed )
+    {
+	int turned = (rec->channel == block->turnChannel)
+	    && (rec->azimuth < block->lastAzimuth)
+	    && ((block->lastAzimuth - rec->azimuth) > 32768);
+	if( turned || (block->rawBytes + size > m_maxBlockBytes)
+	    || (rec->timeMs - block->startMs
+		> (int64_t)SPX_TIME_SHIFT_MAX_BLOCK_SECS * 1000) )
+	{
+	    closeBlock();
+	}
+    }
+    if( (block == NULL) || block->closed )
+    {
+	size_t reserve = (block != NULL) ? (block->rawBytes + block->rawBytes / 8) : 0;
+	std::shared_ptr<Block> open(new Block());
+	open->id = m_nextId++;
+	open->startMs = rec->timeMs;
+	open->endMs = rec->timeMs;
+	open->numSpokes = 0;
+	open->rawBytes = 0;
+	open->closed = 0;
+	open->packed = 0;
+	open->compressed = 0;
+	open->turnChannel = rec->channel;
+	open->lastAzimuth = rec->azimuth;
+	open->data.reserve((reserve < m_maxBlockBytes) ? reserve : m_maxBlockBytes);
+	m_memBytes += open->data.capacity();
+	m_blocks.push_back(open);
+	block = open.get();
+    }
+
+    /* 레코드와 샘플을 이어 붙임 (재생 표시 magic 으로) */
+    size_t capacity = block->data.capacity();
+    size_t offset = block->data.size();
+    block->data.resize(offset + size);
+    SPxSpokeHubRecord out = *rec;
+    out.magic = SPX_SPOKE_HUB_MAGIC_SHIFTED;
+    out.numCoalesced = 0;
+    out.lag = 0;
+    memcpy(&block->data[offset], &out, sizeof(out));
+    if( rec->numSamples > 0 )
+    {
+	memcpy(&block->data[offset + sizeof(out)], samples, rec->numSamples);
+    }
+    m_memBytes += block->data.capacity() - capacity;
+    block->endMs = rec->timeMs;
+    block->numSpokes++;
+    block->rawBytes += size;
+    if( rec->channel == block->turnChannel )
+    {
+	block->lastAzimuth = rec->azimuth;
+    }
+    m_numSpokes++;
+    evict();
+} /* SPxTimeShift::Add() */
+
+
+/*====================================================================
+*
+* SPxTimeShift::GetNewestMs
+*	Get the newest spoke's time.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Milliseconds since the epoch, 0 if empty.
+*
+* Notes
+*
+*===================================================================*/
+int64_t SPxTimeShift::GetNewestMs(void)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return( m_blocks.empty() ? 0 : m_blocks.back()->endMs );
+} /* SPxTimeShift::GetNewestMs() */
+
+
+/*====================================================================
+*
+* SPxTimeShift::Seek
+*	Position a cursor one turn before a time.
+*
+* Params:
+*	timeMs			Time, ms since the epoch,
+*	cursor			Cursor to position.
+*
+* Returns:
+*	Zero on success, -1 if the store is empty.
+*
+* Notes
+*	The turn is the length of the block before the one holding the
+*	time (that block may not be complete).  Only the block found is
+*	inflated, then its spokes before the turn are skipped.
+*
+*===================================================================*/
+int SPxTimeShift::Seek(int64_t timeMs, Cursor *cursor)
+{
+    std::shared_ptr<Block> block;
+    int64_t fromMs = timeMs;
+    {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if( m_blocks.empty() )
+	{
+	    return(-1);
+	}
+	long idx = findTime(timeMs);
+	const Block *turn = m_blocks[(idx > 0) ? (idx - 1) : idx].get();
+	fromMs = timeMs - (turn->endMs - turn->startMs);
+	block = m_blocks[findTime(fromMs)];
+    }
+    cursor->numLapped = 0;
+    load(cursor, block);
+
+    const unsigned char *samples = NULL;
+    const SPxSpokeHubRecord *rec = NULL;
+    while( ((rec = Peek(cursor, &samples)) != NULL) && (rec->timeMs < fromMs) )
+    {
+	Next(cursor);
+    }
+    return(0);
+} /* SPxTimeShift::Seek() */
+
+
+/*====================================================================
+*
+* SPxTimeShift::Peek
+*	Get a cursor's next spoke.
+*
+* Params:
+*	cursor			Cursor,
+*	samples			Set to the spoke's samples.
+*
+* Returns:
+*	The record, or NULL if the cursor is at the newest spoke.
+*
+* Notes
+*	At the end of its block the cursor copies what has since been
+*	added to an open block, or moves to the next block (the oldest
+*	kept, if the next was evicted before it was read).
+*
+*===================================================================*/
+const SPxSpokeHubRecord *SPxTimeShift::Peek(Cursor *cursor,
+					    const unsigned char **samples)
+{
+    for(;;)
+    {
+	if( cursor->offset + sizeof(SPxSpokeHubRecord) <= cursor->numBytes )
+	{
+	    /* 블록 안의 레코드는 정렬되지 않았을 수 있어 복사 */
+	    memcpy(&cursor->rec, cursor->bytes + cursor->offset,
+		   sizeof(cursor->rec));
+	    *samples = cursor->bytes + cursor->offset + sizeof(cursor->rec);
+	    return(&cursor->rec);
+	}
+	if( !cursor->block )
+	{
+	    return(NULL);
+	}
+
+	std::shared_ptr<Block> next;
+	{
+	    std::lock_guard<std::mutex> lock(m_mutex);
+	    const Block *block = cursor->block.get();
+	    if( cursor->copying && (block->data.size() > cursor->buffer.size()) )
+	    {
+		cursor->buffer.insert(cursor->buffer.end(),
+				      block->data.begin() + cursor->buffer.size(),
+				      block->data.end());
+		cursor->bytes = &cursor->buffer[0];
+		cursor->numBytes = cursor->buffer.size();
+		continue;
+	    }
+	    if( !block->closed || m_blocks.empty() )
+	    {
+		return(NULL);
+	    }
+	    uint64_t id = block->id + 1;
+	    long idx = findBlock(id);
+	    if( idx < 0 )
+	    {
+		if( id > m_blocks.back()->id )
+		{
+		    return(NULL);
+		}
+		cursor->numLapped += m_blocks.front()->id - id;
+		idx = 0;
+	    }
+	    next = m_blocks[idx];
+	}
+	load(cursor, next);
+    }
+} /* SPxTimeShift::Peek() */
+
+
+/*====================================================================
+*
+* SPxTimeShift::Next
+*	Move a cursor past the spoke Peek() returned.
+*
+* Params:
+*	cursor			Cursor.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+void SPxTimeShift::Next(Cursor *cursor)
+{
+    cursor->offset += sizeof(cursor->rec) + cursor->rec.numSamples;
+} /* SPxTimeShift::Next() */
+
+
+/*====================================================================
+*
+* SPxTimeShift::GetStats
+*	Read the statistics.
+*
+* Params:
+*	stats			Filled in.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+void SPxTimeShift::GetStats(Stats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if( !m_blocks.empty() )
+    {
+	stats->oldestMs = m_blocks.front()->startMs;
+	stats->newestMs = m_blocks.back()->endMs;
+    }
+    stats->numBlocks = (unsigned int)m_blocks.size();
+    stats->memBytes = m_memBytes;
+    stats->maxBytes = m_maxBytes;
+    stats->compression = (m_closedRawBytes > 0)
+	? ((double)m_closedBytes / (double)m_closedRawBytes) : 1.0;
+    stats->numSpokes = m_numSpokes;
+    stats->numEvicted = m_numEvicted;
+} /* SPxTimeShift::GetStats() */
+
+
+/*********************************************************************
+*
+*	Private functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* SPxTimeShift::compressThread
+*	Pack closed blocks until stopped.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	A packed copy of the block (zlib if that is smaller, otherwise
+*	the spokes without spare capacity) replaces it, unless it was
+*	evicted meanwhile.  Readers of the old copy keep it until done.
+*
+*===================================================================*/
+void SPxTimeShift::compressThread(void)
+{
+    std::vector<unsigned char> packed;
+    for(;;)
+    {
+	std::shared_ptr<Block> block;
+	{
+	    std::unique_lock<std::mutex> lock(m_mutex);
+	    while( m_toCompress.empty() && !m_stop )
+	    {
+		m_ready.wait(lock);
+	    }
+	    if( m_stop )
+	    {
+		return;
+	    }
+	    long idx = findBlock(m_toCompress.front());
+	    m_toCompress.pop_front();
+	    if( idx < 0 )
+	    {
+		continue;
+	    }
+	    block = m_blocks[idx];
+	}
+
+	/* 잠금 밖에서 압축 (닫힌 블록은 바뀌지 않음) */
+	std::shared_ptr<Block> out(new Block());
+	out->id = block->id;
+	out->startMs = block->startMs;
+	out->endMs = block->endMs;
+	out->numSpokes = block->numSpokes;
+	out->rawBytes = block->rawBytes;
+	out->closed = 1;
+	out->packed = 1;
+	out->compressed = 0;
+	out->turnChannel = block->turnChannel;
+	out->lastAzimuth = block->lastAzimuth;
+	uLongf packedLen = 0;
+	if( m_zlib && !block->data.empty() )
+	{
+	    packed.resize(compressBound((uLong)block->data.size()));
+	    packedLen = (uLongf)packed.size();
+	    if( (compress2(&packed[0], &packedLen, &block->data[0],
+			   (uLong)block->data.size(), Z_BEST_SPEED) != Z_OK)
+		|| (packedLen >= block->data.size()) )
+	    {
+		packedLen = 0;
+	    }
+	}
+	if( packedLen > 0 )
+	{
+	    out->data.assign(packed.begin(), packed.begin() + packedLen);
+	    out->compressed = 1;
+	}
+	else
+	{
+	    out->data.assign(block->data.begin(), block->data.end());
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	long idx = findBlock(out->id);
+	if( (idx >= 0) && (m_blocks[idx] == block) )
+	{
+	    m_memBytes -= block->data.capacity();
+	    m_memBytes += out->data.capacity();
+	    m_closedRawBytes += out->rawBytes;
+	    m_closedBytes += out->data.size();
+	    m_blocks[idx] = out;
+	}
+    }
+} /* SPxTimeShift::compressThread() */
+
+
+/*====================================================================
+*
+* SPxTimeShift::closeBlock
+*	Close the open block and queue it to be packed.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Called with m_mutex held.
+*
+*===================================================================*/
+void SPxTimeShift::closeBlock(void)
+{
+    Block *block = m_blocks.back().get();
+    block->closed = 1;
+    m_toCompress.push_back(block->id);
+    m_ready.notify_one();
+} /* SPxTimeShift::closeBlock() */
+
+
+/*====================================================================
+*
+* SPxTimeShift::evict
+*	Drop the oldest blocks beyond the minutes or memory given.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Called with m_mutex held.  The open block is never dropped.
+*
+*===================================================================*/
+void SPxTimeShift::evict(void)
+{
+    int64_t newestMs = m_blocks.empty() ? 0 : m_blocks.back()->endMs;
+    while( (m_blocks.size() > 1)
+	   && ((m_memBytes > m_maxBytes)
+	       || (m_blocks.front()->endMs < newestMs - m_maxMs)) )
+    {
+	const Block *block = m_blocks.front().get();
+	m_memBytes -= block->data.capacity();
+	if( block->packed )
+	{
+	    m_closedRawBytes -= block->rawBytes;
+	    m_closedBytes -= block->data.size();
+	}
+	m_blocks.pop_front();
+	m_numEvicted++;
+    }
+} /* SPxTimeShift::evict() */
+
+
+/*====================================================================
+*
+* SPxTimeShift::findBlock
+*	Find a block by id.
+*
+* Params:
+*	id			Block id.
+*
+* Returns:
+*	Its index in m_blocks, or -1 if not kept.
+*
+* Notes
+*	Called with m_mutex held.  Ids are consecutive.
+*
+*===================================================================*/
+long SPxTimeShift::findBlock(uint64_t id) const
+{
+    if( m_blocks.empty() || (id < m_blocks.front()->id) )
+    {
+	return(-1);
+    }
+    uint64_t idx = id - m_blocks.front()->id;
+    return( (idx < m_blocks.size()) ? (long)idx : -1 );
+} /* SPxTimeShift::findBlock() */
+
+
+/*====================================================================
+*
+* SPxTimeShift::findTime
+*	Find the block holding a time.
+*
+* Params:
+*	timeMs			Time, ms since the epoch.
+*
+* Returns:
+*	Index in m_blocks of the last block starting at or before the
+*	time (the oldest if the time is before them all).
+*
+* Notes
+*	Called with m_mutex held and m_blocks not empty.  Binary search,
+*	as the blocks are in time order.
+*
+*===================================================================*/
+long SPxTimeShift::findTime(int64_t timeMs) const
+{
+    long lo = 0;
+    long hi = (long)m_blocks.size() - 1;
+    while( lo < hi )
+    {
+	long mid = (lo + hi + 1) / 2;
+	if( m_blocks[mid]->startMs <= timeMs )
+	{
+	    lo = mid;
+	}
+	else
+	{
+	    hi = mid - 1;
+	}
+    }
+    return(lo);
+} /* SPxTimeShift::findTime() */
+
+
+/*====================================================================
+*
+* SPxTimeShift::load
+*	Start a cursor at a block's first spoke.
+*
+* Params:
+*	cursor			Cursor,
+*	block			Block.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Called without m_mutex.  An open block is copied as it is (and
+*	Peek() copies what is added later); a closed one is read in
+*	place, or inflated into the cursor's buffer.  A block that
+*	fails to inflate reads as empty.
+*
+*===================================================================*/
+void SPxTimeShift::load(Cursor *cursor, const std::shared_ptr<Block> &block)
+{
+    cursor->block = block;
+    cursor->offset = 0;
+    cursor->copying = 0;
+    cursor->bytes = NULL;
+    cursor->numBytes = 0;
+    {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if( !block->closed )
+	{
+	    cursor->copying = 1;
+	    cursor->buffer.assign(block->data.begin(), block->data.end());
+	}
+    }
+    if( cursor->copying )
+    {
+	cursor->bytes = cursor->buffer.empty() ? NULL : &cursor->buffer[0];
+	cursor->numBytes = cursor->buffer.size();
+    }
+    else if( !block->compressed )
+    {
+	cursor->bytes = block->data.empty() ? NULL : &block->data[0];
+	cursor->numBytes = block->data.size();
+    }
+    else
+    {
+	/* 회전 하나만 풀어서 탐색이 빠름 */
+	cursor->buffer.resize(block->rawBytes);
+	uLongf len = (uLongf)block->rawBytes;
+	if( (block->rawBytes > 0)
+	    && (uncompress(&cursor->buffer[0], &len, &block->data[0],
+			   (uLong)block->data.size()) == Z_OK) )
+	{
+	    cursor->bytes = &cursor->buffer[0];
+	    cursor->numBytes = len;
+	}
+    }
+} /* SPxTimeShift::load() */
+
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
@@ -0,0 +1,172 @@
+/*********************************************************************
+*
+* File: SPxTimeShift.h
+*
+* Purpose:
+*	Time-shift store for the spoke fan-out hub: the last minutes of
+*	spokes are kept in memory, so a subscriber can rewind the live
+*	picture without a recording (see SPxSpokeHub.h).
+*
+*	A store is given as "<minutes>[,option...]" with the options:
+*
+*	    mb=<n>		Memory for the spokes (default 256)
+*	    zlib		Compress each rotation once it is complete
+*
+*	Spokes are kept as hub records with their samples, one block per
+*	rotation (a turn of the block's first channel), so a block is
+*	compressed, looked up by time and evicted as a whole.  Blocks
+*	older than the minutes given, or beyond the memory, are evicted
+*	oldest first.  A block is also closed early at SPX_TIME_SHIFT_
+*	MAX_BLOCK_BYTES (or an eighth of the memory): seeking inflates
+*	one block before the first spoke goes out, about 5 ms per MB,
+*	so this keeps a seek well under 50 ms.
+*
+*	Compression runs on a thread of its own.  Readers hold their
+*	block, so eviction never pulls data from under them.  The store
+*	does not depend on the SPx library.
+*
+**********************************************************************/
+
+#ifndef _SPX_TIME_SHIFT_H
+#define _SPX_TIME_SHIFT_H
+
+#include <stdint.h>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* Hub record kept with each spoke. */
+#include "SPxSpokeHub.h"
+
+/* Default memory, and the largest block (raw bytes) and time a block
+ * is left open without a turn.
+ */
+#define	SPX_TIME_SHIFT_MB		256
+#define	SPX_TIME_SHIFT_MAX_BLOCK_BYTES	(4 * 1024 * 1024)
+#define	SPX_TIME_SHIFT_MAX_BLOCK_SECS	60
+
+class SPxTimeShift
+{
+    /* A block of spokes (records with their samples), immutable once
+     * closed.
+     */
+    struct Block
+    {
+	uint64_t id;			/* Consecutive from the first */
+	int64_t startMs, endMs;		/* Of its first and last spoke */
+	uint32_t numSpokes;
+	size_t rawBytes;		/* Before compression */
+	int closed;
+	int packed;			/* Trimmed or compressed */
+	int compressed;			/* data is zlib */
+	uint16_t turnChannel;		/* Channel that closes it */
+	uint16_t lastAzimuth;		/* Of turnChannel */
+	std::vector<unsigned char> data;
+    };
+
+public:
+    /* Statistics; counts are totals. */
+    struct Stats
+    {
+	int64_t oldestMs, newestMs;	/* Times covered, 0 if empty */
+	unsigned int numBlocks;
+	size_t memBytes;		/* Held by the blocks */
+	size_t maxBytes;		/* Memory given */
+	double compression;		/* Stored / raw bytes, closed blocks */
+	uint64_t numSpokes;		/* Added */
+	uint64_t numEvicted;		/* Blocks */
+    };
+
+    /* A reader's position.  Only touched by its reader. */
+    struct Cursor
+    {
+	std::shared_ptr<const Block> block;
+	SPxSpokeHubRecord rec;		/* Copy of the next record */
+	std::vector<unsigned char> buffer;	/* Inflated or copied */
+	int copying;			/* Block was open: buffer is a copy */
+	const unsigned char *bytes;	/* Block's spokes */
+	size_t numBytes;
+	size_t offset;			/* Next record */
+	uint64_t numLapped;		/* Blocks evicted before read */
+    };
+
+    /* Constructor/destructor. */
+    SPxTimeShift(void);
+    ~SPxTimeShift();
+
+    /* Set up the store (see above) and start the compression thread.
+     * Zero on success or -1 on error (see GetError()).
+     */
+    int Create(const char *spec);
+    const char *GetError(void) const { return m_error.c_str(); }
+    const char *GetSpec(void) const { return m_spec.c_str(); }
+
+    /* Add a spoke (from one thread).  It is kept with the magic
+     * SPX_SPOKE_HUB_MAGIC_SHIFTED.  Readers' cursors hold their own
+     * copies, apart from the memory given.
+     */
+    void Add(const SPxSpokeHubRecord *rec, const unsigned char *samples);
+
+    /* Newest spoke time, 0 if empty. */
+    int64_t GetNewestMs(void);
+
+    /* Position a cursor one turn before a time (clamped to what is
+     * kept), so a reader can draw a whole picture for that time at
+     * once.  Zero on success or -1 if the store is empty.
+     */
+    int Seek(int64_t timeMs, Cursor *cursor);
+
+    /* The cursor's next spoke, or NULL when it is at the newest.  The
+     * record and samples stay valid until Next() or Seek().
+     */
+    const SPxSpokeHubRecord *Peek(Cursor *cursor, const unsigned char **samples);
+    void Next(Cursor *cursor);
+
+    /* Read the statistics. */
+    void GetStats(Stats *stats);
+
+private:
+    /* Store. */
+    std::string m_spec;
+    std::string m_error;
+    int64_t m_maxMs;			/* Minutes given */
+    size_t m_maxBytes;
+    size_t m_maxBlockBytes;
+    int m_zlib;
+    std::thread m_thread;
+
+    /* Blocks, oldest first (the newest open), and what is waiting to be
+     * packed, guarded by the mutex.
+     */
+    std::mutex m_mutex;
+    std::condition_variable m_ready;
+    std::deque<std::shared_ptr<Block> > m_blocks;
+    std::deque<uint64_t> m_toCompress;
+    uint64_t m_nextId;
+    size_t m_memBytes;
+    size_t m_closedRawBytes;		/* For the compression ratio */
+    size_t m_closedBytes;
+    uint64_t m_numSpokes;
+    uint64_t m_numEvicted;
+    int m_stop;
+
+    /* Private functions. */
+    void compressThread(void);
+    void closeBlock(void);
+    void evict(void);
+    long findBlock(uint64_t id) const;
+    long findTime(int64_t timeMs) const;
+    void load(Cursor *cursor, const std::shared_ptr<Block> &block);
+};
+
+#endif /* _SPX_TIME_SHIFT_H */
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
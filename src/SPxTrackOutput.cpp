@@ -0,0 +1,382 @@
+/*********************************************************************
+*
+* File: SPxTrackOutput.cpp
+*
+* Purpose:
+*	Track output for the streamers (see SPxTrackOutput.h).
+*
+**********************************************************************/
+
+/* Standard headers. */
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+/* Our own header. */
+#include "SPxTrackOutput.h"
+
+/*
+ * Constants.
+ */
+#define	NO_AZI		0xFFFFFFFFu	/* No return seen yet */
+
+static const char FileMagic[8] = { 'S', 'P', 'X', 'T', 'R', 'A', 'K', '1' };
+
+
+/*********************************************************************
+*
+*	Public functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* SPxTrackOutput::SPxTrackOutput
+*	Constructor.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Nothing is output until Create() succeeds.
+*
+*===================================================================*/
+SPxTrackOutput::SPxTrackOutput(void)
+    : m_csv(0), m_file(NULL), m_sender(NULL), m_totalReports(0),
+      m_lastAzi(NO_AZI), m_wrapped(0), m_scanCpuMs(0.0), m_scanTracks(0),
+      m_numTracks(0), m_numScans(0), m_sumCpuMs(0.0), m_maxCpuMs(0.0)
+{
+} /* SPxTrackOutput::SPxTrackOutput() */
+
+
+/*====================================================================
+*
+* SPxTrackOutput::~SPxTrackOutput
+*	Destructor.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	The tracker reporting to us must have been deleted.
+*
+*===================================================================*/
+SPxTrackOutput::~SPxTrackOutput()
+{
+    delete m_sender;
+    if( m_file != NULL )
+    {
+	fclose(m_file);
+    }
+} /* SPxTrackOutput::~SPxTrackOutput() */
+
+
+/*====================================================================
+*
+* SPxTrackOutput::Create
+*	Open the track file and/or the packet destination.
+*
+* Params:
+*	filename		Track file (CSV if it ends in ".csv"),
+*				or NULL,
+*	destination		"<address>:<port>" for track packets,
+*				or NULL.
+*
+* Returns:
+*	Zero on success, -1 on error.
+*
+* Notes
+*
+*===================================================================*/
+int SPxTrackOutput::Create(const char *filename, const char *destination)
+{
+    if( ((filename == NULL) && (destination == NULL))
+	|| (m_file != NULL) || (m_sender != NULL) )
+    {
+	m_error = "no track output";
+	return(-1);
+    }
+
+    /* 목적지 "주소:포트" 확인 */
+    std::string address;
+    long port = 0;
+    if( destination != NULL )
+    {
+	std::string text = destination;
+	size_t colon = text.rfind(':');
+	char *end = NULL;
+	if( colon != std::string::npos )
+	{
+	    port = strtol(text.c_str() + colon + 1, &end, 10);
+	}
+	if( (colon == std::string::npos) || (colon == 0) || (*end != '\0')
+	    || (port < 1) || (port > 65535) )
+	{
+	    m_error = "invalid track destination '" + text + "'";
+	    return(-1);
+	}
+	address = text.substr(0, colon);
+    }
+
+    FILE *fp = NULL;
+    int csv = 0;
+    if( filename != NULL )
+    {
+	size_t len = strlen(filename);
+	csv = (len >= 4) && (strcmp(filename + len - 4, ".csv") == 0);
+	fp = fopen(filename, csv ? "w" : "wb");
+	if( fp == NULL )
+	{
+	    m_error = std::string("cannot open track file '") + filename + "'";
+	    return(-1);
+	}
+	if( csv )
+	{
+	    fprintf(fp, "time_ms,id,active,range_m,azimuth_deg,x_m,y_m,"
+		    "speed_mps,course_deg,coasts,plots\n");
+	}
+	else
+	{
+	    fwrite(FileMagic, sizeof(FileMagic), 1, fp);
+	}
+    }
+
+    if( destination != NULL )
+    {
+	SPxPacketSender *sender = new SPxPacketSender();
+	if( sender->SetAddress(address.c_str(), (int)port) != SPX_NO_ERROR )
+	{
+	    delete sender;
+	    if( fp != NULL )
+	    {
+		fclose(fp);
+	    }
+	    m_error = std::string("cannot send tracks to '") + destination + "'";
+	    return(-1);
+	}
+	m_sender = sender;
+    }
+
+    m_csv = csv;
+    m_file = fp;
+    return(0);
+} /* SPxTrackOutput::Create() */
+
+
+/*====================================================================
+*
+* SPxTrackOutput::ReportFn
+*	Track report callback installed on the tracker.
+*
+* Params:
+*	invokingObject		The SPxTracker,
+*	userObject		The SPxTrackOutput,
+*	arg			The SPxTrack_t.
+*
+* Returns:
+*	Zero.
+*
+* Notes
+*
+*===================================================================*/
+int SPxTrackOutput::ReportFn(void *invokingObject, void *userObject, void *arg)
+{
+    if( (userObject != NULL) && (arg != NULL) )
+    {
+	((SPxTrackOutput *)userObject)->writeTrack((const SPxTrack_t *)arg);
+    }
+    return(0);
+} /* SPxTrackOutput::ReportFn() */
+
+
+/*====================================================================
+*
+* SPxTrackOutput::AddTrackerTime
+*	Account tracker CPU time.
+*
+* Params:
+*	firstAzi		First PIM azimuth processed,
+*	cpuMs			Tracker CPU time for these returns.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	A scan ends when the PIM azimuth goes backwards.  The partial
+*	scan before the first such wrap is not counted.
+*
+*===================================================================*/
+void SPxTrackOutput::AddTrackerTime(unsigned int firstAzi, double cpuMs)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if( (m_lastAzi != NO_AZI) && (firstAzi < m_lastAzi) )
+    {
+	/* 첫 랩 전의 부분 스캔은 버림 */
+	if( m_wrapped )
+	{
+	    m_numScans++;
+	    m_sumCpuMs += m_scanCpuMs;
+	    if( m_scanCpuMs > m_maxCpuMs )
+	    {
+		m_maxCpuMs = m_scanCpuMs;
+	    }
+	    m_numTracks = m_scanTracks;
+	}
+	m_wrapped = 1;
+	m_scanCpuMs = 0.0;
+	m_scanTracks = 0;
+    }
+    m_scanCpuMs += cpuMs;
+    m_lastAzi = firstAzi;
+} /* SPxTrackOutput::AddTrackerTime() */
+
+
+/*====================================================================
+*
+* SPxTrackOutput::GetStats
+*	Flush the track file and read the statistics.
+*
+* Params:
+*	stats			Filled in.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	CPU times cover the whole scans since the previous call.
+*
+*===================================================================*/
+void SPxTrackOutput::GetStats(Stats *stats)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    stats->totalReports = m_totalReports;
+    stats->numTracks = m_numTracks;
+    stats->numScans = m_numScans;
+    stats->meanCpuMs = (m_numScans > 0) ? m_sumCpuMs / m_numScans : 0.0;
+    stats->maxCpuMs = m_maxCpuMs;
+
+    if( m_file != NULL )
+    {
+	fflush(m_file);
+    }
+    m_numScans = 0;
+    m_sumCpuMs = 0.0;
+    m_maxCpuMs = 0.0;
+} /* SPxTrackOutput::GetStats() */
+
+
+/*********************************************************************
+*
+*	Private functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* SPxTrackOutput::writeTrack
+*	Write a track report and update the statistics.
+*
+* Params:
+*	track			Report from the tracker.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+void SPxTrackOutput::writeTrack(const SPxTrack_t *track)
+{
+    SPxTrackRecord rec;
+    if( track->timestamp.secs != 0 )
+    {
+	rec.timeMsecs = ((int64_t)track->timestamp.secs * 1000)
+	    + (track->timestamp.usecs / 1000);
+    }
+    else
+    {
+	rec.timeMsecs = std::chrono::duration_cast<std::chrono::milliseconds>(
+	    std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+    rec.id = track->id;
+    rec.active = track->active ? 1 : 0;
+    rec.rangeMetres = track->rangeMetres;
+    rec.azimuthDegrees = track->azimuthDegrees;
+    rec.xMetres = track->xMetres;
+    rec.yMetres = track->yMetres;
+    rec.speedMps = track->speedMps;
+    rec.courseDegrees = track->courseDegrees;
+    rec.coastingCount = track->coastingCount;
+    rec.numBlobs = track->numBlobs;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if( m_file != NULL )
+    {
+	if( m_csv )
+	{
+	    fprintf(m_file, "%lld,%u,%u,%.1f,%.3f,%.1f,%.1f,%.2f,%.2f,%u,%u\n",
+		    (long long)rec.timeMsecs, rec.id, rec.active,
+		    rec.rangeMetres, rec.azimuthDegrees, rec.xMetres, rec.yMetres,
+		    rec.speedMps, rec.courseDegrees, rec.coastingCount,
+		    rec.numBlobs);
+	}
+	else
+	{
+	    fwrite(&rec, sizeof(rec), 1, m_file);
+	}
+    }
+
+    if( m_sender != NULL )
+    {
+	SPxPacketTrackNormal pkt;
+	memset(&pkt, 0, sizeof(pkt));
+	pkt.min.id = rec.id;
+	pkt.min.status = rec.active ? SPX_PACKET_TRACK_STATUS_ESTABLISHED
+				    : SPX_PACKET_TRACK_STATUS_DELETED;
+	pkt.min.numCoasts = (UINT8)((rec.coastingCount > 255) ? 255
+							      : rec.coastingCount);
+	pkt.min.rangeMetres = rec.rangeMetres;
+	pkt.min.azimuthDegrees = rec.azimuthDegrees;
+	pkt.min.speedMps = rec.speedMps;
+	pkt.min.courseDegrees = rec.courseDegrees;
+	pkt.min.weight = rec.numBlobs;
+	pkt.min.validity = SPX_PACKET_TRACK_INVALID_NONE;
+	pkt.xMetres = rec.xMetres;
+	pkt.yMetres = rec.yMetres;
+	pkt.measRange = rec.rangeMetres;
+	pkt.measAzimuth = rec.azimuthDegrees;
+
+	/* 32비트 필드는 네트워크 바이트 순서로 */
+	SPxHtonlInSitu(&pkt.min.id);
+	SPxHtonlInSitu(&pkt.min.rangeMetres);
+	SPxHtonlInSitu(&pkt.min.azimuthDegrees);
+	SPxHtonlInSitu(&pkt.min.speedMps);
+	SPxHtonlInSitu(&pkt.min.courseDegrees);
+	SPxHtonlInSitu(&pkt.min.weight);
+	SPxHtonlInSitu(&pkt.xMetres);
+	SPxHtonlInSitu(&pkt.yMetres);
+	SPxHtonlInSitu(&pkt.measRange);
+	SPxHtonlInSitu(&pkt.measAzimuth);
+	m_sender->SendPacketB(SPX_PACKET_TYPEB_TRACK_NORM, track->timestamp,
+			      &pkt, sizeof(pkt), FALSE);
+    }
+
+    m_totalReports++;
+    if( rec.active )
+    {
+	m_scanTracks++;
+    }
+} /* SPxTrackOutput::writeTrack() */
+
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
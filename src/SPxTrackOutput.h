@@ -0,0 +1,114 @@
+/*********************************************************************
+*
+* File: SPxTrackOutput.h
+*
+* Purpose:
+*	Track output for the streamers: the reports of an SPxTracker
+*	fed by the plot extractor (see SPxPlotExtract.h) are written
+*	to a file and/or sent as SPx track report packets.
+*
+*	The file is either CSV (name ending in ".csv") or binary:
+*
+*	  "SPXTRAK1"		8-byte magic,
+*	  SPxTrackRecord	per report, 48 bytes, host byte order.
+*
+*	Packets are SPxPacketTrackNormal (SPX_PACKET_TYPEB_TRACK_NORM)
+*	in network byte order, as read by SPx track clients.
+*
+*	The tracker CPU time per scan and the number of active tracks
+*	are kept for the streamers to print.
+*
+**********************************************************************/
+
+#ifndef _SPX_TRACK_OUTPUT_H
+#define _SPX_TRACK_OUTPUT_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <mutex>
+#include <string>
+
+/* SPx library types (SPxTrack_t, SPxPacketSender etc.). */
+#include "SPx.h"
+
+/* Track record in binary track files. */
+typedef struct SPxTrackRecord_tag
+{
+    int64_t timeMsecs;		/* Epoch time of the report, milliseconds */
+    uint32_t id;		/* Tracker ID, 1 to N */
+    uint32_t active;		/* Zero in the final report of a track */
+    float rangeMetres;		/* Tracked position */
+    float azimuthDegrees;
+    float xMetres;
+    float yMetres;
+    float speedMps;		/* Tracked velocity */
+    float courseDegrees;
+    uint32_t coastingCount;	/* Scans without a plot */
+    uint32_t numBlobs;		/* Plots forming the measurement */
+} SPxTrackRecord;
+
+class SPxTrackOutput
+{
+public:
+    /* Statistics since the previous GetStats() call. */
+    struct Stats
+    {
+	uint64_t totalReports;	/* Since creation */
+	unsigned int numTracks;	/* Active tracks in the last whole scan */
+	unsigned int numScans;	/* Whole scans in this interval */
+	double meanCpuMs;	/* Tracker CPU time per scan */
+	double maxCpuMs;
+    };
+
+    /* Constructor/destructor. */
+    SPxTrackOutput(void);
+    ~SPxTrackOutput();
+
+    /* Open the track file and/or the "<address>:<port>" destination
+     * for track packets (either may be NULL but not both), zero on
+     * success or -1 on error (GetError() says why).
+     */
+    int Create(const char *filename, const char *destination);
+    const char *GetError(void) const { return m_error.c_str(); }
+
+    /* Report callback for SPxTracker::AddReportCallback(). */
+    static int ReportFn(void *invokingObject, void *userObject, void *arg);
+
+    /* Account tracker CPU time for returns from PIM azimuth firstAzi,
+     * called by the tracking process on the detection thread.
+     */
+    void AddTrackerTime(unsigned int firstAzi, double cpuMs);
+
+    /* Flush the track file and read the statistics. */
+    void GetStats(Stats *stats);
+
+private:
+    /* Outputs. */
+    int m_csv;
+    FILE *m_file;
+    SPxPacketSender *m_sender;
+    std::string m_error;
+
+    /* Statistics, guarded by the mutex. */
+    std::mutex m_mutex;
+    uint64_t m_totalReports;
+    unsigned int m_lastAzi;
+    int m_wrapped;		/* Seen the end of a scan */
+    double m_scanCpuMs;		/* Scan in progress */
+    unsigned int m_scanTracks;
+    unsigned int m_numTracks;	/* Last whole scan */
+    unsigned int m_numScans;
+    double m_sumCpuMs;
+    double m_maxCpuMs;
+
+    /* Private functions. */
+    void writeTrack(const SPxTrack_t *track);
+};
+
+#endif /* _SPX_TRACK_OUTPUT_H */
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
@@ -0,0 +1,469 @@
+/*********************************************************************
+*
+* File: SPxVideoRepublish.cpp
+*
+* Purpose:
+*	Video output link for the streamers (see SPxVideoRepublish.h).
+*
+**********************************************************************/
+
+/* Standard headers. */
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+
+/* Our own header. */
+#include "SPxVideoRepublish.h"
+
+/*
+ * Constants.
+ */
+/* Most bytes of samples per sent spoke (radarVideoSize is 16 bits). */
+#define	MAX_SAMPLES		65535
+
+/*
+ * Private function prototypes.
+ */
+static int64_t nowUsecs(void);
+
+
+/*********************************************************************
+*
+*	Sender classes
+*
+**********************************************************************/
+
+/* SDK sender with its encode and send of one return made public, and
+ * the datagrams it sends counted (also from the SDK's own threads).
+ */
+template<class SenderBase> class SPxRepublishSenderBase : public SenderBase
+{
+public:
+    SPxRepublishSenderBase(void) : numPackets(0), numBytes(0) {}
+
+    int SendOne(SPxReturn *rtn, std::vector<unsigned char> *buf)
+    {
+	unsigned int size = 0;
+	unsigned int format = 0;
+	unsigned char *encoded = this->EncodeReturn(rtn, &(*buf)[0],
+						   (unsigned int)buf->size(),
+						   &size, &format);
+	if( encoded == NULL )
+	{
+	    return(-1);
+	}
+	return( this->SendReturn(&rtn->header, encoded, size, format) );
+    }
+
+    std::atomic<uint64_t> numPackets;
+    std::atomic<uint64_t> numBytes;
+};
+
+/* SPx radar video, counted where SPxNetworkSend sends each datagram. */
+class SPxRepublishSender : public SPxRepublishSenderBase<SPxNetworkSend>
+{
+protected:
+    virtual int SendPacket(const unsigned char *data, unsigned int size)
+    {
+	numPackets++;
+	numBytes += size;
+	return( SPxNetworkSend::SendPacket(data, size) );
+    }
+};
+
+/* ASTERIX Cat-240, counted where each message is sent. */
+class SPxRepublishSenderAsterix
+    : public SPxRepublishSenderBase<SPxNetworkSendAsterix>
+{
+protected:
+    virtual SPxErrorCode SendData(const char *data, int size,
+				  const char *errorMessage)
+    {
+	numPackets++;
+	numBytes += (uint64_t)size;
+	return( SPxNetworkSendAsterix::SendData(data, size, errorMessage) );
+    }
+};
+
+
+/*********************************************************************
+*
+*	Public functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* SPxVideoRepublish::SPxVideoRepublish
+*	Constructor.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Nothing is sent until Create() succeeds.
+*
+*===================================================================*/
+SPxVideoRepublish::SPxVideoRepublish(void)
+    : m_channel(0),
+      m_rangeReduction(1),
+      m_packing(SPX_RIB_PACKING_RAW8),
+      m_spx(NULL),
+      m_asterix(NULL),
+      m_numSpokes(0),
+      m_numPackets(0),
+      m_numBytes(0),
+      m_numRawBytes(0),
+      m_numErrors(0),
+      m_lastStatsUsecs(nowUsecs())
+{
+} /* SPxVideoRepublish::SPxVideoRepublish() */
+
+
+/*====================================================================
+*
+* SPxVideoRepublish::~SPxVideoRepublish
+*	Destructor.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+SPxVideoRepublish::~SPxVideoRepublish()
+{
+    delete m_spx;
+    delete m_asterix;
+} /* SPxVideoRepublish::~SPxVideoRepublish() */
+
+
+/*====================================================================
+*
+* SPxVideoRepublish::Create
+*	Open the link.
+*
+* Params:
+*	spec			"<addr>:<port>[@ifAddr][,option...]"
+*				(see SPxVideoRepublish.h).
+*
+* Returns:
+*	Zero on success, -1 on error.
+*
+* Notes
+*
+*===================================================================*/
+int SPxVideoRepublish::Create(const char *spec)
+{
+    if( (m_spx != NULL) || (m_asterix != NULL) )
+    {
+	m_error = "video link already created";
+	return(-1);
+    }
+    std::string text = (spec != NULL) ? spec : "";
+    m_error = "invalid video link '" + text + "'";
+
+    /* "주소:포트[@인터페이스]" 다음에 쉼표로 구분된 옵션 */
+    std::string dest = text.substr(0, text.find(','));
+    std::string ifAddr;
+    size_t at = dest.find('@');
+    if( at != std::string::npos )
+    {
+	ifAddr = dest.substr(at + 1);
+	dest = dest.substr(0, at);
+    }
+    size_t colon = dest.rfind(':');
+    char *end = NULL;
+    long port = 0;
+    if( colon != std::string::npos )
+    {
+	port = strtol(dest.c_str() + colon + 1, &end, 10);
+    }
+    if( (colon == std::string::npos) || (colon == 0) || (*end != '\0')
+	|| (port < 1) || (port > 65535) || ((at != std::string::npos) && ifAddr.empty()) )
+    {
+	return(-1);
+    }
+    std::string addr = dest.substr(0, colon);
+
+    int cat240 = 0;
+    unsigned int mtu = 0;
+    unsigned int sndBuf = 0;
+    size_t pos = text.find(',');
+    while( pos != std::string::npos )
+    {
+	size_t next = text.find(',', pos + 1);
+	std::string opt = text.substr(pos + 1, (next == std::string::npos)
+				      ? std::string::npos : (next - pos - 1));
+	std::string value;
+	size_t eq = opt.find('=');
+	unsigned long n = 0;
+	if( eq != std::string::npos )
+	{
+	    value = opt.substr(eq + 1);
+	    opt = opt.substr(0, eq);
+	    n = strtoul(value.c_str(), &end, 0);
+	    if( value.empty() || (*end != '\0') )
+	    {
+		return(-1);
+	    }
+	}
+	if( (opt == "spx") && value.empty() )		{ cat240 = 0; }
+	else if( (opt == "cat240") && value.empty() )	{ cat240 = 1; }
+	else if( (opt == "raw") && value.empty() )	{ m_packing = SPX_RIB_PACKING_RAW8; }
+	else if( (opt == "orc") && value.empty() )	{ m_packing = SPX_RIB_PACKING_ORC; }
+	else if( (opt == "zlib") && value.empty() )	{ m_packing = SPX_RIB_PACKING_ZLIB; }
+	else if( (opt == "rr") && (n >= 1) && (n <= 64) )
+	{
+	    m_rangeReduction = (unsigned int)n;
+	}
+	else if( (opt == "mtu") && (n >= 256) && (n <= 65000) )
+	{
+	    mtu = (unsigned int)n;
+	}
+	else if( (opt == "sndbuf") && (n >= 1) && (n <= (1u << 30)) )
+	{
+	    sndBuf = (unsigned int)n;
+	}
+	else if( (opt == "ch") && !value.empty() && (n < 65536) )
+	{
+	    m_channel = (unsigned int)n;
+	}
+	else
+	{
+	    return(-1);
+	}
+	pos = next;
+    }
+
+    /* Set the sender up before Create() opens its socket. */
+    SPxNetworkSend *sender = NULL;
+    if( cat240 )
+    {
+	m_asterix = new SPxRepublishSenderAsterix();
+	sender = m_asterix;
+    }
+    else
+    {
+	m_spx = new SPxRepublishSender();
+	sender = m_spx;
+    }
+    if( !sender->IsEncodeFormatSupported(m_packing) )
+    {
+	m_error = "packing not supported for video link '" + text + "'";
+    }
+    else if( ((mtu > 0) && (sender->SetMTU(mtu) != SPX_NO_ERROR))
+	     || ((sndBuf > 0) && (sender->SetSndBufSize(sndBuf) != SPX_NO_ERROR)) )
+    {
+	m_error = "invalid mtu or sndbuf for video link '" + text + "'";
+    }
+    else if( sender->Create(addr.c_str(), (int)port,
+			    ifAddr.empty() ? NULL : ifAddr.c_str()) != SPX_NO_ERROR )
+    {
+	m_error = "cannot send video to '" + dest + "'";
+    }
+    else
+    {
+	sender->SetEncodeFormat(m_packing);
+	m_spec = text;
+	m_error.clear();
+	m_lastStatsUsecs = nowUsecs();
+	return(0);
+    }
+    delete m_spx;
+    delete m_asterix;
+    m_spx = NULL;
+    m_asterix = NULL;
+    return(-1);
+} /* SPxVideoRepublish::Create() */
+
+
+/*====================================================================
+*
+* SPxVideoRepublish::Send
+*	Encode and send a spoke.
+*
+* Params:
+*	hdr			Received spoke header,
+*	data, numSamples	Samples to send,
+*	bytesPerSample		1 or 2.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	The spoke is range reduced (maximum of each rr samples) and
+*	sent as RAW16 if it has 16-bit samples and the packing is raw,
+*	else as 8-bit samples (the top 8 bits of 16-bit ones) for the
+*	sender to pack.  Range reduction is done here as SPxNetworkSend
+*	only applies its own on the RIB path.  Long spokes are cut so
+*	the sent samples fit the 16-bit radarVideoSize.
+*
+*===================================================================*/
+void SPxVideoRepublish::Send(const SPxReturnHeader *hdr,
+			     const unsigned char *data,
+			     unsigned int numSamples,
+			     unsigned int bytesPerSample)
+{
+    if( ((m_spx == NULL) && (m_asterix == NULL))
+	|| ((bytesPerSample != 1) && (bytesPerSample != 2)) )
+    {
+	return;
+    }
+    int wide = (bytesPerSample == 2) && (m_packing == SPX_RIB_PACKING_RAW8);
+    unsigned int outBps = wide ? 2 : 1;
+    unsigned int rr = m_rangeReduction;
+
+    /* 출력 크기가 16비트에 들어가도록 범위를 자름 */
+    unsigned int maxSamples = (MAX_SAMPLES / outBps) * rr;
+    if( numSamples > maxSamples )
+    {
+	numSamples = maxSamples;
+    }
+    unsigned int numOut = (numSamples + rr - 1) / rr;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t needed = sizeof(SPxReturnHeader) + ((size_t)numOut * outBps);
+    if( m_return.size() < needed )
+    {
+	m_return.resize(needed);
+	m_encoded.resize((2 * needed) + 4096);
+    }
+
+    /* 받은 헤더를 복사하고 샘플 수/패킹만 바꿈 */
+    SPxReturn *rtn = (SPxReturn *)&m_return[0];
+    SPxReturnHeader *out = &rtn->header;
+    *out = *hdr;
+    out->magic1 = SPX_RIB_HEADER_MAGIC1;
+    out->magic2 = SPX_RIB_HEADER_MAGIC2;
+    out->headerSize = sizeof(SPxReturnHeader);
+    out->packing = wide ? SPX_RIB_PACKING_RAW16 : SPX_RIB_PACKING_RAW8;
+    out->nominalLength = (UINT16)numOut;
+    out->thisLength = (UINT16)numOut;
+    out->radarVideoSize = (UINT16)(numOut * outBps);
+    out->totalSize = (UINT32)(sizeof(SPxReturnHeader) + (numOut * outBps));
+
+    unsigned char *samples = &m_return[sizeof(SPxReturnHeader)];
+    const UINT16 *data16 = (const UINT16 *)data;
+    for(unsigned int i = 0; i < numOut; i++)
+    {
+	unsigned int first = i * rr;
+	unsigned int last = (first + rr < numSamples) ? (first + rr) : numSamples;
+	unsigned int peak = 0;
+	for(unsigned int j = first; j < last; j++)
+	{
+	    unsigned int v = (bytesPerSample == 1) ? data[j] : data16[j];
+	    if( v > peak )
+	    {
+		peak = v;
+	    }
+	}
+	if( wide )
+	{
+	    UINT16 v16 = (UINT16)peak;
+	    memcpy(&samples[2 * i], &v16, 2);
+	}
+	else
+	{
+	    samples[i] = (unsigned char)((bytesPerSample == 1) ? peak : (peak >> 8));
+	}
+    }
+
+    int sent = (m_spx != NULL) ? m_spx->SendOne(rtn, &m_encoded)
+	: m_asterix->SendOne(rtn, &m_encoded);
+    if( sent < 0 )
+    {
+	m_numErrors++;
+	return;
+    }
+    m_numSpokes++;
+    m_numRawBytes += (uint64_t)numSamples * bytesPerSample;
+} /* SPxVideoRepublish::Send() */
+
+
+/*====================================================================
+*
+* SPxVideoRepublish::GetStats
+*	Read the statistics.
+*
+* Params:
+*	stats			Filled in.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Rates cover the time since the previous call.
+*
+*===================================================================*/
+void SPxVideoRepublish::GetStats(Stats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    std::lock_guard<std::mutex> lock(m_mutex);
+    int64_t now = nowUsecs();
+    double secs = (double)(now - m_lastStatsUsecs) / 1e6;
+    uint64_t totalPackets = (m_spx != NULL) ? m_spx->numPackets.load()
+	: ((m_asterix != NULL) ? m_asterix->numPackets.load() : 0);
+    uint64_t totalBytes = (m_spx != NULL) ? m_spx->numBytes.load()
+	: ((m_asterix != NULL) ? m_asterix->numBytes.load() : 0);
+    uint64_t numPackets = totalPackets - m_numPackets;
+    uint64_t numBytes = totalBytes - m_numBytes;
+
+    if( secs > 0.0 )
+    {
+	stats->spokesPerSec = (double)m_numSpokes / secs;
+	stats->packetsPerSec = (double)numPackets / secs;
+	stats->bitsPerSec = (double)numBytes * 8.0 / secs;
+    }
+    stats->compression = (m_numRawBytes > 0)
+	? ((double)numBytes / (double)m_numRawBytes) : 0.0;
+    stats->numErrors = m_numErrors;
+
+    m_numSpokes = 0;
+    m_numPackets = totalPackets;
+    m_numBytes = totalBytes;
+    m_numRawBytes = 0;
+    m_numErrors = 0;
+    m_lastStatsUsecs = now;
+} /* SPxVideoRepublish::GetStats() */
+
+
+/*********************************************************************
+*
+*	Private functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* nowUsecs
+*	Monotonic time.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Microseconds since an arbitrary point.
+*
+* Notes
+*
+*===================================================================*/
+static int64_t nowUsecs(void)
+{
+    return( std::chrono::duration_cast<std::chrono::microseconds>(
+	std::chrono::steady_clock::now().time_since_epoch()).count() );
+} /* nowUsecs() */
+
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
@@ -0,0 +1,105 @@
+/*********************************************************************
+*
+* File: SPxVideoRepublish.h
+*
+* Purpose:
+*	Video output link for the streamers: processed spokes are sent
+*	on as SPx radar video (SPxNetworkSend) or ASTERIX Cat-240
+*	(SPxNetworkSendAsterix), so existing SPx consoles can show the
+*	filtered picture.
+*
+*	A link is given as "<addr>:<port>[@ifAddr][,option...]" with
+*	the options:
+*
+*	    spx | cat240	Protocol (default spx)
+*	    raw | orc | zlib	Packing (default raw)
+*	    rr=<n>		Range reduction, maximum of each n samples
+*	    mtu=<bytes>		Largest datagram
+*	    sndbuf=<bytes>	Socket send buffer
+*	    ch=<n>		Channel to send (default 0)
+*
+*	Each spoke is encoded and sent on the calling thread.  Spokes,
+*	datagrams and bytes sent are counted for the bandwidth reports.
+*
+**********************************************************************/
+
+#ifndef _SPX_VIDEO_REPUBLISH_H
+#define _SPX_VIDEO_REPUBLISH_H
+
+#include <stdint.h>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/* SPx library types (SPxReturnHeader, SPxNetworkSend etc.). */
+#include "SPx.h"
+
+/* Senders with their encode and send of one return made public. */
+class SPxRepublishSender;
+class SPxRepublishSenderAsterix;
+
+class SPxVideoRepublish
+{
+public:
+    /* Statistics since the previous GetStats() call. */
+    struct Stats
+    {
+	double spokesPerSec;
+	double packetsPerSec;		/* Datagrams */
+	double bitsPerSec;		/* Encoded bytes sent, as bits */
+	double compression;		/* Sent bytes / raw sample bytes */
+	uint64_t numErrors;		/* Spokes that failed to encode/send */
+    };
+
+    /* Constructor/destructor. */
+    SPxVideoRepublish(void);
+    ~SPxVideoRepublish();
+
+    /* Open the link (see above).  Zero on success or -1 on error (see
+     * GetError()).  The SPx library must be initialised.
+     */
+    int Create(const char *spec);
+    const char *GetError(void) const { return m_error.c_str(); }
+
+    /* Link description and the channel it sends. */
+    const char *GetSpec(void) const { return m_spec.c_str(); }
+    unsigned int GetChannel(void) const { return m_channel; }
+
+    /* Send a spoke: the received header, with the samples (1 or 2
+     * bytes each) that are to be sent in place of the received ones.
+     */
+    void Send(const SPxReturnHeader *hdr, const unsigned char *data,
+	      unsigned int numSamples, unsigned int bytesPerSample);
+
+    /* Read the statistics. */
+    void GetStats(Stats *stats);
+
+private:
+    /* Link. */
+    std::string m_spec;
+    std::string m_error;
+    unsigned int m_channel;
+    unsigned int m_rangeReduction;
+    int m_packing;			/* SPX_RIB_PACKING_... */
+    SPxRepublishSender *m_spx;		/* One of these */
+    SPxRepublishSenderAsterix *m_asterix;
+
+    /* Return and encode buffers, and statistics, guarded by the mutex. */
+    std::mutex m_mutex;
+    std::vector<unsigned char> m_return;
+    std::vector<unsigned char> m_encoded;
+    uint64_t m_numSpokes;
+    uint64_t m_numPackets;		/* Sender's totals at the last GetStats() */
+    uint64_t m_numBytes;
+    uint64_t m_numRawBytes;
+    uint64_t m_numErrors;
+    int64_t m_lastStatsUsecs;
+};
+
+#endif /* _SPX_VIDEO_REPUBLISH_H */
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
@@ -0,0 +1,731 @@
+/*********************************************************************
+*
+* File: SPxViewerLib.cpp
+*
+* Purpose:
+*	Native helper library for the Python viewer (see SPxViewerLib.h).
+*
+*	The per-frame kernels are written three times: AVX2, SSE2 and a
+*	plain scalar fallback.  The widest one supported by the CPU is
+*	selected on first use, so one binary runs on any x86 machine and
+*	the scalar path is used everywhere else.
+*
+**********************************************************************/
+
+/* Standard headers. */
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <mutex>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define	SPX_VIEWER_X86	1
+#include <immintrin.h>
+#endif
+
+/* Our own headers. */
+#include "SPxViewerLib.h"
+#include "SPxViewerRaster.h"
+#include "SPxWorkPool.h"
+#include "SPxFilterChain.h"
+#include "SPxScanIntegrator.h"
+#include "SPxClutterMap.h"
+
+/*
+ * Types.
+ */
+typedef void (*FadeFn_t)(uint8_t *bytes, size_t numBytes, unsigned int factor);
+
+/*
+ * Private function prototypes.
+ */
+static void fadeScalar(uint8_t *bytes, size_t numBytes, unsigned int factor);
+#ifdef SPX_VIEWER_X86
+static void fadeSse2(uint8_t *bytes, size_t numBytes, unsigned int factor);
+static void fadeAvx2(uint8_t *bytes, size_t numBytes, unsigned int factor);
+#endif
+static void selectKernels(void);
+static SPxWorkPool *getPool(int numThreads);
+
+/*
+ * Global variables.
+ */
+/* Selected kernels. */
+static FadeFn_t FadeFn = NULL;
+static const char *SimdName = "scalar";
+
+/* Thread pool shared by the rasters, filter chains and clutter maps,
+ * recreated when the requested number of threads changes.  The mutex
+ * also serialises the calls that use it.
+ */
+static std::mutex PoolMutex;
+static SPxWorkPool *WorkPool = NULL;
+
+
+/*********************************************************************
+*
+*	Public functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* SPxViewerGetSimdName
+*	Report which instruction set the kernels use.
+*
+* Params:
+*	None
+*
+* Returns:
+*	"avx2", "sse2" or "scalar".
+*
+* Notes
+*
+*===================================================================*/
+const char *SPxViewerGetSimdName(void)
+{
+    selectKernels();
+    return(SimdName);
+} /* SPxViewerGetSimdName() */
+
+
+/*====================================================================
+*
+* SPxViewerFade32
+*	Fade a 32-bit image in place.
+*
+* Params:
+*	pixels			First pixel of the image,
+*	width, height		Image size in pixels,
+*	pitchBytes		Distance between rows in bytes,
+*	factor			Multiplier in 1/256 units (256 = no change).
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Every byte including the unused alpha/X byte is scaled, which
+*	keeps the kernel a straight byte stream.  Contiguous images are
+*	faded in a single pass.
+*
+*===================================================================*/
+void SPxViewerFade32(uint32_t *pixels, int width, int height,
+			int pitchBytes, int factor)
+{
+    if( (pixels == NULL) || (width <= 0) || (height <= 0) )
+    {
+	return;
+    }
+    if( factor >= 256 )
+    {
+	return;
+    }
+    if( factor < 0 )
+    {
+	factor = 0;
+    }
+    selectKernels();
+
+    size_t rowBytes = (size_t)width * 4;
+    uint8_t *row = (uint8_t *)pixels;
+    if( (size_t)pitchBytes == rowBytes )
+    {
+	FadeFn(row, rowBytes * (size_t)height, (unsigned int)factor);
+	return;
+    }
+    for(int y = 0; y < height; y++)
+    {
+	FadeFn(row, rowBytes, (unsigned int)factor);
+	row += pitchBytes;
+    }
+} /* SPxViewerFade32() */
+
+
+/*====================================================================
+*
+* SPxViewerPlotMax32
+*	Max-blend a list of points into a 32-bit image.
+*
+* Params:
+*	pixels			First pixel of the image,
+*	width, height		Image size in pixels,
+*	pitchBytes		Distance between rows in bytes,
+*	xs, ys			Point coordinates,
+*	colours			Point colours (same layout as the image),
+*	numPoints		Number of points.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Scattered writes do not vectorise, but doing the per-channel max
+*	here saves several temporary arrays per spoke in numpy.
+*
+*===================================================================*/
+void SPxViewerPlotMax32(uint32_t *pixels, int width, int height,
+			int pitchBytes, const int32_t *xs, const int32_t *ys,
+			const uint32_t *colours, int numPoints)
+{
+    if( (pixels == NULL) || (xs == NULL) || (ys == NULL) || (colours == NULL) )
+    {
+	return;
+    }
+    uint8_t *base = (uint8_t *)pixels;
+    for(int i = 0; i < numPoints; i++)
+    {
+	int32_t x = xs[i];
+	int32_t y = ys[i];
+	if( (x < 0) || (y < 0) || (x >= width) || (y >= height) )
+	{
+	    continue;
+	}
+	uint32_t *pix = (uint32_t *)(base + ((size_t)y * pitchBytes)) + x;
+	uint32_t a = *pix;
+	uint32_t b = colours[i];
+	uint32_t out = 0;
+	for(int shift = 0; shift < 32; shift += 8)
+	{
+	    uint32_t ca = (a >> shift) & 0xFF;
+	    uint32_t cb = (b >> shift) & 0xFF;
+	    out |= ((ca > cb) ? ca : cb) << shift;
+	}
+	*pix = out;
+    }
+} /* SPxViewerPlotMax32() */
+
+
+/*====================================================================
+*
+* SPxViewerRaster...
+*	C wrappers around SPxViewerRaster for ctypes.
+*
+* Params:
+*	raster			Handle from SPxViewerRasterCreate(),
+*	others			As for the SPxViewerRaster functions.
+*
+* Returns:
+*	SPxViewerRasterCreate() returns NULL on failure,
+*	SPxViewerRasterRender() returns the number of tiles rendered.
+*
+* Notes
+*	NULL handles are ignored.
+*
+*===================================================================*/
+void *SPxViewerRasterCreate(int width, int height, int numAzis,
+			    int numGates, int tileSize)
+{
+    try
+    {
+	return(new SPxViewerRaster(width, height, numAzis, numGates, tileSize));
+    }
+    catch(...)
+    {
+	return(NULL);
+    }
+} /* SPxViewerRasterCreate() */
+
+void SPxViewerRasterDestroy(void *raster)
+{
+    delete (SPxViewerRaster *)raster;
+} /* SPxViewerRasterDestroy() */
+
+void SPxViewerRasterSetGeometry(void *raster, double centreX, double centreY,
+				double radiusPixels, double gatesInRadius)
+{
+    if( raster != NULL )
+    {
+	((SPxViewerRaster *)raster)->SetGeometry(centreX, centreY,
+						 radiusPixels, gatesInRadius);
+    }
+} /* SPxViewerRasterSetGeometry() */
+
+void SPxViewerRasterSetPalette(void *raster, const uint32_t *palette)
+{
+    if( raster != NULL )
+    {
+	((SPxViewerRaster *)raster)->SetPalette(palette);
+    }
+} /* SPxViewerRasterSetPalette() */
+
+void SPxViewerRasterUpdateSpoke(void *raster, double azimuthDegs,
+				const uint8_t *samples, int numSamples)
+{
+    if( raster != NULL )
+    {
+	((SPxViewerRaster *)raster)->UpdateSpoke(azimuthDegs, samples, numSamples);
+    }
+} /* SPxViewerRasterUpdateSpoke() */
+
+void SPxViewerRasterClear(void *raster)
+{
+    if( raster != NULL )
+    {
+	((SPxViewerRaster *)raster)->Clear();
+    }
+} /* SPxViewerRasterClear() */
+
+void SPxViewerRasterInvalidate(void *raster)
+{
+    if( raster != NULL )
+    {
+	((SPxViewerRaster *)raster)->Invalidate();
+    }
+} /* SPxViewerRasterInvalidate() */
+
+int SPxViewerRasterRender(void *raster, uint32_t *pixels, int pitchBytes,
+			  int numThreads, int flags)
+{
+    if( raster == NULL )
+    {
+	return(0);
+    }
+    std::lock_guard<std::mutex> lock(PoolMutex);
+    return(((SPxViewerRaster *)raster)->Render(pixels, pitchBytes,
+					       getPool(numThreads), flags));
+} /* SPxViewerRasterRender() */
+
+void SPxViewerRasterGetDirtyBounds(void *raster, int *x, int *y,
+				   int *w, int *h)
+{
+    if( raster != NULL )
+    {
+	((SPxViewerRaster *)raster)->GetDirtyBounds(x, y, w, h);
+    }
+} /* SPxViewerRasterGetDirtyBounds() */
+
+
+/*====================================================================
+*
+* SPxViewerFilter...
+*	C wrappers around SPxFilterChain for ctypes.
+*
+* Params:
+*	filter			Handle from SPxViewerFilterCreate(),
+*	others			As for the SPxFilterChain functions.
+*
+* Returns:
+*	SPxViewerFilterCreate() returns NULL on failure,
+*	SPxViewerFilterSetParams() returns zero on success, -1 on error.
+*
+* Notes
+*	NULL handles are ignored.
+*
+*===================================================================*/
+void *SPxViewerFilterCreate(void)
+{
+    try
+    {
+	return(new SPxFilterChain());
+    }
+    catch(...)
+    {
+	return(NULL);
+    }
+} /* SPxViewerFilterCreate() */
+
+void SPxViewerFilterDestroy(void *filter)
+{
+    delete (SPxFilterChain *)filter;
+} /* SPxViewerFilterDestroy() */
+
+int SPxViewerFilterSetParams(void *filter, const char *params)
+{
+    if( filter == NULL )
+    {
+	return(-1);
+    }
+    return(((SPxFilterChain *)filter)->SetParams(params));
+} /* SPxViewerFilterSetParams() */
+
+const char *SPxViewerFilterGetError(void *filter)
+{
+    if( filter == NULL )
+    {
+	return("");
+    }
+    return(((SPxFilterChain *)filter)->GetError());
+} /* SPxViewerFilterGetError() */
+
+void SPxViewerFilterApplyFrame(void *filter, uint8_t *frame, int numSpokes,
+			       int numSamples, int strideBytes,
+			       const double *azimuthDegs, int numThreads)
+{
+    if( filter != NULL )
+    {
+	std::lock_guard<std::mutex> lock(PoolMutex);
+	((SPxFilterChain *)filter)->ApplyFrame(frame, numSpokes, numSamples,
+					       strideBytes, azimuthDegs,
+					       getPool(numThreads));
+    }
+} /* SPxViewerFilterApplyFrame() */
+
+const char *SPxViewerFilterGetSimdName(void)
+{
+    return(SPxFilterChain::GetSimdName());
+} /* SPxViewerFilterGetSimdName() */
+
+
+/*====================================================================
+*
+* SPxViewerIntegrator...
+*	C wrappers around SPxScanIntegrator for ctypes.
+*
+* Params:
+*	integrator		Handle from SPxViewerIntegratorCreate(),
+*	azimuthDegs		Azimuth of each spoke,
+*	frame, out		Input spokes and integrated rows,
+*	strides			Distance between spokes in bytes,
+*	others			As for the SPxScanIntegrator functions.
+*
+* Returns:
+*	SPxViewerIntegratorCreate() returns NULL on failure.
+*
+* Notes
+*	NULL handles are ignored.
+*
+*===================================================================*/
+void *SPxViewerIntegratorCreate(int numAzis, int numGates, const char *args)
+{
+    SPxScanIntegrator *integrator = NULL;
+    try
+    {
+	integrator = new SPxScanIntegrator(numAzis, numGates);
+	if( integrator->SetParams(args) != 0 )
+	{
+	    delete integrator;
+	    integrator = NULL;
+	}
+    }
+    catch(...)
+    {
+	delete integrator;
+	integrator = NULL;
+    }
+    return(integrator);
+} /* SPxViewerIntegratorCreate() */
+
+void SPxViewerIntegratorDestroy(void *integrator)
+{
+    delete (SPxScanIntegrator *)integrator;
+} /* SPxViewerIntegratorDestroy() */
+
+void SPxViewerIntegratorUpdateSpokes(void *integrator, const double *azimuthDegs,
+				     const uint8_t *frame, int numSpokes,
+				     int numSamples, int strideBytes,
+				     uint8_t *out, int outStrideBytes)
+{
+    SPxScanIntegrator *si = (SPxScanIntegrator *)integrator;
+    if( (si == NULL) || (azimuthDegs == NULL) || (frame == NULL) || (out == NULL) )
+    {
+	return;
+    }
+    for(int i = 0; i < numSpokes; i++)
+    {
+	int bin = si->UpdateSpoke(azimuthDegs[i], frame + ((size_t)i * strideBytes),
+				  numSamples);
+	if( bin >= 0 )
+	{
+	    memcpy(out + ((size_t)i * outStrideBytes), si->GetRow(bin),
+		   si->GetNumGates());
+	}
+    }
+} /* SPxViewerIntegratorUpdateSpokes() */
+
+void SPxViewerIntegratorGetFrame(void *integrator, uint8_t *frame)
+{
+    SPxScanIntegrator *si = (SPxScanIntegrator *)integrator;
+    if( (si != NULL) && (frame != NULL) )
+    {
+	memcpy(frame, si->GetFrame(), (size_t)si->GetNumAzis() * si->GetNumGates());
+    }
+} /* SPxViewerIntegratorGetFrame() */
+
+void SPxViewerIntegratorReset(void *integrator)
+{
+    if( integrator != NULL )
+    {
+	((SPxScanIntegrator *)integrator)->Reset();
+    }
+} /* SPxViewerIntegratorReset() */
+
+unsigned int SPxViewerIntegratorGetRotationCount(void *integrator)
+{
+    if( integrator == NULL )
+    {
+	return(0);
+    }
+    return(((SPxScanIntegrator *)integrator)->GetRotationCount());
+} /* SPxViewerIntegratorGetRotationCount() */
+
+size_t SPxViewerIntegratorGetMemoryBytes(void *integrator)
+{
+    if( integrator == NULL )
+    {
+	return(0);
+    }
+    return(((SPxScanIntegrator *)integrator)->GetMemoryBytes());
+} /* SPxViewerIntegratorGetMemoryBytes() */
+
+
+/*====================================================================
+*
+* SPxViewerClutter...
+*	C wrappers around SPxClutterMap for ctypes.
+*
+* Params:
+*	clutter			Handle from SPxViewerClutterCreate(),
+*	azimuthDegs		Azimuth of each spoke,
+*	frame			Spokes, changed in place,
+*	strideBytes		Distance between spokes in bytes,
+*	others			As for the SPxClutterMap functions.
+*
+* Returns:
+*	SPxViewerClutterCreate() returns NULL on failure, Save() and
+*	Load() -1 on failure (including a NULL handle).
+*
+* Notes
+*	NULL handles are otherwise ignored.
+*
+*===================================================================*/
+void *SPxViewerClutterCreate(int numAzis, int numGates, const char *args)
+{
+    SPxClutterMap *clutter = NULL;
+    try
+    {
+	clutter = new SPxClutterMap(numAzis, numGates);
+	if( clutter->SetParams(args) != 0 )
+	{
+	    delete clutter;
+	    clutter = NULL;
+	}
+    }
+    catch(...)
+    {
+	delete clutter;
+	clutter = NULL;
+    }
+    return(clutter);
+} /* SPxViewerClutterCreate() */
+
+void SPxViewerClutterDestroy(void *clutter)
+{
+    delete (SPxClutterMap *)clutter;
+} /* SPxViewerClutterDestroy() */
+
+void SPxViewerClutterApplySpokes(void *clutter, const double *azimuthDegs,
+				 uint8_t *frame, int numSpokes,
+				 int numSamples, int strideBytes,
+				 int numThreads)
+{
+    if( clutter != NULL )
+    {
+	std::lock_guard<std::mutex> lock(PoolMutex);
+	((SPxClutterMap *)clutter)->ApplyFrame(azimuthDegs, frame, numSpokes,
+					       numSamples, strideBytes,
+					       getPool(numThreads));
+    }
+} /* SPxViewerClutterApplySpokes() */
+
+int SPxViewerClutterSave(void *clutter, const char *filename)
+{
+    if( clutter == NULL )
+    {
+	return(-1);
+    }
+    return(((SPxClutterMap *)clutter)->Save(filename));
+} /* SPxViewerClutterSave() */
+
+int SPxViewerClutterLoad(void *clutter, const char *filename)
+{
+    if( clutter == NULL )
+    {
+	return(-1);
+    }
+    try
+    {
+	return(((SPxClutterMap *)clutter)->Load(filename));
+    }
+    catch(...)
+    {
+	return(-1);
+    }
+} /* SPxViewerClutterLoad() */
+
+void SPxViewerClutterReset(void *clutter)
+{
+    if( clutter != NULL )
+    {
+	((SPxClutterMap *)clutter)->Reset();
+    }
+} /* SPxViewerClutterReset() */
+
+
+/*====================================================================
+*
+* SPxViewerGetNumCores
+*	Report the number of hardware threads.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Number of hardware threads, at least one.
+*
+* Notes
+*
+*===================================================================*/
+int SPxViewerGetNumCores(void)
+{
+    return((int)SPxWorkPool::GetNumCores());
+} /* SPxViewerGetNumCores() */
+
+
+/*********************************************************************
+*
+*	Private functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* getPool
+*	Get the shared thread pool for a number of threads.
+*
+* Params:
+*	numThreads		Threads wanted, 0 for one per core.
+*
+* Returns:
+*	Pool, or NULL for a single thread.
+*
+* Notes
+*	The caller must hold PoolMutex until it has finished with the
+*	pool.
+*
+*===================================================================*/
+static SPxWorkPool *getPool(int numThreads)
+{
+    unsigned int threads = (numThreads > 0) ? (unsigned int)numThreads
+					    : SPxWorkPool::GetNumCores();
+    if( (WorkPool != NULL) && (WorkPool->GetNumThreads() != threads) )
+    {
+	delete WorkPool;
+	WorkPool = NULL;
+    }
+    if( (WorkPool == NULL) && (threads > 1) )
+    {
+	WorkPool = new SPxWorkPool(threads);
+    }
+    return(WorkPool);
+} /* getPool() */
+
+
+/*====================================================================
+*
+* selectKernels
+*	Pick the widest kernels the CPU supports.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Racing first calls from several threads all store the same
+*	values, so no lock is needed.
+*
+*===================================================================*/
+static void selectKernels(void)
+{
+    if( FadeFn != NULL )
+    {
+	return;
+    }
+#ifdef SPX_VIEWER_X86
+    __builtin_cpu_init();
+    if( __builtin_cpu_supports("avx2") )
+    {
+	SimdName = "avx2";
+	FadeFn = fadeAvx2;
+	return;
+    }
+    if( __builtin_cpu_supports("sse2") )
+    {
+	SimdName = "sse2";
+	FadeFn = fadeSse2;
+	return;
+    }
+#endif
+    SimdName = "scalar";
+    FadeFn = fadeScalar;
+} /* selectKernels() */
+
+
+/*====================================================================
+*
+* fadeScalar / fadeSse2 / fadeAvx2
+*	Scale each byte by factor/256.
+*
+* Params:
+*	bytes			Data to fade in place,
+*	numBytes		Number of bytes,
+*	factor			Multiplier in 1/256 units (0..255).
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	The SIMD versions widen to 16 bits, multiply, shift and pack
+*	back, and hand any tail to the scalar version.  All three give
+*	identical results.
+*
+*===================================================================*/
+static void fadeScalar(uint8_t *bytes, size_t numBytes, unsigned int factor)
+{
+    for(size_t i = 0; i < numBytes; i++)
+    {
+	bytes[i] = (uint8_t)((bytes[i] * factor) >> 8);
+    }
+} /* fadeScalar() */
+
+#ifdef SPX_VIEWER_X86
+__attribute__((target("sse2")))
+static void fadeSse2(uint8_t *bytes, size_t numBytes, unsigned int factor)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i mul = _mm_set1_epi16((short)factor);
+    size_t i = 0;
+    for(; i + 16 <= numBytes; i += 16)
+    {
+	__m128i v = _mm_loadu_si128((const __m128i *)(bytes + i));
+	__m128i lo = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(v, zero), mul), 8);
+	__m128i hi = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(v, zero), mul), 8);
+	_mm_storeu_si128((__m128i *)(bytes + i), _mm_packus_epi16(lo, hi));
+    }
+    fadeScalar(bytes + i, numBytes - i, factor);
+} /* fadeSse2() */
+
+__attribute__((target("avx2")))
+static void fadeAvx2(uint8_t *bytes, size_t numBytes, unsigned int factor)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i mul = _mm256_set1_epi16((short)factor);
+    size_t i = 0;
+    for(; i + 32 <= numBytes; i += 32)
+    {
+	/* unpack/pack 는 128비트 레인 단위로 동작하므로 순서가 유지됨 */
+	__m256i v = _mm256_loadu_si256((const __m256i *)(bytes + i));
+	__m256i lo = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(v, zero), mul), 8);
+	__m256i hi = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(v, zero), mul), 8);
+	_mm256_storeu_si256((__m256i *)(bytes + i), _mm256_packus_epi16(lo, hi));
+    }
+    fadeScalar(bytes + i, numBytes - i, factor);
+} /* fadeAvx2() */
+#endif /* SPX_VIEWER_X86 */
+
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
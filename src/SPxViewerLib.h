@@ -0,0 +1,130 @@
+/*********************************************************************
+*
+* File: SPxViewerLib.h
+*
+* Purpose:
+*	C interface of the native helper library (libspxviewer.so) used
+*	by the Python viewer through ctypes.
+*
+*	The library does not depend on the SPx library, so it can be
+*	built on machines without the SDK.  All functions operate on
+*	caller owned memory and never allocate per call; the raster
+*	scan converter allocates only when it is created or its
+*	geometry changes.
+*
+*	Any change to these prototypes must be mirrored in
+*	SPxRadarStream/native.py.
+*
+**********************************************************************/
+
+#ifndef _SPX_VIEWER_LIB_H
+#define _SPX_VIEWER_LIB_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Name of the SIMD instruction set selected at run time
+ * ("avx2", "sse2" or "scalar").
+ */
+const char *SPxViewerGetSimdName(void);
+
+/* Multiply every byte of a 32-bit pixel image by factor/256 in place
+ * (phosphor style fade).  factor is clamped to 0..256, pitchBytes is
+ * the distance between rows.
+ */
+void SPxViewerFade32(uint32_t *pixels, int width, int height,
+			int pitchBytes, int factor);
+
+/* Plot points into a 32-bit pixel image keeping the per-channel
+ * maximum of the existing pixel and the new colour.  Points outside
+ * the image are ignored.
+ */
+void SPxViewerPlotMax32(uint32_t *pixels, int width, int height,
+			int pitchBytes, const int32_t *xs, const int32_t *ys,
+			const uint32_t *colours, int numPoints);
+
+/* Tiled multi-threaded scan converter (see SPxViewerRaster.h).
+ * Render() writes the dirty tiles straight into a 32-bit pixel image
+ * of the size given at creation, using numThreads threads (zero or
+ * less for one per core).  flags are SPX_VIEWER_RASTER_MAX/_CONSUME.
+ */
+void *SPxViewerRasterCreate(int width, int height, int numAzis,
+			    int numGates, int tileSize);
+void SPxViewerRasterDestroy(void *raster);
+void SPxViewerRasterSetGeometry(void *raster, double centreX, double centreY,
+				double radiusPixels, double gatesInRadius);
+void SPxViewerRasterSetPalette(void *raster, const uint32_t *palette);
+void SPxViewerRasterUpdateSpoke(void *raster, double azimuthDegs,
+				const uint8_t *samples, int numSamples);
+void SPxViewerRasterClear(void *raster);
+void SPxViewerRasterInvalidate(void *raster);
+int SPxViewerRasterRender(void *raster, uint32_t *pixels, int pitchBytes,
+			  int numThreads, int flags);
+void SPxViewerRasterGetDirtyBounds(void *raster, int *x, int *y,
+				   int *w, int *h);
+
+/* Per-spoke filter chain on 8-bit samples (see SPxFilterChain.h).
+ * SetParams() returns zero on success or -1 with GetError() giving the
+ * reason.  ApplyFrame() filters numSpokes spokes in place; azimuthDegs
+ * gives each spoke's azimuth for mask stages (NULL skips them).  The
+ * frame is split over numThreads threads (0 = one per core), shared
+ * with the rasters, and the result does not depend on the number.
+ */
+void *SPxViewerFilterCreate(void);
+void SPxViewerFilterDestroy(void *filter);
+int SPxViewerFilterSetParams(void *filter, const char *params);
+const char *SPxViewerFilterGetError(void *filter);
+void SPxViewerFilterApplyFrame(void *filter, uint8_t *frame, int numSpokes,
+			       int numSamples, int strideBytes,
+			       const double *azimuthDegs, int numThreads);
+const char *SPxViewerFilterGetSimdName(void);
+
+/* Scan-to-scan integration (see SPxScanIntegrator.h).  Create() returns
+ * NULL if the args are invalid.  UpdateSpokes() adds numSpokes spokes
+ * and copies the integrated row of each spoke's bin (numGates samples)
+ * to out.
+ */
+void *SPxViewerIntegratorCreate(int numAzis, int numGates, const char *args);
+void SPxViewerIntegratorDestroy(void *integrator);
+void SPxViewerIntegratorUpdateSpokes(void *integrator, const double *azimuthDegs,
+				     const uint8_t *frame, int numSpokes,
+				     int numSamples, int strideBytes,
+				     uint8_t *out, int outStrideBytes);
+void SPxViewerIntegratorGetFrame(void *integrator, uint8_t *frame);
+void SPxViewerIntegratorReset(void *integrator);
+unsigned int SPxViewerIntegratorGetRotationCount(void *integrator);
+size_t SPxViewerIntegratorGetMemoryBytes(void *integrator);
+
+/* Adaptive clutter map (see SPxClutterMap.h).  Create() returns NULL
+ * if the args are invalid.  ApplySpokes() suppresses clutter on
+ * numSpokes spokes in place and learns from them, split over
+ * numThreads threads as for the filter.  Save() and Load() return
+ * zero on success or -1 on error.
+ */
+void *SPxViewerClutterCreate(int numAzis, int numGates, const char *args);
+void SPxViewerClutterDestroy(void *clutter);
+void SPxViewerClutterApplySpokes(void *clutter, const double *azimuthDegs,
+				 uint8_t *frame, int numSpokes,
+				 int numSamples, int strideBytes,
+				 int numThreads);
+int SPxViewerClutterSave(void *clutter, const char *filename);
+int SPxViewerClutterLoad(void *clutter, const char *filename);
+void SPxViewerClutterReset(void *clutter);
+
+/* Number of hardware threads. */
+int SPxViewerGetNumCores(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SPX_VIEWER_LIB_H */
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
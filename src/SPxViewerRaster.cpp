@@ -0,0 +1,573 @@
+/*********************************************************************
+*
+* File: SPxViewerRaster.cpp
+*
+* Purpose:
+*	Tiled software scan converter (see SPxViewerRaster.h).
+*
+**********************************************************************/
+
+/* Standard headers. */
+#include <math.h>
+#include <string.h>
+
+/* Our own headers. */
+#include "SPxWorkPool.h"
+#include "SPxViewerRaster.h"
+
+/*
+ * Constants.
+ */
+#ifndef M_PI
+#define	M_PI	3.14159265358979323846
+#endif
+
+/* Largest azimuth gap (as a fraction of a turn) filled from the new
+ * spoke, so that sparse spokes do not leave black wedges.
+ */
+#define	MAX_FILL_DIVISOR	32
+
+
+/*********************************************************************
+*
+*	Public functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* SPxViewerRaster::SPxViewerRaster
+*	Constructor.
+*
+* Params:
+*	width, height		Output image size in pixels,
+*	numAzis			Azimuth bins per turn,
+*	numGates		Range gates per spoke,
+*	tileSize		Tile side in pixels.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Nothing is drawn until SetGeometry() is called.
+*
+*===================================================================*/
+SPxViewerRaster::SPxViewerRaster(int width, int height, int numAzis,
+				 int numGates, int tileSize)
+{
+    m_width = (width > 0) ? width : 1;
+    m_height = (height > 0) ? height : 1;
+    m_numAzis = (numAzis > 0) ? numAzis : 1;
+    m_numGates = (numGates > 1) ? numGates : 2;
+    m_tileSize = (tileSize >= 8) ? tileSize : 8;
+    m_tilesX = (m_width + m_tileSize - 1) / m_tileSize;
+    m_tilesY = (m_height + m_tileSize - 1) / m_tileSize;
+
+    m_polar.assign((size_t)m_numAzis * m_numGates + 1, 0);
+    m_lut.assign((size_t)m_width * m_height, (int32_t)(m_polar.size() - 1));
+    m_aziTileStart.assign(m_numAzis + 1, 0);
+    m_tileDirty.assign(m_tilesX * m_tilesY, 0);
+    m_aziUpdated.assign(m_numAzis, 0);
+    m_lastAzi = -1;
+    m_boundsX0 = m_boundsY0 = m_boundsX1 = m_boundsY1 = 0;
+
+    /* 기본 팔레트: 세기를 초록색 채널로 표시 (기존 표시와 동일) */
+    for(int i = 0; i < 256; i++)
+    {
+	m_palette[i] = (uint32_t)i << 8;
+    }
+
+    m_renderPixels = NULL;
+    m_renderPitch = 0;
+    m_renderFlags = 0;
+    Invalidate();
+} /* SPxViewerRaster::SPxViewerRaster() */
+
+
+/*====================================================================
+*
+* SPxViewerRaster::~SPxViewerRaster
+*	Destructor.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+SPxViewerRaster::~SPxViewerRaster()
+{
+} /* SPxViewerRaster::~SPxViewerRaster() */
+
+
+/*====================================================================
+*
+* SPxViewerRaster::SetGeometry
+*	Rebuild the pixel lookup table for a new centre or zoom.
+*
+* Params:
+*	centreX, centreY	Radar position in output pixels,
+*	radiusPixels		Radius of the displayed range in pixels,
+*	gatesInRadius		Number of gates covered by that radius.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Azimuth zero is up and increases clockwise, as in the viewer.
+*	Pixels outside the radius map to the spare zero entry of the
+*	polar image.  Every tile is rendered on the next Render().
+*
+*===================================================================*/
+void SPxViewerRaster::SetGeometry(double centreX, double centreY,
+				  double radiusPixels, double gatesInRadius)
+{
+    const int32_t outside = (int32_t)(m_polar.size() - 1);
+    double gatesPerPixel = (radiusPixels > 0.0) ? (gatesInRadius / radiusPixels) : 0.0;
+    double binsPerRadian = m_numAzis / (2.0 * M_PI);
+
+    for(int y = 0; y < m_height; y++)
+    {
+	double dy = (y + 0.5) - centreY;
+	int32_t *lut = &m_lut[(size_t)y * m_width];
+	for(int x = 0; x < m_width; x++)
+	{
+	    double dx = (x + 0.5) - centreX;
+	    double r = sqrt((dx * dx) + (dy * dy));
+	    int gate = (int)((r * gatesPerPixel) + 0.5);
+	    if( (radiusPixels <= 0.0) || (r > radiusPixels) || (gate >= m_numGates) )
+	    {
+		lut[x] = outside;
+		continue;
+	    }
+	    double theta = atan2(dx, -dy);
+	    if( theta < 0.0 )
+	    {
+		theta += 2.0 * M_PI;
+	    }
+	    int azi = (int)(theta * binsPerRadian);
+	    if( azi >= m_numAzis )
+	    {
+		azi = 0;
+	    }
+	    lut[x] = (azi * m_numGates) + gate;
+	}
+    }
+
+    /* 방위 빈마다 그 빈을 참조하는 타일 목록 작성 (CSR) */
+    std::vector<int32_t> pairAzi;
+    std::vector<int32_t> pairTile;
+    std::vector<uint8_t> seen(m_numAzis, 0);
+    std::vector<int32_t> tileAzis;
+    for(int t = 0; t < m_tilesX * m_tilesY; t++)
+    {
+	int x0 = (t % m_tilesX) * m_tileSize;
+	int y0 = (t / m_tilesX) * m_tileSize;
+	int x1 = (x0 + m_tileSize < m_width) ? (x0 + m_tileSize) : m_width;
+	int y1 = (y0 + m_tileSize < m_height) ? (y0 + m_tileSize) : m_height;
+	tileAzis.clear();
+	for(int y = y0; y < y1; y++)
+	{
+	    const int32_t *lut = &m_lut[(size_t)y * m_width];
+	    for(int x = x0; x < x1; x++)
+	    {
+		if( lut[x] == outside )
+		{
+		    continue;
+		}
+		int azi = lut[x] / m_numGates;
+		if( !seen[azi] )
+		{
+		    seen[azi] = 1;
+		    tileAzis.push_back(azi);
+		}
+	    }
+	}
+	for(size_t i = 0; i < tileAzis.size(); i++)
+	{
+	    seen[tileAzis[i]] = 0;
+	    pairAzi.push_back(tileAzis[i]);
+	    pairTile.push_back(t);
+	}
+    }
+    m_aziTileStart.assign(m_numAzis + 1, 0);
+    for(size_t i = 0; i < pairAzi.size(); i++)
+    {
+	m_aziTileStart[pairAzi[i] + 1]++;
+    }
+    for(int a = 0; a < m_numAzis; a++)
+    {
+	m_aziTileStart[a + 1] += m_aziTileStart[a];
+    }
+    m_aziTiles.assign(pairAzi.size(), 0);
+    std::vector<int32_t> fill(m_aziTileStart.begin(), m_aziTileStart.end() - 1);
+    for(size_t i = 0; i < pairAzi.size(); i++)
+    {
+	m_aziTiles[fill[pairAzi[i]]++] = pairTile[i];
+    }
+
+    Invalidate();
+} /* SPxViewerRaster::SetGeometry() */
+
+
+/*====================================================================
+*
+* SPxViewerRaster::SetPalette
+*	Set the intensity to pixel colour mapping.
+*
+* Params:
+*	palette			256 colours in the output pixel format.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+void SPxViewerRaster::SetPalette(const uint32_t *palette)
+{
+    if( palette == NULL )
+    {
+	return;
+    }
+    memcpy(m_palette, palette, sizeof(m_palette));
+    Invalidate();
+} /* SPxViewerRaster::SetPalette() */
+
+
+/*====================================================================
+*
+* SPxViewerRaster::UpdateSpoke
+*	Store one spoke and mark the tiles it touches.
+*
+* Params:
+*	azimuthDegs		Azimuth, degrees clockwise from north,
+*	samples			Intensities, first sample at zero range,
+*	numSamples		Number of samples spanning all the gates.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Spokes of a different length are resampled to the nearest gate.
+*	Small gaps since the previous spoke are filled with this one so
+*	the image has no holes when spokes are coarser than the bins.
+*
+*===================================================================*/
+void SPxViewerRaster::UpdateSpoke(double azimuthDegs, const uint8_t *samples,
+				  int numSamples)
+{
+    if( (samples == NULL) || (numSamples <= 0) )
+    {
+	return;
+    }
+    double turns = azimuthDegs / 360.0;
+    turns -= floor(turns);
+    int azi = (int)(turns * m_numAzis);
+    if( azi >= m_numAzis )
+    {
+	azi = 0;
+    }
+
+    uint8_t *row = &m_polar[(size_t)azi * m_numGates];
+    if( numSamples == m_numGates )
+    {
+	memcpy(row, samples, m_numGates);
+    }
+    else
+    {
+	int64_t num = numSamples - 1;
+	int64_t den = m_numGates - 1;
+	for(int g = 0; g < m_numGates; g++)
+	{
+	    row[g] = samples[((g * num) + (den / 2)) / den];
+	}
+    }
+    markAzi(azi);
+
+    if( m_lastAzi >= 0 )
+    {
+	int gap = (azi - m_lastAzi + m_numAzis) % m_numAzis;
+	if( (gap > 1) && (gap <= m_numAzis / MAX_FILL_DIVISOR) )
+	{
+	    for(int i = 1; i < gap; i++)
+	    {
+		int fillAzi = (m_lastAzi + i) % m_numAzis;
+		memcpy(&m_polar[(size_t)fillAzi * m_numGates], row, m_numGates);
+		markAzi(fillAzi);
+	    }
+	}
+    }
+    m_lastAzi = azi;
+} /* SPxViewerRaster::UpdateSpoke() */
+
+
+/*====================================================================
+*
+* SPxViewerRaster::Clear
+*	Clear the polar image.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+void SPxViewerRaster::Clear(void)
+{
+    memset(&m_polar[0], 0, m_polar.size());
+    m_lastAzi = -1;
+    Invalidate();
+} /* SPxViewerRaster::Clear() */
+
+
+/*====================================================================
+*
+* SPxViewerRaster::Invalidate
+*	Mark every tile for rendering.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Used after the destination surface has been replaced or cleared.
+*
+*===================================================================*/
+void SPxViewerRaster::Invalidate(void)
+{
+    m_dirtyTiles.clear();
+    for(int t = 0; t < m_tilesX * m_tilesY; t++)
+    {
+	m_tileDirty[t] = 1;
+	m_dirtyTiles.push_back(t);
+    }
+} /* SPxViewerRaster::Invalidate() */
+
+
+/*====================================================================
+*
+* SPxViewerRaster::Render
+*	Scan convert the dirty tiles into a 32-bit image.
+*
+* Params:
+*	pixels			First pixel of the output image,
+*	pitchBytes		Distance between rows in bytes,
+*	pool			Thread pool, or NULL to render inline,
+*	flags			SPX_VIEWER_RASTER_... flags.
+*
+* Returns:
+*	Number of tiles rendered.
+*
+* Notes
+*	Tiles are independent, so each pool task writes one tile with no
+*	locking.  With SPX_VIEWER_RASTER_CONSUME the spokes are zeroed
+*	afterwards, so a MAX render on a fading image only adds the new
+*	video instead of restoring the old.
+*
+*===================================================================*/
+int SPxViewerRaster::Render(uint32_t *pixels, int pitchBytes,
+			    SPxWorkPool *pool, int flags)
+{
+    int numTiles = (int)m_dirtyTiles.size();
+    if( (pixels == NULL) || (numTiles == 0) )
+    {
+	m_boundsX0 = m_boundsY0 = m_boundsX1 = m_boundsY1 = 0;
+	return(0);
+    }
+
+    m_renderPixels = pixels;
+    m_renderPitch = pitchBytes;
+    m_renderFlags = flags;
+    if( pool != NULL )
+    {
+	pool->Run((unsigned int)numTiles, renderTask, this);
+    }
+    else
+    {
+	for(int i = 0; i < numTiles; i++)
+	{
+	    renderTile(m_dirtyTiles[i]);
+	}
+    }
+
+    /* 그려진 타일들의 외곽 영역 계산 후 변경 표시 초기화 */
+    m_boundsX0 = m_tilesX;
+    m_boundsY0 = m_tilesY;
+    m_boundsX1 = 0;
+    m_boundsY1 = 0;
+    for(int i = 0; i < numTiles; i++)
+    {
+	int t = m_dirtyTiles[i];
+	int tx = t % m_tilesX;
+	int ty = t / m_tilesX;
+	if( tx < m_boundsX0 ) m_boundsX0 = tx;
+	if( ty < m_boundsY0 ) m_boundsY0 = ty;
+	if( tx + 1 > m_boundsX1 ) m_boundsX1 = tx + 1;
+	if( ty + 1 > m_boundsY1 ) m_boundsY1 = ty + 1;
+	m_tileDirty[t] = 0;
+    }
+    m_dirtyTiles.clear();
+
+    for(size_t i = 0; i < m_updatedAzis.size(); i++)
+    {
+	int azi = m_updatedAzis[i];
+	if( flags & SPX_VIEWER_RASTER_CONSUME )
+	{
+	    memset(&m_polar[(size_t)azi * m_numGates], 0, m_numGates);
+	}
+	m_aziUpdated[azi] = 0;
+    }
+    m_updatedAzis.clear();
+
+    m_renderPixels = NULL;
+    return(numTiles);
+} /* SPxViewerRaster::Render() */
+
+
+/*====================================================================
+*
+* SPxViewerRaster::GetDirtyBounds
+*	Get the area written by the last Render().
+*
+* Params:
+*	x, y, w, h		Set to the bounding rectangle in pixels
+*				(zero size if nothing was rendered).
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+void SPxViewerRaster::GetDirtyBounds(int *x, int *y, int *w, int *h) const
+{
+    int x0 = m_boundsX0 * m_tileSize;
+    int y0 = m_boundsY0 * m_tileSize;
+    int x1 = m_boundsX1 * m_tileSize;
+    int y1 = m_boundsY1 * m_tileSize;
+    if( x1 > m_width ) x1 = m_width;
+    if( y1 > m_height ) y1 = m_height;
+    if( x ) *x = x0;
+    if( y ) *y = y0;
+    if( w ) *w = (x1 > x0) ? (x1 - x0) : 0;
+    if( h ) *h = (y1 > y0) ? (y1 - y0) : 0;
+} /* SPxViewerRaster::GetDirtyBounds() */
+
+
+/*********************************************************************
+*
+*	Private functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* SPxViewerRaster::markAzi
+*	Record an updated azimuth bin and mark its tiles dirty.
+*
+* Params:
+*	azi			Azimuth bin.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+void SPxViewerRaster::markAzi(int azi)
+{
+    if( !m_aziUpdated[azi] )
+    {
+	m_aziUpdated[azi] = 1;
+	m_updatedAzis.push_back(azi);
+    }
+    for(int i = m_aziTileStart[azi]; i < m_aziTileStart[azi + 1]; i++)
+    {
+	int t = m_aziTiles[i];
+	if( !m_tileDirty[t] )
+	{
+	    m_tileDirty[t] = 1;
+	    m_dirtyTiles.push_back(t);
+	}
+    }
+} /* SPxViewerRaster::markAzi() */
+
+
+/*====================================================================
+*
+* SPxViewerRaster::renderTile / renderTask
+*	Scan convert one tile (renderTask is the pool entry point).
+*
+* Params:
+*	tileIdx			Tile to render.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Each output row is a gather through the lookup table and a
+*	palette lookup, written directly to the destination row.
+*
+*===================================================================*/
+void SPxViewerRaster::renderTile(int tileIdx)
+{
+    int x0 = (tileIdx % m_tilesX) * m_tileSize;
+    int y0 = (tileIdx / m_tilesX) * m_tileSize;
+    int x1 = (x0 + m_tileSize < m_width) ? (x0 + m_tileSize) : m_width;
+    int y1 = (y0 + m_tileSize < m_height) ? (y0 + m_tileSize) : m_height;
+    int n = x1 - x0;
+    const uint8_t *polar = &m_polar[0];
+    const uint32_t *palette = m_palette;
+
+    for(int y = y0; y < y1; y++)
+    {
+	const int32_t *lut = &m_lut[((size_t)y * m_width) + x0];
+	uint32_t *row = (uint32_t *)((uint8_t *)m_renderPixels + ((size_t)y * m_renderPitch)) + x0;
+	if( m_renderFlags & SPX_VIEWER_RASTER_MAX )
+	{
+	    for(int i = 0; i < n; i++)
+	    {
+		uint32_t a = row[i];
+		uint32_t b = palette[polar[lut[i]]];
+		uint32_t out = 0;
+		for(int shift = 0; shift < 32; shift += 8)
+		{
+		    uint32_t ca = (a >> shift) & 0xFF;
+		    uint32_t cb = (b >> shift) & 0xFF;
+		    out |= ((ca > cb) ? ca : cb) << shift;
+		}
+		row[i] = out;
+	    }
+	}
+	else
+	{
+	    for(int i = 0; i < n; i++)
+	    {
+		row[i] = palette[polar[lut[i]]];
+	    }
+	}
+    }
+} /* SPxViewerRaster::renderTile() */
+
+void SPxViewerRaster::renderTask(void *userArg, unsigned int taskIdx,
+				 unsigned int /* workerIdx */)
+{
+    SPxViewerRaster *raster = (SPxViewerRaster *)userArg;
+    raster->renderTile(raster->m_dirtyTiles[taskIdx]);
+} /* SPxViewerRaster::renderTask() */
+
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
@@ -0,0 +1,113 @@
+/*********************************************************************
+*
+* File: SPxViewerRaster.h
+*
+* Purpose:
+*	Tiled software scan converter for the Python viewer.
+*
+*	Spokes are stored in a polar image (azimuth bins x range gates).
+*	The Cartesian output is split into square tiles and each output
+*	pixel has a precomputed offset into the polar image, so rendering
+*	a tile is a gather plus a palette lookup per pixel.  Updating a
+*	spoke only marks the tiles its azimuth bin touches, and Render()
+*	converts the dirty tiles in parallel on a SPxWorkPool, writing
+*	straight into the caller's 32-bit pixel rows.
+*
+*	Spoke updates and Render() must come from one thread; the pool
+*	threads only run inside Render().
+*
+**********************************************************************/
+
+#ifndef _SPX_VIEWER_RASTER_H
+#define _SPX_VIEWER_RASTER_H
+
+#include <stdint.h>
+#include <vector>
+
+/* Forward declarations. */
+class SPxWorkPool;
+
+/* Render flags. */
+#define	SPX_VIEWER_RASTER_MAX		0x01	/* Per-channel max with existing pixels */
+#define	SPX_VIEWER_RASTER_CONSUME	0x02	/* Zero updated spokes after rendering */
+
+class SPxViewerRaster
+{
+public:
+    /* Constructor/destructor. */
+    SPxViewerRaster(int width, int height, int numAzis, int numGates,
+		    int tileSize);
+    ~SPxViewerRaster();
+
+    /* Configuration. */
+    void SetGeometry(double centreX, double centreY, double radiusPixels,
+		     double gatesInRadius);
+    void SetPalette(const uint32_t *palette);
+
+    /* Data input. */
+    void UpdateSpoke(double azimuthDegs, const uint8_t *samples,
+		     int numSamples);
+    void Clear(void);
+    void Invalidate(void);
+
+    /* Rendering. */
+    int Render(uint32_t *pixels, int pitchBytes, SPxWorkPool *pool,
+	       int flags);
+    void GetDirtyBounds(int *x, int *y, int *w, int *h) const;
+
+    /* Information retrieval. */
+    int GetWidth(void) const { return m_width; }
+    int GetHeight(void) const { return m_height; }
+    int GetNumTiles(void) const { return m_tilesX * m_tilesY; }
+
+private:
+    /* Image and polar sizes. */
+    int m_width;
+    int m_height;
+    int m_numAzis;
+    int m_numGates;
+    int m_tileSize;
+    int m_tilesX;
+    int m_tilesY;
+
+    /* Polar image, with one extra zero entry for pixels out of range. */
+    std::vector<uint8_t> m_polar;
+
+    /* Offset into m_polar for every output pixel (row major). */
+    std::vector<int32_t> m_lut;
+
+    /* Tiles touched by each azimuth bin (CSR layout). */
+    std::vector<int32_t> m_aziTileStart;
+    std::vector<int32_t> m_aziTiles;
+
+    /* Dirty tiles and azimuth bins written since the last render. */
+    std::vector<uint8_t> m_tileDirty;
+    std::vector<int32_t> m_dirtyTiles;
+    std::vector<uint8_t> m_aziUpdated;
+    std::vector<int32_t> m_updatedAzis;
+    int m_lastAzi;
+
+    /* Bounds of the tiles written by the last render. */
+    int m_boundsX0, m_boundsY0, m_boundsX1, m_boundsY1;
+
+    uint32_t m_palette[256];
+
+    /* State of the render in progress (read by the pool threads). */
+    uint32_t *m_renderPixels;
+    int m_renderPitch;
+    int m_renderFlags;
+
+    /* Private functions. */
+    void markAzi(int azi);
+    void renderTile(int tileIdx);
+    static void renderTask(void *userArg, unsigned int taskIdx,
+			   unsigned int workerIdx);
+};
+
+#endif /* _SPX_VIEWER_RASTER_H */
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
@@ -0,0 +1,611 @@
+/*********************************************************************
+*
+* File: SPxWebBench.cpp
+*
+* Purpose:
+*	Fan-out cost of the browser viewer server (SPxWebStream) on
+*	loopback.
+*
+*	A synthetic radar (noise, near clutter and moving targets)
+*	is published into a server while 1, 2, 4, ... WebSocket clients
+*	read it, each decoding the sector deltas into its own copy of
+*	the grid as the browser viewer does.  For each client count the
+*	server's hub thread CPU, the bytes and updates per client and
+*	the encode time per update are printed, with the share of the
+*	sector messages that were encoded once for several clients.
+*	Optionally the last client reads slowly (-w) to show the rate
+*	limiting.
+*
+*	When the radar stops, every client's grid must come to match
+*	the others'; any that do not are reported.
+*
+*	The program does not need the SPx library.
+*
+*	Run the program with "-?" as the command line option to get a help
+*	message.
+*
+**********************************************************************/
+
+/* Standard headers. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <zlib.h>
+
+/* Our own headers. */
+#include "SPxWebStream.h"
+
+/*
+ * Constants.
+ */
+#define	DEFAULT_CLIENTS	"1,2,4,8,16"
+#define	USAGE "Usage:\n\tSPxWebBench [options]\n"			\
+		"\nOptions:\n"						\
+		"\t-a <bins>\tSet grid azimuth bins (default 1024)\n"	\
+		"\t-c <counts>\tSet client counts (default \"" DEFAULT_CLIENTS "\")\n" \
+		"\t-d <secs>\tSet seconds per measurement (default 5)\n" \
+		"\t-e <noise>\tSet noise amplitude, 0 for thresholded\n" \
+		"\t\t\tvideo (default 64)\n"				\
+		"\t-f <fps>\tSet updates per second per client (default 10)\n" \
+		"\t-g <gates>\tSet grid range gates (default 512)\n"	\
+		"\t-r <rpm>\tSet radar rotation rate (default 60)\n"	\
+		"\t-w <usecs>\tMake the last client read slowly, waiting\n" \
+		"\t\t\tthis long per message\n"				\
+		"\t-?\t\tPrint usage information.\n\n"
+
+/* Radar spokes per turn and samples per spoke. */
+#define	RADAR_SPOKES	4096
+#define	RADAR_SAMPLES	1024
+
+/* Example key and accept value from RFC 6455. */
+#define	WS_TEST_KEY	"dGhlIHNhbXBsZSBub25jZQ=="
+#define	WS_TEST_ACCEPT	"s3pPLMBiTxaQ9kYGzzhZRbK+xOo="
+
+/* The synthetic radar. */
+struct Radar
+{
+    SPxWebStream *server;
+    unsigned int rpm;
+    unsigned int noise;
+    std::atomic<int> stop;
+};
+
+/* A client and what it has received. */
+struct BenchClient
+{
+    int port;
+    unsigned int delayUsecs;		/* Per message, 0 for none */
+    std::atomic<int> stop;
+    int ok;				/* Connected and decoding */
+    unsigned int numAz;
+    unsigned int gates;
+    std::vector<unsigned char> grid;
+    uint64_t numMessages;
+    uint64_t numBytes;
+};
+
+/*
+ * Private function prototypes.
+ */
+static int runClients(unsigned int numClients, const char *serverSpec,
+		      unsigned int rpm, unsigned int noise, double secs,
+		      unsigned int slowUsecs);
+static void radarThread(Radar *radar);
+static void clientThread(BenchClient *client);
+static int readAll(BenchClient *client, int fd, void *buf, size_t len);
+static double nowSecs(void);
+
+
+/*********************************************************************
+*
+*	Public functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* main
+*	Main entry point for the program.
+*
+* Params:
+*	argc, argv		Command line arguments.
+*
+* Returns:
+*	Zero if every client's grid matched, -1 otherwise.
+*
+* Notes
+*
+*===================================================================*/
+int main(int argc, char **argv)
+{
+    int c;
+    unsigned int numAz = 1024;
+    unsigned int gates = 512;
+    const char *counts = DEFAULT_CLIENTS;
+    double secs = 5.0;
+    unsigned int noise = 64;
+    unsigned int fps = 10;
+    unsigned int rpm = 60;
+    unsigned int slowUsecs = 0;
+
+    /* Process any command line arguments.  */
+    opterr = 0;
+    while( (c = getopt(argc, argv, "a:c:d:e:f:g:r:w:?")) != -1 )
+    {
+	switch(c)
+	{
+	    case 'a':	numAz = strtoul(optarg, NULL, 0);	break;
+	    case 'c':	counts = optarg;			break;
+	    case 'd':	secs = strtod(optarg, NULL);		break;
+	    case 'e':	noise = strtoul(optarg, NULL, 0);	break;
+	    case 'f':	fps = strtoul(optarg, NULL, 0);		break;
+	    case 'g':	gates = strtoul(optarg, NULL, 0);	break;
+	    case 'r':	rpm = strtoul(optarg, NULL, 0);		break;
+	    case 'w':	slowUsecs = strtoul(optarg, NULL, 0);	break;
+	    case '?':	/* fall through */
+	    default:
+		fprintf(stderr, "\n%s", USAGE);
+		exit(-1);
+	}
+    } /* end of for each option */
+
+    std::vector<unsigned int> clientCounts;
+    const char *p = counts;
+    while( *p != '\0' )
+    {
+	char *end = NULL;
+	unsigned long n = strtoul(p, &end, 10);
+	if( (end == p) || (n < 1) || (n > 60) || ((*end != ',') && (*end != '\0')) )
+	{
+	    clientCounts.clear();
+	    break;
+	}
+	clientCounts.push_back((unsigned int)n);
+	p = (*end == ',') ? (end + 1) : end;
+    }
+    if( clientCounts.empty() || (secs <= 0.0) || (rpm < 1) || (noise > 255) )
+    {
+	fprintf(stderr, "Invalid parameters.\n\n%s", USAGE);
+	exit(-1);
+    }
+
+    char serverSpec[128];
+    snprintf(serverSpec, sizeof(serverSpec), "127.0.0.1:0,az=%u,gates=%u,fps=%u",
+	     numAz, gates, fps);
+    printf("SPxWebBench: grid %u x %u, %u updates/s per client, radar %u rpm,"
+	   " noise %u, %.1f s per measurement%s\n\n", numAz, gates, fps, rpm,
+	   noise, secs, (slowUsecs > 0) ? ", last client slow" : "");
+    printf("clients | server CPU %% | CPU %%/client | kB/s/client | updates/s"
+	   " | raw:sent | us/update | shared %% | deferred | grids\n");
+
+    int failed = 0;
+    for(size_t i = 0; i < clientCounts.size(); i++)
+    {
+	if( runClients(clientCounts[i], serverSpec, rpm, noise, secs,
+		       slowUsecs) != 0 )
+	{
+	    failed = 1;
+	}
+    }
+
+    printf("\n%s\n", failed ? "Client grids DIFFER (or a client failed)."
+	   : "All client grids match.");
+    return( failed ? -1 : 0 );
+} /* main() */
+
+
+/*********************************************************************
+*
+*	Private functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* runClients
+*	Measure one client count.
+*
+* Params:
+*	numClients		Clients,
+*	serverSpec		SPxWebStream::Create() spec,
+*	rpm, noise		Synthetic radar,
+*	secs			Measurement time,
+*	slowUsecs		Delay per message of the last client, or 0.
+*
+* Returns:
+*	Zero if the clients' grids matched, -1 otherwise.
+*
+* Notes
+*	Prints a row of the table.
+*
+*===================================================================*/
+static int runClients(unsigned int numClients, const char *serverSpec,
+		      unsigned int rpm, unsigned int noise, double secs,
+		      unsigned int slowUsecs)
+{
+    SPxWebStream server;
+    if( server.Create(serverSpec) != 0 )
+    {
+	fprintf(stderr, "Failed to create server: %s.\n", server.GetError());
+	return(-1);
+    }
+
+    Radar radar;
+    radar.server = &server;
+    radar.rpm = rpm;
+    radar.noise = noise;
+    radar.stop = 0;
+    std::thread radarT(radarThread, &radar);
+
+    std::vector<BenchClient *> clients;
+    std::vector<std::thread> threads;
+    for(unsigned int i = 0; i < numClients; i++)
+    {
+	BenchClient *client = new BenchClient();
+	client->port = server.GetPort();
+	client->delayUsecs = ((i + 1 == numClients) && (numClients > 1)) ? slowUsecs : 0;
+	client->stop = 0;
+	client->ok = 0;
+	client->numAz = 0;
+	client->gates = 0;
+	client->numMessages = 0;
+	client->numBytes = 0;
+	clients.push_back(client);
+	threads.push_back(std::thread(clientThread, client));
+    }
+
+    /* 접속과 첫 전체 전송이 끝난 뒤부터 측정 */
+    SPxWebStream::Stats stats;
+    std::vector<SPxWebStream::ClientStats> clientStats;
+    usleep(1000000);
+    server.GetStats(&stats, &clientStats);
+    usleep((useconds_t)(secs * 1e6));
+    server.GetStats(&stats, &clientStats);
+
+    /* 레이더를 멈추고 모든 클라이언트가 마지막 상태를 받을 때까지 대기 */
+    radar.stop = 1;
+    radarT.join();
+    usleep(2000000);
+    for(unsigned int i = 0; i < numClients; i++)
+    {
+	clients[i]->stop = 1;
+    }
+    for(unsigned int i = 0; i < numClients; i++)
+    {
+	threads[i].join();
+    }
+
+    int match = 1;
+    for(unsigned int i = 0; i < numClients; i++)
+    {
+	if( !clients[i]->ok || clients[i]->grid.empty()
+	    || (clients[i]->grid != clients[0]->grid) )
+	{
+	    match = 0;
+	}
+    }
+
+    uint64_t numUpdates = 0, numBytes = 0, numRawBytes = 0, numDeferred = 0;
+    uint64_t numSectors = 0, numShared = 0;
+    double encodeUsecs = 0.0;
+    for(size_t i = 0; i < clientStats.size(); i++)
+    {
+	numUpdates += clientStats[i].numUpdates;
+	numBytes += clientStats[i].numBytes;
+	numRawBytes += clientStats[i].numRawBytes;
+	numDeferred += clientStats[i].numDeferred;
+	numSectors += clientStats[i].numSectors;
+	numShared += clientStats[i].numShared;
+	encodeUsecs += clientStats[i].encodeUsecs;
+    }
+    double cpu = (stats.secs > 0.0) ? (100.0 * stats.cpuSecs / stats.secs) : 0.0;
+    printf("%7u | %12.1f | %12.2f | %11.1f | %9.1f | %8.1f | %9.1f | %8.1f | %8llu | %s\n",
+	   numClients, cpu, cpu / numClients,
+	   (double)numBytes / 1024.0 / numClients / stats.secs,
+	   (double)numUpdates / numClients / stats.secs,
+	   (numBytes > 0) ? ((double)numRawBytes / (double)numBytes) : 0.0,
+	   (numUpdates > 0) ? (encodeUsecs / (double)numUpdates) : 0.0,
+	   (numSectors > 0) ? (100.0 * numShared / (double)numSectors) : 0.0,
+	   (unsigned long long)numDeferred, match ? "match" : "DIFFER");
+    fflush(stdout);
+
+    for(unsigned int i = 0; i < numClients; i++)
+    {
+	delete clients[i];
+    }
+    return( match ? 0 : -1 );
+} /* runClients() */
+
+
+/*====================================================================
+*
+* radarThread
+*	Publish a rotating synthetic radar until stopped.
+*
+* Params:
+*	radar			Radar.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Noise changes every turn; the clutter is fixed and a few targets
+*	move slowly outwards.
+*
+*===================================================================*/
+static void radarThread(Radar *radar)
+{
+    std::vector<unsigned char> samples(RADAR_SAMPLES);
+    unsigned int seed = 12345;
+    double spokesPerSec = (double)RADAR_SPOKES * radar->rpm / 60.0;
+    double start = nowSecs();
+    unsigned long long numSpokes = 0;
+    while( !radar->stop )
+    {
+	/* 회전 속도에 맞춰 밀린 스포크를 발행 */
+	unsigned long long due = (unsigned long long)((nowSecs() - start) * spokesPerSec);
+	for( ; numSpokes < due; numSpokes++)
+	{
+	    unsigned int a = (unsigned int)(numSpokes % RADAR_SPOKES);
+	    unsigned int turn = (unsigned int)(numSpokes / RADAR_SPOKES);
+	    for(unsigned int g = 0; g < RADAR_SAMPLES; g++)
+	    {
+		/* xorshift32 (an LCG's low bits would repeat every turn) */
+		seed ^= seed << 13;
+		seed ^= seed >> 17;
+		seed ^= seed << 5;
+		unsigned int v = (radar->noise > 0) ? ((seed >> 8) % radar->noise) : 0;
+		if( g < RADAR_SAMPLES / 8 )
+		{
+		    v += 200 - (g * 160 / (RADAR_SAMPLES / 8));
+		}
+		/* 방위 8 개 위치의 표적이 회전마다 바깥으로 이동 */
+		unsigned int targetGate = (200 + (turn * 3) + (a / 512) * 40) % RADAR_SAMPLES;
+		if( ((a % 512) < 12) && (g >= targetGate) && (g < targetGate + 6) )
+		{
+		    v += 180;
+		}
+		samples[g] = (unsigned char)((v > 255) ? 255 : v);
+	    }
+	    radar->server->Publish((uint16_t)((a * 65536u) / RADAR_SPOKES),
+				   5000.0f, &samples[0], RADAR_SAMPLES, 1);
+	}
+	usleep(1000);
+    }
+} /* radarThread() */
+
+
+/*====================================================================
+*
+* clientThread
+*	Connect to the server and decode its messages until stopped.
+*
+* Params:
+*	client			Client.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Sets client->ok once the handshake has been checked.
+*
+*===================================================================*/
+static void clientThread(BenchClient *client)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons((uint16_t)client->port);
+    sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    struct timeval tv = { 0, 100000 };
+    if( (fd < 0) || (connect(fd, (struct sockaddr *)&sa, sizeof(sa)) != 0)
+	|| (setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) != 0) )
+    {
+	fprintf(stderr, "Client failed to connect.\n");
+	if( fd >= 0 )
+	{
+	    close(fd);
+	}
+	return;
+    }
+
+    /* 핸드셰이크와 Sec-WebSocket-Accept 확인 */
+    std::string request = "GET / HTTP/1.1\r\nHost: 127.0.0.1\r\n"
+	"Upgrade: websocket\r\nConnection: Upgrade\r\n"
+	"Sec-WebSocket-Key: " WS_TEST_KEY "\r\nSec-WebSocket-Version: 13\r\n\r\n";
+    std::string reply;
+    if( send(fd, request.data(), request.size(), MSG_NOSIGNAL) != (ssize_t)request.size() )
+    {
+	close(fd);
+	return;
+    }
+    while( reply.find("\r\n\r\n") == std::string::npos )
+    {
+	char ch;
+	if( readAll(client, fd, &ch, 1) != 0 )
+	{
+	    close(fd);
+	    return;
+	}
+	reply += ch;
+    }
+    if( (reply.find(" 101 ") == std::string::npos)
+	|| (reply.find("Sec-WebSocket-Accept: " WS_TEST_ACCEPT "\r\n") == std::string::npos) )
+    {
+	fprintf(stderr, "Client handshake failed:\n%s", reply.c_str());
+	close(fd);
+	return;
+    }
+    client->ok = 1;
+
+    std::vector<unsigned char> payload;
+    std::vector<unsigned char> rows;
+    for(;;)
+    {
+	unsigned char h[10];
+	if( readAll(client, fd, h, 2) != 0 )
+	{
+	    break;
+	}
+	uint64_t len = h[1] & 0x7F;
+	if( len == 126 )
+	{
+	    if( readAll(client, fd, h + 2, 2) != 0 )
+	    {
+		break;
+	    }
+	    len = ((uint64_t)h[2] << 8) | h[3];
+	}
+	else if( len == 127 )
+	{
+	    if( readAll(client, fd, h + 2, 8) != 0 )
+	    {
+		break;
+	    }
+	    len = 0;
+	    for(int i = 0; i < 8; i++)
+	    {
+		len = (len << 8) | h[2 + i];
+	    }
+	}
+	payload.resize((size_t)len);
+	if( (len > 0) && (readAll(client, fd, &payload[0], (size_t)len) != 0) )
+	{
+	    break;
+	}
+	client->numMessages++;
+	client->numBytes += len;
+	if( ((h[0] & 0x0F) != 0x2) || (len < sizeof(SPxWebStreamHeader)) )
+	{
+	    continue;
+	}
+
+	/* 브라우저 뷰어와 같은 방식으로 격자에 적용 */
+	SPxWebStreamHeader hdr;
+	memcpy(&hdr, &payload[0], sizeof(hdr));
+	if( hdr.magic != SPX_WEB_STREAM_MAGIC )
+	{
+	    client->ok = 0;
+	    break;
+	}
+	if( hdr.type == SPX_WEB_STREAM_CONFIG )
+	{
+	    client->numAz = hdr.numAz;
+	    client->gates = hdr.gates;
+	    client->grid.assign((size_t)hdr.numAz * hdr.gates, 0);
+	    continue;
+	}
+	size_t size = (size_t)hdr.numAz * hdr.gates;
+	const unsigned char *data = &payload[sizeof(hdr)];
+	if( hdr.flags & SPX_WEB_STREAM_FLAG_ZLIB )
+	{
+	    rows.resize(size);
+	    uLongf outLen = (uLongf)size;
+	    if( (uncompress(&rows[0], &outLen, data, (uLong)(len - sizeof(hdr))) != Z_OK)
+		|| (outLen != size) )
+	    {
+		client->ok = 0;
+		break;
+	    }
+	    data = &rows[0];
+	}
+	else if( len - sizeof(hdr) != size )
+	{
+	    client->ok = 0;
+	    break;
+	}
+	if( ((size_t)hdr.firstAz * client->gates) + size > client->grid.size() )
+	{
+	    client->ok = 0;
+	    break;
+	}
+	unsigned char *out = &client->grid[(size_t)hdr.firstAz * client->gates];
+	for(size_t i = 0; i < size; i++)
+	{
+	    out[i] = (hdr.flags & SPX_WEB_STREAM_FLAG_KEY) ? data[i] : (out[i] ^ data[i]);
+	}
+	if( client->delayUsecs > 0 )
+	{
+	    usleep(client->delayUsecs);
+	}
+    }
+    close(fd);
+} /* clientThread() */
+
+
+/*====================================================================
+*
+* readAll
+*	Read exactly len bytes.
+*
+* Params:
+*	client			Client (for its stop flag),
+*	fd			Socket,
+*	buf, len		Where to read to.
+*
+* Returns:
+*	Zero on success, -1 if closed, stopped or on error.
+*
+* Notes
+*
+*===================================================================*/
+static int readAll(BenchClient *client, int fd, void *buf, size_t len)
+{
+    unsigned char *p = (unsigned char *)buf;
+    while( len > 0 )
+    {
+	ssize_t n = recv(fd, p, len, 0);
+	if( (n < 0) && ((errno == EAGAIN) || (errno == EINTR)) && !client->stop )
+	{
+	    continue;
+	}
+	if( (n <= 0) || client->stop )
+	{
+	    return(-1);
+	}
+	p += n;
+	len -= (size_t)n;
+    }
+    return(0);
+} /* readAll() */
+
+
+/*====================================================================
+*
+* nowSecs
+*	Get a monotonic time.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Seconds.
+*
+* Notes
+*
+*===================================================================*/
+static double nowSecs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return(ts.tv_sec + ts.tv_nsec / 1e9);
+} /* nowSecs() */
+
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
@@ -0,0 +1,1383 @@
+/*********************************************************************
+*
+* File: SPxWebStream.cpp
+*
+* Purpose:
+*	WebSocket server for browser viewers (see SPxWebStream.h).
+*
+**********************************************************************/
+
+/* Standard headers. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <chrono>
+#include <zlib.h>
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#endif
+
+/* Our own header. */
+#include "SPxWebStream.h"
+
+/*
+ * Constants.
+ */
+/* Grid and rate defaults and limits. */
+#define	DEFAULT_AZIS		1024
+#define	DEFAULT_GATES		512
+#define	DEFAULT_SECTORS		32
+#define	DEFAULT_FPS		10
+#define	MAX_AZIS		8192
+#define	MAX_GATES		4096
+#define	MAX_FPS			50
+
+/* Most clients, longest HTTP request and client message. */
+#define	MAX_CLIENTS		64
+#define	MAX_REQUEST		8192
+#define	MAX_MESSAGE		1024
+
+/* How often changed sectors are looked for, and the poll timeout. */
+#define	TICK_USECS		10000
+#define	POLL_TIMEOUT_MSECS	10
+
+/* Largest page served. */
+#define	MAX_PAGE_BYTES		(4 * 1024 * 1024)
+
+/* Client states. */
+#define	CLIENT_HTTP		0	/* Reading the HTTP request */
+#define	CLIENT_WS		1	/* WebSocket open */
+#define	CLIENT_CLOSING		2	/* Close once the queue is sent */
+
+/* WebSocket opcodes. */
+#define	WS_TEXT			0x1
+#define	WS_BINARY		0x2
+#define	WS_CLOSE		0x8
+#define	WS_PING			0x9
+#define	WS_PONG			0xA
+
+/* Appended to the client's key for Sec-WebSocket-Accept (RFC 6455). */
+#define	WS_GUID			"258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+
+/*
+ * Private function prototypes.
+ */
+static void appendFrameHeader(std::vector<unsigned char> *buf, int opcode,
+			      size_t len);
+static void appendMessage(std::vector<unsigned char> *buf,
+			  const SPxWebStreamHeader *hdr,
+			  const unsigned char *payload, size_t len);
+static std::string acceptKey(const std::string &key);
+static void sha1(const unsigned char *data, size_t len, unsigned char digest[20]);
+static int64_t nowUsecs(void);
+static double threadCpuSecs(void);
+
+
+/*********************************************************************
+*
+*	Public functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* SPxWebStream::SPxWebStream
+*	Constructor.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+SPxWebStream::SPxWebStream(void)
+    : m_channel(0),
+      m_port(0),
+      m_numAz(DEFAULT_AZIS),
+      m_gates(DEFAULT_GATES),
+      m_numSectors(DEFAULT_SECTORS),
+      m_maxFps(DEFAULT_FPS),
+      m_listenFd(-1),
+      m_stop(0),
+      m_endRange(0.0f),
+      m_numSpokes(0),
+      m_numChanged(0),
+      m_cpuSecs(0.0),
+      m_lastStatsUsecs(nowUsecs()),
+      m_frameEndRange(0.0f),
+      m_nextId(0)
+{
+} /* SPxWebStream::SPxWebStream() */
+
+
+/*====================================================================
+*
+* SPxWebStream::~SPxWebStream
+*	Destructor, disconnecting the clients.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+SPxWebStream::~SPxWebStream()
+{
+    m_stop = 1;
+    if( m_thread.joinable() )
+    {
+	m_thread.join();
+    }
+#ifndef _WIN32
+    while( !m_clients.empty() )
+    {
+	closeClient(m_clients.size() - 1);
+    }
+    if( m_listenFd >= 0 )
+    {
+	close(m_listenFd);
+    }
+#endif
+} /* SPxWebStream::~SPxWebStream() */
+
+
+/*====================================================================
+*
+* SPxWebStream::Create
+*	Listen for clients and start the hub thread.
+*
+* Params:
+*	spec			"[<addr>:]<port>[,option...]" (see
+*				SPxWebStream.h).
+*
+* Returns:
+*	Zero on success, -1 on error (see GetError()).
+*
+* Notes
+*	Port 0 listens on any free port (see GetPort()).
+*
+*===================================================================*/
+int SPxWebStream::Create(const char *spec)
+{
+#ifdef _WIN32
+    m_error = "web server not supported on this platform";
+    return(-1);
+#else
+    if( m_listenFd >= 0 )
+    {
+	m_error = "web server already created";
+	return(-1);
+    }
+    std::string text = (spec != NULL) ? spec : "";
+    m_error = "invalid web server '" + text + "'";
+
+    /* "[주소:]포트" 다음에 쉼표로 구분된 옵션 */
+    std::string dest = text.substr(0, text.find(','));
+    std::string addr;
+    size_t colon = dest.rfind(':');
+    if( colon != std::string::npos )
+    {
+	addr = dest.substr(0, colon);
+	dest = dest.substr(colon + 1);
+    }
+    char *end = NULL;
+    long port = strtol(dest.c_str(), &end, 10);
+    if( dest.empty() || (*end != '\0') || (port < 0) || (port > 65535)
+	|| ((colon != std::string::npos) && addr.empty()) )
+    {
+	return(-1);
+    }
+
+    std::string html;
+    size_t pos = text.find(',');
+    while( pos != std::string::npos )
+    {
+	size_t next = text.find(',', pos + 1);
+	std::string opt = text.substr(pos + 1, (next == std::string::npos)
+				      ? std::string::npos : (next - pos - 1));
+	size_t eq = opt.find('=');
+	if( (eq == std::string::npos) || (eq + 1 == opt.size()) )
+	{
+	    return(-1);
+	}
+	std::string value = opt.substr(eq + 1);
+	opt = opt.substr(0, eq);
+	unsigned long n = strtoul(value.c_str(), &end, 0);
+	int isNum = (*end == '\0');
+	if( opt == "html" )				{ html = value; }
+	else if( !isNum )				{ return(-1); }
+	else if( (opt == "az") && (n >= 64) && (n <= MAX_AZIS) )
+	{
+	    m_numAz = (unsigned int)n;
+	}
+	else if( (opt == "gates") && (n >= 16) && (n <= MAX_GATES) )
+	{
+	    m_gates = (unsigned int)n;
+	}
+	else if( (opt == "sectors") && (n >= 1) && (n <= 1024) )
+	{
+	    m_numSectors = (unsigned int)n;
+	}
+	else if( (opt == "fps") && (n >= 1) && (n <= MAX_FPS) )
+	{
+	    m_maxFps = (unsigned int)n;
+	}
+	else if( (opt == "ch") && (n < 65536) )
+	{
+	    m_channel = (unsigned int)n;
+	}
+	else
+	{
+	    return(-1);
+	}
+	pos = next;
+    }
+    if( (m_numAz % m_numSectors) != 0 )
+    {
+	m_error = "sectors must divide az for web server '" + text + "'";
+	return(-1);
+    }
+
+    /* Page for "GET /". */
+    if( !html.empty() )
+    {
+	FILE *fp = fopen(html.c_str(), "rb");
+	if( fp == NULL )
+	{
+	    m_error = "cannot read web page '" + html + "'";
+	    return(-1);
+	}
+	char buf[4096];
+	size_t n;
+	while( ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+	       && (m_page.size() < MAX_PAGE_BYTES) )
+	{
+	    m_page.append(buf, n);
+	}
+	fclose(fp);
+    }
+
+    struct sockaddr_in sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons((uint16_t)port);
+    sa.sin_addr.s_addr = htonl(INADDR_ANY);
+    if( !addr.empty() && (inet_pton(AF_INET, addr.c_str(), &sa.sin_addr) != 1) )
+    {
+	return(-1);
+    }
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if( fd < 0 )
+    {
+	m_error = std::string("socket: ") + strerror(errno);
+	return(-1);
+    }
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    socklen_t saLen = sizeof(sa);
+    if( (bind(fd, (struct sockaddr *)&sa, sizeof(sa)) != 0)
+	|| (listen(fd, 16) != 0)
+	|| (getsockname(fd, (struct sockaddr *)&sa, &saLen) != 0) )
+    {
+	m_error = "cannot listen on '" + text.substr(0, text.find(',')) + "': "
+	    + strerror(errno);
+	close(fd);
+	return(-1);
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    m_listenFd = fd;
+    m_port = ntohs(sa.sin_port);
+
+    m_grid.assign((size_t)m_numAz * m_gates, 0);
+    m_gen.assign(m_numSectors, 0);
+    m_frame.assign(m_grid.size(), 0);
+    m_frameGen.assign(m_numSectors, 0);
+    size_t sectorBytes = m_grid.size() / m_numSectors;
+    m_delta.resize(sectorBytes);
+    m_packed.resize(compressBound((uLong)sectorBytes));
+    m_cache.resize(m_numSectors);
+    m_spec = text;
+    m_error.clear();
+
+    m_thread = std::thread(&SPxWebStream::hubThread, this);
+    return(0);
+#endif
+} /* SPxWebStream::Create() */
+
+
+/*====================================================================
+*
+* SPxWebStream::Publish
+*	Add a spoke to the grid.
+*
+* Params:
+*	azimuth			65536 per turn,
+*	endRange		Range of the last sample,
+*	data, numSamples	Samples,
+*	bytesPerSample		1 or 2.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Called on the receive thread.  The samples are resampled to the
+*	grid's gates (the maximum of the samples in each gate) and
+*	replace the azimuth bin's row.
+*
+*===================================================================*/
+void SPxWebStream::Publish(uint16_t azimuth, float endRange,
+			   const unsigned char *data, unsigned int numSamples,
+			   unsigned int bytesPerSample)
+{
+    if( m_grid.empty() || ((bytesPerSample != 1) && (bytesPerSample != 2)) )
+    {
+	return;
+    }
+    unsigned int row = ((uint32_t)azimuth * m_numAz) >> 16;
+    unsigned int n = numSamples;
+    const uint16_t *data16 = (const uint16_t *)data;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    unsigned char *out = &m_grid[(size_t)row * m_gates];
+    for(unsigned int g = 0; g < m_gates; g++)
+    {
+	/* 게이트에 들어가는 샘플 중 최대값 (샘플이 적으면 반복) */
+	unsigned int first = (unsigned int)(((uint64_t)g * n) / m_gates);
+	unsigned int last = (unsigned int)(((uint64_t)(g + 1) * n) / m_gates);
+	if( last <= first )
+	{
+	    last = first + 1;
+	}
+	unsigned int peak = 0;
+	for(unsigned int j = first; (j < last) && (j < n); j++)
+	{
+	    unsigned int v = (bytesPerSample == 1) ? data[j] : (data16[j] >> 8u);
+	    if( v > peak )
+	    {
+		peak = v;
+	    }
+	}
+	out[g] = (unsigned char)peak;
+    }
+    m_gen[row / (m_numAz / m_numSectors)]++;
+    m_endRange = endRange;
+    m_numSpokes++;
+} /* SPxWebStream::Publish() */
+
+
+/*====================================================================
+*
+* SPxWebStream::GetStats
+*	Read the server's and the clients' statistics.
+*
+* Params:
+*	stats			Filled in,
+*	clients			Filled in, one per WebSocket client.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Resets the counts.
+*
+*===================================================================*/
+void SPxWebStream::GetStats(Stats *stats, std::vector<ClientStats> *clients)
+{
+    clients->clear();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    int64_t now = nowUsecs();
+    stats->secs = (double)(now - m_lastStatsUsecs) / 1e6;
+    stats->numSpokes = m_numSpokes;
+    stats->numSectors = m_numChanged;
+    stats->cpuSecs = m_cpuSecs;
+    m_numSpokes = 0;
+    m_numChanged = 0;
+    m_cpuSecs = 0.0;
+    m_lastStatsUsecs = now;
+
+    for(size_t i = 0; i < m_clients.size(); i++)
+    {
+	Client *client = m_clients[i];
+	if( client->state != CLIENT_WS )
+	{
+	    continue;
+	}
+	client->stats.fps = client->fps;
+	client->stats.pendingBytes = client->pending.size() - client->pendingOffset;
+	clients->push_back(client->stats);
+	client->stats.numUpdates = 0;
+	client->stats.numSectors = 0;
+	client->stats.numShared = 0;
+	client->stats.numBytes = 0;
+	client->stats.numRawBytes = 0;
+	client->stats.numDeferred = 0;
+	client->stats.numResyncs = 0;
+	client->stats.encodeUsecs = 0.0;
+    }
+} /* SPxWebStream::GetStats() */
+
+
+/*********************************************************************
+*
+*	Private functions
+*
+**********************************************************************/
+
+#ifndef _WIN32
+
+/*====================================================================
+*
+* SPxWebStream::hubThread
+*	Serve the clients until stopped.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Never blocks on a client: sockets are non-blocking, and a client
+*	with updates still queued is skipped until they have gone.
+*
+*===================================================================*/
+void SPxWebStream::hubThread(void)
+{
+    std::vector<struct pollfd> fds;
+    int64_t lastTick = 0;
+    double lastCpu = threadCpuSecs();
+    while( !m_stop )
+    {
+	fds.resize(1 + m_clients.size());
+	fds[0].fd = m_listenFd;
+	fds[0].events = POLLIN;
+	fds[0].revents = 0;
+	for(size_t i = 0; i < m_clients.size(); i++)
+	{
+	    Client *client = m_clients[i];
+	    fds[1 + i].fd = client->fd;
+	    fds[1 + i].events = POLLIN;
+	    fds[1 + i].revents = 0;
+	    if( client->pendingOffset < client->pending.size() )
+	    {
+		fds[1 + i].events |= POLLOUT;
+	    }
+	}
+	if( poll(&fds[0], fds.size(), POLL_TIMEOUT_MSECS) < 0 )
+	{
+	    if( errno != EINTR )
+	    {
+		break;
+	    }
+	    continue;
+	}
+
+	/* 주기마다 바뀐 섹터를 복사해 두고 클라이언트별로 갱신 */
+	int64_t now = nowUsecs();
+	int tick = (now - lastTick >= TICK_USECS);
+	if( tick )
+	{
+	    snapshot();
+	    lastTick = now;
+	}
+
+	/* Serve the clients, last first so closing one does not move
+	 * the others.
+	 */
+	for(size_t i = fds.size() - 1; i-- > 0; )
+	{
+	    Client *client = m_clients[i];
+	    int ok = 1;
+	    if( fds[1 + i].revents & (POLLIN | POLLHUP | POLLERR) )
+	    {
+		ok = (readClient(client) == 0);
+	    }
+	    if( ok && tick )
+	    {
+		update(client, now);
+	    }
+	    if( ok )
+	    {
+		ok = (sendPending(client) == 0);
+	    }
+	    if( !ok )
+	    {
+		closeClient(i);
+	    }
+	}
+
+	if( fds[0].revents & POLLIN )
+	{
+	    acceptClient();
+	}
+
+	if( tick )
+	{
+	    double cpu = threadCpuSecs();
+	    std::lock_guard<std::mutex> lock(m_mutex);
+	    m_cpuSecs += cpu - lastCpu;
+	    lastCpu = cpu;
+	}
+    }
+} /* SPxWebStream::hubThread() */
+
+
+/*====================================================================
+*
+* SPxWebStream::acceptClient
+*	Accept a new connection.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Beyond MAX_CLIENTS connections are closed at once.
+*
+*===================================================================*/
+void SPxWebStream::acceptClient(void)
+{
+    struct sockaddr_in sa;
+    socklen_t saLen = sizeof(sa);
+    int fd = accept(m_listenFd, (struct sockaddr *)&sa, &saLen);
+    if( fd < 0 )
+    {
+	return;
+    }
+    if( m_clients.size() >= MAX_CLIENTS )
+    {
+	close(fd);
+	return;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+    char addr[INET_ADDRSTRLEN] = "";
+    inet_ntop(AF_INET, &sa.sin_addr, addr, sizeof(addr));
+    char peer[64];
+    snprintf(peer, sizeof(peer), "%s:%u", addr, (unsigned int)ntohs(sa.sin_port));
+
+    Client *client = new Client();
+    client->fd = fd;
+    client->id = m_nextId++;
+    client->state = CLIENT_HTTP;
+    client->fps = m_maxFps;
+    client->nextUpdateUsecs = 0;
+    client->resync = 1;
+    client->pendingOffset = 0;
+    client->stats.id = client->id;
+    client->stats.peer = peer;
+    client->stats.fps = client->fps;
+    client->stats.numUpdates = 0;
+    client->stats.numSectors = 0;
+    client->stats.numShared = 0;
+    client->stats.numBytes = 0;
+    client->stats.numRawBytes = 0;
+    client->stats.numDeferred = 0;
+    client->stats.numResyncs = 0;
+    client->stats.encodeUsecs = 0.0;
+    client->stats.pendingBytes = 0;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_clients.push_back(client);
+} /* SPxWebStream::acceptClient() */
+
+
+/*====================================================================
+*
+* SPxWebStream::readClient
+*	Read what a client has sent.
+*
+* Params:
+*	client			Client.
+*
+* Returns:
+*	Zero if read or still to come, -1 to disconnect it.
+*
+* Notes
+*
+*===================================================================*/
+int SPxWebStream::readClient(Client *client)
+{
+    char buf[4096];
+    ssize_t n = recv(client->fd, buf, sizeof(buf), MSG_DONTWAIT);
+    if( n == 0 )
+    {
+	return(-1);
+    }
+    if( n < 0 )
+    {
+	return(((errno == EAGAIN) || (errno == EINTR)) ? 0 : -1);
+    }
+    if( client->state == CLIENT_CLOSING )
+    {
+	return(0);
+    }
+    client->request.append(buf, (size_t)n);
+    if( (client->state == CLIENT_HTTP) && (handshake(client) != 0) )
+    {
+	return(-1);
+    }
+    if( client->state == CLIENT_WS )
+    {
+	return(readFrames(client));
+    }
+    return(0);
+} /* SPxWebStream::readClient() */
+
+
+/*====================================================================
+*
+* SPxWebStream::handshake
+*	Answer a client's HTTP request, once complete.
+*
+* Params:
+*	client			Client.
+*
+* Returns:
+*	Zero if answered or still to come, -1 to disconnect it.
+*
+* Notes
+*	A WebSocket upgrade is accepted and sent the grid's config; a
+*	"GET /" is sent the page and closed; anything else gets a 404.
+*
+*===================================================================*/
+int SPxWebStream::handshake(Client *client)
+{
+    size_t headerEnd = client->request.find("\r\n\r\n");
+    if( headerEnd == std::string::npos )
+    {
+	return((client->request.size() < MAX_REQUEST) ? 0 : -1);
+    }
+    std::string header = client->request.substr(0, headerEnd + 2);
+    client->request.erase(0, headerEnd + 4);
+
+    /* 요청 줄과 필요한 헤더 (이름은 대소문자 구분 없음) */
+    std::string method, path, upgrade, key;
+    size_t pos = 0;
+    for(int first = 1; pos < header.size(); first = 0)
+    {
+	size_t eol = header.find("\r\n", pos);
+	std::string line = header.substr(pos, eol - pos);
+	pos = eol + 2;
+	if( first )
+	{
+	    size_t sp1 = line.find(' ');
+	    size_t sp2 = line.find(' ', sp1 + 1);
+	    if( (sp1 == std::string::npos) || (sp2 == std::string::npos) )
+	    {
+		return(-1);
+	    }
+	    method = line.substr(0, sp1);
+	    path = line.substr(sp1 + 1, sp2 - sp1 - 1);
+	    continue;
+	}
+	size_t colon = line.find(':');
+	if( colon == std::string::npos )
+	{
+	    continue;
+	}
+	std::string name = line.substr(0, colon);
+	for(size_t i = 0; i < name.size(); i++)
+	{
+	    name[i] = (char)tolower((unsigned char)name[i]);
+	}
+	size_t v = line.find_first_not_of(" \t", colon + 1);
+	std::string value = (v == std::string::npos) ? "" : line.substr(v);
+	while( !value.empty() && ((value[value.size() - 1] == ' ')
+				  || (value[value.size() - 1] == '\t')) )
+	{
+	    value.erase(value.size() - 1);
+	}
+	if( name == "upgrade" )
+	{
+	    for(size_t i = 0; i < value.size(); i++)
+	    {
+		value[i] = (char)tolower((unsigned char)value[i]);
+	    }
+	    upgrade = value;
+	}
+	else if( name == "sec-websocket-key" )
+	{
+	    key = value;
+	}
+    }
+
+    std::string reply;
+    if( (method == "GET") && (upgrade == "websocket") && !key.empty() )
+    {
+	reply = "HTTP/1.1 101 Switching Protocols\r\n"
+	    "Upgrade: websocket\r\nConnection: Upgrade\r\n"
+	    "Sec-WebSocket-Accept: " + acceptKey(key) + "\r\n\r\n";
+	client->pending.insert(client->pending.end(), reply.begin(), reply.end());
+
+	/* 접속하면 격자 설정을 보내고 다음 갱신에서 전체를 보냄 */
+	client->state = CLIENT_WS;
+	client->resync = 1;
+	client->shadow.assign(m_frame.size(), 0);
+	client->sentGen.assign(m_numSectors, 0);
+	SPxWebStreamHeader hdr;
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.magic = SPX_WEB_STREAM_MAGIC;
+	hdr.type = SPX_WEB_STREAM_CONFIG;
+	hdr.sector = (uint16_t)m_numSectors;
+	hdr.numAz = (uint16_t)m_numAz;
+	hdr.gates = (uint16_t)m_gates;
+	hdr.endRange = m_frameEndRange;
+	appendMessage(&client->pending, &hdr, NULL, 0);
+	return(0);
+    }
+
+    if( (method == "GET") && !m_page.empty()
+	&& ((path == "/") || (path == "/index.html")) )
+    {
+	char len[32];
+	snprintf(len, sizeof(len), "%lu", (unsigned long)m_page.size());
+	reply = "HTTP/1.1 200 OK\r\nContent-Type: text/html; charset=utf-8\r\n"
+	    "Content-Length: " + std::string(len) + "\r\n"
+	    "Cache-Control: no-cache\r\nConnection: close\r\n\r\n" + m_page;
+    }
+    else
+    {
+	reply = "HTTP/1.1 404 Not Found\r\nContent-Type: text/plain\r\n"
+	    "Content-Length: 10\r\nConnection: close\r\n\r\nNot found\n";
+    }
+    client->pending.insert(client->pending.end(), reply.begin(), reply.end());
+    client->state = CLIENT_CLOSING;
+    return(0);
+} /* SPxWebStream::handshake() */
+
+
+/*====================================================================
+*
+* SPxWebStream::readFrames
+*	Handle the complete WebSocket frames a client has sent.
+*
+* Params:
+*	client			Client.
+*
+* Returns:
+*	Zero on success, -1 to disconnect it.
+*
+* Notes
+*	Text messages "resync" and "fps=<n>" are acted on, pings are
+*	answered and a close is echoed.  Fragmented and binary messages
+*	are ignored.
+*
+*===================================================================*/
+int SPxWebStream::readFrames(Client *client)
+{
+    std::string *buf = &client->request;
+    while( buf->size() >= 2 )
+    {
+	const unsigned char *p = (const unsigned char *)buf->data();
+	int fin = (p[0] & 0x80) != 0;
+	int opcode = p[0] & 0x0F;
+	size_t len = p[1] & 0x7F;
+	size_t offset = 2;
+	if( (p[1] & 0x80) == 0 )
+	{
+	    /* Clients must mask their frames. */
+	    return(-1);
+	}
+	if( len == 126 )
+	{
+	    if( buf->size() < 4 )
+	    {
+		return(0);
+	    }
+	    len = ((size_t)p[2] << 8) | p[3];
+	    offset = 4;
+	}
+	else if( len == 127 )
+	{
+	    return(-1);
+	}
+	if( len > MAX_MESSAGE )
+	{
+	    return(-1);
+	}
+	if( buf->size() < offset + 4 + len )
+	{
+	    return(0);
+	}
+	const unsigned char *mask = p + offset;
+	unsigned char payload[MAX_MESSAGE + 1];
+	for(size_t i = 0; i < len; i++)
+	{
+	    payload[i] = p[offset + 4 + i] ^ mask[i & 3];
+	}
+	payload[len] = '\0';
+	buf->erase(0, offset + 4 + len);
+
+	if( (opcode == WS_TEXT) && fin )
+	{
+	    const char *text = (const char *)payload;
+	    if( strcmp(text, "resync") == 0 )
+	    {
+		client->resync = 1;
+	    }
+	    else if( strncmp(text, "fps=", 4) == 0 )
+	    {
+		unsigned long fps = strtoul(text + 4, NULL, 0);
+		client->fps = (fps < 1) ? 1 : ((fps > m_maxFps) ? m_maxFps
+					       : (unsigned int)fps);
+	    }
+	}
+	else if( opcode == WS_PING )
+	{
+	    queueFrame(client, WS_PONG, payload, len);
+	}
+	else if( opcode == WS_CLOSE )
+	{
+	    queueFrame(client, WS_CLOSE, NULL, 0);
+	    client->state = CLIENT_CLOSING;
+	    return(0);
+	}
+    }
+    return(0);
+} /* SPxWebStream::readFrames() */
+
+
+/*====================================================================
+*
+* SPxWebStream::snapshot
+*	Copy the sectors that have changed from the grid, and forget
+*	the previous update's encodings.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	So the clients are encoded without holding m_mutex.
+*
+*===================================================================*/
+void SPxWebStream::snapshot(void)
+{
+    size_t sectorBytes = m_frame.size() / m_numSectors;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for(unsigned int s = 0; s < m_numSectors; s++)
+    {
+	if( m_gen[s] != m_frameGen[s] )
+	{
+	    memcpy(&m_frame[s * sectorBytes], &m_grid[s * sectorBytes], sectorBytes);
+	    m_frameGen[s] = m_gen[s];
+	    m_numChanged++;
+	}
+    }
+    m_frameEndRange = m_endRange;
+
+    /* 이전 갱신의 인코딩은 이제 맞지 않음 */
+    for(unsigned int s = 0; s < m_numSectors; s++)
+    {
+	m_cache[s].clear();
+    }
+    m_encoded.clear();
+} /* SPxWebStream::snapshot() */
+
+
+/*====================================================================
+*
+* SPxWebStream::update
+*	Send a client the sectors that changed since it was last sent
+*	them, if it is due an update.
+*
+* Params:
+*	client			Client,
+*	now			Time, microseconds.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Each sector is sent as the XOR of its rows with the client's
+*	copy (the rows themselves after a resync), zlib compressed if
+*	that makes it smaller.  The client's copy of a sector is the
+*	frame's rows at the generation it was last sent, so a message
+*	encoded this update for another client last sent the same
+*	generation is reused as it is.  Sectors that turn out not to
+*	have changed are not sent.  An update due while earlier ones
+*	are still queued is put off to the next one.
+*
+*===================================================================*/
+void SPxWebStream::update(Client *client, int64_t now)
+{
+    if( (client->state != CLIENT_WS) || (now < client->nextUpdateUsecs) )
+    {
+	return;
+    }
+
+    /* 같은 속도의 클라이언트가 같은 틱에 갱신되도록 공통 주기에 맞춤 */
+    int64_t period = 1000000 / (int64_t)client->fps;
+    client->nextUpdateUsecs = ((now / period) + 1) * period;
+    if( client->pendingOffset < client->pending.size() )
+    {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	client->stats.numDeferred++;
+	return;
+    }
+    client->pending.clear();
+    client->pendingOffset = 0;
+    int64_t start = nowUsecs();
+
+    int key = client->resync;
+    if( key )
+    {
+	std::fill(client->shadow.begin(), client->shadow.end(), 0);
+	client->resync = 0;
+    }
+    size_t rows = m_numAz / m_numSectors;
+    size_t sectorBytes = rows * m_gates;
+    uint64_t numSectors = 0;
+    uint64_t numShared = 0;
+    uint64_t numBytes = 0;
+    uint64_t numRawBytes = 0;
+    for(unsigned int s = 0; s < m_numSectors; s++)
+    {
+	if( !key && (client->sentGen[s] == m_frameGen[s]) )
+	{
+	    continue;
+	}
+	uint32_t fromGen = client->sentGen[s];
+	client->sentGen[s] = m_frameGen[s];
+	const unsigned char *rowData = &m_frame[s * sectorBytes];
+	unsigned char *shadow = &client->shadow[s * sectorBytes];
+
+	/* 이번 갱신에서 같은 상태의 클라이언트용으로 이미 인코딩했으면 재사용 */
+	std::vector<Encoded> *cache = &m_cache[s];
+	const Encoded *found = NULL;
+	for(size_t i = 0; i < cache->size(); i++)
+	{
+	    const Encoded *e = &(*cache)[i];
+	    if( (e->key == key) && (key || (e->fromGen == fromGen)) )
+	    {
+		found = e;
+		break;
+	    }
+	}
+	if( found != NULL )
+	{
+	    if( found->len > 0 )
+	    {
+		memcpy(shadow, rowData, sectorBytes);
+		client->pending.insert(client->pending.end(),
+				       m_encoded.begin() + found->offset,
+				       m_encoded.begin() + found->offset + found->len);
+		numSectors++;
+		numShared++;
+		numBytes += found->len;
+		numRawBytes += sectorBytes;
+	    }
+	    continue;
+	}
+
+	/* 지난번에 보낸 것과 XOR, 클라이언트 사본도 갱신 */
+	unsigned char *delta = &m_delta[0];
+	unsigned char changed = 0;
+	for(size_t i = 0; i < sectorBytes; i++)
+	{
+	    delta[i] = rowData[i] ^ shadow[i];
+	    changed |= delta[i];
+	}
+	Encoded enc;
+	enc.fromGen = fromGen;
+	enc.key = key;
+	enc.offset = m_encoded.size();
+	enc.len = 0;
+	if( changed || key )
+	{
+	    memcpy(shadow, rowData, sectorBytes);
+
+	    SPxWebStreamHeader hdr;
+	    memset(&hdr, 0, sizeof(hdr));
+	    hdr.magic = SPX_WEB_STREAM_MAGIC;
+	    hdr.type = SPX_WEB_STREAM_SECTOR;
+	    hdr.flags = key ? SPX_WEB_STREAM_FLAG_KEY : 0;
+	    hdr.sector = (uint16_t)s;
+	    hdr.firstAz = (uint16_t)(s * rows);
+	    hdr.numAz = (uint16_t)rows;
+	    hdr.gates = (uint16_t)m_gates;
+	    hdr.endRange = m_frameEndRange;
+	    uLongf packedLen = (uLongf)m_packed.size();
+	    if( (compress2(&m_packed[0], &packedLen, delta, (uLong)sectorBytes,
+			   Z_BEST_SPEED) == Z_OK) && (packedLen < sectorBytes) )
+	    {
+		hdr.flags |= SPX_WEB_STREAM_FLAG_ZLIB;
+		appendMessage(&m_encoded, &hdr, &m_packed[0], packedLen);
+	    }
+	    else
+	    {
+		appendMessage(&m_encoded, &hdr, delta, sectorBytes);
+	    }
+	    enc.len = m_encoded.size() - enc.offset;
+	    client->pending.insert(client->pending.end(),
+				   m_encoded.begin() + enc.offset, m_encoded.end());
+	    numSectors++;
+	    numBytes += enc.len;
+	    numRawBytes += sectorBytes;
+	}
+	cache->push_back(enc);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if( numSectors > 0 )
+    {
+	client->stats.numUpdates++;
+    }
+    if( key )
+    {
+	client->stats.numResyncs++;
+    }
+    client->stats.numSectors += numSectors;
+    client->stats.numShared += numShared;
+    client->stats.numBytes += numBytes;
+    client->stats.numRawBytes += numRawBytes;
+    client->stats.encodeUsecs += (double)(nowUsecs() - start);
+} /* SPxWebStream::update() */
+
+
+/*====================================================================
+*
+* SPxWebStream::queueFrame
+*	Queue a control frame for a client.
+*
+* Params:
+*	client			Client,
+*	opcode			WS_...,
+*	data, len		Payload.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+void SPxWebStream::queueFrame(Client *client, int opcode,
+			      const unsigned char *data, size_t len)
+{
+    appendFrameHeader(&client->pending, opcode, len);
+    if( len > 0 )
+    {
+	client->pending.insert(client->pending.end(), data, data + len);
+    }
+} /* SPxWebStream::queueFrame() */
+
+
+/*====================================================================
+*
+* SPxWebStream::sendPending
+*	Send as much of a client's queue as its socket takes.
+*
+* Params:
+*	client			Client.
+*
+* Returns:
+*	Zero if sent or the socket is full, -1 to disconnect it (also
+*	once a closing client's queue has gone).
+*
+* Notes
+*
+*===================================================================*/
+int SPxWebStream::sendPending(Client *client)
+{
+    while( client->pendingOffset < client->pending.size() )
+    {
+	ssize_t n = send(client->fd, &client->pending[client->pendingOffset],
+			 client->pending.size() - client->pendingOffset,
+			 MSG_DONTWAIT | MSG_NOSIGNAL);
+	if( n < 0 )
+	{
+	    return(((errno == EAGAIN) || (errno == EINTR)) ? 0 : -1);
+	}
+	client->pendingOffset += (size_t)n;
+    }
+    return((client->state == CLIENT_CLOSING) ? -1 : 0);
+} /* SPxWebStream::sendPending() */
+
+
+/*====================================================================
+*
+* SPxWebStream::closeClient
+*	Disconnect and remove a client.
+*
+* Params:
+*	idx			Its index in m_clients.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+void SPxWebStream::closeClient(size_t idx)
+{
+    Client *client = m_clients[idx];
+    {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_clients.erase(m_clients.begin() + idx);
+    }
+    close(client->fd);
+    delete client;
+} /* SPxWebStream::closeClient() */
+
+#endif /* _WIN32 */
+
+
+/*====================================================================
+*
+* appendFrameHeader
+*	Append a WebSocket frame header (server to client, unmasked).
+*
+* Params:
+*	buf			Appended to,
+*	opcode			WS_...,
+*	len			Payload bytes.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+static void appendFrameHeader(std::vector<unsigned char> *buf, int opcode,
+			      size_t len)
+{
+    buf->push_back((unsigned char)(0x80 | opcode));
+    if( len < 126 )
+    {
+	buf->push_back((unsigned char)len);
+    }
+    else if( len < 65536 )
+    {
+	buf->push_back(126);
+	buf->push_back((unsigned char)(len >> 8));
+	buf->push_back((unsigned char)len);
+    }
+    else
+    {
+	buf->push_back(127);
+	for(int shift = 56; shift >= 0; shift -= 8)
+	{
+	    buf->push_back((unsigned char)((uint64_t)len >> shift));
+	}
+    }
+} /* appendFrameHeader() */
+
+
+/*====================================================================
+*
+* appendMessage
+*	Append a binary message (as a WebSocket frame).
+*
+* Params:
+*	buf			Appended to,
+*	hdr			Message header,
+*	payload, len		What follows it.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+static void appendMessage(std::vector<unsigned char> *buf,
+			  const SPxWebStreamHeader *hdr,
+			  const unsigned char *payload, size_t len)
+{
+    appendFrameHeader(buf, WS_BINARY, sizeof(*hdr) + len);
+    const unsigned char *h = (const unsigned char *)hdr;
+    buf->insert(buf->end(), h, h + sizeof(*hdr));
+    if( len > 0 )
+    {
+	buf->insert(buf->end(), payload, payload + len);
+    }
+} /* appendMessage() */
+
+
+/*====================================================================
+*
+* acceptKey
+*	Work out the Sec-WebSocket-Accept value for a client's key.
+*
+* Params:
+*	key			Sec-WebSocket-Key.
+*
+* Returns:
+*	Base64 of the SHA-1 of the key and WS_GUID.
+*
+* Notes
+*
+*===================================================================*/
+static std::string acceptKey(const std::string &key)
+{
+    static const char *b64 =
+	"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string text = key + WS_GUID;
+    unsigned char digest[21];
+    sha1((const unsigned char *)text.data(), text.size(), digest);
+    digest[20] = 0;
+
+    /* 20 바이트 → base64 28 자 (마지막 '=' 하나) */
+    std::string out;
+    for(int i = 0; i < 21; i += 3)
+    {
+	uint32_t v = ((uint32_t)digest[i] << 16) | ((uint32_t)digest[i + 1] << 8)
+	    | ((i + 2 < 21) ? digest[i + 2] : 0);
+	out += b64[(v >> 18) & 0x3F];
+	out += b64[(v >> 12) & 0x3F];
+	out += (i + 1 < 20) ? b64[(v >> 6) & 0x3F] : '=';
+	out += (i + 2 < 20) ? b64[v & 0x3F] : '=';
+    }
+    return(out);
+} /* acceptKey() */
+
+
+/*====================================================================
+*
+* sha1
+*	SHA-1 digest (for the WebSocket handshake only).
+*
+* Params:
+*	data, len		Message,
+*	digest			Filled in.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+static void sha1(const unsigned char *data, size_t len, unsigned char digest[20])
+{
+    uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+
+    /* 메시지 + 0x80 + 0 채움 + 비트 길이 (64 바이트 블록) */
+    std::vector<unsigned char> msg(data, data + len);
+    msg.push_back(0x80);
+    while( (msg.size() % 64) != 56 )
+    {
+	msg.push_back(0);
+    }
+    uint64_t bits = (uint64_t)len * 8;
+    for(int shift = 56; shift >= 0; shift -= 8)
+    {
+	msg.push_back((unsigned char)(bits >> shift));
+    }
+
+    for(size_t block = 0; block < msg.size(); block += 64)
+    {
+	uint32_t w[80];
+	for(int i = 0; i < 16; i++)
+	{
+	    const unsigned char *p = &msg[block + (4 * i)];
+	    w[i] = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16)
+		| ((uint32_t)p[2] << 8) | p[3];
+	}
+	for(int i = 16; i < 80; i++)
+	{
+	    uint32_t v = w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16];
+	    w[i] = (v << 1) | (v >> 31);
+	}
+	uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+	for(int i = 0; i < 80; i++)
+	{
+	    uint32_t f, k;
+	    if( i < 20 )	{ f = (b & c) | (~b & d);		k = 0x5A827999; }
+	    else if( i < 40 )	{ f = b ^ c ^ d;			k = 0x6ED9EBA1; }
+	    else if( i < 60 )	{ f = (b & c) | (b & d) | (c & d);	k = 0x8F1BBCDC; }
+	    else		{ f = b ^ c ^ d;			k = 0xCA62C1D6; }
+	    uint32_t t = ((a << 5) | (a >> 27)) + f + e + k + w[i];
+	    e = d;
+	    d = c;
+	    c = (b << 30) | (b >> 2);
+	    b = a;
+	    a = t;
+	}
+	h[0] += a;
+	h[1] += b;
+	h[2] += c;
+	h[3] += d;
+	h[4] += e;
+    }
+    for(int i = 0; i < 5; i++)
+    {
+	digest[(4 * i) + 0] = (unsigned char)(h[i] >> 24);
+	digest[(4 * i) + 1] = (unsigned char)(h[i] >> 16);
+	digest[(4 * i) + 2] = (unsigned char)(h[i] >> 8);
+	digest[(4 * i) + 3] = (unsigned char)h[i];
+    }
+} /* sha1() */
+
+
+/*====================================================================
+*
+* nowUsecs
+*	Monotonic time.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Microseconds since an arbitrary point.
+*
+* Notes
+*
+*===================================================================*/
+static int64_t nowUsecs(void)
+{
+    return( std::chrono::duration_cast<std::chrono::microseconds>(
+	std::chrono::steady_clock::now().time_since_epoch()).count() );
+} /* nowUsecs() */
+
+
+/*====================================================================
+*
+* threadCpuSecs
+*	CPU time of the calling thread.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Seconds.
+*
+* Notes
+*
+*===================================================================*/
+static double threadCpuSecs(void)
+{
+#ifdef _WIN32
+    return(0.0);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return(ts.tv_sec + ts.tv_nsec / 1e9);
+#endif
+} /* threadCpuSecs() */
+
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
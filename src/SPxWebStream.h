@@ -0,0 +1,225 @@
+/*********************************************************************
+*
+* File: SPxWebStream.h
+*
+* Purpose:
+*	WebSocket server for browser viewers (SPxWebViewer.html): spokes
+*	are kept in a fixed polar grid (azimuth bins x range gates) and
+*	each client is sent the sectors of the grid that changed, delta
+*	encoded against what it was last sent and compressed.
+*
+*	A server is given as "[<addr>:]<port>[,option...]" with the
+*	options:
+*
+*	    az=<bins>		Azimuth bins per turn (default 1024)
+*	    gates=<n>		Range gates per azimuth (default 512)
+*	    sectors=<n>		Sectors per turn (default 32), dividing az
+*	    fps=<n>		Most updates per second per client (default 10)
+*	    ch=<n>		Channel to show (default 0)
+*	    html=<file>		Page served for "GET /" (the viewer)
+*
+*	A hub thread accepts clients, upgrades them to WebSocket (or
+*	serves the page), and on each update sends every changed sector
+*	as a binary message: an SPxWebStreamHeader followed by the rows,
+*	each byte XORed with the one last sent to the client (all of it
+*	on joining or on a "resync" request), zlib compressed unless
+*	that does not make it smaller.  A client is sent nothing while
+*	its earlier updates are still queued, so a slow client gets
+*	fewer, larger deltas and never holds up the others.
+*
+*	Updates are due on a schedule common to all clients at the same
+*	rate, and each encoded sector is kept until the next update, so
+*	clients that were sent the same sectors before share one
+*	encoding instead of each costing a delta and a compression.
+*
+*	Clients may send text messages "resync" (send everything again)
+*	and "fps=<n>" (their own update rate, up to the server's).
+*	The server does not depend on the SPx library.
+*
+**********************************************************************/
+
+#ifndef _SPX_WEB_STREAM_H
+#define _SPX_WEB_STREAM_H
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* Magic number at the start of each message. */
+#define	SPX_WEB_STREAM_MAGIC		0x57585053	/* "SPXW" */
+
+/* Message types. */
+#define	SPX_WEB_STREAM_CONFIG		0	/* Grid size, no payload */
+#define	SPX_WEB_STREAM_SECTOR		1	/* Rows of a sector */
+
+/* Message flags. */
+#define	SPX_WEB_STREAM_FLAG_KEY		0x01	/* Rows, not XOR deltas */
+#define	SPX_WEB_STREAM_FLAG_ZLIB	0x02	/* Payload zlib compressed */
+
+/* Header of each binary message, little endian.  For a config message
+ * numAz is the azimuth bins per turn and sector the sectors per turn.
+ */
+struct SPxWebStreamHeader
+{
+    uint32_t magic;		/* SPX_WEB_STREAM_MAGIC */
+    uint8_t type;		/* SPX_WEB_STREAM_... */
+    uint8_t flags;		/* SPX_WEB_STREAM_FLAG_... */
+    uint16_t sector;		/* Sector number */
+    uint16_t firstAz;		/* First row (azimuth bin) */
+    uint16_t numAz;		/* Rows */
+    uint16_t gates;		/* Bytes per row */
+    uint16_t reserved;
+    float endRange;		/* Range of the last gate, metres */
+};
+
+class SPxWebStream
+{
+public:
+    /* Server statistics since the previous GetStats() call. */
+    struct Stats
+    {
+	double secs;			/* Interval */
+	uint64_t numSpokes;		/* Spokes added to the grid */
+	uint64_t numSectors;		/* Sectors changed */
+	double cpuSecs;			/* Hub thread CPU time */
+    };
+
+    /* Statistics of one client since the previous GetStats() call. */
+    struct ClientStats
+    {
+	unsigned int id;		/* Connection number */
+	std::string peer;		/* "<addr>:<port>" */
+	unsigned int fps;		/* Update rate asked for */
+	uint64_t numUpdates;		/* Updates sent */
+	uint64_t numSectors;		/* Sector messages sent */
+	uint64_t numShared;		/* Of those, encoded for another client */
+	uint64_t numBytes;		/* Message bytes queued */
+	uint64_t numRawBytes;		/* Row bytes before delta/zlib */
+	uint64_t numDeferred;		/* Updates put off, queue not empty */
+	uint64_t numResyncs;		/* Everything sent (joining, resync) */
+	double encodeUsecs;		/* Time encoding for this client */
+	size_t pendingBytes;		/* Queued now */
+    };
+
+    /* Constructor/destructor. */
+    SPxWebStream(void);
+    ~SPxWebStream();
+
+    /* Listen and start the hub thread (see above).  Zero on success or
+     * -1 on error (see GetError()).
+     */
+    int Create(const char *spec);
+    const char *GetError(void) const { return m_error.c_str(); }
+
+    /* Server description and the channel it shows. */
+    const char *GetSpec(void) const { return m_spec.c_str(); }
+    unsigned int GetChannel(void) const { return m_channel; }
+    int GetPort(void) const { return m_port; }
+
+    /* Add a spoke to the grid (from any thread).  bytesPerSample is 1
+     * or 2; 16-bit samples are reduced to their top 8 bits.
+     */
+    void Publish(uint16_t azimuth, float endRange, const unsigned char *data,
+		 unsigned int numSamples, unsigned int bytesPerSample);
+
+    /* Read the statistics. */
+    void GetStats(Stats *stats, std::vector<ClientStats> *clients);
+
+private:
+    /* A connection, used by the hub thread only (apart from its
+     * statistics, guarded by m_mutex).
+     */
+    struct Client
+    {
+	int fd;
+	unsigned int id;
+	int state;			/* CLIENT_... */
+	std::string request;		/* HTTP request, then frame bytes */
+	unsigned int fps;
+	int64_t nextUpdateUsecs;
+	int resync;			/* Send everything on the next update */
+	std::vector<uint32_t> sentGen;	/* Sector generations sent */
+	std::vector<unsigned char> shadow;	/* Grid as last sent */
+	std::vector<unsigned char> pending;	/* Encoded, not yet sent */
+	size_t pendingOffset;
+	ClientStats stats;
+    };
+
+    /* Server. */
+    std::string m_spec;
+    std::string m_error;
+    unsigned int m_channel;
+    int m_port;
+    unsigned int m_numAz;
+    unsigned int m_gates;
+    unsigned int m_numSectors;
+    unsigned int m_maxFps;
+    std::string m_page;			/* Served for "GET /", or empty */
+
+    /* Socket and thread. */
+    int m_listenFd;
+    std::thread m_thread;
+    std::atomic<int> m_stop;
+
+    /* Grid and sector generations written by Publish(), guarded by
+     * m_mutex, with the statistics.
+     */
+    std::mutex m_mutex;
+    std::vector<unsigned char> m_grid;
+    std::vector<uint32_t> m_gen;
+    float m_endRange;
+    uint64_t m_numSpokes;
+    uint64_t m_numChanged;
+    double m_cpuSecs;
+    int64_t m_lastStatsUsecs;
+
+    /* A sector message encoded this update, for clients last sent the
+     * sector at fromGen (or for key, after a resync).
+     */
+    struct Encoded
+    {
+	uint32_t fromGen;
+	int key;
+	size_t offset;			/* In m_encoded, 0 bytes if unchanged */
+	size_t len;
+    };
+
+    /* Hub thread copy of the grid, its work buffers and the sector
+     * messages encoded since the last snapshot.
+     */
+    std::vector<unsigned char> m_frame;
+    std::vector<uint32_t> m_frameGen;
+    float m_frameEndRange;
+    std::vector<unsigned char> m_delta;
+    std::vector<unsigned char> m_packed;
+    std::vector<std::vector<Encoded> > m_cache;	/* Per sector */
+    std::vector<unsigned char> m_encoded;
+
+    /* Clients (added and removed by the hub thread under m_mutex). */
+    std::vector<Client *> m_clients;
+    unsigned int m_nextId;
+
+    /* Private functions. */
+    void hubThread(void);
+    void acceptClient(void);
+    int readClient(Client *client);
+    int handshake(Client *client);
+    int readFrames(Client *client);
+    void snapshot(void);
+    void update(Client *client, int64_t now);
+    void queueFrame(Client *client, int opcode, const unsigned char *data,
+		    size_t len);
+    int sendPending(Client *client);
+    void closeClient(size_t idx);
+};
+
+#endif /* _SPX_WEB_STREAM_H */
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
@@ -0,0 +1,357 @@
+/*********************************************************************
+*
+* File: SPxWorkPool.cpp
+*
+* Purpose:
+*	Work-stealing thread pool (see SPxWorkPool.h).
+*
+**********************************************************************/
+
+/* Our own header. */
+#include "SPxWorkPool.h"
+
+
+/*********************************************************************
+*
+*	Public functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* SPxWorkPool::SPxWorkPool
+*	Constructor, starts numThreads - 1 worker threads.
+*
+* Params:
+*	numThreads		Total number of threads including the
+*				caller of Run(), at least one.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+SPxWorkPool::SPxWorkPool(unsigned int numThreads)
+    : m_numThreads((numThreads > 0) ? numThreads : 1),
+      m_generation(0),
+      m_fn(NULL),
+      m_userArg(NULL),
+      m_tasksRemaining(0),
+      m_numActive(0),
+      m_shutdown(0),
+      m_numSteals(0)
+{
+    for(unsigned int i = 0; i < m_numThreads; i++)
+    {
+	m_queues.push_back(new Queue);
+    }
+    for(unsigned int i = 1; i < m_numThreads; i++)
+    {
+	m_threads.push_back(std::thread(&SPxWorkPool::workerThread, this, i));
+    }
+} /* SPxWorkPool::SPxWorkPool() */
+
+
+/*====================================================================
+*
+* SPxWorkPool::~SPxWorkPool
+*	Destructor, stops and joins the worker threads.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*
+*===================================================================*/
+SPxWorkPool::~SPxWorkPool()
+{
+    {
+	std::lock_guard<std::mutex> lock(m_batchMutex);
+	m_shutdown = 1;
+    }
+    m_batchStart.notify_all();
+    for(size_t i = 0; i < m_threads.size(); i++)
+    {
+	m_threads[i].join();
+    }
+    for(size_t i = 0; i < m_queues.size(); i++)
+    {
+	delete m_queues[i];
+    }
+} /* SPxWorkPool::~SPxWorkPool() */
+
+
+/*====================================================================
+*
+* SPxWorkPool::Run
+*	Execute a batch of tasks and wait for completion.
+*
+* Params:
+*	numTasks		Number of tasks,
+*	fn			Task function,
+*	userArg			Passed to the task function.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	Contiguous index ranges are dealt to each worker so that
+*	neighbouring tasks (adjacent tiles or azimuths) tend to run on
+*	the same core.  Not re-entrant: one batch at a time.
+*
+*	The queues are only filled once every worker has left the last
+*	batch, and the batch is only started after that, so a worker
+*	never takes a task of a batch it was not woken for.
+*
+*===================================================================*/
+void SPxWorkPool::Run(unsigned int numTasks, SPxWorkPoolTaskFn_t fn,
+			void *userArg)
+{
+    if( (numTasks == 0) || (fn == NULL) )
+    {
+	return;
+    }
+
+    /* 스레드가 하나뿐이면 그냥 순서대로 실행 */
+    if( m_numThreads == 1 )
+    {
+	for(unsigned int i = 0; i < numTasks; i++)
+	{
+	    fn(userArg, i, 0);
+	}
+	return;
+    }
+
+    /* 이전 배치에서 모든 작업자가 빠져나올 때까지 대기 */
+    {
+	std::unique_lock<std::mutex> lock(m_batchMutex);
+	while( m_numActive != 0 )
+	{
+	    m_batchDone.wait(lock);
+	}
+    }
+
+    /* 작업을 연속 구간으로 나누어 각 작업자 큐에 배분 */
+    for(unsigned int w = 0; w < m_numThreads; w++)
+    {
+	unsigned int first = (unsigned int)(((unsigned long long)numTasks * w) / m_numThreads);
+	unsigned int last = (unsigned int)(((unsigned long long)numTasks * (w + 1)) / m_numThreads);
+	std::lock_guard<std::mutex> lock(m_queues[w]->mutex);
+	for(unsigned int i = first; i < last; i++)
+	{
+	    m_queues[w]->tasks.push_back(i);
+	}
+    }
+
+    {
+	std::lock_guard<std::mutex> lock(m_batchMutex);
+	m_fn = fn;
+	m_userArg = userArg;
+	m_tasksRemaining = numTasks;
+	m_numActive = m_numThreads - 1;
+	m_generation++;
+    }
+    m_batchStart.notify_all();
+
+    /* 호출한 스레드도 작업자 0 으로 참여 */
+    workUntilEmpty(0, fn, userArg);
+
+    std::unique_lock<std::mutex> lock(m_batchMutex);
+    while( m_tasksRemaining != 0 )
+    {
+	m_batchDone.wait(lock);
+    }
+} /* SPxWorkPool::Run() */
+
+
+/*====================================================================
+*
+* SPxWorkPool::GetChunkSize
+*	Choose how many items each task of a split batch handles.
+*
+* Params:
+*	numItems		Items to split (e.g. spokes of a frame),
+*	minItems		Smallest worthwhile task.
+*
+* Returns:
+*	Items per task, at least one.
+*
+* Notes
+*	Tasks are then ceil(numItems / size), the last one short.
+*
+*===================================================================*/
+unsigned int SPxWorkPool::GetChunkSize(unsigned int numItems,
+				       unsigned int minItems) const
+{
+    unsigned int numTasks = m_numThreads * 4;
+    unsigned int size = (numItems + numTasks - 1) / numTasks;
+    if( size < minItems )
+    {
+	size = minItems;
+    }
+    return( (size > 0) ? size : 1 );
+} /* SPxWorkPool::GetChunkSize() */
+
+
+/*====================================================================
+*
+* SPxWorkPool::GetNumCores
+*	Report the number of hardware threads.
+*
+* Params:
+*	None
+*
+* Returns:
+*	Number of hardware threads, at least one.
+*
+* Notes
+*
+*===================================================================*/
+unsigned int SPxWorkPool::GetNumCores(void)
+{
+    unsigned int n = std::thread::hardware_concurrency();
+    return( (n > 0) ? n : 1 );
+} /* SPxWorkPool::GetNumCores() */
+
+
+/*********************************************************************
+*
+*	Private functions
+*
+**********************************************************************/
+
+/*====================================================================
+*
+* SPxWorkPool::workerThread
+*	Body of each worker thread.
+*
+* Params:
+*	workerIdx		Index of this worker (1..numThreads-1).
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	The batch's function and argument are read under the batch mutex,
+*	and the worker reports leaving the batch so Run() can deal the
+*	next one.
+*
+*===================================================================*/
+void SPxWorkPool::workerThread(unsigned int workerIdx)
+{
+    unsigned long long seenGeneration = 0;
+    for(;;)
+    {
+	SPxWorkPoolTaskFn_t fn;
+	void *userArg;
+	{
+	    std::unique_lock<std::mutex> lock(m_batchMutex);
+	    while( !m_shutdown && (m_generation == seenGeneration) )
+	    {
+		m_batchStart.wait(lock);
+	    }
+	    if( m_shutdown )
+	    {
+		return;
+	    }
+	    seenGeneration = m_generation;
+	    fn = m_fn;
+	    userArg = m_userArg;
+	}
+	workUntilEmpty(workerIdx, fn, userArg);
+
+	std::lock_guard<std::mutex> lock(m_batchMutex);
+	if( --m_numActive == 0 )
+	{
+	    m_batchDone.notify_all();
+	}
+    }
+} /* SPxWorkPool::workerThread() */
+
+
+/*====================================================================
+*
+* SPxWorkPool::workUntilEmpty
+*	Execute tasks until no queue has any left.
+*
+* Params:
+*	workerIdx		Index of this worker,
+*	fn, userArg		The batch's task function and argument.
+*
+* Returns:
+*	Nothing
+*
+* Notes
+*	The worker finishing the last task wakes the caller of Run().
+*
+*===================================================================*/
+void SPxWorkPool::workUntilEmpty(unsigned int workerIdx,
+				 SPxWorkPoolTaskFn_t fn, void *userArg)
+{
+    unsigned int taskIdx;
+    while( takeTask(workerIdx, &taskIdx) )
+    {
+	fn(userArg, taskIdx, workerIdx);
+	if( m_tasksRemaining.fetch_sub(1) == 1 )
+	{
+	    std::lock_guard<std::mutex> lock(m_batchMutex);
+	    m_batchDone.notify_all();
+	}
+    }
+} /* SPxWorkPool::workUntilEmpty() */
+
+
+/*====================================================================
+*
+* SPxWorkPool::takeTask
+*	Take the next task for a worker, stealing if necessary.
+*
+* Params:
+*	workerIdx		Index of this worker,
+*	taskIdx			Set to the task to run.
+*
+* Returns:
+*	Non-zero if a task was taken, zero if all queues are empty.
+*
+* Notes
+*	Own work is taken from the back, stolen work from the front, so
+*	owner and thief work from opposite ends of a range.
+*
+*===================================================================*/
+int SPxWorkPool::takeTask(unsigned int workerIdx, unsigned int *taskIdx)
+{
+    Queue *own = m_queues[workerIdx];
+    {
+	std::lock_guard<std::mutex> lock(own->mutex);
+	if( !own->tasks.empty() )
+	{
+	    *taskIdx = own->tasks.back();
+	    own->tasks.pop_back();
+	    return(1);
+	}
+    }
+    for(unsigned int i = 1; i < m_numThreads; i++)
+    {
+	Queue *victim = m_queues[(workerIdx + i) % m_numThreads];
+	std::lock_guard<std::mutex> lock(victim->mutex);
+	if( !victim->tasks.empty() )
+	{
+	    *taskIdx = victim->tasks.front();
+	    victim->tasks.pop_front();
+	    m_numSteals++;
+	    return(1);
+	}
+    }
+    return(0);
+} /* SPxWorkPool::takeTask() */
+
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/
@@ -0,0 +1,96 @@
+/*********************************************************************
+*
+* File: SPxWorkPool.h
+*
+* Purpose:
+*	Small work-stealing thread pool for data-parallel batches.
+*
+*	A batch is a number of independent tasks identified by index.
+*	Run() deals the indices out to per-worker deques and blocks until
+*	all of them have been executed.  Each worker pops from the back of
+*	its own deque and, when that is empty, steals from the front of
+*	the others, so uneven task costs (e.g. tiles with and without
+*	video) still keep every core busy.  The calling thread works as
+*	worker zero, so a pool of one thread runs everything inline.
+*
+*	The pool does not depend on the SPx library.
+*
+**********************************************************************/
+
+#ifndef _SPX_WORK_POOL_H
+#define _SPX_WORK_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* Task function, called once per task index. */
+typedef void (*SPxWorkPoolTaskFn_t)(void *userArg, unsigned int taskIdx,
+				    unsigned int workerIdx);
+
+class SPxWorkPool
+{
+public:
+    /* Constructor/destructor.  numThreads includes the caller. */
+    explicit SPxWorkPool(unsigned int numThreads);
+    ~SPxWorkPool();
+
+    /* Run tasks 0..numTasks-1 and wait for them all to finish. */
+    void Run(unsigned int numTasks, SPxWorkPoolTaskFn_t fn, void *userArg);
+
+    /* Information retrieval. */
+    unsigned int GetNumThreads(void) const { return m_numThreads; }
+    unsigned long long GetNumSteals(void) const { return m_numSteals; }
+
+    /* Items per task when splitting numItems into tasks, about four
+     * per thread for stealing to even out, but at least minItems.
+     */
+    unsigned int GetChunkSize(unsigned int numItems, unsigned int minItems) const;
+
+    /* Number of hardware threads, at least one. */
+    static unsigned int GetNumCores(void);
+
+private:
+    /* Per-worker queue of task indices. */
+    struct Queue
+    {
+	std::mutex mutex;
+	std::deque<unsigned int> tasks;
+    };
+
+    unsigned int m_numThreads;
+    std::vector<Queue *> m_queues;
+    std::vector<std::thread> m_threads;
+
+    /* Current batch, and the worker threads still working on it (a
+     * new batch is not dealt until they have all left the last one).
+     */
+    std::mutex m_batchMutex;
+    std::condition_variable m_batchStart;
+    std::condition_variable m_batchDone;
+    unsigned long long m_generation;
+    SPxWorkPoolTaskFn_t m_fn;
+    void *m_userArg;
+    std::atomic<unsigned int> m_tasksRemaining;
+    unsigned int m_numActive;
+    int m_shutdown;
+
+    std::atomic<unsigned long long> m_numSteals;
+
+    /* Private functions. */
+    void workerThread(unsigned int workerIdx);
+    void workUntilEmpty(unsigned int workerIdx, SPxWorkPoolTaskFn_t fn,
+			void *userArg);
+    int takeTask(unsigned int workerIdx, unsigned int *taskIdx);
+};
+
+#endif /* _SPX_WORK_POOL_H */
+
+/*********************************************************************
+*
+* End of file
+*
+**********************************************************************/